@@ -0,0 +1,79 @@
+// Boilerplate stripping: milliseconds per 1 MB crawled page and MB/s for
+// each rule preset, on markdown mixing prose, lists, headings, navigation
+// chrome and reference sections.
+//
+// Usage: bench_boilerplate [pages]
+
+#include "boilerplate_stripper.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// About 1 MB of page-like markdown, 1 line in 12 of it boilerplate
+std::string makePage(std::mt19937& rng) {
+    const char* prose[] = {
+        "Search engines crawl the web and build an inverted index of the pages they find.",
+        "The ranking function combines term statistics with link analysis and freshness.",
+        "Caf\xC3\xA9 owners in \xE6\x9D\xB1\xE4\xBA\xAC report that most visitors arrive from search results.",
+        "  Indented continuation of the previous paragraph, kept as is.",
+        "* A list item describing one of the crawler settings",
+        "1. A numbered step in the indexing pipeline",
+        "",
+    };
+    const char* chrome[] = {
+        "[Jump to content](#content)", "Main menu", "Cookie settings", "Toggle navigation",
+        "[Privacy policy](https://example.org/privacy)", "Theme Auto Light Dark", "Previous topic",
+    };
+    const char* headings[] = {"## History", "## Design", "### Details", "## See also", "## References"};
+    std::string page;
+    while (page.size() < (1 << 20)) {
+        const unsigned roll = rng() % 60;
+        if (roll < 5) {
+            page += chrome[rng() % 7];
+        } else if (roll < 7) {
+            page += headings[rng() % 5];
+        } else {
+            page += prose[rng() % 7];
+        }
+        page += '\n';
+    }
+    return page;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t pages = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200;
+    std::mt19937 rng(17);
+    const std::string page = makePage(rng);
+    const double mb = page.size() / 1048576.0;
+
+    std::printf("%zu pages of %.2f MB\n", pages, mb);
+    std::printf("%-8s %12s %10s %10s\n", "rules", "ms/page", "MB/s", "kept %");
+    const char* names[] = {"crawler", "scraper", "web-api"};
+    const BoilerplateRules presets[] = {BoilerplateRules::crawler(), BoilerplateRules::scraper(),
+                                        BoilerplateRules::webApi()};
+    for (size_t r = 0; r < 3; ++r) {
+        BoilerplateStripper stripper;
+        if (!stripper.setRules(presets[r])) {
+            return 1;
+        }
+        std::string out;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < pages; ++i) {
+            stripper.strip(page, out);
+        }
+        const double seconds = secondsSince(start);
+        std::printf("%-8s %12.3f %10.1f %10.1f\n", names[r], seconds * 1000 / pages, mb * pages / seconds,
+                    100.0 * out.size() / page.size());
+    }
+    return 0;
+}
@@ -0,0 +1,88 @@
+// Chunker throughput: MB/s of sentence packing and of character windows
+// (the settings rag.embed uses) on crawled-page-like text, splitting whole
+// pages and streaming them in 16 KiB pieces.
+//
+// Usage: bench_chunker [megabytes]
+
+#include "chunker.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// A page of mostly English sentences with some accented and CJK words,
+// paragraph breaks and the odd non-breaking space
+std::string makePage(std::mt19937& rng, size_t bytes) {
+    const char* words[] = {"the", "search", "results", "show", "that", "pages", "are", "ranked", "by", "relevance",
+                           "and", "crawled", "content", "is", "stored", "café", "données", "東京", "with", "of"};
+    const char* separators[] = {" ", " ", " ", " ", " ", " ", "\n\n", "\xC2\xA0"};
+    std::string page;
+    while (page.size() < bytes) {
+        const size_t count = 5 + rng() % 25;
+        for (size_t w = 0; w < count; ++w) {
+            page += w > 0 ? " " : "";
+            page += words[rng() % 20];
+        }
+        page += rng() % 10 == 0 ? "?" : ".";
+        page += separators[rng() % 8];
+    }
+    return page;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 32;
+    std::mt19937 rng(11);
+    std::vector<std::string> pages;
+    size_t total = 0;
+    while (total < megabytes << 20) {
+        pages.push_back(makePage(rng, 4096 + rng() % 60000));
+        total += pages.back().size();
+    }
+
+    ChunkerOptions sentences;
+    ChunkerOptions windows;
+    windows.overlapChars = 200;
+
+    std::printf("%zu MB in %zu pages\n", megabytes, pages.size());
+    std::printf("%-10s %-8s %10s %12s\n", "mode", "input", "MB/s", "chunks/s");
+    const double mb = total / 1048576.0;
+    for (const ChunkerOptions* options : {&sentences, &windows}) {
+        const char* name = options == &sentences ? "sentences" : "windows";
+        Chunker chunker(*options);
+        size_t chunks = 0;
+        size_t bytes = 0;
+        auto count = [&](std::string_view chunk) {
+            ++chunks;
+            bytes += chunk.size();
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        for (const std::string& page : pages) {
+            chunker.split(page, count);
+        }
+        double seconds = secondsSince(start);
+        std::printf("%-10s %-8s %10.1f %12.0f\n", name, "whole", mb / seconds, chunks / seconds);
+
+        chunks = 0;
+        start = std::chrono::steady_clock::now();
+        for (const std::string& page : pages) {
+            for (size_t offset = 0; offset < page.size(); offset += 16384) {
+                chunker.feed(std::string_view(page).substr(offset, 16384), count);
+            }
+            chunker.finish(count);
+        }
+        seconds = secondsSince(start);
+        std::printf("%-10s %-8s %10.1f %12.0f\n", name, "stream", mb / seconds, chunks / seconds);
+    }
+    return 0;
+}
@@ -0,0 +1,150 @@
+// Completion cache: cost of keying a request, latency of a hit, and hit
+// ratio against a plain LRU of the same byte size. The trace draws prompts
+// from a Zipf distribution and mixes in one-off prompts, which a chat
+// gateway sees plenty of; each miss is stored, as the gateway stores the
+// provider's response.
+//
+// Usage: bench_completion_cache [cache_mb] [prompts] [requests] [one_off_percent]
+
+#include "completion_cache.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The baseline: one LRU list bounded by the same bytes per entry as the cache accounts
+class LruCache {
+public:
+    explicit LruCache(size_t maxBytes) : maxBytes_(maxBytes), bytes_(0) {}
+
+    bool get(const std::string& key) {
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            return false;
+        }
+        order_.splice(order_.begin(), order_, it->second);
+        return true;
+    }
+
+    void put(const std::string& key, size_t size) {
+        order_.emplace_front(key, size + 256);
+        index_[key] = order_.begin();
+        bytes_ += size + 256;
+        while (bytes_ > maxBytes_) {
+            bytes_ -= order_.back().second;
+            index_.erase(order_.back().first);
+            order_.pop_back();
+        }
+    }
+
+private:
+    size_t maxBytes_;
+    size_t bytes_;
+    std::list<std::pair<std::string, size_t>> order_;
+    std::unordered_map<std::string, std::list<std::pair<std::string, size_t>>::iterator> index_;
+};
+
+std::vector<CompletionMessage> request(size_t prompt) {
+    return {{"system", "You are a research assistant. Answer from the sources given and cite them."},
+            {"user", "Question " + std::to_string(prompt) + ": " + std::string(600, 'q')}};
+}
+
+size_t responseSize(size_t prompt) {
+    return 1000 + (prompt * 2654435761u) % 3000;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t cacheMb = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+    const size_t prompts = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200000;
+    const size_t requests = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 2000000;
+    const size_t oneOffPercent = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 30;
+    std::mt19937_64 rng(11);
+
+    // Keying a request: SHA-256 over the provider and about 700 bytes of messages
+    const int keyings = 200000;
+    auto start = std::chrono::steady_clock::now();
+    unsigned check = 0;
+    for (int i = 0; i < keyings; ++i) {
+        check += CompletionCache::key("deepseek", request(static_cast<size_t>(i))).bytes[0];
+    }
+    std::printf("key(): %.2f us per request (%u)\n", secondsSince(start) * 1e6 / keyings, check & 1);
+
+    // Hit latency on a warm cache
+    CompletionCacheOptions options;
+    options.maxBytes = cacheMb << 20;
+    {
+        CompletionCache cache(options);
+        std::vector<CompletionKey> keys;
+        for (size_t i = 0; i < 4096; ++i) {
+            keys.push_back(CompletionCache::key("deepseek", request(i)));
+            cache.put(keys.back(), std::string(responseSize(i), 'r'), 0);
+        }
+        const size_t gets = 5000000;
+        size_t bytes = 0;
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < gets; ++i) {
+            bytes += cache.get(keys[i & 4095], 1)->size();
+        }
+        std::printf("get() hit: %.0f ns (%zu bytes served)\n", secondsSince(start) * 1e9 / gets, bytes);
+    }
+
+    // Hit ratio: Zipf(0.9) over the prompts, with one-off prompts mixed in
+    std::vector<double> cdf(prompts);
+    double sum = 0;
+    for (size_t i = 0; i < prompts; ++i) {
+        sum += 1.0 / std::pow(static_cast<double>(i + 1), 0.9);
+        cdf[i] = sum;
+    }
+    std::uniform_real_distribution<double> uniform(0, sum);
+    std::vector<size_t> trace(requests);
+    size_t nextOneOff = prompts;
+    for (size_t& prompt : trace) {
+        prompt = rng() % 100 < oneOffPercent ? nextOneOff++
+                                             : std::lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin();
+    }
+    std::vector<CompletionKey> traceKeys(trace.size());
+    for (size_t i = 0; i < trace.size(); ++i) {
+        traceKeys[i] = CompletionCache::key("deepseek", request(trace[i]));
+    }
+
+    CompletionCache cache(options);
+    LruCache lru(options.maxBytes);
+    size_t lruHits = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < trace.size(); ++i) {
+        if (!cache.get(traceKeys[i], 1)) {
+            cache.put(traceKeys[i], std::string(responseSize(trace[i]), 'r'), 1);
+        }
+    }
+    const double cacheSeconds = secondsSince(start);
+    for (size_t i = 0; i < trace.size(); ++i) {
+        const std::string key(reinterpret_cast<const char*>(traceKeys[i].bytes), sizeof(traceKeys[i].bytes));
+        if (lru.get(key)) {
+            ++lruHits;
+        } else {
+            lru.put(key, responseSize(trace[i]));
+        }
+    }
+    const CompletionCacheStats stats = cache.stats();
+    std::printf("trace: %zu requests, %zu prompts, %zu%% one-off, %zu MB cache\n", requests, prompts, oneOffPercent,
+                cacheMb);
+    std::printf("W-TinyLFU: %.1f%% hits, %zu entries, %llu evicted, %llu rejected, %.2f us per request\n",
+                100.0 * stats.hits / requests, stats.entries, static_cast<unsigned long long>(stats.evictions),
+                static_cast<unsigned long long>(stats.rejected), cacheSeconds * 1e6 / requests);
+    std::printf("LRU:       %.1f%% hits\n", 100.0 * lruHits / requests);
+    return stats.bytes <= stats.capacityBytes ? 0 : 1;
+}
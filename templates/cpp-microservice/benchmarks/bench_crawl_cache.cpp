@@ -0,0 +1,164 @@
+// Crawl cache throughput: puts of markdown pages into the segment log, then
+// single-threaded gets (decompressing the page into a CrawlPage each time)
+// over a mix of hits and misses, the same gets once every domain has a
+// trained dictionary, and a reopen that replays every segment.
+//
+// Usage: bench_crawl_cache [pages] [gets] [kilobytes per page]
+
+#include "crawl_cache.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Word of a made-up language: 1-4 syllables, so lengths and letter
+// statistics look like prose rather than numbered tokens
+std::string word(size_t rank) {
+    static const char* const syllables[] = {"the", "an", "de", "ing", "re", "con", "ter", "al", "is", "ment",
+                                            "pro", "ly", "ex", "tion", "or", "com", "er", "in", "at", "per",
+                                            "ble", "ver", "un", "es", "ty", "ar", "ful", "mo", "sa", "ri"};
+    std::string out;
+    size_t n = rank;
+    do {
+        out += syllables[n % 30];
+        n /= 30;
+    } while (n > 0);
+    return out;
+}
+
+// Markdown over a Zipf-distributed 20000-word vocabulary, with headings, links and lists
+std::string markdown(std::mt19937& rng, size_t bytes) {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::string out = "# Page title\n\n";
+    size_t words = 0;
+    while (out.size() < bytes) {
+        out += word(static_cast<size_t>(std::pow(20000.0, uniform(rng))) - 1);
+        ++words;
+        if (words % 120 == 0) {
+            out += "\n\n## Section " + std::to_string(words / 120) + "\n\n";
+        } else if (words % 40 == 0) {
+            out += " [link](https://example.com/" + std::to_string(rng() % 1000) + ").\n- ";
+        } else {
+            out += words % 13 == 0 ? ". " : " ";
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t pages = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    const size_t gets = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+    const size_t kilobytes = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 12;
+
+    const std::filesystem::path dir =
+        std::filesystem::temp_directory_path() / ("bench_crawl_cache_" + std::to_string(getpid()));
+    std::filesystem::remove_all(dir);
+    CrawlCacheOptions options;
+    options.directory = dir.string();
+
+    std::mt19937 rng(42);
+    std::vector<std::string> bodies;
+    for (size_t i = 0; i < 64; ++i) {
+        bodies.push_back(markdown(rng, kilobytes * 1024));
+    }
+    const double now =
+        std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+    CrawlCache cache;
+    if (!cache.open(options)) {
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    CrawlPage page;
+    for (size_t i = 0; i < pages; ++i) {
+        page.url = "https://site" + std::to_string(i % 97) + ".com/article/" + std::to_string(i);
+        page.sourceDomain = "site" + std::to_string(i % 97) + ".com";
+        page.crawledAt = now;
+        page.fields = {{"markdown", bodies[i % bodies.size()]},
+                       {"title", "Article " + std::to_string(i)},
+                       {"word_count", std::to_string(bodies[i % bodies.size()].size() / 6)},
+                       {"success", "true"}};
+        if (!cache.put(page)) {
+            return 1;
+        }
+    }
+    const double putSeconds = secondsSince(start);
+    const CrawlCacheStats stats = cache.stats();
+    std::printf("put: %zu pages of %zu KB in %.2f s (%.0f puts/s), %zu segments\n", pages, kilobytes, putSeconds,
+                pages / putSeconds, stats.segments);
+    std::printf("compression: %.1f MB of fields in %.1f MB of records (ratio %.2f)\n", stats.rawBytes / 1e6,
+                stats.liveBytes / 1e6, static_cast<double>(stats.rawBytes) / stats.liveBytes);
+
+    // 90% hits, 10% misses, uniformly over the cached URLs
+    std::vector<std::string> urls;
+    for (size_t i = 0; i < 4096; ++i) {
+        const size_t n = rng() % pages;
+        urls.push_back("https://site" + std::to_string(n % 97) + ".com/article/" + std::to_string(n) +
+                       (i % 10 == 9 ? "?missing" : ""));
+    }
+    size_t hits = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < gets; ++i) {
+        hits += cache.get(urls[i & 4095], page);
+    }
+    const double getSeconds = secondsSince(start);
+    std::printf("get: %zu lookups (%zu hits) in %.2f s: %.0f gets/s, %.2f us each, %.0f MB/s decompressed\n", gets,
+                hits, getSeconds, gets / getSeconds, getSeconds * 1e6 / gets,
+                hits * static_cast<double>(stats.rawBytes) / stats.entries / getSeconds / 1e6);
+
+    start = std::chrono::steady_clock::now();
+    size_t present = 0;
+    for (size_t i = 0; i < gets; ++i) {
+        present += cache.contains(urls[i & 4095], options.ttlSeconds);
+    }
+    const double containsSeconds = secondsSince(start);
+    std::printf("contains: %.0f lookups/s (%zu present)\n", gets / containsSeconds, present);
+
+    // Train every domain's dictionary and rewrite the sealed segments' pages with it
+    start = std::chrono::steady_clock::now();
+    size_t dictionaries = 0;
+    do {
+        dictionaries = cache.stats().dictionaries;
+        if (!cache.trainDictionaries()) {
+            return 1;
+        }
+    } while (cache.stats().dictionaries > dictionaries);
+    if (!cache.compact(true)) {
+        return 1;
+    }
+    const double trainSeconds = secondsSince(start);
+    const CrawlCacheStats trained = cache.stats();
+    std::printf("dictionaries: %zu trained and pages recompressed in %.2f s, ratio %.2f\n", trained.dictionaries,
+                trainSeconds, static_cast<double>(trained.rawBytes) / trained.liveBytes);
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < gets; ++i) {
+        cache.get(urls[i & 4095], page);
+    }
+    const double dictionarySeconds = secondsSince(start);
+    const CrawlCacheStats decoded = cache.stats();
+    std::printf("get with dictionaries: %.0f gets/s, %.2f us each, decode %.0f MB/s\n", gets / dictionarySeconds,
+                dictionarySeconds * 1e6 / gets,
+                (decoded.decodedBytes - trained.decodedBytes) / 1e3 / (decoded.decodeMillis - trained.decodeMillis));
+
+    cache.close();
+    if (!cache.open(options)) {
+        return 1;
+    }
+    std::printf("reopen: replayed %zu pages in %.1f ms\n", cache.stats().entries, cache.stats().openMillis);
+    cache.close();
+    std::filesystem::remove_all(dir);
+    return 0;
+}
@@ -0,0 +1,100 @@
+// Crawl frontier under a batch crawl: millions of URLs spread over many
+// hosts, a share of them pushed with a delay, leased on a simulated
+// millisecond clock with every lease finished at once. Reports push and
+// lease cost, memory per URL, and checks that no host is leased sooner
+// than its interval while every host runs at it.
+//
+// Usage: bench_crawl_frontier [urls] [hosts] [interval_ms]
+
+#include "crawl_frontier.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t urls = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+    const size_t hosts = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100000;
+    const uint64_t interval = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1000;
+
+    CrawlFrontierOptions options;
+    options.domainIntervalMillis = interval;
+    CrawlFrontier frontier(options);
+    std::mt19937_64 rng(42);
+    const CrawlPriority classes[] = {CrawlPriority::Interactive, CrawlPriority::Batch, CrawlPriority::Background};
+
+    // One in eight URLs is delayed by up to a minute, as a retry would be
+    size_t delayed = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < urls; ++i) {
+        const size_t host = rng() % hosts;
+        const std::string url = "https://host" + std::to_string(host) + ".example/article/" + std::to_string(i);
+        const uint64_t delay = rng() % 8 == 0 ? 1 + rng() % 60000 : 0;
+        delayed += delay > 0;
+        if (!frontier.push(url, classes[rng() % 3 == 0 ? 2 : 1], 0, delay)) {
+            std::fprintf(stderr, "push refused at %zu\n", i);
+            return 1;
+        }
+    }
+    const double pushSeconds = secondsSince(start);
+    CrawlFrontierStats stats = frontier.stats();
+    std::printf("push: %zu URLs (%zu delayed) over %zu hosts in %.2f s (%.0f ns each), %.0f bytes per URL\n", urls,
+                delayed, stats.domains, pushSeconds, pushSeconds * 1e9 / urls,
+                static_cast<double>(stats.memoryBytes) / urls);
+
+    // Lease and finish on a simulated clock until everything is out
+    std::unordered_map<std::string, uint64_t> lastLease;
+    lastLease.reserve(hosts);
+    std::vector<FrontierLease> leases;
+    uint64_t tooSoon = 0;
+    uint64_t onTime = 0;
+    uint64_t leased = 0;
+    uint64_t now = 0;
+    double leaseSeconds = 0;
+    while (leased < urls) {
+        leases.clear();
+        start = std::chrono::steady_clock::now();
+        frontier.lease(SIZE_MAX, now, leases);
+        for (const FrontierLease& lease : leases) {
+            frontier.finish(lease.host, now);
+        }
+        leaseSeconds += secondsSince(start);
+        for (const FrontierLease& lease : leases) {
+            auto it = lastLease.find(lease.host);
+            if (it != lastLease.end()) {
+                tooSoon += now - it->second < interval;
+                onTime += now - it->second == interval;
+                it->second = now;
+            } else {
+                lastLease.emplace(lease.host, now);
+            }
+        }
+        leased += leases.size();
+        // Sleep as a worker would, straight to the next time something is ready
+        const int64_t wait = frontier.waitMillis(now);
+        now += wait > 0 ? static_cast<uint64_t>(wait) : 1;
+    }
+    stats = frontier.stats();
+    std::printf("lease+finish: %.0f ns per URL, simulated %.1f s, max wait %.1f s\n", leaseSeconds * 1e9 / urls,
+                now / 1e3, stats.maxWaitMillis / 1e3);
+    const uint64_t repeats = std::max<uint64_t>(urls - lastLease.size(), 1);
+    std::printf("politeness: %llu leases before the interval ran out, %.1f%% of repeat leases exactly on it\n",
+                static_cast<unsigned long long>(tooSoon), 100.0 * onTime / repeats);
+    std::printf("leases by class: interactive %llu, batch %llu, background %llu\n",
+                static_cast<unsigned long long>(stats.leasesByClass[0]),
+                static_cast<unsigned long long>(stats.leasesByClass[1]),
+                static_cast<unsigned long long>(stats.leasesByClass[2]));
+    return tooSoon == 0 ? 0 : 1;
+}
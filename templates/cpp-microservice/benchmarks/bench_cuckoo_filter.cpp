@@ -0,0 +1,151 @@
+// Cuckoo filter in front of the crawl cache: inserts and lookups of the
+// filter on its own (throughput, false-positive rate against the bound),
+// then gets and contains() of uncached URLs against a crawl cache holding
+// many small pages, with and without the filter.
+//
+// Usage: bench_cuckoo_filter [urls] [lookups]
+
+#include "crawl_cache.h"
+#include "cuckoo_filter.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string url(const char* host, size_t n) {
+    return std::string("https://") + host + std::to_string(n % 997) + ".com/article/" + std::to_string(n);
+}
+
+// Misses per second of @p lookups gets and contains() for URLs the cache does not hold
+void measureMisses(const CrawlCache& cache, size_t urls, size_t lookups, const char* label) {
+    std::vector<std::string> absent;
+    for (size_t i = 0; i < 65536; ++i) {
+        absent.push_back(url("missing", urls + i * 7919));
+    }
+    CrawlPage page;
+    size_t hits = 0;
+    for (const std::string& u : absent) {
+        hits += cache.contains(u, 86400);
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < lookups; ++i) {
+        hits += cache.get(absent[i & 65535], page);
+    }
+    const double getSeconds = secondsSince(start);
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < lookups; ++i) {
+        hits += cache.contains(absent[i & 65535], 86400);
+    }
+    const double containsSeconds = secondsSince(start);
+    std::printf("%s: get miss %.0f ns, contains miss %.0f ns (%zu false hits)\n", label, getSeconds * 1e9 / lookups,
+                containsSeconds * 1e9 / lookups, hits);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t urls = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const size_t lookups = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000000;
+
+    // The filter alone, filled to 90%
+    std::mt19937_64 rng(42);
+    CuckooFilter filter;
+    if (!filter.create("", urls * 10 / 9)) {
+        return 1;
+    }
+    const size_t target = filter.capacity() * 9 / 10;
+    std::vector<uint64_t> hashes(target);
+    for (uint64_t& hash : hashes) {
+        hash = rng();
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (uint64_t hash : hashes) {
+        if (!filter.insert(hash)) {
+            std::fprintf(stderr, "insert failed at load %.3f\n", filter.load());
+            return 1;
+        }
+    }
+    const double insertSeconds = secondsSince(start);
+    start = std::chrono::steady_clock::now();
+    size_t found = 0;
+    for (size_t i = 0; i < lookups; ++i) {
+        found += filter.contains(hashes[(i * 2654435761u) % hashes.size()]);
+    }
+    const double hitSeconds = secondsSince(start);
+    start = std::chrono::steady_clock::now();
+    size_t passed = 0;
+    for (size_t i = 0; i < lookups; ++i) {
+        passed += filter.contains(rng());
+    }
+    const double missSeconds = secondsSince(start);
+    if (found != lookups) {
+        std::fprintf(stderr, "filter missed %zu inserted hashes\n", lookups - found);
+        return 1;
+    }
+    std::printf("filter: %zu hashes at load %.2f in %.1f MB (%.1f bits each), insert %.0f ns\n", filter.size(),
+                filter.load(), filter.memoryBytes() / 1e6, filter.memoryBytes() * 8.0 / filter.size(),
+                insertSeconds * 1e9 / target);
+    std::printf("filter: contains %.0f ns present, %.0f ns absent; false positives %.4f%% (bound %.4f%%)\n",
+                hitSeconds * 1e9 / lookups, missSeconds * 1e9 / lookups, 100.0 * passed / lookups,
+                100.0 * filter.expectedFalsePositiveRate());
+
+    // A crawl cache of small pages, so the table rather than decompression dominates
+    const std::filesystem::path dir =
+        std::filesystem::temp_directory_path() / ("bench_cuckoo_filter_" + std::to_string(getpid()));
+    std::filesystem::remove_all(dir);
+    CrawlCacheOptions options;
+    options.directory = dir.string();
+    options.dictionaryBytes = 0;
+    const double now =
+        std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+    CrawlCache cache;
+    if (!cache.open(options)) {
+        return 1;
+    }
+    start = std::chrono::steady_clock::now();
+    CrawlPage page;
+    page.crawledAt = now;
+    page.fields = {{"title", "Article"}, {"success", "true"}};
+    for (size_t i = 0; i < urls; ++i) {
+        page.url = url("site", i);
+        page.sourceDomain = "site" + std::to_string(i % 997) + ".com";
+        if (!cache.put(page)) {
+            return 1;
+        }
+    }
+    const double putSeconds = secondsSince(start);
+    CrawlCacheStats stats = cache.stats();
+    std::printf("cache: %zu pages put in %.2f s (%.0f puts/s), filter %.1f MB at load %.2f\n", stats.entries,
+                putSeconds, urls / putSeconds, stats.filterBytes / 1e6, stats.filterLoad);
+    measureMisses(cache, urls, lookups, "with filter");
+    stats = cache.stats();
+    std::printf("with filter: observed false positives %.4f%% (expected %.4f%%)\n",
+                100.0 * stats.filterFalsePositives / (stats.filterNegatives + stats.filterFalsePositives),
+                100.0 * stats.filterExpectedFpr);
+
+    cache.close();
+    start = std::chrono::steady_clock::now();
+    if (!cache.open(options)) {
+        return 1;
+    }
+    std::printf("reopen with a clean filter: %.0f ms\n", secondsSince(start) * 1e3);
+    cache.close();
+    options.filter = false;
+    if (!cache.open(options)) {
+        return 1;
+    }
+    measureMisses(cache, urls, lookups, "table only ");
+    cache.close();
+    std::filesystem::remove_all(dir);
+    return 0;
+}
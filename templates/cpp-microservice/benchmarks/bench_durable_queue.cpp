@@ -0,0 +1,104 @@
+// Durable forward queue: delivery throughput against a growing backlog,
+// and append throughput with fdatasync group commit. Delivery polls in
+// batches and acks each message, as the background sender does; the rate
+// should not depend on how many messages wait behind the cursor. Appends
+// run from 1 and 8 threads with syncWrites, and report how many appends
+// shared each fdatasync.
+//
+// Usage: bench_durable_queue [max_backlog] [payload_bytes] [directory]
+
+#include "durable_queue.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t maxBacklog = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const size_t payloadBytes = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 256;
+    const std::string directory = argc > 3 ? argv[3] : "bench_durable_queue_data";
+    const std::string payload(payloadBytes, 'p');
+    const size_t delivered = 20000;
+
+    for (size_t backlog = 10000; backlog <= maxBacklog; backlog *= 10) {
+        std::filesystem::remove_all(directory);
+        DurableQueueOptions options;
+        options.directory = directory;
+        options.syncWrites = false;
+        DurableQueue queue;
+        if (!queue.open(options)) {
+            return 1;
+        }
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < backlog + delivered; ++i) {
+            if (queue.append(payload) == 0) {
+                return 1;
+            }
+        }
+        queue.sync();
+        const double fillSeconds = secondsSince(start);
+
+        std::vector<QueueMessage> messages;
+        size_t acked = 0;
+        start = std::chrono::steady_clock::now();
+        while (acked < delivered) {
+            messages.clear();
+            queue.poll(64, 0, messages);
+            for (const QueueMessage& message : messages) {
+                acked += queue.ack(message.seq);
+            }
+        }
+        queue.sync();
+        const double deliverSeconds = secondsSince(start);
+        const DurableQueueStats stats = queue.stats();
+        std::printf("backlog %8zu: filled at %.0f appends/s, delivered+acked %zu at %.0f messages/s, %zu segments\n",
+                    backlog, (backlog + delivered) / fillSeconds, acked, acked / deliverSeconds, stats.segments);
+    }
+
+    const int threadCounts[] = {1, 8};
+    for (int threads : threadCounts) {
+        std::filesystem::remove_all(directory);
+        DurableQueueOptions options;
+        options.directory = directory;
+        DurableQueue queue;
+        if (!queue.open(options)) {
+            return 1;
+        }
+        std::atomic<bool> stop(false);
+        std::atomic<uint64_t> failed(0);
+        std::vector<std::thread> workers;
+        auto start = std::chrono::steady_clock::now();
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&] {
+                while (!stop.load(std::memory_order_relaxed)) {
+                    failed += queue.append(payload) == 0;
+                }
+            });
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(2));
+        stop = true;
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        const double seconds = secondsSince(start);
+        const DurableQueueStats stats = queue.stats();
+        std::printf("synced appends, %d thread%s: %.0f appends/s, %.1f appends per fdatasync, %llu failed\n", threads,
+                    threads == 1 ? "" : "s", stats.appended / seconds,
+                    static_cast<double>(stats.appended) / std::max<uint64_t>(stats.syncs, 1),
+                    static_cast<unsigned long long>(failed.load()));
+    }
+    std::filesystem::remove_all(directory);
+    return 0;
+}
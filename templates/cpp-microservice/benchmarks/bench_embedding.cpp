@@ -0,0 +1,87 @@
+// Embedding throughput: tokens/s of the native forward pass on a randomly
+// initialized model with the all-MiniLM-L6-v2 shape, fp32 against int8
+// weights, one sequence per call against ragged batches.
+//
+// Usage: bench_embedding [sequences] [tokens_per_sequence] [batch]
+
+#include "embedding_model.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Runs every sequence through the model in groups of `batch`, returning tokens/s
+double measure(const EmbeddingModel& model, const std::vector<std::vector<int32_t>>& sequences, size_t batch,
+               ThreadPool* pool) {
+    std::vector<float> out(batch * model.config().hidden);
+    size_t tokens = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t begin = 0; begin < sequences.size(); begin += batch) {
+        size_t end = std::min(sequences.size(), begin + batch);
+        std::vector<std::vector<int32_t>> group(sequences.begin() + begin, sequences.begin() + end);
+        model.embed(group, out.data(), pool);
+        for (const std::vector<int32_t>& sequence : group) {
+            tokens += sequence.size();
+        }
+    }
+    return tokens / secondsSince(start);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+    const size_t length = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 128;
+    const size_t batch = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 32;
+
+    EmbeddingModelConfig config;
+    std::vector<float> parameters(EmbeddingModel::parameterCount(config));
+    std::mt19937 rng(42);
+    std::normal_distribution<float> normal(0.0f, 0.05f);
+    for (float& x : parameters) {
+        x = normal(rng);
+    }
+    std::string path =
+        (std::filesystem::temp_directory_path() / ("bench_embedding_" + std::to_string(getpid()) + ".dsem")).string();
+    if (!EmbeddingModel::write(path, config, parameters.data())) {
+        return 1;
+    }
+    parameters = std::vector<float>();
+
+    // Lengths vary around the target, as chunked documents do
+    std::uniform_int_distribution<size_t> lengths(length / 2, length);
+    std::uniform_int_distribution<int32_t> ids(1000, static_cast<int32_t>(config.vocabSize) - 1);
+    std::vector<std::vector<int32_t>> sequences(count);
+    for (std::vector<int32_t>& sequence : sequences) {
+        sequence.resize(lengths(rng));
+        for (int32_t& id : sequence) {
+            id = ids(rng);
+        }
+        sequence.front() = 101;
+        sequence.back() = 102;
+    }
+
+    ThreadPool pool(0);
+    std::printf("%zu threads, %zu sequences of %zu-%zu tokens\n", pool.size() + 1, count, length / 2, length);
+    std::printf("%-8s %8s %12s\n", "weights", "batch", "tokens/s");
+    for (bool quantize : {false, true}) {
+        EmbeddingModel model;
+        if (!model.load(path, quantize)) {
+            return 1;
+        }
+        for (size_t b : {static_cast<size_t>(1), batch}) {
+            std::printf("%-8s %8zu %12.0f\n", quantize ? "int8" : "fp32", b, measure(model, sequences, b, &pool));
+        }
+    }
+    std::filesystem::remove(path);
+    return 0;
+}
@@ -0,0 +1,106 @@
+// Flat scan vs HNSW crossover: per-query latency of an exact SIMD scan and
+// of a graph search (plus the one-off graph build) at growing row counts.
+//
+// Usage: bench_flat_scan [max_rows] [queries]
+
+#include "bench_data.h"
+#include "flat_scan.h"
+#include "hnsw_index.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+const uint32_t kDim = 384;
+const size_t kTopK = 10;
+
+double millisSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t maxRows = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    const size_t queries = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200;
+
+    std::vector<float> data;
+    std::vector<float> queryData;
+    clusteredVectors(maxRows, queries, kDim, data, queryData);
+
+    ThreadPool pool;
+    std::printf("%zu threads, dim %u, k %zu, ef 64\n", pool.size() + 1, kDim, kTopK);
+    std::printf("%8s %12s %12s %12s %12s %10s %14s\n", "rows", "flat us", "pool us", "hnsw us", "build ms",
+                "recall", "break-even q");
+
+    for (size_t rows : {500, 1000, 2000, 5000, 10000, 20000, 50000}) {
+        if (rows > maxRows) {
+            break;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        HnswBuilder builder(DistanceMetric::Cosine, kDim, data.data());
+        builder.reserve(static_cast<uint32_t>(rows));
+        for (uint32_t row = 0; row < rows; ++row) {
+            builder.add(row);
+        }
+        double buildMillis = millisSince(start);
+
+        std::vector<uint64_t> upperOffsets;
+        std::vector<uint32_t> upper;
+        builder.flattenUpper(upperOffsets, upper);
+        HnswGraphView graph;
+        graph.level0 = builder.level0().data();
+        graph.levels = builder.levels().data();
+        graph.upperOffsets = upperOffsets.data();
+        graph.upper = upper.data();
+        graph.count = static_cast<uint32_t>(rows);
+        graph.maxDegree = builder.maxDegree();
+        graph.maxDegree0 = builder.maxDegree0();
+        graph.entryPoint = builder.entryPoint();
+        graph.maxLevel = builder.maxLevel();
+
+        std::vector<std::vector<SearchHit>> exact(queries);
+        start = std::chrono::steady_clock::now();
+        for (size_t q = 0; q < queries; ++q) {
+            exact[q] = flatSearch(DistanceMetric::Cosine, data.data(), kDim, queryData.data() + q * kDim, nullptr,
+                                  rows, kTopK);
+        }
+        double flatMicros = millisSince(start) * 1000.0 / queries;
+
+        start = std::chrono::steady_clock::now();
+        for (size_t q = 0; q < queries; ++q) {
+            flatSearch(DistanceMetric::Cosine, data.data(), kDim, queryData.data() + q * kDim, nullptr, rows, kTopK,
+                       &pool);
+        }
+        double poolMicros = millisSince(start) * 1000.0 / queries;
+
+        size_t found = 0;
+        start = std::chrono::steady_clock::now();
+        for (size_t q = 0; q < queries; ++q) {
+            std::vector<SearchHit> hits = hnswSearch(graph, DistanceMetric::Cosine, data.data(), kDim,
+                                                     queryData.data() + q * kDim, kTopK, 64);
+            for (const SearchHit& hit : hits) {
+                for (const SearchHit& e : exact[q]) {
+                    found += hit.row == e.row ? 1 : 0;
+                }
+            }
+        }
+        double hnswMicros = millisSince(start) * 1000.0 / queries;
+
+        // Queries needed before the graph's per-query saving pays for building it
+        double saving = std::min(flatMicros, poolMicros) - hnswMicros;
+        if (saving > 0) {
+            std::printf("%8zu %12.1f %12.1f %12.1f %12.1f %10.3f %14.0f\n", rows, flatMicros, poolMicros, hnswMicros,
+                        buildMillis, static_cast<double>(found) / (queries * kTopK), buildMillis * 1000.0 / saving);
+        } else {
+            std::printf("%8zu %12.1f %12.1f %12.1f %12.1f %10.3f %14s\n", rows, flatMicros, poolMicros, hnswMicros,
+                        buildMillis, static_cast<double>(found) / (queries * kTopK), "never");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,128 @@
+// HTML to Markdown: pages/s and MB/s over a stored corpus, converting whole
+// pages and streaming them in 16 KiB pieces. Without a directory, a
+// synthetic corpus of article-like pages with navigation, scripts and tables
+// is used.
+//
+// Usage: bench_html_markdown [corpus_dir] [max_pages]
+
+#include "html_to_markdown.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void loadCorpus(const std::string& dir, size_t maxPages, std::vector<std::string>& pages) {
+    DIR* handle = opendir(dir.c_str());
+    if (!handle) {
+        return;
+    }
+    while (dirent* entry = readdir(handle)) {
+        if (pages.size() >= maxPages) {
+            break;
+        }
+        const std::string name = entry->d_name;
+        if (name == "." || name == "..") {
+            continue;
+        }
+        const std::string path = dir + "/" + name;
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) {
+            continue;
+        }
+        if (S_ISDIR(info.st_mode)) {
+            loadCorpus(path, maxPages, pages);
+        } else if (name.size() > 5 && name.compare(name.size() - 5, 5, ".html") == 0) {
+            std::ifstream file(path, std::ios::binary);
+            std::stringstream content;
+            content << file.rdbuf();
+            pages.push_back(content.str());
+        }
+    }
+    closedir(handle);
+}
+
+std::string makePage(std::mt19937& rng) {
+    const char* paragraphs[] = {
+        "<p>Search engines <b>crawl</b> the web and build an <a href=\"/wiki/Inverted_index\">inverted "
+        "index</a> of the pages they find.</p>\n",
+        "<p>The ranking function combines term statistics with <em>link analysis</em> and freshness, "
+        "see &ldquo;PageRank&rdquo; &amp; HITS.</p>\n",
+        "<ul>\n  <li>Politeness delay</li>\n  <li>robots.txt rules</li>\n  <li>Sitemaps</li>\n</ul>\n",
+        "<table><tr><th>Engine</th><th>Year</th></tr><tr><td>Archie</td><td>1990</td></tr>"
+        "<tr><td>AltaVista</td><td>1995</td></tr></table>\n",
+        "<pre><code>for url in frontier:\n    fetch(url)\n</code></pre>\n",
+        "<script>window.dataLayer = window.dataLayer || []; function gtag(){dataLayer.push(arguments);}</script>\n",
+        "<div class=\"nav\"><a href=\"/\">Home</a> | <a href=\"/about\">About</a></div>\n",
+    };
+    std::string page = "<!DOCTYPE html><html><head><title>Search engine</title>"
+                       "<style>body { font-family: sans-serif; }</style></head><body>\n<h1>Search engine</h1>\n";
+    const size_t target = 20000 + rng() % 60000;
+    while (page.size() < target) {
+        page += paragraphs[rng() % 7];
+    }
+    page += "</body></html>\n";
+    return page;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t maxPages = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20000;
+    std::vector<std::string> pages;
+    if (argc > 1) {
+        loadCorpus(argv[1], maxPages, pages);
+    }
+    if (pages.empty()) {
+        std::mt19937 rng(7);
+        for (size_t i = 0; i < std::min<size_t>(maxPages, 2000); ++i) {
+            pages.push_back(makePage(rng));
+        }
+    }
+    size_t bytes = 0;
+    for (const std::string& page : pages) {
+        bytes += page.size();
+    }
+    const double mb = bytes / 1048576.0;
+    std::printf("%zu pages, %.1f MB\n", pages.size(), mb);
+    std::printf("%-10s %10s %10s %12s\n", "mode", "pages/s", "MB/s", "output %");
+
+    HtmlToMarkdown converter;
+    std::string markdown;
+    size_t outputBytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const std::string& page : pages) {
+        converter.convert(page, markdown);
+        outputBytes += markdown.size();
+    }
+    double seconds = secondsSince(start);
+    std::printf("%-10s %10.0f %10.1f %11.1f%%\n", "whole", pages.size() / seconds, mb / seconds,
+                100.0 * outputBytes / bytes);
+
+    const size_t piece = 16384;
+    outputBytes = 0;
+    start = std::chrono::steady_clock::now();
+    for (const std::string& page : pages) {
+        markdown.clear();
+        for (size_t pos = 0; pos < page.size(); pos += piece) {
+            converter.feed(std::string_view(page).substr(pos, piece), markdown);
+        }
+        converter.finish(markdown);
+        outputBytes += markdown.size();
+    }
+    seconds = secondsSince(start);
+    std::printf("%-10s %10.0f %10.1f %11.1f%%\n", "streamed", pages.size() / seconds, mb / seconds,
+                100.0 * outputBytes / bytes);
+    return 0;
+}
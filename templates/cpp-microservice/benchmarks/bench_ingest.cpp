@@ -0,0 +1,114 @@
+// Ingestion throughput: records/s through the batched pipeline (parallel
+// prepare, lock-free queue, one log sync per batch) against one fsync'd
+// upsert per record.
+//
+// Usage: bench_ingest [records] [producers] [request_batch]
+
+#include "bench_data.h"
+#include "vector_ingestor.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const uint32_t kDim = 384;
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+VectorStoreOptions storeOptions(const std::string& directory) {
+    VectorStoreOptions options;
+    options.directory = directory;
+    options.dim = kDim;
+    options.syncWrites = true;
+    options.compactionThreshold = static_cast<size_t>(-1);    // Measure ingestion only
+    return options;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t records = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    const size_t producers = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4;
+    const size_t requestBatch = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 256;
+
+    std::vector<float> data;
+    std::vector<float> queryData;
+    clusteredVectors(records, 0, kDim, data, queryData);
+    auto makeRecord = [&](size_t i) {
+        VectorRecord record;
+        record.vector.assign(data.begin() + i * kDim, data.begin() + (i + 1) * kDim);
+        record.metadata["document"] = "chunk " + std::to_string(i) + " of a crawled page";
+        record.metadata["url"] = "https://example.com/" + std::to_string(i / 8);
+        return record;
+    };
+
+    std::string dir = (std::filesystem::temp_directory_path() / ("bench_ingest_" + std::to_string(getpid()))).string();
+
+    // Batched pipeline
+    std::filesystem::remove_all(dir);
+    double pipelineSeconds;
+    size_t threads;
+    IngestStats stats;
+    {
+        VectorStore store;
+        store.open(storeOptions(dir));
+        threads = store.pool()->size() + 1;
+        VectorIngestor ingestor;
+        ingestor.start(store);
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        std::vector<uint64_t> tokens(producers, 0);
+        for (size_t p = 0; p < producers; ++p) {
+            workers.emplace_back([&, p] {
+                for (size_t begin = p * requestBatch; begin < records; begin += producers * requestBatch) {
+                    std::vector<VectorRecord> batch;
+                    for (size_t i = begin; i < std::min(records, begin + requestBatch); ++i) {
+                        batch.push_back(makeRecord(i));
+                    }
+                    tokens[p] = ingestor.submit(batch);
+                }
+            });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        for (uint64_t token : tokens) {
+            ingestor.waitFor(token, 600000);
+        }
+        pipelineSeconds = secondsSince(start);
+        stats = ingestor.stats();
+    }
+
+    // One durable upsert per record, on a slice so the run stays short
+    std::filesystem::remove_all(dir);
+    const size_t direct = std::min<size_t>(records, 2000);
+    double directSeconds;
+    {
+        VectorStore store;
+        store.open(storeOptions(dir));
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < direct; ++i) {
+            VectorRecord record = makeRecord(i);
+            record.id = std::to_string(i);
+            store.upsert(record);
+        }
+        directSeconds = secondsSince(start);
+    }
+    std::filesystem::remove_all(dir);
+
+    std::printf("%zu threads, dim %u, %zu producers, %zu records per request\n", threads, kDim, producers,
+                requestBatch);
+    std::printf("%-22s %10s %12s %10s\n", "path", "records", "records/s", "batches");
+    std::printf("%-22s %10zu %12.0f %10llu\n", "batched pipeline", records, records / pipelineSeconds,
+                static_cast<unsigned long long>(stats.batches));
+    std::printf("%-22s %10zu %12.0f %10zu\n", "upsert per record", direct, direct / directSeconds, direct);
+    return 0;
+}
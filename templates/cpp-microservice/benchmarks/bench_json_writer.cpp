@@ -0,0 +1,129 @@
+// JSON writing: a response of ranked search results written with JsonWriter
+// into a reused BufferChain, against the same response built by std::string
+// concatenation with appendJsonString/appendJsonNumber.
+//
+// Usage: bench_json_writer [results] [iterations]
+
+#include "json_util.h"
+#include "json_writer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct SearchResult {
+    std::string url;
+    std::string title;
+    std::string snippet;
+    std::vector<std::string> engines;
+    double score;
+    uint32_t rank;
+};
+
+} // namespace
+
+template <>
+struct JsonFields<SearchResult> {
+    static constexpr auto fields =
+        std::make_tuple(jsonField("url", &SearchResult::url), jsonField("title", &SearchResult::title),
+                        jsonField("snippet", &SearchResult::snippet), jsonField("engines", &SearchResult::engines),
+                        jsonField("score", &SearchResult::score), jsonField("rank", &SearchResult::rank));
+};
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string words(std::mt19937& rng, size_t count) {
+    static const char* kWords[] = {"search", "vector", "index", "the", "of", "quantization", "latency", "caf\xC3\xA9",
+                                   "\"quoted\"", "throughput", "memory", "and", "a", "retrieval", "model"};
+    std::string out;
+    for (size_t i = 0; i < count; ++i) {
+        out += (i > 0 ? " " : "") + std::string(kWords[rng() % 15]);
+    }
+    return out;
+}
+
+std::string concatenate(const std::vector<SearchResult>& results) {
+    std::string out = "{\"query\": \"vector search\", \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const SearchResult& r = results[i];
+        out += i > 0 ? ", {\"url\": " : "{\"url\": ";
+        appendJsonString(out, r.url);
+        out += ", \"title\": ";
+        appendJsonString(out, r.title);
+        out += ", \"snippet\": ";
+        appendJsonString(out, r.snippet);
+        out += ", \"engines\": [";
+        for (size_t j = 0; j < r.engines.size(); ++j) {
+            out += j > 0 ? ", " : "";
+            appendJsonString(out, r.engines[j]);
+        }
+        out += "], \"score\": ";
+        appendJsonNumber(out, r.score);
+        out += ", \"rank\": " + std::to_string(r.rank) + "}";
+    }
+    return out + "]}";
+}
+
+void stream(const std::vector<SearchResult>& results, BufferChain& out) {
+    out.clear();
+    JsonWriter writer(out);
+    writer.beginObject();
+    writer.member("query", "vector search");
+    writer.member("results", results);
+    writer.endObject();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100;
+    const size_t iterations = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20000;
+    std::mt19937 rng(5);
+    std::vector<SearchResult> results;
+    for (size_t i = 0; i < count; ++i) {
+        results.push_back(SearchResult{"https://site" + std::to_string(rng() % 1000) + ".example.com/articles/" +
+                                           std::to_string(rng()),
+                                       words(rng, 8), words(rng, 40), {"duckduckgo", "brave"}, 1.0 / (i + 1),
+                                       static_cast<uint32_t>(i + 1)});
+    }
+
+    BufferChain out;
+    stream(results, out);
+    const size_t bytes = out.size();
+
+    // Best of several rounds filters out scheduler noise
+    double writerSeconds = 1e9;
+    double concatSeconds = 1e9;
+    size_t sink = 0;
+    for (int round = 0; round < 5; ++round) {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            stream(results, out);
+            sink += out.size();
+        }
+        writerSeconds = std::min(writerSeconds, secondsSince(start));
+
+        start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            sink += concatenate(results).size();
+        }
+        concatSeconds = std::min(concatSeconds, secondsSince(start));
+    }
+
+    const double mb = bytes * static_cast<double>(iterations) / 1048576.0;
+    std::printf("%zu results, %.1f KB per response\n", count, bytes / 1024.0);
+    std::printf("JsonWriter           %7.2f us/response %7.0f MB/s\n", writerSeconds * 1e6 / iterations,
+                mb / writerSeconds);
+    std::printf("string concatenation %7.2f us/response %7.0f MB/s\n", concatSeconds * 1e6 / iterations,
+                mb / concatSeconds);
+    return sink == 0;
+}
@@ -0,0 +1,193 @@
+// Per-domain dictionary compression: for each site, train an LzDictionary on
+// some of its pages, then compress the others one page at a time (as the
+// crawl cache and text segments store them) with and without it. Reports
+// the compression ratio and decode throughput of both.
+//
+// Pages are synthetic: every site has its own navigation, sidebar and footer
+// around articles drawn from a shared Zipf vocabulary. Pass a directory to
+// treat its files as the pages of one site instead.
+//
+// Usage: bench_lz_dictionary [sites] [pages per site] [dictionary KB] [directory]
+
+#include "lz_codec.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string word(size_t rank) {
+    static const char* const syllables[] = {"the", "an", "de", "ing", "re", "con", "ter", "al", "is", "ment",
+                                            "pro", "ly", "ex", "tion", "or", "com", "er", "in", "at", "per",
+                                            "ble", "ver", "un", "es", "ty", "ar", "ful", "mo", "sa", "ri"};
+    std::string out;
+    size_t n = rank;
+    do {
+        out += syllables[n % 30];
+        n /= 30;
+    } while (n > 0);
+    return out;
+}
+
+std::string sentence(std::mt19937& rng, size_t words) {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::string out;
+    for (size_t i = 0; i < words; ++i) {
+        out += word(static_cast<size_t>(std::pow(20000.0, uniform(rng))) - 1);
+        out += i + 1 < words ? " " : ".";
+    }
+    return out;
+}
+
+// One site's boilerplate: the parts every page of the site repeats
+struct Site {
+    std::string header;
+    std::string footer;
+    std::vector<std::string> phrases;    // Recurring headings and calls to action
+};
+
+Site makeSite(std::mt19937& rng, size_t n) {
+    Site site;
+    const std::string host = "https://" + word(n + 900) + ".com";
+    site.header = "[" + word(n + 900) + "](" + host + "/)";
+    for (int i = 0; i < 12; ++i) {
+        const std::string section = word(rng() % 3000);
+        site.header += " | [" + section + "](" + host + "/" + section + ")";
+    }
+    site.header += "\n\n> " + sentence(rng, 14) + "\n\n";
+    site.footer = "\n\n---\n\n";
+    for (int i = 0; i < 6; ++i) {
+        site.footer += "- [" + sentence(rng, 3) + "](" + host + "/about/" + word(rng() % 3000) + ")\n";
+    }
+    site.footer += "\n" + sentence(rng, 40) + "\n\nCopyright " + word(n + 900) + " Inc. " + sentence(rng, 12) + "\n";
+    for (int i = 0; i < 20; ++i) {
+        site.phrases.push_back(sentence(rng, 8));
+    }
+    return site;
+}
+
+std::string makePage(std::mt19937& rng, const Site& site, size_t bytes) {
+    std::string out = site.header + "# " + sentence(rng, 7) + "\n\n";
+    while (out.size() < bytes) {
+        out += "## " + site.phrases[rng() % site.phrases.size()] + "\n\n";
+        for (int p = 0; p < 3; ++p) {
+            out += sentence(rng, 20 + rng() % 30) + " " + sentence(rng, 10 + rng() % 20) + "\n\n";
+        }
+    }
+    return out + site.footer;
+}
+
+struct Totals {
+    size_t raw = 0;
+    size_t plain = 0;
+    size_t dictionary = 0;
+    double plainSeconds = 0;
+    double dictionarySeconds = 0;
+    double trainSeconds = 0;
+};
+
+// Compresses each page of @p test and times decoding them all, several times over
+double decodeSeconds(const std::vector<std::string>& test, const LzDictionary* dictionary, size_t* compressed) {
+    std::vector<std::string> blocks(test.size());
+    *compressed = 0;
+    for (size_t i = 0; i < test.size(); ++i) {
+        lzCompress(test[i].data(), test[i].size(), blocks[i], dictionary);
+        *compressed += blocks[i].size();
+    }
+    std::string out(1 << 20, '\0');
+    for (size_t i = 0; i < test.size(); ++i) {
+        if (!lzDecompress(reinterpret_cast<const uint8_t*>(blocks[i].data()), blocks[i].size(), &out[0],
+                          test[i].size(), dictionary) ||
+            out.compare(0, test[i].size(), test[i]) != 0) {
+            std::fprintf(stderr, "round trip failed\n");
+            std::exit(1);
+        }
+    }
+    const int rounds = 20;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < test.size(); ++i) {
+            lzDecompress(reinterpret_cast<const uint8_t*>(blocks[i].data()), blocks[i].size(), &out[0],
+                         test[i].size(), dictionary);
+        }
+    }
+    return secondsSince(start) / rounds;
+}
+
+void measure(const std::vector<std::string>& pages, size_t samples, size_t dictionaryBytes, Totals& totals) {
+    const std::vector<std::string_view> training(pages.begin(), pages.begin() + samples);
+    const std::vector<std::string> test(pages.begin() + samples, pages.end());
+    auto start = std::chrono::steady_clock::now();
+    const LzDictionary dictionary = LzDictionary::train(training, dictionaryBytes);
+    totals.trainSeconds += secondsSince(start);
+
+    size_t plain = 0;
+    size_t trained = 0;
+    totals.plainSeconds += decodeSeconds(test, nullptr, &plain);
+    totals.dictionarySeconds += decodeSeconds(test, dictionary.empty() ? nullptr : &dictionary, &trained);
+    for (const std::string& page : test) {
+        totals.raw += page.size();
+    }
+    totals.plain += plain;
+    totals.dictionary += trained;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t sites = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20;
+    const size_t perSite = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200;
+    const size_t dictionaryBytes = (argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 32) << 10;
+    const size_t samples = 32;
+
+    Totals totals;
+    size_t measured = 0;
+    if (argc > 4) {
+        std::vector<std::string> pages;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(argv[4])) {
+            if (entry.is_regular_file() && entry.file_size() > 0 && entry.file_size() < (1 << 20)) {
+                std::ifstream in(entry.path(), std::ios::binary);
+                pages.emplace_back((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            }
+        }
+        if (pages.size() <= samples) {
+            std::fprintf(stderr, "need more than %zu files in %s\n", samples, argv[4]);
+            return 1;
+        }
+        std::shuffle(pages.begin(), pages.end(), std::mt19937(42));
+        measure(pages, samples, dictionaryBytes, totals);
+        measured = 1;
+    } else {
+        std::mt19937 rng(42);
+        for (size_t s = 0; s < sites; ++s) {
+            const Site site = makeSite(rng, s);
+            std::vector<std::string> pages;
+            for (size_t i = 0; i < perSite; ++i) {
+                pages.push_back(makePage(rng, site, 2048 + rng() % 10240));
+            }
+            measure(pages, samples, dictionaryBytes, totals);
+            ++measured;
+        }
+    }
+
+    std::printf("%zu site(s), %.1f MB of pages compressed one at a time, %zu KB dictionaries trained on %zu pages\n",
+                measured, totals.raw / 1e6, dictionaryBytes >> 10, samples);
+    std::printf("train: %.1f ms per dictionary\n", totals.trainSeconds * 1e3 / measured);
+    std::printf("no dictionary: ratio %.2f, decode %.0f MB/s\n", static_cast<double>(totals.raw) / totals.plain,
+                totals.raw / totals.plainSeconds / 1e6);
+    std::printf("dictionary:    ratio %.2f, decode %.0f MB/s\n", static_cast<double>(totals.raw) / totals.dictionary,
+                totals.raw / totals.dictionarySeconds / 1e6);
+    return 0;
+}
@@ -0,0 +1,118 @@
+// Near-duplicate detection: signing throughput, index lookup cost and the
+// precision/recall of duplicate pairs on a synthetic corpus of pages, where
+// a third of the pages are edited copies (mirrors, syndicated posts) of
+// another page.
+//
+// Usage: bench_near_duplicate [pages] [edit_percent]
+
+#include "near_duplicate.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Zipf-distributed words, so unrelated pages share their common words as real text does
+std::vector<std::string> makeVocabulary(std::mt19937& rng, size_t size) {
+    std::vector<std::string> words(size);
+    for (std::string& word : words) {
+        const size_t length = 2 + rng() % 9;
+        for (size_t i = 0; i < length; ++i) {
+            word.push_back(static_cast<char>('a' + rng() % 26));
+        }
+    }
+    return words;
+}
+
+std::vector<std::string> makeWords(std::mt19937& rng, const std::vector<std::string>& vocabulary, size_t count) {
+    std::vector<double> weights(vocabulary.size());
+    for (size_t i = 0; i < weights.size(); ++i) {
+        weights[i] = 1.0 / (i + 1);
+    }
+    std::discrete_distribution<size_t> zipf(weights.begin(), weights.end());
+    std::vector<std::string> words;
+    for (size_t i = 0; i < count; ++i) {
+        words.push_back(vocabulary[zipf(rng)]);
+    }
+    return words;
+}
+
+std::string join(const std::vector<std::string>& words) {
+    std::string text;
+    for (size_t i = 0; i < words.size(); ++i) {
+        text += words[i];
+        text += i % 17 == 16 ? ". " : " ";
+    }
+    return text;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t pages = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 30000;
+    const double editPercent = argc > 2 ? std::atof(argv[2]) : 3.0;
+    std::mt19937 rng(11);
+    const std::vector<std::string> vocabulary = makeVocabulary(rng, 20000);
+
+    // Pages 3i+2 are edited copies of pages 3i+1
+    std::vector<std::string> texts;
+    std::vector<size_t> original;
+    size_t bytes = 0;
+    std::vector<std::string> words;
+    for (size_t i = 0; i < pages; ++i) {
+        if (i % 3 == 2) {
+            for (std::string& word : words) {
+                if (rng() % 10000 < editPercent * 100) {
+                    word = vocabulary[rng() % vocabulary.size()];
+                }
+            }
+            original.push_back(i - 1);
+        } else {
+            words = makeWords(rng, vocabulary, 300 + rng() % 1200);
+            original.push_back(i);
+        }
+        texts.push_back(join(words));
+        bytes += texts.back().size();
+    }
+
+    NearDuplicateOptions options;
+    options.capacity = pages;
+    NearDuplicateIndex index(options);
+    std::vector<DocumentSignature> signatures(pages);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < pages; ++i) {
+        index.sign(texts[i], signatures[i]);
+    }
+    const double signSeconds = secondsSince(start);
+
+    size_t truePositives = 0;
+    size_t falsePositives = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < pages; ++i) {
+        const uint64_t match = index.find(signatures[i]);
+        if (match != NearDuplicateIndex::kNotFound) {
+            ++(original[i] == original[match] ? truePositives : falsePositives);
+        }
+        index.add(signatures[i]);
+    }
+    const double indexSeconds = secondsSince(start);
+    const size_t expected = pages / 3;
+
+    std::printf("%zu pages, %.1f MB, %.1f%% of words edited in copies\n", pages, bytes / 1048576.0, editPercent);
+    std::printf("%-22s %12.0f pages/s %8.1f MB/s\n", "sign", pages / signSeconds, bytes / 1048576.0 / signSeconds);
+    std::printf("%-22s %12.2f us/page\n", "find + add", 1e6 * indexSeconds / pages);
+    std::printf("%-22s %12.3f\n", "recall", expected ? static_cast<double>(truePositives) / expected : 1.0);
+    std::printf("%-22s %12.3f\n", "precision",
+                truePositives + falsePositives ? static_cast<double>(truePositives) / (truePositives + falsePositives)
+                                               : 1.0);
+    return 0;
+}
@@ -0,0 +1,123 @@
+// Recall@10, latency and bytes per vector of the vector store with float,
+// SQ8 and PQ segments, with and without exact re-ranking.
+//
+// Usage: bench_quantization [rows] [queries]
+//
+// The data set is synthetic but clustered like sentence embeddings (see
+// bench_data.h).
+
+#include "bench_data.h"
+#include "vector_store.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+const uint32_t kDim = 384;
+const size_t kTopK = 10;
+
+struct DataSet {
+    std::vector<float> rows;
+    std::vector<float> queries;
+    std::vector<std::vector<uint32_t>> truth;
+};
+
+DataSet makeDataSet(size_t rows, size_t queries) {
+    DataSet data;
+    clusteredVectors(rows, queries, kDim, data.rows, data.queries);
+
+    data.truth.resize(queries);
+    std::vector<std::pair<float, uint32_t>> scored(rows);
+    for (size_t q = 0; q < queries; ++q) {
+        const float* query = data.queries.data() + q * kDim;
+        for (size_t i = 0; i < rows; ++i) {
+            scored[i] = {1.0f - dotProduct(query, data.rows.data() + i * kDim, kDim), static_cast<uint32_t>(i)};
+        }
+        std::partial_sort(scored.begin(), scored.begin() + kTopK, scored.end());
+        for (size_t i = 0; i < kTopK; ++i) {
+            data.truth[q].push_back(scored[i].second);
+        }
+    }
+    return data;
+}
+
+void report(const char* name, const VectorStore& store, const DataSet& data, size_t queries) {
+    size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t q = 0; q < queries; ++q) {
+        std::vector<float> query(data.queries.begin() + q * kDim, data.queries.begin() + (q + 1) * kDim);
+        std::vector<VectorQueryResult> results = store.query(query, kTopK);
+        for (uint32_t expected : data.truth[q]) {
+            for (const VectorQueryResult& r : results) {
+                found += r.id == std::to_string(expected) ? 1 : 0;
+            }
+        }
+    }
+    double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    VectorStoreStats stats = store.stats();
+    size_t searched = stats.codeBytesPerVector ? stats.codeBytesPerVector : kDim * sizeof(float);
+    std::printf("%-18s %10.3f %12zu %14.1f %12.1f\n", name, static_cast<double>(found) / (queries * kTopK),
+                searched, static_cast<double>(stats.segmentBytes) / stats.segmentRows, micros / queries);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t rows = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    const size_t queries = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200;
+    const std::filesystem::path dir =
+        std::filesystem::temp_directory_path() / ("bench_quantization_" + std::to_string(getpid()));
+
+    std::printf("Generating %zu x %u vectors, %zu queries\n", rows, kDim, queries);
+    DataSet data = makeDataSet(rows, queries);
+
+    std::printf("%-18s %10s %12s %14s %12s\n", "mode", "recall@10", "bytes/vec", "segment B/vec", "query us");
+    struct Mode {
+        const char* name;
+        QuantizerType type;
+    };
+    for (const Mode& mode : {Mode{"float32", QuantizerType::None}, Mode{"sq8", QuantizerType::Scalar8},
+                             Mode{"pq", QuantizerType::Product}}) {
+        std::filesystem::remove_all(dir);
+        VectorStoreOptions options;
+        options.directory = dir.string();
+        options.dim = kDim;
+        options.syncWrites = false;
+        options.quantization = mode.type;
+        {
+            VectorStore store;
+            if (!store.open(options)) {
+                return 1;
+            }
+            for (size_t i = 0; i < rows; ++i) {
+                std::vector<float> v(data.rows.begin() + i * kDim, data.rows.begin() + (i + 1) * kDim);
+                store.upsert({std::to_string(i), std::move(v), {}});
+            }
+            store.compact();
+        }
+
+        // The re-rank factor only affects queries, so reopen the same segment for each setting
+        for (size_t rerank : {size_t(0), size_t(4)}) {
+            if (mode.type == QuantizerType::None && rerank == 0) {
+                continue;
+            }
+            options.rerankFactor = rerank;
+            VectorStore store;
+            if (!store.open(options)) {
+                return 1;
+            }
+            std::string name = std::string(mode.name) + (mode.type == QuantizerType::None ? ""
+                                                         : rerank ? " + rerank" : " (adc only)");
+            report(name.c_str(), store, data, queries);
+        }
+    }
+    std::filesystem::remove_all(dir);
+    return 0;
+}
@@ -0,0 +1,113 @@
+// robots.txt matching: parse cost of a large robots.txt, then the cost of
+// allowed() on its compiled trie and of a RobotsCache::check() hit across
+// many cached origins. The file mixes plain prefixes with "*" and "$"
+// rules, as large sites publish them.
+//
+// Usage: bench_robots [origins] [checks] [rules]
+
+#include "robots_cache.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+const char* const kSections[] = {"news", "sport", "shop", "search", "account", "video", "blog", "api"};
+
+std::string makeRobots(size_t rules, std::mt19937_64& rng) {
+    std::string text = "User-agent: Googlebot\nDisallow: /nogoogle\n\nUser-agent: *\nCrawl-delay: 1\n";
+    for (size_t i = 0; i < rules; ++i) {
+        const std::string section = kSections[rng() % 8];
+        switch (rng() % 4) {
+        case 0:
+            text += "Disallow: /" + section + "/" + std::to_string(rng() % 1000) + "/\n";
+            break;
+        case 1:
+            text += "Allow: /" + section + "/" + std::to_string(rng() % 1000) + "/public\n";
+            break;
+        case 2:
+            text += "Disallow: /*/" + section + "?sessionid=" + std::to_string(i) + "\n";
+            break;
+        default:
+            text += "Disallow: /" + section + "/*." + std::to_string(i) + ".pdf$\n";
+            break;
+        }
+    }
+    return text + "Sitemap: https://example.com/sitemap.xml\n";
+}
+
+std::string makePath(std::mt19937_64& rng) {
+    std::string path = "/" + std::string(kSections[rng() % 8]) + "/" + std::to_string(rng() % 1000) + "/";
+    switch (rng() % 3) {
+    case 0:
+        return path + "public/article-" + std::to_string(rng() % 100000) + ".html";
+    case 1:
+        return path + "report." + std::to_string(rng() % 200) + ".pdf";
+    default:
+        return path + "page?id=" + std::to_string(rng() % 100000) + "&sessionid=" + std::to_string(rng() % 200);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t origins = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    const size_t checks = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000000;
+    const size_t ruleCount = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 200;
+    std::mt19937_64 rng(7);
+
+    const std::string text = makeRobots(ruleCount, rng);
+    const int parses = 200;
+    auto start = std::chrono::steady_clock::now();
+    size_t compiled = 0;
+    for (int i = 0; i < parses; ++i) {
+        compiled += RobotsRules::parse(text, "DeepSearchStack").ruleCount();
+    }
+    const double parseSeconds = secondsSince(start);
+    const RobotsRules rules = RobotsRules::parse(text, "DeepSearchStack");
+    std::printf("parse: %zu-byte robots.txt, %zu rules, %.1f us each, %zu bytes compiled\n", text.size(),
+                compiled / parses, parseSeconds * 1e6 / parses, rules.memoryBytes());
+
+    std::vector<std::string> paths(4096);
+    for (std::string& path : paths) {
+        path = makePath(rng);
+    }
+    size_t allowed = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < checks; ++i) {
+        allowed += rules.allowed(paths[i & 4095]);
+    }
+    const double matchSeconds = secondsSince(start);
+    std::printf("allowed(): %.0f ns per path, %.1f%% allowed\n", matchSeconds * 1e9 / checks, 100.0 * allowed / checks);
+
+    RobotsCacheOptions options;
+    options.maxHosts = origins;
+    RobotsCache cache(options);
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < origins; ++i) {
+        cache.store("https://host" + std::to_string(i) + ".example", 200, i % 10 == 0 ? text : "", 0);
+    }
+    const double storeSeconds = secondsSince(start);
+    std::vector<std::string> urls(65536);
+    for (std::string& url : urls) {
+        url = "https://host" + std::to_string(rng() % origins) + ".example" + makePath(rng);
+    }
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < checks; ++i) {
+        allowed += cache.check(urls[i & 65535], 1) == RobotsVerdict::Allowed;
+    }
+    const double checkSeconds = secondsSince(start);
+    const RobotsCacheStats stats = cache.stats();
+    std::printf("cache: %zu origins (1 in 10 with the large file) stored in %.2f s, %.1f MB\n", origins, storeSeconds,
+                stats.memoryBytes / 1e6);
+    std::printf("check() hit: %.0f ns per URL, %llu hits, %llu misses\n", checkSeconds * 1e9 / checks,
+                static_cast<unsigned long long>(stats.hits), static_cast<unsigned long long>(stats.misses));
+    return stats.misses == 0 ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+// Score fusion: time to fuse one query's provider result lists, with the
+// gateway's provider count and weights and overlapping result sets.
+//
+// Usage: bench_score_fusion [lists] [results_per_list] [queries]
+
+#include "score_fusion.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+const double kWeights[] = {1.0, 1.0, 0.8, 1.1, 1.2, 1.2, 1.2, 1.3, 1.2, 1.1, 1.1, 0.9, 0.9};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t lists = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 13;
+    const size_t perList = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100;
+    const size_t queries = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 2000;
+
+    // Each query draws its results from a pool three times the list length, so
+    // popular pages show up in several lists
+    std::mt19937 rng(11);
+    std::vector<std::vector<Hash128>> keys(queries * lists);
+    std::vector<std::vector<double>> scores(queries * lists);
+    for (size_t q = 0; q < queries; ++q) {
+        for (size_t l = 0; l < lists; ++l) {
+            std::vector<Hash128>& k = keys[q * lists + l];
+            std::vector<double>& s = scores[q * lists + l];
+            for (size_t i = 0; i < perList; ++i) {
+                const std::string url = "https://site" + std::to_string(q) + ".com/" +
+                                        std::to_string(rng() % (3 * perList));
+                k.push_back(murmurHash3(url.data(), url.size()));
+                s.push_back(1.0 / (1.0 + i));
+            }
+        }
+    }
+
+    std::printf("%zu queries, %zu lists x %zu results each\n", queries, lists, perList);
+    const struct {
+        const char* name;
+        FusionMethod method;
+    } methods[] = {{"rrf", FusionMethod::Rrf}, {"combsum", FusionMethod::CombSum}, {"combmnz", FusionMethod::CombMnz}};
+    for (const auto& m : methods) {
+        ScoreFusionOptions options;
+        options.method = m.method;
+        ScoreFusion fusion(options);
+        size_t fused = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t q = 0; q < queries; ++q) {
+            fusion.reset();
+            for (size_t l = 0; l < lists; ++l) {
+                const size_t i = q * lists + l;
+                fusion.addList(keys[i].data(), scores[i].data(), keys[i].size(), kWeights[l % 13]);
+            }
+            fusion.rank(50);
+            fused += fusion.size();
+        }
+        const double seconds = secondsSince(start);
+        std::printf("%-10s %8.2f us/query %8.1f ns/result %8zu distinct/query\n", m.name, 1e6 * seconds / queries,
+                    1e9 * seconds / (queries * lists * perList), fused / queries);
+    }
+    return 0;
+}
@@ -0,0 +1,91 @@
+// Snippet latency per page of hits: cutting the best 40-term window from
+// stored term offsets against splitting each document's markdown again to
+// find its terms (what FTS5 snippet() does per row).
+//
+// Usage: bench_snippet [pages] [hits per page] [words per document]
+
+#include "snippet.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+double microsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+double percentile(std::vector<double> values, double p) {
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<size_t>(p * values.size()))];
+}
+
+// Markdown-ish text: headings, punctuation and mixed case over a 5000-word vocabulary
+std::string document(std::mt19937& rng, size_t words) {
+    std::string out = "# Heading\n\n";
+    for (size_t i = 0; i < words; ++i) {
+        out += (rng() % 7 == 0 ? "Word" : "word") + std::to_string(rng() % 5000);
+        out += i % 17 == 16 ? ".\n\n" : (i % 5 == 4 ? ", " : " ");
+    }
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t pages = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200;
+    const size_t perPage = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100;
+    const size_t words = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 600;
+
+    std::mt19937 rng(42);
+    std::vector<std::string> texts;
+    std::vector<std::string> offsets(pages * perPage);
+    size_t offsetBytes = 0;
+    size_t textBytes = 0;
+    for (size_t i = 0; i < pages * perPage; ++i) {
+        texts.push_back(document(rng, words));
+        encodeTermOffsets(texts.back(), offsets[i]);
+        offsetBytes += offsets[i].size();
+        textBytes += texts.back().size();
+    }
+    std::printf("%zu documents of %zu words: offsets are %.1f%% of the markdown\n", texts.size(), words,
+                100.0 * offsetBytes / textBytes);
+
+    std::vector<double> stored;
+    std::vector<double> resplit;
+    std::string scratch;
+    std::string out;
+    size_t checksum = 0;
+    for (size_t page = 0; page < pages; ++page) {
+        SnippetBuilder builder({"word" + std::to_string(rng() % 200), "word" + std::to_string(rng() % 200)},
+                               SnippetOptions());
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = page * perPage; i < (page + 1) * perPage; ++i) {
+            builder.build(texts[i], offsets[i], out);
+            checksum += out.size();
+        }
+        stored.push_back(microsSince(start));
+
+        start = std::chrono::steady_clock::now();
+        for (size_t i = page * perPage; i < (page + 1) * perPage; ++i) {
+            scratch.clear();
+            encodeTermOffsets(texts[i], scratch);
+            builder.build(texts[i], scratch, out);
+            checksum -= out.size();
+        }
+        resplit.push_back(microsSince(start));
+    }
+    if (checksum != 0) {
+        std::fprintf(stderr, "snippets differ\n");
+        return 1;
+    }
+
+    std::printf("%-16s %12s %12s\n", "per page", "p50 us", "p99 us");
+    std::printf("%-16s %12.1f %12.1f\n", "stored offsets", percentile(stored, 0.5), percentile(stored, 0.99));
+    std::printf("%-16s %12.1f %12.1f\n", "re-split", percentile(resplit, 0.5), percentile(resplit, 0.99));
+    return 0;
+}
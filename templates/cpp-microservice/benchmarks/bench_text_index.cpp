@@ -0,0 +1,149 @@
+// Full-text query latency: block-max WAND / block-max intersection against
+// exhaustive scoring of every matching posting, over a synthetic corpus
+// with a Zipf vocabulary, plus index build and segment size.
+//
+// Usage: bench_text_index [documents] [queries]
+
+#include "text_index.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const size_t kVocabulary = 200000;
+const size_t kBatch = 50000;
+
+double millisSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Zipf(1) ranks by inverting the harmonic CDF approximation
+class ZipfWords {
+public:
+    explicit ZipfWords(uint32_t seed) : rng_(seed), uniform_(0.0, 1.0) {}
+
+    size_t rank() {
+        return std::min(kVocabulary - 1, static_cast<size_t>(std::exp(uniform_(rng_) * std::log(kVocabulary))) - 1);
+    }
+
+    std::string text(size_t words) {
+        std::string out;
+        for (size_t i = 0; i < words; ++i) {
+            out += (i ? " t" : "t") + std::to_string(rank());
+        }
+        return out;
+    }
+
+    std::mt19937& rng() { return rng_; }
+
+private:
+    std::mt19937 rng_;
+    std::uniform_real_distribution<double> uniform_;
+};
+
+double percentile(std::vector<double> values, double p) {
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<size_t>(p * values.size()))];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t documents = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    const size_t queries = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 300;
+
+    const std::string dir =
+        (std::filesystem::temp_directory_path() / ("bench_text_index_" + std::to_string(getpid()))).string();
+    std::filesystem::remove_all(dir);
+    TextIndexOptions options;
+    options.directory = dir;
+    options.syncWrites = false;
+    options.flushThreshold = SIZE_MAX;
+
+    TextIndex index;
+    if (!index.open(options)) {
+        return 1;
+    }
+
+    // Documents of 50-550 words: title plus markdown, as the warehouse stores them
+    ZipfWords words(42);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t first = 0; first < documents; first += kBatch) {
+        std::vector<TextDocument> batch;
+        for (size_t id = first; id < std::min(documents, first + kBatch); ++id) {
+            batch.push_back({id, {{"title", words.text(6)}, {"markdown", words.text(50 + words.rng()() % 500)},
+                                  {"source_domain", "d" + std::to_string(id % 50) + ".org"}}});
+        }
+        if (!index.addBatch(batch) || !index.flush()) {
+            return 1;
+        }
+    }
+    index.merge(true);
+    const double buildMillis = millisSince(start);
+    TextIndexStats stats = index.stats();
+    std::printf("%zu documents, vocabulary %zu: built in %.0f ms, %zu segment(s), %.1f MB\n", documents,
+                kVocabulary, buildMillis, stats.segments, stats.segmentBytes / 1048576.0);
+
+    std::printf("%-18s %6s %12s %12s %12s %12s %8s\n", "query", "k", "exh p50 us", "exh p99 us", "bmw p50 us",
+                "bmw p99 us", "speedup");
+    struct Shape {
+        const char* name;
+        size_t terms;
+        bool matchAll;
+        bool filtered;
+    };
+    for (const Shape& shape : {Shape{"1 term", 1, true, false}, Shape{"2 terms AND", 2, true, false},
+                               Shape{"3 terms AND", 3, true, false}, Shape{"2 terms OR", 2, false, false},
+                               Shape{"4 terms OR", 4, false, false}, Shape{"2 terms AND dom", 2, true, true}}) {
+        for (size_t k : {10, 100}) {
+            // Query terms drawn from the same distribution as the text, so most include common words
+            ZipfWords queryWords(7);
+            std::vector<TextQuery> batch(queries);
+            for (size_t q = 0; q < queries; ++q) {
+                batch[q].text = queryWords.text(shape.terms);
+                batch[q].limit = k;
+                batch[q].matchAll = shape.matchAll;
+                batch[q].domain = shape.filtered ? "d" + std::to_string(q % 50) + ".org" : "";
+            }
+
+            std::vector<double> exhaustive;
+            std::vector<double> pruned;
+            for (TextQuery& query : batch) {
+                query.blockMax = false;
+                auto t = std::chrono::steady_clock::now();
+                std::vector<TextHit> exact = index.search(query);
+                exhaustive.push_back(millisSince(t) * 1000.0);
+
+                query.blockMax = true;
+                t = std::chrono::steady_clock::now();
+                std::vector<TextHit> hits = index.search(query);
+                pruned.push_back(millisSince(t) * 1000.0);
+                if (hits.size() != exact.size() ||
+                    (!hits.empty() && std::fabs(hits.back().score - exact.back().score) > 1e-4f)) {
+                    std::fprintf(stderr, "block-max results differ for \"%s\"\n", query.text.c_str());
+                    return 1;
+                }
+            }
+            double sumExhaustive = 0;
+            double sumPruned = 0;
+            for (size_t q = 0; q < queries; ++q) {
+                sumExhaustive += exhaustive[q];
+                sumPruned += pruned[q];
+            }
+            std::printf("%-18s %6zu %12.1f %12.1f %12.1f %12.1f %7.1fx\n", shape.name, k,
+                        percentile(exhaustive, 0.5), percentile(exhaustive, 0.99), percentile(pruned, 0.5),
+                        percentile(pruned, 0.99), sumExhaustive / std::max(sumPruned, 1e-9));
+        }
+    }
+
+    index.close();
+    std::filesystem::remove_all(dir);
+    return 0;
+}
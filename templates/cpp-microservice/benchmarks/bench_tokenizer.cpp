@@ -0,0 +1,106 @@
+// Tokenizer throughput: MB/s of word splitting alone and of full WordPiece
+// encoding into a caller buffer, on English-like ASCII text and on text
+// mixing accents, Cyrillic and CJK.
+//
+// Usage: bench_tokenizer [megabytes]
+
+#include "word_splitter.h"
+#include "wordpiece_tokenizer.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Pronounceable pseudo-words built from syllables
+std::string pseudoWord(std::mt19937& rng, size_t syllables) {
+    const char* parts[] = {"ta", "re", "si", "on", "ing", "er", "al", "co", "mp", "ut", "an", "st", "de", "pro",
+                           "ver", "ex", "ti", "ly", "ment", "qu"};
+    std::string word;
+    for (size_t i = 0; i < syllables; ++i) {
+        word += parts[rng() % 20];
+    }
+    return word;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t megabytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 32;
+    std::mt19937 rng(5);
+
+    // A BERT-sized vocabulary: whole words plus continuation pieces
+    std::vector<std::string> vocab = {"[PAD]", "[UNK]", "[CLS]", "[SEP]", "[MASK]"};
+    std::vector<std::string> words;
+    while (vocab.size() < 30522) {
+        std::string word = pseudoWord(rng, 1 + rng() % 4);
+        vocab.push_back(rng() % 3 == 0 ? "##" + word : word);
+        if (vocab.back()[0] != '#') {
+            words.push_back(word);
+        }
+    }
+    for (const char* symbol : {".", ",", "!", "?", "(", ")", "'", "-", "é", "я", "中"}) {
+        vocab.push_back(symbol);
+    }
+    WordPieceTokenizer tokenizer;
+    if (!tokenizer.setVocabulary(vocab)) {
+        return 1;
+    }
+
+    // Zipf-like word choice, capitalized sentence starts, some out-of-vocabulary words
+    std::string ascii;
+    std::string mixed;
+    const char* foreign[] = {"Café", "naïve", "Москва", "中文", "résumé", "Ελλάδα"};
+    while (ascii.size() < megabytes << 20) {
+        std::string word = rng() % 10 == 0 ? pseudoWord(rng, 5) : words[(rng() % 1000) * (rng() % 30) % words.size()];
+        if (rng() % 12 == 0) {
+            word[0] = static_cast<char>(word[0] - 32);
+        }
+        ascii += word;
+        mixed += rng() % 8 == 0 ? foreign[rng() % 6] : word;
+        const char* separator = rng() % 10 == 0 ? ". " : (rng() % 15 == 0 ? ", " : " ");
+        ascii += separator;
+        mixed += separator;
+    }
+
+    std::printf("%zu MB per corpus, vocabulary %zu\n", megabytes, tokenizer.vocabularySize());
+    std::printf("%-8s %-10s %10s %14s\n", "corpus", "stage", "MB/s", "tokens/s");
+    std::vector<int32_t> ids(1 << 16);
+    for (const std::string* corpus : {&ascii, &mixed}) {
+        const char* name = corpus == &ascii ? "ascii" : "mixed";
+        const double mb = corpus->size() / 1048576.0;
+
+        auto start = std::chrono::steady_clock::now();
+        WordSplitter splitter(*corpus);
+        std::string_view word;
+        size_t count = 0;
+        while (splitter.next(word)) {
+            ++count;
+        }
+        double seconds = secondsSince(start);
+        std::printf("%-8s %-10s %10.1f %14.0f\n", name, "split", mb / seconds, count / seconds);
+
+        // Encode in 4 KiB slices into a reused buffer, as a chunker feeding the embedder would
+        start = std::chrono::steady_clock::now();
+        size_t tokens = 0;
+        for (size_t offset = 0; offset < corpus->size();) {
+            size_t end = std::min(corpus->size(), offset + 4096);
+            while (end < corpus->size() && (*corpus)[end] != ' ') {
+                ++end;
+            }
+            tokens += tokenizer.encode(std::string_view(*corpus).substr(offset, end - offset), ids.data(),
+                                       ids.size());
+            offset = end;
+        }
+        seconds = secondsSince(start);
+        std::printf("%-8s %-10s %10.1f %14.0f\n", name, "encode", mb / seconds, tokens / seconds);
+    }
+    return 0;
+}
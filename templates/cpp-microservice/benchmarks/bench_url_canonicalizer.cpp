@@ -0,0 +1,96 @@
+// URL canonicalization: URLs/s for canonicalize + 128-bit hash, and how many
+// distinct cache keys remain when each page is seen under several spellings
+// (case, default port, trailing slash, tracking parameters, fragments).
+//
+// Usage: bench_url_canonicalizer [pages] [variants_per_page]
+
+#include "url_canonicalizer.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string randomWord(std::mt19937& rng) {
+    std::string word;
+    const size_t length = 3 + rng() % 8;
+    for (size_t i = 0; i < length; ++i) {
+        word.push_back(static_cast<char>('a' + rng() % 26));
+    }
+    return word;
+}
+
+std::string variant(std::mt19937& rng, const std::string& host, const std::string& path, const std::string& query) {
+    std::string url = rng() % 2 ? "https://" : "HTTPS://";
+    for (char c : host) {
+        url.push_back(rng() % 4 == 0 ? static_cast<char>(std::toupper(static_cast<unsigned char>(c))) : c);
+    }
+    if (rng() % 3 == 0) {
+        url += ":443";
+    }
+    url += path;
+    if (rng() % 2) {
+        url += "/";
+    }
+    std::string params = query;
+    if (rng() % 2) {
+        params += "&utm_source=" + randomWord(rng) + "&utm_medium=social";
+    }
+    if (rng() % 3 == 0) {
+        params = "fbclid=IwAR" + randomWord(rng) + "&" + params;
+    }
+    url += "?" + params;
+    if (rng() % 3 == 0) {
+        url += "#" + randomWord(rng);
+    }
+    return url;
+}
+
+struct HashOf {
+    size_t operator()(const Hash128& h) const { return h.low; }
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const size_t pages = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    const size_t variants = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 5;
+    std::mt19937 rng(5);
+    std::vector<std::string> urls;
+    size_t bytes = 0;
+    for (size_t p = 0; p < pages; ++p) {
+        const std::string host = (rng() % 2 ? "www." : "") + randomWord(rng) + ".com";
+        const std::string path = "/" + randomWord(rng) + "/" + randomWord(rng) + "-" + randomWord(rng);
+        const std::string query = "id=" + std::to_string(rng() % 100000) + "&lang=en";
+        for (size_t v = 0; v < variants; ++v) {
+            urls.push_back(variant(rng, host, path, query));
+            bytes += urls.back().size();
+        }
+    }
+
+    UrlCanonicalizer canonicalizer;
+    std::vector<Hash128> hashes(urls.size());
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < urls.size(); ++i) {
+        canonicalizer.hash(urls[i], hashes[i]);
+    }
+    const double seconds = secondsSince(start);
+
+    std::unordered_set<std::string> raw(urls.begin(), urls.end());
+    std::unordered_set<Hash128, HashOf> canonical(hashes.begin(), hashes.end());
+    std::printf("%zu URLs (%zu pages x %zu spellings), %.0f bytes average\n", urls.size(), pages, variants,
+                static_cast<double>(bytes) / urls.size());
+    std::printf("%-26s %10.0f URLs/s %8.0f ns/URL %8.1f MB/s\n", "canonicalize + hash", urls.size() / seconds,
+                1e9 * seconds / urls.size(), bytes / 1048576.0 / seconds);
+    std::printf("%-26s %10zu\n", "distinct raw keys", raw.size());
+    std::printf("%-26s %10zu\n", "distinct canonical keys", canonical.size());
+    return 0;
+}
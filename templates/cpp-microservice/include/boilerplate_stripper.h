@@ -0,0 +1,78 @@
+#ifndef BOILERPLATE_STRIPPER_H
+#define BOILERPLATE_STRIPPER_H
+
+#include "pattern_automaton.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief What counts as boilerplate in crawled markdown
+ *
+ * The presets hold the lists from the Python services, pattern for pattern,
+ * since each service has its own copy of `_strip_boilerplate`.
+ */
+struct BoilerplateRules {
+    std::vector<std::string> linePatterns;    // Python regexes, matched case-insensitively at the start of a stripped line
+    std::vector<std::string> sections;        // Lower-case headings whose sections are dropped
+    bool skipChildLines = false;              // Also drop up to 10 list or indented lines after a dropped line
+
+    /** services/crawler/main.py */
+    static BoilerplateRules crawler();
+    /** services/deepsearch/core/scraper.py, which also drops child lines */
+    static BoilerplateRules scraper();
+    /** services/web-api/main.py */
+    static BoilerplateRules webApi();
+};
+
+/**
+ * @brief Removes navigation chrome, cookie banners and reference sections
+ *        from crawled markdown, as the services' `_strip_boilerplate` does
+ *
+ * A line is dropped when it matches one of the line patterns (after
+ * stripping whitespace) or sits in a section opened by a boilerplate
+ * heading, until the next heading of the same or a higher level. The kept
+ * lines are joined, trimmed and have runs of blank lines squeezed to one,
+ * and an input that would clean to nothing is returned unchanged.
+ *
+ * All line patterns are compiled into one PatternAutomaton and the section
+ * headings into another, so each line costs a single DFA walk (usually one
+ * or two steps) however many patterns there are. The output is
+ * byte-identical to the Python functions.
+ */
+class BoilerplateStripper {
+public:
+    /**
+     * @brief Construct a BoilerplateStripper with the crawler rules
+     */
+    BoilerplateStripper();
+
+    /**
+     * @brief Replace the rules
+     *
+     * @param rules Patterns, sections and child-line behaviour
+     * @return true if every pattern compiled
+     */
+    bool setRules(const BoilerplateRules& rules);
+
+    /**
+     * @brief Clean a markdown document
+     *
+     * @param markdown UTF-8 markdown
+     * @param out Receives the cleaned markdown
+     */
+    void strip(std::string_view markdown, std::string& out) const;
+
+    /**
+     * @brief Clean a markdown document
+     */
+    std::string strip(std::string_view markdown) const;
+
+private:
+    PatternAutomaton lines_;
+    PatternAutomaton sections_;
+    PatternAutomaton childLines_;
+    bool skipChildLines_;
+};
+
+#endif // BOILERPLATE_STRIPPER_H
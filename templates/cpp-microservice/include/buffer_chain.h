@@ -0,0 +1,116 @@
+#ifndef BUFFER_CHAIN_H
+#define BUFFER_CHAIN_H
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Output buffer made of fixed-size blocks
+ *
+ * A response is appended block by block and never moved, so appends cost a
+ * bounds check and a copy, and the blocks can go to writev as they are.
+ * clear() keeps the blocks: a buffer kept per connection stops allocating
+ * once it has held its largest response.
+ *
+ * Not thread-safe.
+ */
+class BufferChain {
+public:
+    /** Bytes per block */
+    static constexpr size_t kBlockSize = 16384;
+
+    /**
+     * @brief Construct a new, empty BufferChain object (allocates on first append)
+     */
+    BufferChain();
+
+    BufferChain(const BufferChain&) = delete;
+    BufferChain& operator=(const BufferChain&) = delete;
+
+    /**
+     * @brief Append bytes, spilling into further blocks as needed
+     */
+    void append(const char* data, size_t size) {
+        if (size <= static_cast<size_t>(end_ - cursor_)) {
+            std::memcpy(cursor_, data, size);
+            cursor_ += size;
+        } else {
+            appendSlow(data, size);
+        }
+    }
+
+    void append(std::string_view text) { append(text.data(), text.size()); }
+
+    void push(char c) {
+        if (cursor_ == end_) {
+            nextBlock();
+        }
+        *cursor_++ = c;
+    }
+
+    /**
+     * @brief Contiguous space for up to size bytes, to be followed by commit()
+     *
+     * @param size At most kBlockSize
+     * @return char* Where to write; the rest of the current block if it fits, else a fresh block
+     */
+    char* reserve(size_t size) {
+        if (size > static_cast<size_t>(end_ - cursor_)) {
+            nextBlock();
+        }
+        return cursor_;
+    }
+
+    /**
+     * @brief Mark bytes written after reserve() as part of the buffer
+     */
+    void commit(size_t size) { cursor_ += size; }
+
+    /**
+     * @brief Total bytes held
+     */
+    size_t size() const;
+
+    bool empty() const { return size() == 0; }
+
+    /**
+     * @brief Drop the contents but keep the blocks
+     */
+    void clear();
+
+    /**
+     * @brief Number of blocks holding data (the last may be partly filled)
+     */
+    size_t blockCount() const { return blocks_.empty() ? 0 : current_ + 1; }
+
+    /**
+     * @brief Contents of one block, for scatter-gather writes
+     */
+    std::string_view block(size_t index) const;
+
+    /**
+     * @brief Append the contents to a string
+     */
+    void appendTo(std::string& out) const;
+
+    /**
+     * @brief The contents as one string
+     */
+    std::string str() const;
+
+private:
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    std::vector<size_t> used_;  // Bytes in each filled block before current_
+    size_t current_;
+    char* cursor_;
+    char* end_;
+
+    void nextBlock();
+    void appendSlow(const char* data, size_t size);
+};
+
+#endif // BUFFER_CHAIN_H
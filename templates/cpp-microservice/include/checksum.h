@@ -0,0 +1,21 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Compute a CRC-32C (Castagnoli) checksum
+ *
+ * Uses the SSE4.2 crc32 instruction when the build enables it and a
+ * table-driven fallback otherwise. Pass a previous result as @p crc to
+ * checksum data incrementally.
+ *
+ * @param data Bytes to checksum
+ * @param len Number of bytes
+ * @param crc Running checksum (0 to start)
+ * @return uint32_t Updated checksum
+ */
+uint32_t crc32c(const void* data, size_t len, uint32_t crc = 0);
+
+#endif // CHECKSUM_H
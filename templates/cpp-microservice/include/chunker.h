@@ -0,0 +1,125 @@
+#ifndef CHUNKER_H
+#define CHUNKER_H
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Chunking settings, as in rag.split_into_chunks
+ */
+struct ChunkerOptions {
+    size_t chunkSize = 1000;         // Target characters (code points) per chunk
+    size_t overlapSentences = 2;     // Sentences carried into the next chunk
+    size_t overlapChars = 0;         // > 0 selects fixed character windows instead of sentences
+};
+
+/**
+ * @brief Single-pass text chunker producing the same chunks as the Python
+ *        `split_into_chunks` (services/deepsearch/core/rag.py)
+ *
+ * Character mode emits windows of chunkSize code points every
+ * chunkSize - overlapChars code points, dropping a trailing window shorter
+ * than 100. Sentence mode splits after '.', '!' or '?' followed by
+ * whitespace (Python's `\\s`), then packs sentences up to chunkSize, joined by
+ * single spaces, carrying the last overlapSentences into the next chunk.
+ * As in Python, overlapSentences = 0 carries every sentence forward.
+ *
+ * Chunks are string_views. In character mode they always point into the
+ * input. In sentence mode they do whenever the sentences inside a chunk are
+ * separated by exactly one space in the input; otherwise the joined text
+ * is built in a buffer owned by the chunker.
+ *
+ * Input can be passed whole (split) or streamed in pieces (feed/finish).
+ * When streaming, only the text the next chunk may still need is kept,
+ * so pages need not fit in memory at once.
+ */
+class Chunker {
+public:
+    typedef std::function<void(std::string_view chunk)> ChunkCallback;
+
+    /**
+     * @brief Construct a new Chunker object
+     */
+    explicit Chunker(const ChunkerOptions& options = ChunkerOptions());
+
+    /**
+     * @brief Chunk a whole text
+     *
+     * @param text UTF-8 text
+     * @param chunks Receives the chunks; views stay valid while @p text is
+     *               alive and until the next call on this chunker
+     */
+    void split(std::string_view text, std::vector<std::string_view>& chunks);
+
+    /**
+     * @brief Chunk a whole text, passing each chunk to a callback
+     *
+     * @param text UTF-8 text
+     * @param emit Called with each chunk (valid during the call)
+     */
+    void split(std::string_view text, const ChunkCallback& emit);
+
+    /**
+     * @brief Stream the next piece of a text
+     *
+     * Pieces may split anywhere, even inside a UTF-8 sequence.
+     *
+     * @param data Next bytes of the text
+     * @param emit Called with each chunk completed so far (valid during the call)
+     */
+    void feed(std::string_view data, const ChunkCallback& emit);
+
+    /**
+     * @brief End the streamed text, emitting the remaining chunks, and reset
+     *
+     * @param emit Called with each remaining chunk (valid during the call)
+     */
+    void finish(const ChunkCallback& emit);
+
+    /**
+     * @brief Drop any streamed state
+     */
+    void reset();
+
+    /**
+     * @brief Bytes currently retained from streamed input
+     */
+    size_t buffered() const { return buffer_.size(); }
+
+private:
+    struct Sentence {
+        size_t begin;    // Byte offsets into the current text
+        size_t end;
+        size_t chars;
+    };
+
+    ChunkerOptions options_;
+    std::string buffer_;
+    std::deque<std::string> joined_;
+    size_t emitted_;
+    bool done_;
+
+    // Character mode: the window [start_, end_) holding windowChars_ code points
+    size_t start_;
+    size_t end_;
+    size_t windowChars_;
+
+    // Sentence mode
+    std::deque<Sentence> sentences_;
+    size_t currentChars_;
+    size_t sentenceStart_;
+    size_t searchFrom_;
+
+    size_t process(std::string_view text, bool final, const ChunkCallback& emit, bool keepJoined);
+    size_t processWindows(std::string_view text, bool final, const ChunkCallback& emit);
+    size_t processSentences(std::string_view text, bool final, const ChunkCallback& emit, bool keepJoined);
+    void addSentence(std::string_view text, size_t begin, size_t end, const ChunkCallback& emit, bool keepJoined);
+    void emitSentences(std::string_view text, const ChunkCallback& emit, bool keepJoined);
+    void shift(size_t consumed);
+};
+
+#endif // CHUNKER_H
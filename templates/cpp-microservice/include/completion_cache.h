@@ -0,0 +1,297 @@
+#ifndef COMPLETION_CACHE_H
+#define COMPLETION_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief CompletionCache settings
+ */
+struct CompletionCacheOptions {
+    size_t maxBytes = 256u << 20;    // Keys, responses and bookkeeping across all shards
+    size_t shards = 16;              // Independently locked parts, each with an equal share of maxBytes
+    uint64_t ttlMillis = 86400000;   // How long a response is served after it is stored
+    double windowRatio = 0.01;       // Share of a shard's bytes in the admission window
+    double protectedRatio = 0.8;     // Share of the rest kept for entries hit more than once
+};
+
+/**
+ * @brief One chat message of a completion request
+ */
+struct CompletionMessage {
+    std::string role;
+    std::string content;
+};
+
+/**
+ * @brief SHA-256 of a completion request, as CompletionCache::key() computes it
+ */
+struct CompletionKey {
+    uint8_t bytes[32];
+
+    bool operator==(const CompletionKey& other) const;
+    bool operator!=(const CompletionKey& other) const { return !(*this == other); }
+
+    std::string hex() const;
+
+    /**
+     * @brief Parse the 64 hex digits hex() writes
+     *
+     * @return false unless text is exactly that
+     */
+    static bool fromHex(std::string_view text, CompletionKey& key);
+};
+
+/**
+ * @brief CompletionCache counters
+ */
+struct CompletionCacheStats {
+    size_t entries = 0;
+    size_t bytes = 0;            // Accounted bytes of the entries cached
+    size_t capacityBytes = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;         // Including expired entries and spill hits
+    uint64_t expired = 0;        // Lookups that found an entry past its TTL
+    uint64_t inserts = 0;
+    uint64_t evictions = 0;      // Entries pushed out of the main space by admitted ones
+    uint64_t rejected = 0;       // Window entries the admission policy kept out of the main space
+    uint64_t spillHits = 0;      // Misses answered by the spill tier
+    uint64_t spillWrites = 0;
+};
+
+/**
+ * @brief Second cache tier that evicted and rejected responses are written to
+ *
+ * Either function may be empty. Both are called without any cache lock held
+ * and may block on the network; they must be thread-safe.
+ */
+struct CompletionSpill {
+    // Fetch a response by hex key; sets ttlMillis to its remaining lifetime, or 0 if unknown
+    std::function<bool(const std::string& key, std::string& value, uint64_t& ttlMillis)> get;
+    // Store a response by hex key for ttlMillis
+    std::function<void(const std::string& key, const std::string& value, uint64_t ttlMillis)> set;
+};
+
+/**
+ * @brief In-process cache of LLM completion responses
+ *
+ * Keys are the SHA-256 of the provider, the messages and any sampling
+ * settings, so equal requests hit whatever their JSON formatting was. The
+ * key's bytes pick a shard, each with its own mutex, and a hit is a hash
+ * lookup and a list splice: a response is served in well under a
+ * microsecond, against a network round trip for Redis.
+ *
+ * Each shard is bounded in bytes and runs W-TinyLFU. New entries enter a
+ * small LRU window; the window's oldest entry is only admitted to the main
+ * space, a segmented LRU of probation and protected entries, if a
+ * count-min sketch of recent lookups says it is asked for more often than
+ * every entry it would push out. A burst of one-off prompts thus passes
+ * through the window without flushing the responses that are asked for
+ * again and again. The sketch halves its counters periodically, so
+ * popularity ages. Entries expire ttlMillis after they are stored; expired
+ * ones are dropped when looked up or when they reach the end of their LRU.
+ *
+ * With a spill tier set, entries the cache evicts or rejects are written to
+ * it with their remaining TTL, and misses are looked up there before the
+ * caller goes to the provider. redisSpill() makes one that speaks RESP
+ * to a Redis-compatible server. All methods are thread-safe.
+ */
+class CompletionCache {
+public:
+    /**
+     * @brief Send one or more RESP commands and return every reply
+     *
+     * @param request The commands, RESP-encoded back to back
+     * @param replies Receives the server's RESP replies, one per command, in order
+     * @return false on a connection error
+     */
+    using RespTransport = std::function<bool(const std::string& request, std::string& replies)>;
+
+    /**
+     * @brief Construct a new CompletionCache object
+     *
+     * @param options Size, sharding and TTL
+     */
+    explicit CompletionCache(const CompletionCacheOptions& options = CompletionCacheOptions());
+
+    CompletionCache(const CompletionCache&) = delete;
+    CompletionCache& operator=(const CompletionCache&) = delete;
+
+    /**
+     * @brief Key of a completion request
+     *
+     * Every field is length-prefixed before hashing, so no two different
+     * requests share a byte stream.
+     *
+     * @param provider Provider or model name
+     * @param messages Chat messages in order
+     * @param settings Anything else that changes the answer, built with appendSetting(); empty if nothing
+     * @return The request's SHA-256
+     */
+    static CompletionKey key(std::string_view provider, const std::vector<CompletionMessage>& messages,
+                             std::string_view settings = std::string_view());
+
+    /**
+     * @brief Add one sampling setting to the settings a key() covers
+     *
+     * The name and value are length-prefixed like key()'s fields, so no
+     * value can pass for another setting.
+     *
+     * @param settings Settings so far; append in a fixed order
+     * @param name Setting name, e.g. "temperature"
+     * @param value Its value as sent, e.g. "0.7"
+     */
+    static void appendSetting(std::string& settings, std::string_view name, std::string_view value);
+
+    /**
+     * @brief Look a response up, then in the spill tier on a miss
+     *
+     * @param key Request key
+     * @param nowMillis Milliseconds on a monotonic clock
+     * @return The response, or nullptr on a miss
+     */
+    std::shared_ptr<const std::string> get(const CompletionKey& key, uint64_t nowMillis);
+
+    /**
+     * @brief Store or replace a response
+     *
+     * @param key Request key
+     * @param response Serialized response
+     * @param nowMillis Milliseconds on a monotonic clock
+     * @param ttlMillis Lifetime; 0 for the configured one
+     * @return false if the response is too large to cache in memory (it is still spilled)
+     */
+    bool put(const CompletionKey& key, std::string response, uint64_t nowMillis, uint64_t ttlMillis = 0);
+
+    /**
+     * @brief Drop a response from memory; the spill tier is left as it is
+     *
+     * @return true if one was cached
+     */
+    bool remove(const CompletionKey& key);
+
+    void setSpill(const CompletionSpill& spill);
+
+    CompletionCacheStats stats() const;
+    const CompletionCacheOptions& options() const { return options_; }
+
+    /**
+     * @brief A spill tier on a Redis-compatible server
+     *
+     * Writes are SET <prefix><key> <value> PX <ttl>; reads pipeline GET and
+     * PTTL in one round trip. Errors are logged and count as misses.
+     *
+     * @param transport Connection to the server
+     * @param keyPrefix Prepended to every key, e.g. "completion:"
+     */
+    static CompletionSpill redisSpill(const RespTransport& transport, const std::string& keyPrefix);
+
+    /**
+     * @brief RESP encoding of a command, as an array of bulk strings
+     */
+    static std::string respCommand(const std::vector<std::string_view>& arguments);
+
+    /**
+     * @brief Split the first RESP reply off a buffer
+     *
+     * @param replies Buffer; the reply is removed from its front
+     * @param value Receives a bulk or simple string, an integer's digits or an error's text
+     * @param type Receives the reply's type byte ('$', '+', ':', '-'), or '_' for a nil bulk string
+     * @return false if the buffer does not start with a whole reply of those types
+     */
+    static bool parseRespReply(std::string_view& replies, std::string& value, char& type);
+
+private:
+    enum class Region : uint8_t { Window, Probation, Protected };
+
+    struct Entry {
+        CompletionKey key;
+        std::shared_ptr<const std::string> value;
+        size_t bytes;
+        uint64_t expiresAt;
+        Region region;
+    };
+
+    struct KeyHash {
+        size_t operator()(const CompletionKey& key) const;
+    };
+
+    typedef std::list<Entry> EntryList;
+
+    /**
+     * @brief 4-bit count-min sketch of key popularity, halved every sampleSize increments
+     */
+    class FrequencySketch {
+    public:
+        explicit FrequencySketch(size_t counters);
+        void increment(const CompletionKey& key);
+        unsigned frequency(const CompletionKey& key) const;
+
+    private:
+        std::vector<uint64_t> table_;    // 16 counters a word
+        size_t mask_;                    // Counters - 1
+        size_t additions_;
+        size_t sampleSize_;
+
+        void halve();
+    };
+
+    struct Shard {
+        explicit Shard(size_t sketchCounters) : sketch(sketchCounters) {}
+
+        std::mutex mutex;
+        std::unordered_map<CompletionKey, EntryList::iterator, KeyHash> index;
+        EntryList window;       // Most recent at the front
+        EntryList probation;
+        EntryList protectedList;
+        size_t windowBytes = 0;
+        size_t probationBytes = 0;
+        size_t protectedBytes = 0;
+        FrequencySketch sketch;
+    };
+
+    // A response leaving memory that belongs in the spill tier
+    struct Spilled {
+        CompletionKey key;
+        std::shared_ptr<const std::string> value;
+        uint64_t ttlMillis;
+    };
+
+    CompletionCacheOptions options_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    size_t shardBytes_;
+    size_t windowBytes_;       // Per shard
+    size_t protectedBytes_;    // Per shard
+    mutable std::mutex spillMutex_;
+    std::shared_ptr<const CompletionSpill> spill_;
+
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+    std::atomic<uint64_t> expired_;
+    std::atomic<uint64_t> inserts_;
+    std::atomic<uint64_t> evictions_;
+    std::atomic<uint64_t> rejected_;
+    std::atomic<uint64_t> spillHits_;
+    std::atomic<uint64_t> spillWrites_;
+
+    Shard& shardOf(const CompletionKey& key) const;
+    std::shared_ptr<const CompletionSpill> spill() const;
+    bool insertLocked(Shard& shard, const CompletionKey& key, std::shared_ptr<const std::string> value,
+                      uint64_t expiresAt, uint64_t nowMillis, std::vector<Spilled>& spilled);
+    void eraseLocked(Shard& shard, EntryList::iterator it);
+    void admitLocked(Shard& shard, uint64_t nowMillis, std::vector<Spilled>& spilled);
+    void writeSpilled(const std::vector<Spilled>& spilled);
+    EntryList& listOf(Shard& shard, Region region);
+    size_t& bytesOf(Shard& shard, Region region);
+};
+
+#endif // COMPLETION_CACHE_H
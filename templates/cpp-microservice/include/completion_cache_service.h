@@ -0,0 +1,54 @@
+#ifndef COMPLETION_CACHE_SERVICE_H
+#define COMPLETION_CACHE_SERVICE_H
+
+#include "completion_cache.h"
+#include "http_server.h"
+#include <map>
+#include <memory>
+#include <string>
+
+class ConfigManager;
+
+/**
+ * @brief HTTP front-end for the completion response cache
+ *
+ * The gateway's /completion asks /completion/cache/lookup with the
+ * provider and messages it is about to send. On a hit it returns the
+ * cached response; on a miss it calls the provider and posts the
+ * serialized CompletionResponse to /completion/cache/store under the key
+ * the lookup returned. In-process callers use cache() directly, and can
+ * set a Redis spill tier on it.
+ */
+class CompletionCacheService {
+public:
+    /**
+     * @brief Construct a new CompletionCacheService object
+     */
+    CompletionCacheService();
+
+    /**
+     * @brief Create the cache using COMPLETION_CACHE_* configuration keys
+     *
+     * @param config Loaded configuration
+     * @return true if the configuration is valid
+     */
+    bool initialize(const ConfigManager& config);
+
+    /**
+     * @brief Register the completion cache routes on a server
+     *
+     * @param server HTTP server
+     */
+    void registerRoutes(HttpServer& server);
+
+    CompletionCache& cache() { return *cache_; }
+
+    std::string handleLookup(const std::map<std::string, std::string>& params);
+    std::string handleStore(const std::map<std::string, std::string>& params);
+    std::string handleStats(const std::map<std::string, std::string>& params);
+
+private:
+    std::unique_ptr<CompletionCache> cache_;
+};
+
+#endif // COMPLETION_CACHE_SERVICE_H
@@ -0,0 +1,74 @@
+#ifndef CONTENT_SERVICE_H
+#define CONTENT_SERVICE_H
+
+#include "boilerplate_stripper.h"
+#include "feed_reader.h"
+#include "html_to_markdown.h"
+#include "http_server.h"
+#include "near_duplicate.h"
+#include "score_fusion.h"
+#include "url_canonicalizer.h"
+#include <map>
+#include <mutex>
+#include <string>
+
+class ConfigManager;
+
+/**
+ * @brief HTTP front-end for cleaning crawled page content
+ *
+ * Serves the text processing the Python crawler and scraper do inline,
+ * so they can hand it off: POST /strip_boilerplate takes `markdown` and an
+ * optional `rules` preset (crawler, scraper or web-api), and
+ * POST /html_to_markdown converts a fetched page's `html`, stripping it with
+ * `rules` too when that is given. POST /near_duplicates clusters a batch of
+ * `texts.<i>` (search snippets or page bodies) so near-duplicates can be
+ * dropped before they are scraped or embedded; with `remember=true` the
+ * batch is also checked against, and added to, the pages seen before.
+ * POST /canonicalize_urls returns the canonical form and 128-bit cache key
+ * of each `urls.<i>`. POST /fuse_results merges provider result lists
+ * (`lists.<i>.urls.<j>`) into one ranking, deduplicated by canonical URL.
+ * POST /parse_feed pulls the entries out of an arXiv, YaCy or PubMed `xml`
+ * response.
+ */
+class ContentService {
+public:
+    /**
+     * @brief Construct a new ContentService object
+     */
+    ContentService();
+
+    /**
+     * @brief Pick the default boilerplate preset from CONTENT_BOILERPLATE_RULES
+     *        and read the near-duplicate (CONTENT_DEDUP_*) and URL
+     *        (CONTENT_URL_TRACKING_PARAMS) settings
+     *
+     * @param config Loaded configuration
+     * @return true if the settings are valid
+     */
+    bool initialize(const ConfigManager& config);
+
+    /**
+     * @brief Register the content routes on a server
+     *
+     * @param server HTTP server
+     */
+    void registerRoutes(HttpServer& server);
+
+    std::string handleStripBoilerplate(const std::map<std::string, std::string>& params);
+    std::string handleHtmlToMarkdown(const std::map<std::string, std::string>& params);
+    std::string handleNearDuplicates(const std::map<std::string, std::string>& params);
+    std::string handleCanonicalizeUrls(const std::map<std::string, std::string>& params);
+    std::string handleFuseResults(const std::map<std::string, std::string>& params);
+    std::string handleParseFeed(const std::map<std::string, std::string>& params);
+
+private:
+    std::map<std::string, BoilerplateStripper> strippers_;
+    std::string defaultRules_;
+    UrlCanonicalizer canonicalizer_;
+
+    std::mutex seenMutex_;
+    NearDuplicateIndex seen_;    // Pages kept by earlier remember=true batches
+};
+
+#endif // CONTENT_SERVICE_H
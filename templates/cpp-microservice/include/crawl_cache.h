@@ -0,0 +1,317 @@
+#ifndef CRAWL_CACHE_H
+#define CRAWL_CACHE_H
+
+#include "cuckoo_filter.h"
+#include "lz_codec.h"
+#include "vector_segment.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Crawl cache settings
+ */
+struct CrawlCacheOptions {
+    std::string directory = "data/crawl_cache";
+    double ttlSeconds = 86400;              // Pages crawled longer ago miss, and compaction drops them
+    size_t segmentBytes = 64u << 20;        // Start a new segment file once the active one is this large
+    double compactGarbageRatio = 0.5;       // Rewrite a sealed segment once this share of it is dead
+    int compactIntervalSeconds = 60;        // Background compaction period
+    bool syncWrites = false;                // fdatasync the active segment after every put
+    size_t dictionaryBytes = 32u << 10;     // Per-domain compression dictionary size; 0 disables dictionaries
+    size_t dictionarySamples = 32;          // Pages of a domain to train its dictionary on
+    size_t maxDictionaries = 1024;          // Domains past this many compress without a dictionary
+    bool filter = true;                     // Answer lookups of uncached URLs from a cuckoo filter
+};
+
+/**
+ * @brief A cached page
+ */
+struct CrawlPage {
+    std::string url;
+    std::string sourceDomain;
+    double crawledAt = 0;    // Seconds since the epoch, as time.time() in the crawler
+    Metadata fields;         // content, markdown, title, author, word_count, ...
+};
+
+/**
+ * @brief Crawl cache statistics
+ */
+struct CrawlCacheStats {
+    size_t entries = 0;          // URLs with a record (fresh or not)
+    size_t segments = 0;
+    uint64_t segmentBytes = 0;   // Bytes of records in every segment
+    uint64_t liveBytes = 0;      // Bytes of the records the index points to
+    uint64_t rawBytes = 0;       // Uncompressed size of those records' fields
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t expired = 0;        // Gets that found only a stale record
+    uint64_t puts = 0;
+    uint64_t compactions = 0;
+    uint64_t droppedRecords = 0; // Expired or replaced records compaction removed
+    size_t dictionaries = 0;     // Trained per-domain dictionaries
+    uint64_t decodedBytes = 0;   // Field bytes decompressed by gets
+    double decodeMillis = 0;     // Time gets spent decompressing them
+    uint64_t filterBytes = 0;    // Cuckoo filter mapping (0 without one)
+    double filterLoad = 0;       // Share of its slots in use
+    double filterExpectedFpr = 0; // Chance an uncached URL passes it, at that load
+    uint64_t filterNegatives = 0; // Lookups it answered alone, without the table or a segment
+    uint64_t filterFalsePositives = 0; // Lookups it passed that found no record
+    double openMillis = 0;
+    double lastCompactionMillis = 0;
+};
+
+/**
+ * @brief Log-structured, memory-mapped cache of crawled pages keyed by URL
+ *
+ * Layout of the cache directory:
+ *
+ *   cache-<gen>.log   append-only segment of CRC-checked page records
+ *   dict-<id>.lzd     compression dictionary trained for one source domain
+ *   urls.cuckoo       cuckoo filter of the URLs the table holds
+ *
+ * Puts compress the page's fields (see lzCompress) and append one record to
+ * the active segment, which is mapped read-write at its full size. A new
+ * segment starts once it is full. An open-addressing table maps a URL's
+ * 64-bit hash to the segment and offset of its newest record.
+ *
+ * Pages of one site share navigation, headings and boilerplate. Once a
+ * domain has dictionarySamples pages, trainDictionaries builds an
+ * LzDictionary from them. Later puts for that domain compress with it, and
+ * compaction recompresses the domain's older records as it copies them.
+ * Records stay compressed in the segments (and the page cache). Only a get
+ * decompresses, and only the one page it returns.
+ *
+ * Gets take no lock. They probe the table and decompress the record
+ * straight out of the mapping, checking the record's URL and crawled_at.
+ * Tables and segments replaced by a writer are freed only once every get
+ * that might still see them has finished: gets announce themselves in a
+ * per-thread counter of the current epoch, and the writer bumps the epoch
+ * and waits for the previous one's counters to drain.
+ *
+ * Most lookups before a crawl are for URLs that are not cached. A
+ * CuckooFilter of the table's URL hashes answers those from a few MB of
+ * memory: a get first checks the filter and only probes the table (and
+ * reads a segment) if the filter passes it. A URL enters the filter before
+ * the table points at it and leaves once the table no longer does, whether
+ * it was removed or compaction dropped it as expired. A filter that gets
+ * too full is rebuilt at twice the size from the table's keys. Close flushes
+ * the filter, stamped with the segments' generations, file sizes and record
+ * bytes. Open maps it instead of rebuilding it if the segments still match,
+ * so records put by a session without the filter force a rebuild.
+ *
+ * Background compaction deletes sealed segments whose records are all
+ * expired. It rewrites a segment once compactGarbageRatio of it is
+ * replaced or expired, copying the live records into the active segment.
+ * On open every segment is scanned in generation order to rebuild the
+ * table, and a torn record at the end of the last one is cut off.
+ */
+class CrawlCache {
+public:
+    /**
+     * @brief Construct a new CrawlCache object
+     */
+    CrawlCache();
+
+    /**
+     * @brief Destroy the CrawlCache object, stopping background work
+     */
+    ~CrawlCache();
+
+    CrawlCache(const CrawlCache&) = delete;
+    CrawlCache& operator=(const CrawlCache&) = delete;
+
+    /**
+     * @brief Open (or create) a cache directory
+     *
+     * @param options Cache settings
+     * @return true if the cache was opened
+     */
+    bool open(const CrawlCacheOptions& options);
+
+    /**
+     * @brief Stop background work and release the cache
+     */
+    void close();
+
+    /**
+     * @brief Store or replace the page cached for a URL
+     *
+     * @param page Page; source_domain is taken from page.sourceDomain
+     * @return true if the record was written
+     */
+    bool put(const CrawlPage& page);
+
+    /**
+     * @brief Look up a fresh page, without locking
+     *
+     * @param url Page URL
+     * @param maxAgeSeconds Pages crawled longer ago than this miss (the crawler's cache_ttl_override)
+     * @param page Receives the page on a hit
+     * @return true on a hit
+     */
+    bool get(std::string_view url, double maxAgeSeconds, CrawlPage& page) const;
+
+    /**
+     * @brief Look up a fresh page with the configured TTL
+     */
+    bool get(std::string_view url, CrawlPage& page) const { return get(url, options_.ttlSeconds, page); }
+
+    /**
+     * @brief Whether a fresh page is cached, without decompressing it
+     */
+    bool contains(std::string_view url, double maxAgeSeconds) const;
+
+    /**
+     * @brief Drop the page cached for a URL
+     *
+     * @return true if a page was cached and its removal was written
+     */
+    bool remove(std::string_view url);
+
+    /**
+     * @brief Drop every page and segment
+     *
+     * @return true if the cache was emptied
+     */
+    bool clear();
+
+    /**
+     * @brief Delete expired segments and rewrite mostly dead ones
+     *
+     * @param force Rewrite every sealed segment holding any dead record or a live
+     *              page put before its domain had a dictionary
+     * @return true if compaction succeeded or there was nothing to do
+     */
+    bool compact(bool force = false);
+
+    /**
+     * @brief Train dictionaries for domains that have enough pages
+     *
+     * @return true if every dictionary trained was stored
+     */
+    bool trainDictionaries();
+
+    /**
+     * @brief Start the background thread (dictionary training, then compaction)
+     */
+    void startBackgroundCompaction();
+
+    /**
+     * @brief Stop the background compaction thread
+     */
+    void stopBackgroundCompaction();
+
+    /**
+     * @brief Count pages crawled within maxAgeSeconds
+     */
+    size_t countFresh(double maxAgeSeconds) const;
+
+    /**
+     * @brief Pages per source_domain, most first
+     *
+     * @param limit Number of domains to return
+     */
+    std::vector<std::pair<std::string, size_t>> topDomains(size_t limit) const;
+
+    /**
+     * @brief Current statistics
+     */
+    CrawlCacheStats stats() const;
+
+    const CrawlCacheOptions& options() const { return options_; }
+
+private:
+    struct Segment;
+    struct SegmentTable;
+    struct Index;
+
+    // One cache line per counter, so concurrent gets never share one
+    struct alignas(64) ReaderStripe {
+        std::atomic<int64_t> active[2];    // Gets in progress, by epoch parity
+        std::atomic<uint64_t> hits;
+        std::atomic<uint64_t> misses;
+        std::atomic<uint64_t> expired;
+        std::atomic<uint64_t> decodedBytes;
+        std::atomic<uint64_t> decodeNanos;
+        std::atomic<uint64_t> filtered;          // Lookups the filter answered
+        std::atomic<uint64_t> falsePositives;    // Lookups it passed that found no record
+    };
+    static constexpr size_t kReaderStripes = 16;
+
+    class ReadGuard;
+
+    // Writer-side state of one source domain
+    struct DomainState {
+        uint32_t pages = 0;          // Pages put without a dictionary
+        uint32_t dictionary = 0;     // Its dictionary's id, once trained
+        bool trained = false;        // Training ran (it may have found nothing shared)
+    };
+
+    CrawlCacheOptions options_;
+
+    // Read without locking; replaced by writers under writeMutex_
+    std::atomic<Index*> index_;
+    std::atomic<SegmentTable*> segmentTable_;
+    std::atomic<CuckooFilter*> filter_;    // nullptr if disabled or it could not be built
+    mutable std::atomic<uint64_t> epoch_;
+    mutable ReaderStripe readers_[kReaderStripes];
+
+    mutable std::mutex writeMutex_;  // Serializes puts, removes and table swaps
+    std::mutex compactionMutex_;     // Serializes compactions, clears and dictionary training
+    std::map<uint64_t, std::unique_ptr<Segment>> segments_;    // By generation; writer-owned
+    Segment* active_;
+    uint64_t nextGeneration_;
+    uint64_t rawBytes_;
+
+    // Dictionaries by id, read without locking; set once and freed on close
+    std::unique_ptr<std::atomic<const LzDictionary*>[]> dictionaries_;
+    size_t dictionaryCapacity_;
+    std::vector<std::unique_ptr<LzDictionary>> dictionaryStore_;    // Writer-owned
+    std::unordered_map<std::string, DomainState> domains_;           // Writer-owned
+    uint32_t nextDictionary_;
+
+    std::mutex backgroundMutex_;
+    std::condition_variable backgroundCv_;
+    std::thread backgroundThread_;
+    bool backgroundRunning_;
+
+    std::atomic<uint64_t> puts_;
+    std::atomic<uint64_t> compactions_;
+    std::atomic<uint64_t> droppedRecords_;
+    double openMillis_;
+    std::atomic<double> lastCompactionMillis_;
+
+    const uint8_t* findRecord(std::string_view url, uint64_t hash, uint32_t* length) const;
+    bool append(const std::string& record, uint64_t hash, bool removal, double crawledAt, uint32_t rawSize);
+    uint64_t storeLocation(uint64_t hash, uint64_t location);
+    void release(uint64_t location);
+    bool roll(size_t recordSize);
+    Segment* createSegment(uint64_t generation, size_t capacity);
+    Segment* openSegment(uint64_t generation);
+    void replaySegment(Segment& segment);
+    bool compactSegment(Segment& segment, double cutoff, bool keepRemovals);
+    bool recompressible(const Segment& segment);
+    void publishSegments();
+    void synchronize() const;
+    void dropSegment(uint64_t generation);
+    CuckooFilter* buildFilter(size_t capacity);
+    void replaceFilter(CuckooFilter* filter);
+    std::string segmentFileSizes(const std::vector<uint64_t>& generations) const;
+    uint64_t filterStamp(std::string fileSizes) const;
+    std::string segmentPath(uint64_t generation) const;
+    std::string dictionaryPath(uint32_t id) const;
+    bool loadDictionaries();
+    const LzDictionary* dictionaryFor(std::string_view domain, uint32_t* id);
+    void backgroundLoop();
+};
+
+#endif // CRAWL_CACHE_H
@@ -0,0 +1,66 @@
+#ifndef CRAWL_CACHE_SERVICE_H
+#define CRAWL_CACHE_SERVICE_H
+
+#include "crawl_cache.h"
+#include "http_server.h"
+#include <map>
+#include <string>
+
+class ConfigManager;
+
+/**
+ * @brief HTTP front-end for the crawl cache
+ *
+ * Replaces the SQLite `cache` table of services/crawler: /cache/page
+ * answers what _cache_get returns (the row's columns, or hit=false for a
+ * missing or stale URL) and /cache/put takes what _cache_put stores, with
+ * `headers` flattened as headers.<name>. /cache/stats and /cache/clear keep
+ * the crawler's response shapes.
+ */
+class CrawlCacheService {
+public:
+    /**
+     * @brief Construct a new CrawlCacheService object
+     */
+    CrawlCacheService();
+
+    /**
+     * @brief Destroy the CrawlCacheService object
+     */
+    ~CrawlCacheService();
+
+    /**
+     * @brief Open the cache using CRAWL_CACHE_* configuration keys
+     *
+     * @param config Loaded configuration
+     * @return true if the cache was opened
+     */
+    bool initialize(const ConfigManager& config);
+
+    /**
+     * @brief Register the cache routes on a server
+     *
+     * @param server HTTP server
+     */
+    void registerRoutes(HttpServer& server);
+
+    /**
+     * @brief Stop background compaction and close the cache
+     */
+    void shutdown();
+
+    CrawlCache& cache() { return cache_; }
+
+    void handlePage(const std::map<std::string, std::string>& params, JsonWriter& out);
+    std::string handleContains(const std::map<std::string, std::string>& params);
+    std::string handlePut(const std::map<std::string, std::string>& params);
+    std::string handleDelete(const std::map<std::string, std::string>& params);
+    std::string handleStats(const std::map<std::string, std::string>& params);
+    std::string handleClear(const std::map<std::string, std::string>& params);
+    std::string handleCompact(const std::map<std::string, std::string>& params);
+
+private:
+    CrawlCache cache_;
+};
+
+#endif // CRAWL_CACHE_SERVICE_H
@@ -0,0 +1,218 @@
+#ifndef CRAWL_FRONTIER_H
+#define CRAWL_FRONTIER_H
+
+#include "timer_wheel.h"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Priority classes of the crawl frontier, most urgent first
+ */
+enum class CrawlPriority : uint8_t {
+    Interactive = 0,    // A user is waiting on /crawl
+    Batch = 1,          // /crawl/batch
+    Background = 2      // Feed polling and re-crawls
+};
+
+/**
+ * @brief CrawlFrontier tuning
+ */
+struct CrawlFrontierOptions {
+    uint64_t domainIntervalMillis = 1000;    // Between two leases of one host, as the crawler's _rate_limit
+    size_t domainConcurrency = 1;            // Leases of one host out at once
+    size_t maxPending = 10000000;            // Queued and delayed URLs; push() refuses beyond this
+    uint32_t classWeights[3] = {16, 4, 1};   // Lease shares of the classes while all have ready hosts
+};
+
+/**
+ * @brief A URL handed out by lease()
+ */
+struct FrontierLease {
+    std::string url;
+    std::string host;
+    CrawlPriority priority;
+    uint64_t waitedMillis;    // From being queued (or coming due) to the lease
+};
+
+/**
+ * @brief CrawlFrontier counters
+ */
+struct CrawlFrontierStats {
+    size_t queued = 0;         // Waiting for their host
+    size_t delayed = 0;        // Pushed with a delay that has not run out
+    size_t leased = 0;         // Out and not yet finished
+    size_t domains = 0;        // Hosts with queued, delayed or leased URLs, or still within their interval
+    size_t readyDomains = 0;   // Hosts with a queued URL and a free lease slot, within their interval or not
+    uint64_t pushed = 0;
+    uint64_t rejected = 0;     // Refused by maxPending
+    uint64_t leases = 0;
+    uint64_t leasesByClass[3] = {0, 0, 0};
+    uint64_t maxWaitMillis = 0;
+    size_t memoryBytes = 0;
+};
+
+/**
+ * @brief Per-host politeness scheduler for URLs waiting to be crawled
+ *
+ * Every host has one FIFO queue per priority class and a next-allowed
+ * time. A host with queued URLs and a free lease slot sits in the ready
+ * heap of its most urgent non-empty class, ordered by next-allowed time,
+ * so lease() only looks at heap tops and never at hosts still waiting out
+ * their interval. Leasing a URL moves the host's next-allowed time one
+ * interval on; reaching the concurrency limit takes it out of the heaps
+ * until finish().
+ *
+ * Classes share leases by smooth weighted round-robin over the classes
+ * whose heap top is ready, so background hosts keep their share while
+ * interactive ones are busy, and a class with nothing ready gives its
+ * share to the others.
+ *
+ * URLs pushed with a delay, and hosts that went idle, wait in a
+ * hierarchical timer wheel (millisecond ticks) rather than a heap, so
+ * millions of them cost O(1) each to schedule. An idle host is forgotten
+ * once its interval has passed. Times are caller-supplied milliseconds on
+ * a monotonic clock; see steadyMillis(). All methods are thread-safe.
+ */
+class CrawlFrontier {
+public:
+    /**
+     * @brief Construct an empty CrawlFrontier object
+     *
+     * @param options Politeness limits and class weights
+     */
+    explicit CrawlFrontier(const CrawlFrontierOptions& options = CrawlFrontierOptions());
+
+    CrawlFrontier(const CrawlFrontier&) = delete;
+    CrawlFrontier& operator=(const CrawlFrontier&) = delete;
+
+    /**
+     * @brief Queue a URL behind the others of its host and class
+     *
+     * @param url Absolute URL
+     * @param priority Class it is leased in
+     * @param nowMillis Current time
+     * @param delayMillis Keep it out of the queue this long
+     * @return false if the URL has no host or maxPending URLs are waiting
+     */
+    bool push(std::string_view url, CrawlPriority priority, uint64_t nowMillis, uint64_t delayMillis = 0);
+
+    /**
+     * @brief Hand out URLs whose hosts are allowed a request now
+     *
+     * @param max Most URLs to lease; a host gets more than one only up to its concurrency
+     * @param nowMillis Current time
+     * @param out Receives the leases
+     * @return Number of URLs leased
+     */
+    size_t lease(size_t max, uint64_t nowMillis, std::vector<FrontierLease>& out);
+
+    /**
+     * @brief Release a lease of @p host, freeing its slot for the next URL
+     *
+     * @return false if the host had no lease out
+     */
+    bool finish(std::string_view host, uint64_t nowMillis);
+
+    /**
+     * @brief Set a host's interval, e.g. from robots.txt Crawl-delay
+     *
+     * Kept after the host goes idle; 0 restores the default.
+     */
+    void setDomainInterval(std::string_view host, uint64_t intervalMillis);
+
+    /**
+     * @brief How long a caller can sleep before lease() may return something
+     *
+     * @return 0 if a URL is ready now; -1 if nothing is queued or delayed outside hosts at their concurrency limit
+     */
+    int64_t waitMillis(uint64_t nowMillis);
+
+    CrawlFrontierStats stats() const;
+
+    const CrawlFrontierOptions& options() const { return options_; }
+
+    /**
+     * @brief Milliseconds on the steady clock
+     */
+    static uint64_t steadyMillis();
+
+    /**
+     * @brief Lower-cased host of a URL without userinfo and port, as urlparse().hostname
+     *
+     * @return Empty if the URL has no "scheme://host"
+     */
+    static std::string hostOf(std::string_view url);
+
+private:
+    static constexpr int kClasses = 3;
+    static constexpr uint32_t kNone = UINT32_MAX;
+    static constexpr uint64_t kDomainTimer = uint64_t(1) << 63;    // Payload flag: idle host, not a delayed URL
+
+    struct Entry {
+        std::string url;
+        uint32_t domain;
+        uint32_t next;
+        uint64_t readyAt;
+        CrawlPriority priority;
+    };
+
+    struct Queue {
+        uint32_t head = kNone;
+        uint32_t tail = kNone;
+    };
+
+    struct Domain {
+        std::string host;
+        Queue queues[kClasses];
+        size_t queued = 0;
+        size_t delayed = 0;
+        size_t leased = 0;
+        uint64_t nextAllowed = 0;
+        uint64_t intervalMillis = 0;
+        uint64_t heapSeq = 0;    // Matches the host's one live ready-heap item; 0 when it is in none
+        int heapClass = 0;
+        bool idleTimer = false;
+    };
+
+    struct HeapItem {
+        uint64_t nextAllowed;
+        uint64_t seq;
+        uint32_t domain;
+
+        // Earliest next-allowed on top, ties to the host that entered the heap first
+        bool operator<(const HeapItem& other) const {
+            return nextAllowed != other.nextAllowed ? nextAllowed > other.nextAllowed : seq > other.seq;
+        }
+    };
+
+    CrawlFrontierOptions options_;
+    mutable std::mutex mutex_;
+    std::vector<Entry> entries_;
+    uint32_t freeEntry_;
+    std::vector<Domain> domains_;
+    std::vector<uint32_t> freeDomains_;
+    std::unordered_map<std::string, uint32_t> domainIndex_;
+    std::unordered_map<std::string, uint64_t> intervals_;
+    std::vector<HeapItem> heaps_[kClasses];
+    int64_t credits_[kClasses];
+    TimerWheel wheel_;
+    std::vector<TimerWheel::Timer> fired_;
+    uint64_t heapSeq_;
+    size_t urlBytes_;
+    CrawlFrontierStats counters_;    // Everything but domains and memoryBytes is kept current
+
+    void advance(uint64_t nowMillis);
+    uint32_t domainFor(const std::string& host);
+    void enqueue(uint32_t entry);
+    void schedule(uint32_t domain);
+    void releaseIfIdle(uint32_t domain, uint64_t nowMillis);
+    int pickClass(uint64_t nowMillis);
+    void dropStale(int priority);
+};
+
+#endif // CRAWL_FRONTIER_H
@@ -0,0 +1,64 @@
+#ifndef CRAWL_FRONTIER_SERVICE_H
+#define CRAWL_FRONTIER_SERVICE_H
+
+#include "crawl_frontier.h"
+#include "http_server.h"
+#include <map>
+#include <memory>
+#include <string>
+
+class ConfigManager;
+class RobotsCache;
+
+/**
+ * @brief HTTP front-end for the crawl frontier
+ *
+ * Takes the place of the crawler's _rate_limit sleepers: /crawl/batch
+ * pushes its URLs to /frontier/push, its workers ask /frontier/lease for
+ * URLs whose host may be fetched now (sleeping for the returned wait_ms
+ * when there are none) and report each fetch to /frontier/done, which
+ * frees the host for its next URL.
+ */
+class CrawlFrontierService {
+public:
+    /**
+     * @brief Construct a new CrawlFrontierService object
+     */
+    CrawlFrontierService();
+
+    /**
+     * @brief Create the frontier using FRONTIER_* configuration keys
+     *
+     * @param config Loaded configuration
+     * @return true if the configuration is valid
+     */
+    bool initialize(const ConfigManager& config);
+
+    /**
+     * @brief Register the frontier routes on a server
+     *
+     * @param server HTTP server
+     */
+    void registerRoutes(HttpServer& server);
+
+    /**
+     * @brief Check pushed URLs against robots.txt rules; disallowed ones are not queued
+     *
+     * @param robots Cache to consult, or nullptr to stop; it must outlive the service
+     */
+    void setRobots(RobotsCache* robots) { robots_ = robots; }
+
+    CrawlFrontier& frontier() { return *frontier_; }
+
+    std::string handlePush(const std::map<std::string, std::string>& params);
+    std::string handleLease(const std::map<std::string, std::string>& params);
+    std::string handleDone(const std::map<std::string, std::string>& params);
+    std::string handleDomain(const std::map<std::string, std::string>& params);
+    std::string handleStats(const std::map<std::string, std::string>& params);
+
+private:
+    std::unique_ptr<CrawlFrontier> frontier_;
+    RobotsCache* robots_;
+};
+
+#endif // CRAWL_FRONTIER_SERVICE_H
@@ -0,0 +1,161 @@
+#ifndef CUCKOO_FILTER_H
+#define CUCKOO_FILTER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief On-disk cuckoo filter header, stored in the first page of the file
+ */
+struct CuckooFilterHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t clean;            // 1 once persist() flushed the buckets; 0 while a writer may change them
+    uint64_t buckets;
+    uint64_t count;            // Fingerprints stored
+    uint64_t stamp;            // Caller's fingerprint of the state the filter describes
+    uint32_t dataChecksum;     // CRC-32C of the buckets, set by persist()
+    uint32_t checksum;         // CRC-32C of the header with this field zeroed
+};
+
+/**
+ * @brief Approximate set of 64-bit hashes with deletion (Fan et al., 2014)
+ *
+ * Every hash keeps a 16-bit fingerprint in one of two buckets of four
+ * slots. The first bucket comes from the hash's low bits, the second is
+ * the first XOR a hash of the fingerprint, so either bucket and the
+ * fingerprint give the other. A lookup reads the two 64-bit bucket words
+ * and compares all four slots of each at once. It never misses a hash that
+ * was inserted and not erased, and passes an absent one with probability
+ * of about 8 x load / 65536 (0.012% when full).
+ *
+ * An insert that finds both buckets full searches breadth-first for a
+ * chain of fingerprints that can each move to their other bucket, ending
+ * at a free slot. It then moves them from the end of the chain backwards,
+ * writing each fingerprint's new slot before clearing its old one. If no
+ * chain is found the insert fails, and the caller rebuilds the filter
+ * larger.
+ *
+ * Lookups take no lock and may run during inserts and erases. A lookup
+ * could still miss a fingerprint that moves twice while it reads. Inserts
+ * that move fingerprints bump a version around the moves, and a lookup
+ * that found nothing retries if the version changed. Inserts and erases
+ * must be serialized by the caller.
+ *
+ * The buckets live in a shared read-write mapping of the filter file, after
+ * a one-page header. persist() flushes them and marks the file clean with
+ * the caller's stamp. open() only accepts a clean file with the same stamp.
+ */
+class CuckooFilter {
+public:
+    static constexpr uint32_t kFormatVersion = 1;
+    static constexpr size_t kSlotsPerBucket = 4;
+
+    /**
+     * @brief Construct an empty (unmapped) CuckooFilter object
+     */
+    CuckooFilter();
+
+    /**
+     * @brief Destroy the CuckooFilter object, unmapping without marking the file clean
+     */
+    ~CuckooFilter();
+
+    CuckooFilter(const CuckooFilter&) = delete;
+    CuckooFilter& operator=(const CuckooFilter&) = delete;
+
+    /**
+     * @brief Create an empty filter, replacing any file at @p path
+     *
+     * @param path Filter file; empty keeps the filter in anonymous memory
+     * @param capacity Hashes it should hold; rounded up to a power-of-two number of buckets
+     * @return true if the filter was created
+     */
+    bool create(const std::string& path, size_t capacity);
+
+    /**
+     * @brief Map a filter that persist() left with the same stamp
+     *
+     * The file is marked dirty before open() returns, so a crash before
+     * the next persist() makes the following open() fail.
+     *
+     * @param path Filter file
+     * @param stamp Stamp the caller expects
+     * @return false if the file is missing, corrupt, not clean or has another stamp
+     */
+    bool open(const std::string& path, uint64_t stamp);
+
+    /**
+     * @brief Flush the buckets and mark the file clean
+     *
+     * @param stamp Caller's fingerprint of what the filter now describes
+     * @return true if the file was flushed
+     */
+    bool persist(uint64_t stamp);
+
+    /**
+     * @brief Unmap the filter
+     */
+    void close();
+
+    /**
+     * @brief Whether @p hash may have been inserted; false means certainly not
+     */
+    bool contains(uint64_t hash) const;
+
+    /**
+     * @brief Add a hash (again, if it is already present)
+     *
+     * @return false if the filter is too full to place it; every hash inserted before is still found
+     */
+    bool insert(uint64_t hash);
+
+    /**
+     * @brief Remove one copy of a hash's fingerprint
+     *
+     * Only erase hashes that were inserted: erasing another hash with the
+     * same fingerprint and buckets would remove theirs.
+     *
+     * @return true if a matching fingerprint was found
+     */
+    bool erase(uint64_t hash);
+
+    bool isOpen() const { return buckets_ != nullptr; }
+    size_t size() const { return count_; }
+    size_t capacity() const { return (mask_ + 1) * kSlotsPerBucket; }
+    const std::string& path() const { return path_; }
+
+    /**
+     * @brief Bytes mapped: the header page and the buckets
+     */
+    size_t memoryBytes() const { return mappedBytes_; }
+
+    /**
+     * @brief Share of slots in use
+     */
+    double load() const { return isOpen() ? static_cast<double>(count_) / capacity() : 0.0; }
+
+    /**
+     * @brief Probability that contains() passes an absent hash at the current load
+     */
+    double expectedFalsePositiveRate() const;
+
+private:
+    std::string path_;    // Empty for an anonymous filter
+    uint8_t* mapping_;
+    size_t mappedBytes_;
+    std::atomic<uint64_t>* buckets_;
+    uint64_t mask_;
+    size_t count_;
+    std::atomic<uint64_t> version_;    // Odd while an insert moves fingerprints
+
+    bool map(int fd, size_t bytes);
+    CuckooFilterHeader* header() const { return reinterpret_cast<CuckooFilterHeader*>(mapping_); }
+    bool writeHeader(bool clean, uint64_t stamp);
+    bool place(uint64_t bucket, uint16_t fingerprint);
+    bool relocate(uint64_t first, uint64_t second, uint16_t fingerprint);
+};
+
+#endif // CUCKOO_FILTER_H
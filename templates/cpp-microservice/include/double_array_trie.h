@@ -0,0 +1,73 @@
+#ifndef DOUBLE_ARRAY_TRIE_H
+#define DOUBLE_ARRAY_TRIE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Byte-wise double-array trie mapping strings to int32 values
+ *
+ * Each node s owns the slots base[s] + byte + 1; a slot t is a child of s
+ * when check[t] == s. A transition is therefore two array reads with no
+ * pointer chasing, and prefix walks (longest match, shared "##" prefixes)
+ * cost one step per byte.
+ */
+class DoubleArrayTrie {
+public:
+    static const int32_t kRoot = 0;
+
+    /**
+     * @brief Construct an empty DoubleArrayTrie object
+     */
+    DoubleArrayTrie();
+
+    /**
+     * @brief Build from keys and their values, replacing any previous contents
+     *
+     * Empty keys are ignored; for duplicate keys the first value wins.
+     *
+     * @param keys Keys (any byte strings)
+     * @param values Non-negative value for each key
+     */
+    void build(const std::vector<std::string>& keys, const std::vector<int32_t>& values);
+
+    /**
+     * @brief Follow one byte from a node
+     *
+     * @param node Current node, updated on success
+     * @param byte Next byte
+     * @return true if the transition exists
+     */
+    bool step(int32_t& node, uint8_t byte) const {
+        const uint32_t next = static_cast<uint32_t>(base_[node]) + byte + 1;
+        if (next >= check_.size() || check_[next] != node) {
+            return false;
+        }
+        node = static_cast<int32_t>(next);
+        return true;
+    }
+
+    /**
+     * @brief Value stored at a node, or -1 when no key ends there
+     */
+    int32_t value(int32_t node) const { return value_[node]; }
+
+    /**
+     * @brief Value of an exact key, or -1
+     */
+    int32_t find(const char* key, size_t size, int32_t node = kRoot) const;
+
+    /**
+     * @brief Number of array slots (memory is 12 bytes per slot)
+     */
+    size_t slots() const { return check_.size(); }
+
+private:
+    std::vector<int32_t> base_;
+    std::vector<int32_t> check_;
+    std::vector<int32_t> value_;
+};
+
+#endif // DOUBLE_ARRAY_TRIE_H
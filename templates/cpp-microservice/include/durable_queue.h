@@ -0,0 +1,266 @@
+#ifndef DURABLE_QUEUE_H
+#define DURABLE_QUEUE_H
+
+#include "timer_wheel.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Durable queue settings
+ */
+struct DurableQueueOptions {
+    std::string directory = "data/forward_queue";
+    size_t segmentBytes = 64u << 20;         // Start a new segment file once the active one is this large
+    bool syncWrites = true;                  // append() returns once its record is fdatasync'd (group commit)
+    uint32_t maxAttempts = 10;               // Deliveries before a message moves to the dead-letter log
+    uint64_t backoffMillis = 1000;           // Wait before the second delivery; doubles with every failure
+    uint64_t maxBackoffMillis = 3600000;     // Longest wait between deliveries
+    size_t offsetInterval = 1024;            // Persist the consumer offset after this many acks
+    size_t maxHeldRetries = 65536;           // Retries held in memory for their backoff; the rest are re-read when due
+};
+
+/**
+ * @brief A queued message, as poll() hands it out
+ */
+struct QueueMessage {
+    uint64_t seq = 0;          // Position in the log; ack() and nack() take it
+    uint64_t createdAt = 0;    // Milliseconds since the epoch of the first append
+    uint32_t attempts = 0;     // Deliveries that failed before this one
+    std::string payload;
+};
+
+/**
+ * @brief Durable queue statistics
+ */
+struct DurableQueueStats {
+    uint64_t backlog = 0;        // Messages appended and not yet acked, retried or dead-lettered
+    size_t inflight = 0;         // Handed out and awaiting ack()
+    size_t waiting = 0;          // Read back for a retry whose backoff has not run out
+    size_t segments = 0;
+    uint64_t segmentBytes = 0;
+    uint64_t appended = 0;
+    uint64_t delivered = 0;
+    uint64_t acked = 0;
+    uint64_t retried = 0;        // nack()s that queued the message again
+    uint64_t deadLetters = 0;    // Messages moved to dead.log after maxAttempts
+    uint64_t syncs = 0;          // fdatasync calls; appended / syncs is the group commit size
+    uint64_t consumerOffset = 0; // Persisted position below which every message is done
+    double openMillis = 0;
+};
+
+/**
+ * @brief Append-only on-disk queue with at-least-once delivery and backoff retries
+ *
+ * Layout of the queue directory:
+ *
+ *   queue-<seq>.log   segment of CRC-checked records, named after its first sequence number
+ *   consumer.offset   sequence number below which every message is done
+ *   dead.log          records of messages that failed maxAttempts times
+ *
+ * Every record holds its sequence number, creation time, attempt count
+ * and a not-before time. Appends write to the active segment; with
+ * syncWrites the appenders waiting at the same time share one fdatasync.
+ *
+ * The consumer reads the log in order from a cursor, so a delivery costs
+ * the same however long the backlog is. A failed delivery (nack) appends
+ * the message again with its attempt count raised and a not-before time
+ * one backoff later, and marks the old record done. When the cursor
+ * reaches a record that is not yet due, it holds it in a timer wheel and
+ * reads on; past maxHeldRetries such records, it keeps only their place
+ * in the log and reads them again once they are due.
+ * The consumer offset is the oldest message not yet done. It is persisted
+ * every offsetInterval acks, after syncing the log, and whole segments
+ * below it are deleted. After a crash the messages between the persisted
+ * offset and the cursor are delivered again.
+ *
+ * All methods are thread-safe.
+ */
+class DurableQueue {
+public:
+    /**
+     * @brief Delivers one message; false to retry it after a backoff
+     */
+    using Sender = std::function<bool(const QueueMessage& message)>;
+
+    /**
+     * @brief Construct a closed DurableQueue object
+     */
+    DurableQueue();
+
+    /**
+     * @brief Destroy the DurableQueue object, stopping delivery and closing it
+     */
+    ~DurableQueue();
+
+    DurableQueue(const DurableQueue&) = delete;
+    DurableQueue& operator=(const DurableQueue&) = delete;
+
+    /**
+     * @brief Open or create the queue, cutting a torn record off the last segment
+     *
+     * @param options Directory and limits
+     * @return true if the queue is ready
+     */
+    bool open(const DurableQueueOptions& options);
+
+    /**
+     * @brief Stop delivery, sync the log and persist the consumer offset
+     */
+    void close();
+
+    /**
+     * @brief Add a message at the tail
+     *
+     * @param payload Message body
+     * @return Its sequence number, or 0 if the write or its sync failed
+     */
+    uint64_t append(const std::string& payload);
+
+    /**
+     * @brief Hand out messages in log order, then retries whose backoff ran out
+     *
+     * @param max Most messages to return
+     * @param nowMillis Milliseconds since the epoch
+     * @param out Receives the messages; each must be acked or nacked
+     * @return Number of messages handed out
+     */
+    size_t poll(size_t max, uint64_t nowMillis, std::vector<QueueMessage>& out);
+
+    /**
+     * @brief Mark a handed-out message delivered
+     *
+     * @return false if @p seq is not awaiting an ack
+     */
+    bool ack(uint64_t seq);
+
+    /**
+     * @brief Mark a handed-out message failed: queue it again after a backoff, or dead-letter it
+     *
+     * If the retry or dead-letter record cannot be written, the message waits
+     * out the backoff in memory instead and is delivered again.
+     *
+     * @return false if @p seq is not awaiting an ack or the log write failed
+     */
+    bool nack(uint64_t seq, uint64_t nowMillis);
+
+    /**
+     * @brief Make every message waiting out a backoff due now
+     *
+     * @return Number of messages made due
+     */
+    size_t retryNow();
+
+    /**
+     * @brief Milliseconds until poll() may return something more
+     *
+     * @return 0 if a message is ready now; -1 if nothing is waiting on a backoff or unread
+     */
+    int64_t waitMillis(uint64_t nowMillis);
+
+    /**
+     * @brief Messages not yet done, oldest first, without handing them out
+     *
+     * @param limit Most messages to return
+     * @param out Receives copies of them
+     */
+    void pending(size_t limit, std::vector<QueueMessage>& out);
+
+    /**
+     * @brief fdatasync the active segment and persist the consumer offset
+     */
+    bool sync();
+
+    /**
+     * @brief Deliver in the background: poll, send each message, ack or nack it
+     *
+     * @param sender Outbound client call; it runs on the delivery thread
+     * @param batch Messages taken per poll
+     */
+    void startDelivery(const Sender& sender, size_t batch = 64);
+
+    /**
+     * @brief Stop the delivery thread once it has sent the batch in hand
+     */
+    void stopDelivery();
+
+    DurableQueueStats stats() const;
+
+    const DurableQueueOptions& options() const { return options_; }
+    bool isOpen() const { return activeFd_ >= 0; }
+
+    /**
+     * @brief Milliseconds since the epoch on the system clock
+     */
+    static uint64_t wallMillis();
+
+private:
+    enum class State : uint8_t { Inflight, Waiting, Done };
+
+    DurableQueueOptions options_;
+    mutable std::mutex mutex_;
+    std::condition_variable syncCv_;       // A group fdatasync finished
+    std::condition_variable deliveryCv_;   // A message was appended or made due, or delivery is stopping
+    std::map<uint64_t, uint64_t> segments_;    // First sequence number -> bytes written
+    int activeFd_;
+    uint64_t activeBase_;
+    uint64_t nextSeq_;
+    uint64_t syncedSeq_;                   // Every record below this is on disk
+    bool syncing_;
+    int deadFd_;
+
+    // A read position in the log; the consumer's, or a copy of it for pending()
+    struct Cursor {
+        int fd = -1;
+        uint64_t base = 0;            // Segment fd has open
+        uint64_t offset = 0;          // Byte offset of the next record in it
+        uint64_t seq = 0;             // Sequence number of that record
+        std::string buffer;
+        uint64_t bufferOffset = 0;    // File offset of buffer[0]
+    };
+
+    Cursor cursor_;
+    uint64_t offset_;                      // Oldest message not yet done
+    uint64_t persistedOffset_;
+    std::deque<State> window_;             // States of offset_ .. cursor_.seq - 1
+    // Where a Waiting message's record starts in the log
+    struct Location {
+        uint64_t base;
+        uint64_t offset;
+    };
+
+    std::unordered_map<uint64_t, QueueMessage> held_;    // Inflight and Waiting messages
+    std::unordered_map<uint64_t, Location> located_;     // Waiting messages past maxHeldRetries, not held
+    std::deque<uint64_t> due_;             // Waiting messages whose backoff ran out
+    TimerWheel wheel_;
+    std::vector<TimerWheel::Timer> fired_;
+    size_t acksSinceOffset_;
+
+    std::thread deliveryThread_;
+    bool deliveryStop_;
+    DurableQueueStats counters_;
+
+    std::string segmentPath(uint64_t base) const;
+    bool openActive(uint64_t base);
+    bool recoverSegment(uint64_t base, uint64_t& nextSeq);
+    uint64_t appendLocked(const QueueMessage& message, uint64_t notBefore, std::unique_lock<std::mutex>& lock);
+    bool syncLocked(uint64_t seq, std::unique_lock<std::mutex>& lock);
+    bool fill(Cursor& cursor, size_t bytes, uint64_t limit);
+    bool readRecord(Cursor& cursor, QueueMessage& message, uint64_t& notBefore);
+    bool copyMessage(uint64_t seq, QueueMessage& message);
+    void closeCursor(Cursor& cursor);
+    void advance(uint64_t nowMillis);
+    int64_t waitLocked(uint64_t nowMillis);
+    void markDone(uint64_t seq, std::unique_lock<std::mutex>& lock);
+    bool persistOffset(std::unique_lock<std::mutex>& lock);
+    void deliveryLoop(Sender sender, size_t batch);
+};
+
+#endif // DURABLE_QUEUE_H
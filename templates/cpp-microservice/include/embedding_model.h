@@ -0,0 +1,124 @@
+#ifndef EMBEDDING_MODEL_H
+#define EMBEDDING_MODEL_H
+
+#include "gemm.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Shape of a BERT-style sentence encoder (defaults: all-MiniLM-L6-v2)
+ */
+struct EmbeddingModelConfig {
+    uint32_t vocabSize = 30522;
+    uint32_t hidden = 384;
+    uint32_t layers = 6;
+    uint32_t heads = 12;
+    uint32_t intermediate = 1536;
+    uint32_t maxPositions = 512;
+    uint32_t typeVocabSize = 2;
+    float layerNormEps = 1e-12f;
+};
+
+/**
+ * @brief BERT encoder with mean pooling, run natively on the CPU
+ *
+ * Weight file layout (little-endian), as written by scripts/export_minilm.py:
+ *
+ *   [64-byte header: "DSEMBED1", u32 version, 7 x u32 config, f32 layer-norm eps]
+ *   fp32 tensors, linear weights in PyTorch [out x in] layout:
+ *     word embeddings [vocab x hidden], position embeddings [maxPositions x hidden],
+ *     token-type embeddings [typeVocab x hidden], embedding LayerNorm gamma, beta
+ *     per layer: query W, b; key W, b; value W, b; attention output W, b;
+ *                attention LayerNorm gamma, beta; intermediate W, b; output W, b;
+ *                output LayerNorm gamma, beta
+ *
+ * The file is mapped read-only. At load, linear layers are packed for the
+ * fp32 kernel or quantized to int8 (per output channel), and Q, K and V are
+ * fused into one GEMM. A batch is run ragged: the sequences' tokens are
+ * concatenated for every GEMM and only attention looks at sequence
+ * boundaries, so no work is spent on padding.
+ */
+class EmbeddingModel {
+public:
+    /**
+     * @brief Construct an empty EmbeddingModel object
+     */
+    EmbeddingModel();
+
+    /**
+     * @brief Load a weight file
+     *
+     * @param path Weight file
+     * @param quantize Run linear layers with int8 weights instead of fp32
+     * @return true if the model was loaded
+     */
+    bool load(const std::string& path, bool quantize);
+
+    /**
+     * @brief Embed a batch of token id sequences
+     *
+     * @param sequences Token ids, [CLS] ... [SEP], each at most maxPositions long
+     * @param out Receives sequences x hidden floats, mean-pooled and L2-normalized
+     * @param pool Worker pool, or nullptr to run on the calling thread
+     * @return true if every id and length was in range
+     */
+    bool embed(const std::vector<std::vector<int32_t>>& sequences, float* out, ThreadPool* pool = nullptr) const;
+
+    /**
+     * @brief Number of floats a weight file holds for a configuration
+     */
+    static size_t parameterCount(const EmbeddingModelConfig& config);
+
+    /**
+     * @brief Write a weight file
+     *
+     * @param path Destination path
+     * @param config Model shape
+     * @param parameters parameterCount(config) floats in file order
+     * @return true if the file was written
+     */
+    static bool write(const std::string& path, const EmbeddingModelConfig& config, const float* parameters);
+
+    const EmbeddingModelConfig& config() const { return config_; }
+    bool isLoaded() const { return file_.isOpen(); }
+    bool quantized() const { return quantized_; }
+
+private:
+    struct Linear {
+        PackedMatrix fp32;
+        QuantizedMatrix int8;
+        const float* bias;
+        std::vector<float> fusedBias;
+    };
+
+    struct Layer {
+        Linear qkv;
+        Linear attentionOutput;
+        const float* attentionNormGamma;
+        const float* attentionNormBeta;
+        Linear intermediate;
+        Linear output;
+        const float* outputNormGamma;
+        const float* outputNormBeta;
+    };
+
+    EmbeddingModelConfig config_;
+    MappedFile file_;
+    bool quantized_;
+    const float* wordEmbeddings_;
+    const float* positionEmbeddings_;
+    const float* typeEmbeddings_;
+    const float* embeddingNormGamma_;
+    const float* embeddingNormBeta_;
+    std::vector<Layer> layers_;
+
+    void prepareLinear(Linear& linear, const float* weights, size_t rows, size_t cols);
+    void applyLinear(const Linear& linear, const float* in, size_t m, float* out, ThreadPool* pool) const;
+    void attention(const float* qkv, const std::vector<size_t>& offsets, float* context, ThreadPool* pool) const;
+};
+
+#endif // EMBEDDING_MODEL_H
@@ -0,0 +1,59 @@
+#ifndef EMBEDDING_SERVICE_H
+#define EMBEDDING_SERVICE_H
+
+#include "http_server.h"
+#include "text_embedder.h"
+#include <map>
+#include <string>
+
+class ConfigManager;
+
+/**
+ * @brief HTTP front-end for native sentence embeddings
+ *
+ * Replaces the ONNX runtime that ChromaDB runs inside the Python vector
+ * store: texts are embedded offline, on the CPU, with the model in
+ * EMBEDDING_MODEL_DIR. Texts arrive as `text` or flattened `texts.<i>`.
+ */
+class EmbeddingService {
+public:
+    /**
+     * @brief Construct a new EmbeddingService object
+     */
+    EmbeddingService();
+
+    /**
+     * @brief Destroy the EmbeddingService object
+     */
+    ~EmbeddingService();
+
+    /**
+     * @brief Load the model using EMBEDDING_* configuration keys
+     *
+     * @param config Loaded configuration
+     * @return true if the model was loaded
+     */
+    bool initialize(const ConfigManager& config);
+
+    /**
+     * @brief Register the embedding routes on a server
+     *
+     * @param server HTTP server
+     */
+    void registerRoutes(HttpServer& server);
+
+    /**
+     * @brief Stop the batcher
+     */
+    void shutdown();
+
+    TextEmbedder& embedder() { return embedder_; }
+
+    std::string handleEmbedText(const std::map<std::string, std::string>& params);
+    std::string handleStats(const std::map<std::string, std::string>& params);
+
+private:
+    TextEmbedder embedder_;
+};
+
+#endif // EMBEDDING_SERVICE_H
@@ -0,0 +1,89 @@
+#ifndef FEED_READER_H
+#define FEED_READER_H
+
+#include "xml_reader.h"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * @brief Provider feed formats FeedReader understands
+ */
+enum class FeedFormat : uint8_t {
+    Unknown,
+    Atom,               // <feed><entry>: arXiv's API
+    Rss,                // <rss><channel><item>: YaCy's yacysearch.rss
+    PubmedSummary,      // <eSummaryResult><DocSum>: E-utilities esummary
+    PubmedArticles,     // <PubmedArticleSet><PubmedArticle>: E-utilities efetch
+};
+
+/**
+ * @brief The fields of one feed entry, as raw views into the document
+ *
+ * Each view is the raw content of the source element (or attribute value),
+ * entities and any nested markup intact; pass it to decodeXmlText to display
+ * it. A field the entry lacks is empty.
+ */
+struct FeedEntry {
+    std::string_view id;        // Atom <id>, RSS <guid>, PubMed id
+    std::string_view title;
+    std::string_view link;      // Atom <link rel="alternate" href>, RSS <link>; PubMed has none
+    std::string_view summary;   // Atom <summary>, RSS <description>, efetch <Abstract>, esummary Source
+    std::string_view date;      // Atom <published> (else <updated>), RSS <pubDate>, PubMed PubDate
+};
+
+/**
+ * @brief One-pass reader for search provider feeds
+ *
+ * Pulls entries out of an arXiv Atom, YaCy RSS or PubMed E-utilities XML
+ * response with an XmlReader, recognising the format from the root element.
+ * Only the few elements that map to FeedEntry fields are looked at, no tree
+ * is built and nothing is copied, so memory stays the same however large
+ * the feed. When a field has several sources (Atom's published and updated),
+ * the preferred one wins wherever it appears in the entry.
+ *
+ * Not thread-safe.
+ */
+class FeedReader {
+public:
+    /**
+     * @brief Construct a new FeedReader object
+     *
+     * @param xml Provider response; must outlive the reader and its entries
+     */
+    explicit FeedReader(std::string_view xml);
+
+    /**
+     * @brief Read the next entry
+     *
+     * @param entry Receives the entry's fields
+     * @return false at the end of the feed, for an unknown format, or on malformed XML (see error())
+     */
+    bool next(FeedEntry& entry);
+
+    /**
+     * @brief The feed's format, known once next() has been called
+     */
+    FeedFormat format() const { return format_; }
+
+    /**
+     * @brief Why reading stopped early, or "" if it did not
+     */
+    const char* error() const { return error_; }
+
+private:
+    std::string_view xml_;
+    XmlReader reader_;
+    FeedFormat format_;
+    const char* error_;
+
+    bool readEntry(size_t depth, FeedEntry& entry);
+    bool fail(const char* message);
+};
+
+/**
+ * @brief Name of a feed format ("atom", "rss", "pubmed_summary", "pubmed_articles", "unknown")
+ */
+const char* feedFormatName(FeedFormat format);
+
+#endif // FEED_READER_H
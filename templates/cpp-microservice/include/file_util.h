@@ -0,0 +1,56 @@
+#ifndef FILE_UTIL_H
+#define FILE_UTIL_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <sys/types.h>
+
+/**
+ * @brief Append a value's bytes to a buffer in host byte order
+ */
+template <typename T>
+void appendRaw(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/**
+ * @brief Read a value stored by appendRaw, at any alignment
+ */
+template <typename T>
+T readRaw(const void* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+/**
+ * @brief Parse a "<prefix><digits><suffix>" file name, e.g. delta-00000003.log
+ *
+ * @param name File name without directory
+ * @param prefix Text before the digits
+ * @param suffix Text after the digits
+ * @param generation Receives the number
+ * @return false if name does not have that shape or its number does not fit 64 bits
+ */
+bool parseGeneration(const std::string& name, const std::string& prefix, const std::string& suffix,
+                     uint64_t& generation);
+
+/**
+ * @brief Write a whole buffer, retrying short writes and EINTR
+ *
+ * @param fd Open file
+ * @param data Bytes to write
+ * @param size Number of bytes
+ * @param offset File offset to write at (pwrite), or -1 for the current one (write)
+ * @return false on the first error
+ */
+bool writeAll(int fd, const char* data, size_t size, off_t offset);
+
+/**
+ * @brief Milliseconds elapsed since start, for timing log lines and stats
+ */
+double millisSince(std::chrono::steady_clock::time_point start);
+
+#endif // FILE_UTIL_H
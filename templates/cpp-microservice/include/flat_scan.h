@@ -0,0 +1,49 @@
+#ifndef FLAT_SCAN_H
+#define FLAT_SCAN_H
+
+#include "hnsw_index.h"
+#include "thread_pool.h"
+#include "vector_distance.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Distances from one query to a block of rows
+ *
+ * Uses AVX2/FMA when the CPU supports it (selected once at runtime, so the
+ * binary stays portable) and a scalar loop otherwise.
+ *
+ * @param metric Distance metric
+ * @param vectors Row-major vector buffer
+ * @param dim Vector dimension
+ * @param query Query vector
+ * @param rows Row ids to score, or nullptr for rows first..first+count-1
+ * @param first First row when @p rows is nullptr, otherwise an index into @p rows
+ * @param count Number of rows
+ * @param out Receives @p count distances
+ */
+void blockDistances(DistanceMetric metric, const float* vectors, uint32_t dim, const float* query,
+                    const uint32_t* rows, size_t first, size_t count, float* out);
+
+/**
+ * @brief Exact k-nearest-neighbour search by scanning every row
+ *
+ * Rows are scored in cache-sized blocks, each thread keeps its own top-k
+ * heap over a contiguous range, and the heaps are merged at the end. For a
+ * few thousand rows this beats a graph search and needs no index.
+ *
+ * @param metric Distance metric
+ * @param vectors Row-major vector buffer
+ * @param dim Vector dimension
+ * @param query Query vector (normalized for cosine)
+ * @param rows Row ids to scan (ascending), or nullptr to scan rows 0..count-1
+ * @param count Number of rows to scan
+ * @param k Number of results
+ * @param pool Worker pool to split large scans across, or nullptr to scan on the calling thread
+ * @return std::vector<SearchHit> Up to k hits ordered by ascending distance
+ */
+std::vector<SearchHit> flatSearch(DistanceMetric metric, const float* vectors, uint32_t dim, const float* query,
+                                  const uint32_t* rows, size_t count, size_t k, ThreadPool* pool = nullptr);
+
+#endif // FLAT_SCAN_H
@@ -0,0 +1,68 @@
+#ifndef FORWARD_QUEUE_SERVICE_H
+#define FORWARD_QUEUE_SERVICE_H
+
+#include "durable_queue.h"
+#include "http_server.h"
+#include <map>
+#include <string>
+#include <string_view>
+
+class ConfigManager;
+
+/**
+ * @brief HTTP front-end for the warehouse forward queue
+ *
+ * Replaces the crawler's pending_forwards table and its 60-second retry
+ * scan. /forward/enqueue takes what _store_pending_forward stores and
+ * keeps the request body as sent, so a lease hands back the same /ingest
+ * body. A sender either runs in-process (queue().startDelivery with the
+ * outbound client call) or leases messages over /forward/lease, posts them
+ * to the warehouse and reports each with /forward/ack. /forward/pending and
+ * /forward/retry answer what /crawl/pending and /crawl/retry-pending do.
+ */
+class ForwardQueueService {
+public:
+    /**
+     * @brief Construct a new ForwardQueueService object
+     */
+    ForwardQueueService();
+
+    /**
+     * @brief Destroy the ForwardQueueService object
+     */
+    ~ForwardQueueService();
+
+    /**
+     * @brief Open the queue using FORWARD_QUEUE_* configuration keys
+     *
+     * @param config Loaded configuration
+     * @return true if the queue was opened
+     */
+    bool initialize(const ConfigManager& config);
+
+    /**
+     * @brief Register the forward queue routes on a server
+     *
+     * @param server HTTP server
+     */
+    void registerRoutes(HttpServer& server);
+
+    /**
+     * @brief Stop delivery and close the queue
+     */
+    void shutdown();
+
+    DurableQueue& queue() { return queue_; }
+
+    std::string handleEnqueue(const std::map<std::string, std::string>& params, std::string_view body);
+    std::string handleLease(const std::map<std::string, std::string>& params);
+    std::string handleAck(const std::map<std::string, std::string>& params);
+    std::string handlePending(const std::map<std::string, std::string>& params);
+    std::string handleRetry(const std::map<std::string, std::string>& params);
+    std::string handleStats(const std::map<std::string, std::string>& params);
+
+private:
+    DurableQueue queue_;
+};
+
+#endif // FORWARD_QUEUE_SERVICE_H
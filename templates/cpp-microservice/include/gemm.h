@@ -0,0 +1,81 @@
+#ifndef GEMM_H
+#define GEMM_H
+
+#include "thread_pool.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief fp32 weight matrix packed for the GEMM micro-kernel
+ *
+ * A linear layer's [N x K] weight (PyTorch layout, one row per output) is
+ * stored as ceil(N / 16) column panels of K x 16 floats, so the kernel
+ * streams each panel sequentially while reusing it across rows of A.
+ */
+struct PackedMatrix {
+    size_t rows;    // N (outputs)
+    size_t cols;    // K (inputs)
+    std::vector<float> panels;
+
+    /**
+     * @brief Pack a row-major [rows x cols] weight matrix
+     */
+    void pack(const float* weights, size_t rows, size_t cols);
+};
+
+/**
+ * @brief int8 weight matrix with one symmetric scale per output row
+ *
+ * Rows are padded with zeros to a multiple of 32 columns. Row sums let the
+ * VNNI kernel, which multiplies unsigned by signed bytes, run on activations
+ * offset by +128 and subtract the offset afterwards.
+ */
+struct QuantizedMatrix {
+    size_t rows;          // N (outputs)
+    size_t cols;          // K (inputs)
+    size_t stride;        // cols rounded up to 32
+    std::vector<int8_t> data;
+    std::vector<float> scales;
+    std::vector<int32_t> rowSums;
+
+    /**
+     * @brief Quantize a row-major [rows x cols] weight matrix
+     */
+    void quantize(const float* weights, size_t rows, size_t cols);
+};
+
+/**
+ * @brief C = A * W^T + bias with fp32 weights
+ *
+ * Uses an AVX2/FMA 4x16 register-blocked kernel when the CPU supports it
+ * (selected once at runtime) and a scalar loop otherwise. Work is split by
+ * column panel across the pool.
+ *
+ * @param a Row-major [m x K] activations
+ * @param m Number of rows of A
+ * @param w Packed [N x K] weights
+ * @param bias N biases, or nullptr
+ * @param c Receives row-major [m x N] outputs
+ * @param pool Worker pool, or nullptr to run on the calling thread
+ */
+void gemm(const float* a, size_t m, const PackedMatrix& w, const float* bias, float* c, ThreadPool* pool = nullptr);
+
+/**
+ * @brief C = A * W^T + bias with int8 weights and dynamically quantized activations
+ *
+ * Each row of A is quantized to int8 with its own symmetric scale, products
+ * are accumulated exactly in int32 and rescaled per output. The kernel is
+ * AVX-512 VNNI (vpdpbusd) when available, else AVX2 maddubs, else scalar.
+ *
+ * @param a Row-major [m x K] activations
+ * @param m Number of rows of A
+ * @param w Quantized [N x K] weights
+ * @param bias N biases, or nullptr
+ * @param c Receives row-major [m x N] outputs
+ * @param pool Worker pool, or nullptr to run on the calling thread
+ */
+void gemmInt8(const float* a, size_t m, const QuantizedMatrix& w, const float* bias, float* c,
+              ThreadPool* pool = nullptr);
+
+#endif // GEMM_H
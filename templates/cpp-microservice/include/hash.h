@@ -0,0 +1,91 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief 128-bit hash value
+ */
+struct Hash128 {
+    uint64_t low;
+    uint64_t high;
+
+    bool operator==(const Hash128& other) const { return low == other.low && high == other.high; }
+    bool operator!=(const Hash128& other) const { return !(*this == other); }
+};
+
+/**
+ * @brief MurmurHash3 (x64, 128-bit) of a byte range
+ *
+ * Fast, well-distributed and stable across platforms with the same
+ * endianness; not cryptographic. Use it for ids, fingerprints and hash
+ * tables, never for anything an attacker must not be able to collide.
+ *
+ * @param data Bytes to hash
+ * @param size Number of bytes
+ * @param seed Seed, for independent hash families
+ * @return Hash128 The hash
+ */
+Hash128 murmurHash3(const void* data, size_t size, uint64_t seed = 0);
+
+/**
+ * @brief 64-bit hash of a byte range (the low half of murmurHash3)
+ */
+inline uint64_t hash64(const void* data, size_t size, uint64_t seed = 0) {
+    return murmurHash3(data, size, seed).low;
+}
+
+/**
+ * @brief 64-bit hash of a string
+ */
+inline uint64_t hash64(std::string_view text, uint64_t seed = 0) {
+    return murmurHash3(text.data(), text.size(), seed).low;
+}
+
+/**
+ * @brief SHA-256 (FIPS 180-4), fed incrementally
+ *
+ * Several times slower than murmurHash3, but collision-resistant: use
+ * it for keys over input a client chooses, such as cache keys over
+ * request bodies. Uses the x86 SHA extensions when the CPU has them.
+ */
+class Sha256 {
+public:
+    static const size_t kDigestSize = 32;
+
+    /**
+     * @brief Construct a new Sha256 object
+     */
+    Sha256();
+
+    /**
+     * @brief Hash more bytes
+     */
+    void update(const void* data, size_t size);
+
+    /**
+     * @brief Write the digest of everything hashed, then start over
+     */
+    void finish(uint8_t digest[kDigestSize]);
+
+    /**
+     * @brief Digest of one byte range
+     */
+    static void hash(const void* data, size_t size, uint8_t digest[kDigestSize]);
+
+private:
+    uint32_t state_[8];
+    uint8_t buffer_[64];
+    size_t buffered_;
+    uint64_t length_;
+};
+
+/**
+ * @brief Lower-case hex encoding of a byte range
+ */
+std::string toHex(const void* data, size_t size);
+
+#endif // HASH_H
@@ -0,0 +1,204 @@
+#ifndef HNSW_INDEX_H
+#define HNSW_INDEX_H
+
+#include "vector_distance.h"
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <vector>
+
+/**
+ * @brief Sentinel row id for "no row"
+ */
+constexpr uint32_t kInvalidRow = std::numeric_limits<uint32_t>::max();
+
+/**
+ * @brief A single nearest-neighbour result
+ */
+struct SearchHit {
+    uint32_t row;
+    float distance;
+};
+
+/**
+ * @brief Read-only view over flat HNSW adjacency arrays
+ *
+ * Every adjacency list is stored as `[degree, n0, n1, ...]` with a fixed
+ * stride, so the arrays can be written to disk as-is and searched straight
+ * out of a memory-mapped segment.
+ */
+struct HnswGraphView {
+    const uint32_t* level0 = nullptr;       // count x (maxDegree0 + 1)
+    const uint8_t* levels = nullptr;        // count
+    const uint64_t* upperOffsets = nullptr; // count + 1, in uint32 units
+    const uint32_t* upper = nullptr;        // per node: level x (maxDegree + 1)
+    uint32_t count = 0;
+    uint32_t maxDegree = 0;
+    uint32_t maxDegree0 = 0;
+    uint32_t entryPoint = kInvalidRow;
+    uint32_t maxLevel = 0;
+
+    bool empty() const { return count == 0 || entryPoint == kInvalidRow; }
+
+    /**
+     * @brief Adjacency list of a node on a level, as `[degree, neighbours...]`
+     */
+    const uint32_t* neighbors(uint32_t node, uint32_t level) const {
+        if (level == 0) {
+            return level0 + static_cast<size_t>(node) * (maxDegree0 + 1);
+        }
+        return upper + upperOffsets[node] + static_cast<size_t>(level - 1) * (maxDegree + 1);
+    }
+};
+
+/**
+ * @brief HNSW construction parameters
+ */
+struct HnswParams {
+    uint32_t m = 16;                // Max neighbours on upper levels (2*m on level 0)
+    uint32_t efConstruction = 200;  // Candidate list size while inserting
+    uint64_t seed = 42;             // Level generator seed, for reproducible builds
+};
+
+/**
+ * @brief Incremental HNSW graph builder
+ *
+ * Vectors are not copied: the builder reads them from a caller-owned,
+ * row-major buffer that must stay valid (and large enough for every row
+ * added) for the builder's lifetime.
+ */
+class HnswBuilder {
+public:
+    /**
+     * @brief Construct a new HnswBuilder object
+     *
+     * @param metric Distance metric
+     * @param dim Vector dimension
+     * @param vectors Row-major vector buffer indexed by row id
+     * @param params Construction parameters
+     */
+    HnswBuilder(DistanceMetric metric, uint32_t dim, const float* vectors, const HnswParams& params = HnswParams());
+
+    /**
+     * @brief Reserve adjacency storage for a number of nodes
+     */
+    void reserve(uint32_t count);
+
+    /**
+     * @brief Seed the graph from an existing one, dropping and renumbering nodes
+     *
+     * Used by compaction so that surviving rows keep their links instead of
+     * the whole graph being rebuilt. Must be called on an empty builder.
+     *
+     * @param graph Existing graph
+     * @param remap Old row -> new row, or kInvalidRow for dropped rows. Surviving
+     *              rows must map onto 0..N-1 without gaps.
+     */
+    void seed(const HnswGraphView& graph, const std::vector<uint32_t>& remap);
+
+    /**
+     * @brief Insert the next row (row ids must be added in order, starting at size())
+     *
+     * @param row Row id of the vector to insert
+     */
+    void add(uint32_t row);
+
+    /**
+     * @brief Number of nodes in the graph
+     */
+    uint32_t size() const { return static_cast<uint32_t>(levels_.size()); }
+
+    /**
+     * @brief Flatten the upper levels into offset/adjacency arrays for serialization
+     *
+     * @param offsets Receives size() + 1 offsets (in uint32 units)
+     * @param upper Receives the concatenated upper-level adjacency lists
+     */
+    void flattenUpper(std::vector<uint64_t>& offsets, std::vector<uint32_t>& upper) const;
+
+    /**
+     * @brief Adjacency list of a node on a level, as `[degree, neighbours...]`
+     */
+    const uint32_t* neighbors(uint32_t node, uint32_t level) const;
+
+    const std::vector<uint32_t>& level0() const { return level0_; }
+    const std::vector<uint8_t>& levels() const { return levels_; }
+    uint32_t maxDegree() const { return m_; }
+    uint32_t maxDegree0() const { return m0_; }
+    uint32_t entryPoint() const { return entry_; }
+    uint32_t maxLevel() const { return maxLevel_; }
+
+private:
+    DistanceMetric metric_;
+    uint32_t dim_;
+    const float* vectors_;
+    uint32_t m_;
+    uint32_t m0_;
+    uint32_t efConstruction_;
+    double levelMult_;
+    std::mt19937_64 rng_;
+
+    std::vector<uint32_t> level0_;
+    std::vector<uint8_t> levels_;
+    std::vector<std::vector<uint32_t>> upper_;
+    uint32_t entry_;
+    uint32_t maxLevel_;
+
+    uint8_t randomLevel();
+    uint32_t* links(uint32_t node, uint32_t level);
+    float distance(uint32_t a, uint32_t b) const;
+    void selectNeighbors(std::vector<SearchHit>& candidates, uint32_t maxCount) const;
+    void connect(uint32_t node, uint32_t level, const std::vector<SearchHit>& neighbors);
+    void addLink(uint32_t node, uint32_t level, uint32_t neighbor);
+    void repair(uint32_t node);
+};
+
+/**
+ * @brief Whether a row may appear in the results, for filtered searches
+ */
+typedef bool (*RowFilterFn)(const void* context, uint32_t row);
+
+/**
+ * @brief k-nearest-neighbour search over an HNSW graph
+ *
+ * With a filter, rejected rows are still traversed (so a selective filter
+ * does not disconnect the graph) but never returned, and the search keeps
+ * going until it has ef accepted rows or runs out of candidates.
+ *
+ * @param graph Graph to search
+ * @param metric Distance metric the graph was built with
+ * @param vectors Row-major vector buffer the graph refers to
+ * @param dim Vector dimension
+ * @param query Query vector (normalized for cosine graphs)
+ * @param k Number of results
+ * @param ef Size of the dynamic candidate list (clamped to at least k)
+ * @param filter Row filter, or nullptr to accept every row
+ * @param filterContext Passed through to @p filter
+ * @return std::vector<SearchHit> Up to k hits ordered by ascending distance
+ */
+std::vector<SearchHit> hnswSearch(const HnswGraphView& graph, DistanceMetric metric, const float* vectors,
+                                  uint32_t dim, const float* query, size_t k, size_t ef,
+                                  RowFilterFn filter = nullptr, const void* filterContext = nullptr);
+
+/**
+ * @brief Distance from the current query to a row, for graphs searched over compressed codes
+ */
+typedef float (*RowDistanceFn)(const void* context, uint32_t row);
+
+/**
+ * @brief k-nearest-neighbour search using a caller-supplied distance
+ *
+ * @param graph Graph to search
+ * @param distance Distance from the query to a row
+ * @param context Passed through to @p distance
+ * @param k Number of results
+ * @param ef Size of the dynamic candidate list (clamped to at least k)
+ * @param filter Row filter, or nullptr to accept every row
+ * @param filterContext Passed through to @p filter
+ * @return std::vector<SearchHit> Up to k hits ordered by ascending distance
+ */
+std::vector<SearchHit> hnswSearch(const HnswGraphView& graph, RowDistanceFn distance, const void* context,
+                                  size_t k, size_t ef, RowFilterFn filter = nullptr,
+                                  const void* filterContext = nullptr);
+
+#endif // HNSW_INDEX_H
@@ -0,0 +1,147 @@
+#ifndef HTML_TO_MARKDOWN_H
+#define HTML_TO_MARKDOWN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Streaming HTML to Markdown converter
+ *
+ * Headings, paragraphs, links, images, emphasis, inline code, pre blocks,
+ * block quotes, nested lists and tables are kept; script, style, template,
+ * svg and similar bodies are skipped along with comments. Whitespace is
+ * collapsed as a browser would outside `<pre>`, and entities are decoded.
+ * Inline code is held until its end tag, so its fence can be one backtick
+ * longer than any run inside it. Other text is escaped so it cannot start a
+ * heading, quote or list item, or form emphasis, links or code. Blocks inside
+ * a link collapse to spaces so the link stays whole.
+ *
+ * Text runs are scanned for `<`, `&` and collapsible whitespace 32 bytes at
+ * a time with AVX2 and copied out whole. HTML may arrive in pieces split
+ * anywhere; only an unfinished tag, entity or end-of-script search window
+ * is carried between pieces, and tags, attribute values, inline code and
+ * the element stack have fixed caps, so memory stays bounded on any input.
+ */
+class HtmlToMarkdown {
+public:
+    /** Tags longer than this are dropped */
+    static const size_t kMaxTagBytes = 16384;
+    /** Elements nested deeper than this are treated as plain inline tags */
+    static const size_t kMaxDepth = 512;
+    /** Inline code longer than this is closed early and the rest written as text */
+    static const size_t kMaxCodeBytes = 16384;
+
+    /**
+     * @brief Construct a new HtmlToMarkdown object
+     */
+    HtmlToMarkdown();
+
+    /**
+     * @brief Convert a whole document
+     *
+     * @param html HTML (UTF-8)
+     * @param markdown Receives the Markdown
+     */
+    void convert(std::string_view html, std::string& markdown);
+
+    /**
+     * @brief Convert the next piece of a document
+     *
+     * @param html Next bytes of the document
+     * @param markdown Markdown for the piece is appended here
+     */
+    void feed(std::string_view html, std::string& markdown);
+
+    /**
+     * @brief End the document, flushing anything pending, and reset
+     *
+     * @param markdown Remaining Markdown is appended here
+     */
+    void finish(std::string& markdown);
+
+    /**
+     * @brief Drop any streamed state
+     */
+    void reset();
+
+    /**
+     * @brief Bytes of input currently carried between pieces
+     */
+    size_t buffered() const { return buffer_.size(); }
+
+private:
+    enum Mode { kText, kRawText, kComment, kSkipTag };
+
+    struct Element {
+        uint8_t tag;
+        uint32_t data;    // List counter for <ol>; whether a link was opened for <a>, or a code span for <code>
+    };
+
+    struct Table {
+        size_t rows;
+        size_t cells;
+        bool rowOpen;
+        bool cellOpen;
+    };
+
+    std::string buffer_;
+    std::string* out_;
+    Mode mode_;
+    uint8_t rawTag_;
+
+    std::vector<Element> stack_;
+    std::vector<std::string> hrefs_;
+    std::vector<Table> tables_;
+    size_t skipDepth_;
+    size_t linkDepth_;
+    size_t quoteDepth_;
+    size_t listDepth_;
+    size_t itemDepth_;
+    size_t headingDepth_;
+    size_t preDepth_;
+
+    // Output state
+    bool hasOutput_;
+    size_t trailingNewlines_;
+    size_t pendingBreaks_;
+    bool pendingSpace_;
+    bool skipPreNewline_;
+    bool lineDigits_;    // The line holds only digits so far: a '.' or ')' next would make it a list item
+    bool linkOpened_;    // Nothing written since "[": space there is dropped
+    std::string pendingMarker_;
+
+    // Inline code is held until it ends, so its fence can outrun any backticks inside
+    bool codeOpen_;
+    bool codeSpaceBefore_;
+    std::string codeText_;
+    std::string tagName_;
+    std::string attrValue_;
+
+    size_t process(std::string_view html, bool final);
+    size_t parseTag(std::string_view html, size_t pos, bool final);
+    size_t parseEntity(std::string_view html, size_t pos, bool final);
+    void openTag(uint8_t tag, std::string_view attributes, bool selfClosing);
+    void closeTag(uint8_t tag);
+    void popElement();
+
+    bool inlineOnly() const { return headingDepth_ > 0 || linkDepth_ > 0 || cellOpen() || codeOpen_; }
+    bool cellOpen() const { return tables_.size() == 1 && tables_.back().cellOpen; }
+    void requestBreak(size_t lines);
+    bool beginContent();
+    void writeText(const char* p, size_t n);
+    void writeEscaped(const char* p, size_t n, bool lineStart);
+    void writeOpening(std::string_view markup);
+    void writeClosing(std::string_view markup);
+    void writeNewline();
+    void writePreNewline();
+    void appendCode(const char* p, size_t n);
+    void flushCode();
+    void writePrefix(bool marker);
+    void closeCell();
+    void closeRow();
+};
+
+#endif // HTML_TO_MARKDOWN_H
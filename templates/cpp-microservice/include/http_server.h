@@ -4,10 +4,13 @@
 #include <string>
 #include <functional>
 #include <map>
+#include <string_view>
 #include <vector>
 
-// Forward declaration
+// Forward declarations
 class Microservice;
+class BufferChain;
+class JsonWriter;
 
 /**
  * @brief Simple HTTP server class
@@ -18,6 +21,11 @@ class HttpServer {
 public:
     // Type aliases for request handlers
     using RequestHandler = std::function<std::string(const std::map<std::string, std::string>& params)>;
+    // Writes its response straight into the connection's output buffer
+    using JsonHandler = std::function<void(const std::map<std::string, std::string>& params, JsonWriter& out)>;
+    // Also gets the request body as sent, for a route that must keep it byte for byte
+    using BodyHandler =
+        std::function<std::string(const std::map<std::string, std::string>& params, std::string_view body)>;
     
     /**
      * @brief Construct a new HttpServer object
@@ -62,6 +70,57 @@ public:
      */
     void post(const std::string& path, const RequestHandler& handler);
 
+    /**
+     * @brief Register a GET route that streams its response with a JsonWriter
+     *
+     * @param path Route path
+     * @param handler Handler function
+     */
+    void getJson(const std::string& path, const JsonHandler& handler);
+
+    /**
+     * @brief Register a POST route that streams its response with a JsonWriter
+     *
+     * @param path Route path
+     * @param handler Handler function
+     */
+    void postJson(const std::string& path, const JsonHandler& handler);
+
+    /**
+     * @brief Register a POST route whose handler also gets the raw request body
+     *
+     * @param path Route path
+     * @param handler Handler function
+     */
+    void postBody(const std::string& path, const BodyHandler& handler);
+
+    /**
+     * @brief Run the handler registered for a request
+     *
+     * A non-empty body is decoded as a JSON object and flattened into the
+     * handler's parameters (see flattenJson).
+     *
+     * @param method "GET" or "POST"
+     * @param path Route path
+     * @param body Request body
+     * @return std::string The handler's response, or a JSON error for an
+     *         unknown route or a body that is not a JSON object
+     */
+    std::string dispatch(const std::string& method, const std::string& path, std::string_view body) const;
+
+    /**
+     * @brief Run the handler registered for a request, appending its response to an output buffer
+     *
+     * Streaming handlers write into out directly; the response of a string
+     * handler is copied in.
+     *
+     * @param method "GET" or "POST"
+     * @param path Route path
+     * @param body Request body
+     * @param out The connection's output buffer
+     */
+    void dispatch(const std::string& method, const std::string& path, std::string_view body, BufferChain& out) const;
+
 private:
     Microservice& service_;
     bool running_;
@@ -69,6 +128,9 @@ private:
     // Route handlers
     std::map<std::string, RequestHandler> get_handlers_;
     std::map<std::string, RequestHandler> post_handlers_;
+    std::map<std::string, JsonHandler> get_json_handlers_;
+    std::map<std::string, JsonHandler> post_json_handlers_;
+    std::map<std::string, BodyHandler> post_body_handlers_;
 };
 
 #endif // HTTP_SERVER_H
\ No newline at end of file
@@ -0,0 +1,246 @@
+#ifndef JSON_PARSER_H
+#define JSON_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class JsonParser;
+
+/**
+ * @brief Type of a JSON value
+ */
+enum class JsonType : uint8_t { Null, Bool, Number, String, Array, Object };
+
+/**
+ * @brief Handle to a value in a parsed document
+ *
+ * Values point into the parser's tape and the parsed text, so they are valid
+ * until the parser parses again or the text goes away. Strings are unescaped
+ * and numbers converted only when asked for. A handle for a missing value
+ * (a failed find or an index past the end) is invalid and converts to false.
+ */
+class JsonValue {
+public:
+    JsonValue() : parser_(nullptr), node_(0) {}
+
+    explicit operator bool() const { return parser_ != nullptr; }
+    JsonType type() const;
+    bool isNull() const { return parser_ && type() == JsonType::Null; }
+
+    /**
+     * @brief The value's text: a number or literal as written, a string's
+     *        contents between the quotes with escapes intact, or a whole
+     *        array or object
+     */
+    std::string_view raw() const;
+
+    /**
+     * @brief A string's contents, unescaped
+     *
+     * @param scratch Holds the unescaped text when the string has escapes
+     * @return std::string_view The contents; points into the document when
+     *         there are no escapes, else into scratch. Empty for non-strings.
+     */
+    std::string_view string(std::string& scratch) const;
+
+    /**
+     * @brief A string's contents, unescaped, as a new string
+     */
+    std::string string() const;
+
+    bool getBool(bool& value) const;
+    bool getDouble(double& value) const;
+
+    /**
+     * @brief A number without fraction or exponent that fits in 64 bits
+     */
+    bool getInt64(int64_t& value) const;
+
+    /**
+     * @brief Number of elements of an array or members of an object, else 0
+     */
+    size_t size() const;
+
+    /**
+     * @brief Element of an array (a linear walk over the earlier elements)
+     */
+    JsonValue operator[](size_t index) const;
+
+    /**
+     * @brief First member of an object with this (unescaped) key
+     */
+    JsonValue find(std::string_view key) const;
+
+    class ArrayIterator;
+    class MemberIterator;
+    template <class Iterator>
+    struct Range {
+        Iterator first;
+        Iterator last;
+        Iterator begin() const { return first; }
+        Iterator end() const { return last; }
+    };
+
+    /**
+     * @brief The elements of an array, for range-for; empty for other types
+     */
+    Range<ArrayIterator> items() const;
+
+    /**
+     * @brief The members of an object, for range-for; empty for other types
+     */
+    Range<MemberIterator> members() const;
+
+private:
+    friend class JsonParser;
+    JsonValue(const JsonParser* parser, uint32_t node) : parser_(parser), node_(node) {}
+
+    const JsonParser* parser_;
+    uint32_t node_;
+};
+
+/**
+ * @brief One member of an object
+ */
+struct JsonMember {
+    JsonValue key;
+    JsonValue value;
+};
+
+/**
+ * @brief Two-stage JSON parser
+ *
+ * Stage 1 classifies the text 64 bytes at a time (AVX2 where available):
+ * quotes, backslashes, structural characters and whitespace become bitmasks,
+ * odd runs of backslashes mark escaped characters, and a prefix XOR over the
+ * unescaped quotes gives the in-string mask. The positions of structural
+ * characters, opening quotes and the first byte of each number or literal
+ * are written to an index. Stage 2 walks only that index, checks the
+ * grammar and builds a tape of nodes holding offsets into the text, with
+ * each container recording where its subtree ends so lookups can skip it.
+ *
+ * The whole document is validated (RFC 8259) except that string bytes are
+ * not checked for well-formed UTF-8; unescaped control characters, bad
+ * escapes and malformed numbers are rejected. Nesting is capped at
+ * kMaxDepth.
+ *
+ * The index and tape are reused across parse calls, so a parser kept per
+ * thread stops allocating once it has seen its largest document. The text
+ * is not copied and must outlive the values.
+ *
+ * Not thread-safe.
+ */
+class JsonParser {
+public:
+    /** Deepest nesting of arrays and objects accepted */
+    static const size_t kMaxDepth = 1024;
+    /** Largest document accepted (offsets are 32-bit) */
+    static const size_t kMaxBytes = 0xFFFFFFF0u;
+
+    /**
+     * @brief Construct a new JsonParser object
+     */
+    JsonParser();
+
+    /**
+     * @brief Parse a document
+     *
+     * @param json UTF-8 JSON text; must stay alive while values are used
+     * @return true if the text is a single valid JSON value
+     */
+    bool parse(std::string_view json);
+
+    /**
+     * @brief The document's root value, or an invalid value if parse failed
+     */
+    JsonValue root() const;
+
+    /**
+     * @brief Why the last parse failed, or "" after a success
+     */
+    const char* error() const { return error_; }
+
+    /**
+     * @brief Byte offset near which the last parse failed
+     */
+    size_t errorOffset() const { return errorOffset_; }
+
+private:
+    friend class JsonValue;
+    friend class JsonValue::ArrayIterator;
+    friend class JsonValue::MemberIterator;
+
+    struct Node {
+        uint32_t offset;    // Start of the value (a string's first byte after the quote)
+        uint32_t length;    // Bytes of the value, set for containers when they close
+        uint32_t next;      // Tape index just past this value's subtree
+        uint32_t count;     // Elements or members of a container
+        JsonType type;
+    };
+
+    std::string_view json_;
+    std::vector<uint32_t> structurals_;
+    size_t structuralCount_;
+    std::vector<Node> tape_;
+    std::vector<uint32_t> stack_;
+    bool valid_;
+    const char* error_;
+    size_t errorOffset_;
+
+    bool indexStructurals();
+    bool buildTape();
+    bool fail(const char* message, size_t offset);
+};
+
+class JsonValue::ArrayIterator {
+public:
+    JsonValue operator*() const { return JsonValue(parser_, node_); }
+    ArrayIterator& operator++();
+    bool operator!=(const ArrayIterator& other) const { return node_ != other.node_; }
+
+private:
+    friend class JsonValue;
+    ArrayIterator(const JsonParser* parser, uint32_t node) : parser_(parser), node_(node) {}
+
+    const JsonParser* parser_;
+    uint32_t node_;
+};
+
+class JsonValue::MemberIterator {
+public:
+    JsonMember operator*() const { return JsonMember{JsonValue(parser_, node_), JsonValue(parser_, node_ + 1)}; }
+    MemberIterator& operator++();
+    bool operator!=(const MemberIterator& other) const { return node_ != other.node_; }
+
+private:
+    friend class JsonValue;
+    MemberIterator(const JsonParser* parser, uint32_t node) : parser_(parser), node_(node) {}
+
+    const JsonParser* parser_;
+    uint32_t node_;
+};
+
+/**
+ * @brief Decode a JSON request body into flattened handler parameters
+ *
+ * The body must be an object. Nested members are named with dots:
+ * {"documents": [{"text": "a", "metadata": {"k": 1}}]} gives documents.0.text
+ * and documents.0.metadata.k. Strings are unescaped, numbers kept as
+ * written, and booleans become "true" or "false". An array of numbers
+ * becomes one comma-separated value under its own name (the form vector
+ * parameters take); one mixing numbers with anything else, nulls included,
+ * is rejected, so a key's form never depends on its elements. Nulls and
+ * empty arrays and objects are omitted.
+ *
+ * @param body Request body
+ * @param params Receives the parameters; existing entries are kept unless overwritten
+ * @param error Receives why the body was rejected, if not null
+ * @return false if the body is not a valid JSON object or mixes numbers into an array
+ */
+bool flattenJson(std::string_view body, std::map<std::string, std::string>& params, std::string* error = nullptr);
+
+#endif // JSON_PARSER_H
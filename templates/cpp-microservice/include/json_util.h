@@ -0,0 +1,77 @@
+#ifndef JSON_UTIL_H
+#define JSON_UTIL_H
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Indexes of flattened array parameters (texts.<i>) run below this unless a service configures its own
+ */
+const size_t kMaxParamIndex = 10000;
+
+/**
+ * @brief Length of the prefix of a string that can go into a JSON string literal as is
+ *
+ * Stops at the first quote, backslash or control character (AVX2 where available).
+ *
+ * @param data Raw UTF-8 bytes
+ * @param size Number of bytes
+ * @return size_t Offset of the first byte needing an escape, or size
+ */
+size_t jsonSafeLength(const char* data, size_t size);
+
+/**
+ * @brief Write the escape sequence for a byte jsonSafeLength stopped at
+ *
+ * @param c A quote, backslash or control character
+ * @param out Receives 2 or 6 bytes
+ * @return size_t Bytes written
+ */
+size_t jsonEscape(char c, char* out);
+
+/**
+ * @brief Append a JSON string literal (quoted and escaped) to a buffer
+ *
+ * @param out Buffer to append to
+ * @param value Raw UTF-8 string
+ */
+void appendJsonString(std::string& out, std::string_view value);
+
+/**
+ * @brief Append a JSON number to a buffer (non-finite values become null)
+ *
+ * Writes the shortest form that parses back to the same double.
+ *
+ * @param out Buffer to append to
+ * @param value Number to write
+ */
+void appendJsonNumber(std::string& out, double value);
+
+/**
+ * @brief Parse the index of a flattened array parameter, e.g. the 3 of texts.3
+ *
+ * @param digits The index as it appears in the parameter name
+ * @param limit Indexes must be below this
+ * @param index Receives the index
+ * @return false unless digits is a whole decimal number below limit
+ */
+bool parseParamIndex(std::string_view digits, size_t limit, size_t& index);
+
+/**
+ * @brief Collect <prefix><i> parameters in index order
+ *
+ * Names with anything but digits after the prefix are not array elements and
+ * are skipped.
+ *
+ * @param params Flattened request parameters
+ * @param prefix e.g. "texts."
+ * @param limit Indexes must be below this
+ * @param values Receives the values by index; they point into params
+ * @return false on an index of limit or more
+ */
+bool indexedParams(const std::map<std::string, std::string>& params, const std::string& prefix, size_t limit,
+                   std::map<size_t, std::string_view>& values);
+
+#endif // JSON_UTIL_H
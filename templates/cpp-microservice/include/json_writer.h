@@ -0,0 +1,236 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include "buffer_chain.h"
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <optional>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief One serialized member of a struct: its JSON name and member pointer
+ */
+template <class T, class M>
+struct JsonField {
+    std::string_view name;
+    M T::*member;
+};
+
+template <class T, class M>
+constexpr JsonField<T, M> jsonField(std::string_view name, M T::*member) {
+    return JsonField<T, M>{name, member};
+}
+
+/**
+ * @brief Describes how a struct is written as a JSON object
+ *
+ * Specialize with a tuple of fields, written in order:
+ *
+ *     template <>
+ *     struct JsonFields<SearchResult> {
+ *         static constexpr auto fields = std::make_tuple(jsonField("url", &SearchResult::url),
+ *                                                        jsonField("score", &SearchResult::score));
+ *     };
+ *
+ * A class with private members declares the specialization a friend.
+ */
+template <class T>
+struct JsonFields {};
+
+template <class T, class = void>
+struct HasJsonFields : std::false_type {};
+
+template <class T>
+struct HasJsonFields<T, std::void_t<decltype(JsonFields<T>::fields)>> : std::true_type {};
+
+/**
+ * @brief Streaming JSON writer that appends to a BufferChain
+ *
+ * Values are written straight into the output buffer: strings are escaped a
+ * run at a time (the runs needing no escape found with AVX2 where available),
+ * numbers formatted with std::to_chars, and commas placed automatically.
+ * Nothing is allocated beyond the buffer's own blocks, so with a reused
+ * buffer a whole response is written without allocating.
+ *
+ * write() serializes strings, numbers, booleans, std::optional (null when
+ * empty), sequences as arrays, maps with string keys as objects, and any
+ * struct with a JsonFields specialization as an object. The layout matches
+ * the service's hand-written responses: {"a": 1, "b": [2, 3]}.
+ *
+ * One writer writes one document. It does not check that the calls form a
+ * valid one.
+ */
+class JsonWriter {
+public:
+    /**
+     * @brief Construct a new JsonWriter object
+     *
+     * @param out Buffer to append to; must outlive the writer
+     */
+    explicit JsonWriter(BufferChain& out) : out_(out), comma_(false) {}
+
+    void beginObject() { open('{'); }
+    void endObject() { close('}'); }
+    void beginArray() { open('['); }
+    void endArray() { close(']'); }
+
+    /**
+     * @brief Write an object member's name; the next value is its value
+     */
+    void key(std::string_view name) {
+        separate();
+        quoted(name);
+        out_.append(": ", 2);
+        comma_ = false;
+    }
+
+    void string(std::string_view value) {
+        separate();
+        quoted(value);
+        comma_ = true;
+    }
+
+    void boolean(bool value) {
+        separate();
+        if (value) {
+            out_.append("true", 4);
+        } else {
+            out_.append("false", 5);
+        }
+        comma_ = true;
+    }
+
+    void null() {
+        separate();
+        out_.append("null", 4);
+        comma_ = true;
+    }
+
+    /**
+     * @brief Write a number in its shortest round-trip form (non-finite values become null)
+     */
+    void number(double value);
+    void integer(int64_t value);
+    void unsignedInteger(uint64_t value);
+
+    /**
+     * @brief Write already encoded JSON as one value
+     */
+    void raw(std::string_view json) {
+        separate();
+        out_.append(json);
+        comma_ = true;
+    }
+
+    /**
+     * @brief Write a value of any supported type (see the class comment)
+     */
+    template <class T>
+    void write(const T& value);
+
+    /**
+     * @brief Write an object member
+     */
+    template <class T>
+    void member(std::string_view name, const T& value) {
+        key(name);
+        write(value);
+    }
+
+private:
+    BufferChain& out_;
+    bool comma_;    // A value was just completed, so the next one needs a separator
+
+    void separate() {
+        if (comma_) {
+            out_.append(", ", 2);
+        }
+    }
+
+    void open(char c) {
+        separate();
+        out_.push(c);
+        comma_ = false;
+    }
+
+    void close(char c) {
+        out_.push(c);
+        comma_ = true;
+    }
+
+    void quoted(std::string_view value);
+};
+
+namespace json_writer_detail {
+
+template <class T, class = void>
+struct IsSequence : std::false_type {};
+
+template <class T>
+struct IsSequence<T, std::void_t<decltype(std::begin(std::declval<const T&>())),
+                                 decltype(std::end(std::declval<const T&>()))>> : std::true_type {};
+
+template <class T, class = void>
+struct IsStringMap : std::false_type {};
+
+template <class T>
+struct IsStringMap<T, std::void_t<typename T::key_type, typename T::mapped_type>>
+    : std::is_convertible<const typename T::key_type&, std::string_view> {};
+
+template <class T>
+struct IsOptional : std::false_type {};
+
+template <class T>
+struct IsOptional<std::optional<T>> : std::true_type {};
+
+template <class T>
+struct Unsupported : std::false_type {};
+
+} // namespace json_writer_detail
+
+template <class T>
+void JsonWriter::write(const T& value) {
+    using namespace json_writer_detail;
+    if constexpr (std::is_same<T, bool>::value) {
+        boolean(value);
+    } else if constexpr (std::is_integral<T>::value && std::is_signed<T>::value) {
+        integer(static_cast<int64_t>(value));
+    } else if constexpr (std::is_integral<T>::value) {
+        unsignedInteger(static_cast<uint64_t>(value));
+    } else if constexpr (std::is_floating_point<T>::value) {
+        number(static_cast<double>(value));
+    } else if constexpr (std::is_convertible<const T&, std::string_view>::value) {
+        string(std::string_view(value));
+    } else if constexpr (HasJsonFields<T>::value) {
+        beginObject();
+        std::apply([&](const auto&... field) { (member(field.name, value.*(field.member)), ...); },
+                   JsonFields<T>::fields);
+        endObject();
+    } else if constexpr (IsOptional<T>::value) {
+        if (value) {
+            write(*value);
+        } else {
+            null();
+        }
+    } else if constexpr (IsStringMap<T>::value) {
+        beginObject();
+        for (const auto& entry : value) {
+            member(entry.first, entry.second);
+        }
+        endObject();
+    } else if constexpr (IsSequence<T>::value) {
+        beginArray();
+        for (const auto& element : value) {
+            write(element);
+        }
+        endArray();
+    } else {
+        static_assert(Unsupported<T>::value, "no JSON representation; specialize JsonFields");
+    }
+}
+
+#endif // JSON_WRITER_H
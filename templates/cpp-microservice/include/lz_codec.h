@@ -0,0 +1,98 @@
+#ifndef LZ_CODEC_H
+#define LZ_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Shared history for compressing many small, similar records
+ *
+ * Compressing with a dictionary behaves as if its bytes came right before
+ * the input, so a record's first sentences can already match text that the
+ * dictionary holds (site navigation, headings, boilerplate). Pages of one
+ * site repeat much of each other, but every record is compressed on its own
+ * for random access. Without a dictionary each would start from nothing.
+ *
+ * Matches reach back at most 65535 bytes, so a dictionary is capped at
+ * kMaxSize and its most useful content is placed at the end.
+ */
+class LzDictionary {
+public:
+    static constexpr size_t kMaxSize = 48 << 10;
+
+    /**
+     * @brief Construct an empty dictionary (compression without one)
+     */
+    LzDictionary();
+
+    /**
+     * @brief Wrap trained or stored dictionary bytes
+     *
+     * @param bytes Dictionary content; only the last kMaxSize bytes are used
+     */
+    explicit LzDictionary(std::string bytes);
+
+    /**
+     * @brief Train a dictionary from sample records
+     *
+     * A simplified COVER selection (as in zstd's trainer). Samples are cut
+     * into epochs. From each epoch it takes the segment whose 8-byte
+     * substrings occur in the most samples. Those substrings then stop
+     * counting, so later segments add new content. The first pick ends up
+     * last in the dictionary.
+     *
+     * @param samples Records typical of what will be compressed
+     * @param maxBytes Dictionary size (at most kMaxSize)
+     * @return The dictionary; empty if the samples share nothing
+     */
+    static LzDictionary train(const std::vector<std::string_view>& samples, size_t maxBytes);
+
+    const std::string& bytes() const { return bytes_; }
+    size_t size() const { return bytes_.size(); }
+    bool empty() const { return bytes_.empty(); }
+
+private:
+    friend void lzCompress(const char* data, size_t size, std::string& out, const LzDictionary* dictionary);
+
+    std::string bytes_;
+    std::vector<uint32_t> table_;    // Match finder state after hashing the dictionary
+};
+
+/**
+ * @brief Compress a buffer into one LZ77 block (LZ4 block layout)
+ *
+ * A block is a run of sequences: a token byte (literal count in the high
+ * nibble, match length - 4 in the low one, 15 meaning "more length bytes
+ * follow, 255 at a time"), the literals, then a 16-bit little-endian match
+ * offset back into the output. The last sequence has literals only. Matches
+ * are found through a hash of the next 4 bytes, so compression runs at
+ * several hundred MB/s and decompression at GB/s, trading ratio for the
+ * speed a cache read path needs.
+ *
+ * @param data Bytes to compress
+ * @param size Number of bytes
+ * @param out Buffer the block is appended to
+ * @param dictionary Optional dictionary; the block then only decodes with the same one
+ */
+void lzCompress(const char* data, size_t size, std::string& out, const LzDictionary* dictionary = nullptr);
+
+/**
+ * @brief Decompress a block produced by lzCompress
+ *
+ * Every length and offset is bounds-checked, so a corrupt block fails
+ * rather than reading or writing outside the buffers.
+ *
+ * @param block Compressed block
+ * @param size Bytes in the block
+ * @param out Destination of exactly @p outSize bytes
+ * @param outSize Uncompressed size, recorded by the caller
+ * @param dictionary Dictionary the block was compressed with, if any
+ * @return false if the block is corrupt or does not decode to exactly outSize bytes
+ */
+bool lzDecompress(const uint8_t* block, size_t size, char* out, size_t outSize,
+                  const LzDictionary* dictionary = nullptr);
+
+#endif // LZ_CODEC_H
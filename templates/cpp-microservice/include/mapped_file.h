@@ -0,0 +1,88 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Read-only memory mapping of a file
+ *
+ * The mapping is shared, so every process that maps the same file shares
+ * one copy in the OS page cache. Pages are faulted in lazily on first access.
+ */
+class MappedFile {
+public:
+    /**
+     * @brief Construct an empty (unmapped) MappedFile object
+     */
+    MappedFile();
+
+    /**
+     * @brief Destroy the MappedFile object and unmap the file
+     */
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    /**
+     * @brief Map a file read-only
+     *
+     * @param path Path of the file to map
+     * @return true if the file was mapped
+     * @return false if the file could not be opened or mapped
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief Unmap the file
+     */
+    void close();
+
+    /**
+     * @brief Hint the kernel about the expected access pattern
+     *
+     * @param random true for random access (graph traversal), false for sequential scans
+     */
+    void adviseRandom(bool random) const;
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool isOpen() const { return data_ != nullptr; }
+    const std::string& path() const { return path_; }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    std::string path_;
+};
+
+/**
+ * @brief Flush a file's data to stable storage
+ *
+ * @param path File path
+ * @return true if fsync succeeded
+ */
+bool syncFile(const std::string& path);
+
+/**
+ * @brief Flush a directory entry table to stable storage (after a rename)
+ *
+ * @param dir Directory path
+ * @return true if fsync succeeded
+ */
+bool syncDirectory(const std::string& dir);
+
+/**
+ * @brief Atomically replace a small file with new contents (write, fsync, rename)
+ *
+ * @param path Destination path
+ * @param contents New file contents
+ * @return true if the file was replaced
+ */
+bool writeFileAtomic(const std::string& path, const std::string& contents);
+
+#endif // MAPPED_FILE_H
@@ -0,0 +1,116 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+/**
+ * @brief Bounded lock-free multi-producer, single-consumer ring buffer
+ *
+ * Each cell carries a sequence number (Vyukov's bounded queue): producers
+ * claim a slot with one CAS on the enqueue position and publish it by
+ * bumping the cell's sequence, so a slow producer never blocks the others
+ * and items are popped strictly in claim order. That order is exposed as a
+ * ticket, which callers can use as a monotonically increasing write
+ * position.
+ */
+template <typename T>
+class MpscQueue {
+public:
+    /**
+     * @brief Construct a new MpscQueue object
+     *
+     * @param capacity Maximum number of queued items (rounded up to a power of two)
+     */
+    explicit MpscQueue(size_t capacity) : dequeuePos_(0) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        mask_ = size - 1;
+        cells_.reset(new Cell[size]);
+        for (size_t i = 0; i < size; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueuePos_.store(0, std::memory_order_relaxed);
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    /**
+     * @brief Enqueue an item unless the queue is full
+     *
+     * @param value Item to move into the queue
+     * @param ticket Receives the item's position in the queue's total order
+     * @return true if the item was queued
+     */
+    bool tryPush(T&& value, uint64_t* ticket = nullptr) {
+        uint64_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells_[pos & mask_];
+            uint64_t sequence = cell.sequence.load(std::memory_order_acquire);
+            int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    if (ticket) {
+                        *ticket = pos;
+                    }
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Dequeue the next item (consumer thread only)
+     *
+     * @param value Receives the item
+     * @return true if an item was available
+     */
+    bool tryPop(T& value) {
+        Cell& cell = cells_[dequeuePos_ & mask_];
+        uint64_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if (static_cast<int64_t>(sequence) - static_cast<int64_t>(dequeuePos_ + 1) < 0) {
+            return false;
+        }
+        value = std::move(cell.value);
+        cell.sequence.store(dequeuePos_ + mask_ + 1, std::memory_order_release);
+        ++dequeuePos_;
+        return true;
+    }
+
+    /**
+     * @brief Tickets below this have been popped (consumer thread only)
+     */
+    uint64_t dequeuePosition() const { return dequeuePos_; }
+
+    /**
+     * @brief Tickets below this have been claimed by producers
+     */
+    uint64_t enqueuePosition() const { return enqueuePos_.load(std::memory_order_relaxed); }
+
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct Cell {
+        std::atomic<uint64_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    alignas(64) std::atomic<uint64_t> enqueuePos_;
+    alignas(64) uint64_t dequeuePos_;
+};
+
+#endif // MPSC_QUEUE_H
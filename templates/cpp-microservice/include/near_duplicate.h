@@ -0,0 +1,144 @@
+#ifndef NEAR_DUPLICATE_H
+#define NEAR_DUPLICATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Near-duplicate detection settings
+ */
+struct NearDuplicateOptions {
+    size_t shingleWords = 4;        // Words per shingle
+    size_t bands = 16;              // LSH bands
+    size_t rows = 6;                // MinHash values per band
+    double threshold = 0.8;         // Estimated Jaccard similarity at which two texts are duplicates
+    size_t simhashDistance = 3;     // SimHash Hamming distance at which two texts are duplicates (at most 3)
+    size_t capacity = 100000;       // Texts an index remembers before dropping the oldest
+};
+
+/**
+ * @brief Fingerprints of one text
+ */
+struct DocumentSignature {
+    uint64_t simhash = 0;               // Charikar SimHash over shingle occurrences
+    std::vector<uint32_t> minhash;      // bands * rows MinHash values over word shingles
+    size_t shingles = 0;                // 0 for a text without words
+};
+
+/**
+ * @brief SimHash and MinHash near-duplicate detector with an LSH index
+ *
+ * Texts are lower-cased and split into Unicode words. Word shingles feed a
+ * MinHash signature, computed 8 hash functions at a time with AVX2, and a
+ * 64-bit SimHash weighted by how often each shingle occurs. Two texts are near-duplicates when
+ * their estimated shingle Jaccard similarity reaches the threshold, or when
+ * their SimHashes differ in at most simhashDistance bits.
+ *
+ * Candidates come from one open-addressing table holding a key per LSH
+ * band plus a key per 16-bit SimHash block, so a lookup touches bands + 4
+ * probe runs rather than every stored text. Stored texts keep one byte per
+ * MinHash value (b-bit MinHash) and the SimHash, and the oldest are dropped
+ * past the capacity, so memory is sized once, on the first add.
+ *
+ * Not thread-safe.
+ */
+class NearDuplicateIndex {
+public:
+    /** Returned by find when there is no near-duplicate */
+    static const uint64_t kNotFound = ~0ULL;
+
+    /**
+     * @brief Construct a new NearDuplicateIndex object
+     */
+    explicit NearDuplicateIndex(const NearDuplicateOptions& options = NearDuplicateOptions());
+
+    /**
+     * @brief Compute the fingerprints of a text
+     *
+     * @param text UTF-8 text
+     * @param signature Receives the fingerprints
+     */
+    void sign(std::string_view text, DocumentSignature& signature) const;
+
+    /**
+     * @brief Find a stored near-duplicate
+     *
+     * @param signature Fingerprints of the text to look up
+     * @return uint64_t Number (from add) of the oldest matching text still stored,
+     *                  or kNotFound
+     */
+    uint64_t find(const DocumentSignature& signature) const;
+
+    /**
+     * @brief Store a text's fingerprints
+     *
+     * @param signature Fingerprints from sign
+     * @return uint64_t The text's number: 0 for the first text added, then 1, 2...
+     */
+    uint64_t add(const DocumentSignature& signature);
+
+    /**
+     * @brief Group a batch of texts into near-duplicate clusters
+     *
+     * Texts are taken in order; each joins the cluster of the first earlier
+     * text it nearly duplicates. Uses a scratch index, not this one.
+     *
+     * @param texts UTF-8 texts
+     * @param clusters Receives, for each text, the index of its cluster's first text
+     */
+    void cluster(const std::vector<std::string_view>& texts, std::vector<size_t>& clusters) const;
+
+    /**
+     * @brief Group texts already signed by this index into clusters
+     *
+     * @param signatures Fingerprints from sign, in order
+     * @param clusters Receives, for each text, the index of its cluster's first text
+     */
+    void cluster(const std::vector<DocumentSignature>& signatures, std::vector<size_t>& clusters) const;
+
+    /**
+     * @brief Estimated Jaccard similarity of two signatures' shingle sets
+     */
+    static double similarity(const DocumentSignature& a, const DocumentSignature& b);
+
+    /**
+     * @brief Number of texts currently stored
+     */
+    size_t size() const;
+
+    /**
+     * @brief Drop all stored texts
+     */
+    void clear();
+
+    const NearDuplicateOptions& options() const { return options_; }
+
+private:
+    struct Slot {
+        uint32_t key;
+        uint32_t entry;    // kEmpty when free
+    };
+
+    NearDuplicateOptions options_;
+    std::vector<uint32_t> seeds_;
+    size_t hashes_;
+    size_t keysPerEntry_;
+
+    // Stored texts, in a ring of capacity entries
+    std::vector<uint8_t> minhashBytes_;
+    std::vector<uint64_t> simhashes_;
+    std::vector<uint32_t> keys_;
+    uint64_t added_;
+
+    std::vector<Slot> table_;
+    size_t mask_;
+
+    void computeKeys(const DocumentSignature& signature, uint32_t* keys) const;
+    bool matches(const DocumentSignature& signature, size_t entry) const;
+    void insertKey(uint32_t key, uint32_t entry);
+    void eraseKey(uint32_t key, uint32_t entry);
+};
+
+#endif // NEAR_DUPLICATE_H
@@ -0,0 +1,83 @@
+#ifndef PATTERN_AUTOMATON_H
+#define PATTERN_AUTOMATON_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief A set of anchored regular expressions compiled into one DFA
+ *
+ * Patterns use the subset of Python `re` syntax that line filters need:
+ * literals and `\\` escapes, `.`, `\\s` `\\d` `\\w` (and negations), bracket
+ * sets with ranges and `^`, groups with `|`, the quantifiers `*` `+` `?`
+ * (lazy forms behave the same, since only a yes/no answer is wanted), `$`,
+ * and `\\b` as the last item of a pattern. Every pattern is anchored at the
+ * start of the text, as re.match (or re.search with a leading `^`) does.
+ *
+ * Code points are mapped to a small alphabet: one symbol per distinct
+ * literal and a few for everything else (digits, other word characters,
+ * whitespace, newline, the rest), with the Unicode classes Python uses.
+ * The union of all patterns then runs as a single DFA over that alphabet,
+ * stopping at the first accepting or dead state, so a line that cannot
+ * match costs one or two table lookups.
+ */
+class PatternAutomaton {
+public:
+    enum CaseMode {
+        kExactCase,    // Literals match themselves only
+        kIgnoreCase,   // As re.IGNORECASE, including the Kelvin sign, long s and dotted/dotless i
+        kLowerCase     // Text is compared after str.lower(), as `text.lower() == literal`
+    };
+
+    /**
+     * @brief Construct an automaton that matches nothing
+     */
+    PatternAutomaton();
+
+    /**
+     * @brief Compile a set of patterns
+     *
+     * @param patterns Python-style regular expressions
+     * @param mode How letter case is matched
+     * @return true if every pattern was understood
+     */
+    bool compile(const std::vector<std::string>& patterns, CaseMode mode = kExactCase);
+
+    /**
+     * @brief Whether any pattern matches at the start of text
+     */
+    bool matches(std::string_view text) const;
+
+    /**
+     * @brief Number of DFA states (the dead state included)
+     */
+    size_t states() const { return accepting_.size(); }
+
+    /**
+     * @brief Size of the input alphabet (the end-of-text symbol included)
+     */
+    size_t symbols() const { return symbolCount_; }
+
+private:
+    CaseMode mode_;
+    size_t symbolCount_;
+    uint16_t asciiSymbols_[128];
+    // Non-ASCII literals, sorted by (case-folded) code point
+    std::vector<std::pair<uint32_t, uint16_t>> wideSymbols_;
+    uint16_t digitSymbol_;
+    uint16_t wordSymbol_;
+    uint16_t spaceSymbol_;
+    uint16_t otherSymbol_;
+    uint16_t endSymbol_;
+    std::vector<int32_t> transitions_;    // state * symbolCount_ + symbol
+    std::vector<uint8_t> accepting_;
+
+    uint32_t fold(uint32_t cp) const;
+    uint16_t symbolOf(uint32_t cp) const;
+};
+
+#endif // PATTERN_AUTOMATON_H
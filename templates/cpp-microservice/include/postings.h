@@ -0,0 +1,122 @@
+#ifndef POSTINGS_H
+#define POSTINGS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/** Documents per postings block; every block but a term's last holds exactly this many */
+constexpr uint32_t kPostingBlockSize = 128;
+
+/**
+ * @brief Skip entry of one postings block
+ *
+ * maxFreq and minLength bound every document in the block, which is all a
+ * BM25 upper bound needs: the score grows with the frequency and shrinks
+ * with the document length, so scoring (maxFreq, minLength) can only
+ * overestimate. The bound stays valid whatever the collection statistics
+ * are when the query runs.
+ */
+struct PostingBlock {
+    uint32_t lastDoc;      // Highest document in the block
+    uint32_t offset;       // Byte offset of the encoded block after the skip table
+    uint32_t maxFreq;      // Highest term frequency in the block
+    uint32_t minLength;    // Shortest document in the block
+};
+
+/**
+ * @brief Bounds over a whole postings list, for the term directory
+ */
+struct PostingSummary {
+    uint32_t docFreq;
+    uint32_t maxFreq;
+    uint32_t minLength;
+};
+
+/**
+ * @brief Encode one term's postings
+ *
+ * Layout: a skip table of ceil(n / kPostingBlockSize) PostingBlock entries,
+ * then the blocks. A full block stores its document gaps and frequencies
+ * bit-packed at the width of their largest value ([u8 gap bits][u8 freq
+ * bits][128 gaps][128 freqs], the BP128 layout); the last, partial block
+ * stores (gap, freq) pairs as varints. Gaps are `doc - previous - 1` and
+ * frequencies `freq - 1`, so runs of consecutive documents seen once pack
+ * to zero bits.
+ *
+ * @param docs Ascending document numbers
+ * @param freqs Term frequency of each document (at least 1)
+ * @param n Number of postings
+ * @param lengths Length of every document, indexed by document number
+ * @param out Buffer to append to; the skip table starts 4-byte aligned
+ *            relative to out's start
+ * @param summary Receives the list's bounds
+ */
+void encodePostings(const uint32_t* docs, const uint32_t* freqs, size_t n, const uint32_t* lengths,
+                    std::string& out, PostingSummary& summary);
+
+/**
+ * @brief Reads a postings list written by encodePostings
+ *
+ * Blocks are decoded one at a time into a small buffer the first time a
+ * document in them is needed; advance() and shallowAdvance() consult the
+ * skip table first, so blocks that cannot contain a candidate are never
+ * decoded.
+ */
+class PostingCursor {
+public:
+    /** doc() once the list is exhausted */
+    static constexpr uint32_t kEnd = UINT32_MAX;
+
+    /**
+     * @brief Construct an exhausted PostingCursor object
+     */
+    PostingCursor();
+
+    /**
+     * @brief Position on the first document of a list
+     *
+     * @param postings Start of the list (its skip table), in mapped segment memory
+     * @param docFreq Number of postings
+     */
+    void reset(const uint8_t* postings, uint32_t docFreq);
+
+    uint32_t doc() const { return doc_; }
+    uint32_t freq() const { return freqs_[pos_]; }
+    uint32_t docFreq() const { return docFreq_; }
+
+    /**
+     * @brief Move to the next document
+     */
+    void next();
+
+    /**
+     * @brief Move to the first document >= target
+     */
+    void advance(uint32_t target);
+
+    /**
+     * @brief Find the block that would hold target without decoding it
+     *
+     * @param target Document number; must not be below the current block
+     * @return The block, or nullptr when every document is below target
+     */
+    const PostingBlock* shallowAdvance(uint32_t target);
+
+private:
+    const PostingBlock* blocks_;
+    const uint8_t* data_;
+    uint32_t blockCount_;
+    uint32_t docFreq_;
+    uint32_t block_;       // Decoded block
+    uint32_t shallow_;     // Block found by the last shallowAdvance
+    uint32_t pos_;
+    uint32_t count_;       // Documents in the decoded block
+    uint32_t doc_;
+    uint32_t docs_[kPostingBlockSize];
+    uint32_t freqs_[kPostingBlockSize];
+
+    void decode(uint32_t block);
+};
+
+#endif // POSTINGS_H
@@ -0,0 +1,183 @@
+#ifndef QUANTIZATION_H
+#define QUANTIZATION_H
+
+#include "vector_distance.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Compressed vector encodings supported by the vector index
+ */
+enum class QuantizerType : uint32_t {
+    None = 0,
+    Scalar8 = 1,   // One byte per dimension, per-dimension min/step (4x smaller)
+    Product = 2    // One byte per subspace, 256 trained centroids each (dim/subspaces * 4 x smaller)
+};
+
+/**
+ * @brief Parse a quantizer name ("none", "sq8", "pq")
+ *
+ * @param name Quantizer name
+ * @return QuantizerType Parsed type, QuantizerType::None if unrecognized
+ */
+QuantizerType parseQuantizerType(const std::string& name);
+
+/**
+ * @brief Trained vector quantizer
+ *
+ * Quantized search is asymmetric: the query stays in float and is turned
+ * into a per-query table by prepareQuery(); distances to encoded vectors are
+ * then computed from codes alone (no decoding).
+ */
+class VectorQuantizer {
+public:
+    virtual ~VectorQuantizer();
+
+    virtual QuantizerType type() const = 0;
+
+    /**
+     * @brief Bytes per encoded vector
+     */
+    virtual size_t codeSize() const = 0;
+
+    /**
+     * @brief Train the quantizer on a sample of vectors
+     *
+     * @param vectors Row-major training vectors
+     * @param count Number of vectors
+     * @return true if training succeeded
+     */
+    virtual bool train(const float* vectors, size_t count) = 0;
+
+    /**
+     * @brief Encode one vector into codeSize() bytes
+     */
+    virtual void encode(const float* vector, uint8_t* code) const = 0;
+
+    /**
+     * @brief Approximately reconstruct a vector from its code
+     */
+    virtual void decode(const uint8_t* code, float* vector) const = 0;
+
+    /**
+     * @brief Build the per-query distance table used by distance()
+     */
+    virtual void prepareQuery(const float* query, std::vector<float>& table) const = 0;
+
+    /**
+     * @brief Asymmetric distance between a prepared query and an encoded vector
+     */
+    virtual float distance(const std::vector<float>& table, const uint8_t* code) const = 0;
+
+    /**
+     * @brief Append the trained parameters to a buffer
+     */
+    void serialize(std::string& out) const;
+
+    /**
+     * @brief Recreate a quantizer from serialize() output
+     *
+     * @return std::unique_ptr<VectorQuantizer> Quantizer, or nullptr if the data is invalid
+     */
+    static std::unique_ptr<VectorQuantizer> deserialize(const uint8_t* data, size_t size);
+
+    /**
+     * @brief Create an untrained quantizer
+     *
+     * @param type Quantizer type
+     * @param metric Distance metric of the index
+     * @param dim Vector dimension
+     * @param subspaces Product quantizer subspaces (rounded down to a divisor of dim)
+     * @return std::unique_ptr<VectorQuantizer> Quantizer, or nullptr for QuantizerType::None
+     */
+    static std::unique_ptr<VectorQuantizer> create(QuantizerType type, DistanceMetric metric, uint32_t dim,
+                                                   uint32_t subspaces = 0);
+
+    DistanceMetric metric() const { return metric_; }
+    uint32_t dim() const { return dim_; }
+
+protected:
+    VectorQuantizer(DistanceMetric metric, uint32_t dim);
+
+    virtual void serializeParams(std::string& out) const = 0;
+    virtual bool deserializeParams(const uint8_t* data, size_t size) = 0;
+
+    DistanceMetric metric_;
+    uint32_t dim_;
+};
+
+/**
+ * @brief int8 scalar quantizer with per-dimension range
+ */
+class ScalarQuantizer : public VectorQuantizer {
+public:
+    ScalarQuantizer(DistanceMetric metric, uint32_t dim);
+
+    QuantizerType type() const override { return QuantizerType::Scalar8; }
+    size_t codeSize() const override { return dim_; }
+    bool train(const float* vectors, size_t count) override;
+    void encode(const float* vector, uint8_t* code) const override;
+    void decode(const uint8_t* code, float* vector) const override;
+    void prepareQuery(const float* query, std::vector<float>& table) const override;
+    float distance(const std::vector<float>& table, const uint8_t* code) const override;
+
+protected:
+    void serializeParams(std::string& out) const override;
+    bool deserializeParams(const uint8_t* data, size_t size) override;
+
+private:
+    std::vector<float> min_;
+    std::vector<float> step_;
+};
+
+/**
+ * @brief Product quantizer with 256 k-means centroids per subspace
+ */
+class ProductQuantizer : public VectorQuantizer {
+public:
+    static constexpr uint32_t kCentroids = 256;
+
+    ProductQuantizer(DistanceMetric metric, uint32_t dim, uint32_t subspaces);
+
+    QuantizerType type() const override { return QuantizerType::Product; }
+    size_t codeSize() const override { return subspaces_; }
+    bool train(const float* vectors, size_t count) override;
+    void encode(const float* vector, uint8_t* code) const override;
+    void decode(const uint8_t* code, float* vector) const override;
+    void prepareQuery(const float* query, std::vector<float>& table) const override;
+    float distance(const std::vector<float>& table, const uint8_t* code) const override;
+
+    uint32_t subspaces() const { return subspaces_; }
+
+protected:
+    void serializeParams(std::string& out) const override;
+    bool deserializeParams(const uint8_t* data, size_t size) override;
+
+private:
+    uint32_t subspaces_;
+    uint32_t subDim_;
+    std::vector<float> centroids_;   // subspaces x kCentroids x subDim
+
+    const float* centroid(uint32_t subspace, uint32_t index) const {
+        return centroids_.data() + (static_cast<size_t>(subspace) * kCentroids + index) * subDim_;
+    }
+};
+
+/**
+ * @brief Cluster vectors with Lloyd's k-means (squared L2)
+ *
+ * @param data Row-major input vectors
+ * @param count Number of vectors
+ * @param dim Vector dimension
+ * @param k Number of clusters
+ * @param iterations Lloyd iterations
+ * @param seed Random seed for initialization
+ * @param centroids Receives k x dim centroids
+ */
+void kmeans(const float* data, size_t count, uint32_t dim, uint32_t k, int iterations, uint64_t seed,
+            std::vector<float>& centroids);
+
+#endif // QUANTIZATION_H
@@ -0,0 +1,90 @@
+#ifndef ROARING_BITMAP_H
+#define ROARING_BITMAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Encode ascending row ids as a roaring-style compressed bitmap
+ *
+ * Rows are grouped by their high 16 bits into containers. A container with
+ * at most 4096 rows is a sorted uint16 array, a denser one is a 65536-bit
+ * bitmap, so each container costs at most 8 KiB and sparse sets stay at
+ * about two bytes per row.
+ *
+ * Layout (little-endian):
+ *
+ *   [u32 containerCount]
+ *   containerCount x {u16 key, u16 type, u32 cardinality, u32 offset}
+ *   container payloads, 8-byte aligned, offsets relative to the bitmap start
+ *
+ * @param rows Ascending, unique row ids
+ * @param count Number of rows
+ * @param out Buffer to append to (the bitmap is 8-byte aligned relative to out's start)
+ */
+void encodeRoaring(const uint32_t* rows, size_t count, std::string& out);
+
+/**
+ * @brief Read-only view over an encoded roaring bitmap
+ *
+ * Works directly on mapped segment memory; nothing is copied.
+ */
+class RoaringView {
+public:
+    /**
+     * @brief Construct an empty RoaringView object
+     */
+    RoaringView();
+
+    /**
+     * @brief Attach to an encoded bitmap and validate its container table
+     *
+     * @param data Encoded bytes (8-byte aligned)
+     * @param size Number of bytes
+     * @return true if the bitmap is well-formed
+     */
+    bool open(const uint8_t* data, size_t size);
+
+    /**
+     * @brief Whether a row is in the set
+     */
+    bool contains(uint32_t row) const;
+
+    /**
+     * @brief Number of rows in the set
+     */
+    uint64_t cardinality() const { return cardinality_; }
+
+    bool empty() const { return cardinality_ == 0; }
+
+    /**
+     * @brief Append all rows in ascending order
+     */
+    void toArray(std::vector<uint32_t>& rows) const;
+
+    /**
+     * @brief Rows present in every view, in ascending order
+     *
+     * Iterates the smallest set and probes the others.
+     */
+    static std::vector<uint32_t> intersect(const std::vector<const RoaringView*>& views);
+
+private:
+    struct Container {
+        uint16_t key;
+        uint16_t type;
+        uint32_t cardinality;
+        uint32_t offset;
+    };
+
+    const uint8_t* data_;
+    const Container* containers_;
+    uint32_t containerCount_;
+    uint64_t cardinality_;
+
+    const Container* findContainer(uint16_t key) const;
+};
+
+#endif // ROARING_BITMAP_H
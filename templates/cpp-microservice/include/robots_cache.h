@@ -0,0 +1,182 @@
+#ifndef ROBOTS_CACHE_H
+#define ROBOTS_CACHE_H
+
+#include "robots_txt.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+class CrawlFrontier;
+
+/**
+ * @brief RobotsCache settings
+ */
+struct RobotsCacheOptions {
+    std::string userAgent = "DeepSearchStack";    // Product token matched against user-agent lines
+    uint64_t ttlMillis = 86400000;          // RFC 9309 asks for no more than 24 hours
+    uint64_t errorTtlMillis = 300000;       // After a 5xx or an unreachable host, before fetching again
+    uint64_t maxCrawlDelayMillis = 60000;   // Longer Crawl-delay values are cut to this
+    size_t maxHosts = 100000;               // Origins cached; the oldest stored go first beyond this
+};
+
+/**
+ * @brief Outcome of fetching /robots.txt
+ */
+struct RobotsFetchResult {
+    int status = 0;      // HTTP status after redirects; 0 if the host could not be reached
+    std::string body;
+};
+
+/**
+ * @brief Answer of RobotsCache::check()
+ */
+enum class RobotsVerdict : uint8_t {
+    Allowed,
+    Disallowed,
+    Unknown    // No rules cached for the origin and no fetcher to get them
+};
+
+/**
+ * @brief RobotsCache counters
+ */
+struct RobotsCacheStats {
+    size_t origins = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;         // Checks of an origin with no rules cached, or expired ones
+    uint64_t fetches = 0;
+    uint64_t fetchErrors = 0;    // 5xx or unreachable
+    uint64_t evicted = 0;
+    uint64_t allowed = 0;
+    uint64_t disallowed = 0;
+    size_t memoryBytes = 0;
+};
+
+/**
+ * @brief Per-origin cache of compiled robots.txt rules
+ *
+ * An origin is a scheme, host and port, as RFC 9309 scopes robots.txt.
+ * check() finds the origin's rules under a shared lock and matches the
+ * URL path against them; nothing is parsed or allocated on a hit.
+ *
+ * On a miss the rules come from the fetcher, if one is set. Concurrent
+ * checks of one origin wait for a single fetch. Without a fetcher the
+ * caller fetches /robots.txt itself and hands the result to store().
+ * As RFC 9309 asks, a 4xx (and a redirect loop) allows everything, and a
+ * 5xx or unreachable host disallows everything until errorTtlMillis has
+ * passed, unless rules fetched earlier are cached; those are kept instead.
+ *
+ * With a frontier attached, each stored Crawl-delay becomes the host's
+ * interval in the frontier, so a host asking for 10 s between requests
+ * gets it without the crawler doing anything. All methods are thread-safe;
+ * times are milliseconds on a monotonic clock.
+ */
+class RobotsCache {
+public:
+    /**
+     * @brief Fetch a robots.txt URL, following redirects
+     */
+    using Fetcher = std::function<RobotsFetchResult(const std::string& robotsUrl)>;
+
+    /**
+     * @brief Construct a new RobotsCache object
+     *
+     * @param options Agent and limits
+     */
+    explicit RobotsCache(const RobotsCacheOptions& options = RobotsCacheOptions());
+
+    void setFetcher(const Fetcher& fetcher);
+
+    /**
+     * @brief Pass Crawl-delay values on to a frontier as per-host intervals
+     *
+     * @param frontier Frontier to update, or nullptr to stop; it must outlive the cache
+     */
+    void attachFrontier(CrawlFrontier* frontier);
+
+    /**
+     * @brief Whether a URL may be crawled, fetching the origin's robots.txt on a miss
+     *
+     * @param url Absolute http(s) URL
+     * @param nowMillis Milliseconds on a monotonic clock
+     * @return Unknown if the URL has no host, or on a miss without a fetcher
+     */
+    RobotsVerdict check(std::string_view url, uint64_t nowMillis);
+
+    /**
+     * @brief check() with Unknown counted as allowed
+     */
+    bool allowed(std::string_view url, uint64_t nowMillis) {
+        return check(url, nowMillis) != RobotsVerdict::Disallowed;
+    }
+
+    /**
+     * @brief Cache a fetched robots.txt
+     *
+     * @param origin Origin as originOf() returns it
+     * @param status HTTP status, 0 if the host could not be reached
+     * @param body robots.txt contents
+     * @param nowMillis Milliseconds on a monotonic clock
+     * @return The rules now cached for the origin
+     */
+    std::shared_ptr<const RobotsRules> store(const std::string& origin, int status, std::string_view body,
+                                             uint64_t nowMillis);
+
+    /**
+     * @brief Rules cached for an origin
+     *
+     * @return nullptr if none are, or they have expired
+     */
+    std::shared_ptr<const RobotsRules> rules(const std::string& origin, uint64_t nowMillis) const;
+
+    RobotsCacheStats stats() const;
+    const RobotsCacheOptions& options() const { return options_; }
+
+    /**
+     * @brief Split a URL into its origin and the path robots.txt rules match
+     *
+     * @param url Absolute URL
+     * @param origin Receives lower-case scheme://host, with the port unless it is the scheme's default
+     * @param path Receives the path and query, "/" if empty, without the fragment
+     * @return false if the URL has no scheme or host
+     */
+    static bool originOf(std::string_view url, std::string& origin, std::string_view& path);
+
+private:
+    struct Entry {
+        std::shared_ptr<const RobotsRules> rules;
+        uint64_t expiresAt = 0;
+        uint64_t generation = 0;    // Matches its order_ item while that is the latest store
+        bool fetched = false;       // Rules from a 2xx, kept over a later fetch error
+    };
+
+    RobotsCacheOptions options_;
+    mutable std::shared_mutex mutex_;
+    std::condition_variable_any fetchCv_;
+    std::unordered_map<std::string, Entry> entries_;
+    std::deque<std::pair<std::string, uint64_t>> order_;    // Origins and generations by store time
+    std::unordered_set<std::string> fetching_;
+    Fetcher fetcher_;
+    CrawlFrontier* frontier_;
+    uint64_t generation_;
+
+    std::atomic<uint64_t> hits_;
+    std::atomic<uint64_t> misses_;
+    std::atomic<uint64_t> fetches_;
+    std::atomic<uint64_t> fetchErrors_;
+    std::atomic<uint64_t> evicted_;
+    std::atomic<uint64_t> allowed_;
+    std::atomic<uint64_t> disallowed_;
+
+    std::shared_ptr<const RobotsRules> fetch(const std::string& origin, uint64_t nowMillis);
+    RobotsVerdict count(bool allowed);
+};
+
+#endif // ROBOTS_CACHE_H
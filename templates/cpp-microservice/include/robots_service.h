@@ -0,0 +1,61 @@
+#ifndef ROBOTS_SERVICE_H
+#define ROBOTS_SERVICE_H
+
+#include "http_server.h"
+#include "robots_cache.h"
+#include <map>
+#include <memory>
+#include <string>
+
+class ConfigManager;
+class CrawlFrontierService;
+
+/**
+ * @brief HTTP front-end for the robots.txt cache
+ *
+ * The crawler asks /robots/check about the URLs it is about to crawl.
+ * The answer lists the robots.txt files of origins with no cached rules;
+ * the crawler fetches them and posts each to /robots/store, after which
+ * checks of those origins are answered from memory. In-process callers
+ * can set a fetcher on cache() instead.
+ */
+class RobotsService {
+public:
+    /**
+     * @brief Construct a new RobotsService object
+     */
+    RobotsService();
+
+    /**
+     * @brief Create the cache using ROBOTS_* configuration keys
+     *
+     * @param config Loaded configuration
+     * @return true if the configuration is valid
+     */
+    bool initialize(const ConfigManager& config);
+
+    /**
+     * @brief Register the robots routes on a server
+     *
+     * @param server HTTP server
+     */
+    void registerRoutes(HttpServer& server);
+
+    /**
+     * @brief Have a frontier drop disallowed URLs on push and space hosts by their Crawl-delay
+     *
+     * @param frontier Frontier service; it must outlive this one
+     */
+    void attachFrontier(CrawlFrontierService& frontier);
+
+    RobotsCache& cache() { return *cache_; }
+
+    std::string handleCheck(const std::map<std::string, std::string>& params);
+    std::string handleStore(const std::map<std::string, std::string>& params);
+    std::string handleStats(const std::map<std::string, std::string>& params);
+
+private:
+    std::unique_ptr<RobotsCache> cache_;
+};
+
+#endif // ROBOTS_SERVICE_H
@@ -0,0 +1,118 @@
+#ifndef ROBOTS_TXT_H
+#define ROBOTS_TXT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief The rules of one robots.txt that apply to one user agent, compiled for matching
+ *
+ * Parsing follows RFC 9309: the groups whose user-agent lines name the
+ * agent's product token (case-insensitively) are merged, and the "*"
+ * groups apply only when none does. Crawl-delay, which the RFC leaves
+ * out, is read from the same groups; Sitemap lines are collected from
+ * anywhere in the file.
+ *
+ * Allow and Disallow paths go into one path-compressed byte trie. A "*"
+ * in a path is an edge of its own that matches any run of bytes, and a
+ * trailing "$" marks its node as matching only at the end of the URL path.
+ * allowed() walks the trie along the path once, remembering the longest
+ * rule that matched (allow wins a tie), so a host with hundreds of rules
+ * costs about the same as one with a few, and only "*" edges branch.
+ * A path takes at most 4096 such branches; past that the longest match
+ * found so far decides.
+ *
+ * Percent escapes are compared with upper-case hex digits, and bytes
+ * outside ASCII in rules are percent-encoded, so rules and paths written
+ * either way match.
+ */
+class RobotsRules {
+public:
+    /**
+     * @brief Construct rules that allow everything
+     */
+    RobotsRules();
+
+    /**
+     * @brief Parse a robots.txt body
+     *
+     * @param text File contents; only the first 500 KiB are read, as RFC 9309 allows
+     * @param userAgent Product token of the crawler, e.g. "DeepSearchStack"
+     * @return The rules for @p userAgent
+     */
+    static RobotsRules parse(std::string_view text, std::string_view userAgent);
+
+    /**
+     * @brief Rules that disallow every path, for a robots.txt that could not be fetched
+     */
+    static RobotsRules disallowAll();
+
+    /**
+     * @brief Whether a path may be crawled
+     *
+     * @param path URL path with its query, starting with "/"; "/robots.txt" is always allowed
+     * @return true unless the longest matching rule is a Disallow
+     */
+    bool allowed(std::string_view path) const;
+
+    /**
+     * @brief Crawl-delay of the matching groups in milliseconds, 0 if none
+     */
+    uint64_t crawlDelayMillis() const { return crawlDelayMillis_; }
+
+    const std::vector<std::string>& sitemaps() const { return sitemaps_; }
+    size_t ruleCount() const { return rules_; }
+    size_t memoryBytes() const;
+
+private:
+    enum Rule : uint8_t { kNoRule = 0, kAllow = 1, kDisallow = 2 };
+
+    // Node of the compiled trie; its edges are edges_[firstEdge, firstEdge + edgeCount), sorted by byte
+    struct Node {
+        uint32_t firstEdge = 0;
+        uint16_t edgeCount = 0;
+        uint8_t rule = kNoRule;        // Rule whose path ends here, matching any rest of the URL path
+        uint8_t endRule = kNoRule;     // Rule whose path ends here with "$"
+        uint32_t star = 0;             // Child reached by a "*", 0 if none
+        uint32_t length = 0;           // Length of the rule path to here, "*" counting one byte
+    };
+
+    // Runs of bytes with no rule or "*" along them are one edge, labelled with all of them
+    struct Edge {
+        uint32_t labelOffset;    // Into labels_; the first byte is the one edges are sorted by
+        uint32_t labelLength;
+        uint32_t child;
+        char byte;
+    };
+
+    std::vector<Node> nodes_;
+    std::vector<Edge> edges_;
+    std::string labels_;
+    uint64_t crawlDelayMillis_;
+    std::vector<std::string> sitemaps_;
+    size_t rules_;
+
+    void compile(const std::vector<std::pair<std::string, bool>>& rules);
+    const Edge* edge(const Node& node, char byte) const;
+    // Longest rule matched so far, and how many more "*" branches a path may take
+    struct Match {
+        uint32_t length = 0;
+        uint8_t rule = kNoRule;
+        uint32_t branches = 0;
+    };
+
+    void walk(uint32_t node, size_t pos, std::string_view path, Match& match) const;
+};
+
+/**
+ * @brief Put the percent escapes of a URL path or robots.txt rule into the form RobotsRules compares
+ *
+ * @param path Path as written
+ * @return Path with upper-case hex digits in escapes and bytes outside ASCII percent-encoded
+ */
+std::string normalizeRobotsPath(std::string_view path);
+
+#endif // ROBOTS_TXT_H
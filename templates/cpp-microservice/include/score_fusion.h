@@ -0,0 +1,124 @@
+#ifndef SCORE_FUSION_H
+#define SCORE_FUSION_H
+
+#include "hash.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief How the scores of one result across lists are combined
+ */
+enum class FusionMethod {
+    Rrf,        // Reciprocal rank fusion: sum of weight / (rrfK + rank), ranks from 1
+    CombSum,    // Sum of weight * score
+    CombMnz,    // CombSum times the number of lists holding the result
+};
+
+/**
+ * @brief Fusion settings
+ */
+struct ScoreFusionOptions {
+    FusionMethod method = FusionMethod::Rrf;
+    double rrfK = 60.0;             // RRF rank offset
+    bool normalizeScores = true;    // CombSum/CombMnz: min-max scale each list's scores to [0, 1] first
+};
+
+/**
+ * @brief One fused result
+ */
+struct FusedResult {
+    Hash128 key;        // Result key, e.g. the canonical URL hash
+    double score;       // Fused score
+    uint32_t list;      // List of the occurrence that contributed most
+    uint32_t index;     // Its position in that list
+    uint32_t lists;     // Number of lists holding the result
+};
+
+/**
+ * @brief Rank fusion operator for merging several providers' result lists
+ *
+ * Lists are added one at a time, each with a weight (the provider weight).
+ * Every result is looked up by key in an open-addressing table as it is
+ * read, so the lists are passed over once, and a key repeated within a list
+ * only counts at its best rank. rank() then sorts the fused results into a
+ * buffer owned by the operator.
+ *
+ * reset() starts a new fusion but keeps the table and buffers, so an
+ * operator reused across queries stops allocating once it has seen its
+ * largest query. The table is cleared by bumping a generation stamp rather
+ * than by rewriting it.
+ *
+ * Not thread-safe.
+ */
+class ScoreFusion {
+public:
+    /**
+     * @brief Construct a new ScoreFusion object
+     */
+    explicit ScoreFusion(const ScoreFusionOptions& options = ScoreFusionOptions());
+
+    /**
+     * @brief Drop all added lists, keeping the allocated memory
+     */
+    void reset();
+
+    /**
+     * @brief Add a ranked result list
+     *
+     * @param keys Result keys, best first
+     * @param scores Provider scores, higher is better; may be null, in which
+     *               case CombSum/CombMnz score position i of n as 1 - i / n
+     * @param count Number of results
+     * @param weight Weight of the list
+     * @return uint32_t The list's number: 0 for the first list after reset, then 1, 2...
+     */
+    uint32_t addList(const Hash128* keys, const double* scores, size_t count, double weight = 1.0);
+
+    /**
+     * @brief Rank the fused results, best first
+     *
+     * Ties go to the result that was added first.
+     *
+     * @param limit Keep only the best limit results; 0 keeps all
+     * @return const std::vector<FusedResult>& Ranked results, valid until the next call
+     *         to rank, addList or reset
+     */
+    const std::vector<FusedResult>& rank(size_t limit = 0);
+
+    /**
+     * @brief Number of distinct keys added since the last reset
+     */
+    size_t size() const { return results_.size(); }
+
+    const ScoreFusionOptions& options() const { return options_; }
+
+private:
+    struct Slot {
+        uint32_t generation;    // Slot is free unless this equals generation_
+        uint32_t entry;
+    };
+
+    struct EntryState {
+        double best;            // Largest single contribution so far
+        uint32_t lastList;      // Last list the key was seen in
+    };
+
+    ScoreFusionOptions options_;
+    std::vector<Slot> table_;
+    size_t mask_;
+    uint32_t generation_;
+    uint32_t lists_;
+
+    // Fused results in order of first appearance, and their state
+    std::vector<FusedResult> results_;
+    std::vector<EntryState> states_;
+
+    std::vector<uint32_t> order_;
+    std::vector<FusedResult> ranked_;
+
+    void reserve(size_t entries);
+    uint32_t findOrInsert(const Hash128& key, bool& inserted);
+};
+
+#endif // SCORE_FUSION_H
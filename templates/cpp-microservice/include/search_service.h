@@ -0,0 +1,65 @@
+#ifndef SEARCH_SERVICE_H
+#define SEARCH_SERVICE_H
+
+#include "http_server.h"
+#include "text_index.h"
+#include <map>
+#include <string>
+
+class ConfigManager;
+
+/**
+ * @brief HTTP front-end for the native full-text index
+ *
+ * Mirrors the /search contract of services/knowledge-warehouse (SQLite
+ * FTS5) so callers can point at either implementation: every query term
+ * must match, hits are ranked by BM25 and carry id, url, title, snippet,
+ * source_domain, word_count and ingested_at. Documents arrive flattened as
+ * documents.<i>.<field>.
+ */
+class SearchService {
+public:
+    /**
+     * @brief Construct a new SearchService object
+     */
+    SearchService();
+
+    /**
+     * @brief Destroy the SearchService object
+     */
+    ~SearchService();
+
+    /**
+     * @brief Open the index using SEARCH_* configuration keys
+     *
+     * @param config Loaded configuration
+     * @return true if the index was opened
+     */
+    bool initialize(const ConfigManager& config);
+
+    /**
+     * @brief Register the search routes on a server
+     *
+     * @param server HTTP server
+     */
+    void registerRoutes(HttpServer& server);
+
+    /**
+     * @brief Stop background work and close the index
+     */
+    void shutdown();
+
+    TextIndex& index() { return index_; }
+
+    void handleSearch(const std::map<std::string, std::string>& params, JsonWriter& out);
+    std::string handleIngest(const std::map<std::string, std::string>& params);
+    std::string handleDelete(const std::map<std::string, std::string>& params);
+    std::string handleStats(const std::map<std::string, std::string>& params);
+    std::string handleMerge(const std::map<std::string, std::string>& params);
+
+private:
+    TextIndex index_;
+    size_t maxDocuments_;    // documents.<i> indexes in one /ingest below this
+};
+
+#endif // SEARCH_SERVICE_H
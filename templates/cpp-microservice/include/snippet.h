@@ -0,0 +1,92 @@
+#ifndef SNIPPET_H
+#define SNIPPET_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Snippet settings, the arguments of FTS5 snippet()
+ */
+struct SnippetOptions {
+    size_t tokens = 40;                  // Index terms in the window
+    std::string open = "<b>";            // Written before each query term
+    std::string close = "</b>";          // Written after each query term
+    std::string ellipsis = "...";        // Written where the window cuts the text
+};
+
+/**
+ * @brief Encode where each index term of a text lies, for SnippetBuilder
+ *
+ * One entry per term TermSplitter produces: [varint bytes since the end of
+ * the previous term][varint length in bytes][u16 term fingerprint]. A
+ * snippet is then chosen and cut from these offsets without splitting the
+ * text again.
+ *
+ * @param text Text as it will be stored
+ * @param out Buffer the offsets are appended to
+ */
+void encodeTermOffsets(std::string_view text, std::string& out);
+
+/**
+ * @brief Append the entry of one term, for callers already splitting the text
+ *
+ * @param text Text being split
+ * @param source The term's bytes in text (TermSplitter::source())
+ * @param term The term
+ * @param previousEnd End of the previous term in text (0 at first); advanced past this one
+ * @param out Buffer the entry is appended to
+ */
+void appendTermOffset(std::string_view text, std::string_view source, std::string_view term, size_t& previousEnd,
+                      std::string& out);
+
+/**
+ * @brief Builds FTS5-style snippets for one query
+ *
+ * The window of options.tokens consecutive terms with the most distinct
+ * query terms (then the most query-term occurrences) is picked, centred on
+ * the query terms it holds, and cut from the text with each query term
+ * highlighted. Text before the first or after the last term of the window
+ * is replaced by the ellipsis unless the window reaches that end. Reuses
+ * its buffers, so building one snippet after another does not allocate
+ * beyond the output.
+ */
+class SnippetBuilder {
+public:
+    /**
+     * @brief Construct a SnippetBuilder for query terms as TermSplitter produces them
+     */
+    SnippetBuilder(std::vector<std::string> terms, SnippetOptions options);
+
+    /**
+     * @brief Build the snippet of one document
+     *
+     * @param text The text the offsets were encoded from
+     * @param offsets Its encodeTermOffsets output
+     * @param out Receives the snippet (replaced)
+     */
+    void build(std::string_view text, std::string_view offsets, std::string& out);
+
+private:
+    struct Token {
+        uint32_t start;
+        uint32_t end;
+    };
+
+    struct Hit {
+        uint32_t token;    // Index into tokens_
+        uint32_t term;     // Index into terms_
+    };
+
+    std::vector<std::string> terms_;
+    std::vector<uint16_t> fingerprints_;
+    SnippetOptions options_;
+    std::vector<Token> tokens_;
+    std::vector<Hit> hits_;
+    std::vector<uint32_t> counts_;
+
+    int32_t match(std::string_view source, uint16_t fingerprint) const;
+};
+
+#endif // SNIPPET_H
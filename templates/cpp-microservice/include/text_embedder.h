@@ -0,0 +1,135 @@
+#ifndef TEXT_EMBEDDER_H
+#define TEXT_EMBEDDER_H
+
+#include "embedding_model.h"
+#include "thread_pool.h"
+#include "wordpiece_tokenizer.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Text embedder settings
+ */
+struct TextEmbedderOptions {
+    bool quantize = true;              // int8 linear layers (fp32 otherwise)
+    size_t maxSequenceLength = 256;    // Word pieces per text, [CLS] and [SEP] included
+    size_t maxBatchTokens = 8192;      // Tokens run through the model in one pass
+    int maxWaitMicros = 0;             // Extra time an idle batcher waits for more requests
+    size_t threads = 0;                // Inference threads (0 = one per core)
+};
+
+/**
+ * @brief Text embedder statistics
+ */
+struct TextEmbedderStats {
+    uint64_t requests;
+    uint64_t texts;
+    uint64_t tokens;
+    uint64_t batches;
+    double busySeconds;         // Time spent inside the model
+    double tokensPerSecond;     // tokens / busySeconds
+};
+
+/**
+ * @brief Tokenizer + encoder behind a dynamic batcher
+ *
+ * Callers tokenize on their own thread and enqueue; a single batcher thread
+ * runs whatever accumulated while the previous batch was in the model (up to
+ * maxBatchTokens) as one ragged batch. Under load requests share GEMMs; an
+ * idle embedder adds no latency unless maxWaitMicros asks it to linger.
+ */
+class TextEmbedder {
+public:
+    /**
+     * @brief Construct a new TextEmbedder object
+     */
+    TextEmbedder();
+
+    /**
+     * @brief Destroy the TextEmbedder object, stopping the batcher
+     */
+    ~TextEmbedder();
+
+    TextEmbedder(const TextEmbedder&) = delete;
+    TextEmbedder& operator=(const TextEmbedder&) = delete;
+
+    /**
+     * @brief Load a model directory holding model.dsem and vocab.txt
+     *
+     * @param directory Model directory
+     * @param options Embedder settings
+     * @return true if the model and vocabulary were loaded
+     */
+    bool load(const std::string& directory, const TextEmbedderOptions& options = TextEmbedderOptions());
+
+    /**
+     * @brief Load a model from explicit weight and vocabulary paths
+     */
+    bool load(const std::string& modelPath, const std::string& vocabPath, const TextEmbedderOptions& options);
+
+    /**
+     * @brief Stop the batcher; pending requests fail
+     */
+    void stop();
+
+    /**
+     * @brief Embed texts, batched with concurrent callers
+     *
+     * @param texts UTF-8 texts
+     * @param vectors Receives one L2-normalized vector per text
+     * @param tokens Receives the number of tokens processed, if not null
+     * @return true if the texts were embedded
+     */
+    bool embed(const std::vector<std::string>& texts, std::vector<std::vector<float>>& vectors,
+               size_t* tokens = nullptr);
+
+    /**
+     * @brief Embedding dimension
+     */
+    size_t dim() const { return model_.config().hidden; }
+
+    bool isLoaded() const { return running_; }
+
+    /**
+     * @brief Current statistics
+     */
+    TextEmbedderStats stats() const;
+
+private:
+    struct Request {
+        std::vector<std::vector<int32_t>> ids;
+        size_t tokens;
+        std::vector<std::vector<float>>* vectors;
+        bool done;
+        bool ok;
+    };
+
+    TextEmbedderOptions options_;
+    WordPieceTokenizer tokenizer_;
+    EmbeddingModel model_;
+    std::unique_ptr<ThreadPool> pool_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable pendingCv_;
+    std::condition_variable doneCv_;
+    std::deque<Request*> pending_;
+    size_t pendingTokens_;
+    bool running_;
+    std::thread batcher_;
+
+    uint64_t requests_;
+    uint64_t texts_;
+    uint64_t tokens_;
+    uint64_t batches_;
+    double busySeconds_;
+
+    void batchLoop();
+};
+
+#endif // TEXT_EMBEDDER_H
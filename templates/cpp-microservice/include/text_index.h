@@ -0,0 +1,319 @@
+#ifndef TEXT_INDEX_H
+#define TEXT_INDEX_H
+
+#include "snippet.h"
+#include "text_segment.h"
+#include "word_splitter.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief A document to index
+ *
+ * Fields follow the knowledge-warehouse content table: title, markdown,
+ * content, url and author are indexed; every field but content is stored
+ * and returned with hits (source_domain, word_count, ingested_at, ...).
+ */
+struct TextDocument {
+    uint64_t id;
+    Metadata fields;
+};
+
+/**
+ * @brief A full-text query
+ */
+struct TextQuery {
+    std::string text;
+    size_t limit = 20;
+    std::string domain;       // Only documents whose source_domain equals this (empty for all)
+    bool matchAll = true;     // Every query term must match, as in an FTS5 MATCH; false ranks any match
+    bool blockMax = true;     // Skip blocks that cannot reach the top-k; false scores every match
+    size_t snippetTokens = 0; // Terms of markdown per hit snippet, as FTS5 snippet(..., n); 0 for none
+};
+
+/**
+ * @brief A single search result
+ */
+struct TextHit {
+    uint64_t id;
+    float score;              // BM25, higher is better
+    Metadata fields;          // Stored fields
+    std::string snippet;      // Markdown around the query terms, which are wrapped in <b></b>
+};
+
+/**
+ * @brief Full-text index settings
+ */
+struct TextIndexOptions {
+    std::string directory = "data/text";
+    size_t flushThreshold = 20000;         // Delta documents that trigger a background flush to a new segment
+    int flushIntervalSeconds = 10;         // Flush a non-empty delta at least this often
+    size_t mergeFactor = 8;                // Merge this many adjacent segments once there are this many
+    bool syncWrites = true;                // fdatasync the delta log after every write
+    float k1 = 1.2f;                       // BM25 term frequency saturation
+    float b = 0.75f;                       // BM25 length normalization
+    size_t filterScanThreshold = 4096;     // Score domains with up to this many rows in a segment row by row
+    bool compressStored = true;            // Write segments with LZ-compressed stored fields
+    size_t storedDictionaryBytes = 16u << 10;    // Per-segment stored field dictionary; 0 compresses without one
+};
+
+/**
+ * @brief Full-text index statistics
+ */
+struct TextIndexStats {
+    size_t segments;
+    uint64_t segmentDocs;
+    uint64_t deletedDocs;     // Segment rows replaced or deleted since they were written
+    size_t segmentBytes;
+    uint64_t storedBytes;     // Stored fields in segments, as written
+    uint64_t storedRawBytes;  // The same fields uncompressed
+    size_t deltaDocs;
+    double openMillis;
+    double lastFlushMillis;
+    double lastMergeMillis;
+    uint64_t flushes;
+    uint64_t merges;
+};
+
+/**
+ * @brief Splits text into index terms
+ *
+ * Words as WordSplitter produces them (lower-cased, accents stripped),
+ * without punctuation and overlong words, so that "Graph-based ANN" and
+ * "graph based ann" index the same terms. Never allocates.
+ */
+class TermSplitter {
+public:
+    /**
+     * @brief Construct a TermSplitter over text (which must outlive it)
+     */
+    explicit TermSplitter(std::string_view text) : words_(text) {}
+
+    /**
+     * @brief Produce the next term
+     *
+     * @param term Receives the term; valid until the next call
+     * @return false at the end of the text
+     */
+    bool next(std::string_view& term);
+
+    /**
+     * @brief Bytes of the text the last term was produced from
+     */
+    std::string_view source() const { return words_.source(); }
+
+private:
+    WordSplitter words_;
+};
+
+/**
+ * @brief Persistent BM25 full-text index over immutable segments plus a delta
+ *
+ * Layout of the index directory:
+ *
+ *   CURRENT               names of the live segments, oldest first
+ *   segment-<gen>.tsx     immutable segment (see TextSegment)
+ *   delta-<gen>.log       CRC-checked log of writes not yet in a segment
+ *
+ * Writes append to the delta log and an in-memory delta that queries search
+ * directly. A background thread flushes the delta into a new segment, which
+ * records the ids it replaces or deletes in older segments, and merges runs
+ * of adjacent segments so their number stays small. Queries run block-max
+ * WAND (or, when every term must match, a block-max intersection) over each
+ * segment with one top-k heap, so whole postings blocks whose best possible
+ * score cannot enter the results are skipped without being decoded.
+ */
+class TextIndex {
+public:
+    /**
+     * @brief Construct a new TextIndex object
+     */
+    TextIndex();
+
+    /**
+     * @brief Destroy the TextIndex object, stopping background work
+     */
+    ~TextIndex();
+
+    TextIndex(const TextIndex&) = delete;
+    TextIndex& operator=(const TextIndex&) = delete;
+
+    /**
+     * @brief Open (or create) an index directory
+     *
+     * @param options Index settings
+     * @return true if the index was opened
+     * @return false if the directory or a live segment could not be used
+     */
+    bool open(const TextIndexOptions& options);
+
+    /**
+     * @brief Stop background work and release the index
+     */
+    void close();
+
+    /**
+     * @brief Index or replace a document
+     *
+     * @param document Document; its id replaces any earlier document with the same id
+     * @return true if the write was logged
+     */
+    bool add(const TextDocument& document);
+
+    /**
+     * @brief Index or replace a batch of documents with one log write and one sync
+     *
+     * @param documents Documents (moved from)
+     * @return true if the batch was logged
+     */
+    bool addBatch(std::vector<TextDocument>& documents);
+
+    /**
+     * @brief Delete a document by id
+     *
+     * @return true if the delete was logged
+     */
+    bool remove(uint64_t id);
+
+    /**
+     * @brief Top documents for a query by BM25
+     *
+     * @param query Query text, limit, optional domain filter
+     * @return std::vector<TextHit> Hits ordered by descending score
+     */
+    std::vector<TextHit> search(const TextQuery& query) const;
+
+    /**
+     * @brief Write the delta to a new segment and swap it in
+     *
+     * Queries and writes continue while the segment is written.
+     *
+     * @return true if the flush succeeded or there was nothing to flush
+     */
+    bool flush();
+
+    /**
+     * @brief Merge segments into one
+     *
+     * @param full Merge every segment; otherwise merge the mergeFactor
+     *             adjacent segments with the fewest documents, if there are
+     *             that many
+     * @return true if the merge succeeded or there was nothing to merge
+     */
+    bool merge(bool full = false);
+
+    /**
+     * @brief Start the background flush and merge thread
+     */
+    void startBackgroundMaintenance();
+
+    /**
+     * @brief Stop the background flush and merge thread
+     */
+    void stopBackgroundMaintenance();
+
+    /**
+     * @brief Number of live documents
+     */
+    size_t count() const;
+
+    /**
+     * @brief Current statistics
+     */
+    TextIndexStats stats() const;
+
+    const TextIndexOptions& options() const { return options_; }
+
+private:
+    struct DeltaDoc {
+        Metadata stored;
+        std::vector<std::pair<std::string, uint32_t>> terms;    // Sorted by term
+        uint32_t length;
+        bool deleted;
+        uint32_t sequence = 0;    // Set by Delta::put
+        std::string termOffsets;  // Of stored markdown (see encodeTermOffsets)
+    };
+
+    // A posting is current while its document still has the put sequence it records
+    struct DeltaPosting {
+        uint64_t id;
+        uint32_t freq;
+        uint32_t sequence;
+    };
+
+    // Recent writes, searched through a term -> postings map that may hold stale entries
+    struct Delta {
+        std::unordered_map<uint64_t, DeltaDoc> docs;
+        std::unordered_map<std::string, std::vector<DeltaPosting>> postings;
+        uint64_t totalLength = 0;
+        size_t liveDocs = 0;
+        uint32_t sequence = 0;    // Neither cleared nor swapped, so sequences never repeat in the active delta
+
+        void put(uint64_t id, DeltaDoc doc);
+        bool empty() const { return docs.empty(); }
+        void clear();
+        void swap(Delta& other);
+    };
+
+    struct Segment {
+        std::shared_ptr<TextSegment> segment;
+        std::vector<uint64_t> deleted;    // One bit per row
+        uint32_t deletedCount = 0;
+
+        bool isDeleted(uint32_t row) const { return (deleted[row >> 6] >> (row & 63)) & 1; }
+        bool markDeleted(uint32_t row);
+    };
+    using Segments = std::vector<std::shared_ptr<Segment>>;
+
+    struct Scorer;
+    struct Collector;
+
+    TextIndexOptions options_;
+    mutable std::shared_mutex mutex_;
+    Segments segments_;      // Oldest first
+    Delta active_;           // Writes since the last flush started
+    Delta frozen_;           // Writes being written to the next segment
+    int logFd_;
+    uint64_t logGeneration_;
+    uint64_t nextGeneration_;
+
+    std::mutex maintenanceMutex_;    // Serializes flushes and merges
+    std::mutex backgroundMutex_;
+    std::condition_variable backgroundCv_;
+    std::thread backgroundThread_;
+    bool backgroundRunning_;
+    bool flushRequested_;
+
+    double openMillis_;
+    std::atomic<double> lastFlushMillis_;
+    std::atomic<double> lastMergeMillis_;
+    std::atomic<uint64_t> flushes_;
+    std::atomic<uint64_t> merges_;
+
+    static DeltaDoc makeDeltaDoc(Metadata fields);
+    bool writeLog(const std::string& records);
+    bool replayLog(const std::string& path);
+    bool openLog(uint64_t generation);
+    bool writeCurrent(const Segments& segments) const;
+    std::string segmentPath(uint64_t generation) const;
+    std::string logPath(uint64_t generation) const;
+    const DeltaDoc* findDelta(uint64_t id) const;
+    bool liveInSegments(uint64_t id, size_t end) const;
+    void requestFlush(size_t pending);
+    void searchDelta(const std::vector<std::string>& terms, const TextQuery& query, const Scorer& scorer,
+                     Collector& top) const;
+    void searchSegment(size_t index, const std::vector<std::string>& terms, const TextQuery& query,
+                       const Scorer& scorer, Collector& top) const;
+    void backgroundLoop();
+};
+
+#endif // TEXT_INDEX_H
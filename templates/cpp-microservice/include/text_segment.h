@@ -0,0 +1,325 @@
+#ifndef TEXT_SEGMENT_H
+#define TEXT_SEGMENT_H
+
+#include "lz_codec.h"
+#include "mapped_file.h"
+#include "postings.h"
+#include "roaring_bitmap.h"
+#include "vector_segment.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Sections of a full-text segment file
+ *
+ * Each section starts on a page boundary, as in vector segments. New
+ * sections are appended to the end of this list; readers ignore sections
+ * they do not know about.
+ */
+enum class TextSegmentSection : uint32_t {
+    Terms = 0,          // concatenated index terms, in term order
+    TermDirectory,      // term-sorted TextTermEntry
+    Postings,           // per term: skip table then blocks (see encodePostings)
+    DocLengths,         // count x uint32 indexed terms per document
+    DocIds,             // count x uint64 document ids
+    IdTable,            // open-addressing table: {uint64 id, uint32 row, uint32 pad}, at most half full
+    StoredOffsets,      // (count + 1) x uint64 offsets into StoredBlob
+    StoredBlob,         // stored fields of each document (see encodeMetadata); compressed in version 2
+    DomainTerms,        // concatenated source_domain values
+    DomainDirectory,    // domain-sorted {uint64 termOffset, uint64 bitmapOffset, uint32 termLength, uint32 bitmapLength}
+    DomainBitmaps,      // roaring bitmap of rows per domain (see encodeRoaring)
+    Tombstones,         // ascending uint64 ids this segment deletes from older segments
+    TermOffsetIndex,    // (count + 1) x uint64 offsets into TermOffsets; absent in older segments
+    TermOffsets,        // where each markdown term lies (see encodeTermOffsets)
+    StoredDictionary,   // LzDictionary the version 2 stored records were compressed with; may be empty
+    Count
+};
+
+/**
+ * @brief On-disk full-text segment header, stored in the first page of the file
+ */
+struct TextSegmentHeader {
+    struct Section {
+        uint64_t offset;
+        uint64_t length;
+    };
+
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t count;
+    uint64_t generation;
+    uint64_t logGeneration;    // Writes in delta logs below this generation are in the segment
+    uint64_t totalLength;      // Sum of DocLengths
+    Section sections[16];      // Indexed by TextSegmentSection
+    uint32_t checksum;         // CRC-32C of the header with this field zeroed
+    uint32_t reserved;
+};
+
+static_assert(static_cast<uint32_t>(TextSegmentSection::Count) <= 16, "text segment header has 16 section slots");
+
+/**
+ * @brief Directory entry of one index term
+ */
+struct TextTermEntry {
+    uint64_t termOffset;
+    uint64_t postingsOffset;
+    uint32_t termLength;
+    uint32_t docFreq;
+    uint32_t maxFreq;      // Bounds over the whole postings list (see PostingBlock)
+    uint32_t minLength;
+};
+
+/**
+ * @brief Immutable, memory-mapped full-text segment
+ *
+ * Holds an inverted index over a fixed set of documents together with
+ * their lengths, ids and stored fields. Opening only validates the header
+ * and section bounds; postings are decoded straight out of the mapping as
+ * queries walk them.
+ *
+ * Version 2 segments keep each stored record as [u32 raw size][lzCompress
+ * block], compressed with a dictionary trained on the segment's own
+ * records, and decompress a record only when it is read. Version 1
+ * segments keep them uncompressed and are still read.
+ */
+class TextSegment {
+public:
+    static constexpr uint32_t kFormatVersion = 2;
+
+    /**
+     * @brief Construct an empty TextSegment object
+     */
+    TextSegment();
+
+    /**
+     * @brief Destroy the TextSegment object
+     */
+    ~TextSegment();
+
+    TextSegment(const TextSegment&) = delete;
+    TextSegment& operator=(const TextSegment&) = delete;
+
+    /**
+     * @brief Map and validate a segment file
+     *
+     * @param path Segment file path
+     * @return true if the segment is valid and mapped
+     * @return false if the file is missing, truncated or has an unsupported version
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief Unmap the segment
+     */
+    void close();
+
+    uint32_t size() const { return static_cast<uint32_t>(header_.count); }
+    uint64_t generation() const { return header_.generation; }
+    uint64_t logGeneration() const { return header_.logGeneration; }
+    uint64_t totalLength() const { return header_.totalLength; }
+    size_t fileSize() const { return file_.size(); }
+    const std::string& path() const { return file_.path(); }
+
+    /**
+     * @brief Number of distinct terms
+     */
+    uint64_t termCount() const { return termCount_; }
+
+    /**
+     * @brief Directory entry of the i-th term in term order
+     */
+    const TextTermEntry& termEntry(uint64_t i) const { return termDirectory_[i]; }
+
+    /**
+     * @brief Text of the i-th term in term order
+     */
+    std::string_view term(uint64_t i) const;
+
+    /**
+     * @brief Look up a term
+     *
+     * @return The directory entry, or nullptr if no document has the term
+     */
+    const TextTermEntry* findTerm(std::string_view term) const;
+
+    /**
+     * @brief Position a cursor on a term's postings
+     */
+    void postings(const TextTermEntry& entry, PostingCursor& cursor) const {
+        cursor.reset(postings_ + entry.postingsOffset, entry.docFreq);
+    }
+
+    /**
+     * @brief Indexed terms of every document, indexed by row
+     */
+    const uint32_t* lengths() const { return lengths_; }
+
+    uint64_t id(uint32_t row) const { return ids_[row]; }
+
+    /**
+     * @brief Find the row holding a document id
+     *
+     * @return uint32_t Row, or kInvalidRow if the id is not in this segment
+     */
+    uint32_t findRow(uint64_t id) const;
+
+    /**
+     * @brief Decode the stored fields of one row
+     */
+    Metadata stored(uint32_t row) const;
+
+    /**
+     * @brief Encoded stored fields of one row (see encodeMetadata)
+     *
+     * @param row Row
+     * @param buffer Holds the record if it has to be decompressed
+     * @param length Set to the record's length; 0 if it is corrupt
+     * @return The record, in the mapping or in @p buffer
+     */
+    const uint8_t* storedRecord(uint32_t row, std::string& buffer, size_t* length) const;
+
+    /**
+     * @brief Look up one stored field without decoding the whole record
+     *
+     * @param buffer Holds the record if it has to be decompressed; the result may point into it
+     */
+    std::string_view storedValue(uint32_t row, std::string_view key, std::string& buffer) const;
+
+    /**
+     * @brief Bytes of stored records on disk, and their size once decompressed
+     */
+    uint64_t storedBytes() const;
+    uint64_t storedRawBytes() const { return storedRawBytes_; }
+
+    /**
+     * @brief Term offsets of one row's markdown (see encodeTermOffsets)
+     *
+     * @return Empty if the segment was written without them
+     */
+    std::string_view termOffsets(uint32_t row) const;
+
+    /**
+     * @brief Rows whose source_domain is @p domain
+     *
+     * @return false if no row has that domain
+     */
+    bool domainRows(std::string_view domain, RoaringView& rows) const;
+
+    /**
+     * @brief Ids this segment deletes from older segments
+     */
+    const uint64_t* tombstones(size_t* count) const;
+
+private:
+    MappedFile file_;
+    TextSegmentHeader header_;
+    const char* terms_;
+    const TextTermEntry* termDirectory_;
+    uint64_t termCount_;
+    const uint8_t* postings_;
+    const uint32_t* lengths_;
+    const uint64_t* ids_;
+    const uint8_t* idTable_;
+    uint64_t idTableMask_;
+    const uint64_t* storedOffsets_;
+    const uint8_t* storedBlob_;
+    bool compressed_;
+    LzDictionary dictionary_;
+    uint64_t storedRawBytes_;
+    const uint64_t* termOffsetIndex_;
+    const char* termOffsets_;
+    const char* domainTerms_;
+    const uint8_t* domainDirectory_;
+    uint64_t domainCount_;
+    const uint8_t* domainBitmaps_;
+
+    const uint8_t* section(TextSegmentSection section, size_t* length) const;
+    bool validate();
+};
+
+/**
+ * @brief Writes a new full-text segment file
+ *
+ * Documents are added first, in row order, then terms in ascending order.
+ * Data goes to `<path>.tmp`; the header is written last and the file is
+ * fsynced and renamed into place by finish(), so a crash mid-write never
+ * leaves a file that passes validation.
+ */
+class TextSegmentWriter {
+public:
+    /**
+     * @brief Construct a new TextSegmentWriter object
+     *
+     * @param path Final segment path
+     * @param generation Generation number recorded in the header
+     * @param logGeneration First delta log whose writes are not in the segment
+     */
+    TextSegmentWriter(const std::string& path, uint64_t generation, uint64_t logGeneration);
+
+    /**
+     * @brief Append the next row
+     *
+     * @param id Document id
+     * @param length Indexed terms in the document
+     * @param stored Encoded stored fields (see encodeMetadata)
+     * @param storedSize Bytes in stored
+     * @param termOffsets Term offsets of the stored markdown (see encodeTermOffsets)
+     */
+    void addDocument(uint64_t id, uint32_t length, const uint8_t* stored, size_t storedSize,
+                     std::string_view termOffsets);
+
+    /**
+     * @brief Append a term's postings, after every document has been added
+     *
+     * @param term Index term, greater than the previous one
+     * @param docs Ascending rows containing the term
+     * @param freqs Occurrences in each row
+     * @param n Number of rows
+     */
+    void addTerm(std::string_view term, const uint32_t* docs, const uint32_t* freqs, size_t n);
+
+    /**
+     * @brief Ids this segment deletes from older segments
+     */
+    void setTombstones(std::vector<uint64_t> ids);
+
+    /**
+     * @brief Compress stored records, with a dictionary trained on them
+     *
+     * @param compress false writes a version 1 segment with plain records
+     * @param dictionaryBytes Dictionary size; 0 compresses each record on its own
+     */
+    void setStoredCompression(bool compress, size_t dictionaryBytes);
+
+    /**
+     * @brief Write the sections and header, then fsync and rename
+     *
+     * @return true if the segment was committed
+     */
+    bool finish();
+
+    uint32_t size() const { return static_cast<uint32_t>(ids_.size()); }
+
+private:
+    std::string path_;
+    uint64_t generation_;
+    uint64_t logGeneration_;
+    std::vector<uint32_t> lengths_;
+    std::vector<uint64_t> ids_;
+    std::vector<uint64_t> storedOffsets_;
+    std::string storedBlob_;
+    std::vector<uint64_t> termOffsetIndex_;
+    std::string termOffsets_;
+    std::string terms_;
+    std::vector<TextTermEntry> termDirectory_;
+    std::string postings_;
+    std::vector<uint64_t> tombstones_;
+    uint64_t totalLength_;
+    bool compress_;
+    size_t dictionaryBytes_;
+};
+
+#endif // TEXT_SEGMENT_H
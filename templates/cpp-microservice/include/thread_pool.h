@@ -0,0 +1,64 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed-size worker pool shared by the service's data-parallel work
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief Construct a new ThreadPool object
+     *
+     * @param threads Number of worker threads (0 = one per hardware thread, minus the caller)
+     */
+    explicit ThreadPool(size_t threads = 0);
+
+    /**
+     * @brief Destroy the ThreadPool object, finishing queued tasks first
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Number of worker threads
+     */
+    size_t size() const { return workers_.size(); }
+
+    /**
+     * @brief Queue a task to run on a worker thread
+     */
+    void submit(std::function<void()> task);
+
+    /**
+     * @brief Run @p fn over [0, count) in chunks of @p grain and wait for all chunks
+     *
+     * The calling thread works on chunks too, so this is safe to call from a
+     * worker and still makes progress when every worker is busy.
+     *
+     * @param count Number of items
+     * @param grain Items per chunk (chunk i covers [i * grain, min((i + 1) * grain, count)))
+     * @param fn Called as fn(chunk, begin, end)
+     */
+    void parallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t, size_t)>& fn);
+
+private:
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_;
+
+    void workerLoop();
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,104 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Hierarchical timer wheel (Varghese and Lauck, 1987)
+ *
+ * Holds millions of one-shot timers at a few bytes each, with O(1)
+ * schedule. Four levels of 256 slots cover 2^32 ticks (49 days of
+ * milliseconds). A timer goes to the lowest level whose slot lies ahead of
+ * the current tick with every higher digit equal. Each time a level's
+ * digit of the current tick changes, that level's current slot is
+ * redistributed to the levels below. Timers further out than 2^32 ticks
+ * are parked in the top level and placed again until they are in range.
+ *
+ * advance() skips runs of ticks on which nothing can fire, so an idle
+ * wheel catches up with a distant clock in a few steps. Timers are kept in
+ * one pool linked by index; firing returns nodes to a free list. The
+ * wheel is not thread-safe.
+ */
+class TimerWheel {
+public:
+    /**
+     * @brief A timer that fired
+     */
+    struct Timer {
+        uint64_t due;
+        uint64_t payload;
+    };
+
+    /**
+     * @brief Construct an empty TimerWheel object
+     *
+     * @param now Current tick
+     */
+    explicit TimerWheel(uint64_t now = 0);
+
+    /**
+     * @brief Add a timer
+     *
+     * @param due Tick it fires on; one already past fires on the next tick
+     * @param payload Returned when it fires
+     */
+    void schedule(uint64_t due, uint64_t payload);
+
+    /**
+     * @brief Move the current tick forward, collecting the timers that come due
+     *
+     * @param now New current tick; earlier ticks are ignored
+     * @param fired Receives the fired timers, in due order
+     */
+    void advance(uint64_t now, std::vector<Timer>& fired);
+
+    /**
+     * @brief Ticks a caller can wait before advancing again
+     *
+     * Exact if a timer is due within the current level-0 round. Otherwise
+     * it is the wait until the next redistribution, after which the caller
+     * should ask again.
+     *
+     * @return 0 if nothing is scheduled
+     */
+    uint64_t nextWait() const;
+
+    uint64_t now() const { return now_; }
+    size_t size() const { return size_; }
+
+    /**
+     * @brief Bytes held by the timer pool
+     */
+    size_t memoryBytes() const { return nodes_.capacity() * sizeof(Node); }
+
+private:
+    static constexpr int kLevels = 4;
+    static constexpr int kSlotBits = 8;
+    static constexpr uint32_t kSlots = 1u << kSlotBits;
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    struct Node {
+        uint64_t due;
+        uint64_t payload;
+        uint32_t next;
+    };
+
+    struct Slot {
+        uint32_t head = kNone;
+        uint32_t tail = kNone;
+    };
+
+    uint64_t now_;
+    size_t size_;
+    std::vector<Node> nodes_;
+    uint32_t free_;
+    Slot slots_[kLevels][kSlots];
+    size_t levelSizes_[kLevels];
+
+    void place(uint32_t node);
+    void cascade(int level);
+};
+
+#endif // TIMER_WHEEL_H
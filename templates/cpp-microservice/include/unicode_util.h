@@ -0,0 +1,86 @@
+#ifndef UNICODE_UTIL_H
+#define UNICODE_UTIL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Decode one UTF-8 code point and advance past it
+ *
+ * Malformed or truncated sequences decode to U+FFFD and advance one byte,
+ * so arbitrary bytes never stall a scanner.
+ *
+ * @param p Read position, advanced past the code point
+ * @param end End of the buffer
+ * @return uint32_t The code point
+ */
+uint32_t decodeUtf8(const char*& p, const char* end);
+
+/**
+ * @brief Write a code point as UTF-8
+ *
+ * @param cp Code point
+ * @param out Receives 1 to 4 bytes
+ * @return size_t Number of bytes written
+ */
+size_t encodeUtf8(uint32_t cp, char* out);
+
+/**
+ * @brief Append a code point as UTF-8
+ */
+void appendUtf8(uint32_t cp, std::string& out);
+
+/**
+ * @brief Whitespace as BERT's basic tokenizer sees it (space separators plus \\t \\n \\r)
+ */
+bool isUnicodeWhitespace(uint32_t cp);
+
+/**
+ * @brief Whitespace as Python's str.isspace() and regex `\\s` see it
+ */
+bool isPythonWhitespace(uint32_t cp);
+
+/**
+ * @brief Python's str.isalnum(); with '_' added this is regex `\\w`
+ */
+bool isUnicodeAlnum(uint32_t cp);
+
+/**
+ * @brief Decimal digits (Nd), which regex `\\d` matches
+ */
+bool isUnicodeDecimal(uint32_t cp);
+
+/**
+ * @brief Control and format characters that BERT's tokenizer drops (\\t \\n \\r excluded)
+ */
+bool isUnicodeControl(uint32_t cp);
+
+/**
+ * @brief Punctuation: any ASCII non-alphanumeric symbol, or a Unicode P* character
+ */
+bool isUnicodePunctuation(uint32_t cp);
+
+/**
+ * @brief CJK ideographs, which BERT splits into single-character words
+ */
+bool isCjkIdeograph(uint32_t cp);
+
+/**
+ * @brief Nonspacing combining marks (Mn), which accent stripping removes
+ */
+bool isCombiningMark(uint32_t cp);
+
+/**
+ * @brief Lower-case a code point (ASCII, Latin-1, Latin Extended-A, Greek and Cyrillic)
+ */
+uint32_t toLowerCodePoint(uint32_t cp);
+
+/**
+ * @brief Base letter of a precomposed accented letter, as NFD followed by dropping marks gives
+ *
+ * @return uint32_t The base letter, or @p cp unchanged when it does not decompose
+ */
+uint32_t stripAccent(uint32_t cp);
+
+#endif // UNICODE_UTIL_H
@@ -0,0 +1,92 @@
+#ifndef URL_CANONICALIZER_H
+#define URL_CANONICALIZER_H
+
+#include "hash.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Canonicalization settings
+ */
+struct UrlCanonicalizerOptions {
+    bool stripTracking = true;           // Drop trackingParams and parameters starting with a trackingPrefixes entry
+    bool sortQuery = true;               // Order parameters by name (repeated names keep their order)
+    bool dropFragment = true;            // Drop #fragment
+    bool removeTrailingSlash = true;     // "/docs/" becomes "/docs"; "/" stays
+    std::vector<std::string> trackingParams = {
+        "fbclid", "gclid", "gclsrc", "dclid", "msclkid", "yclid", "twclid", "ttclid", "igshid", "mc_cid",
+        "mc_eid", "_ga", "_gl", "_hsenc", "_hsmi", "mkt_tok", "li_fat_id", "wickedid", "vero_id", "oly_anon_id",
+        "oly_enc_id", "ref_src",
+    };
+    std::vector<std::string> trackingPrefixes = {"utm_"};
+};
+
+/**
+ * @brief URL canonicalizer and cache-key hasher
+ *
+ * Maps the spellings of one URL that the Python services currently hash
+ * separately onto a single form:
+ * - scheme and host lower-cased, trailing dot on the host dropped
+ * - default ports (http 80, https 443, ...) removed
+ * - percent escapes decoded where the byte is unreserved and re-encoded
+ *   with upper-case hex otherwise; bytes that must be escaped are escaped
+ * - "." and ".." path segments resolved, an empty path becomes "/"
+ * - tracking parameters (utm_*, fbclid, gclid, ...) and empty parameters
+ *   dropped, the rest sorted by name
+ * - the fragment dropped
+ *
+ * Only URLs with an authority ("scheme://host...") are accepted, and at
+ * most kMaxUrlBytes of output. Parsing and hashing use fixed buffers
+ * and never allocate; hosts are not IDNA-converted.
+ *
+ * Thread-safe once constructed.
+ */
+class UrlCanonicalizer {
+public:
+    /** Longest canonical URL produced */
+    static constexpr size_t kMaxUrlBytes = 8192;
+    /** Query parameters sorted; any beyond this keep their original order after the sorted ones */
+    static constexpr size_t kMaxQueryParams = 256;
+
+    /**
+     * @brief Construct a new UrlCanonicalizer object
+     */
+    explicit UrlCanonicalizer(const UrlCanonicalizerOptions& options = UrlCanonicalizerOptions());
+
+    /**
+     * @brief Canonicalize into a caller buffer
+     *
+     * @param url URL to canonicalize
+     * @param out Output buffer
+     * @param capacity Size of @p out
+     * @return size_t Length written, or 0 if the URL is invalid or does not fit
+     */
+    size_t canonicalize(std::string_view url, char* out, size_t capacity) const;
+
+    /**
+     * @brief Canonicalize into a string
+     *
+     * @param url URL to canonicalize
+     * @param out Receives the canonical URL
+     * @return true if the URL is valid
+     */
+    bool canonicalize(std::string_view url, std::string& out) const;
+
+    /**
+     * @brief Hash the canonical form (murmurHash3, 128-bit), without allocating
+     *
+     * @param url URL to hash
+     * @param hash Receives the hash
+     * @return true if the URL is valid
+     */
+    bool hash(std::string_view url, Hash128& hash) const;
+
+private:
+    UrlCanonicalizerOptions options_;
+
+    bool isTracking(std::string_view name) const;
+};
+
+#endif // URL_CANONICALIZER_H
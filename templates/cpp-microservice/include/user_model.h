@@ -1,6 +1,7 @@
 #ifndef USER_MODEL_H
 #define USER_MODEL_H
 
+#include "json_writer.h"
 #include <string>
 #include <vector>
 
@@ -64,9 +65,20 @@ public:
     static std::vector<UserModel> findAll();
 
 private:
+    friend struct JsonFields<UserModel>;
+
     int id_;
     std::string name_;
     std::string email_;
 };
 
+/**
+ * @brief Writes a user as {"id": 1, "name": "...", "email": "..."}
+ */
+template <>
+struct JsonFields<UserModel> {
+    static constexpr auto fields = std::make_tuple(jsonField("id", &UserModel::id_), jsonField("name", &UserModel::name_),
+                                                   jsonField("email", &UserModel::email_));
+};
+
 #endif // USER_MODEL_H
\ No newline at end of file
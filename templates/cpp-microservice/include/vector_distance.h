@@ -0,0 +1,62 @@
+#ifndef VECTOR_DISTANCE_H
+#define VECTOR_DISTANCE_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Distance metric used by a vector index
+ *
+ * Cosine indexes store unit-normalized vectors, so their distance is
+ * 1 - dot(a, b), matching the `1 - distance` similarity used by the
+ * deepsearch RAG stage.
+ */
+enum class DistanceMetric : uint32_t {
+    L2 = 0,
+    Cosine = 1
+};
+
+/**
+ * @brief Dot product of two float vectors
+ */
+inline float dotProduct(const float* a, const float* b, size_t dim) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < dim; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+/**
+ * @brief Squared Euclidean distance of two float vectors
+ */
+inline float squaredL2(const float* a, const float* b, size_t dim) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < dim; ++i) {
+        float d = a[i] - b[i];
+        sum += d * d;
+    }
+    return sum;
+}
+
+/**
+ * @brief Distance between two vectors under the given metric
+ */
+inline float vectorDistance(DistanceMetric metric, const float* a, const float* b, size_t dim) {
+    return metric == DistanceMetric::Cosine ? 1.0f - dotProduct(a, b, dim) : squaredL2(a, b, dim);
+}
+
+/**
+ * @brief Scale a vector to unit length in place (no-op for zero vectors)
+ */
+inline void normalizeVector(float* v, size_t dim) {
+    float norm = std::sqrt(dotProduct(v, v, dim));
+    if (norm > 0.0f) {
+        for (size_t i = 0; i < dim; ++i) {
+            v[i] /= norm;
+        }
+    }
+}
+
+#endif // VECTOR_DISTANCE_H
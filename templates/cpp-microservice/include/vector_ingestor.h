@@ -0,0 +1,164 @@
+#ifndef VECTOR_INGESTOR_H
+#define VECTOR_INGESTOR_H
+
+#include "mpsc_queue.h"
+#include "vector_store.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Ingestion pipeline settings
+ */
+struct IngestOptions {
+    size_t queueCapacity = 65536;    // Records buffered before submit() applies backpressure
+    size_t maxBatch = 4096;          // Records folded into one log write and sync
+};
+
+/**
+ * @brief Ingestion pipeline statistics
+ */
+struct IngestStats {
+    uint64_t submitted;     // Records accepted by submit()
+    uint64_t written;       // Records written to the store
+    uint64_t duplicates;    // Records dropped as repeats within a batch or unchanged from the store
+    uint64_t failed;        // Records lost to failed log writes
+    uint64_t batches;       // Group commits
+    uint64_t queued;        // Records submitted but not yet applied
+    uint64_t appliedToken;  // Highest token visible to queries
+};
+
+/**
+ * @brief Batched, asynchronous upserts into a VectorStore
+ *
+ * Producers (request handlers) prepare their records on the store's worker
+ * pool - content-addressed ids, id hashes, vector normalization and
+ * fingerprints - and push them into a bounded lock-free queue. A single
+ * applier thread drains the queue in batches, drops repeated ids (the last
+ * write wins) and unchanged records, and commits each batch with one log
+ * write and one sync.
+ *
+ * submit() returns a token: the queue position just past the caller's last
+ * record. Records are applied in queue order, so once appliedToken() reaches
+ * a token every write before it is visible to queries (read-your-writes),
+ * unless its batch failed to reach the log; lost() tells which.
+ */
+class VectorIngestor {
+public:
+    /**
+     * @brief Construct a new VectorIngestor object
+     */
+    VectorIngestor();
+
+    /**
+     * @brief Destroy the VectorIngestor object, draining the queue
+     */
+    ~VectorIngestor();
+
+    VectorIngestor(const VectorIngestor&) = delete;
+    VectorIngestor& operator=(const VectorIngestor&) = delete;
+
+    /**
+     * @brief Start the applier thread
+     *
+     * @param store Open store to write to; must outlive the ingestor or stop()
+     * @param options Pipeline settings
+     * @return true if the pipeline was started
+     */
+    bool start(VectorStore& store, const IngestOptions& options = IngestOptions());
+
+    /**
+     * @brief Apply everything queued, then stop the applier thread
+     */
+    void stop();
+
+    /**
+     * @brief Queue records for upsert
+     *
+     * Records without an id get one derived from a hash of their "document"
+     * metadata. Blocks while the queue is full.
+     *
+     * @param records Records to queue (moved from); every vector must match the store dimension
+     * @param idPrefix Prepended to every id (e.g. "<namespace>:")
+     * @param first Receives the queue position of the first record, for lost()
+     * @return uint64_t Read-your-writes token, or 0 if the batch was rejected
+     *                  or the pipeline stopped before all of it was queued
+     */
+    uint64_t submit(std::vector<VectorRecord>& records, const std::string& idPrefix = "",
+                    uint64_t* first = nullptr);
+
+    /**
+     * @brief Wait until every record up to a token is visible to queries
+     *
+     * @param token Token returned by submit()
+     * @param timeoutMillis Maximum time to wait
+     * @return true if the token was reached
+     */
+    bool waitFor(uint64_t token, int timeoutMillis) const;
+
+    /**
+     * @brief Whether an applied record between two queue positions was lost to a failed write
+     *
+     * Only the most recent failed batches are remembered.
+     *
+     * @param first Position of the first record, from submit(), or token - 1 for the last one only
+     * @param token Token returned by submit(), already reached
+     * @return true if part of a failed batch lies in [first, token)
+     */
+    bool lost(uint64_t first, uint64_t token) const;
+
+    /**
+     * @brief Highest token whose records are visible to queries
+     */
+    uint64_t appliedToken() const { return applied_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Current statistics
+     */
+    IngestStats stats() const;
+
+    /**
+     * @brief Content-addressed id of a document: the first 16 hex digits of its SHA-256,
+     *        as the Python vector-store generates them
+     */
+    static std::string contentId(const std::string& text);
+
+private:
+    struct Item {
+        VectorRecord record;
+        uint64_t idHash;
+        uint64_t fingerprint;
+    };
+
+    VectorStore* store_;
+    IngestOptions options_;
+    std::unique_ptr<MpscQueue<Item>> queue_;
+    std::thread applier_;
+    std::atomic<bool> running_;
+
+    std::mutex parkMutex_;
+    std::condition_variable parkCv_;
+    std::atomic<bool> parked_;
+
+    mutable std::mutex appliedMutex_;
+    mutable std::condition_variable appliedCv_;
+    std::atomic<uint64_t> applied_;
+    std::deque<std::pair<uint64_t, uint64_t>> failedRanges_;    // Queue positions of failed batches
+
+    std::atomic<uint64_t> submitted_;
+    std::atomic<uint64_t> written_;
+    std::atomic<uint64_t> duplicates_;
+    std::atomic<uint64_t> failed_;
+    std::atomic<uint64_t> batches_;
+
+    void applyLoop();
+    bool applyBatch(std::vector<Item>& batch);
+};
+
+#endif // VECTOR_INGESTOR_H
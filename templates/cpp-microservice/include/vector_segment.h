@@ -0,0 +1,343 @@
+#ifndef VECTOR_SEGMENT_H
+#define VECTOR_SEGMENT_H
+
+#include "hnsw_index.h"
+#include "mapped_file.h"
+#include "quantization.h"
+#include "roaring_bitmap.h"
+#include "vector_distance.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Per-record metadata (url, title, namespace, chunk_index, ...)
+ */
+using Metadata = std::map<std::string, std::string>;
+
+/**
+ * @brief Sections of a vector segment file
+ *
+ * Each section starts on a page boundary so it can be mapped and handed to
+ * the search code without copying. New sections are appended to the end of
+ * this list; readers ignore sections they do not know about.
+ */
+enum class SegmentSection : uint32_t {
+    Vectors = 0,           // count x dim float32, row-major
+    IdOffsets,             // (count + 1) x uint64 offsets into IdBlob
+    IdBlob,                // concatenated id strings
+    IdTable,               // open-addressing table: {uint64 hash, uint32 row, uint32 pad}
+    MetadataOffsets,       // (count + 1) x uint64 offsets into MetadataBlob
+    MetadataBlob,          // encoded metadata records (see encodeMetadata)
+    GraphLevels,           // count x uint8 HNSW node levels
+    GraphLevel0,           // count x (maxDegree0 + 1) uint32 adjacency lists
+    GraphUpperOffsets,     // (count + 1) x uint64 offsets into GraphUpper
+    GraphUpper,            // upper-level adjacency lists
+    QuantizerParams,       // serialized VectorQuantizer, absent when the store does not quantize
+    QuantizedCodes,        // count x codeSize bytes, with QuantizerParams
+    MetadataIndexTerms,    // [u32 n][n bytes of NUL-terminated indexed keys] then "key\0value" terms
+    MetadataIndexDirectory,// term-sorted {uint64 termOffset, uint64 bitmapOffset, uint32 termLength, uint32 bitmapLength}
+    MetadataIndexBitmaps,  // roaring bitmap of rows per term (see encodeRoaring)
+    Count
+};
+
+/**
+ * @brief On-disk segment header, stored in the first page of the file
+ */
+struct SegmentHeader {
+    struct Section {
+        uint64_t offset;
+        uint64_t length;
+    };
+
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t dim;
+    uint32_t metric;
+    uint64_t count;
+    uint64_t generation;
+    uint32_t maxDegree;
+    uint32_t maxDegree0;
+    uint32_t entryPoint;
+    uint32_t maxLevel;
+    Section sections[16];  // Indexed by SegmentSection
+    uint32_t checksum;     // CRC-32C of the header with this field zeroed
+    uint32_t reserved;
+};
+
+static_assert(static_cast<uint32_t>(SegmentSection::Count) <= 16, "segment header has 16 section slots");
+
+/**
+ * @brief Encode a metadata map as `[u16 count]([u16 klen][key][u32 vlen][value])*`
+ *
+ * @param metadata Metadata to encode
+ * @param out Buffer to append to
+ */
+void encodeMetadata(const Metadata& metadata, std::string& out);
+
+/**
+ * @brief Decode a metadata record produced by encodeMetadata
+ *
+ * @param data Encoded bytes
+ * @param size Number of bytes
+ * @param metadata Receives the decoded pairs
+ * @return true if the record was well-formed
+ */
+bool decodeMetadata(const uint8_t* data, size_t size, Metadata& metadata);
+
+/**
+ * @brief Look up one key in an encoded metadata record without decoding it
+ *
+ * @return std::string_view The value, or an empty view if the key is absent
+ */
+std::string_view findMetadataValue(const uint8_t* data, size_t size, std::string_view key);
+
+/**
+ * @brief 64-bit FNV-1a hash used for the segment id table
+ */
+uint64_t hashRecordId(std::string_view id);
+
+/**
+ * @brief Immutable, memory-mapped vector segment
+ *
+ * Opening a segment only validates the header and section bounds; vectors,
+ * ids, metadata and graph adjacency are read straight out of the mapping,
+ * so cold start time does not depend on the segment size.
+ */
+class VectorSegment {
+public:
+    static constexpr uint32_t kFormatVersion = 1;
+    static constexpr size_t kPageSize = 4096;
+
+    /**
+     * @brief Construct an empty VectorSegment object
+     */
+    VectorSegment();
+
+    /**
+     * @brief Destroy the VectorSegment object
+     */
+    ~VectorSegment();
+
+    /**
+     * @brief Map and validate a segment file
+     *
+     * @param path Segment file path
+     * @return true if the segment is valid and mapped
+     * @return false if the file is missing, truncated or has an unsupported version
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief Unmap the segment
+     */
+    void close();
+
+    bool isOpen() const { return file_.isOpen(); }
+    uint32_t dim() const { return header_.dim; }
+    DistanceMetric metric() const { return static_cast<DistanceMetric>(header_.metric); }
+    uint32_t size() const { return static_cast<uint32_t>(header_.count); }
+    uint64_t generation() const { return header_.generation; }
+    size_t fileSize() const { return file_.size(); }
+    const std::string& path() const { return file_.path(); }
+
+    /**
+     * @brief Row-major vector data of all rows
+     */
+    const float* vectors() const { return vectors_; }
+
+    /**
+     * @brief Vector of one row
+     */
+    const float* vector(uint32_t row) const { return vectors_ + static_cast<size_t>(row) * header_.dim; }
+
+    /**
+     * @brief Id of one row
+     */
+    std::string_view id(uint32_t row) const;
+
+    /**
+     * @brief Decode the metadata of one row
+     */
+    Metadata metadata(uint32_t row) const;
+
+    /**
+     * @brief Look up one metadata value of a row without decoding the whole record
+     */
+    std::string_view metadataValue(uint32_t row, std::string_view key) const;
+
+    /**
+     * @brief Encoded metadata record of one row (see encodeMetadata)
+     */
+    const uint8_t* metadataRecord(uint32_t row, size_t* length) const;
+
+    /**
+     * @brief Find the row holding an id
+     *
+     * @param id Record id
+     * @return uint32_t Row, or kInvalidRow if the id is not in this segment
+     */
+    uint32_t findRow(std::string_view id) const;
+
+    /**
+     * @brief HNSW graph over this segment's vectors
+     */
+    const HnswGraphView& graph() const { return graph_; }
+
+    /**
+     * @brief Quantizer the codes were produced with, or nullptr for unquantized segments
+     */
+    const VectorQuantizer* quantizer() const { return quantizer_.get(); }
+
+    /**
+     * @brief Quantized code of one row (quantizer()->codeSize() bytes)
+     */
+    const uint8_t* code(uint32_t row) const { return codes_ + static_cast<size_t>(row) * quantizer_->codeSize(); }
+
+    /**
+     * @brief Whether a metadata key has bitmaps in this segment
+     */
+    bool isIndexed(std::string_view key) const;
+
+    /**
+     * @brief Rows whose metadata @p key equals @p value
+     *
+     * @param key Metadata key
+     * @param value Metadata value
+     * @param bitmap Receives the rows (empty if no row has the value)
+     * @return true if the key is indexed
+     * @return false if the key is not indexed (the caller must filter rows itself)
+     */
+    bool metadataBitmap(std::string_view key, std::string_view value, RoaringView& bitmap) const;
+
+    /**
+     * @brief Raw bytes of a section (empty if the segment does not have it)
+     */
+    const uint8_t* section(SegmentSection section, size_t* length) const;
+
+private:
+    MappedFile file_;
+    SegmentHeader header_;
+    const float* vectors_;
+    const uint64_t* idOffsets_;
+    const char* idBlob_;
+    const uint8_t* idTable_;
+    uint64_t idTableMask_;
+    const uint64_t* metadataOffsets_;
+    const uint8_t* metadataBlob_;
+    HnswGraphView graph_;
+    std::unique_ptr<VectorQuantizer> quantizer_;
+    const uint8_t* codes_;
+    std::vector<std::string_view> indexedKeys_;
+    const uint8_t* termDirectory_;
+    uint64_t termCount_;
+    const char* terms_;
+    const uint8_t* bitmaps_;
+
+    bool validate();
+};
+
+/**
+ * @brief Writes a new segment file
+ *
+ * Data goes to `<path>.tmp`; the header is written last and the file is
+ * fsynced and renamed into place by finish(), so a crash mid-write never
+ * leaves a file that passes validation.
+ */
+class VectorSegmentWriter {
+public:
+    /**
+     * @brief Construct a new VectorSegmentWriter object
+     *
+     * @param path Final segment path
+     * @param dim Vector dimension
+     * @param metric Distance metric
+     * @param generation Generation number recorded in the header
+     */
+    VectorSegmentWriter(const std::string& path, uint32_t dim, DistanceMetric metric, uint64_t generation);
+
+    /**
+     * @brief Destroy the VectorSegmentWriter object, discarding an unfinished file
+     */
+    ~VectorSegmentWriter();
+
+    VectorSegmentWriter(const VectorSegmentWriter&) = delete;
+    VectorSegmentWriter& operator=(const VectorSegmentWriter&) = delete;
+
+    /**
+     * @brief Create the temporary file and map a writable vector section
+     *
+     * @param count Number of rows the segment will hold
+     * @return true if the file was created
+     */
+    bool begin(uint32_t count);
+
+    /**
+     * @brief Writable row-major vector buffer (count x dim), valid until finish()
+     *
+     * Graph construction reads vectors back from this buffer, so compaction
+     * does not need a second in-memory copy of the index.
+     */
+    float* vectors() { return vectors_; }
+
+    /**
+     * @brief Append the id and metadata of the next row
+     */
+    void addRecord(std::string_view id, const Metadata& metadata);
+
+    /**
+     * @brief Append the id and pre-encoded metadata of the next row
+     */
+    void addEncodedRecord(std::string_view id, const uint8_t* metadata, size_t metadataSize);
+
+    /**
+     * @brief Store quantized codes alongside the float vectors
+     *
+     * @param quantizer Trained quantizer
+     * @param codes count x quantizer.codeSize() bytes, in row order
+     */
+    void setQuantization(const VectorQuantizer& quantizer, std::vector<uint8_t> codes);
+
+    /**
+     * @brief Build per-value row bitmaps for these metadata keys
+     */
+    void setIndexedKeys(const std::vector<std::string>& keys) { indexedKeys_ = keys; }
+
+    /**
+     * @brief Write the remaining sections and header, then fsync and rename
+     *
+     * @param graph Graph built over vectors()
+     * @return true if the segment was committed
+     */
+    bool finish(const HnswBuilder& graph);
+
+private:
+    std::string path_;
+    std::string tmpPath_;
+    uint32_t dim_;
+    DistanceMetric metric_;
+    uint64_t generation_;
+    uint32_t count_;
+    int fd_;
+    float* vectors_;
+    size_t vectorBytes_;
+    uint64_t nextOffset_;
+    SegmentHeader header_;
+
+    std::vector<uint64_t> idOffsets_;
+    std::string idBlob_;
+    std::vector<uint64_t> metadataOffsets_;
+    std::string metadataBlob_;
+    std::string quantizerParams_;
+    std::vector<uint8_t> codes_;
+    std::vector<std::string> indexedKeys_;
+
+    bool writeSection(SegmentSection section, const void* data, size_t length);
+    void abort();
+};
+
+#endif // VECTOR_SEGMENT_H
@@ -0,0 +1,79 @@
+#ifndef VECTOR_SERVICE_H
+#define VECTOR_SERVICE_H
+
+#include "http_server.h"
+#include "text_embedder.h"
+#include "vector_ingestor.h"
+#include "vector_store.h"
+#include <map>
+#include <string>
+
+class ConfigManager;
+
+/**
+ * @brief HTTP front-end for the native vector store
+ *
+ * Mirrors the contract of services/vector-store (ChromaDB) so the deepsearch
+ * RAG stage can point at either implementation. Request parameters arrive
+ * as a flat key/value map; vectors are comma-separated floats and batches
+ * are flattened as documents.<i>.<field>.
+ */
+class VectorService {
+public:
+    /**
+     * @brief Construct a new VectorService object
+     */
+    VectorService();
+
+    /**
+     * @brief Destroy the VectorService object
+     */
+    ~VectorService();
+
+    /**
+     * @brief Open the store using VECTOR_* configuration keys
+     *
+     * @param config Loaded configuration
+     * @return true if the store was opened
+     */
+    bool initialize(const ConfigManager& config);
+
+    /**
+     * @brief Register the vector routes on a server
+     *
+     * @param server HTTP server
+     */
+    void registerRoutes(HttpServer& server);
+
+    /**
+     * @brief Stop background work and close the store
+     */
+    void shutdown();
+
+    VectorStore& store() { return store_; }
+
+    /**
+     * @brief Embed texts natively when a request carries no vectors
+     *
+     * With an embedder attached, /embed documents may omit `vector` and
+     * /query accepts `query_text`, as the Python service does.
+     *
+     * @param embedder Loaded embedder that outlives the service, or nullptr to detach
+     */
+    void setEmbedder(TextEmbedder* embedder) { embedder_ = embedder; }
+
+    std::string handleUpsert(const std::map<std::string, std::string>& params);
+    std::string handleEmbed(const std::map<std::string, std::string>& params);
+    std::string handleQuery(const std::map<std::string, std::string>& params);
+    std::string handleDelete(const std::map<std::string, std::string>& params);
+    std::string handleStats(const std::map<std::string, std::string>& params);
+    std::string handleCompact(const std::map<std::string, std::string>& params);
+
+private:
+    VectorStore store_;
+    VectorIngestor ingestor_;
+    TextEmbedder* embedder_;
+    size_t maxDocuments_;    // documents.<i> indexes in one /embed run below this
+};
+
+#endif // VECTOR_SERVICE_H
@@ -0,0 +1,275 @@
+#ifndef VECTOR_STORE_H
+#define VECTOR_STORE_H
+
+#include "hnsw_index.h"
+#include "thread_pool.h"
+#include "vector_segment.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief A record to upsert into the vector store
+ */
+struct VectorRecord {
+    std::string id;
+    std::vector<float> vector;
+    Metadata metadata;
+};
+
+/**
+ * @brief A single query result
+ */
+struct VectorQueryResult {
+    std::string id;
+    float distance;
+    Metadata metadata;
+};
+
+/**
+ * @brief Metadata equality conditions a result must all satisfy (chromadb `where`)
+ */
+using MetadataFilter = std::map<std::string, std::string>;
+
+/**
+ * @brief Vector store settings
+ */
+struct VectorStoreOptions {
+    std::string directory = "data/vectors";
+    uint32_t dim = 384;
+    DistanceMetric metric = DistanceMetric::Cosine;
+    HnswParams hnsw;
+    size_t efSearch = 64;
+    size_t compactionThreshold = 50000;    // Delta records that trigger a background compaction
+    int compactionIntervalSeconds = 60;    // Compact a non-empty delta at least this often
+    bool syncWrites = true;                // fdatasync the delta log after every write
+    QuantizerType quantization = QuantizerType::None;  // Codes searched in place of float vectors
+    uint32_t pqSubspaces = 0;              // PQ code bytes per vector (0 = dim / 4)
+    size_t rerankFactor = 4;               // Quantized candidates per result re-scored with float vectors
+    size_t flatScanThreshold = 5000;       // Scan namespaces (or segments) up to this many rows exactly
+    size_t searchThreads = 0;              // Flat-scan worker threads (0 = one per core)
+    std::vector<std::string> indexedMetadataKeys = {"namespace", "url", "query"};  // Keys with row bitmaps
+};
+
+/**
+ * @brief Vector store statistics
+ */
+struct VectorStoreStats {
+    uint64_t generation;
+    uint32_t segmentRows;
+    size_t segmentBytes;
+    size_t deltaRecords;
+    size_t codeBytesPerVector;    // Quantized code size, 0 when the segment is not quantized
+    double openMillis;
+    double lastCompactionMillis;
+    uint64_t compactions;
+};
+
+/**
+ * @brief Persistent vector store backed by an immutable mmap'd segment plus a delta
+ *
+ * Layout of the store directory:
+ *
+ *   CURRENT               name of the live segment file
+ *   segment-<gen>.dss     immutable segment (see VectorSegment)
+ *   delta-<gen>.log       CRC-checked log of writes not yet compacted
+ *
+ * Startup maps the live segment and replays the (bounded) delta log, so it
+ * takes milliseconds regardless of segment size. Writes append to the delta
+ * log and an in-memory delta; compaction folds the delta into a new segment
+ * in the background and swaps it in atomically via CURRENT.
+ */
+class VectorStore {
+public:
+    /**
+     * @brief Construct a new VectorStore object
+     */
+    VectorStore();
+
+    /**
+     * @brief Destroy the VectorStore object, stopping background compaction
+     */
+    ~VectorStore();
+
+    VectorStore(const VectorStore&) = delete;
+    VectorStore& operator=(const VectorStore&) = delete;
+
+    /**
+     * @brief Open (or create) a store directory
+     *
+     * @param options Store settings
+     * @return true if the store was opened
+     * @return false if the directory or live segment could not be used
+     */
+    bool open(const VectorStoreOptions& options);
+
+    /**
+     * @brief Stop background compaction and release the store
+     */
+    void close();
+
+    /**
+     * @brief Insert or replace a record
+     *
+     * @param record Record to store; its vector must match the store dimension
+     *               and its id must be 1 to 65535 bytes
+     * @return true if the write was logged
+     */
+    bool upsert(const VectorRecord& record);
+
+    /**
+     * @brief Normalize a record for this store and compute its content fingerprint
+     *
+     * Touches no shared state, so batches can be prepared in parallel before
+     * they reach upsertBatch.
+     *
+     * @param record Record to prepare in place; its vector must match the store dimension
+     * @return uint64_t Fingerprint of the stored vector and metadata
+     */
+    uint64_t prepareRecord(VectorRecord& record) const;
+
+    /**
+     * @brief Insert or replace a batch of prepared records with one log write and one sync
+     *
+     * Records whose fingerprint matches what is already stored under their
+     * id are skipped, so replaying a batch is idempotent and costs no I/O.
+     * Records are applied in order, so a later duplicate id wins.
+     *
+     * @param records Records passed through prepareRecord (moved from)
+     * @param fingerprints Fingerprint of each record
+     * @param written Receives the number of records actually written
+     * @return true if the batch was logged
+     */
+    bool upsertBatch(std::vector<VectorRecord>& records, const std::vector<uint64_t>& fingerprints,
+                     size_t* written = nullptr);
+
+    /**
+     * @brief Delete a record by id
+     *
+     * @param id Record id
+     * @return true if the delete was logged
+     */
+    bool remove(const std::string& id);
+
+    /**
+     * @brief Delete every record whose "namespace" metadata matches
+     *
+     * @param ns Namespace
+     * @return size_t Number of records deleted
+     */
+    size_t removeNamespace(const std::string& ns);
+
+    /**
+     * @brief Nearest-neighbour query
+     *
+     * @param vector Query vector
+     * @param k Number of results
+     * @param ns Only return records in this namespace (empty for all)
+     * @return std::vector<VectorQueryResult> Results ordered by ascending distance
+     */
+    std::vector<VectorQueryResult> query(const std::vector<float>& vector, size_t k,
+                                         const std::string& ns = "") const;
+
+    /**
+     * @brief Filtered nearest-neighbour query
+     *
+     * Conditions on indexed keys are resolved to row bitmaps and applied
+     * inside the graph traversal (or flat scan, when few rows match), so
+     * selective filters still return a full top-k. Other conditions are
+     * checked on each hit.
+     *
+     * @param vector Query vector
+     * @param k Number of results
+     * @param where Metadata conditions
+     * @return std::vector<VectorQueryResult> Results ordered by ascending distance
+     */
+    std::vector<VectorQueryResult> query(const std::vector<float>& vector, size_t k,
+                                         const MetadataFilter& where) const;
+
+    /**
+     * @brief Fold the delta into a new segment and swap it in
+     *
+     * Queries and writes continue while the new segment is built.
+     *
+     * @return true if compaction succeeded or there was nothing to compact
+     */
+    bool compact();
+
+    /**
+     * @brief Start the background compaction thread
+     */
+    void startBackgroundCompaction();
+
+    /**
+     * @brief Stop the background compaction thread
+     */
+    void stopBackgroundCompaction();
+
+    /**
+     * @brief Number of live records
+     */
+    size_t count() const;
+
+    /**
+     * @brief Current statistics
+     */
+    VectorStoreStats stats() const;
+
+    const VectorStoreOptions& options() const { return options_; }
+
+    /**
+     * @brief Worker pool, shared with the ingestion pipeline
+     */
+    ThreadPool* pool() const { return pool_.get(); }
+
+private:
+    struct DeltaEntry {
+        std::vector<float> vector;
+        Metadata metadata;
+        bool deleted;
+        uint64_t fingerprint;
+    };
+    using Delta = std::unordered_map<std::string, DeltaEntry>;
+
+    VectorStoreOptions options_;
+    std::unique_ptr<ThreadPool> pool_;
+    mutable std::shared_mutex mutex_;
+    std::shared_ptr<const VectorSegment> segment_;
+    Delta active_;    // Writes since the last compaction started
+    Delta frozen_;    // Writes being folded into the next segment
+    int logFd_;
+    uint64_t logGeneration_;
+
+    std::mutex compactMutex_;
+    std::mutex backgroundMutex_;
+    std::condition_variable backgroundCv_;
+    std::thread backgroundThread_;
+    bool backgroundRunning_;
+    bool compactionRequested_;
+
+    double openMillis_;
+    std::atomic<double> lastCompactionMillis_;
+    std::atomic<uint64_t> compactions_;
+
+    bool writeLog(const std::string& records);
+    bool replayLog(const std::string& path);
+    bool openLog(uint64_t generation);
+    std::string segmentPath(uint64_t generation) const;
+    std::string logPath(uint64_t generation) const;
+    const DeltaEntry* findDelta(const std::string& id) const;
+    bool storedFingerprint(const std::string& id, uint64_t& fingerprint) const;
+    std::vector<SearchHit> searchSegment(const VectorSegment& segment, const float* query, size_t k,
+                                         RowFilterFn filter, const void* filterContext) const;
+    bool encodeSegment(const VectorSegment* base, const std::vector<uint32_t>& remap, uint32_t survivors,
+                       const float* vectors, uint32_t total, VectorSegmentWriter& writer) const;
+    void backgroundLoop();
+};
+
+#endif // VECTOR_STORE_H
@@ -0,0 +1,65 @@
+#ifndef WORD_SPLITTER_H
+#define WORD_SPLITTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * @brief Splits text into normalized words the way BERT's uncased basic tokenizer does
+ *
+ * Control characters are dropped, whitespace separates words, text is
+ * lower-cased and stripped of accents, and every punctuation character or
+ * CJK ideograph becomes a word of its own. Words are produced one at a time
+ * into a fixed internal buffer, so splitting never allocates. Runs of ASCII
+ * letters and digits are classified and lower-cased 32 bytes at a time with
+ * AVX2 when the CPU supports it.
+ */
+class WordSplitter {
+public:
+    /** Words longer than this many characters are reported as overlong and not stored */
+    static const size_t kMaxWordChars = 100;
+
+    /**
+     * @brief Construct a WordSplitter over text (which must outlive it)
+     */
+    explicit WordSplitter(std::string_view text);
+
+    /**
+     * @brief Produce the next word
+     *
+     * @param word Receives the normalized UTF-8 word; valid until the next call.
+     *             Empty when the word is overlong.
+     * @return false at the end of the text
+     */
+    bool next(std::string_view& word);
+
+    /**
+     * @brief Whether the last word had more than kMaxWordChars characters
+     */
+    bool overlong() const { return chars_ > kMaxWordChars; }
+
+    /**
+     * @brief The bytes of the text the last word was read from, before normalization
+     */
+    std::string_view source() const { return std::string_view(start_, static_cast<size_t>(stop_ - start_)); }
+
+private:
+    const char* p_;
+    const char* end_;
+    size_t size_;
+    size_t chars_;
+    const char* start_;    // Source span of the word in progress
+    const char* stop_;
+    // A punctuation or CJK word that ended the previous word, emitted next
+    char pending_[4];
+    size_t pendingSize_;
+    const char* pendingStart_;
+    // Room for kMaxWordChars 4-byte characters plus one 32-byte SIMD store
+    char buffer_[kMaxWordChars * 4 + 64];
+
+    void append(uint32_t cp);
+    void appendAsciiRun();
+};
+
+#endif // WORD_SPLITTER_H
@@ -0,0 +1,100 @@
+#ifndef WORDPIECE_TOKENIZER_H
+#define WORDPIECE_TOKENIZER_H
+
+#include "double_array_trie.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief BERT (uncased) WordPiece tokenizer
+ *
+ * Matches HuggingFace's BertTokenizer with do_lower_case: control
+ * characters are dropped, CJK ideographs become single words, text is
+ * lower-cased and stripped of accents, words are split on punctuation and
+ * then into the longest vocabulary pieces ("##" marks continuations).
+ *
+ * Words come from WordSplitter and pieces from one walk of a double-array
+ * trie per piece, which remembers the longest match seen so far.
+ * Continuation pieces start from the trie node for "##". The
+ * buffer-based encode() does no heap allocation.
+ */
+class WordPieceTokenizer {
+public:
+    /**
+     * @brief Construct an empty WordPieceTokenizer object
+     */
+    WordPieceTokenizer();
+
+    /**
+     * @brief Load a vocab.txt (one token per line, id = line number)
+     *
+     * @param path Vocabulary file
+     * @return true if the vocabulary was loaded and has the special tokens
+     */
+    bool load(const std::string& path);
+
+    /**
+     * @brief Use an in-memory vocabulary (id = index)
+     *
+     * @param tokens Vocabulary tokens
+     * @return true if the vocabulary has the special tokens
+     */
+    bool setVocabulary(const std::vector<std::string>& tokens);
+
+    /**
+     * @brief Split text into WordPiece tokens
+     *
+     * @param text UTF-8 text
+     * @param pieces Receives the tokens
+     */
+    void tokenize(std::string_view text, std::vector<std::string>& pieces) const;
+
+    /**
+     * @brief Encode text into a caller-provided buffer, without special tokens
+     *
+     * Stops when the buffer is full; the ids written are always a prefix
+     * of the unbounded encoding.
+     *
+     * @param text UTF-8 text
+     * @param ids Receives the token ids
+     * @param capacity Size of @p ids
+     * @return size_t Number of ids written
+     */
+    size_t encode(std::string_view text, int32_t* ids, size_t capacity) const;
+
+    /**
+     * @brief Encode text as [CLS] pieces [SEP], truncated to @p maxLength ids
+     *
+     * @param text UTF-8 text
+     * @param maxLength Maximum number of ids including [CLS] and [SEP]
+     * @param ids Receives the token ids
+     */
+    void encode(std::string_view text, size_t maxLength, std::vector<int32_t>& ids) const;
+
+    /**
+     * @brief Id of a token, or -1 when it is not in the vocabulary
+     */
+    int32_t tokenId(std::string_view token) const;
+
+    /**
+     * @brief Token string of an id
+     */
+    const std::string& token(int32_t id) const { return tokens_[id]; }
+
+    size_t vocabularySize() const { return tokens_.size(); }
+
+private:
+    std::vector<std::string> tokens_;
+    DoubleArrayTrie trie_;
+    int32_t continuationNode_;
+    int32_t unknownId_;
+    int32_t clsId_;
+    int32_t sepId_;
+
+    size_t wordPiece(std::string_view word, int32_t* ids) const;
+};
+
+#endif // WORDPIECE_TOKENIZER_H
@@ -0,0 +1,128 @@
+#ifndef XML_READER_H
+#define XML_READER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Kind of token returned by XmlReader::next
+ */
+enum class XmlToken : uint8_t {
+    StartTag,   // <name attr="...">, or the first half of <name/>
+    EndTag,     // </name>, or the second half of <name/>
+    Text,       // Character data between tags, or a CDATA section's contents
+    End,        // End of the document
+    Error,      // Malformed markup; see error()
+};
+
+/**
+ * @brief Pull-style XML tokenizer
+ *
+ * Walks a document in one pass and hands out tags and text as views into it.
+ * Nothing is built or copied: the reader keeps a position and a nesting
+ * depth, so its memory is the same for any document size. Text is searched
+ * for the next '<' with memchr, which glibc vectorizes.
+ *
+ * The XML declaration, processing instructions, comments and the DOCTYPE
+ * (including an internal subset) are skipped, and whitespace outside the root
+ * element is dropped. Text comes back raw, with entities intact (see
+ * decodeXmlText). End tag names are not matched against their start tags,
+ * which would need a stack of names; only the depth is checked. Namespaces
+ * are not resolved: name() is the local name, prefix dropped.
+ *
+ * Not thread-safe.
+ */
+class XmlReader {
+public:
+    /**
+     * @brief Construct a new XmlReader object
+     *
+     * @param xml Document; must outlive the reader and its views
+     */
+    explicit XmlReader(std::string_view xml);
+
+    /**
+     * @brief Advance to the next token
+     */
+    XmlToken next();
+
+    /**
+     * @brief Local name of the current start or end tag (e.g. "date" for dc:date)
+     */
+    std::string_view name() const { return name_; }
+
+    /**
+     * @brief Raw text of the current Text token
+     */
+    std::string_view text() const { return text_; }
+
+    /**
+     * @brief Whether the current Text token is a CDATA section (no entities to decode)
+     */
+    bool cdata() const { return cdata_; }
+
+    /**
+     * @brief Look up an attribute of the current start tag
+     *
+     * @param name Qualified attribute name as written, e.g. "rel" or "xml:lang"
+     * @param value Receives the raw value, entities intact
+     * @return false if the tag has no such attribute
+     */
+    bool attribute(std::string_view name, std::string_view& value) const;
+
+    /**
+     * @brief Elements open at the current position; a start tag counts itself
+     */
+    size_t depth() const { return depth_; }
+
+    /**
+     * @brief Offset just past the current token; for a start tag, where its content begins
+     */
+    size_t offset() const { return pos_; }
+
+    /**
+     * @brief Offset of the '<' of the current tag
+     */
+    size_t tagOffset() const { return tagStart_; }
+
+    /**
+     * @brief Why the document was rejected, or "" if it was not
+     */
+    const char* error() const { return error_; }
+
+private:
+    std::string_view xml_;
+    size_t pos_;
+    size_t tagStart_;
+    size_t depth_;
+    std::string_view name_;
+    std::string_view text_;
+    std::string_view attributes_;
+    bool cdata_;
+    bool pendingEnd_;
+    const char* error_;
+
+    XmlToken fail(const char* message);
+    bool skipPast(std::string_view terminator);
+    bool skipDoctype();
+};
+
+/**
+ * @brief Text of an element's raw content, ready to display
+ *
+ * Entities (the five predefined ones and numeric character references) are
+ * decoded, CDATA sections kept as is, comments dropped and any nested tags
+ * read as whitespace, so mixed content such as "<i>E. coli</i> growth" or
+ * "<Year>2024</Year><Month>Jan</Month>" reads naturally. Runs of whitespace
+ * collapse to one space and the ends are trimmed. Unknown entities are left
+ * as written.
+ *
+ * @param raw Content between an element's start and end tags
+ * @param scratch Holds the result when it differs from raw
+ * @return std::string_view raw itself when nothing needed changing, else scratch
+ */
+std::string_view decodeXmlText(std::string_view raw, std::string& scratch);
+
+#endif // XML_READER_H
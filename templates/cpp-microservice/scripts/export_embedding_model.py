@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""Export a BERT-family sentence-transformers model for the native embedder.
+
+Writes <out>/model.dsem (the EmbeddingModel format) and <out>/vocab.txt.
+
+Usage:
+    python3 scripts/export_embedding_model.py                       all-MiniLM-L6-v2 -> models/all-MiniLM-L6-v2
+    python3 scripts/export_embedding_model.py <hf-model> <out-dir>
+"""
+import os, shutil, struct, sys
+
+import numpy as np
+from transformers import AutoModel, AutoTokenizer
+
+MAGIC = b"DSEMBED1"
+VERSION = 1
+HEADER_SIZE = 64
+
+
+def main():
+    name = sys.argv[1] if len(sys.argv) > 1 else "sentence-transformers/all-MiniLM-L6-v2"
+    out = sys.argv[2] if len(sys.argv) > 2 else os.path.join("models", name.split("/")[-1])
+    os.makedirs(out, exist_ok=True)
+
+    model = AutoModel.from_pretrained(name).eval()
+    tokenizer = AutoTokenizer.from_pretrained(name)
+    cfg = model.config
+    state = {k: v.detach().float().numpy() for k, v in model.state_dict().items()}
+
+    # Tensor order must match EmbeddingModel::load
+    names = [
+        "embeddings.word_embeddings.weight",
+        "embeddings.position_embeddings.weight",
+        "embeddings.token_type_embeddings.weight",
+        "embeddings.LayerNorm.weight",
+        "embeddings.LayerNorm.bias",
+    ]
+    for i in range(cfg.num_hidden_layers):
+        p = f"encoder.layer.{i}."
+        names += [p + s for s in (
+            "attention.self.query.weight", "attention.self.query.bias",
+            "attention.self.key.weight", "attention.self.key.bias",
+            "attention.self.value.weight", "attention.self.value.bias",
+            "attention.output.dense.weight", "attention.output.dense.bias",
+            "attention.output.LayerNorm.weight", "attention.output.LayerNorm.bias",
+            "intermediate.dense.weight", "intermediate.dense.bias",
+            "output.dense.weight", "output.dense.bias",
+            "output.LayerNorm.weight", "output.LayerNorm.bias",
+        )]
+
+    header = MAGIC + struct.pack(
+        "<8If", VERSION, cfg.vocab_size, cfg.hidden_size, cfg.num_hidden_layers, cfg.num_attention_heads,
+        cfg.intermediate_size, cfg.max_position_embeddings, cfg.type_vocab_size, cfg.layer_norm_eps)
+    header = header.ljust(HEADER_SIZE, b"\0")
+
+    path = os.path.join(out, "model.dsem")
+    with open(path + ".tmp", "wb") as f:
+        f.write(header)
+        for n in names:
+            f.write(np.ascontiguousarray(state[n], dtype="<f4").tobytes())
+    os.replace(path + ".tmp", path)
+
+    vocab = getattr(tokenizer, "vocab_file", None)
+    if vocab and os.path.exists(vocab):
+        shutil.copyfile(vocab, os.path.join(out, "vocab.txt"))
+    else:
+        tokens = sorted(tokenizer.get_vocab().items(), key=lambda kv: kv[1])
+        with open(os.path.join(out, "vocab.txt"), "w", encoding="utf-8") as f:
+            f.writelines(t + "\n" for t, _ in tokens)
+
+    print(f"Wrote {path} ({os.path.getsize(path) / 1e6:.1f} MB) and vocab.txt, "
+          f"{cfg.num_hidden_layers} layers x {cfg.hidden_size} hidden")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,261 @@
+#include "boilerplate_stripper.h"
+#include "unicode_util.h"
+#include <cstring>
+
+namespace {
+
+// Python's scraper drops at most this many list lines after a dropped line
+const int kMaxChildLines = 10;
+
+// Length of the leading run of Python whitespace
+size_t leadingSpace(std::string_view text) {
+    size_t pos = 0;
+    while (pos < text.size()) {
+        const unsigned char c = static_cast<unsigned char>(text[pos]);
+        if (c < 0x80) {
+            if (!isPythonWhitespace(c)) {
+                break;
+            }
+            ++pos;
+            continue;
+        }
+        const char* p = text.data() + pos;
+        if (!isPythonWhitespace(decodeUtf8(p, text.data() + text.size()))) {
+            break;
+        }
+        pos = p - text.data();
+    }
+    return pos;
+}
+
+// End of text once trailing Python whitespace is removed
+size_t trailingSpaceStart(std::string_view text) {
+    size_t end = text.size();
+    while (end > 0) {
+        const unsigned char c = static_cast<unsigned char>(text[end - 1]);
+        if (c < 0x80) {
+            if (!isPythonWhitespace(c)) {
+                break;
+            }
+            --end;
+            continue;
+        }
+        size_t start = end - 1;
+        while (start > 0 && (static_cast<unsigned char>(text[start]) & 0xC0) == 0x80) {
+            --start;
+        }
+        const char* p = text.data() + start;
+        if (!isPythonWhitespace(decodeUtf8(p, text.data() + end)) || p != text.data() + end) {
+            break;
+        }
+        end = start;
+    }
+    return end;
+}
+
+// str.strip()
+std::string_view stripSpace(std::string_view text) {
+    text.remove_prefix(leadingSpace(text));
+    return text.substr(0, trailingSpaceStart(text));
+}
+
+// `^(#{1,6})\s+` on a stripped line: the heading level and the text after it
+bool parseHeading(std::string_view line, size_t& level, std::string_view& text) {
+    size_t hashes = 0;
+    while (hashes < line.size() && hashes < 7 && line[hashes] == '#') {
+        ++hashes;
+    }
+    if (hashes == 0 || hashes > 6) {
+        return false;
+    }
+    const size_t space = leadingSpace(line.substr(hashes));
+    if (space == 0) {
+        return false;
+    }
+    level = hashes;
+    text = line.substr(hashes + space);
+    return true;
+}
+
+// A literal as a pattern
+std::string escapePattern(const std::string& literal) {
+    std::string pattern;
+    for (char c : literal) {
+        const unsigned char u = static_cast<unsigned char>(c);
+        if (u < 0x80 && !((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))) {
+            pattern.push_back('\\');
+        }
+        pattern.push_back(c);
+    }
+    return pattern;
+}
+
+} // namespace
+
+BoilerplateRules BoilerplateRules::crawler() {
+    BoilerplateRules rules;
+    rules.linePatterns = {
+        R"(^\[Jump to content\])", R"(^\[Skip to (content|main|navigation)\])",
+        R"(^Main menu$)", R"(^move to sidebar)", R"(^(Navigation|Contents|Menu)\s*$)",
+        R"(^\[.*?(Privacy|Terms|Cookie|Legal|Accessibility)\])",
+        R"(^(Cookie|Privacy|Terms|Legal|Accessibility)\b)",
+        R"(^(Theme|Language|Version)\s+(Auto|Light|Dark))",
+        R"(^(Previous|Next) topic)", R"(^Keyboard shortcuts$)",
+        R"(^Press .(←|→|S|\?|Esc). to)", R"(^\[.*?\]\(https?://.*?(privacy|terms|cookie)\))",
+        R"(^\[ Sign in \])", R"(^Sign in$)", R"(^Navigation Menu$)",
+        R"(^Toggle navigation$)", R"(^Search or jump to)",
+    };
+    rules.sections = {
+        "see also", "references", "external links", "further reading",
+        "notes", "footnotes", "citations", "bibliography", "navigation menu",
+    };
+    return rules;
+}
+
+BoilerplateRules BoilerplateRules::scraper() {
+    BoilerplateRules rules;
+    rules.linePatterns = {
+        R"(^\[Jump to content\])",
+        R"(^\[Skip to (content|main|navigation)\])",
+        R"(^Main menu$)",
+        R"(^move to sidebar (hide|show)$)",
+        R"(^(Navigation|Contents|Menu)\s*$)",
+        R"(^\[.*?(Privacy Policy|Terms of Service|Cookie Policy|Cookie Statement)\])",
+        R"(^(Cookie|Privacy|Terms|Legal|Accessibility)\b)",
+        R"(^\*\*Sponsored by:\*\*)",
+        R"(^(Theme|Language|Version)\s+(Auto|Light|Dark))",
+        R"(^(English|Spanish|French|German|Italian|Japanese|Korean|Chinese|Russian|Arabic|Portuguese|Polish|Turkish|Romanian|Greek|Dutch|Swedish|Norwegian|Danish|Finnish|Hungarian|Czech|Slovak|Ukrainian|Hebrew|Thai|Vietnamese|Indonesian|Malay|Hindi|Bengali|Tamil|Telugu|Marathi|Urdu|Persian)\s*[\|\\|])",
+        R"(^(Previous|Next) topic)",
+        R"(^\[.*?\]\(https?://.*?(privacy|terms|cookie|legal|accessibility)\))",
+    };
+    rules.sections = {
+        "see also", "references", "external links", "further reading",
+        "notes", "footnotes", "citations", "bibliography",
+        "navigation menu", "related articles",
+    };
+    rules.skipChildLines = true;
+    return rules;
+}
+
+BoilerplateRules BoilerplateRules::webApi() {
+    BoilerplateRules rules = crawler();
+    // The web API's copy predates the GitHub-style patterns
+    rules.linePatterns.resize(12);
+    return rules;
+}
+
+BoilerplateStripper::BoilerplateStripper() : skipChildLines_(false) {
+    setRules(BoilerplateRules::crawler());
+    // stripped[0] in (' ', '\t', '*', '-', '+') or re.match(r'^\d+\.', stripped)
+    childLines_.compile({R"([ \t*\-+])", R"(\d+\.)"});
+}
+
+bool BoilerplateStripper::setRules(const BoilerplateRules& rules) {
+    std::vector<std::string> sections;
+    for (const std::string& section : rules.sections) {
+        sections.push_back(escapePattern(section) + "$");
+    }
+    PatternAutomaton lines;
+    PatternAutomaton headings;
+    if (!lines.compile(rules.linePatterns, PatternAutomaton::kIgnoreCase) ||
+        !headings.compile(sections, PatternAutomaton::kLowerCase)) {
+        return false;
+    }
+    lines_ = std::move(lines);
+    sections_ = std::move(headings);
+    skipChildLines_ = rules.skipChildLines;
+    return true;
+}
+
+std::string BoilerplateStripper::strip(std::string_view markdown) const {
+    std::string out;
+    strip(markdown, out);
+    return out;
+}
+
+void BoilerplateStripper::strip(std::string_view markdown, std::string& out) const {
+    out.clear();
+    if (markdown.empty()) {
+        return;
+    }
+    out.reserve(markdown.size());
+
+    bool skipSection = false;
+    size_t skipLevel = 0;
+    int childLines = 0;
+    // '\n'.join(kept) with runs of three or more newlines squeezed to two as they are written
+    size_t newlines = 0;
+    bool first = true;
+    auto keep = [&](std::string_view line) {
+        if (!first && newlines < 2) {
+            out.push_back('\n');
+            ++newlines;
+        }
+        first = false;
+        if (!line.empty()) {
+            out.append(line.data(), line.size());
+            newlines = 0;
+        }
+    };
+
+    const char* data = markdown.data();
+    size_t pos = 0;
+    while (true) {
+        const void* newline = std::memchr(data + pos, '\n', markdown.size() - pos);
+        const size_t end = newline ? static_cast<const char*>(newline) - data : markdown.size();
+        const std::string_view line(data + pos, end - pos);
+        const std::string_view stripped = stripSpace(line);
+        pos = end + 1;
+
+        size_t level;
+        std::string_view heading;
+        bool drop = false;
+        if (!stripped.empty() && stripped[0] == '#' && parseHeading(stripped, level, heading)) {
+            childLines = 0;
+            if (skipSection && level <= skipLevel) {
+                skipSection = false;
+            }
+            if (sections_.matches(heading)) {
+                skipSection = true;
+                skipLevel = level;
+                drop = true;
+            }
+        }
+        drop = drop || skipSection;
+
+        if (!drop && skipChildLines_) {
+            if (childLines > 0) {
+                if (!stripped.empty() && childLines_.matches(stripped)) {
+                    --childLines;
+                    drop = true;
+                } else {
+                    childLines = 0;
+                }
+            }
+            if (!drop && !stripped.empty() && lines_.matches(stripped)) {
+                childLines = kMaxChildLines;
+                drop = true;
+            }
+        } else if (!drop) {
+            drop = !stripped.empty() && lines_.matches(stripped);
+        }
+        if (!drop) {
+            keep(line);
+        }
+        if (!newline) {
+            break;
+        }
+    }
+
+    // .strip(); squeezing first gives the same result since every newline
+    // run lies entirely inside or outside the trimmed ends
+    const size_t end = trailingSpaceStart(out);
+    out.resize(end);
+    const size_t begin = leadingSpace(out);
+    if (begin > 0) {
+        out.erase(0, begin);
+    }
+    if (out.empty()) {
+        out.assign(markdown.data(), markdown.size());
+    }
+}
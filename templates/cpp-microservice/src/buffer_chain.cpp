@@ -0,0 +1,71 @@
+#include "buffer_chain.h"
+#include <algorithm>
+
+BufferChain::BufferChain() : current_(0), cursor_(nullptr), end_(nullptr) {}
+
+size_t BufferChain::size() const {
+    if (blocks_.empty()) {
+        return 0;
+    }
+    size_t total = static_cast<size_t>(cursor_ - blocks_[current_].get());
+    for (size_t i = 0; i < current_; ++i) {
+        total += used_[i];
+    }
+    return total;
+}
+
+void BufferChain::clear() {
+    current_ = 0;
+    if (!blocks_.empty()) {
+        cursor_ = blocks_[0].get();
+        end_ = cursor_ + kBlockSize;
+    }
+}
+
+std::string_view BufferChain::block(size_t index) const {
+    const char* data = blocks_[index].get();
+    const size_t size = index < current_ ? used_[index] : static_cast<size_t>(cursor_ - data);
+    return std::string_view(data, size);
+}
+
+void BufferChain::appendTo(std::string& out) const {
+    out.reserve(out.size() + size());
+    for (size_t i = 0; i < blockCount(); ++i) {
+        out.append(block(i));
+    }
+}
+
+std::string BufferChain::str() const {
+    std::string out;
+    appendTo(out);
+    return out;
+}
+
+void BufferChain::nextBlock() {
+    if (!blocks_.empty()) {
+        // Remember how much of the block is used; a reserve() may leave a gap at its end
+        if (used_.size() <= current_) {
+            used_.resize(current_ + 1);
+        }
+        used_[current_] = static_cast<size_t>(cursor_ - blocks_[current_].get());
+        ++current_;
+    }
+    if (current_ == blocks_.size()) {
+        blocks_.emplace_back(new char[kBlockSize]);
+    }
+    cursor_ = blocks_[current_].get();
+    end_ = cursor_ + kBlockSize;
+}
+
+void BufferChain::appendSlow(const char* data, size_t size) {
+    while (size > 0) {
+        if (cursor_ == end_) {
+            nextBlock();
+        }
+        const size_t n = std::min(size, static_cast<size_t>(end_ - cursor_));
+        std::memcpy(cursor_, data, n);
+        cursor_ += n;
+        data += n;
+        size -= n;
+    }
+}
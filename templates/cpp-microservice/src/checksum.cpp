@@ -0,0 +1,54 @@
+#include "checksum.h"
+#include <cstring>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#else
+namespace {
+
+struct Crc32cTable {
+    uint32_t entries[256];
+
+    Crc32cTable() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : (c >> 1);
+            }
+            entries[i] = c;
+        }
+    }
+};
+
+const Crc32cTable& table() {
+    static const Crc32cTable instance;
+    return instance;
+}
+
+} // namespace
+#endif
+
+uint32_t crc32c(const void* data, size_t len, uint32_t crc) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+
+#if defined(__SSE4_2__)
+    while (len >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        crc = static_cast<uint32_t>(_mm_crc32_u64(crc, word));
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+#else
+    const uint32_t* t = table().entries;
+    while (len--) {
+        crc = t[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+#endif
+
+    return ~crc;
+}
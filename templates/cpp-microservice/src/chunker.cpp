@@ -0,0 +1,315 @@
+#include "chunker.h"
+#include "unicode_util.h"
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Python drops a trailing character window shorter than this
+const size_t kMinTrailingChars = 100;
+
+// Bytes of the whitespace character at pos, or 0. Sets incomplete when a
+// multi-byte sequence runs past the end of the buffer.
+size_t spaceLength(std::string_view text, size_t pos, bool& incomplete) {
+    const unsigned char c = static_cast<unsigned char>(text[pos]);
+    if (c < 0x80) {
+        return isPythonWhitespace(c) ? 1 : 0;
+    }
+    const size_t length = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : 2;
+    if (pos + length > text.size()) {
+        incomplete = true;
+        return 0;
+    }
+    const char* p = text.data() + pos;
+    return isPythonWhitespace(decodeUtf8(p, text.data() + text.size())) ? length : 0;
+}
+
+inline bool isLeadByte(char c) {
+    return (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+}
+
+size_t scalarCountCodePoints(const char* p, size_t n) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; ++i) {
+        count += isLeadByte(p[i]);
+    }
+    return count;
+}
+
+size_t scalarFindTerminator(const char* p, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (p[i] == '.' || p[i] == '!' || p[i] == '?') {
+            return i;
+        }
+    }
+    return n;
+}
+
+typedef size_t (*CountKernel)(const char* p, size_t n);
+typedef size_t (*FindKernel)(const char* p, size_t n);
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// Lead bytes are those above 0xBF as signed (-65): ASCII and 0xC0..0xFF
+__attribute__((target("avx2,popcnt"))) size_t avx2CountCodePoints(const char* p, size_t n) {
+    const __m256i continuation = _mm256_set1_epi8(static_cast<char>(0xBF));
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        count += _mm_popcnt_u32(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(bytes, continuation))));
+    }
+    return count + scalarCountCodePoints(p + i, n - i);
+}
+
+__attribute__((target("avx2,bmi"))) size_t avx2FindTerminator(const char* p, size_t n) {
+    const __m256i period = _mm256_set1_epi8('.');
+    const __m256i exclamation = _mm256_set1_epi8('!');
+    const __m256i question = _mm256_set1_epi8('?');
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, period),
+                                                       _mm256_cmpeq_epi8(bytes, exclamation)),
+                                       _mm256_cmpeq_epi8(bytes, question));
+        const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+        if (mask != 0) {
+            return i + _tzcnt_u32(mask);
+        }
+    }
+    return i + scalarFindTerminator(p + i, n - i);
+}
+
+bool hasAvx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi") && __builtin_cpu_supports("popcnt");
+}
+
+const bool kAvx2 = hasAvx2();
+const CountKernel kCountCodePoints = kAvx2 ? avx2CountCodePoints : scalarCountCodePoints;
+const FindKernel kFindTerminator = kAvx2 ? avx2FindTerminator : scalarFindTerminator;
+
+#else
+
+const CountKernel kCountCodePoints = scalarCountCodePoints;
+const FindKernel kFindTerminator = scalarFindTerminator;
+
+#endif
+
+// Moves pos forward by up to count code points, skipping whole 32-byte
+// blocks by their lead-byte count; returns how many were skipped
+size_t advanceCodePoints(std::string_view text, size_t& pos, size_t count) {
+    size_t skipped = 0;
+    while (pos + 32 <= text.size()) {
+        const size_t leads = kCountCodePoints(text.data() + pos, 32);
+        if (skipped + leads > count) {
+            break;
+        }
+        skipped += leads;
+        pos += 32;
+    }
+    // Stop on the lead byte of the code point after the last one skipped
+    while (pos < text.size()) {
+        if (isLeadByte(text[pos])) {
+            if (skipped == count) {
+                break;
+            }
+            ++skipped;
+        }
+        ++pos;
+    }
+    return skipped;
+}
+
+} // namespace
+
+Chunker::Chunker(const ChunkerOptions& options) : options_(options) {
+    reset();
+}
+
+void Chunker::reset() {
+    buffer_.clear();
+    joined_.clear();
+    emitted_ = 0;
+    done_ = false;
+    start_ = 0;
+    end_ = 0;
+    windowChars_ = 0;
+    sentences_.clear();
+    currentChars_ = 0;
+    sentenceStart_ = 0;
+    searchFrom_ = 0;
+}
+
+void Chunker::split(std::string_view text, std::vector<std::string_view>& chunks) {
+    chunks.clear();
+    reset();
+    process(text, true, [&chunks](std::string_view chunk) { chunks.push_back(chunk); }, true);
+}
+
+void Chunker::split(std::string_view text, const ChunkCallback& emit) {
+    reset();
+    process(text, true, emit, false);
+    reset();
+}
+
+void Chunker::feed(std::string_view data, const ChunkCallback& emit) {
+    buffer_.append(data.data(), data.size());
+    const size_t consumed = process(buffer_, false, emit, false);
+    buffer_.erase(0, consumed);
+    shift(consumed);
+}
+
+void Chunker::finish(const ChunkCallback& emit) {
+    process(buffer_, true, emit, false);
+    reset();
+}
+
+size_t Chunker::process(std::string_view text, bool final, const ChunkCallback& emit, bool keepJoined) {
+    return options_.overlapChars > 0 ? processWindows(text, final, emit)
+                                     : processSentences(text, final, emit, keepJoined);
+}
+
+void Chunker::shift(size_t consumed) {
+    start_ -= consumed;
+    end_ -= consumed;
+    sentenceStart_ -= consumed;
+    searchFrom_ -= consumed;
+    for (Sentence& sentence : sentences_) {
+        sentence.begin -= consumed;
+        sentence.end -= consumed;
+    }
+}
+
+size_t Chunker::processWindows(std::string_view text, bool final, const ChunkCallback& emit) {
+    const size_t size = options_.chunkSize;
+    const size_t step = options_.overlapChars < size ? size - options_.overlapChars : 1;
+    while (!done_) {
+        // Also steps over continuation bytes of the last code point that
+        // arrived after the previous piece
+        windowChars_ += advanceCodePoints(text, end_, size - windowChars_);
+        // Streaming: the window is only known to be complete once the next
+        // code point has started, since its last one may still be arriving
+        if (!final && (windowChars_ < size || end_ >= text.size())) {
+            return start_;
+        }
+        if (start_ >= text.size()) {
+            // Past the end: an empty text still yields one (empty) chunk
+            if (emitted_ == 0) {
+                emit(std::string_view());
+                ++emitted_;
+            }
+            done_ = true;
+            break;
+        }
+        if (windowChars_ < kMinTrailingChars && emitted_ > 0) {
+            done_ = true;
+            break;
+        }
+        emit(text.substr(start_, end_ - start_));
+        ++emitted_;
+
+        const size_t skipped = advanceCodePoints(text, start_, step);
+        if (start_ >= end_) {
+            end_ = start_;
+            windowChars_ = 0;
+        } else {
+            windowChars_ -= skipped;
+        }
+    }
+    // Once done, the rest of the input is irrelevant
+    return text.size();
+}
+
+size_t Chunker::processSentences(std::string_view text, bool final, const ChunkCallback& emit, bool keepJoined) {
+    size_t from = searchFrom_;
+    while (true) {
+        const size_t terminator = from + kFindTerminator(text.data() + from, text.size() - from);
+        if (terminator >= text.size()) {
+            if (!final) {
+                searchFrom_ = text.size();
+                break;
+            }
+            addSentence(text, sentenceStart_, text.size(), emit, keepJoined);
+            if (!sentences_.empty()) {
+                emitSentences(text, emit, keepJoined);
+            }
+            return text.size();
+        }
+
+        // The separator is the whole whitespace run after the terminator
+        size_t run = terminator + 1;
+        bool incomplete = false;
+        while (run < text.size()) {
+            const size_t length = spaceLength(text, run, incomplete);
+            if (length == 0) {
+                break;
+            }
+            run += length;
+        }
+        if (!final && (run >= text.size() || incomplete)) {
+            // The run may continue (or start) in the next piece
+            searchFrom_ = terminator;
+            break;
+        }
+        if (run > terminator + 1) {
+            addSentence(text, sentenceStart_, terminator + 1, emit, keepJoined);
+            sentenceStart_ = run;
+        }
+        from = run;
+    }
+    return sentences_.empty() ? sentenceStart_ : sentences_.front().begin;
+}
+
+void Chunker::addSentence(std::string_view text, size_t begin, size_t end, const ChunkCallback& emit,
+                          bool keepJoined) {
+    const size_t chars = kCountCodePoints(text.data() + begin, end - begin);
+    if (currentChars_ + chars > options_.chunkSize && !sentences_.empty()) {
+        emitSentences(text, emit, keepJoined);
+        // Python keeps current[-k:] when it is shorter than the chunk, else
+        // nothing; for k = 0 that slice is the whole list
+        const size_t overlap = options_.overlapSentences;
+        if (overlap > 0) {
+            if (sentences_.size() > overlap) {
+                sentences_.erase(sentences_.begin(), sentences_.end() - static_cast<std::ptrdiff_t>(overlap));
+            } else {
+                sentences_.clear();
+            }
+            currentChars_ = 0;
+            for (const Sentence& sentence : sentences_) {
+                currentChars_ += sentence.chars;
+            }
+        }
+    }
+    sentences_.push_back({begin, end, chars});
+    currentChars_ += chars;
+}
+
+void Chunker::emitSentences(std::string_view text, const ChunkCallback& emit, bool keepJoined) {
+    bool contiguous = true;
+    for (size_t i = 0; i + 1 < sentences_.size() && contiguous; ++i) {
+        const size_t gap = sentences_[i].end;
+        contiguous = sentences_[i + 1].begin == gap + 1 && text[gap] == ' ';
+    }
+    ++emitted_;
+    if (contiguous) {
+        emit(text.substr(sentences_.front().begin, sentences_.back().end - sentences_.front().begin));
+        return;
+    }
+
+    // Separators other than one space are normalized to one, as " ".join does
+    joined_.emplace_back();
+    std::string& out = joined_.back();
+    for (size_t i = 0; i < sentences_.size(); ++i) {
+        if (i > 0) {
+            out.push_back(' ');
+        }
+        out.append(text.data() + sentences_[i].begin, sentences_[i].end - sentences_[i].begin);
+    }
+    emit(out);
+    if (!keepJoined) {
+        joined_.clear();
+    }
+}
@@ -0,0 +1,484 @@
+#include "completion_cache.h"
+#include "hash.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+// List node, index node and the shared string's control block, as libstdc++ lays them out on x86-64
+const size_t kEntryOverhead = 256;
+// Sketch counters per byte of shard: 16 (one word) for each 1 KiB, several per response so collisions stay rare
+const size_t kBytesPerCounter = 64;
+const size_t kMinCounters = 4096;
+// The sketch halves once it has counted this many lookups per counter
+const size_t kSampleFactor = 10;
+
+void hashField(Sha256& sha, std::string_view field) {
+    uint8_t length[8];
+    uint64_t size = field.size();
+    for (int i = 0; i < 8; ++i) {
+        length[i] = static_cast<uint8_t>(size >> (8 * i));
+    }
+    sha.update(length, sizeof(length));
+    sha.update(field.data(), field.size());
+}
+
+int hexDigit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+uint64_t keyWord(const CompletionKey& key, size_t offset) {
+    uint64_t word;
+    std::memcpy(&word, key.bytes + offset, sizeof(word));
+    return word;
+}
+
+} // namespace
+
+bool CompletionKey::operator==(const CompletionKey& other) const {
+    return std::memcmp(bytes, other.bytes, sizeof(bytes)) == 0;
+}
+
+std::string CompletionKey::hex() const {
+    return toHex(bytes, sizeof(bytes));
+}
+
+bool CompletionKey::fromHex(std::string_view text, CompletionKey& key) {
+    if (text.size() != 2 * sizeof(key.bytes)) {
+        return false;
+    }
+    for (size_t i = 0; i < sizeof(key.bytes); ++i) {
+        const int high = hexDigit(text[2 * i]);
+        const int low = hexDigit(text[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        key.bytes[i] = static_cast<uint8_t>(high << 4 | low);
+    }
+    return true;
+}
+
+size_t CompletionCache::KeyHash::operator()(const CompletionKey& key) const {
+    // The key is a SHA-256 already; the shard index uses bytes 0-7, the sketch 16-31
+    return static_cast<size_t>(keyWord(key, 8));
+}
+
+CompletionCache::FrequencySketch::FrequencySketch(size_t counters) : additions_(0) {
+    size_t size = kMinCounters;
+    while (size < counters) {
+        size <<= 1;
+    }
+    table_.assign(size / 16, 0);
+    mask_ = size - 1;
+    sampleSize_ = kSampleFactor * size;
+}
+
+void CompletionCache::FrequencySketch::increment(const CompletionKey& key) {
+    const uint64_t h1 = keyWord(key, 16);
+    const uint64_t h2 = keyWord(key, 24) | 1;
+    bool added = false;
+    for (uint64_t i = 0; i < 4; ++i) {
+        const size_t counter = static_cast<size_t>(h1 + i * h2) & mask_;
+        uint64_t& word = table_[counter >> 4];
+        const unsigned shift = static_cast<unsigned>(counter & 15) * 4;
+        if (((word >> shift) & 15) != 15) {
+            word += uint64_t(1) << shift;
+            added = true;
+        }
+    }
+    if (added && ++additions_ >= sampleSize_) {
+        halve();
+    }
+}
+
+unsigned CompletionCache::FrequencySketch::frequency(const CompletionKey& key) const {
+    const uint64_t h1 = keyWord(key, 16);
+    const uint64_t h2 = keyWord(key, 24) | 1;
+    unsigned least = 15;
+    for (uint64_t i = 0; i < 4; ++i) {
+        const size_t counter = static_cast<size_t>(h1 + i * h2) & mask_;
+        const unsigned shift = static_cast<unsigned>(counter & 15) * 4;
+        least = std::min(least, static_cast<unsigned>((table_[counter >> 4] >> shift) & 15));
+    }
+    return least;
+}
+
+void CompletionCache::FrequencySketch::halve() {
+    for (uint64_t& word : table_) {
+        word = (word >> 1) & 0x7777777777777777ULL;
+    }
+    additions_ /= 2;
+}
+
+CompletionCache::CompletionCache(const CompletionCacheOptions& options)
+    : options_(options), hits_(0), misses_(0), expired_(0), inserts_(0), evictions_(0), rejected_(0), spillHits_(0),
+      spillWrites_(0) {
+    // Every shard gets an equal slice of maxBytes, split between its window and main regions
+    options_.shards = std::max<size_t>(options_.shards, 1);
+    shardBytes_ = options_.maxBytes / options_.shards;
+    windowBytes_ = static_cast<size_t>(static_cast<double>(shardBytes_) * std::min(options_.windowRatio, 1.0));
+    protectedBytes_ = static_cast<size_t>(static_cast<double>(shardBytes_ - windowBytes_) *
+                                          std::min(options_.protectedRatio, 1.0));
+    shards_.reserve(options_.shards);
+    for (size_t i = 0; i < options_.shards; ++i) {
+        shards_.emplace_back(new Shard(shardBytes_ / kBytesPerCounter));
+    }
+}
+
+CompletionKey CompletionCache::key(std::string_view provider, const std::vector<CompletionMessage>& messages,
+                                   std::string_view settings) {
+    Sha256 sha;
+    hashField(sha, provider);
+    hashField(sha, std::to_string(messages.size()));
+    for (const CompletionMessage& message : messages) {
+        hashField(sha, message.role);
+        hashField(sha, message.content);
+    }
+    hashField(sha, settings);
+    CompletionKey key;
+    sha.finish(key.bytes);
+    return key;
+}
+
+void CompletionCache::appendSetting(std::string& settings, std::string_view name, std::string_view value) {
+    for (std::string_view field : {name, value}) {
+        const uint64_t size = field.size();
+        for (int i = 0; i < 8; ++i) {
+            settings += static_cast<char>(size >> (8 * i));
+        }
+        settings.append(field.data(), field.size());
+    }
+}
+
+CompletionCache::Shard& CompletionCache::shardOf(const CompletionKey& key) const {
+    return *shards_[keyWord(key, 0) % shards_.size()];
+}
+
+CompletionCache::EntryList& CompletionCache::listOf(Shard& shard, Region region) {
+    switch (region) {
+    case Region::Window:
+        return shard.window;
+    case Region::Probation:
+        return shard.probation;
+    default:
+        return shard.protectedList;
+    }
+}
+
+size_t& CompletionCache::bytesOf(Shard& shard, Region region) {
+    switch (region) {
+    case Region::Window:
+        return shard.windowBytes;
+    case Region::Probation:
+        return shard.probationBytes;
+    default:
+        return shard.protectedBytes;
+    }
+}
+
+void CompletionCache::eraseLocked(Shard& shard, EntryList::iterator it) {
+    bytesOf(shard, it->region) -= it->bytes;
+    shard.index.erase(it->key);
+    listOf(shard, it->region).erase(it);
+}
+
+std::shared_ptr<const std::string> CompletionCache::get(const CompletionKey& key, uint64_t nowMillis) {
+    Shard& shard = shardOf(key);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.sketch.increment(key);
+        auto found = shard.index.find(key);
+        if (found != shard.index.end()) {
+            EntryList::iterator it = found->second;
+            if (it->expiresAt > nowMillis) {
+                hits_.fetch_add(1, std::memory_order_relaxed);
+                if (it->region == Region::Window) {
+                    shard.window.splice(shard.window.begin(), shard.window, it);
+                } else if (it->region == Region::Protected) {
+                    shard.protectedList.splice(shard.protectedList.begin(), shard.protectedList, it);
+                } else {
+                    // A hit on probation promotes; the protected segment's oldest go back on probation
+                    shard.protectedList.splice(shard.protectedList.begin(), shard.probation, it);
+                    it->region = Region::Protected;
+                    shard.probationBytes -= it->bytes;
+                    shard.protectedBytes += it->bytes;
+                    while (shard.protectedBytes > protectedBytes_ && shard.protectedList.size() > 1) {
+                        EntryList::iterator demoted = std::prev(shard.protectedList.end());
+                        shard.probation.splice(shard.probation.begin(), shard.protectedList, demoted);
+                        demoted->region = Region::Probation;
+                        shard.protectedBytes -= demoted->bytes;
+                        shard.probationBytes += demoted->bytes;
+                    }
+                }
+                return it->value;
+            }
+            expired_.fetch_add(1, std::memory_order_relaxed);
+            eraseLocked(shard, it);
+        }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+
+    std::shared_ptr<const CompletionSpill> tier = spill();
+    if (!tier || !tier->get) {
+        return nullptr;
+    }
+    std::string value;
+    uint64_t ttl = 0;
+    try {
+        if (!tier->get(key.hex(), value, ttl)) {
+            return nullptr;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Completion cache spill read failed: " << e.what() << std::endl;
+        return nullptr;
+    }
+    spillHits_.fetch_add(1, std::memory_order_relaxed);
+    ttl = ttl == 0 ? options_.ttlMillis : std::min(ttl, options_.ttlMillis);
+    std::shared_ptr<const std::string> response = std::make_shared<const std::string>(std::move(value));
+    std::vector<Spilled> spilled;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        insertLocked(shard, key, response, nowMillis + ttl, nowMillis, spilled);
+    }
+    writeSpilled(spilled);
+    return response;
+}
+
+bool CompletionCache::put(const CompletionKey& key, std::string response, uint64_t nowMillis, uint64_t ttlMillis) {
+    const uint64_t ttl = ttlMillis == 0 ? options_.ttlMillis : ttlMillis;
+    std::shared_ptr<const std::string> value = std::make_shared<const std::string>(std::move(response));
+    Shard& shard = shardOf(key);
+    std::vector<Spilled> spilled;
+    bool cached;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        cached = insertLocked(shard, key, value, nowMillis + ttl, nowMillis, spilled);
+    }
+    inserts_.fetch_add(1, std::memory_order_relaxed);
+    if (!cached) {
+        spilled.push_back(Spilled{key, value, ttl});
+    }
+    writeSpilled(spilled);
+    return cached;
+}
+
+bool CompletionCache::insertLocked(Shard& shard, const CompletionKey& key, std::shared_ptr<const std::string> value,
+                                   uint64_t expiresAt, uint64_t nowMillis, std::vector<Spilled>& spilled) {
+    auto found = shard.index.find(key);
+    if (found != shard.index.end()) {
+        // A replaced response starts over in the window; its sketch count carries it back into the main space
+        eraseLocked(shard, found->second);
+    }
+    const size_t bytes = kEntryOverhead + value->size();
+    if (bytes > shardBytes_ - windowBytes_) {
+        return false;
+    }
+    shard.window.push_front(Entry{key, std::move(value), bytes, expiresAt, Region::Window});
+    shard.index.emplace(key, shard.window.begin());
+    shard.windowBytes += bytes;
+    admitLocked(shard, nowMillis, spilled);
+    return true;
+}
+
+// Moves the window's oldest entries to probation while the window is over its size, if the sketch admits them
+void CompletionCache::admitLocked(Shard& shard, uint64_t nowMillis, std::vector<Spilled>& spilled) {
+    const size_t mainBytes = shardBytes_ - windowBytes_;
+    std::vector<EntryList::iterator> victims;
+    while (shard.windowBytes > windowBytes_ && !shard.window.empty()) {
+        EntryList::iterator candidate = std::prev(shard.window.end());
+        if (candidate->expiresAt <= nowMillis) {
+            eraseLocked(shard, candidate);
+            continue;
+        }
+
+        // Entries differ in size, so the candidate may have to displace several; it must beat each of them
+        const unsigned candidateFrequency = shard.sketch.frequency(candidate->key);
+        size_t freed = 0;
+        bool admit = true;
+        victims.clear();
+        EntryList* lists[] = {&shard.probation, &shard.protectedList};
+        for (EntryList* list : lists) {
+            for (auto it = list->rbegin(); admit && it != list->rend(); ++it) {
+                if (shard.probationBytes + shard.protectedBytes - freed + candidate->bytes <= mainBytes) {
+                    break;
+                }
+                if (it->expiresAt > nowMillis && shard.sketch.frequency(it->key) >= candidateFrequency) {
+                    admit = false;
+                }
+                victims.push_back(std::prev(it.base()));
+                freed += it->bytes;
+            }
+        }
+
+        if (!admit) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            spilled.push_back(Spilled{candidate->key, candidate->value, candidate->expiresAt - nowMillis});
+            eraseLocked(shard, candidate);
+            continue;
+        }
+        for (EntryList::iterator victim : victims) {
+            if (victim->expiresAt > nowMillis) {
+                evictions_.fetch_add(1, std::memory_order_relaxed);
+                spilled.push_back(Spilled{victim->key, victim->value, victim->expiresAt - nowMillis});
+            }
+            eraseLocked(shard, victim);
+        }
+        shard.probation.splice(shard.probation.begin(), shard.window, candidate);
+        candidate->region = Region::Probation;
+        shard.windowBytes -= candidate->bytes;
+        shard.probationBytes += candidate->bytes;
+    }
+}
+
+bool CompletionCache::remove(const CompletionKey& key) {
+    Shard& shard = shardOf(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.index.find(key);
+    if (found == shard.index.end()) {
+        return false;
+    }
+    eraseLocked(shard, found->second);
+    return true;
+}
+
+void CompletionCache::setSpill(const CompletionSpill& spill) {
+    std::shared_ptr<const CompletionSpill> tier =
+        spill.get || spill.set ? std::make_shared<const CompletionSpill>(spill) : nullptr;
+    std::lock_guard<std::mutex> lock(spillMutex_);
+    spill_ = tier;
+}
+
+std::shared_ptr<const CompletionSpill> CompletionCache::spill() const {
+    std::lock_guard<std::mutex> lock(spillMutex_);
+    return spill_;
+}
+
+void CompletionCache::writeSpilled(const std::vector<Spilled>& spilled) {
+    if (spilled.empty()) {
+        return;
+    }
+    std::shared_ptr<const CompletionSpill> tier = spill();
+    if (!tier || !tier->set) {
+        return;
+    }
+    for (const Spilled& item : spilled) {
+        try {
+            tier->set(item.key.hex(), *item.value, item.ttlMillis);
+            spillWrites_.fetch_add(1, std::memory_order_relaxed);
+        } catch (const std::exception& e) {
+            std::cerr << "Completion cache spill write failed: " << e.what() << std::endl;
+        }
+    }
+}
+
+CompletionCacheStats CompletionCache::stats() const {
+    CompletionCacheStats s;
+    s.capacityBytes = shardBytes_ * shards_.size();
+    s.hits = hits_.load(std::memory_order_relaxed);
+    s.misses = misses_.load(std::memory_order_relaxed);
+    s.expired = expired_.load(std::memory_order_relaxed);
+    s.inserts = inserts_.load(std::memory_order_relaxed);
+    s.evictions = evictions_.load(std::memory_order_relaxed);
+    s.rejected = rejected_.load(std::memory_order_relaxed);
+    s.spillHits = spillHits_.load(std::memory_order_relaxed);
+    s.spillWrites = spillWrites_.load(std::memory_order_relaxed);
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        s.entries += shard->index.size();
+        s.bytes += shard->windowBytes + shard->probationBytes + shard->protectedBytes;
+    }
+    return s;
+}
+
+std::string CompletionCache::respCommand(const std::vector<std::string_view>& arguments) {
+    std::string out = "*" + std::to_string(arguments.size()) + "\r\n";
+    for (std::string_view argument : arguments) {
+        out += "$" + std::to_string(argument.size()) + "\r\n";
+        out.append(argument.data(), argument.size());
+        out += "\r\n";
+    }
+    return out;
+}
+
+bool CompletionCache::parseRespReply(std::string_view& replies, std::string& value, char& type) {
+    const size_t end = replies.find("\r\n");
+    if (replies.empty() || end == std::string_view::npos) {
+        return false;
+    }
+    type = replies[0];
+    const std::string_view line = replies.substr(1, end - 1);
+    if (type == '+' || type == '-' || type == ':') {
+        value.assign(line.data(), line.size());
+        replies.remove_prefix(end + 2);
+        return true;
+    }
+    if (type != '$') {
+        return false;
+    }
+    if (line == "-1") {
+        type = '_';
+        value.clear();
+        replies.remove_prefix(end + 2);
+        return true;
+    }
+    if (line.empty() || line.size() > 10 || line.find_first_not_of("0123456789") != std::string_view::npos) {
+        return false;
+    }
+    const size_t size = std::stoul(std::string(line));
+    if (replies.size() < end + 2 + size + 2 || replies.compare(end + 2 + size, 2, "\r\n") != 0) {
+        return false;
+    }
+    value.assign(replies.data() + end + 2, size);
+    replies.remove_prefix(end + 2 + size + 2);
+    return true;
+}
+
+CompletionSpill CompletionCache::redisSpill(const RespTransport& transport, const std::string& keyPrefix) {
+    CompletionSpill spill;
+    spill.get = [transport, keyPrefix](const std::string& key, std::string& value, uint64_t& ttlMillis) {
+        const std::string name = keyPrefix + key;
+        std::string replies;
+        if (!transport(respCommand({"GET", name}) + respCommand({"PTTL", name}), replies)) {
+            return false;
+        }
+        std::string_view rest(replies);
+        std::string ttl;
+        char getType;
+        char ttlType;
+        if (!parseRespReply(rest, value, getType) || !parseRespReply(rest, ttl, ttlType)) {
+            std::cerr << "Completion cache spill: malformed reply to GET" << std::endl;
+            return false;
+        }
+        if (getType == '-' || ttlType == '-') {
+            std::cerr << "Completion cache spill: " << (getType == '-' ? value : ttl) << std::endl;
+            return false;
+        }
+        // PTTL is -1 for a key without expiry, -2 if it expired between the two commands
+        ttlMillis = ttlType == ':' && !ttl.empty() && ttl[0] != '-' ? std::stoull(ttl) : 0;
+        return getType == '$' && !(ttlType == ':' && ttl == "-2");
+    };
+    spill.set = [transport, keyPrefix](const std::string& key, const std::string& value, uint64_t ttlMillis) {
+        const std::string ttl = std::to_string(std::max<uint64_t>(ttlMillis, 1));
+        std::string replies;
+        if (!transport(respCommand({"SET", keyPrefix + key, value, "PX", ttl}), replies)) {
+            return;
+        }
+        std::string_view rest(replies);
+        std::string status;
+        char type;
+        if (!parseRespReply(rest, status, type) || type != '+') {
+            std::cerr << "Completion cache spill: SET failed: " << status << std::endl;
+        }
+    };
+    return spill;
+}
@@ -0,0 +1,174 @@
+#include "completion_cache_service.h"
+#include "config_manager.h"
+#include "json_util.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+
+typedef std::map<std::string, std::string> Params;
+
+// Parameters of the cache routes themselves; every other one besides provider and messages keys the request
+const char* const kCacheParams[] = {"key", "response", "ttl_s"};
+
+std::string param(const Params& params, const std::string& key, const std::string& defaultValue = "") {
+    auto it = params.find(key);
+    return it != params.end() ? it->second : defaultValue;
+}
+
+std::string error(const std::string& message) {
+    std::string out = "{\"error\": ";
+    appendJsonString(out, message);
+    out += "}";
+    return out;
+}
+
+uint64_t steadyMillis() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
+
+// Key of the completion request in params; returns an error message, or "" on success
+std::string requestKey(const Params& params, CompletionKey& key) {
+    const std::string provider = param(params, "provider");
+    if (provider.empty()) {
+        return "provider required";
+    }
+    const std::string prefix = "messages.";
+    std::map<size_t, CompletionMessage> messages;
+    for (auto it = params.lower_bound(prefix); it != params.end() && it->first.compare(0, prefix.size(), prefix) == 0;
+         ++it) {
+        const std::string& name = it->first;
+        const size_t dot = name.find('.', prefix.size());
+        size_t index;
+        const std::string_view digits = std::string_view(name).substr(prefix.size(), dot - prefix.size());
+        if (dot == std::string::npos || !parseParamIndex(digits, kMaxParamIndex, index)) {
+            return "bad index";
+        }
+        const std::string_view field = std::string_view(name).substr(dot + 1);
+        if (field == "role") {
+            messages[index].role = it->second;
+        } else if (field == "content") {
+            messages[index].content = it->second;
+        } else {
+            // Multi-part content and tool calls are not keyed; such requests bypass the cache
+            return "unsupported message field " + name.substr(0, 64);
+        }
+    }
+    if (messages.empty()) {
+        return "messages.<i>.role and messages.<i>.content required";
+    }
+    std::vector<CompletionMessage> ordered;
+    ordered.reserve(messages.size());
+    for (auto& kv : messages) {
+        ordered.push_back(std::move(kv.second));
+    }
+
+    // temperature, max_tokens, stop.<i> and the like change the answer
+    std::string settings;
+    for (const auto& kv : params) {
+        const std::string& name = kv.first;
+        if (name == "provider" || name.compare(0, prefix.size(), prefix) == 0 ||
+            std::find(std::begin(kCacheParams), std::end(kCacheParams), name) != std::end(kCacheParams)) {
+            continue;
+        }
+        CompletionCache::appendSetting(settings, name, kv.second);
+    }
+    key = CompletionCache::key(provider, ordered, settings);
+    return "";
+}
+
+} // namespace
+
+CompletionCacheService::CompletionCacheService() : cache_(new CompletionCache()) {}
+
+bool CompletionCacheService::initialize(const ConfigManager& config) {
+    CompletionCacheOptions options;
+    const int maxMb = config.getInt("COMPLETION_CACHE_MAX_MB", static_cast<int>(options.maxBytes >> 20));
+    const int shards = config.getInt("COMPLETION_CACHE_SHARDS", static_cast<int>(options.shards));
+    const int ttl = config.getInt("COMPLETION_CACHE_TTL_S", static_cast<int>(options.ttlMillis / 1000));
+    const int windowPercent =
+        config.getInt("COMPLETION_CACHE_WINDOW_PERCENT", static_cast<int>(options.windowRatio * 100));
+    if (maxMb < 1 || shards < 1 || ttl < 1 || windowPercent < 0 || windowPercent > 50) {
+        std::cerr << "COMPLETION_CACHE_MAX_MB, COMPLETION_CACHE_SHARDS and COMPLETION_CACHE_TTL_S must be positive "
+                     "and COMPLETION_CACHE_WINDOW_PERCENT between 0 and 50"
+                  << std::endl;
+        return false;
+    }
+    options.maxBytes = static_cast<size_t>(maxMb) << 20;
+    options.shards = static_cast<size_t>(shards);
+    options.ttlMillis = static_cast<uint64_t>(ttl) * 1000;
+    options.windowRatio = windowPercent / 100.0;
+    cache_.reset(new CompletionCache(options));
+    return true;
+}
+
+void CompletionCacheService::registerRoutes(HttpServer& server) {
+    server.post("/completion/cache/lookup", [this](const Params& params) { return handleLookup(params); });
+    server.post("/completion/cache/store", [this](const Params& params) { return handleStore(params); });
+    server.get("/completion/cache/stats", [this](const Params& params) { return handleStats(params); });
+}
+
+std::string CompletionCacheService::handleLookup(const Params& params) {
+    CompletionKey key;
+    const std::string message = requestKey(params, key);
+    if (!message.empty()) {
+        return error(message);
+    }
+    std::shared_ptr<const std::string> response = cache_->get(key, steadyMillis());
+    std::string out = response ? "{\"hit\": true, \"key\": \"" : "{\"hit\": false, \"key\": \"";
+    out += key.hex();
+    out += "\"";
+    if (response) {
+        out += ", \"response\": ";
+        appendJsonString(out, *response);
+    }
+    out += "}";
+    return out;
+}
+
+std::string CompletionCacheService::handleStore(const Params& params) {
+    auto response = params.find("response");
+    if (response == params.end()) {
+        return error("response required, as a JSON string");
+    }
+    CompletionKey key;
+    auto hex = params.find("key");
+    if (hex != params.end()) {
+        if (!CompletionKey::fromHex(hex->second, key)) {
+            return error("key must be the 64 hex digits a lookup returned");
+        }
+    } else {
+        const std::string message = requestKey(params, key);
+        if (!message.empty()) {
+            return error(message);
+        }
+    }
+    const std::string ttlText = param(params, "ttl_s", "0");
+    char* end = nullptr;
+    const long long ttl = std::strtoll(ttlText.c_str(), &end, 10);
+    if (*end != '\0' || ttl < 0) {
+        return error("ttl_s must be a non-negative number of seconds");
+    }
+    const bool cached = cache_->put(key, response->second, steadyMillis(), static_cast<uint64_t>(ttl) * 1000);
+    return std::string("{\"key\": \"") + key.hex() + "\", \"cached\": " + (cached ? "true" : "false") + "}";
+}
+
+std::string CompletionCacheService::handleStats(const Params&) {
+    CompletionCacheStats s = cache_->stats();
+    std::string out = "{\"entries\": " + std::to_string(s.entries);
+    out += ", \"bytes\": " + std::to_string(s.bytes);
+    out += ", \"capacity_bytes\": " + std::to_string(s.capacityBytes);
+    out += ", \"hits\": " + std::to_string(s.hits);
+    out += ", \"misses\": " + std::to_string(s.misses);
+    out += ", \"expired\": " + std::to_string(s.expired);
+    out += ", \"inserts\": " + std::to_string(s.inserts);
+    out += ", \"evictions\": " + std::to_string(s.evictions);
+    out += ", \"rejected\": " + std::to_string(s.rejected);
+    out += ", \"spill_hits\": " + std::to_string(s.spillHits);
+    out += ", \"spill_writes\": " + std::to_string(s.spillWrites) + "}";
+    return out;
+}
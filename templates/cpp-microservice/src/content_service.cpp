@@ -0,0 +1,386 @@
+#include "content_service.h"
+#include "config_manager.h"
+#include "json_util.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+typedef std::map<std::string, std::string> Params;
+
+std::string error(const std::string& message) {
+    std::string out = "{\"error\": ";
+    appendJsonString(out, message);
+    out += "}";
+    return out;
+}
+
+// One provider's results, as lists.<i>.{weight,urls.<j>,scores}
+struct ResultList {
+    double weight = 1.0;
+    std::map<size_t, std::string_view> urls;
+    std::map<size_t, double> scores;
+};
+
+bool parseNumber(const std::string& text, double& value) {
+    char* end = nullptr;
+    value = std::strtod(text.c_str(), &end);
+    return !text.empty() && *end == '\0' && std::isfinite(value);
+}
+
+} // namespace
+
+ContentService::ContentService() : defaultRules_("crawler") {
+    strippers_["crawler"].setRules(BoilerplateRules::crawler());
+    strippers_["scraper"].setRules(BoilerplateRules::scraper());
+    strippers_["web-api"].setRules(BoilerplateRules::webApi());
+}
+
+bool ContentService::initialize(const ConfigManager& config) {
+    std::string rules = config.get("CONTENT_BOILERPLATE_RULES", defaultRules_);
+    if (strippers_.find(rules) == strippers_.end()) {
+        std::cerr << "Unknown boilerplate rules: " << rules << std::endl;
+        return false;
+    }
+    defaultRules_ = rules;
+
+    NearDuplicateOptions options;
+    options.shingleWords = static_cast<size_t>(
+        config.getInt("CONTENT_DEDUP_SHINGLE_WORDS", static_cast<int>(options.shingleWords)));
+    options.threshold = std::strtod(config.get("CONTENT_DEDUP_THRESHOLD", "0.8").c_str(), nullptr);
+    options.capacity = static_cast<size_t>(
+        config.getInt("CONTENT_DEDUP_CAPACITY", static_cast<int>(options.capacity)));
+    if (options.threshold <= 0.0 || options.threshold > 1.0) {
+        std::cerr << "CONTENT_DEDUP_THRESHOLD must be in (0, 1]" << std::endl;
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(seenMutex_);
+        seen_ = NearDuplicateIndex(options);
+    }
+
+    UrlCanonicalizerOptions urlOptions;
+    std::stringstream extra(config.get("CONTENT_URL_TRACKING_PARAMS", ""));
+    std::string name;
+    while (std::getline(extra, name, ',')) {
+        if (!name.empty()) {
+            urlOptions.trackingParams.push_back(name);
+        }
+    }
+    canonicalizer_ = UrlCanonicalizer(urlOptions);
+    return true;
+}
+
+void ContentService::registerRoutes(HttpServer& server) {
+    server.post("/strip_boilerplate", [this](const Params& params) { return handleStripBoilerplate(params); });
+    server.post("/html_to_markdown", [this](const Params& params) { return handleHtmlToMarkdown(params); });
+    server.post("/near_duplicates", [this](const Params& params) { return handleNearDuplicates(params); });
+    server.post("/canonicalize_urls", [this](const Params& params) { return handleCanonicalizeUrls(params); });
+    server.post("/fuse_results", [this](const Params& params) { return handleFuseResults(params); });
+    server.post("/parse_feed", [this](const Params& params) { return handleParseFeed(params); });
+}
+
+std::string ContentService::handleStripBoilerplate(const Params& params) {
+    auto markdown = params.find("markdown");
+    if (markdown == params.end()) {
+        return error("markdown required");
+    }
+    auto rules = params.find("rules");
+    auto stripper = strippers_.find(rules != params.end() ? rules->second : defaultRules_);
+    if (stripper == strippers_.end()) {
+        return error("rules must be crawler, scraper or web-api");
+    }
+
+    std::string cleaned;
+    stripper->second.strip(markdown->second, cleaned);
+    std::string out = "{\"markdown\": ";
+    appendJsonString(out, cleaned);
+    out += ", \"input_bytes\": " + std::to_string(markdown->second.size());
+    out += ", \"output_bytes\": " + std::to_string(cleaned.size()) + "}";
+    return out;
+}
+
+std::string ContentService::handleHtmlToMarkdown(const Params& params) {
+    auto html = params.find("html");
+    if (html == params.end()) {
+        return error("html required");
+    }
+    auto rules = params.find("rules");
+    auto stripper = strippers_.end();
+    if (rules != params.end()) {
+        stripper = strippers_.find(rules->second);
+        if (stripper == strippers_.end()) {
+            return error("rules must be crawler, scraper or web-api");
+        }
+    }
+
+    // The converter carries per-document state, so each request gets its own
+    HtmlToMarkdown converter;
+    std::string markdown;
+    converter.convert(html->second, markdown);
+    if (stripper != strippers_.end()) {
+        std::string cleaned;
+        stripper->second.strip(markdown, cleaned);
+        markdown.swap(cleaned);
+    }
+    std::string out = "{\"markdown\": ";
+    appendJsonString(out, markdown);
+    out += ", \"input_bytes\": " + std::to_string(html->second.size());
+    out += ", \"output_bytes\": " + std::to_string(markdown.size()) + "}";
+    return out;
+}
+
+std::string ContentService::handleNearDuplicates(const Params& params) {
+    std::map<size_t, std::string_view> indexed;
+    if (!indexedParams(params, "texts.", kMaxParamIndex, indexed)) {
+        return error("bad index");
+    }
+    if (indexed.empty()) {
+        return error("texts.<i> required");
+    }
+    auto remember = params.find("remember");
+    const bool remembered = remember != params.end() && (remember->second == "true" || remember->second == "1");
+
+    std::vector<DocumentSignature> signatures(indexed.size());
+    size_t i = 0;
+    for (const auto& kv : indexed) {
+        seen_.sign(kv.second, signatures[i++]);
+    }
+    std::vector<size_t> clusters;
+    seen_.cluster(signatures, clusters);
+
+    // Only cluster leaders are looked up and stored; the rest go with their leader
+    std::vector<bool> seen(signatures.size(), false);
+    if (remembered) {
+        std::lock_guard<std::mutex> lock(seenMutex_);
+        for (i = 0; i < signatures.size(); ++i) {
+            if (clusters[i] == i) {
+                seen[i] = seen_.find(signatures[i]) != NearDuplicateIndex::kNotFound;
+            }
+        }
+        for (i = 0; i < signatures.size(); ++i) {
+            if (clusters[i] == i && !seen[i]) {
+                seen_.add(signatures[i]);
+            }
+        }
+    }
+
+    std::string out = "{\"clusters\": [";
+    std::string keep = "[";
+    std::string seenList = "[";
+    std::string simhashes = "[";
+    for (i = 0; i < signatures.size(); ++i) {
+        const char* separator = i > 0 ? ", " : "";
+        out += separator + std::to_string(clusters[i]);
+        seenList += separator;
+        seenList += seen[clusters[i]] ? "true" : "false";
+        if (clusters[i] == i && !seen[i]) {
+            keep += (keep.size() > 1 ? ", " : "") + std::to_string(i);
+        }
+        char hex[19];
+        std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(signatures[i].simhash));
+        simhashes += separator;
+        appendJsonString(simhashes, hex);
+    }
+    out += "], \"keep\": " + keep + "], \"seen\": " + seenList + "], \"simhash\": " + simhashes + "]}";
+    return out;
+}
+
+std::string ContentService::handleCanonicalizeUrls(const Params& params) {
+    std::map<size_t, std::string_view> indexed;
+    if (!indexedParams(params, "urls.", kMaxParamIndex, indexed)) {
+        return error("bad index");
+    }
+    if (indexed.empty()) {
+        return error("urls.<i> required");
+    }
+
+    // Invalid URLs get null in both lists
+    std::string urls = "{\"urls\": [";
+    std::string hashes = "\"hashes\": [";
+    char canonical[UrlCanonicalizer::kMaxUrlBytes];
+    for (const auto& kv : indexed) {
+        if (kv.first != indexed.begin()->first) {
+            urls += ", ";
+            hashes += ", ";
+        }
+        const size_t size = canonicalizer_.canonicalize(kv.second, canonical, sizeof(canonical));
+        if (size == 0) {
+            urls += "null";
+            hashes += "null";
+            continue;
+        }
+        appendJsonString(urls, std::string_view(canonical, size));
+        const Hash128 hash = murmurHash3(canonical, size);
+        appendJsonString(hashes, toHex(&hash, sizeof(hash)));
+    }
+    return urls + "], " + hashes + "]}";
+}
+
+std::string ContentService::handleFuseResults(const Params& params) {
+    const std::string prefix = "lists.";
+    std::map<size_t, ResultList> lists;
+    for (auto it = params.lower_bound(prefix); it != params.end() && it->first.compare(0, prefix.size(), prefix) == 0;
+         ++it) {
+        const std::string& key = it->first;
+        const size_t dot = key.find('.', prefix.size());
+        size_t index;
+        if (dot == std::string::npos ||
+            !parseParamIndex(std::string_view(key).substr(prefix.size(), dot - prefix.size()), kMaxParamIndex, index)) {
+            return error("bad index");
+        }
+        ResultList& list = lists[index];
+        const std::string_view field = std::string_view(key).substr(dot + 1);
+        size_t position;
+        double number;
+        if (field == "weight") {
+            if (!parseNumber(it->second, list.weight)) {
+                return error("bad number in " + key.substr(0, 64));
+            }
+        } else if (field.compare(0, 5, "urls.") == 0) {
+            if (!parseParamIndex(field.substr(5), kMaxParamIndex, position)) {
+                return error("bad index");
+            }
+            list.urls[position] = it->second;
+        } else if (field == "scores") {
+            // A JSON array of numbers arrives comma-separated
+            std::stringstream values(it->second);
+            std::string value;
+            for (position = 0; std::getline(values, value, ','); ++position) {
+                if (!parseNumber(value, number)) {
+                    return error("bad number in " + key.substr(0, 64));
+                }
+                list.scores[position] = number;
+            }
+        } else {
+            // Scores sent as strings arrive as scores.<j>; fusing that list by rank instead would hide the mistake
+            return error("unknown field " + key.substr(0, 64));
+        }
+    }
+    if (lists.empty()) {
+        return error("lists.<i>.urls.<j> required");
+    }
+
+    ScoreFusionOptions options;
+    auto method = params.find("method");
+    if (method != params.end()) {
+        if (method->second == "rrf") {
+            options.method = FusionMethod::Rrf;
+        } else if (method->second == "combsum") {
+            options.method = FusionMethod::CombSum;
+        } else if (method->second == "combmnz") {
+            options.method = FusionMethod::CombMnz;
+        } else {
+            return error("method must be rrf, combsum or combmnz");
+        }
+    }
+    auto k = params.find("k");
+    if (k != params.end() && (!parseNumber(k->second, options.rrfK) || options.rrfK < 0.0)) {
+        return error("k must be a number of at least 0");
+    }
+    auto normalize = params.find("normalize");
+    options.normalizeScores = normalize == params.end() || normalize->second == "true" || normalize->second == "1";
+    auto limit = params.find("limit");
+    const size_t keep = limit != params.end() ? std::strtoul(limit->second.c_str(), nullptr, 10) : 0;
+
+    // Invalid URLs are left out; the rest are fused by canonical URL hash
+    ScoreFusion fusion(options);
+    std::vector<std::vector<std::string>> canonicalUrls(lists.size());
+    std::vector<std::vector<size_t>> positions(lists.size());
+    std::vector<size_t> listIndexes;
+    std::vector<Hash128> keys;
+    std::vector<double> scores;
+    char canonical[UrlCanonicalizer::kMaxUrlBytes];
+    size_t input = 0;
+    for (const auto& kv : lists) {
+        const ResultList& list = kv.second;
+        if (!list.scores.empty() && list.scores.size() != list.urls.size()) {
+            return error("lists." + std::to_string(kv.first) + ".scores must have one score per url");
+        }
+        const size_t l = listIndexes.size();
+        listIndexes.push_back(kv.first);
+        keys.clear();
+        scores.clear();
+        for (const auto& url : list.urls) {
+            const size_t size = canonicalizer_.canonicalize(url.second, canonical, sizeof(canonical));
+            if (size == 0) {
+                continue;
+            }
+            if (!list.scores.empty()) {
+                auto score = list.scores.find(url.first);
+                if (score == list.scores.end()) {
+                    return error("lists." + std::to_string(kv.first) + ".scores must have one score per url");
+                }
+                scores.push_back(score->second);
+            }
+            keys.push_back(murmurHash3(canonical, size));
+            canonicalUrls[l].emplace_back(canonical, size);
+            positions[l].push_back(url.first);
+        }
+        input += list.urls.size();
+        fusion.addList(keys.data(), list.scores.empty() ? nullptr : scores.data(), keys.size(), list.weight);
+    }
+
+    const std::vector<FusedResult>& ranked = fusion.rank(keep);
+    std::string out = "{\"results\": [";
+    for (size_t i = 0; i < ranked.size(); ++i) {
+        const FusedResult& result = ranked[i];
+        out += i > 0 ? ", {\"url\": " : "{\"url\": ";
+        appendJsonString(out, canonicalUrls[result.list][result.index]);
+        out += ", \"score\": ";
+        appendJsonNumber(out, result.score);
+        out += ", \"list\": " + std::to_string(listIndexes[result.list]);
+        out += ", \"index\": " + std::to_string(positions[result.list][result.index]);
+        out += ", \"lists\": " + std::to_string(result.lists) + "}";
+    }
+    out += "], \"input\": " + std::to_string(input) + ", \"fused\": " + std::to_string(fusion.size()) + "}";
+    return out;
+}
+
+std::string ContentService::handleParseFeed(const Params& params) {
+    auto xml = params.find("xml");
+    if (xml == params.end()) {
+        return error("xml required");
+    }
+    auto limit = params.find("limit");
+    const size_t keep = limit != params.end() ? std::strtoul(limit->second.c_str(), nullptr, 10) : 0;
+
+    FeedReader reader(xml->second);
+    FeedEntry entry;
+    std::string scratch;
+    std::string entries;
+    size_t count = 0;
+    auto member = [&](const char* name, std::string_view raw) {
+        entries += entries.back() == '{' ? "\"" : ", \"";
+        entries += name;
+        entries += "\": ";
+        appendJsonString(entries, decodeXmlText(raw, scratch));
+    };
+    while ((keep == 0 || count < keep) && reader.next(entry)) {
+        entries += count > 0 ? ", {" : "{";
+        member("id", entry.id);
+        member("title", entry.title);
+        // PubMed entries have no link; build the article page URL from the id as the gateway does
+        if (entry.link.empty() && !entry.id.empty() &&
+            (reader.format() == FeedFormat::PubmedSummary || reader.format() == FeedFormat::PubmedArticles)) {
+            entries += ", \"link\": ";
+            appendJsonString(entries, "https://pubmed.ncbi.nlm.nih.gov/" + std::string(entry.id) + "/");
+        } else {
+            member("link", entry.link);
+        }
+        member("summary", entry.summary);
+        member("date", entry.date);
+        entries += "}";
+        ++count;
+    }
+    if (*reader.error()) {
+        return error(std::string("bad feed: ") + reader.error());
+    }
+    std::string out = "{\"format\": ";
+    appendJsonString(out, feedFormatName(reader.format()));
+    out += ", \"entries\": [" + entries + "], \"count\": " + std::to_string(count) + "}";
+    return out;
+}
@@ -0,0 +1,1216 @@
+#include "crawl_cache.h"
+#include "checksum.h"
+#include "cuckoo_filter.h"
+#include "file_util.h"
+#include "hash.h"
+#include "lz_codec.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const uint8_t kRecordPut = 1;
+const uint8_t kRecordRemove = 2;
+const uint8_t kRecordPutDictionary = 3;    // A put whose block starts with its dictionary's u32 id
+const size_t kRecordHeader = 8;        // [u32 payload length][u32 CRC-32C of the payload]
+const size_t kPayloadFixed = 27;       // op, hash, crawledAt, rawSize, url length, domain length
+const int kOffsetBits = 40;            // Location: generation << 40 | offset in the segment
+const uint64_t kOffsetMask = (uint64_t(1) << kOffsetBits) - 1;
+const size_t kMinIndexSlots = 1024;
+const size_t kTrainBatch = 16;         // Domains trained per trainDictionaries call
+const double kMaxFilterLoad = 0.9;     // Rebuild the filter larger past this share of its slots
+
+// Payload: [u8 op][u64 url hash][f64 crawled_at][u32 raw size][u32 url length][u16 domain length]
+//          [url][source_domain]([u32 dictionary id])[lzCompress(encodeMetadata(fields))]
+struct RecordView {
+    uint8_t op;
+    uint64_t hash;
+    double crawledAt;
+    uint32_t rawSize;
+    std::string_view url;
+    std::string_view domain;
+    uint32_t dictionary;    // 0 if the block was compressed without one
+    const uint8_t* block;
+    size_t blockSize;
+};
+
+bool isPut(uint8_t op) {
+    return op == kRecordPut || op == kRecordPutDictionary;
+}
+
+bool parseRecord(const uint8_t* payload, size_t length, RecordView& record) {
+    if (length < kPayloadFixed) {
+        return false;
+    }
+    record.op = payload[0];
+    record.hash = readRaw<uint64_t>(payload + 1);
+    record.crawledAt = readRaw<double>(payload + 9);
+    record.rawSize = readRaw<uint32_t>(payload + 17);
+    const uint32_t urlLength = readRaw<uint32_t>(payload + 21);
+    const uint16_t domainLength = readRaw<uint16_t>(payload + 25);
+    if (length - kPayloadFixed < static_cast<size_t>(urlLength) + domainLength) {
+        return false;
+    }
+    record.url = std::string_view(reinterpret_cast<const char*>(payload + kPayloadFixed), urlLength);
+    record.domain = std::string_view(record.url.data() + urlLength, domainLength);
+    record.block = payload + kPayloadFixed + urlLength + domainLength;
+    record.blockSize = length - kPayloadFixed - urlLength - domainLength;
+    record.dictionary = 0;
+    if (record.op == kRecordPutDictionary) {
+        if (record.blockSize < 4) {
+            return false;
+        }
+        record.dictionary = readRaw<uint32_t>(record.block);
+        record.block += 4;
+        record.blockSize -= 4;
+    }
+    return true;
+}
+
+void encodeRecord(uint8_t op, uint64_t hash, double crawledAt, std::string_view url, std::string_view domain,
+                  const std::string& raw, std::string& out, uint32_t dictionaryId = 0,
+                  const LzDictionary* dictionary = nullptr) {
+    if (op == kRecordPut && dictionaryId != 0) {
+        op = kRecordPutDictionary;
+    }
+    out.assign(kRecordHeader, '\0');
+    appendRaw<uint8_t>(out, op);
+    appendRaw<uint64_t>(out, hash);
+    appendRaw<double>(out, crawledAt);
+    appendRaw<uint32_t>(out, static_cast<uint32_t>(raw.size()));
+    appendRaw<uint32_t>(out, static_cast<uint32_t>(url.size()));
+    appendRaw<uint16_t>(out, static_cast<uint16_t>(domain.size()));
+    out.append(url.data(), url.size());
+    out.append(domain.data(), domain.size());
+    if (op == kRecordPutDictionary) {
+        appendRaw<uint32_t>(out, dictionaryId);
+    }
+    if (isPut(op)) {
+        lzCompress(raw.data(), raw.size(), out, dictionary);
+    }
+    const uint32_t length = static_cast<uint32_t>(out.size() - kRecordHeader);
+    const uint32_t crc = crc32c(out.data() + kRecordHeader, length);
+    std::memcpy(&out[0], &length, 4);
+    std::memcpy(&out[4], &crc, 4);
+}
+
+// 0 marks an empty index slot
+uint64_t urlHash(std::string_view url) {
+    const uint64_t hash = hash64(url);
+    return hash ? hash : 1;
+}
+
+double wallClockSeconds() {
+    return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+size_t readerStripe(size_t stripes) {
+    thread_local const size_t stripe = std::hash<std::thread::id>()(std::this_thread::get_id()) % stripes;
+    return stripe;
+}
+
+} // namespace
+
+// ─── Internal structures ────────────────────────────────────────────────────
+
+struct CrawlCache::Segment {
+    uint64_t generation = 0;
+    std::string path;
+    int fd = -1;
+    uint8_t* data = nullptr;    // Shared read-write mapping of capacity bytes
+    size_t capacity = 0;
+    size_t size = 0;            // Bytes of records
+    size_t liveBytes = 0;       // Bytes of the records the index points to
+    double newest = 0;          // Latest crawled_at of any record
+
+    ~Segment() {
+        if (data) {
+            munmap(data, capacity);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+
+    bool map(size_t bytes) {
+        if (data) {
+            munmap(data, capacity);
+            data = nullptr;
+        }
+        capacity = bytes;
+        if (bytes == 0) {
+            return true;
+        }
+        void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (p == MAP_FAILED) {
+            capacity = 0;
+            return false;
+        }
+        data = static_cast<uint8_t*>(p);
+        return true;
+    }
+};
+
+// Immutable generation -> segment map that gets read
+struct CrawlCache::SegmentTable {
+    uint64_t base = 0;
+    std::vector<const Segment*> slots;    // nullptr for dropped generations
+
+    const Segment* find(uint64_t generation) const {
+        return generation >= base && generation - base < slots.size() ? slots[generation - base] : nullptr;
+    }
+};
+
+// Open-addressing url hash -> location table. A removed entry keeps its
+// key with location 0, so probe sequences through it stay intact.
+struct CrawlCache::Index {
+    struct Slot {
+        std::atomic<uint64_t> key;
+        std::atomic<uint64_t> location;
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    uint64_t mask;
+    size_t used;    // Slots with a key (writer only)
+    size_t live;    // Slots with a location (writer only)
+
+    explicit Index(size_t capacity) : slots(new Slot[capacity]), mask(capacity - 1), used(0), live(0) {
+        for (size_t i = 0; i < capacity; ++i) {
+            slots[i].key.store(0, std::memory_order_relaxed);
+            slots[i].location.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+    uint64_t find(uint64_t key) const {
+        for (uint64_t i = key & mask;; i = (i + 1) & mask) {
+            const uint64_t k = slots[i].key.load(std::memory_order_acquire);
+            if (k == key) {
+                return slots[i].location.load(std::memory_order_acquire);
+            }
+            if (k == 0) {
+                return 0;
+            }
+        }
+    }
+
+    // Returns the previous location; the caller keeps the table at most half full
+    uint64_t store(uint64_t key, uint64_t location) {
+        for (uint64_t i = key & mask;; i = (i + 1) & mask) {
+            Slot& slot = slots[i];
+            const uint64_t k = slot.key.load(std::memory_order_relaxed);
+            if (k == key) {
+                const uint64_t previous = slot.location.load(std::memory_order_relaxed);
+                slot.location.store(location, std::memory_order_release);
+                live += (location != 0) - (previous != 0);
+                return previous;
+            }
+            if (k == 0) {
+                if (location != 0) {
+                    // The location is in place before a get can find the key
+                    slot.location.store(location, std::memory_order_relaxed);
+                    slot.key.store(key, std::memory_order_release);
+                    ++used;
+                    ++live;
+                }
+                return 0;
+            }
+        }
+    }
+};
+
+// Announces a get in the current epoch's counter of this thread's stripe
+class CrawlCache::ReadGuard {
+public:
+    explicit ReadGuard(const CrawlCache& cache) : stripe_(cache.readers_[readerStripe(kReaderStripes)]) {
+        while (true) {
+            const uint64_t epoch = cache.epoch_.load();
+            counter_ = &stripe_.active[epoch & 1];
+            counter_->fetch_add(1);
+            // A writer that bumped the epoch in between may not have seen the increment
+            if (cache.epoch_.load() == epoch) {
+                break;
+            }
+            counter_->fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    ~ReadGuard() { counter_->fetch_sub(1, std::memory_order_release); }
+
+    ReaderStripe& stripe() { return stripe_; }
+
+private:
+    ReaderStripe& stripe_;
+    std::atomic<int64_t>* counter_;
+};
+
+// ─── CrawlCache ─────────────────────────────────────────────────────────────
+
+CrawlCache::CrawlCache()
+    : index_(nullptr), segmentTable_(nullptr), filter_(nullptr), epoch_(0), active_(nullptr), nextGeneration_(1), rawBytes_(0),
+      dictionaryCapacity_(0), nextDictionary_(1), backgroundRunning_(false), puts_(0), compactions_(0),
+      droppedRecords_(0), openMillis_(0), lastCompactionMillis_(0) {
+    for (ReaderStripe& stripe : readers_) {
+        stripe.active[0].store(0);
+        stripe.active[1].store(0);
+        stripe.hits.store(0);
+        stripe.misses.store(0);
+        stripe.expired.store(0);
+        stripe.decodedBytes.store(0);
+        stripe.decodeNanos.store(0);
+        stripe.filtered.store(0);
+        stripe.falsePositives.store(0);
+    }
+}
+
+CrawlCache::~CrawlCache() {
+    close();
+}
+
+std::string CrawlCache::segmentPath(uint64_t generation) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "cache-%08llu.log", static_cast<unsigned long long>(generation));
+    return options_.directory + "/" + name;
+}
+
+// Generations and file sizes of the given segments, read before replay cuts any short
+std::string CrawlCache::segmentFileSizes(const std::vector<uint64_t>& generations) const {
+    std::string sizes;
+    for (uint64_t generation : generations) {
+        std::error_code ec;
+        appendRaw<uint64_t>(sizes, generation);
+        appendRaw<uint64_t>(sizes, static_cast<uint64_t>(fs::file_size(segmentPath(generation), ec)));
+    }
+    return sizes;
+}
+
+// Changes whenever a segment is added, dropped, grows, is cut short or gains
+// records. The active segment's file is always segmentBytes long, so its
+// record bytes are stamped too.
+uint64_t CrawlCache::filterStamp(std::string fileSizes) const {
+    for (const auto& kv : segments_) {
+        appendRaw<uint64_t>(fileSizes, static_cast<uint64_t>(kv.second->size));
+    }
+    return hash64(fileSizes);
+}
+
+std::string CrawlCache::dictionaryPath(uint32_t id) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "dict-%08u.lzd", id);
+    return options_.directory + "/" + name;
+}
+
+// Dictionary file: [u32 CRC-32C of the rest][u16 domain length][domain][dictionary bytes]
+bool CrawlCache::loadDictionaries() {
+    std::error_code ec;
+    std::map<uint32_t, std::pair<std::string, std::string>> found;    // id -> (domain, bytes)
+    uint32_t last = 0;    // Ids of corrupt files are not reused: records may still name them
+    for (const fs::directory_entry& entry : fs::directory_iterator(options_.directory, ec)) {
+        uint64_t id = 0;
+        if (!parseGeneration(entry.path().filename().string(), "dict-", ".lzd", id) || id == 0 || id > UINT32_MAX) {
+            continue;
+        }
+        last = std::max(last, static_cast<uint32_t>(id));
+        std::ifstream in(entry.path(), std::ios::binary);
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        const uint16_t domainLength = data.size() >= 6 ? readRaw<uint16_t>(data.data() + 4) : 0;
+        if (data.size() < 6u + domainLength ||
+            readRaw<uint32_t>(data.data()) != crc32c(data.data() + 4, data.size() - 4)) {
+            std::cerr << "Ignoring corrupt crawl cache dictionary " << entry.path().string() << std::endl;
+            continue;
+        }
+        found[static_cast<uint32_t>(id)] = {data.substr(6, domainLength), data.substr(6 + domainLength)};
+    }
+    if (ec) {
+        return false;
+    }
+
+    dictionaryCapacity_ = std::max<size_t>(options_.maxDictionaries, last) + 1;
+    dictionaries_.reset(new std::atomic<const LzDictionary*>[dictionaryCapacity_]);
+    for (size_t i = 0; i < dictionaryCapacity_; ++i) {
+        dictionaries_[i].store(nullptr, std::memory_order_relaxed);
+    }
+    nextDictionary_ = last + 1;
+    for (auto& kv : found) {
+        dictionaryStore_.push_back(std::make_unique<LzDictionary>(std::move(kv.second.second)));
+        dictionaries_[kv.first].store(dictionaryStore_.back().get(), std::memory_order_release);
+        DomainState& state = domains_[kv.second.first];
+        state.dictionary = kv.first;
+        state.trained = true;
+    }
+    return true;
+}
+
+bool CrawlCache::open(const CrawlCacheOptions& options) {
+    close();
+    options_ = options;
+    auto start = std::chrono::steady_clock::now();
+    std::error_code ec;
+    fs::create_directories(options_.directory, ec);
+    if (ec) {
+        std::cerr << "Failed to create crawl cache directory " << options_.directory << ": " << ec.message()
+                  << std::endl;
+        return false;
+    }
+
+    std::vector<uint64_t> generations;
+    for (const fs::directory_entry& entry : fs::directory_iterator(options_.directory, ec)) {
+        uint64_t generation = 0;
+        if (parseGeneration(entry.path().filename().string(), "cache-", ".log", generation) && generation > 0 &&
+            generation <= (uint64_t(1) << (64 - kOffsetBits)) - 1) {
+            generations.push_back(generation);
+        }
+    }
+    std::sort(generations.begin(), generations.end());
+    const std::string fileSizes = segmentFileSizes(generations);
+
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    index_.store(new Index(kMinIndexSlots));
+    rawBytes_ = 0;
+    if (!loadDictionaries()) {
+        std::cerr << "Failed to list crawl cache dictionaries in " << options_.directory << std::endl;
+        return false;
+    }
+    for (uint64_t generation : generations) {
+        Segment* segment = openSegment(generation);
+        if (!segment) {
+            return false;
+        }
+        replaySegment(*segment);
+    }
+    nextGeneration_ = generations.empty() ? 1 : generations.back() + 1;
+
+    // Replay leaves the filter alone; it is loaded or built once the table is complete
+    bool loaded = false;
+    if (options_.filter) {
+        auto filter = std::make_unique<CuckooFilter>();
+        loaded = filter->open(options_.directory + "/urls.cuckoo", filterStamp(fileSizes)) &&
+                 filter->size() == index_.load()->live;
+        filter_.store(loaded ? filter.release() : buildFilter(2 * index_.load()->live));
+        if (!filter_.load()) {
+            std::cerr << "Failed to build the crawl cache filter; lookups probe the table" << std::endl;
+        }
+    }
+
+    // Keep appending to the newest segment if it has room
+    Segment* last = segments_.empty() ? nullptr : segments_.rbegin()->second.get();
+    if (last && last->size < options_.segmentBytes) {
+        if (ftruncate(last->fd, static_cast<off_t>(options_.segmentBytes)) != 0 ||
+            !last->map(options_.segmentBytes)) {
+            std::cerr << "Failed to reopen crawl cache segment " << last->path << std::endl;
+            return false;
+        }
+        active_ = last;
+    } else {
+        active_ = createSegment(nextGeneration_++, options_.segmentBytes);
+        if (!active_) {
+            return false;
+        }
+    }
+    publishSegments();
+
+    openMillis_ = millisSince(start);
+    std::cout << "Crawl cache opened in " << openMillis_ << " ms: " << index_.load()->live << " pages, "
+              << segments_.size() << " segments, " << dictionaryStore_.size() << " dictionaries, filter "
+              << (!filter_.load() ? "off" : loaded ? "loaded" : "rebuilt") << std::endl;
+    return true;
+}
+
+void CrawlCache::close() {
+    stopBackgroundCompaction();
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    std::unique_ptr<CuckooFilter> filter(filter_.exchange(nullptr));
+    if (filter) {
+        // The filter may only be reused with the records it describes on disk
+        std::vector<uint64_t> generations;
+        for (const auto& kv : segments_) {
+            generations.push_back(kv.first);
+        }
+        if (active_ && fdatasync(active_->fd) != 0) {
+            std::cerr << "Failed to sync crawl cache segment " << active_->path << std::endl;
+        } else {
+            filter->persist(filterStamp(segmentFileSizes(generations)));
+        }
+    }
+    delete index_.exchange(nullptr);
+    delete segmentTable_.exchange(nullptr);
+    active_ = nullptr;
+    segments_.clear();
+    dictionaries_.reset();
+    dictionaryCapacity_ = 0;
+    dictionaryStore_.clear();
+    domains_.clear();
+}
+
+CrawlCache::Segment* CrawlCache::createSegment(uint64_t generation, size_t capacity) {
+    auto segment = std::make_unique<Segment>();
+    segment->generation = generation;
+    segment->path = segmentPath(generation);
+    segment->fd = ::open(segment->path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (segment->fd < 0 || ftruncate(segment->fd, static_cast<off_t>(capacity)) != 0 || !segment->map(capacity)) {
+        std::cerr << "Failed to create crawl cache segment " << segment->path << std::endl;
+        unlink(segment->path.c_str());
+        return nullptr;
+    }
+    syncDirectory(options_.directory);
+    Segment* raw = segment.get();
+    segments_[generation] = std::move(segment);
+    return raw;
+}
+
+CrawlCache::Segment* CrawlCache::openSegment(uint64_t generation) {
+    auto segment = std::make_unique<Segment>();
+    segment->generation = generation;
+    segment->path = segmentPath(generation);
+    segment->fd = ::open(segment->path.c_str(), O_RDWR | O_CLOEXEC);
+    struct stat st;
+    if (segment->fd < 0 || fstat(segment->fd, &st) != 0 || !segment->map(static_cast<size_t>(st.st_size))) {
+        std::cerr << "Failed to map crawl cache segment " << segment->path << std::endl;
+        return nullptr;
+    }
+    Segment* raw = segment.get();
+    segments_[generation] = std::move(segment);
+    return raw;
+}
+
+void CrawlCache::replaySegment(Segment& segment) {
+    size_t pos = 0;
+    while (segment.capacity - pos >= kRecordHeader) {
+        const uint32_t length = readRaw<uint32_t>(segment.data + pos);
+        const uint32_t crc = readRaw<uint32_t>(segment.data + pos + 4);
+        RecordView record;
+        if (length == 0 || segment.capacity - pos - kRecordHeader < length ||
+            crc32c(segment.data + pos + kRecordHeader, length) != crc ||
+            !parseRecord(segment.data + pos + kRecordHeader, length, record)) {
+            break;
+        }
+        const uint64_t location = segment.generation << kOffsetBits | pos;
+        release(storeLocation(record.hash, isPut(record.op) ? location : 0));
+        if (isPut(record.op)) {
+            segment.liveBytes += kRecordHeader + length;
+            rawBytes_ += record.rawSize;
+        }
+        if (record.op == kRecordPut && options_.dictionaryBytes > 0) {
+            DomainState& state = domains_[std::string(record.domain)];
+            state.pages += !state.trained;
+        }
+        segment.newest = std::max(segment.newest, record.crawledAt);
+        pos += kRecordHeader + length;
+    }
+    segment.size = pos;
+
+    // Whatever follows is a torn write from a crash, or the zeroed tail of an active segment
+    if (segment.capacity > pos) {
+        bool torn = false;
+        for (size_t i = pos; i < std::min(segment.capacity, pos + kRecordHeader); ++i) {
+            torn = torn || segment.data[i] != 0;
+        }
+        if (torn) {
+            std::cerr << "Truncating crawl cache segment " << segment.path << " at offset " << pos << std::endl;
+        }
+        if (ftruncate(segment.fd, static_cast<off_t>(pos)) != 0 || !segment.map(pos)) {
+            std::cerr << "Failed to truncate crawl cache segment " << segment.path << std::endl;
+        }
+    }
+}
+
+void CrawlCache::publishSegments() {
+    auto table = new SegmentTable();
+    if (!segments_.empty()) {
+        table->base = segments_.begin()->first;
+        table->slots.assign(segments_.rbegin()->first - table->base + 1, nullptr);
+        for (const auto& kv : segments_) {
+            table->slots[kv.first - table->base] = kv.second.get();
+        }
+    }
+    SegmentTable* previous = segmentTable_.exchange(table);
+    synchronize();
+    delete previous;
+}
+
+void CrawlCache::synchronize() const {
+    // Gets that start after the bump see the new pointers; wait out those that started before
+    const uint64_t previous = epoch_.fetch_add(1);
+    for (ReaderStripe& stripe : readers_) {
+        while (stripe.active[previous & 1].load(std::memory_order_acquire) != 0) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+uint64_t CrawlCache::storeLocation(uint64_t hash, uint64_t location) {
+    Index* index = index_.load(std::memory_order_relaxed);
+    if (location != 0 && (index->used + 1) * 2 > index->capacity()) {
+        // Rebuild without removed keys, at a quarter full
+        size_t capacity = kMinIndexSlots;
+        while (capacity < (index->live + 1) * 4) {
+            capacity <<= 1;
+        }
+        auto grown = new Index(capacity);
+        for (size_t i = 0; i < index->capacity(); ++i) {
+            const uint64_t existing = index->slots[i].location.load(std::memory_order_relaxed);
+            if (existing != 0) {
+                grown->store(index->slots[i].key.load(std::memory_order_relaxed), existing);
+            }
+        }
+        index_.store(grown, std::memory_order_release);
+        synchronize();
+        delete index;
+        index = grown;
+    }
+
+    // A get must find the URL in the filter once the table has it, and may find it there longer
+    CuckooFilter* filter = filter_.load(std::memory_order_relaxed);
+    if (filter && location != 0 && index->find(hash) == 0) {
+        while (filter && (filter->size() + 1 > filter->capacity() * kMaxFilterLoad || !filter->insert(hash))) {
+            filter = buildFilter(filter->capacity() * 2);
+            replaceFilter(filter);
+        }
+    }
+    const uint64_t previous = index->store(hash, location);
+    if (filter && location == 0 && previous != 0) {
+        filter->erase(hash);
+    }
+    return previous;
+}
+
+// A filter of every URL in the table, at most half full
+CuckooFilter* CrawlCache::buildFilter(size_t capacity) {
+    const Index* index = index_.load(std::memory_order_relaxed);
+    capacity = std::max(capacity, 2 * index->live + 1);
+    while (true) {
+        auto filter = std::make_unique<CuckooFilter>();
+        if (!filter->create(options_.directory + "/urls.cuckoo", capacity)) {
+            return nullptr;
+        }
+        bool complete = true;
+        for (size_t i = 0; i < index->capacity() && complete; ++i) {
+            if (index->slots[i].location.load(std::memory_order_relaxed) != 0) {
+                complete = filter->insert(index->slots[i].key.load(std::memory_order_relaxed));
+            }
+        }
+        if (complete) {
+            return filter.release();
+        }
+        capacity *= 2;
+    }
+}
+
+void CrawlCache::replaceFilter(CuckooFilter* filter) {
+    if (!filter) {
+        std::cerr << "Failed to grow the crawl cache filter; lookups probe the table" << std::endl;
+    }
+    CuckooFilter* previous = filter_.exchange(filter);
+    synchronize();
+    delete previous;
+}
+
+// Accounts for a record the index no longer points to
+void CrawlCache::release(uint64_t location) {
+    if (location == 0) {
+        return;
+    }
+    auto it = segments_.find(location >> kOffsetBits);
+    if (it == segments_.end()) {
+        return;
+    }
+    const uint8_t* header = it->second->data + (location & kOffsetMask);
+    const uint32_t length = readRaw<uint32_t>(header);
+    it->second->liveBytes -= kRecordHeader + length;
+    rawBytes_ -= readRaw<uint32_t>(header + kRecordHeader + 17);
+}
+
+bool CrawlCache::roll(size_t recordSize) {
+    Segment* sealed = active_;
+    if (ftruncate(sealed->fd, static_cast<off_t>(sealed->size)) != 0 || fdatasync(sealed->fd) != 0) {
+        std::cerr << "Failed to seal crawl cache segment " << sealed->path << std::endl;
+        return false;
+    }
+    Segment* segment = createSegment(nextGeneration_++, std::max(options_.segmentBytes, recordSize));
+    if (!segment) {
+        return false;
+    }
+    // Gets must find the new segment before the index points into it
+    publishSegments();
+    active_ = segment;
+    return true;
+}
+
+bool CrawlCache::append(const std::string& record, uint64_t hash, bool removal, double crawledAt,
+                        uint32_t rawSize) {
+    if (active_->size + record.size() > active_->capacity && !roll(record.size())) {
+        return false;
+    }
+    std::memcpy(active_->data + active_->size, record.data(), record.size());
+    if (options_.syncWrites && fdatasync(active_->fd) != 0) {
+        std::cerr << "Failed to sync crawl cache segment " << active_->path << std::endl;
+        return false;
+    }
+    const uint64_t location = active_->generation << kOffsetBits | active_->size;
+    active_->size += record.size();
+    active_->newest = std::max(active_->newest, crawledAt);
+    release(storeLocation(hash, removal ? 0 : location));
+    if (!removal) {
+        active_->liveBytes += record.size();
+        rawBytes_ += rawSize;
+    }
+    return true;
+}
+
+bool CrawlCache::put(const CrawlPage& page) {
+    if (page.url.size() > UINT32_MAX || page.sourceDomain.size() > UINT16_MAX) {
+        return false;
+    }
+    // Encoding and compression happen before taking the lock
+    thread_local std::string raw;
+    thread_local std::string record;
+    raw.clear();
+    encodeMetadata(page.fields, raw);
+    const uint64_t hash = urlHash(page.url);
+    uint32_t dictionaryId = 0;
+    const LzDictionary* dictionary = nullptr;
+    if (options_.dictionaryBytes > 0) {
+        // Dictionaries are never freed while the cache is open, so the pointer outlives the lock
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        dictionary = dictionaryFor(page.sourceDomain, &dictionaryId);
+        if (!dictionary && active_) {
+            DomainState& state = domains_[page.sourceDomain];
+            state.pages += !state.trained;
+        }
+    }
+    encodeRecord(kRecordPut, hash, page.crawledAt, page.url, page.sourceDomain, raw, record, dictionaryId,
+                 dictionary);
+
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    if (!active_ || !append(record, hash, false, page.crawledAt, static_cast<uint32_t>(raw.size()))) {
+        return false;
+    }
+    puts_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool CrawlCache::remove(std::string_view url) {
+    const uint64_t hash = urlHash(url);
+    std::string record;
+    encodeRecord(kRecordRemove, hash, wallClockSeconds(), url, "", std::string(), record);
+
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    uint32_t length = 0;
+    if (!active_ || !findRecord(url, hash, &length)) {
+        return false;
+    }
+    return append(record, hash, true, wallClockSeconds(), 0);
+}
+
+const LzDictionary* CrawlCache::dictionaryFor(std::string_view domain, uint32_t* id) {
+    auto it = domains_.find(std::string(domain));
+    *id = it != domains_.end() ? it->second.dictionary : 0;
+    return *id != 0 ? dictionaries_[*id].load(std::memory_order_relaxed) : nullptr;
+}
+
+const uint8_t* CrawlCache::findRecord(std::string_view url, uint64_t hash, uint32_t* length) const {
+    const Index* index = index_.load(std::memory_order_acquire);
+    if (!index) {
+        return nullptr;
+    }
+    uint64_t location = index->find(hash);
+    const Segment* segment = nullptr;
+    while (location != 0) {
+        segment = segmentTable_.load(std::memory_order_acquire)->find(location >> kOffsetBits);
+        if (segment) {
+            break;
+        }
+        // Compaction moved the record and dropped its segment since the probe
+        const uint64_t moved = index_.load(std::memory_order_acquire)->find(hash);
+        location = moved != location ? moved : 0;
+    }
+    if (location == 0) {
+        return nullptr;
+    }
+    const uint8_t* header = segment->data + (location & kOffsetMask);
+    *length = readRaw<uint32_t>(header);
+    RecordView record;
+    if (!parseRecord(header + kRecordHeader, *length, record) || record.url != url) {
+        return nullptr;
+    }
+    return header + kRecordHeader;
+}
+
+bool CrawlCache::get(std::string_view url, double maxAgeSeconds, CrawlPage& page) const {
+    const uint64_t hash = urlHash(url);
+    ReadGuard guard(*this);
+    ReaderStripe& stripe = guard.stripe();
+    const CuckooFilter* filter = filter_.load(std::memory_order_acquire);
+    if (filter && !filter->contains(hash)) {
+        stripe.filtered.fetch_add(1, std::memory_order_relaxed);
+        stripe.misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    uint32_t length = 0;
+    const uint8_t* payload = findRecord(url, hash, &length);
+    RecordView record;
+    if (!payload || !parseRecord(payload, length, record)) {
+        stripe.falsePositives.fetch_add(filter && !payload, std::memory_order_relaxed);
+        stripe.misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (record.crawledAt <= wallClockSeconds() - maxAgeSeconds) {
+        stripe.expired.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    thread_local std::string raw;
+    if (raw.size() < record.rawSize) {
+        raw.resize(record.rawSize);
+    }
+    page.fields.clear();
+    const LzDictionary* dictionary = record.dictionary != 0 && record.dictionary < dictionaryCapacity_
+                                         ? dictionaries_[record.dictionary].load(std::memory_order_acquire)
+                                         : nullptr;
+    const auto decodeStart = std::chrono::steady_clock::now();
+    if ((record.dictionary != 0 && !dictionary) ||
+        !lzDecompress(record.block, record.blockSize, &raw[0], record.rawSize, dictionary) ||
+        !decodeMetadata(reinterpret_cast<const uint8_t*>(raw.data()), record.rawSize, page.fields)) {
+        std::cerr << "Corrupt crawl cache record for " << url << std::endl;
+        stripe.misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    stripe.decodeNanos.fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - decodeStart).count(),
+        std::memory_order_relaxed);
+    stripe.decodedBytes.fetch_add(record.rawSize, std::memory_order_relaxed);
+    page.url.assign(record.url.data(), record.url.size());
+    page.sourceDomain.assign(record.domain.data(), record.domain.size());
+    page.crawledAt = record.crawledAt;
+    stripe.hits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool CrawlCache::contains(std::string_view url, double maxAgeSeconds) const {
+    const uint64_t hash = urlHash(url);
+    ReadGuard guard(*this);
+    ReaderStripe& stripe = guard.stripe();
+    const CuckooFilter* filter = filter_.load(std::memory_order_acquire);
+    if (filter && !filter->contains(hash)) {
+        stripe.filtered.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    uint32_t length = 0;
+    const uint8_t* payload = findRecord(url, hash, &length);
+    stripe.falsePositives.fetch_add(filter && !payload, std::memory_order_relaxed);
+    return payload && readRaw<double>(payload + 9) > wallClockSeconds() - maxAgeSeconds;
+}
+
+// ─── Maintenance ────────────────────────────────────────────────────────────
+
+void CrawlCache::dropSegment(uint64_t generation) {
+    std::unique_ptr<Segment> segment;
+    {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        auto it = segments_.find(generation);
+        if (it == segments_.end()) {
+            return;
+        }
+        segment = std::move(it->second);
+        segments_.erase(it);
+        publishSegments();
+    }
+    unlink(segment->path.c_str());
+}
+
+bool CrawlCache::compactSegment(Segment& segment, double cutoff, bool keepRemovals) {
+    // Sealed segments never change, so they are scanned outside the write lock
+    uint64_t dropped = 0;
+    std::string raw;
+    std::string recompressed;
+    for (size_t pos = 0; pos < segment.size;) {
+        const uint32_t length = readRaw<uint32_t>(segment.data + pos);
+        RecordView record;
+        if (!parseRecord(segment.data + pos + kRecordHeader, length, record)) {
+            break;
+        }
+        const uint64_t location = segment.generation << kOffsetBits | pos;
+        const std::string bytes(reinterpret_cast<const char*>(segment.data + pos), kRecordHeader + length);
+        pos += kRecordHeader + length;
+
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        const uint64_t current = index_.load(std::memory_order_relaxed)->find(record.hash);
+        bool keep;
+        if (isPut(record.op)) {
+            keep = current == location && record.crawledAt > cutoff;
+            if (current == location && !keep) {
+                release(storeLocation(record.hash, 0));
+            }
+        } else {
+            // Still hiding a put in an older segment from replay
+            keep = keepRemovals && current == 0 && record.crawledAt > cutoff;
+        }
+        if (!keep) {
+            ++dropped;
+            continue;
+        }
+        // Pages put before their domain's dictionary was trained are recompressed with it
+        const std::string* copy = &bytes;
+        uint32_t dictionaryId = 0;
+        const LzDictionary* dictionary =
+            record.op == kRecordPut ? dictionaryFor(record.domain, &dictionaryId) : nullptr;
+        if (dictionary) {
+            raw.resize(record.rawSize);
+            if (lzDecompress(record.block, record.blockSize, &raw[0], raw.size())) {
+                encodeRecord(kRecordPut, record.hash, record.crawledAt, record.url, record.domain, raw, recompressed,
+                             dictionaryId, dictionary);
+                copy = &recompressed;
+            }
+        }
+        if (!append(*copy, record.hash, record.op == kRecordRemove, record.crawledAt, record.rawSize)) {
+            return false;
+        }
+    }
+
+    // The copies must be durable before the originals go
+    {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        if (fdatasync(active_->fd) != 0) {
+            std::cerr << "Failed to sync crawl cache segment " << active_->path << std::endl;
+            return false;
+        }
+    }
+    droppedRecords_.fetch_add(dropped, std::memory_order_relaxed);
+    return true;
+}
+
+bool CrawlCache::recompressible(const Segment& segment) {
+    const Index* index = index_.load(std::memory_order_relaxed);
+    for (size_t pos = 0; pos < segment.size;) {
+        const uint32_t length = readRaw<uint32_t>(segment.data + pos);
+        RecordView record;
+        if (!parseRecord(segment.data + pos + kRecordHeader, length, record)) {
+            break;
+        }
+        uint32_t id = 0;
+        if (record.op == kRecordPut && index->find(record.hash) == (segment.generation << kOffsetBits | pos) &&
+            dictionaryFor(record.domain, &id)) {
+            return true;
+        }
+        pos += kRecordHeader + length;
+    }
+    return false;
+}
+
+bool CrawlCache::compact(bool force) {
+    std::lock_guard<std::mutex> guard(compactionMutex_);
+    auto start = std::chrono::steady_clock::now();
+    const double cutoff = wallClockSeconds() - options_.ttlSeconds;
+
+    std::vector<Segment*> candidates;
+    uint64_t oldest = 0;
+    {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        if (!active_) {
+            return false;
+        }
+        oldest = segments_.begin()->first;
+        for (const auto& kv : segments_) {
+            Segment* segment = kv.second.get();
+            if (segment == active_) {
+                continue;
+            }
+            const double dead = segment->size ? 1.0 - static_cast<double>(segment->liveBytes) / segment->size : 0.0;
+            if (segment->newest <= cutoff || dead >= options_.compactGarbageRatio ||
+                (force && (segment->liveBytes < segment->size || recompressible(*segment)))) {
+                candidates.push_back(segment);
+            }
+        }
+    }
+    if (candidates.empty()) {
+        return true;
+    }
+
+    for (Segment* segment : candidates) {
+        if (!compactSegment(*segment, cutoff, segment->generation > oldest)) {
+            return false;
+        }
+        const uint64_t generation = segment->generation;
+        dropSegment(generation);
+        // Once the oldest segment is gone, removals in the next one hide nothing
+        if (generation == oldest) {
+            std::lock_guard<std::mutex> lock(writeMutex_);
+            oldest = segments_.begin()->first;
+        }
+    }
+    compactions_.fetch_add(1, std::memory_order_relaxed);
+    lastCompactionMillis_ = millisSince(start);
+    std::cout << "Compacted " << candidates.size() << " crawl cache segment(s) in " << lastCompactionMillis_
+              << " ms" << std::endl;
+    return true;
+}
+
+bool CrawlCache::clear() {
+    std::lock_guard<std::mutex> guard(compactionMutex_);
+    std::vector<std::unique_ptr<Segment>> old;
+    {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        if (!active_) {
+            return false;
+        }
+        for (auto& kv : segments_) {
+            old.push_back(std::move(kv.second));
+        }
+        segments_.clear();
+        Index* previous = index_.exchange(new Index(kMinIndexSlots));
+        std::unique_ptr<CuckooFilter> previousFilter;
+        if (filter_.load()) {
+            previousFilter.reset(filter_.exchange(buildFilter(kMinIndexSlots)));
+        }
+        rawBytes_ = 0;
+        // Trained dictionaries stay; they still describe their domains
+        for (auto& kv : domains_) {
+            kv.second.pages = 0;
+        }
+        active_ = createSegment(nextGeneration_++, options_.segmentBytes);
+        // One grace period covers the old index, filter and segments
+        publishSegments();
+        delete previous;
+        previousFilter.reset();
+        if (!active_) {
+            return false;
+        }
+    }
+    for (const auto& segment : old) {
+        unlink(segment->path.c_str());
+    }
+    return true;
+}
+
+bool CrawlCache::trainDictionaries() {
+    if (options_.dictionaryBytes == 0) {
+        return true;
+    }
+    std::lock_guard<std::mutex> guard(compactionMutex_);
+    auto start = std::chrono::steady_clock::now();
+
+    // Up to dictionarySamples current pages of each domain that is ready
+    std::map<std::string, std::vector<std::string>, std::less<>> samples;
+    {
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        const Index* index = index_.load(std::memory_order_relaxed);
+        if (!index) {
+            return false;
+        }
+        for (const auto& kv : domains_) {
+            if (!kv.second.trained && kv.second.pages >= options_.dictionarySamples && samples.size() < kTrainBatch &&
+                nextDictionary_ + samples.size() < dictionaryCapacity_) {
+                samples[kv.first];
+            }
+        }
+        if (samples.empty()) {
+            return true;
+        }
+        for (size_t i = 0; i < index->capacity(); ++i) {
+            const uint64_t location = index->slots[i].location.load(std::memory_order_relaxed);
+            auto it = location ? segments_.find(location >> kOffsetBits) : segments_.end();
+            if (it == segments_.end()) {
+                continue;
+            }
+            const uint8_t* header = it->second->data + (location & kOffsetMask);
+            RecordView record;
+            if (!parseRecord(header + kRecordHeader, readRaw<uint32_t>(header), record) || record.op != kRecordPut) {
+                continue;
+            }
+            auto domain = samples.find(record.domain);
+            if (domain == samples.end() || domain->second.size() >= options_.dictionarySamples) {
+                continue;
+            }
+            std::string raw(record.rawSize, '\0');
+            if (lzDecompress(record.block, record.blockSize, &raw[0], raw.size())) {
+                domain->second.push_back(std::move(raw));
+            }
+        }
+    }
+
+    bool ok = true;
+    size_t trained = 0;
+    for (const auto& kv : samples) {
+        if (kv.second.size() < 2) {
+            // Most of its pages were replaced or removed; count again from zero
+            std::lock_guard<std::mutex> lock(writeMutex_);
+            domains_[kv.first].pages = 0;
+            continue;
+        }
+        const std::vector<std::string_view> views(kv.second.begin(), kv.second.end());
+        auto dictionary = std::make_unique<LzDictionary>(LzDictionary::train(views, options_.dictionaryBytes));
+        uint32_t id = 0;
+        if (!dictionary->empty()) {
+            {
+                std::lock_guard<std::mutex> lock(writeMutex_);
+                id = nextDictionary_++;
+            }
+            std::string contents(4, '\0');
+            appendRaw<uint16_t>(contents, static_cast<uint16_t>(kv.first.size()));
+            contents += kv.first;
+            contents += dictionary->bytes();
+            const uint32_t crc = crc32c(contents.data() + 4, contents.size() - 4);
+            std::memcpy(&contents[0], &crc, 4);
+            if (!writeFileAtomic(dictionaryPath(id), contents)) {
+                std::cerr << "Failed to write crawl cache dictionary " << dictionaryPath(id) << std::endl;
+                ok = false;
+                id = 0;
+            }
+        }
+
+        // A domain whose pages share nothing is not trained again
+        std::lock_guard<std::mutex> lock(writeMutex_);
+        if (id != 0) {
+            dictionaries_[id].store(dictionary.get(), std::memory_order_release);
+            dictionaryStore_.push_back(std::move(dictionary));
+            ++trained;
+        }
+        DomainState& state = domains_[kv.first];
+        state.dictionary = id;
+        state.trained = true;
+        state.pages = 0;
+    }
+    std::cout << "Trained " << trained << " crawl cache dictionaries in " << millisSince(start) << " ms" << std::endl;
+    return ok;
+}
+
+void CrawlCache::startBackgroundCompaction() {
+    std::lock_guard<std::mutex> lock(backgroundMutex_);
+    if (backgroundRunning_) {
+        return;
+    }
+    backgroundRunning_ = true;
+    backgroundThread_ = std::thread(&CrawlCache::backgroundLoop, this);
+}
+
+void CrawlCache::stopBackgroundCompaction() {
+    {
+        std::lock_guard<std::mutex> lock(backgroundMutex_);
+        if (!backgroundRunning_) {
+            return;
+        }
+        backgroundRunning_ = false;
+        backgroundCv_.notify_one();
+    }
+    if (backgroundThread_.joinable()) {
+        backgroundThread_.join();
+    }
+}
+
+void CrawlCache::backgroundLoop() {
+    std::unique_lock<std::mutex> lock(backgroundMutex_);
+    while (backgroundRunning_) {
+        backgroundCv_.wait_for(lock, std::chrono::seconds(options_.compactIntervalSeconds),
+                               [this] { return !backgroundRunning_; });
+        if (!backgroundRunning_) {
+            break;
+        }
+        lock.unlock();
+        trainDictionaries();
+        compact(false);
+        lock.lock();
+    }
+}
+
+// ─── Statistics ─────────────────────────────────────────────────────────────
+
+size_t CrawlCache::countFresh(double maxAgeSeconds) const {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    const Index* index = index_.load(std::memory_order_relaxed);
+    if (!index) {
+        return 0;
+    }
+    const double cutoff = wallClockSeconds() - maxAgeSeconds;
+    size_t fresh = 0;
+    for (size_t i = 0; i < index->capacity(); ++i) {
+        const uint64_t location = index->slots[i].location.load(std::memory_order_relaxed);
+        auto it = location ? segments_.find(location >> kOffsetBits) : segments_.end();
+        if (it != segments_.end()) {
+            const uint8_t* payload = it->second->data + (location & kOffsetMask) + kRecordHeader;
+            fresh += readRaw<double>(payload + 9) > cutoff;
+        }
+    }
+    return fresh;
+}
+
+std::vector<std::pair<std::string, size_t>> CrawlCache::topDomains(size_t limit) const {
+    std::unordered_map<std::string_view, size_t> counts;
+    std::vector<std::pair<std::string, size_t>> result;
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    const Index* index = index_.load(std::memory_order_relaxed);
+    if (!index) {
+        return result;
+    }
+    for (size_t i = 0; i < index->capacity(); ++i) {
+        const uint64_t location = index->slots[i].location.load(std::memory_order_relaxed);
+        auto it = location ? segments_.find(location >> kOffsetBits) : segments_.end();
+        if (it == segments_.end()) {
+            continue;
+        }
+        const uint8_t* header = it->second->data + (location & kOffsetMask);
+        RecordView record;
+        if (parseRecord(header + kRecordHeader, readRaw<uint32_t>(header), record)) {
+            ++counts[record.domain];
+        }
+    }
+    for (const auto& kv : counts) {
+        result.emplace_back(std::string(kv.first), kv.second);
+    }
+    std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    if (result.size() > limit) {
+        result.resize(limit);
+    }
+    return result;
+}
+
+CrawlCacheStats CrawlCache::stats() const {
+    CrawlCacheStats s;
+    for (const ReaderStripe& stripe : readers_) {
+        s.hits += stripe.hits.load(std::memory_order_relaxed);
+        s.misses += stripe.misses.load(std::memory_order_relaxed);
+        s.expired += stripe.expired.load(std::memory_order_relaxed);
+        s.decodedBytes += stripe.decodedBytes.load(std::memory_order_relaxed);
+        s.decodeMillis += stripe.decodeNanos.load(std::memory_order_relaxed) / 1e6;
+        s.filterNegatives += stripe.filtered.load(std::memory_order_relaxed);
+        s.filterFalsePositives += stripe.falsePositives.load(std::memory_order_relaxed);
+    }
+    s.puts = puts_.load();
+    s.compactions = compactions_.load();
+    s.droppedRecords = droppedRecords_.load();
+    s.openMillis = openMillis_;
+    s.lastCompactionMillis = lastCompactionMillis_.load();
+
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    const Index* index = index_.load(std::memory_order_relaxed);
+    s.entries = index ? index->live : 0;
+    s.segments = segments_.size();
+    for (const auto& kv : segments_) {
+        s.segmentBytes += kv.second->size;
+        s.liveBytes += kv.second->liveBytes;
+    }
+    s.rawBytes = rawBytes_;
+    s.dictionaries = dictionaryStore_.size();
+    if (const CuckooFilter* filter = filter_.load(std::memory_order_relaxed)) {
+        s.filterBytes = filter->memoryBytes();
+        s.filterLoad = filter->load();
+        s.filterExpectedFpr = filter->expectedFalsePositiveRate();
+    }
+    return s;
+}
@@ -0,0 +1,241 @@
+#include "crawl_cache_service.h"
+#include "config_manager.h"
+#include "json_util.h"
+#include "json_writer.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+
+typedef std::map<std::string, std::string> Params;
+
+// Columns of the crawler's cache table returned by /cache/page, besides url, crawled_at and source_domain
+const char* const kTextColumns[] = {"content", "markdown", "title", "author", "published",
+                                    "language", "error_type", "error_message"};
+const char* const kHeaderPrefix = "headers.";
+
+std::string param(const Params& params, const std::string& key, const std::string& defaultValue = "") {
+    auto it = params.find(key);
+    return it != params.end() ? it->second : defaultValue;
+}
+
+std::string error(const std::string& message) {
+    std::string out = "{\"error\": ";
+    appendJsonString(out, message);
+    out += "}";
+    return out;
+}
+
+double parseDouble(const std::string& text, double defaultValue) {
+    char* end = nullptr;
+    double value = std::strtod(text.c_str(), &end);
+    return end != text.c_str() && *end == '\0' ? value : defaultValue;
+}
+
+double wallClockSeconds() {
+    return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+CrawlCacheService::CrawlCacheService() {}
+
+CrawlCacheService::~CrawlCacheService() {
+    shutdown();
+}
+
+bool CrawlCacheService::initialize(const ConfigManager& config) {
+    CrawlCacheOptions options;
+    options.directory = config.get("CRAWL_CACHE_DIR", options.directory);
+    options.ttlSeconds = parseDouble(config.get("CRAWL_CACHE_TTL"), options.ttlSeconds);
+    const int segmentMb = config.getInt("CRAWL_CACHE_SEGMENT_MB", static_cast<int>(options.segmentBytes >> 20));
+    options.compactGarbageRatio =
+        parseDouble(config.get("CRAWL_CACHE_GARBAGE_RATIO"), options.compactGarbageRatio);
+    options.compactIntervalSeconds = config.getInt("CRAWL_CACHE_COMPACT_INTERVAL", options.compactIntervalSeconds);
+    options.syncWrites = config.getBool("CRAWL_CACHE_SYNC_WRITES", options.syncWrites);
+    options.filter = config.getBool("CRAWL_CACHE_FILTER", options.filter);
+    const int dictionaryBytes =
+        config.getInt("CRAWL_CACHE_DICTIONARY_BYTES", static_cast<int>(options.dictionaryBytes));
+    const int dictionarySamples =
+        config.getInt("CRAWL_CACHE_DICTIONARY_SAMPLES", static_cast<int>(options.dictionarySamples));
+    if (options.ttlSeconds <= 0 || segmentMb < 1 || options.compactGarbageRatio <= 0 ||
+        options.compactGarbageRatio > 1 || options.compactIntervalSeconds < 1) {
+        std::cerr << "CRAWL_CACHE_TTL, CRAWL_CACHE_SEGMENT_MB and CRAWL_CACHE_COMPACT_INTERVAL must be positive "
+                     "and CRAWL_CACHE_GARBAGE_RATIO within (0, 1]"
+                  << std::endl;
+        return false;
+    }
+    if (dictionaryBytes < 0 || static_cast<size_t>(dictionaryBytes) > LzDictionary::kMaxSize ||
+        dictionarySamples < 2) {
+        std::cerr << "CRAWL_CACHE_DICTIONARY_BYTES must be within [0, " << LzDictionary::kMaxSize
+                  << "] and CRAWL_CACHE_DICTIONARY_SAMPLES at least 2" << std::endl;
+        return false;
+    }
+    options.segmentBytes = static_cast<size_t>(segmentMb) << 20;
+    options.dictionaryBytes = static_cast<size_t>(dictionaryBytes);
+    options.dictionarySamples = static_cast<size_t>(dictionarySamples);
+
+    if (!cache_.open(options)) {
+        std::cerr << "Failed to open crawl cache at " << options.directory << std::endl;
+        return false;
+    }
+    cache_.startBackgroundCompaction();
+    return true;
+}
+
+void CrawlCacheService::shutdown() {
+    cache_.close();
+}
+
+void CrawlCacheService::registerRoutes(HttpServer& server) {
+    server.getJson("/cache/page", [this](const Params& params, JsonWriter& out) { handlePage(params, out); });
+    server.get("/cache/contains", [this](const Params& params) { return handleContains(params); });
+    server.post("/cache/put", [this](const Params& params) { return handlePut(params); });
+    server.post("/cache/delete", [this](const Params& params) { return handleDelete(params); });
+    server.get("/cache/stats", [this](const Params& params) { return handleStats(params); });
+    server.post("/cache/clear", [this](const Params& params) { return handleClear(params); });
+    server.post("/cache/compact", [this](const Params& params) { return handleCompact(params); });
+}
+
+void CrawlCacheService::handlePage(const Params& params, JsonWriter& out) {
+    const std::string url = param(params, "url");
+    out.beginObject();
+    if (url.empty()) {
+        out.member("error", "url is required");
+        out.endObject();
+        return;
+    }
+    const double ttl = parseDouble(param(params, "ttl"), cache_.options().ttlSeconds);
+    CrawlPage page;
+    if (!cache_.get(url, ttl, page)) {
+        out.member("hit", false);
+        out.endObject();
+        return;
+    }
+
+    out.member("hit", true);
+    out.member("url", page.url);
+    for (const char* column : kTextColumns) {
+        auto it = page.fields.find(column);
+        out.key(column);
+        if (it != page.fields.end()) {
+            out.string(it->second);
+        } else {
+            out.null();
+        }
+    }
+    auto wordCount = page.fields.find("word_count");
+    out.member("word_count",
+               wordCount != page.fields.end() ? std::strtoll(wordCount->second.c_str(), nullptr, 10) : 0LL);
+    auto success = page.fields.find("success");
+    out.member("success", success == page.fields.end() || success->second == "true" || success->second == "1");
+    out.member("crawled_at", page.crawledAt);
+
+    // headers.<name> fields go back together, as the crawler's headers_json column
+    std::string headers = "{";
+    for (auto it = page.fields.lower_bound(kHeaderPrefix);
+         it != page.fields.end() && it->first.compare(0, 8, kHeaderPrefix) == 0; ++it) {
+        if (headers.size() > 1) {
+            headers += ", ";
+        }
+        appendJsonString(headers, it->first.substr(8));
+        headers += ": ";
+        appendJsonString(headers, it->second);
+    }
+    out.member("headers_json", headers + "}");
+    out.member("source_domain", page.sourceDomain);
+    out.endObject();
+}
+
+std::string CrawlCacheService::handleContains(const Params& params) {
+    const std::string url = param(params, "url");
+    if (url.empty()) {
+        return error("url is required");
+    }
+    const double ttl = parseDouble(param(params, "ttl"), cache_.options().ttlSeconds);
+    return cache_.contains(url, ttl) ? "{\"cached\": true}" : "{\"cached\": false}";
+}
+
+std::string CrawlCacheService::handlePut(const Params& params) {
+    CrawlPage page;
+    page.url = param(params, "url");
+    if (page.url.empty()) {
+        return error("url is required");
+    }
+    page.sourceDomain = param(params, "source_domain");
+    page.crawledAt = parseDouble(param(params, "crawled_at"), wallClockSeconds());
+    for (const auto& kv : params) {
+        if (kv.first != "url" && kv.first != "source_domain" && kv.first != "crawled_at") {
+            page.fields.insert(kv);
+        }
+    }
+    return cache_.put(page) ? "{\"stored\": true}" : error("cache write failed");
+}
+
+std::string CrawlCacheService::handleDelete(const Params& params) {
+    const std::string url = param(params, "url");
+    if (url.empty()) {
+        return error("url is required");
+    }
+    return cache_.remove(url) ? "{\"deleted\": true}" : "{\"deleted\": false}";
+}
+
+std::string CrawlCacheService::handleStats(const Params&) {
+    CrawlCacheStats s = cache_.stats();
+    std::string out = "{\"total_entries\": " + std::to_string(s.entries);
+    out += ", \"fresh_entries\": " + std::to_string(cache_.countFresh(cache_.options().ttlSeconds));
+    out += ", \"domains\": [";
+    bool first = true;
+    for (const auto& domain : cache_.topDomains(20)) {
+        out += first ? "{\"domain\": " : ", {\"domain\": ";
+        appendJsonString(out, domain.first);
+        out += ", \"count\": " + std::to_string(domain.second) + "}";
+        first = false;
+    }
+    out += "], \"segments\": " + std::to_string(s.segments);
+    out += ", \"segment_bytes\": " + std::to_string(s.segmentBytes);
+    out += ", \"live_bytes\": " + std::to_string(s.liveBytes);
+    out += ", \"raw_bytes\": " + std::to_string(s.rawBytes);
+    out += ", \"compression_ratio\": ";
+    appendJsonNumber(out, s.liveBytes ? static_cast<double>(s.rawBytes) / s.liveBytes : 0.0);
+    out += ", \"hits\": " + std::to_string(s.hits);
+    out += ", \"misses\": " + std::to_string(s.misses);
+    out += ", \"expired\": " + std::to_string(s.expired);
+    out += ", \"puts\": " + std::to_string(s.puts);
+    out += ", \"dictionaries\": " + std::to_string(s.dictionaries);
+    out += ", \"decoded_bytes\": " + std::to_string(s.decodedBytes);
+    out += ", \"decode_mb_per_s\": ";
+    appendJsonNumber(out, s.decodeMillis > 0 ? s.decodedBytes / 1e3 / s.decodeMillis : 0.0);
+    out += ", \"filter_bytes\": " + std::to_string(s.filterBytes);
+    out += ", \"filter_load\": ";
+    appendJsonNumber(out, s.filterLoad);
+    out += ", \"filter_expected_fpr\": ";
+    appendJsonNumber(out, s.filterExpectedFpr);
+    out += ", \"filter_observed_fpr\": ";
+    const uint64_t absent = s.filterNegatives + s.filterFalsePositives;
+    appendJsonNumber(out, absent ? static_cast<double>(s.filterFalsePositives) / absent : 0.0);
+    out += ", \"filter_negatives\": " + std::to_string(s.filterNegatives);
+    out += ", \"filter_false_positives\": " + std::to_string(s.filterFalsePositives);
+    out += ", \"compactions\": " + std::to_string(s.compactions);
+    out += ", \"dropped_records\": " + std::to_string(s.droppedRecords);
+    out += ", \"open_ms\": ";
+    appendJsonNumber(out, s.openMillis);
+    out += ", \"last_compaction_ms\": ";
+    appendJsonNumber(out, s.lastCompactionMillis);
+    out += "}";
+    return out;
+}
+
+std::string CrawlCacheService::handleClear(const Params&) {
+    return cache_.clear() ? "{\"cleared\": true}" : error("cache clear failed");
+}
+
+std::string CrawlCacheService::handleCompact(const Params& params) {
+    // A forced compaction trains pending dictionaries first, so it also recompresses with them
+    const bool force = param(params, "force") == "true";
+    if (force && !cache_.trainDictionaries()) {
+        return error("dictionary training failed");
+    }
+    return cache_.compact(force) ? handleStats(Params()) : error("compaction failed");
+}
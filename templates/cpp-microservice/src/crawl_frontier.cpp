@@ -0,0 +1,327 @@
+#include "crawl_frontier.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+
+CrawlFrontier::CrawlFrontier(const CrawlFrontierOptions& options)
+    : options_(options), freeEntry_(kNone), heapSeq_(0), urlBytes_(0) {
+    std::fill(credits_, credits_ + kClasses, 0);
+}
+
+uint64_t CrawlFrontier::steadyMillis() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
+
+std::string CrawlFrontier::hostOf(std::string_view url) {
+    const size_t scheme = url.find("://");
+    if (scheme == std::string_view::npos || scheme == 0) {
+        return std::string();
+    }
+    for (size_t i = 0; i < scheme; ++i) {
+        const unsigned char c = static_cast<unsigned char>(url[i]);
+        if (!std::isalnum(c) && c != '+' && c != '-' && c != '.') {
+            return std::string();
+        }
+    }
+    std::string_view authority = url.substr(scheme + 3);
+    authority = authority.substr(0, authority.find_first_of("/?#"));
+    const size_t at = authority.rfind('@');
+    if (at != std::string_view::npos) {
+        authority.remove_prefix(at + 1);
+    }
+    std::string_view host;
+    if (!authority.empty() && authority[0] == '[') {
+        const size_t close = authority.find(']');
+        host = close == std::string_view::npos ? std::string_view() : authority.substr(1, close - 1);
+    } else {
+        host = authority.substr(0, authority.find(':'));
+    }
+    if (!host.empty() && host.back() == '.') {
+        host.remove_suffix(1);
+    }
+    std::string out(host);
+    for (char& c : out) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return out;
+}
+
+// Move the wheel to @p nowMillis: delayed URLs join their queues, idle hosts past their interval are dropped
+void CrawlFrontier::advance(uint64_t nowMillis) {
+    fired_.clear();
+    wheel_.advance(nowMillis, fired_);
+    for (const TimerWheel::Timer& timer : fired_) {
+        if (timer.payload & kDomainTimer) {
+            const uint32_t domain = static_cast<uint32_t>(timer.payload & ~kDomainTimer);
+            domains_[domain].idleTimer = false;
+            releaseIfIdle(domain, nowMillis);
+            continue;
+        }
+        Entry& entry = entries_[timer.payload];
+        entry.readyAt = timer.due;
+        --domains_[entry.domain].delayed;
+        --counters_.delayed;
+        enqueue(static_cast<uint32_t>(timer.payload));
+    }
+}
+
+uint32_t CrawlFrontier::domainFor(const std::string& host) {
+    auto it = domainIndex_.find(host);
+    if (it != domainIndex_.end()) {
+        return it->second;
+    }
+    uint32_t index;
+    if (!freeDomains_.empty()) {
+        index = freeDomains_.back();
+        freeDomains_.pop_back();
+        domains_[index] = Domain();
+    } else {
+        index = static_cast<uint32_t>(domains_.size());
+        domains_.emplace_back();
+    }
+    Domain& domain = domains_[index];
+    domain.host = host;
+    auto interval = intervals_.find(host);
+    domain.intervalMillis = interval != intervals_.end() ? interval->second : options_.domainIntervalMillis;
+    domainIndex_.emplace(host, index);
+    return index;
+}
+
+void CrawlFrontier::enqueue(uint32_t index) {
+    const Entry& entry = entries_[index];
+    Domain& domain = domains_[entry.domain];
+    Queue& queue = domain.queues[static_cast<int>(entry.priority)];
+    entries_[index].next = kNone;
+    if (queue.tail == kNone) {
+        queue.head = index;
+    } else {
+        entries_[queue.tail].next = index;
+    }
+    queue.tail = index;
+    ++domain.queued;
+    ++counters_.queued;
+    schedule(entry.domain);
+}
+
+// Put a host with queued URLs and a free lease slot in the ready heap of its most urgent class
+void CrawlFrontier::schedule(uint32_t index) {
+    Domain& domain = domains_[index];
+    if (domain.queued == 0 || domain.leased >= options_.domainConcurrency) {
+        return;
+    }
+    int priority = 0;
+    while (domain.queues[priority].head == kNone) {
+        ++priority;
+    }
+    if (domain.heapSeq != 0) {
+        // Its item stays valid until a lease pops it; only a more urgent class moves it
+        if (domain.heapClass <= priority) {
+            return;
+        }
+    } else {
+        ++counters_.readyDomains;
+    }
+    domain.heapSeq = ++heapSeq_;
+    domain.heapClass = priority;
+    heaps_[priority].push_back(HeapItem{domain.nextAllowed, domain.heapSeq, index});
+    std::push_heap(heaps_[priority].begin(), heaps_[priority].end());
+}
+
+void CrawlFrontier::releaseIfIdle(uint32_t index, uint64_t nowMillis) {
+    Domain& domain = domains_[index];
+    if (domain.host.empty() || domain.queued || domain.delayed || domain.leased) {
+        return;
+    }
+    if (domain.nextAllowed > nowMillis) {
+        // Forgetting the host now would let its next URL skip the rest of the interval
+        if (!domain.idleTimer) {
+            domain.idleTimer = true;
+            wheel_.schedule(domain.nextAllowed, kDomainTimer | index);
+        }
+        return;
+    }
+    domainIndex_.erase(domain.host);
+    domain.host.clear();
+    domain.host.shrink_to_fit();
+    freeDomains_.push_back(index);
+}
+
+// Drop items left behind in a heap by hosts that were leased or moved to a more urgent class
+void CrawlFrontier::dropStale(int priority) {
+    std::vector<HeapItem>& heap = heaps_[priority];
+    while (!heap.empty() && domains_[heap.front().domain].heapSeq != heap.front().seq) {
+        std::pop_heap(heap.begin(), heap.end());
+        heap.pop_back();
+    }
+}
+
+// Smooth weighted round-robin (as nginx upstreams) over the classes with a host ready now
+int CrawlFrontier::pickClass(uint64_t nowMillis) {
+    int64_t total = 0;
+    int best = -1;
+    for (int priority = 0; priority < kClasses; ++priority) {
+        dropStale(priority);
+        if (heaps_[priority].empty() || heaps_[priority].front().nextAllowed > nowMillis) {
+            continue;
+        }
+        const int64_t weight = std::max<uint32_t>(options_.classWeights[priority], 1);
+        credits_[priority] += weight;
+        total += weight;
+        if (best < 0 || credits_[priority] > credits_[best]) {
+            best = priority;
+        }
+    }
+    if (best >= 0) {
+        credits_[best] -= total;
+    }
+    return best;
+}
+
+bool CrawlFrontier::push(std::string_view url, CrawlPriority priority, uint64_t nowMillis, uint64_t delayMillis) {
+    const std::string host = hostOf(url);
+    if (host.empty() || static_cast<int>(priority) >= kClasses) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (counters_.queued + counters_.delayed >= options_.maxPending) {
+        ++counters_.rejected;
+        return false;
+    }
+    advance(nowMillis);
+
+    uint32_t index = freeEntry_;
+    if (index != kNone) {
+        freeEntry_ = entries_[index].next;
+    } else {
+        index = static_cast<uint32_t>(entries_.size());
+        entries_.emplace_back();
+    }
+    Entry& entry = entries_[index];
+    entry.url.assign(url.data(), url.size());
+    entry.domain = domainFor(host);
+    entry.priority = priority;
+    entry.readyAt = nowMillis;
+    urlBytes_ += entry.url.capacity();
+    ++counters_.pushed;
+    if (delayMillis > 0) {
+        ++domains_[entry.domain].delayed;
+        ++counters_.delayed;
+        wheel_.schedule(nowMillis + delayMillis, index);
+    } else {
+        enqueue(index);
+    }
+    return true;
+}
+
+size_t CrawlFrontier::lease(size_t max, uint64_t nowMillis, std::vector<FrontierLease>& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    advance(nowMillis);
+    size_t leased = 0;
+    while (leased < max) {
+        const int priority = pickClass(nowMillis);
+        if (priority < 0) {
+            break;
+        }
+        std::vector<HeapItem>& heap = heaps_[priority];
+        const uint32_t index = heap.front().domain;
+        std::pop_heap(heap.begin(), heap.end());
+        heap.pop_back();
+
+        Domain& domain = domains_[index];
+        domain.heapSeq = 0;
+        --counters_.readyDomains;
+        Queue& queue = domain.queues[priority];
+        const uint32_t taken = queue.head;
+        Entry& entry = entries_[taken];
+        queue.head = entry.next;
+        if (queue.head == kNone) {
+            queue.tail = kNone;
+        }
+        --domain.queued;
+        ++domain.leased;
+        domain.nextAllowed = nowMillis + domain.intervalMillis;
+
+        FrontierLease lease;
+        lease.url = std::move(entry.url);
+        lease.host = domain.host;
+        lease.priority = entry.priority;
+        lease.waitedMillis = nowMillis > entry.readyAt ? nowMillis - entry.readyAt : 0;
+        counters_.maxWaitMillis = std::max(counters_.maxWaitMillis, lease.waitedMillis);
+        urlBytes_ -= lease.url.capacity();
+        entry.url = std::string();
+        entry.next = freeEntry_;
+        freeEntry_ = taken;
+        out.push_back(std::move(lease));
+
+        --counters_.queued;
+        ++counters_.leased;
+        ++counters_.leases;
+        ++counters_.leasesByClass[priority];
+        ++leased;
+        schedule(index);
+    }
+    return leased;
+}
+
+bool CrawlFrontier::finish(std::string_view host, uint64_t nowMillis) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    advance(nowMillis);
+    auto it = domainIndex_.find(std::string(host));
+    if (it == domainIndex_.end() || domains_[it->second].leased == 0) {
+        return false;
+    }
+    const uint32_t index = it->second;
+    --domains_[index].leased;
+    --counters_.leased;
+    schedule(index);
+    releaseIfIdle(index, nowMillis);
+    return true;
+}
+
+void CrawlFrontier::setDomainInterval(std::string_view host, uint64_t intervalMillis) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::string key(host);
+    if (intervalMillis > 0) {
+        intervals_[key] = intervalMillis;
+    } else {
+        intervals_.erase(key);
+    }
+    auto it = domainIndex_.find(key);
+    if (it != domainIndex_.end()) {
+        domains_[it->second].intervalMillis = intervalMillis > 0 ? intervalMillis : options_.domainIntervalMillis;
+    }
+}
+
+int64_t CrawlFrontier::waitMillis(uint64_t nowMillis) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    advance(nowMillis);
+    int64_t wait = -1;
+    for (int priority = 0; priority < kClasses; ++priority) {
+        dropStale(priority);
+        if (!heaps_[priority].empty()) {
+            const uint64_t allowed = heaps_[priority].front().nextAllowed;
+            const int64_t until = allowed > nowMillis ? static_cast<int64_t>(allowed - nowMillis) : 0;
+            wait = wait < 0 ? until : std::min(wait, until);
+        }
+    }
+    if (counters_.delayed > 0) {
+        // May wake early, for an idle host's timer or a wheel redistribution
+        const int64_t until = static_cast<int64_t>(wheel_.nextWait());
+        wait = wait < 0 ? until : std::min(wait, until);
+    }
+    return wait;
+}
+
+CrawlFrontierStats CrawlFrontier::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CrawlFrontierStats s = counters_;
+    s.domains = domainIndex_.size();
+    s.memoryBytes = entries_.capacity() * sizeof(Entry) + urlBytes_ + domains_.capacity() * sizeof(Domain) +
+                    wheel_.memoryBytes();
+    for (int priority = 0; priority < kClasses; ++priority) {
+        s.memoryBytes += heaps_[priority].capacity() * sizeof(HeapItem);
+    }
+    return s;
+}
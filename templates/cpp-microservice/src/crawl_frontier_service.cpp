@@ -0,0 +1,204 @@
+#include "crawl_frontier_service.h"
+#include "config_manager.h"
+#include "json_util.h"
+#include "robots_cache.h"
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+
+typedef std::map<std::string, std::string> Params;
+
+const long kMaxLeasesPerRequest = 1000;
+const char* const kPriorityNames[] = {"interactive", "batch", "background"};
+
+std::string param(const Params& params, const std::string& key, const std::string& defaultValue = "") {
+    auto it = params.find(key);
+    return it != params.end() ? it->second : defaultValue;
+}
+
+std::string error(const std::string& message) {
+    std::string out = "{\"error\": ";
+    appendJsonString(out, message);
+    out += "}";
+    return out;
+}
+
+// Non-negative integer parameter; -1 if it is malformed
+long long parseCount(const std::string& text, long long defaultValue) {
+    if (text.empty()) {
+        return defaultValue;
+    }
+    char* end = nullptr;
+    const long long value = std::strtoll(text.c_str(), &end, 10);
+    return *end == '\0' && value >= 0 ? value : -1;
+}
+
+bool parsePriority(const std::string& text, CrawlPriority& priority) {
+    for (int i = 0; i < 3; ++i) {
+        if (text == kPriorityNames[i]) {
+            priority = static_cast<CrawlPriority>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+CrawlFrontierService::CrawlFrontierService() : frontier_(new CrawlFrontier()), robots_(nullptr) {}
+
+bool CrawlFrontierService::initialize(const ConfigManager& config) {
+    CrawlFrontierOptions options;
+    const int interval = config.getInt("FRONTIER_DOMAIN_INTERVAL_MS", static_cast<int>(options.domainIntervalMillis));
+    const int concurrency = config.getInt("FRONTIER_DOMAIN_CONCURRENCY", static_cast<int>(options.domainConcurrency));
+    const int maxPending = config.getInt("FRONTIER_MAX_PENDING", static_cast<int>(options.maxPending));
+    const int weights[3] = {
+        config.getInt("FRONTIER_WEIGHT_INTERACTIVE", static_cast<int>(options.classWeights[0])),
+        config.getInt("FRONTIER_WEIGHT_BATCH", static_cast<int>(options.classWeights[1])),
+        config.getInt("FRONTIER_WEIGHT_BACKGROUND", static_cast<int>(options.classWeights[2]))};
+    if (interval < 0 || concurrency < 1 || maxPending < 1 || weights[0] < 1 || weights[1] < 1 || weights[2] < 1) {
+        std::cerr << "FRONTIER_DOMAIN_INTERVAL_MS must be non-negative and FRONTIER_DOMAIN_CONCURRENCY, "
+                     "FRONTIER_MAX_PENDING and FRONTIER_WEIGHT_* positive"
+                  << std::endl;
+        return false;
+    }
+    options.domainIntervalMillis = static_cast<uint64_t>(interval);
+    options.domainConcurrency = static_cast<size_t>(concurrency);
+    options.maxPending = static_cast<size_t>(maxPending);
+    for (int i = 0; i < 3; ++i) {
+        options.classWeights[i] = static_cast<uint32_t>(weights[i]);
+    }
+    frontier_.reset(new CrawlFrontier(options));
+    return true;
+}
+
+void CrawlFrontierService::registerRoutes(HttpServer& server) {
+    server.post("/frontier/push", [this](const Params& params) { return handlePush(params); });
+    server.post("/frontier/lease", [this](const Params& params) { return handleLease(params); });
+    server.post("/frontier/done", [this](const Params& params) { return handleDone(params); });
+    server.post("/frontier/domain", [this](const Params& params) { return handleDomain(params); });
+    server.get("/frontier/stats", [this](const Params& params) { return handleStats(params); });
+}
+
+std::string CrawlFrontierService::handlePush(const Params& params) {
+    std::map<size_t, std::string_view> indexed;
+    if (!indexedParams(params, "urls.", kMaxParamIndex, indexed)) {
+        return error("bad index");
+    }
+    auto single = params.find("url");
+    if (single != params.end()) {
+        indexed[indexed.empty() ? 0 : indexed.rbegin()->first + 1] = single->second;
+    }
+    if (indexed.empty()) {
+        return error("url or urls.<i> required");
+    }
+    CrawlPriority priority = CrawlPriority::Batch;
+    if (!parsePriority(param(params, "priority", "batch"), priority)) {
+        return error("priority must be interactive, batch or background");
+    }
+    const long long delay = parseCount(param(params, "delay_ms"), 0);
+    if (delay < 0) {
+        return error("delay_ms must be a non-negative integer");
+    }
+
+    const uint64_t now = CrawlFrontier::steadyMillis();
+    size_t queued = 0;
+    std::string rejected = "[";
+    std::string disallowed = "[";
+    for (const auto& kv : indexed) {
+        // Origins with no rules cached yet are queued; /robots/check names the robots.txt to fetch
+        if (robots_ && robots_->check(kv.second, now) == RobotsVerdict::Disallowed) {
+            if (disallowed.size() > 1) {
+                disallowed += ", ";
+            }
+            appendJsonString(disallowed, kv.second);
+            continue;
+        }
+        if (frontier_->push(kv.second, priority, now, static_cast<uint64_t>(delay))) {
+            ++queued;
+            continue;
+        }
+        if (rejected.size() > 1) {
+            rejected += ", ";
+        }
+        appendJsonString(rejected, kv.second);
+    }
+    std::string out = "{\"queued\": " + std::to_string(queued) + ", \"rejected\": " + rejected + "]";
+    if (robots_) {
+        out += ", \"disallowed\": " + disallowed + "]";
+    }
+    return out + "}";
+}
+
+std::string CrawlFrontierService::handleLease(const Params& params) {
+    const long long max = parseCount(param(params, "max"), 1);
+    if (max < 1 || max > kMaxLeasesPerRequest) {
+        return error("max must be within [1, " + std::to_string(kMaxLeasesPerRequest) + "]");
+    }
+    const uint64_t now = CrawlFrontier::steadyMillis();
+    std::vector<FrontierLease> leases;
+    frontier_->lease(static_cast<size_t>(max), now, leases);
+
+    std::string out = "{\"leases\": [";
+    for (size_t i = 0; i < leases.size(); ++i) {
+        out += i ? ", {\"url\": " : "{\"url\": ";
+        appendJsonString(out, leases[i].url);
+        out += ", \"host\": ";
+        appendJsonString(out, leases[i].host);
+        out += ", \"priority\": ";
+        appendJsonString(out, kPriorityNames[static_cast<int>(leases[i].priority)]);
+        out += ", \"waited_ms\": " + std::to_string(leases[i].waitedMillis) + "}";
+    }
+    // -1: nothing will become ready by waiting, only by /frontier/push or /frontier/done
+    out += "], \"wait_ms\": " + std::to_string(frontier_->waitMillis(now)) + "}";
+    return out;
+}
+
+std::string CrawlFrontierService::handleDone(const Params& params) {
+    std::string host = param(params, "host");
+    if (host.empty()) {
+        host = CrawlFrontier::hostOf(param(params, "url"));
+    }
+    if (host.empty()) {
+        return error("host or url is required");
+    }
+    return frontier_->finish(host, CrawlFrontier::steadyMillis()) ? "{\"released\": true}"
+                                                                  : "{\"released\": false}";
+}
+
+std::string CrawlFrontierService::handleDomain(const Params& params) {
+    const std::string host = param(params, "host");
+    const long long interval = parseCount(param(params, "interval_ms"), -1);
+    if (host.empty() || interval < 0) {
+        return error("host and a non-negative interval_ms are required");
+    }
+    frontier_->setDomainInterval(host, static_cast<uint64_t>(interval));
+    std::string out = "{\"host\": ";
+    appendJsonString(out, host);
+    const uint64_t effective =
+        interval > 0 ? static_cast<uint64_t>(interval) : frontier_->options().domainIntervalMillis;
+    out += ", \"interval_ms\": " + std::to_string(effective) + "}";
+    return out;
+}
+
+std::string CrawlFrontierService::handleStats(const Params&) {
+    CrawlFrontierStats s = frontier_->stats();
+    std::string out = "{\"queued\": " + std::to_string(s.queued);
+    out += ", \"delayed\": " + std::to_string(s.delayed);
+    out += ", \"leased\": " + std::to_string(s.leased);
+    out += ", \"domains\": " + std::to_string(s.domains);
+    out += ", \"ready_domains\": " + std::to_string(s.readyDomains);
+    out += ", \"pushed\": " + std::to_string(s.pushed);
+    out += ", \"rejected\": " + std::to_string(s.rejected);
+    out += ", \"leases\": " + std::to_string(s.leases);
+    out += ", \"leases_by_priority\": {";
+    for (int i = 0; i < 3; ++i) {
+        out += i ? ", \"" : "\"";
+        out += kPriorityNames[i];
+        out += "\": " + std::to_string(s.leasesByClass[i]);
+    }
+    out += "}, \"max_wait_ms\": " + std::to_string(s.maxWaitMillis);
+    out += ", \"memory_bytes\": " + std::to_string(s.memoryBytes) + "}";
+    return out;
+}
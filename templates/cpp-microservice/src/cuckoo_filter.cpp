@@ -0,0 +1,295 @@
+#include "cuckoo_filter.h"
+#include "checksum.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char kMagic[8] = {'C', 'U', 'C', 'K', 'O', 'O', 'F', '1'};
+const size_t kHeaderPage = 4096;
+const size_t kMinBuckets = 16;
+const size_t kMaxSearch = 512;    // Buckets an insert visits looking for a free slot
+const uint64_t kLanes = 0x0001000100010001ULL;
+const uint64_t kLaneHighBits = 0x8000800080008000ULL;
+
+static_assert(sizeof(CuckooFilterHeader) <= kHeaderPage, "cuckoo filter header fits its page");
+static_assert(sizeof(std::atomic<uint64_t>) == 8 && std::atomic<uint64_t>::is_always_lock_free,
+              "buckets are mapped as lock-free 64-bit atomics");
+
+// 0 marks a free slot
+uint16_t fingerprintOf(uint64_t hash) {
+    const uint16_t fingerprint = static_cast<uint16_t>(hash >> 48);
+    return fingerprint ? fingerprint : 1;
+}
+
+// Whether any of the four 16-bit slots of a bucket equals the fingerprint
+bool hasSlot(uint64_t bucket, uint16_t fingerprint) {
+    const uint64_t x = bucket ^ (fingerprint * kLanes);
+    return ((x - kLanes) & ~x & kLaneHighBits) != 0;
+}
+
+uint16_t slotOf(uint64_t bucket, size_t slot) {
+    return static_cast<uint16_t>(bucket >> (16 * slot));
+}
+
+// The fingerprint's other bucket; applying it twice gives back the first
+uint64_t alternate(uint64_t bucket, uint16_t fingerprint, uint64_t mask) {
+    return (bucket ^ (fingerprint * 0x5bd1e995ULL)) & mask;
+}
+
+} // namespace
+
+CuckooFilter::CuckooFilter()
+    : mapping_(nullptr), mappedBytes_(0), buckets_(nullptr), mask_(0), count_(0), version_(0) {}
+
+CuckooFilter::~CuckooFilter() {
+    close();
+}
+
+bool CuckooFilter::map(int fd, size_t bytes) {
+    // Populated up front: a lookup must never wait on a page fault from disk
+    void* p = fd >= 0 ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0)
+                      : mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        return false;
+    }
+    mapping_ = static_cast<uint8_t*>(p);
+    mappedBytes_ = bytes;
+    buckets_ = reinterpret_cast<std::atomic<uint64_t>*>(mapping_ + kHeaderPage);
+    mask_ = (bytes - kHeaderPage) / 8 - 1;
+    return true;
+}
+
+bool CuckooFilter::create(const std::string& path, size_t capacity) {
+    close();
+    size_t buckets = kMinBuckets;
+    while (buckets * kSlotsPerBucket < capacity) {
+        buckets <<= 1;
+    }
+    const size_t bytes = kHeaderPage + buckets * 8;
+    if (path.empty()) {
+        if (!map(-1, bytes)) {
+            std::cerr << "Failed to allocate a " << bytes << "-byte cuckoo filter" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Built under a temporary name, so a reader of the old file never sees a half-made one
+    const std::string tmp = path + ".tmp";
+    const int fd = ::open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    const bool mapped = fd >= 0 && ftruncate(fd, static_cast<off_t>(bytes)) == 0 && map(fd, bytes);
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    path_ = path;
+    if (!mapped || !writeHeader(false, 0) || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to create cuckoo filter " << path << std::endl;
+        close();
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool CuckooFilter::open(const std::string& path, uint64_t stamp) {
+    close();
+    const int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    const bool mapped = fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= kHeaderPage + kMinBuckets * 8 &&
+                        (static_cast<size_t>(st.st_size) - kHeaderPage) % 8 == 0 &&
+                        map(fd, static_cast<size_t>(st.st_size));
+    ::close(fd);
+    if (!mapped) {
+        return false;
+    }
+
+    CuckooFilterHeader copy = *header();
+    copy.checksum = 0;
+    const bool valid = std::memcmp(copy.magic, kMagic, sizeof(kMagic)) == 0 &&
+                       copy.version == kFormatVersion && crc32c(&copy, sizeof(copy)) == header()->checksum &&
+                       copy.buckets == mask_ + 1 && (copy.buckets & mask_) == 0 && copy.count <= capacity();
+    if (!valid) {
+        std::cerr << "Ignoring corrupt cuckoo filter " << path << std::endl;
+        close();
+        return false;
+    }
+    if (!copy.clean || copy.stamp != stamp ||
+        crc32c(mapping_ + kHeaderPage, mappedBytes_ - kHeaderPage) != copy.dataChecksum) {
+        close();
+        return false;
+    }
+    path_ = path;
+    count_ = copy.count;
+    if (!writeHeader(false, stamp)) {
+        std::cerr << "Failed to reopen cuckoo filter " << path << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool CuckooFilter::writeHeader(bool clean, uint64_t stamp) {
+    CuckooFilterHeader& h = *header();
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version = kFormatVersion;
+    h.clean = clean ? 1 : 0;
+    h.buckets = mask_ + 1;
+    h.count = count_;
+    h.stamp = stamp;
+    h.dataChecksum = clean ? crc32c(mapping_ + kHeaderPage, mappedBytes_ - kHeaderPage) : 0;
+    h.checksum = 0;
+    h.checksum = crc32c(&h, sizeof(h));
+    return path_.empty() || msync(mapping_, kHeaderPage, MS_SYNC) == 0;
+}
+
+bool CuckooFilter::persist(uint64_t stamp) {
+    if (!isOpen() || path_.empty()) {
+        return isOpen();
+    }
+    // The buckets are durable before the header says so
+    if (msync(mapping_ + kHeaderPage, mappedBytes_ - kHeaderPage, MS_SYNC) != 0 || !writeHeader(true, stamp)) {
+        std::cerr << "Failed to persist cuckoo filter " << path_ << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void CuckooFilter::close() {
+    if (mapping_) {
+        munmap(mapping_, mappedBytes_);
+    }
+    mapping_ = nullptr;
+    mappedBytes_ = 0;
+    buckets_ = nullptr;
+    mask_ = 0;
+    count_ = 0;
+    path_.clear();
+}
+
+bool CuckooFilter::contains(uint64_t hash) const {
+    const uint16_t fingerprint = fingerprintOf(hash);
+    const uint64_t first = hash & mask_;
+    const uint64_t second = alternate(first, fingerprint, mask_);
+    while (true) {
+        const uint64_t version = version_.load(std::memory_order_acquire);
+        if (hasSlot(buckets_[first].load(std::memory_order_acquire), fingerprint) ||
+            hasSlot(buckets_[second].load(std::memory_order_acquire), fingerprint)) {
+            return true;
+        }
+        // A miss only counts if no insert moved fingerprints meanwhile
+        if ((version & 1) == 0 && version_.load(std::memory_order_acquire) == version) {
+            return false;
+        }
+        std::this_thread::yield();
+    }
+}
+
+bool CuckooFilter::place(uint64_t bucket, uint16_t fingerprint) {
+    const uint64_t word = buckets_[bucket].load(std::memory_order_relaxed);
+    for (size_t slot = 0; slot < kSlotsPerBucket; ++slot) {
+        if (slotOf(word, slot) == 0) {
+            buckets_[bucket].store(word | uint64_t(fingerprint) << (16 * slot), std::memory_order_release);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CuckooFilter::insert(uint64_t hash) {
+    if (!isOpen()) {
+        return false;
+    }
+    const uint16_t fingerprint = fingerprintOf(hash);
+    const uint64_t first = hash & mask_;
+    const uint64_t second = alternate(first, fingerprint, mask_);
+    if (place(first, fingerprint) || place(second, fingerprint) || relocate(first, second, fingerprint)) {
+        ++count_;
+        return true;
+    }
+    return false;
+}
+
+bool CuckooFilter::relocate(uint64_t first, uint64_t second, uint16_t fingerprint) {
+    // Breadth-first over buckets: node i was reached by moving slot `slot` of bucket `parent` into it
+    struct Node {
+        uint64_t bucket;
+        int32_t parent;
+        uint32_t slot;
+    };
+    Node nodes[kMaxSearch];
+    size_t count = 0;
+    nodes[count++] = {first, -1, 0};
+    nodes[count++] = {second, -1, 0};
+    for (size_t head = 0; head < count; ++head) {
+        const uint64_t word = buckets_[nodes[head].bucket].load(std::memory_order_relaxed);
+        for (uint32_t slot = 0; slot < kSlotsPerBucket; ++slot) {
+            const uint64_t other = alternate(nodes[head].bucket, slotOf(word, slot), mask_);
+            if (!hasSlot(buckets_[other].load(std::memory_order_relaxed), 0)) {
+                if (count < kMaxSearch) {
+                    nodes[count++] = {other, static_cast<int32_t>(head), slot};
+                }
+                continue;
+            }
+
+            // Move the chain from its free end back to the root, each fingerprint copied before it is cleared
+            version_.fetch_add(1, std::memory_order_acq_rel);
+            bool moved = true;
+            int32_t node = static_cast<int32_t>(head);
+            uint32_t from = slot;
+            uint64_t to = other;
+            while (moved && node >= 0) {
+                const uint64_t bucket = nodes[node].bucket;
+                const uint16_t moving = slotOf(buckets_[bucket].load(std::memory_order_relaxed), from);
+                moved = moving != 0 && alternate(bucket, moving, mask_) == to && place(to, moving);
+                if (moved) {
+                    const uint64_t current = buckets_[bucket].load(std::memory_order_relaxed);
+                    buckets_[bucket].store(current & ~(uint64_t(0xffff) << (16 * from)), std::memory_order_release);
+                    from = nodes[node].slot;
+                    to = bucket;
+                    node = nodes[node].parent;
+                }
+            }
+            // A chain that visits a bucket twice can stop early; every finished move is still valid
+            moved = moved && place(to, fingerprint);
+            version_.fetch_add(1, std::memory_order_release);
+            return moved;
+        }
+    }
+    return false;
+}
+
+bool CuckooFilter::erase(uint64_t hash) {
+    if (!isOpen()) {
+        return false;
+    }
+    const uint16_t fingerprint = fingerprintOf(hash);
+    const uint64_t first = hash & mask_;
+    const uint64_t second = alternate(first, fingerprint, mask_);
+    for (uint64_t bucket : {first, second}) {
+        const uint64_t word = buckets_[bucket].load(std::memory_order_relaxed);
+        for (size_t slot = 0; slot < kSlotsPerBucket; ++slot) {
+            if (slotOf(word, slot) == fingerprint) {
+                buckets_[bucket].store(word & ~(uint64_t(0xffff) << (16 * slot)), std::memory_order_release);
+                --count_;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+double CuckooFilter::expectedFalsePositiveRate() const {
+    // Each of the up to 8 occupied slots in the two buckets matches with probability 1/65535
+    return 1.0 - std::pow(1.0 - 1.0 / 65535.0, 2.0 * kSlotsPerBucket * load());
+}
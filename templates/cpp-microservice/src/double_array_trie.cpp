@@ -0,0 +1,139 @@
+#include "double_array_trie.h"
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+const int32_t kFree = -1;
+
+// Places sorted keys depth-first: a node's children are given slots before
+// any of them is expanded, so sibling slots never collide
+class Builder {
+public:
+    Builder(std::vector<int32_t>& base, std::vector<int32_t>& check, std::vector<int32_t>& value,
+            const std::vector<std::string>& keys, const std::vector<int32_t>& values,
+            const std::vector<size_t>& order)
+        : base_(base), check_(check), value_(value), keys_(keys), values_(values), order_(order), firstFree_(1) {
+    }
+
+    void place(int32_t node, size_t lo, size_t hi, size_t depth) {
+        if (lo < hi && keyAt(lo).size() == depth) {
+            value_[node] = values_[order_[lo]];
+            ++lo;
+        }
+        if (lo == hi) {
+            return;
+        }
+
+        // Children: distinct next bytes and the key range under each
+        std::vector<std::pair<uint8_t, size_t>> children;
+        for (size_t i = lo; i < hi; ++i) {
+            uint8_t byte = static_cast<uint8_t>(keyAt(i)[depth]);
+            if (children.empty() || children.back().first != byte) {
+                children.emplace_back(byte, i);
+            }
+        }
+
+        const int32_t base = findBase(children);
+        base_[node] = base;
+        for (const auto& child : children) {
+            check_[base + child.first + 1] = node;
+        }
+        for (size_t c = 0; c < children.size(); ++c) {
+            const size_t end = c + 1 < children.size() ? children[c + 1].second : hi;
+            place(base + children[c].first + 1, children[c].second, end, depth + 1);
+        }
+    }
+
+private:
+    std::vector<int32_t>& base_;
+    std::vector<int32_t>& check_;
+    std::vector<int32_t>& value_;
+    const std::vector<std::string>& keys_;
+    const std::vector<int32_t>& values_;
+    const std::vector<size_t>& order_;
+    size_t firstFree_;
+
+    const std::string& keyAt(size_t i) const { return keys_[order_[i]]; }
+
+    void reserve(size_t slots) {
+        if (slots > check_.size()) {
+            size_t size = std::max(slots, check_.size() * 2);
+            base_.resize(size, 0);
+            check_.resize(size, kFree);
+            value_.resize(size, -1);
+        }
+    }
+
+    // Lowest base whose child slots are all free, trying only bases that put
+    // the first child on a free slot
+    int32_t findBase(const std::vector<std::pair<uint8_t, size_t>>& children) {
+        while (firstFree_ < check_.size() && check_[firstFree_] != kFree) {
+            ++firstFree_;
+        }
+        const size_t firstCode = children.front().first + 1u;
+        for (size_t slot = std::max(firstFree_, firstCode);; ++slot) {
+            reserve(slot + 258);
+            if (check_[slot] != kFree) {
+                continue;
+            }
+            const size_t base = slot - firstCode;
+            bool fits = true;
+            for (const auto& child : children) {
+                if (check_[base + child.first + 1] != kFree) {
+                    fits = false;
+                    break;
+                }
+            }
+            if (fits) {
+                return static_cast<int32_t>(base);
+            }
+        }
+    }
+};
+
+} // namespace
+
+DoubleArrayTrie::DoubleArrayTrie() : base_(1, 0), check_(1, -2), value_(1, -1) {}
+
+void DoubleArrayTrie::build(const std::vector<std::string>& keys, const std::vector<int32_t>& values) {
+    // Stable sort keeps the first of duplicate keys in front, and the duplicates are then dropped
+    std::vector<size_t> order(keys.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return keys[a] < keys[b]; });
+    std::vector<size_t> unique;
+    unique.reserve(order.size());
+    for (size_t i : order) {
+        if (!keys[i].empty() && (unique.empty() || keys[unique.back()] != keys[i])) {
+            unique.push_back(i);
+        }
+    }
+
+    base_.assign(1024, 0);
+    check_.assign(1024, kFree);
+    value_.assign(1024, -1);
+    check_[kRoot] = -2;
+    Builder builder(base_, check_, value_, keys, values, unique);
+    builder.place(kRoot, 0, unique.size(), 0);
+
+    // Trim unused tail slots
+    size_t used = check_.size();
+    while (used > 1 && check_[used - 1] == kFree) {
+        --used;
+    }
+    base_.resize(used);
+    check_.resize(used);
+    value_.resize(used);
+    base_.shrink_to_fit();
+    check_.shrink_to_fit();
+    value_.shrink_to_fit();
+}
+
+int32_t DoubleArrayTrie::find(const char* key, size_t size, int32_t node) const {
+    for (size_t i = 0; i < size; ++i) {
+        if (!step(node, static_cast<uint8_t>(key[i]))) {
+            return -1;
+        }
+    }
+    return value_[node];
+}
@@ -0,0 +1,680 @@
+#include "durable_queue.h"
+#include "checksum.h"
+#include "file_util.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Record: u32 length, u32 CRC-32C of the rest, then u64 seq, u64 created, u64 not-before, u32 attempts, payload
+const size_t kRecordPrefix = 8;
+const size_t kRecordFields = 28;
+const size_t kReadChunk = 256u << 10;
+const char* const kOffsetFile = "consumer.offset";
+const char* const kDeadFile = "dead.log";
+
+std::string encodeRecord(const QueueMessage& message, uint64_t seq, uint64_t notBefore) {
+    std::string record;
+    record.reserve(kRecordPrefix + kRecordFields + message.payload.size());
+    appendRaw<uint32_t>(record, static_cast<uint32_t>(kRecordFields + message.payload.size()));
+    appendRaw<uint32_t>(record, 0);
+    appendRaw<uint64_t>(record, seq);
+    appendRaw<uint64_t>(record, message.createdAt);
+    appendRaw<uint64_t>(record, notBefore);
+    appendRaw<uint32_t>(record, message.attempts);
+    record += message.payload;
+    const uint32_t crc = crc32c(record.data() + kRecordPrefix, record.size() - kRecordPrefix);
+    std::memcpy(&record[4], &crc, sizeof(crc));
+    return record;
+}
+
+} // namespace
+
+DurableQueue::DurableQueue()
+    : activeFd_(-1), activeBase_(0), nextSeq_(1), syncedSeq_(1), syncing_(false), deadFd_(-1), offset_(1),
+      persistedOffset_(1), acksSinceOffset_(0), deliveryStop_(false) {}
+
+DurableQueue::~DurableQueue() {
+    close();
+}
+
+uint64_t DurableQueue::wallMillis() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                     std::chrono::system_clock::now().time_since_epoch())
+                                     .count());
+}
+
+std::string DurableQueue::segmentPath(uint64_t base) const {
+    char name[40];
+    std::snprintf(name, sizeof(name), "queue-%012llu.log", static_cast<unsigned long long>(base));
+    return options_.directory + "/" + name;
+}
+
+bool DurableQueue::open(const DurableQueueOptions& options) {
+    close();
+    std::unique_lock<std::mutex> lock(mutex_);
+    options_ = options;
+    counters_ = DurableQueueStats();
+    auto start = std::chrono::steady_clock::now();
+
+    std::error_code ec;
+    fs::create_directories(options_.directory, ec);
+    if (ec) {
+        std::cerr << "Failed to create queue directory " << options_.directory << ": " << ec.message() << std::endl;
+        return false;
+    }
+    std::vector<uint64_t> bases;
+    for (const fs::directory_entry& entry : fs::directory_iterator(options_.directory, ec)) {
+        const std::string name = entry.path().filename().string();
+        uint64_t base = 0;
+        if (parseGeneration(name, "queue-", ".log", base) && base > 0) {
+            bases.push_back(base);
+        } else if (name.size() > 4 && name.compare(name.size() - 4, 4, ".tmp") == 0) {
+            fs::remove(entry.path(), ec);
+        }
+    }
+    std::sort(bases.begin(), bases.end());
+
+    uint64_t offset = 1;
+    std::ifstream offsetIn(options_.directory + "/" + kOffsetFile);
+    if (offsetIn && !(offsetIn >> offset)) {
+        std::cerr << "Ignoring unreadable " << kOffsetFile << " in " << options_.directory << std::endl;
+        offset = 1;
+    }
+
+    // Segments wholly below the offset were done before the last run stopped
+    size_t first = 0;
+    while (first + 1 < bases.size() && bases[first + 1] <= offset) {
+        fs::remove(segmentPath(bases[first]), ec);
+        ++first;
+    }
+    segments_.clear();
+    for (size_t i = first; i + 1 < bases.size(); ++i) {
+        segments_[bases[i]] = fs::file_size(segmentPath(bases[i]), ec);
+    }
+    nextSeq_ = std::max<uint64_t>(offset, 1);
+    if (first < bases.size() && !recoverSegment(bases.back(), nextSeq_)) {
+        return false;
+    }
+    const uint64_t base = segments_.empty() ? nextSeq_ : segments_.rbegin()->first;
+    if (!openActive(base)) {
+        return false;
+    }
+    syncedSeq_ = nextSeq_;
+    deadFd_ = ::open((options_.directory + "/" + kDeadFile).c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (deadFd_ < 0) {
+        std::cerr << "Failed to open " << kDeadFile << " in " << options_.directory << std::endl;
+        ::close(activeFd_);
+        activeFd_ = -1;
+        return false;
+    }
+
+    // The cursor starts at the offset, skipping the done records before it in its segment
+    offset_ = std::min(std::max(offset, segments_.begin()->first), nextSeq_);
+    persistedOffset_ = offset_;
+    cursor_ = Cursor();
+    cursor_.base = std::prev(segments_.upper_bound(offset_))->first;
+    cursor_.seq = cursor_.base;
+    QueueMessage skipped;
+    uint64_t notBefore = 0;
+    while (cursor_.seq < offset_ && readRecord(cursor_, skipped, notBefore)) {
+    }
+    if (cursor_.seq != offset_) {
+        std::cerr << "Failed to find the consumer offset " << offset_ << " in " << options_.directory << std::endl;
+        lock.unlock();
+        close();
+        return false;
+    }
+    window_.clear();
+    held_.clear();
+    located_.clear();
+    due_.clear();
+    wheel_ = TimerWheel();
+    acksSinceOffset_ = 0;
+    counters_.backlog = nextSeq_ - offset_;
+    counters_.openMillis = millisSince(start);
+    std::cout << "Durable queue opened in " << counters_.openMillis << " ms: " << counters_.backlog
+              << " messages in " << segments_.size() << " segments" << std::endl;
+    return true;
+}
+
+// Find the end of the last segment: records must check out and number on from its base
+bool DurableQueue::recoverSegment(uint64_t base, uint64_t& nextSeq) {
+    const std::string path = segmentPath(base);
+    std::ifstream in(path, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    size_t pos = 0;
+    uint64_t seq = base;
+    while (data.size() - pos >= kRecordPrefix + kRecordFields) {
+        const uint32_t length = readRaw<uint32_t>(data.data() + pos);
+        if (length < kRecordFields || data.size() - pos - kRecordPrefix < length ||
+            crc32c(data.data() + pos + kRecordPrefix, length) != readRaw<uint32_t>(data.data() + pos + 4) ||
+            readRaw<uint64_t>(data.data() + pos + kRecordPrefix) != seq) {
+            break;
+        }
+        pos += kRecordPrefix + length;
+        ++seq;
+    }
+    if (pos < data.size()) {
+        std::cerr << "Truncating " << data.size() - pos << " bytes of torn records from " << path << std::endl;
+        if (::truncate(path.c_str(), static_cast<off_t>(pos)) != 0) {
+            std::cerr << "Failed to truncate " << path << std::endl;
+            return false;
+        }
+    }
+    segments_[base] = pos;
+    nextSeq = seq;
+    return true;
+}
+
+bool DurableQueue::openActive(uint64_t base) {
+    const int fd = ::open(segmentPath(base).c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to open queue segment " << segmentPath(base) << std::endl;
+        return false;
+    }
+    if (activeFd_ >= 0) {
+        ::close(activeFd_);
+    }
+    activeFd_ = fd;
+    activeBase_ = base;
+    if (segments_.emplace(base, 0).second) {
+        syncDirectory(options_.directory);
+    }
+    return true;
+}
+
+void DurableQueue::close() {
+    stopDelivery();
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (activeFd_ < 0) {
+        return;
+    }
+    if (syncedSeq_ < nextSeq_) {
+        syncLocked(nextSeq_ - 1, lock);
+    }
+    persistOffset(lock);
+    ::close(activeFd_);
+    activeFd_ = -1;
+    if (deadFd_ >= 0) {
+        ::close(deadFd_);
+        deadFd_ = -1;
+    }
+    closeCursor(cursor_);
+    segments_.clear();
+    window_.clear();
+    held_.clear();
+    located_.clear();
+    due_.clear();
+}
+
+uint64_t DurableQueue::appendLocked(const QueueMessage& message, uint64_t notBefore,
+                                    std::unique_lock<std::mutex>& lock) {
+    const size_t recordBytes = kRecordPrefix + kRecordFields + message.payload.size();
+    while (segments_[activeBase_] > 0 && segments_[activeBase_] + recordBytes > options_.segmentBytes) {
+        // Seal the active segment: synced and closed before the next one takes appends.
+        // Others may append or roll while this waits out a group sync, so check again after it.
+        if (syncing_) {
+            syncCv_.wait(lock);
+            continue;
+        }
+        if (fdatasync(activeFd_) != 0 || !openActive(nextSeq_)) {
+            std::cerr << "Failed to roll queue segment " << segmentPath(activeBase_) << std::endl;
+            return 0;
+        }
+        ++counters_.syncs;
+        syncedSeq_ = nextSeq_;
+    }
+    // Encoded only now: the sequence number is the one this record gets in the log
+    const std::string record = encodeRecord(message, nextSeq_, notBefore);
+    uint64_t& bytes = segments_[activeBase_];
+    if (!writeAll(activeFd_, record.data(), record.size(), -1)) {
+        // A partial record would stop recovery at it, dropping every record after
+        std::cerr << "Queue append failed: " << std::strerror(errno) << std::endl;
+        if (::ftruncate(activeFd_, static_cast<off_t>(bytes)) != 0) {
+            std::cerr << "Failed to roll back " << segmentPath(activeBase_) << std::endl;
+        }
+        return 0;
+    }
+    bytes += record.size();
+    ++counters_.appended;
+    ++counters_.backlog;
+    deliveryCv_.notify_one();
+    return nextSeq_++;
+}
+
+// Group commit: one appender syncs everything written so far while the others wait for it
+bool DurableQueue::syncLocked(uint64_t seq, std::unique_lock<std::mutex>& lock) {
+    while (syncedSeq_ <= seq) {
+        if (syncing_) {
+            syncCv_.wait(lock);
+            continue;
+        }
+        syncing_ = true;
+        const uint64_t target = nextSeq_;
+        const int fd = activeFd_;
+        lock.unlock();
+        const bool synced = fdatasync(fd) == 0;
+        lock.lock();
+        syncing_ = false;
+        ++counters_.syncs;
+        if (synced) {
+            syncedSeq_ = std::max(syncedSeq_, target);
+        }
+        syncCv_.notify_all();
+        if (!synced) {
+            std::cerr << "Queue fdatasync failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t DurableQueue::append(const std::string& payload) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (activeFd_ < 0) {
+        return 0;
+    }
+    QueueMessage message;
+    message.createdAt = wallMillis();
+    message.payload = payload;
+    const uint64_t seq = appendLocked(message, 0, lock);
+    if (seq == 0 || (options_.syncWrites && !syncLocked(seq, lock))) {
+        return 0;
+    }
+    return seq;
+}
+
+bool DurableQueue::fill(Cursor& cursor, size_t bytes, uint64_t limit) {
+    if (cursor.offset >= cursor.bufferOffset && cursor.offset + bytes <= cursor.bufferOffset + cursor.buffer.size()) {
+        return true;
+    }
+    const size_t size = static_cast<size_t>(std::min<uint64_t>(std::max(bytes, kReadChunk), limit - cursor.offset));
+    cursor.buffer.resize(size);
+    cursor.bufferOffset = cursor.offset;
+    size_t done = 0;
+    while (done < size) {
+        const ssize_t n = pread(cursor.fd, &cursor.buffer[done], size - done, static_cast<off_t>(cursor.offset + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+    cursor.buffer.resize(done);
+    return done >= bytes;
+}
+
+void DurableQueue::closeCursor(Cursor& cursor) {
+    if (cursor.fd >= 0) {
+        ::close(cursor.fd);
+    }
+    cursor.fd = -1;
+    cursor.buffer.clear();
+    cursor.bufferOffset = 0;
+}
+
+bool DurableQueue::readRecord(Cursor& cursor, QueueMessage& message, uint64_t& notBefore) {
+    if (cursor.seq >= nextSeq_) {
+        return false;
+    }
+    auto segment = segments_.find(cursor.base);
+    if (segment == segments_.end() || cursor.offset >= segment->second) {
+        // The next segment is named after the first record it holds
+        segment = segments_.find(cursor.seq);
+        if (segment == segments_.end()) {
+            std::cerr << "Queue segment for message " << cursor.seq << " is missing" << std::endl;
+            return false;
+        }
+        closeCursor(cursor);
+        cursor.base = cursor.seq;
+        cursor.offset = 0;
+    }
+    if (cursor.fd < 0) {
+        cursor.fd = ::open(segmentPath(cursor.base).c_str(), O_RDONLY | O_CLOEXEC);
+        if (cursor.fd < 0) {
+            std::cerr << "Failed to open queue segment " << segmentPath(cursor.base) << std::endl;
+            return false;
+        }
+    }
+
+    const uint64_t limit = segment->second;
+    if (!fill(cursor, kRecordPrefix + kRecordFields, limit)) {
+        std::cerr << "Short read in " << segmentPath(cursor.base) << std::endl;
+        return false;
+    }
+    const uint32_t length = readRaw<uint32_t>(cursor.buffer.data() + (cursor.offset - cursor.bufferOffset));
+    if (length < kRecordFields || cursor.offset + kRecordPrefix + length > limit ||
+        !fill(cursor, kRecordPrefix + length, limit)) {
+        std::cerr << "Corrupt record at " << cursor.offset << " in " << segmentPath(cursor.base) << std::endl;
+        return false;
+    }
+    const char* p = cursor.buffer.data() + (cursor.offset - cursor.bufferOffset);
+    if (crc32c(p + kRecordPrefix, length) != readRaw<uint32_t>(p + 4) ||
+        readRaw<uint64_t>(p + kRecordPrefix) != cursor.seq) {
+        std::cerr << "Corrupt record at " << cursor.offset << " in " << segmentPath(cursor.base) << std::endl;
+        return false;
+    }
+    message.seq = cursor.seq;
+    message.createdAt = readRaw<uint64_t>(p + kRecordPrefix + 8);
+    notBefore = readRaw<uint64_t>(p + kRecordPrefix + 16);
+    message.attempts = readRaw<uint32_t>(p + kRecordPrefix + 24);
+    message.payload.assign(p + kRecordPrefix + kRecordFields, length - kRecordFields);
+    cursor.offset += kRecordPrefix + length;
+    ++cursor.seq;
+    return true;
+}
+
+// Copy of an Inflight or Waiting message, from memory or, if it was not held, from its record
+bool DurableQueue::copyMessage(uint64_t seq, QueueMessage& message) {
+    auto location = located_.find(seq);
+    if (location == located_.end()) {
+        message = held_[seq];
+        return true;
+    }
+    Cursor cursor;
+    cursor.base = location->second.base;
+    cursor.offset = location->second.offset;
+    cursor.seq = seq;
+    uint64_t notBefore = 0;
+    const bool read = readRecord(cursor, message, notBefore);
+    closeCursor(cursor);
+    return read;
+}
+
+// Move retries whose backoff ran out to the due list
+void DurableQueue::advance(uint64_t nowMillis) {
+    fired_.clear();
+    wheel_.advance(nowMillis, fired_);
+    for (const TimerWheel::Timer& timer : fired_) {
+        if (timer.payload >= offset_ && window_[timer.payload - offset_] == State::Waiting) {
+            due_.push_back(timer.payload);
+        }
+    }
+}
+
+size_t DurableQueue::poll(size_t max, uint64_t nowMillis, std::vector<QueueMessage>& out) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (activeFd_ < 0) {
+        return 0;
+    }
+    advance(nowMillis);
+    size_t count = 0;
+    while (count < max) {
+        if (!due_.empty()) {
+            const uint64_t seq = due_.front();
+            due_.pop_front();
+            if (seq < offset_) {
+                continue;
+            }
+            State& state = window_[seq - offset_];
+            if (state != State::Waiting) {
+                continue;
+            }
+            if (located_.count(seq)) {
+                QueueMessage message;
+                if (!copyMessage(seq, message)) {
+                    due_.push_front(seq);
+                    break;
+                }
+                located_.erase(seq);
+                held_.emplace(seq, std::move(message));
+            }
+            state = State::Inflight;
+            --counters_.waiting;
+            ++counters_.inflight;
+            ++counters_.delivered;
+            out.push_back(held_[seq]);
+            ++count;
+            continue;
+        }
+        QueueMessage message;
+        uint64_t notBefore = 0;
+        if (!readRecord(cursor_, message, notBefore)) {
+            break;
+        }
+        const uint64_t seq = message.seq;
+        if (notBefore > nowMillis) {
+            window_.push_back(State::Waiting);
+            ++counters_.waiting;
+            wheel_.schedule(notBefore, seq);
+            // Past the cap only the record's place is kept, so the cursor never stops behind retries
+            if (counters_.waiting - located_.size() > options_.maxHeldRetries) {
+                const uint64_t size = kRecordPrefix + kRecordFields + message.payload.size();
+                located_.emplace(seq, Location{cursor_.base, cursor_.offset - size});
+            } else {
+                held_.emplace(seq, std::move(message));
+            }
+            continue;
+        }
+        window_.push_back(State::Inflight);
+        ++counters_.inflight;
+        ++counters_.delivered;
+        out.push_back(message);
+        held_.emplace(seq, std::move(message));
+        ++count;
+    }
+    return count;
+}
+
+void DurableQueue::markDone(uint64_t seq, std::unique_lock<std::mutex>& lock) {
+    held_.erase(seq);
+    window_[seq - offset_] = State::Done;
+    --counters_.inflight;
+    --counters_.backlog;
+    while (!window_.empty() && window_.front() == State::Done) {
+        window_.pop_front();
+        ++offset_;
+    }
+    if (++acksSinceOffset_ >= options_.offsetInterval) {
+        persistOffset(lock);
+    }
+}
+
+bool DurableQueue::ack(uint64_t seq) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (seq < offset_ || seq >= cursor_.seq || window_[seq - offset_] != State::Inflight) {
+        return false;
+    }
+    ++counters_.acked;
+    markDone(seq, lock);
+    return true;
+}
+
+bool DurableQueue::nack(uint64_t seq, uint64_t nowMillis) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (seq < offset_ || seq >= cursor_.seq || window_[seq - offset_] != State::Inflight) {
+        return false;
+    }
+    QueueMessage& held = held_[seq];
+    ++held.attempts;
+    const uint32_t doublings = held.attempts - 1;
+    const uint64_t backoff = doublings >= 32 || (options_.backoffMillis << doublings) > options_.maxBackoffMillis
+                                 ? options_.maxBackoffMillis
+                                 : options_.backoffMillis << doublings;
+    bool written;
+    if (held.attempts >= options_.maxAttempts) {
+        const std::string record = encodeRecord(held, seq, 0);
+        written = writeAll(deadFd_, record.data(), record.size(), -1) && fdatasync(deadFd_) == 0;
+        if (written) {
+            std::cerr << "Queue message " << seq << " failed " << held.attempts << " times; moved to " << kDeadFile
+                      << std::endl;
+            ++counters_.deadLetters;
+        } else {
+            std::cerr << "Failed to dead-letter queue message " << seq << std::endl;
+        }
+    } else {
+        written = appendLocked(held, nowMillis + backoff, lock) != 0;
+        if (written) {
+            ++counters_.retried;
+        }
+    }
+    if (!written) {
+        // Nothing new reached the log: wait out the backoff in memory, then deliver the message again,
+        // so it neither stays in flight for good nor pins the offset (its record is still in the log)
+        window_[seq - offset_] = State::Waiting;
+        --counters_.inflight;
+        ++counters_.waiting;
+        wheel_.schedule(nowMillis + backoff, seq);
+        deliveryCv_.notify_one();
+        return false;
+    }
+    markDone(seq, lock);
+    return true;
+}
+
+size_t DurableQueue::retryNow() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = 0;
+    for (size_t i = 0; i < window_.size(); ++i) {
+        if (window_[i] == State::Waiting) {
+            due_.push_back(offset_ + i);
+            ++count;
+        }
+    }
+    deliveryCv_.notify_one();
+    return count;
+}
+
+int64_t DurableQueue::waitLocked(uint64_t nowMillis) {
+    advance(nowMillis);
+    if (!due_.empty() || cursor_.seq < nextSeq_) {
+        return 0;
+    }
+    // May wake early, at a wheel redistribution
+    return counters_.waiting > 0 ? static_cast<int64_t>(wheel_.nextWait()) : -1;
+}
+
+int64_t DurableQueue::waitMillis(uint64_t nowMillis) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return activeFd_ >= 0 ? waitLocked(nowMillis) : -1;
+}
+
+void DurableQueue::pending(size_t limit, std::vector<QueueMessage>& out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (activeFd_ < 0) {
+        return;
+    }
+    QueueMessage message;
+    for (size_t i = 0; i < window_.size() && out.size() < limit; ++i) {
+        if (window_[i] != State::Done && copyMessage(offset_ + i, message)) {
+            out.push_back(message);
+        }
+    }
+    // Unread messages come from a copy of the cursor, which leaves the consumer's where it was
+    Cursor cursor;
+    cursor.base = cursor_.base;
+    cursor.offset = cursor_.offset;
+    cursor.seq = cursor_.seq;
+    uint64_t notBefore = 0;
+    while (out.size() < limit && readRecord(cursor, message, notBefore)) {
+        out.push_back(message);
+    }
+    closeCursor(cursor);
+}
+
+// Persist the offset once every record appended before it (retries included) is on disk
+bool DurableQueue::persistOffset(std::unique_lock<std::mutex>& lock) {
+    acksSinceOffset_ = 0;
+    const uint64_t offset = offset_;
+    if (offset == persistedOffset_) {
+        return true;
+    }
+    if (syncedSeq_ < nextSeq_ && !syncLocked(nextSeq_ - 1, lock)) {
+        return false;
+    }
+    if (!writeFileAtomic(options_.directory + "/" + kOffsetFile, std::to_string(offset) + "\n")) {
+        std::cerr << "Failed to persist the consumer offset of " << options_.directory << std::endl;
+        return false;
+    }
+    persistedOffset_ = std::max(persistedOffset_, offset);
+
+    // Segments whose every record is below the offset are done with
+    while (segments_.size() > 1) {
+        auto first = segments_.begin();
+        auto second = std::next(first);
+        if (second->first > persistedOffset_ || first->first == activeBase_ || first->first == cursor_.base) {
+            break;
+        }
+        std::error_code ec;
+        fs::remove(segmentPath(first->first), ec);
+        segments_.erase(first);
+    }
+    return true;
+}
+
+bool DurableQueue::sync() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (activeFd_ < 0) {
+        return false;
+    }
+    return (syncedSeq_ >= nextSeq_ || syncLocked(nextSeq_ - 1, lock)) && persistOffset(lock);
+}
+
+void DurableQueue::startDelivery(const Sender& sender, size_t batch) {
+    stopDelivery();
+    std::lock_guard<std::mutex> lock(mutex_);
+    deliveryStop_ = false;
+    deliveryThread_ = std::thread(&DurableQueue::deliveryLoop, this, sender, std::max<size_t>(batch, 1));
+}
+
+void DurableQueue::stopDelivery() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        deliveryStop_ = true;
+        deliveryCv_.notify_all();
+    }
+    if (deliveryThread_.joinable()) {
+        deliveryThread_.join();
+    }
+}
+
+void DurableQueue::deliveryLoop(Sender sender, size_t batch) {
+    std::vector<QueueMessage> messages;
+    while (true) {
+        messages.clear();
+        poll(batch, wallMillis(), messages);
+        for (const QueueMessage& message : messages) {
+            if (sender(message)) {
+                ack(message.seq);
+            } else if (!nack(message.seq, wallMillis())) {
+                std::cerr << "Failed to requeue message " << message.seq << "; it will be delivered again" << std::endl;
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (deliveryStop_) {
+            return;
+        }
+        const int64_t wait = activeFd_ >= 0 ? waitLocked(wallMillis()) : -1;
+        if (wait < 0) {
+            deliveryCv_.wait(lock);
+        } else if (wait > 0) {
+            deliveryCv_.wait_for(lock, std::chrono::milliseconds(wait));
+        }
+    }
+}
+
+DurableQueueStats DurableQueue::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    DurableQueueStats s = counters_;
+    s.segments = segments_.size();
+    for (const auto& segment : segments_) {
+        s.segmentBytes += segment.second;
+    }
+    s.consumerOffset = persistedOffset_;
+    return s;
+}
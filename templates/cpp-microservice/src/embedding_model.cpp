@@ -0,0 +1,412 @@
+#include "embedding_model.h"
+#include "file_util.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const char kMagic[8] = {'D', 'S', 'E', 'M', 'B', 'E', 'D', '1'};
+const uint32_t kVersion = 1;
+const size_t kHeaderSize = 64;
+// Token rows per parallel chunk for row-wise passes (LayerNorm, GELU)
+const size_t kRowGrain = 64;
+
+void forRows(size_t rows, ThreadPool* pool, const std::function<void(size_t, size_t)>& fn) {
+    if (pool) {
+        pool->parallelFor(rows, kRowGrain, [&](size_t, size_t begin, size_t end) { fn(begin, end); });
+    } else {
+        fn(0, rows);
+    }
+}
+
+// x = LayerNorm(x + residual), row by row
+void addLayerNorm(float* x, const float* residual, size_t rows, size_t width, const float* gamma,
+                  const float* beta, float eps, ThreadPool* pool) {
+    forRows(rows, pool, [&](size_t begin, size_t end) {
+        for (size_t row = begin; row < end; ++row) {
+            float* v = x + row * width;
+            if (residual) {
+                const float* r = residual + row * width;
+                for (size_t i = 0; i < width; ++i) {
+                    v[i] += r[i];
+                }
+            }
+            float mean = 0.0f;
+            for (size_t i = 0; i < width; ++i) {
+                mean += v[i];
+            }
+            mean /= static_cast<float>(width);
+            float variance = 0.0f;
+            for (size_t i = 0; i < width; ++i) {
+                variance += (v[i] - mean) * (v[i] - mean);
+            }
+            const float inverse = 1.0f / std::sqrt(variance / static_cast<float>(width) + eps);
+            for (size_t i = 0; i < width; ++i) {
+                v[i] = (v[i] - mean) * inverse * gamma[i] + beta[i];
+            }
+        }
+    });
+}
+
+typedef void (*RowKernel)(float* x, size_t n);
+
+// Exact (erf) GELU, as BERT uses
+void scalarGelu(float* x, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        x[i] = 0.5f * x[i] * (1.0f + std::erf(x[i] * 0.70710678f));
+    }
+}
+
+// x = softmax(x)
+void scalarSoftmax(float* x, size_t n) {
+    const float maxValue = *std::max_element(x, x + n);
+    float sum = 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        x[i] = std::exp(x[i] - maxValue);
+        sum += x[i];
+    }
+    const float inverse = 1.0f / sum;
+    for (size_t i = 0; i < n; ++i) {
+        x[i] *= inverse;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// Cephes expf: 2^n times a degree-6 polynomial on the reduced argument (about 1 ulp)
+__attribute__((target("avx2,fma"))) inline __m256 avx2Exp(__m256 x) {
+    x = _mm256_min_ps(_mm256_max_ps(x, _mm256_set1_ps(-87.3f)), _mm256_set1_ps(88.3f));
+    __m256 n = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.44269504f)),
+                               _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    x = _mm256_fnmadd_ps(n, _mm256_set1_ps(0.693359375f), x);
+    x = _mm256_fnmadd_ps(n, _mm256_set1_ps(-2.12194440e-4f), x);
+    __m256 y = _mm256_set1_ps(1.9875691500e-4f);
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.3981999507e-3f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(8.3334519073e-3f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(4.1665795894e-2f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(1.6666665459e-1f));
+    y = _mm256_fmadd_ps(y, x, _mm256_set1_ps(5.0000001201e-1f));
+    y = _mm256_fmadd_ps(y, _mm256_mul_ps(x, x), _mm256_add_ps(x, _mm256_set1_ps(1.0f)));
+    __m256i exponent = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(y, _mm256_castsi256_ps(exponent));
+}
+
+// Abramowitz-Stegun 7.1.26 erf (absolute error below 1.5e-7) inside GELU
+__attribute__((target("avx2,fma"))) void avx2Gelu(float* x, size_t n) {
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps(x + i);
+        __m256 z = _mm256_mul_ps(v, _mm256_set1_ps(0.70710678f));
+        __m256 sign = _mm256_and_ps(z, signMask);
+        __m256 a = _mm256_andnot_ps(signMask, z);
+        __m256 t = _mm256_div_ps(one, _mm256_fmadd_ps(a, _mm256_set1_ps(0.3275911f), one));
+        __m256 poly = _mm256_set1_ps(1.061405429f);
+        poly = _mm256_fmadd_ps(poly, t, _mm256_set1_ps(-1.453152027f));
+        poly = _mm256_fmadd_ps(poly, t, _mm256_set1_ps(1.421413741f));
+        poly = _mm256_fmadd_ps(poly, t, _mm256_set1_ps(-0.284496736f));
+        poly = _mm256_fmadd_ps(poly, t, _mm256_set1_ps(0.254829592f));
+        poly = _mm256_mul_ps(poly, t);
+        __m256 erf = _mm256_fnmadd_ps(poly, avx2Exp(_mm256_xor_ps(_mm256_mul_ps(a, a), signMask)), one);
+        erf = _mm256_or_ps(erf, sign);
+        _mm256_storeu_ps(x + i, _mm256_mul_ps(_mm256_mul_ps(half, v), _mm256_add_ps(one, erf)));
+    }
+    scalarGelu(x + i, n - i);
+}
+
+__attribute__((target("avx2,fma"))) void avx2Softmax(float* x, size_t n) {
+    const float maxValue = *std::max_element(x, x + n);
+    const __m256 shift = _mm256_set1_ps(maxValue);
+    __m256 sums = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 e = avx2Exp(_mm256_sub_ps(_mm256_loadu_ps(x + i), shift));
+        _mm256_storeu_ps(x + i, e);
+        sums = _mm256_add_ps(sums, e);
+    }
+    float lanes[8];
+    _mm256_storeu_ps(lanes, sums);
+    float sum = lanes[0] + lanes[1] + lanes[2] + lanes[3] + lanes[4] + lanes[5] + lanes[6] + lanes[7];
+    for (; i < n; ++i) {
+        x[i] = std::exp(x[i] - maxValue);
+        sum += x[i];
+    }
+    const float inverse = 1.0f / sum;
+    for (i = 0; i < n; ++i) {
+        x[i] *= inverse;
+    }
+}
+
+bool hasAvx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+const bool kAvx2 = hasAvx2();
+const RowKernel kGelu = kAvx2 ? avx2Gelu : scalarGelu;
+const RowKernel kSoftmax = kAvx2 ? avx2Softmax : scalarSoftmax;
+
+#else
+
+const RowKernel kGelu = scalarGelu;
+const RowKernel kSoftmax = scalarSoftmax;
+
+#endif
+
+void gelu(float* x, size_t rows, size_t width, ThreadPool* pool) {
+    forRows(rows, pool, [&](size_t begin, size_t end) { kGelu(x + begin * width, (end - begin) * width); });
+}
+
+} // namespace
+
+EmbeddingModel::EmbeddingModel()
+    : quantized_(false), wordEmbeddings_(nullptr), positionEmbeddings_(nullptr), typeEmbeddings_(nullptr),
+      embeddingNormGamma_(nullptr), embeddingNormBeta_(nullptr) {}
+
+size_t EmbeddingModel::parameterCount(const EmbeddingModelConfig& c) {
+    const size_t h = c.hidden;
+    const size_t i = c.intermediate;
+    const size_t perLayer = 3 * (h * h + h) + (h * h + h) + 2 * h + (i * h + i) + (h * i + h) + 2 * h;
+    return (static_cast<size_t>(c.vocabSize) + c.maxPositions + c.typeVocabSize) * h + 2 * h + c.layers * perLayer;
+}
+
+bool EmbeddingModel::write(const std::string& path, const EmbeddingModelConfig& config, const float* parameters) {
+    std::string contents(kHeaderSize, '\0');
+    std::memcpy(&contents[0], kMagic, sizeof(kMagic));
+    const uint32_t fields[8] = {kVersion,           config.vocabSize, config.hidden,       config.layers,
+                                config.heads,       config.intermediate, config.maxPositions, config.typeVocabSize};
+    std::memcpy(&contents[8], fields, sizeof(fields));
+    std::memcpy(&contents[8 + sizeof(fields)], &config.layerNormEps, sizeof(float));
+    contents.append(reinterpret_cast<const char*>(parameters), parameterCount(config) * sizeof(float));
+    return writeFileAtomic(path, contents);
+}
+
+void EmbeddingModel::prepareLinear(Linear& linear, const float* weights, size_t rows, size_t cols) {
+    if (quantized_) {
+        linear.int8.quantize(weights, rows, cols);
+    } else {
+        linear.fp32.pack(weights, rows, cols);
+    }
+}
+
+bool EmbeddingModel::load(const std::string& path, bool quantize) {
+    layers_.clear();
+    if (!file_.open(path)) {
+        std::cerr << "Failed to map embedding model " << path << std::endl;
+        return false;
+    }
+    const uint8_t* data = file_.data();
+    if (file_.size() < kHeaderSize || std::memcmp(data, kMagic, sizeof(kMagic)) != 0 ||
+        readRaw<uint32_t>(data + 8) != kVersion) {
+        std::cerr << "Not an embedding model file: " << path << std::endl;
+        file_.close();
+        return false;
+    }
+
+    EmbeddingModelConfig c;
+    c.vocabSize = readRaw<uint32_t>(data + 12);
+    c.hidden = readRaw<uint32_t>(data + 16);
+    c.layers = readRaw<uint32_t>(data + 20);
+    c.heads = readRaw<uint32_t>(data + 24);
+    c.intermediate = readRaw<uint32_t>(data + 28);
+    c.maxPositions = readRaw<uint32_t>(data + 32);
+    c.typeVocabSize = readRaw<uint32_t>(data + 36);
+    c.layerNormEps = readRaw<float>(data + 40);
+    if (c.vocabSize == 0 || c.hidden == 0 || c.heads == 0 || c.hidden % c.heads != 0 || c.intermediate == 0 ||
+        c.maxPositions == 0 || c.typeVocabSize == 0 ||
+        file_.size() != kHeaderSize + parameterCount(c) * sizeof(float)) {
+        std::cerr << "Embedding model " << path << " has an inconsistent shape or size" << std::endl;
+        file_.close();
+        return false;
+    }
+    config_ = c;
+    quantized_ = quantize;
+
+    const size_t h = c.hidden;
+    const size_t inter = c.intermediate;
+    const float* p = reinterpret_cast<const float*>(data + kHeaderSize);
+    auto take = [&p](size_t count) {
+        const float* tensor = p;
+        p += count;
+        return tensor;
+    };
+
+    wordEmbeddings_ = take(static_cast<size_t>(c.vocabSize) * h);
+    positionEmbeddings_ = take(static_cast<size_t>(c.maxPositions) * h);
+    typeEmbeddings_ = take(static_cast<size_t>(c.typeVocabSize) * h);
+    embeddingNormGamma_ = take(h);
+    embeddingNormBeta_ = take(h);
+
+    layers_.resize(c.layers);
+    std::vector<float> fused(3 * h * h);
+    for (Layer& layer : layers_) {
+        // Q, K and V become one [3h x h] GEMM
+        layer.qkv.fusedBias.resize(3 * h);
+        for (size_t part = 0; part < 3; ++part) {
+            std::memcpy(fused.data() + part * h * h, take(h * h), h * h * sizeof(float));
+            std::memcpy(layer.qkv.fusedBias.data() + part * h, take(h), h * sizeof(float));
+        }
+        prepareLinear(layer.qkv, fused.data(), 3 * h, h);
+        layer.qkv.bias = layer.qkv.fusedBias.data();
+
+        prepareLinear(layer.attentionOutput, take(h * h), h, h);
+        layer.attentionOutput.bias = take(h);
+        layer.attentionNormGamma = take(h);
+        layer.attentionNormBeta = take(h);
+        prepareLinear(layer.intermediate, take(inter * h), inter, h);
+        layer.intermediate.bias = take(inter);
+        prepareLinear(layer.output, take(h * inter), h, inter);
+        layer.output.bias = take(h);
+        layer.outputNormGamma = take(h);
+        layer.outputNormBeta = take(h);
+    }
+    return true;
+}
+
+void EmbeddingModel::applyLinear(const Linear& linear, const float* in, size_t m, float* out,
+                                 ThreadPool* pool) const {
+    if (quantized_) {
+        gemmInt8(in, m, linear.int8, linear.bias, out, pool);
+    } else {
+        gemm(in, m, linear.fp32, linear.bias, out, pool);
+    }
+}
+
+void EmbeddingModel::attention(const float* qkv, const std::vector<size_t>& offsets, float* context,
+                               ThreadPool* pool) const {
+    const size_t h = config_.hidden;
+    const size_t heads = config_.heads;
+    const size_t d = h / heads;
+    const size_t stride = 3 * h;
+    const float scale = 1.0f / std::sqrt(static_cast<float>(d));
+    const size_t sequences = offsets.size() - 1;
+
+    // Each (sequence, head) is two small GEMMs through the packed kernel:
+    // scores = (Q / sqrt(d)) K^T, then context = softmax(scores) V
+    auto run = [&](size_t, size_t begin, size_t end) {
+        std::vector<float> queries, keys, valuesT, scores, headContext;
+        PackedMatrix packedKeys, packedValues;
+        for (size_t task = begin; task < end; ++task) {
+            const size_t s = task / heads;
+            const size_t head = task % heads;
+            const size_t first = offsets[s];
+            const size_t length = offsets[s + 1] - first;
+            queries.resize(length * d);
+            keys.resize(length * d);
+            valuesT.resize(d * length);
+            for (size_t i = 0; i < length; ++i) {
+                const float* row = qkv + (first + i) * stride + head * d;
+                for (size_t t = 0; t < d; ++t) {
+                    queries[i * d + t] = row[t] * scale;
+                    keys[i * d + t] = row[h + t];
+                    valuesT[t * length + i] = row[2 * h + t];
+                }
+            }
+            packedKeys.pack(keys.data(), length, d);
+            packedValues.pack(valuesT.data(), d, length);
+
+            scores.resize(length * length);
+            gemm(queries.data(), length, packedKeys, nullptr, scores.data());
+            for (size_t i = 0; i < length; ++i) {
+                kSoftmax(scores.data() + i * length, length);
+            }
+            headContext.resize(length * d);
+            gemm(scores.data(), length, packedValues, nullptr, headContext.data());
+            for (size_t i = 0; i < length; ++i) {
+                std::memcpy(context + (first + i) * h + head * d, headContext.data() + i * d, d * sizeof(float));
+            }
+        }
+    };
+    if (pool) {
+        pool->parallelFor(sequences * heads, 1, run);
+    } else {
+        run(0, 0, sequences * heads);
+    }
+}
+
+bool EmbeddingModel::embed(const std::vector<std::vector<int32_t>>& sequences, float* out, ThreadPool* pool) const {
+    if (!isLoaded()) {
+        return false;
+    }
+    const size_t h = config_.hidden;
+    std::vector<size_t> offsets(1, 0);
+    for (const std::vector<int32_t>& ids : sequences) {
+        if (ids.empty() || ids.size() > config_.maxPositions) {
+            return false;
+        }
+        for (int32_t id : ids) {
+            if (id < 0 || static_cast<uint32_t>(id) >= config_.vocabSize) {
+                return false;
+            }
+        }
+        offsets.push_back(offsets.back() + ids.size());
+    }
+    const size_t tokens = offsets.back();
+    if (tokens == 0) {
+        return true;
+    }
+
+    // Embeddings: word + position + token type 0, then LayerNorm
+    std::vector<float> hidden(tokens * h);
+    for (size_t s = 0; s < sequences.size(); ++s) {
+        for (size_t t = 0; t < sequences[s].size(); ++t) {
+            float* row = hidden.data() + (offsets[s] + t) * h;
+            const float* word = wordEmbeddings_ + static_cast<size_t>(sequences[s][t]) * h;
+            const float* position = positionEmbeddings_ + t * h;
+            for (size_t i = 0; i < h; ++i) {
+                row[i] = word[i] + position[i] + typeEmbeddings_[i];
+            }
+        }
+    }
+    addLayerNorm(hidden.data(), nullptr, tokens, h, embeddingNormGamma_, embeddingNormBeta_,
+                 config_.layerNormEps, pool);
+
+    std::vector<float> qkv(tokens * 3 * h);
+    std::vector<float> context(tokens * h);
+    std::vector<float> projected(tokens * h);
+    std::vector<float> intermediate(tokens * config_.intermediate);
+    for (const Layer& layer : layers_) {
+        applyLinear(layer.qkv, hidden.data(), tokens, qkv.data(), pool);
+        attention(qkv.data(), offsets, context.data(), pool);
+        applyLinear(layer.attentionOutput, context.data(), tokens, projected.data(), pool);
+        addLayerNorm(projected.data(), hidden.data(), tokens, h, layer.attentionNormGamma, layer.attentionNormBeta,
+                     config_.layerNormEps, pool);
+        hidden.swap(projected);
+
+        applyLinear(layer.intermediate, hidden.data(), tokens, intermediate.data(), pool);
+        gelu(intermediate.data(), tokens, config_.intermediate, pool);
+        applyLinear(layer.output, intermediate.data(), tokens, projected.data(), pool);
+        addLayerNorm(projected.data(), hidden.data(), tokens, h, layer.outputNormGamma, layer.outputNormBeta,
+                     config_.layerNormEps, pool);
+        hidden.swap(projected);
+    }
+
+    // Mean pooling over each sequence, then L2 normalization (sentence-transformers' Normalize)
+    for (size_t s = 0; s < sequences.size(); ++s) {
+        float* v = out + s * h;
+        std::fill(v, v + h, 0.0f);
+        for (size_t t = offsets[s]; t < offsets[s + 1]; ++t) {
+            const float* row = hidden.data() + t * h;
+            for (size_t i = 0; i < h; ++i) {
+                v[i] += row[i];
+            }
+        }
+        float norm = 0.0f;
+        for (size_t i = 0; i < h; ++i) {
+            norm += v[i] * v[i];
+        }
+        norm = std::sqrt(norm);
+        for (size_t i = 0; i < h; ++i) {
+            v[i] = norm > 0.0f ? v[i] / norm : 0.0f;
+        }
+    }
+    return true;
+}
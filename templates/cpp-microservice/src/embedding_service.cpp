@@ -0,0 +1,101 @@
+#include "embedding_service.h"
+#include "config_manager.h"
+#include "json_util.h"
+#include <iostream>
+
+namespace {
+
+typedef std::map<std::string, std::string> Params;
+
+std::string error(const std::string& message) {
+    std::string out = "{\"error\": ";
+    appendJsonString(out, message);
+    out += "}";
+    return out;
+}
+
+} // namespace
+
+EmbeddingService::EmbeddingService() {}
+
+EmbeddingService::~EmbeddingService() {
+    shutdown();
+}
+
+bool EmbeddingService::initialize(const ConfigManager& config) {
+    TextEmbedderOptions options;
+    options.quantize = config.getBool("EMBEDDING_INT8", options.quantize);
+    options.maxSequenceLength = static_cast<size_t>(
+        config.getInt("EMBEDDING_MAX_LENGTH", static_cast<int>(options.maxSequenceLength)));
+    options.maxBatchTokens = static_cast<size_t>(
+        config.getInt("EMBEDDING_MAX_BATCH_TOKENS", static_cast<int>(options.maxBatchTokens)));
+    options.maxWaitMicros = config.getInt("EMBEDDING_MAX_WAIT_US", options.maxWaitMicros);
+    options.threads = static_cast<size_t>(config.getInt("EMBEDDING_THREADS", 0));
+
+    std::string directory = config.get("EMBEDDING_MODEL_DIR", "models/all-MiniLM-L6-v2");
+    if (!embedder_.load(directory, options)) {
+        std::cerr << "Failed to load embedding model from " << directory << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void EmbeddingService::shutdown() {
+    embedder_.stop();
+}
+
+void EmbeddingService::registerRoutes(HttpServer& server) {
+    server.post("/embed_text", [this](const Params& params) { return handleEmbedText(params); });
+    server.get("/embed_text/stats", [this](const Params& params) { return handleStats(params); });
+}
+
+std::string EmbeddingService::handleEmbedText(const Params& params) {
+    std::map<size_t, std::string_view> indexed;
+    if (!indexedParams(params, "texts.", kMaxParamIndex, indexed)) {
+        return error("bad index");
+    }
+    std::vector<std::string> texts;
+    auto single = params.find("text");
+    if (single != params.end()) {
+        texts.push_back(single->second);
+    }
+    for (const auto& kv : indexed) {
+        texts.push_back(std::string(kv.second));
+    }
+    if (texts.empty()) {
+        return error("text or texts.<i> required");
+    }
+
+    std::vector<std::vector<float>> vectors;
+    size_t tokens = 0;
+    if (!embedder_.embed(texts, vectors, &tokens)) {
+        return error("embedding failed");
+    }
+
+    std::string out = "{\"embeddings\": [";
+    for (size_t i = 0; i < vectors.size(); ++i) {
+        out += i > 0 ? ", [" : "[";
+        for (size_t d = 0; d < vectors[i].size(); ++d) {
+            if (d > 0) {
+                out += ", ";
+            }
+            appendJsonNumber(out, vectors[i][d]);
+        }
+        out += "]";
+    }
+    out += "], \"dim\": " + std::to_string(embedder_.dim()) + ", \"tokens\": " + std::to_string(tokens) + "}";
+    return out;
+}
+
+std::string EmbeddingService::handleStats(const Params&) {
+    TextEmbedderStats s = embedder_.stats();
+    std::string out = "{\"requests\": " + std::to_string(s.requests);
+    out += ", \"texts\": " + std::to_string(s.texts);
+    out += ", \"tokens\": " + std::to_string(s.tokens);
+    out += ", \"batches\": " + std::to_string(s.batches);
+    out += ", \"busy_seconds\": ";
+    appendJsonNumber(out, s.busySeconds);
+    out += ", \"tokens_per_second\": ";
+    appendJsonNumber(out, s.tokensPerSecond);
+    return out + "}";
+}
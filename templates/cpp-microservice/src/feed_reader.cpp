@@ -0,0 +1,207 @@
+#include "feed_reader.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+enum Field : uint8_t { kId, kTitle, kLink, kSummary, kDate, kFieldCount };
+
+std::string_view FeedEntry::*const kFields[kFieldCount] = {&FeedEntry::id, &FeedEntry::title, &FeedEntry::link,
+                                                           &FeedEntry::summary, &FeedEntry::date};
+
+// Where a FeedEntry field comes from: an element, optionally only when an
+// attribute has a given value, read from its content or from an attribute
+struct Rule {
+    const char* element;
+    const char* attribute;          // Condition attribute, or nullptr
+    const char* attributeValue;     // Required value; nullptr means the attribute must be absent
+    const char* valueAttribute;     // Take the field from this attribute instead of the content
+    Field field;
+    uint8_t priority;               // Lower wins when several rules fill one field
+};
+
+const Rule kAtomRules[] = {
+    {"id", nullptr, nullptr, nullptr, kId, 0},
+    {"title", nullptr, nullptr, nullptr, kTitle, 0},
+    {"summary", nullptr, nullptr, nullptr, kSummary, 0},
+    {"content", nullptr, nullptr, nullptr, kSummary, 1},
+    {"published", nullptr, nullptr, nullptr, kDate, 0},
+    {"updated", nullptr, nullptr, nullptr, kDate, 1},
+    {"link", "rel", "alternate", "href", kLink, 0},
+    {"link", "rel", nullptr, "href", kLink, 0},     // rel defaults to alternate
+};
+
+const Rule kRssRules[] = {
+    {"guid", nullptr, nullptr, nullptr, kId, 0},
+    {"title", nullptr, nullptr, nullptr, kTitle, 0},
+    {"link", nullptr, nullptr, nullptr, kLink, 0},
+    {"description", nullptr, nullptr, nullptr, kSummary, 0},
+    {"pubDate", nullptr, nullptr, nullptr, kDate, 0},
+    {"date", nullptr, nullptr, nullptr, kDate, 1},  // dc:date
+};
+
+const Rule kPubmedSummaryRules[] = {
+    {"Id", nullptr, nullptr, nullptr, kId, 0},
+    {"Item", "Name", "Title", nullptr, kTitle, 0},
+    {"Item", "Name", "Source", nullptr, kSummary, 0},
+    {"Item", "Name", "PubDate", nullptr, kDate, 0},
+};
+
+const Rule kPubmedArticleRules[] = {
+    {"PMID", nullptr, nullptr, nullptr, kId, 0},
+    {"ArticleTitle", nullptr, nullptr, nullptr, kTitle, 0},
+    {"Abstract", nullptr, nullptr, nullptr, kSummary, 0},
+    {"PubDate", nullptr, nullptr, nullptr, kDate, 0},
+};
+
+struct Format {
+    FeedFormat format;
+    const char* root;
+    const char* entry;
+    const char* name;
+    const Rule* rules;
+    size_t ruleCount;
+};
+
+const Format kFormats[] = {
+    {FeedFormat::Atom, "feed", "entry", "atom", kAtomRules, std::size(kAtomRules)},
+    {FeedFormat::Rss, "rss", "item", "rss", kRssRules, std::size(kRssRules)},
+    {FeedFormat::Rss, "RDF", "item", "rss", kRssRules, std::size(kRssRules)},
+    {FeedFormat::PubmedSummary, "eSummaryResult", "DocSum", "pubmed_summary", kPubmedSummaryRules,
+     std::size(kPubmedSummaryRules)},
+    {FeedFormat::PubmedArticles, "PubmedArticleSet", "PubmedArticle", "pubmed_articles", kPubmedArticleRules,
+     std::size(kPubmedArticleRules)},
+};
+
+const Format* findFormat(FeedFormat format) {
+    for (const Format& candidate : kFormats) {
+        if (candidate.format == format) {
+            return &candidate;
+        }
+    }
+    return nullptr;
+}
+
+bool matches(const Rule& rule, const XmlReader& reader) {
+    if (reader.name() != rule.element) {
+        return false;
+    }
+    if (!rule.attribute) {
+        return true;
+    }
+    std::string_view value;
+    const bool present = reader.attribute(rule.attribute, value);
+    return rule.attributeValue ? present && value == rule.attributeValue : !present;
+}
+
+} // namespace
+
+FeedReader::FeedReader(std::string_view xml) : xml_(xml), reader_(xml), format_(FeedFormat::Unknown), error_("") {}
+
+bool FeedReader::fail(const char* message) {
+    error_ = message;
+    return false;
+}
+
+bool FeedReader::next(FeedEntry& entry) {
+    if (*error_) {
+        return false;
+    }
+    if (format_ == FeedFormat::Unknown) {
+        XmlToken token;
+        while ((token = reader_.next()) != XmlToken::StartTag) {
+            if (token == XmlToken::Error) {
+                return fail(reader_.error());
+            }
+            if (token == XmlToken::End) {
+                return fail("empty document");
+            }
+        }
+        for (const Format& format : kFormats) {
+            if (reader_.name() == format.root) {
+                format_ = format.format;
+            }
+        }
+        if (format_ == FeedFormat::Unknown) {
+            return fail("unknown feed format");
+        }
+    }
+
+    const char* entryName = findFormat(format_)->entry;
+    while (true) {
+        switch (reader_.next()) {
+        case XmlToken::StartTag:
+            if (reader_.name() == entryName) {
+                return readEntry(reader_.depth(), entry);
+            }
+            break;
+        case XmlToken::Error:
+            return fail(reader_.error());
+        case XmlToken::End:
+            return false;
+        default:
+            break;
+        }
+    }
+}
+
+bool FeedReader::readEntry(size_t depth, FeedEntry& entry) {
+    const Format* format = findFormat(format_);
+    entry = FeedEntry();
+    uint8_t priority[kFieldCount] = {255, 255, 255, 255, 255};
+
+    // The element whose content is being captured; nested rules are ignored until it closes
+    const Rule* capture = nullptr;
+    size_t captureDepth = 0;
+    size_t captureStart = 0;
+    while (true) {
+        switch (reader_.next()) {
+        case XmlToken::StartTag:
+            if (capture) {
+                break;
+            }
+            for (size_t i = 0; i < format->ruleCount; ++i) {
+                const Rule& rule = format->rules[i];
+                if (rule.priority >= priority[rule.field] || !matches(rule, reader_)) {
+                    continue;
+                }
+                if (rule.valueAttribute) {
+                    std::string_view value;
+                    if (reader_.attribute(rule.valueAttribute, value)) {
+                        entry.*kFields[rule.field] = value;
+                        priority[rule.field] = rule.priority;
+                    }
+                } else {
+                    capture = &rule;
+                    captureDepth = reader_.depth();
+                    captureStart = reader_.offset();
+                }
+                break;
+            }
+            break;
+        case XmlToken::EndTag:
+            if (capture && reader_.depth() + 1 == captureDepth) {
+                // A self-closing element ends where it starts: empty content
+                const size_t end = std::max(reader_.tagOffset(), captureStart);
+                entry.*kFields[capture->field] = xml_.substr(captureStart, end - captureStart);
+                priority[capture->field] = capture->priority;
+                capture = nullptr;
+            }
+            if (reader_.depth() + 1 == depth) {
+                return true;
+            }
+            break;
+        case XmlToken::Error:
+            return fail(reader_.error());
+        case XmlToken::End:
+            return fail("unexpected end of document");
+        default:
+            break;
+        }
+    }
+}
+
+const char* feedFormatName(FeedFormat format) {
+    const Format* found = findFormat(format);
+    return found ? found->name : "unknown";
+}
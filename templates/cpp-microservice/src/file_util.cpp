@@ -0,0 +1,45 @@
+#include "file_util.h"
+#include <cerrno>
+#include <charconv>
+#include <unistd.h>
+
+bool parseGeneration(const std::string& name, const std::string& prefix, const std::string& suffix,
+                     uint64_t& generation) {
+    if (name.size() <= prefix.size() + suffix.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+        name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+        return false;
+    }
+    const char* first = name.data() + prefix.size();
+    const char* last = name.data() + name.size() - suffix.size();
+    if (*first < '0' || *first > '9') {
+        return false;    // from_chars would take a sign
+    }
+    // Too many digits is out_of_range, and the file is skipped rather than aborting startup
+    const std::from_chars_result result = std::from_chars(first, last, generation);
+    return result.ec == std::errc() && result.ptr == last;
+}
+
+bool writeAll(int fd, const char* data, size_t size, off_t offset) {
+    while (size > 0) {
+        const ssize_t n = offset >= 0 ? ::pwrite(fd, data, size, offset) : ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (n == 0) {
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+        if (offset >= 0) {
+            offset += n;
+        }
+    }
+    return true;
+}
+
+double millisSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,167 @@
+#include "flat_scan.h"
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Rows per block: 64 rows x 384 dims x 4 bytes = 96 KiB, about an L2 slice
+const size_t kBlockRows = 64;
+// Rows per parallel chunk; smaller scans are not worth a thread hand-off
+const size_t kChunkRows = 4096;
+
+typedef void (*BlockKernel)(bool cosine, const float* vectors, uint32_t dim, const float* query,
+                            const uint32_t* rows, size_t first, size_t count, float* out);
+
+inline const float* rowPointer(const float* vectors, uint32_t dim, const uint32_t* rows, size_t i) {
+    return vectors + static_cast<size_t>(rows ? rows[i] : i) * dim;
+}
+
+void scalarBlock(bool cosine, const float* vectors, uint32_t dim, const float* query, const uint32_t* rows,
+                 size_t first, size_t count, float* out) {
+    for (size_t i = 0; i < count; ++i) {
+        const float* v = rowPointer(vectors, dim, rows, first + i);
+        out[i] = cosine ? 1.0f - dotProduct(query, v, dim) : squaredL2(query, v, dim);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("avx2,fma"))) inline float horizontalSum(__m256 v) {
+    __m128 lo = _mm256_castps256_ps128(v);
+    __m128 hi = _mm256_extractf128_ps(v, 1);
+    lo = _mm_add_ps(lo, hi);
+    lo = _mm_hadd_ps(lo, lo);
+    lo = _mm_hadd_ps(lo, lo);
+    return _mm_cvtss_f32(lo);
+}
+
+// Scores four rows per pass so every query load feeds four FMAs
+__attribute__((target("avx2,fma"))) void avx2Block(bool cosine, const float* vectors, uint32_t dim,
+                                                   const float* query, const uint32_t* rows, size_t first,
+                                                   size_t count, float* out) {
+    const size_t vecDim = dim & ~static_cast<size_t>(7);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const float* r0 = rowPointer(vectors, dim, rows, first + i);
+        const float* r1 = rowPointer(vectors, dim, rows, first + i + 1);
+        const float* r2 = rowPointer(vectors, dim, rows, first + i + 2);
+        const float* r3 = rowPointer(vectors, dim, rows, first + i + 3);
+        __m256 s0 = _mm256_setzero_ps();
+        __m256 s1 = _mm256_setzero_ps();
+        __m256 s2 = _mm256_setzero_ps();
+        __m256 s3 = _mm256_setzero_ps();
+        size_t d = 0;
+        if (cosine) {
+            for (; d < vecDim; d += 8) {
+                __m256 q = _mm256_loadu_ps(query + d);
+                s0 = _mm256_fmadd_ps(q, _mm256_loadu_ps(r0 + d), s0);
+                s1 = _mm256_fmadd_ps(q, _mm256_loadu_ps(r1 + d), s1);
+                s2 = _mm256_fmadd_ps(q, _mm256_loadu_ps(r2 + d), s2);
+                s3 = _mm256_fmadd_ps(q, _mm256_loadu_ps(r3 + d), s3);
+            }
+        } else {
+            for (; d < vecDim; d += 8) {
+                __m256 q = _mm256_loadu_ps(query + d);
+                __m256 d0 = _mm256_sub_ps(q, _mm256_loadu_ps(r0 + d));
+                __m256 d1 = _mm256_sub_ps(q, _mm256_loadu_ps(r1 + d));
+                __m256 d2 = _mm256_sub_ps(q, _mm256_loadu_ps(r2 + d));
+                __m256 d3 = _mm256_sub_ps(q, _mm256_loadu_ps(r3 + d));
+                s0 = _mm256_fmadd_ps(d0, d0, s0);
+                s1 = _mm256_fmadd_ps(d1, d1, s1);
+                s2 = _mm256_fmadd_ps(d2, d2, s2);
+                s3 = _mm256_fmadd_ps(d3, d3, s3);
+            }
+        }
+        float sums[4] = {horizontalSum(s0), horizontalSum(s1), horizontalSum(s2), horizontalSum(s3)};
+        const float* r[4] = {r0, r1, r2, r3};
+        for (int j = 0; j < 4; ++j) {
+            for (size_t t = vecDim; t < dim; ++t) {
+                float x = cosine ? query[t] * r[j][t] : (query[t] - r[j][t]) * (query[t] - r[j][t]);
+                sums[j] += x;
+            }
+            out[i + j] = cosine ? 1.0f - sums[j] : sums[j];
+        }
+    }
+    scalarBlock(cosine, vectors, dim, query, rows, first + i, count - i, out + i);
+}
+
+BlockKernel selectKernel() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return avx2Block;
+    }
+    return scalarBlock;
+}
+
+#else
+
+BlockKernel selectKernel() {
+    return scalarBlock;
+}
+
+#endif
+
+const BlockKernel kBlockKernel = selectKernel();
+
+bool byDistance(const SearchHit& a, const SearchHit& b) {
+    return a.distance < b.distance;
+}
+
+// Keeps the k best hits of rows [begin, end) in a max-heap ordered by distance
+void scanRange(DistanceMetric metric, const float* vectors, uint32_t dim, const float* query, const uint32_t* rows,
+               size_t begin, size_t end, size_t k, std::vector<SearchHit>& heap) {
+    const bool cosine = metric == DistanceMetric::Cosine;
+    float distances[kBlockRows];
+    heap.clear();
+    heap.reserve(k + 1);
+    for (size_t block = begin; block < end; block += kBlockRows) {
+        const size_t n = std::min(kBlockRows, end - block);
+        kBlockKernel(cosine, vectors, dim, query, rows, block, n, distances);
+        for (size_t i = 0; i < n; ++i) {
+            if (heap.size() == k && distances[i] >= heap.front().distance) {
+                continue;
+            }
+            const uint32_t row = rows ? rows[block + i] : static_cast<uint32_t>(block + i);
+            heap.push_back({row, distances[i]});
+            std::push_heap(heap.begin(), heap.end(), byDistance);
+            if (heap.size() > k) {
+                std::pop_heap(heap.begin(), heap.end(), byDistance);
+                heap.pop_back();
+            }
+        }
+    }
+}
+
+} // namespace
+
+void blockDistances(DistanceMetric metric, const float* vectors, uint32_t dim, const float* query,
+                    const uint32_t* rows, size_t first, size_t count, float* out) {
+    kBlockKernel(metric == DistanceMetric::Cosine, vectors, dim, query, rows, first, count, out);
+}
+
+std::vector<SearchHit> flatSearch(DistanceMetric metric, const float* vectors, uint32_t dim, const float* query,
+                                  const uint32_t* rows, size_t count, size_t k, ThreadPool* pool) {
+    std::vector<SearchHit> hits;
+    if (count == 0 || k == 0) {
+        return hits;
+    }
+
+    if (!pool || pool->size() == 0 || count <= kChunkRows) {
+        scanRange(metric, vectors, dim, query, rows, 0, count, k, hits);
+    } else {
+        std::vector<std::vector<SearchHit>> heaps((count + kChunkRows - 1) / kChunkRows);
+        pool->parallelFor(count, kChunkRows, [&](size_t chunk, size_t begin, size_t end) {
+            scanRange(metric, vectors, dim, query, rows, begin, end, k, heaps[chunk]);
+        });
+        for (const std::vector<SearchHit>& heap : heaps) {
+            hits.insert(hits.end(), heap.begin(), heap.end());
+        }
+    }
+
+    size_t n = std::min(k, hits.size());
+    std::partial_sort(hits.begin(), hits.begin() + n, hits.end(), byDistance);
+    hits.resize(n);
+    return hits;
+}
@@ -0,0 +1,182 @@
+#include "forward_queue_service.h"
+#include "config_manager.h"
+#include "json_parser.h"
+#include "json_util.h"
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+
+typedef std::map<std::string, std::string> Params;
+
+const long kMaxLeasesPerRequest = 1000;
+const size_t kPendingListed = 100;    // As the crawler's /crawl/pending
+
+std::string param(const Params& params, const std::string& key, const std::string& defaultValue = "") {
+    auto it = params.find(key);
+    return it != params.end() ? it->second : defaultValue;
+}
+
+std::string error(const std::string& message) {
+    std::string out = "{\"error\": ";
+    appendJsonString(out, message);
+    out += "}";
+    return out;
+}
+
+// Non-negative integer parameter; -1 if it is malformed
+long long parseCount(const std::string& text, long long defaultValue) {
+    if (text.empty()) {
+        return defaultValue;
+    }
+    char* end = nullptr;
+    const long long value = std::strtoll(text.c_str(), &end, 10);
+    return *end == '\0' && value >= 0 ? value : -1;
+}
+
+// Seconds since the epoch, as the crawler's created_at column, written exactly from the milliseconds
+void appendSeconds(std::string& out, uint64_t millis) {
+    const std::string fraction = std::to_string(1000 + millis % 1000);
+    out += std::to_string(millis / 1000);
+    out += '.';
+    out.append(fraction, 1, 3);
+}
+
+} // namespace
+
+ForwardQueueService::ForwardQueueService() {}
+
+ForwardQueueService::~ForwardQueueService() {
+    shutdown();
+}
+
+bool ForwardQueueService::initialize(const ConfigManager& config) {
+    DurableQueueOptions options;
+    options.directory = config.get("FORWARD_QUEUE_DIR", options.directory);
+    const int segmentMb = config.getInt("FORWARD_QUEUE_SEGMENT_MB", static_cast<int>(options.segmentBytes >> 20));
+    options.syncWrites = config.getBool("FORWARD_QUEUE_SYNC_WRITES", options.syncWrites);
+    const int maxAttempts = config.getInt("FORWARD_QUEUE_MAX_ATTEMPTS", static_cast<int>(options.maxAttempts));
+    const int backoff = config.getInt("FORWARD_QUEUE_BACKOFF_MS", static_cast<int>(options.backoffMillis));
+    const int maxBackoff = config.getInt("FORWARD_QUEUE_MAX_BACKOFF_MS", static_cast<int>(options.maxBackoffMillis));
+    if (segmentMb < 1 || maxAttempts < 1 || backoff < 1 || maxBackoff < backoff) {
+        std::cerr << "FORWARD_QUEUE_SEGMENT_MB, FORWARD_QUEUE_MAX_ATTEMPTS and FORWARD_QUEUE_BACKOFF_MS must be "
+                     "positive and FORWARD_QUEUE_MAX_BACKOFF_MS at least FORWARD_QUEUE_BACKOFF_MS"
+                  << std::endl;
+        return false;
+    }
+    options.segmentBytes = static_cast<size_t>(segmentMb) << 20;
+    options.maxAttempts = static_cast<uint32_t>(maxAttempts);
+    options.backoffMillis = static_cast<uint64_t>(backoff);
+    options.maxBackoffMillis = static_cast<uint64_t>(maxBackoff);
+
+    if (!queue_.open(options)) {
+        std::cerr << "Failed to open forward queue at " << options.directory << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void ForwardQueueService::shutdown() {
+    queue_.close();
+}
+
+void ForwardQueueService::registerRoutes(HttpServer& server) {
+    server.postBody("/forward/enqueue",
+                    [this](const Params& params, std::string_view body) { return handleEnqueue(params, body); });
+    server.post("/forward/lease", [this](const Params& params) { return handleLease(params); });
+    server.post("/forward/ack", [this](const Params& params) { return handleAck(params); });
+    server.get("/forward/pending", [this](const Params& params) { return handlePending(params); });
+    server.post("/forward/retry", [this](const Params& params) { return handleRetry(params); });
+    server.get("/forward/stats", [this](const Params& params) { return handleStats(params); });
+}
+
+std::string ForwardQueueService::handleEnqueue(const Params& params, std::string_view body) {
+    if (param(params, "url").empty()) {
+        return error("url is required");
+    }
+    // The warehouse /ingest body, byte for byte: numbers, booleans and nested values keep their types
+    const std::string payload(body);
+    const uint64_t seq = queue_.append(payload);
+    if (seq == 0) {
+        return error("queue write failed");
+    }
+    return "{\"queued\": true, \"id\": " + std::to_string(seq) + "}";
+}
+
+std::string ForwardQueueService::handleLease(const Params& params) {
+    const long long max = parseCount(param(params, "max"), 20);
+    if (max < 1 || max > kMaxLeasesPerRequest) {
+        return error("max must be within [1, " + std::to_string(kMaxLeasesPerRequest) + "]");
+    }
+    const uint64_t now = DurableQueue::wallMillis();
+    std::vector<QueueMessage> messages;
+    queue_.poll(static_cast<size_t>(max), now, messages);
+    std::string out = "{\"messages\": [";
+    for (size_t i = 0; i < messages.size(); ++i) {
+        out += i ? ", {\"id\": " : "{\"id\": ";
+        out += std::to_string(messages[i].seq);
+        out += ", \"attempts\": " + std::to_string(messages[i].attempts);
+        out += ", \"created_at\": ";
+        appendSeconds(out, messages[i].createdAt);
+        out += ", \"payload\": " + messages[i].payload + "}";
+    }
+    out += "], \"wait_ms\": " + std::to_string(queue_.waitMillis(now)) + "}";
+    return out;
+}
+
+std::string ForwardQueueService::handleAck(const Params& params) {
+    const long long id = parseCount(param(params, "id"), -1);
+    if (id < 1) {
+        return error("id is required");
+    }
+    const std::string ok = param(params, "ok", "true");
+    if (ok == "true") {
+        return queue_.ack(static_cast<uint64_t>(id)) ? "{\"acked\": true}" : error("id is not leased");
+    }
+    return queue_.nack(static_cast<uint64_t>(id), DurableQueue::wallMillis()) ? "{\"requeued\": true}"
+                                                                              : error("id is not leased");
+}
+
+std::string ForwardQueueService::handlePending(const Params&) {
+    std::vector<QueueMessage> messages;
+    queue_.pending(kPendingListed, messages);
+    std::string out = "{\"total\": " + std::to_string(queue_.stats().backlog) + ", \"pending\": [";
+    for (size_t i = 0; i < messages.size(); ++i) {
+        Params payload;
+        flattenJson(messages[i].payload, payload);
+        out += i ? ", {\"id\": " : "{\"id\": ";
+        out += std::to_string(messages[i].seq) + ", \"url\": ";
+        appendJsonString(out, param(payload, "url"));
+        out += ", \"title\": ";
+        appendJsonString(out, param(payload, "title"));
+        out += ", \"attempts\": " + std::to_string(messages[i].attempts) + ", \"created_at\": ";
+        appendSeconds(out, messages[i].createdAt);
+        out += "}";
+    }
+    out += "]}";
+    return out;
+}
+
+std::string ForwardQueueService::handleRetry(const Params&) {
+    return "{\"retried\": true, \"due\": " + std::to_string(queue_.retryNow()) + "}";
+}
+
+std::string ForwardQueueService::handleStats(const Params&) {
+    DurableQueueStats s = queue_.stats();
+    std::string out = "{\"backlog\": " + std::to_string(s.backlog);
+    out += ", \"inflight\": " + std::to_string(s.inflight);
+    out += ", \"waiting\": " + std::to_string(s.waiting);
+    out += ", \"segments\": " + std::to_string(s.segments);
+    out += ", \"segment_bytes\": " + std::to_string(s.segmentBytes);
+    out += ", \"appended\": " + std::to_string(s.appended);
+    out += ", \"delivered\": " + std::to_string(s.delivered);
+    out += ", \"acked\": " + std::to_string(s.acked);
+    out += ", \"retried\": " + std::to_string(s.retried);
+    out += ", \"dead_letters\": " + std::to_string(s.deadLetters);
+    out += ", \"syncs\": " + std::to_string(s.syncs);
+    out += ", \"consumer_offset\": " + std::to_string(s.consumerOffset);
+    out += ", \"open_ms\": ";
+    appendJsonNumber(out, s.openMillis);
+    out += "}";
+    return out;
+}
@@ -0,0 +1,386 @@
+#include "gemm.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const size_t kPanelCols = 16;
+const size_t kTileRows = 4;
+// Weight rows per int8 tile
+const size_t kDotCols = 4;
+// Rows of A per task: 64 x 1536 floats = 384 KiB stays in L2 while panels stream past
+const size_t kBlockRows = 64;
+// Column panels per task
+const size_t kPanelsPerTask = 8;
+// Weight rows per int8 task
+const size_t kInt8RowsPerTask = 64;
+
+// Computes a 4 x 16 tile: tile[r][j] = sum_p a[r][p] * panel[p][j]
+typedef void (*TileKernel)(const float* a, size_t k, const float* panel, float* tile);
+
+// Computes 4 x 4 int32 dot products of A rows with four weight rows (sums holds their row sums)
+typedef void (*DotKernel)(const int8_t* a, size_t stride, const int8_t* const* w, const int32_t* sums,
+                          int32_t* out);
+
+// Quantizes one row of activations to int8, returning its scale
+typedef float (*RowQuantizer)(const float* x, size_t k, int8_t* q);
+
+void scalarTile(const float* a, size_t k, const float* panel, float* tile) {
+    std::fill(tile, tile + kTileRows * kPanelCols, 0.0f);
+    for (size_t r = 0; r < kTileRows; ++r) {
+        float* out = tile + r * kPanelCols;
+        for (size_t p = 0; p < k; ++p) {
+            const float x = a[r * k + p];
+            const float* b = panel + p * kPanelCols;
+            for (size_t j = 0; j < kPanelCols; ++j) {
+                out[j] += x * b[j];
+            }
+        }
+    }
+}
+
+void scalarDot(const int8_t* a, size_t stride, const int8_t* const* w, const int32_t*, int32_t* out) {
+    for (size_t r = 0; r < kTileRows; ++r) {
+        for (size_t j = 0; j < kDotCols; ++j) {
+            int32_t sum = 0;
+            for (size_t p = 0; p < stride; ++p) {
+                sum += static_cast<int32_t>(a[r * stride + p]) * w[j][p];
+            }
+            out[r * kDotCols + j] = sum;
+        }
+    }
+}
+
+float scalarQuantizeRow(const float* x, size_t k, int8_t* q) {
+    float maxAbs = 0.0f;
+    for (size_t p = 0; p < k; ++p) {
+        maxAbs = std::max(maxAbs, std::fabs(x[p]));
+    }
+    if (maxAbs == 0.0f) {
+        return 0.0f;
+    }
+    const float inverse = 127.0f / maxAbs;
+    for (size_t p = 0; p < k; ++p) {
+        q[p] = static_cast<int8_t>(std::lrint(x[p] * inverse));
+    }
+    return maxAbs / 127.0f;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// Each k step loads one 16-wide panel row and feeds it to four broadcast rows of A
+__attribute__((target("avx2,fma"))) void avx2Tile(const float* a, size_t k, const float* panel, float* tile) {
+    __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+    __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+    __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+    __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+    const float* a0 = a;
+    const float* a1 = a + k;
+    const float* a2 = a + 2 * k;
+    const float* a3 = a + 3 * k;
+    for (size_t p = 0; p < k; ++p) {
+        __m256 b0 = _mm256_loadu_ps(panel + p * kPanelCols);
+        __m256 b1 = _mm256_loadu_ps(panel + p * kPanelCols + 8);
+        __m256 x = _mm256_broadcast_ss(a0 + p);
+        c00 = _mm256_fmadd_ps(x, b0, c00);
+        c01 = _mm256_fmadd_ps(x, b1, c01);
+        x = _mm256_broadcast_ss(a1 + p);
+        c10 = _mm256_fmadd_ps(x, b0, c10);
+        c11 = _mm256_fmadd_ps(x, b1, c11);
+        x = _mm256_broadcast_ss(a2 + p);
+        c20 = _mm256_fmadd_ps(x, b0, c20);
+        c21 = _mm256_fmadd_ps(x, b1, c21);
+        x = _mm256_broadcast_ss(a3 + p);
+        c30 = _mm256_fmadd_ps(x, b0, c30);
+        c31 = _mm256_fmadd_ps(x, b1, c31);
+    }
+    _mm256_storeu_ps(tile, c00);
+    _mm256_storeu_ps(tile + 8, c01);
+    _mm256_storeu_ps(tile + 16, c10);
+    _mm256_storeu_ps(tile + 24, c11);
+    _mm256_storeu_ps(tile + 32, c20);
+    _mm256_storeu_ps(tile + 40, c21);
+    _mm256_storeu_ps(tile + 48, c30);
+    _mm256_storeu_ps(tile + 56, c31);
+}
+
+// Reduces one row's four int32 accumulators to their four horizontal sums
+__attribute__((target("avx2"))) inline void horizontalSums(__m256i c0, __m256i c1, __m256i c2, __m256i c3,
+                                                           int32_t* out) {
+    __m256i sums = _mm256_hadd_epi32(_mm256_hadd_epi32(c0, c1), _mm256_hadd_epi32(c2, c3));
+    __m128i total = _mm_add_epi32(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), total);
+}
+
+// maddubs needs one unsigned operand: |a| times w with a's sign, which cannot
+// saturate because both are within +-127, then pairs are widened to int32
+__attribute__((target("avx2"))) void avx2Dot(const int8_t* a, size_t stride, const int8_t* const* w, const int32_t*,
+                                             int32_t* out) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    #pragma GCC unroll 4
+    for (size_t r = 0; r < kTileRows; r += 2) {
+        __m256i c[2][kDotCols];
+        #pragma GCC unroll 4
+        for (size_t j = 0; j < kDotCols; ++j) {
+            c[0][j] = _mm256_setzero_si256();
+            c[1][j] = _mm256_setzero_si256();
+        }
+        const int8_t* a0 = a + r * stride;
+        const int8_t* a1 = a0 + stride;
+        for (size_t p = 0; p < stride; p += 32) {
+            __m256i x0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a0 + p));
+            __m256i x1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a1 + p));
+            __m256i m0 = _mm256_abs_epi8(x0);
+            __m256i m1 = _mm256_abs_epi8(x1);
+            #pragma GCC unroll 4
+            for (size_t j = 0; j < kDotCols; ++j) {
+                __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w[j] + p));
+                __m256i p0 = _mm256_maddubs_epi16(m0, _mm256_sign_epi8(b, x0));
+                __m256i p1 = _mm256_maddubs_epi16(m1, _mm256_sign_epi8(b, x1));
+                c[0][j] = _mm256_add_epi32(c[0][j], _mm256_madd_epi16(p0, ones));
+                c[1][j] = _mm256_add_epi32(c[1][j], _mm256_madd_epi16(p1, ones));
+            }
+        }
+        horizontalSums(c[0][0], c[0][1], c[0][2], c[0][3], out + r * kDotCols);
+        horizontalSums(c[1][0], c[1][1], c[1][2], c[1][3], out + (r + 1) * kDotCols);
+    }
+}
+
+// vpdpbusd multiplies unsigned by signed bytes: a + 128 is unsigned, and
+// 128 * sum(w) is subtracted at the end. Rows go two at a time so the eight
+// accumulators stay within the 16 registers GCC allocates for it.
+__attribute__((target("avx2,avx512vl,avx512vnni"))) void vnniDot(const int8_t* a, size_t stride,
+                                                                 const int8_t* const* w, const int32_t* sums,
+                                                                 int32_t* out) {
+    const __m256i offset = _mm256_set1_epi8(static_cast<char>(0x80));
+    for (size_t r = 0; r < kTileRows; r += 2) {
+        __m256i c[2][kDotCols];
+#pragma GCC unroll 4
+        for (size_t j = 0; j < kDotCols; ++j) {
+            c[0][j] = _mm256_setzero_si256();
+            c[1][j] = _mm256_setzero_si256();
+        }
+        const int8_t* a0 = a + r * stride;
+        const int8_t* a1 = a0 + stride;
+        for (size_t p = 0; p < stride; p += 32) {
+            __m256i x0 = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a0 + p)), offset);
+            __m256i x1 = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a1 + p)), offset);
+#pragma GCC unroll 4
+            for (size_t j = 0; j < kDotCols; ++j) {
+                __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(w[j] + p));
+                c[0][j] = _mm256_dpbusd_epi32(c[0][j], x0, b);
+                c[1][j] = _mm256_dpbusd_epi32(c[1][j], x1, b);
+            }
+        }
+        horizontalSums(c[0][0], c[0][1], c[0][2], c[0][3], out + r * kDotCols);
+        horizontalSums(c[1][0], c[1][1], c[1][2], c[1][3], out + (r + 1) * kDotCols);
+    }
+    for (size_t i = 0; i < kTileRows * kDotCols; ++i) {
+        out[i] -= 128 * sums[i % kDotCols];
+    }
+}
+
+// cvtps_epi32 rounds to nearest even like lrint; packs then restores lane order
+__attribute__((target("avx2"))) float avx2QuantizeRow(const float* x, size_t k, int8_t* q) {
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    __m256 maxima = _mm256_setzero_ps();
+    size_t p = 0;
+    for (; p + 8 <= k; p += 8) {
+        maxima = _mm256_max_ps(maxima, _mm256_andnot_ps(signMask, _mm256_loadu_ps(x + p)));
+    }
+    float lanes[8];
+    _mm256_storeu_ps(lanes, maxima);
+    float maxAbs = *std::max_element(lanes, lanes + 8);
+    for (; p < k; ++p) {
+        maxAbs = std::max(maxAbs, std::fabs(x[p]));
+    }
+    if (maxAbs == 0.0f) {
+        return 0.0f;
+    }
+    const float inverse = 127.0f / maxAbs;
+    const __m256 scale = _mm256_set1_ps(inverse);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    for (p = 0; p + 32 <= k; p += 32) {
+        __m256i v0 = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(x + p), scale));
+        __m256i v1 = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(x + p + 8), scale));
+        __m256i v2 = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(x + p + 16), scale));
+        __m256i v3 = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(x + p + 24), scale));
+        __m256i packed = _mm256_packs_epi16(_mm256_packs_epi32(v0, v1), _mm256_packs_epi32(v2, v3));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(q + p), _mm256_permutevar8x32_epi32(packed, order));
+    }
+    for (; p < k; ++p) {
+        q[p] = static_cast<int8_t>(std::lrint(x[p] * inverse));
+    }
+    return maxAbs / 127.0f;
+}
+
+bool hasAvx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+}
+
+bool hasVnni() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512vnni");
+}
+
+const bool kAvx2 = hasAvx2();
+const TileKernel kTileKernel = kAvx2 ? avx2Tile : scalarTile;
+const DotKernel kDotKernel = kAvx2 ? (hasVnni() ? vnniDot : avx2Dot) : scalarDot;
+const RowQuantizer kRowQuantizer = kAvx2 ? avx2QuantizeRow : scalarQuantizeRow;
+
+#else
+
+const TileKernel kTileKernel = scalarTile;
+const DotKernel kDotKernel = scalarDot;
+const RowQuantizer kRowQuantizer = scalarQuantizeRow;
+
+#endif
+
+// Splits [row blocks x column groups] into tasks; small problems stay on the caller
+void forEachTile(size_t m, size_t groups, ThreadPool* pool, const std::function<void(size_t, size_t)>& fn) {
+    const size_t rowBlocks = (m + kBlockRows - 1) / kBlockRows;
+    const size_t tasks = rowBlocks * groups;
+    auto run = [&](size_t, size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            fn(t / groups, t % groups);
+        }
+    };
+    if (pool) {
+        pool->parallelFor(tasks, 1, run);
+    } else {
+        run(0, 0, tasks);
+    }
+}
+
+} // namespace
+
+void PackedMatrix::pack(const float* weights, size_t n, size_t k) {
+    rows = n;
+    cols = k;
+    const size_t count = (n + kPanelCols - 1) / kPanelCols;
+    panels.assign(count * k * kPanelCols, 0.0f);
+    for (size_t row = 0; row < n; ++row) {
+        float* panel = panels.data() + (row / kPanelCols) * k * kPanelCols + row % kPanelCols;
+        for (size_t p = 0; p < k; ++p) {
+            panel[p * kPanelCols] = weights[row * k + p];
+        }
+    }
+}
+
+void QuantizedMatrix::quantize(const float* weights, size_t n, size_t k) {
+    rows = n;
+    cols = k;
+    stride = (k + 31) & ~static_cast<size_t>(31);
+    data.assign(n * stride, 0);
+    scales.assign(n, 0.0f);
+    rowSums.assign(n, 0);
+    for (size_t row = 0; row < n; ++row) {
+        const float* w = weights + row * k;
+        float maxAbs = 0.0f;
+        for (size_t p = 0; p < k; ++p) {
+            maxAbs = std::max(maxAbs, std::fabs(w[p]));
+        }
+        if (maxAbs == 0.0f) {
+            continue;
+        }
+        scales[row] = maxAbs / 127.0f;
+        const float inverse = 127.0f / maxAbs;
+        for (size_t p = 0; p < k; ++p) {
+            data[row * stride + p] = static_cast<int8_t>(std::lrint(w[p] * inverse));
+            rowSums[row] += data[row * stride + p];
+        }
+    }
+}
+
+void gemm(const float* a, size_t m, const PackedMatrix& w, const float* bias, float* c, ThreadPool* pool) {
+    const size_t n = w.rows;
+    const size_t k = w.cols;
+    const size_t panels = (n + kPanelCols - 1) / kPanelCols;
+    const size_t groups = (panels + kPanelsPerTask - 1) / kPanelsPerTask;
+
+    forEachTile(m, groups, pool, [&](size_t rowBlock, size_t group) {
+        const size_t rowBegin = rowBlock * kBlockRows;
+        const size_t rowEnd = std::min(m, rowBegin + kBlockRows);
+        std::vector<float> padded;
+        float tile[kTileRows * kPanelCols];
+        for (size_t panel = group * kPanelsPerTask; panel < std::min(panels, (group + 1) * kPanelsPerTask); ++panel) {
+            const float* packed = w.panels.data() + panel * k * kPanelCols;
+            const size_t col = panel * kPanelCols;
+            const size_t width = std::min(kPanelCols, n - col);
+            for (size_t row = rowBegin; row < rowEnd; row += kTileRows) {
+                const size_t height = std::min(kTileRows, rowEnd - row);
+                const float* rowsA = a + row * k;
+                if (height < kTileRows) {
+                    // Ragged tail: run the full kernel on zero-padded copies
+                    padded.assign(kTileRows * k, 0.0f);
+                    std::memcpy(padded.data(), rowsA, height * k * sizeof(float));
+                    rowsA = padded.data();
+                }
+                kTileKernel(rowsA, k, packed, tile);
+                for (size_t r = 0; r < height; ++r) {
+                    float* out = c + (row + r) * n + col;
+                    for (size_t j = 0; j < width; ++j) {
+                        out[j] = tile[r * kPanelCols + j] + (bias ? bias[col + j] : 0.0f);
+                    }
+                }
+            }
+        }
+    });
+}
+
+void gemmInt8(const float* a, size_t m, const QuantizedMatrix& w, const float* bias, float* c, ThreadPool* pool) {
+    const size_t n = w.rows;
+    const size_t k = w.cols;
+    const size_t stride = w.stride;
+
+    // Quantize activations per row; rows are padded to whole 4-row tiles
+    const size_t paddedRows = (m + kTileRows - 1) / kTileRows * kTileRows;
+    std::vector<int8_t> quantized(paddedRows * stride, 0);
+    std::vector<float> scales(paddedRows, 0.0f);
+    auto quantizeRows = [&](size_t, size_t begin, size_t end) {
+        for (size_t row = begin; row < end; ++row) {
+            scales[row] = kRowQuantizer(a + row * k, k, quantized.data() + row * stride);
+        }
+    };
+    if (pool) {
+        pool->parallelFor(m, kBlockRows, quantizeRows);
+    } else {
+        quantizeRows(0, 0, m);
+    }
+
+    const size_t groups = (n + kInt8RowsPerTask - 1) / kInt8RowsPerTask;
+    forEachTile(m, groups, pool, [&](size_t rowBlock, size_t group) {
+        const size_t rowBegin = rowBlock * kBlockRows;
+        const size_t rowEnd = std::min(m, rowBegin + kBlockRows);
+        const size_t colEnd = std::min(n, (group + 1) * kInt8RowsPerTask);
+        int32_t sums[kTileRows * kDotCols];
+        for (size_t col = group * kInt8RowsPerTask; col < colEnd; col += kDotCols) {
+            // A ragged last tile repeats the final weight row and drops the extra outputs
+            const size_t width = std::min(kDotCols, n - col);
+            const int8_t* rows[kDotCols];
+            int32_t rowSums[kDotCols];
+            for (size_t j = 0; j < kDotCols; ++j) {
+                const size_t source = col + std::min(j, width - 1);
+                rows[j] = w.data.data() + source * stride;
+                rowSums[j] = w.rowSums[source];
+            }
+            for (size_t row = rowBegin; row < rowEnd; row += kTileRows) {
+                kDotKernel(quantized.data() + row * stride, stride, rows, rowSums, sums);
+                const size_t height = std::min(kTileRows, rowEnd - row);
+                for (size_t r = 0; r < height; ++r) {
+                    float* out = c + (row + r) * n + col;
+                    const float scale = scales[row + r];
+                    for (size_t j = 0; j < width; ++j) {
+                        out[j] = sums[r * kDotCols + j] * scale * w.scales[col + j] + (bias ? bias[col + j] : 0.0f);
+                    }
+                }
+            }
+        }
+    });
+}
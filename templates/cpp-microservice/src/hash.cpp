@@ -0,0 +1,288 @@
+#include "hash.h"
+#include <algorithm>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t fmix64(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+inline uint64_t load64(const uint8_t* p) {
+    uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+const uint32_t kSha256Initial[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+alignas(16) const uint32_t kSha256Rounds[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+inline uint32_t rotr32(uint32_t x, int r) {
+    return (x >> r) | (x << (32 - r));
+}
+
+inline uint32_t loadBigEndian32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 |
+           static_cast<uint32_t>(p[2]) << 8 | static_cast<uint32_t>(p[3]);
+}
+
+typedef void (*Sha256Kernel)(uint32_t state[8], const uint8_t* blocks, size_t count);
+
+void scalarSha256(uint32_t state[8], const uint8_t* blocks, size_t count) {
+    for (; count > 0; --count, blocks += 64) {
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = loadBigEndian32(blocks + i * 4);
+        }
+        for (int i = 16; i < 64; ++i) {
+            const uint32_t s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            const uint32_t s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i) {
+            const uint32_t t1 = h + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25)) + ((e & f) ^ (~e & g)) +
+                                kSha256Rounds[i] + w[i];
+            const uint32_t t2 = (rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// The SHA extensions keep the state as ABEF and CDGH halves and do two rounds per sha256rnds2;
+// sha256msg1 and sha256msg2 extend the message schedule four words at a time
+__attribute__((target("sha,ssse3,sse4.1"))) void shaSha256(uint32_t state[8], const uint8_t* blocks,
+                                                              size_t count) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i cdab = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0xB1);
+    __m128i efgh = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4)), 0x1B);
+    __m128i abef = _mm_alignr_epi8(cdab, efgh, 8);
+    __m128i cdgh = _mm_blend_epi16(efgh, cdab, 0xF0);
+
+    for (; count > 0; --count, blocks += 64) {
+        const __m128i abefStart = abef;
+        const __m128i cdghStart = cdgh;
+        __m128i w[4];
+#pragma GCC unroll 16
+        for (int group = 0; group < 16; ++group) {
+            __m128i& current = w[group & 3];
+            if (group < 4) {
+                current = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks + group * 16)),
+                                           byteSwap);
+            }
+            __m128i words = _mm_add_epi32(
+                current, _mm_load_si128(reinterpret_cast<const __m128i*>(kSha256Rounds + group * 4)));
+            cdgh = _mm_sha256rnds2_epu32(cdgh, abef, words);
+            if (group >= 3 && group < 15) {
+                __m128i& next = w[(group + 1) & 3];
+                next = _mm_add_epi32(next, _mm_alignr_epi8(current, w[(group + 3) & 3], 4));
+                next = _mm_sha256msg2_epu32(next, current);
+            }
+            words = _mm_shuffle_epi32(words, 0x0E);
+            abef = _mm_sha256rnds2_epu32(abef, cdgh, words);
+            if (group >= 1 && group < 13) {
+                __m128i& previous = w[(group + 3) & 3];
+                previous = _mm_sha256msg1_epu32(previous, current);
+            }
+        }
+        abef = _mm_add_epi32(abef, abefStart);
+        cdgh = _mm_add_epi32(cdgh, cdghStart);
+    }
+
+    const __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+    const __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_blend_epi16(feba, dchg, 0xF0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), _mm_alignr_epi8(dchg, feba, 8));
+}
+
+bool hasShaExtensions() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1");
+}
+
+const Sha256Kernel kSha256Blocks = hasShaExtensions() ? shaSha256 : scalarSha256;
+
+#else
+
+const Sha256Kernel kSha256Blocks = scalarSha256;
+
+#endif
+
+} // namespace
+
+Hash128 murmurHash3(const void* data, size_t size, uint64_t seed) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    const size_t blocks = size / 16;
+    const uint64_t c1 = 0x87c37b91114253d5ULL;
+    const uint64_t c2 = 0x4cf5ad432745937fULL;
+    uint64_t h1 = seed;
+    uint64_t h2 = seed;
+
+    for (size_t i = 0; i < blocks; ++i) {
+        uint64_t k1 = load64(bytes + i * 16);
+        uint64_t k2 = load64(bytes + i * 16 + 8);
+
+        k1 *= c1;
+        k1 = rotl64(k1, 31);
+        k1 *= c2;
+        h1 ^= k1;
+        h1 = rotl64(h1, 27);
+        h1 += h2;
+        h1 = h1 * 5 + 0x52dce729;
+
+        k2 *= c2;
+        k2 = rotl64(k2, 33);
+        k2 *= c1;
+        h2 ^= k2;
+        h2 = rotl64(h2, 31);
+        h2 += h1;
+        h2 = h2 * 5 + 0x38495ab5;
+    }
+
+    const uint8_t* tail = bytes + blocks * 16;
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+    switch (size & 15) {
+    case 15: k2 ^= static_cast<uint64_t>(tail[14]) << 48; // fall through
+    case 14: k2 ^= static_cast<uint64_t>(tail[13]) << 40; // fall through
+    case 13: k2 ^= static_cast<uint64_t>(tail[12]) << 32; // fall through
+    case 12: k2 ^= static_cast<uint64_t>(tail[11]) << 24; // fall through
+    case 11: k2 ^= static_cast<uint64_t>(tail[10]) << 16; // fall through
+    case 10: k2 ^= static_cast<uint64_t>(tail[9]) << 8;   // fall through
+    case 9:
+        k2 ^= static_cast<uint64_t>(tail[8]);
+        k2 *= c2;
+        k2 = rotl64(k2, 33);
+        k2 *= c1;
+        h2 ^= k2;
+        // fall through
+    case 8: k1 ^= static_cast<uint64_t>(tail[7]) << 56; // fall through
+    case 7: k1 ^= static_cast<uint64_t>(tail[6]) << 48; // fall through
+    case 6: k1 ^= static_cast<uint64_t>(tail[5]) << 40; // fall through
+    case 5: k1 ^= static_cast<uint64_t>(tail[4]) << 32; // fall through
+    case 4: k1 ^= static_cast<uint64_t>(tail[3]) << 24; // fall through
+    case 3: k1 ^= static_cast<uint64_t>(tail[2]) << 16; // fall through
+    case 2: k1 ^= static_cast<uint64_t>(tail[1]) << 8;  // fall through
+    case 1:
+        k1 ^= static_cast<uint64_t>(tail[0]);
+        k1 *= c1;
+        k1 = rotl64(k1, 31);
+        k1 *= c2;
+        h1 ^= k1;
+    }
+
+    h1 ^= size;
+    h2 ^= size;
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix64(h1);
+    h2 = fmix64(h2);
+    h1 += h2;
+    h2 += h1;
+    return Hash128{h1, h2};
+}
+
+Sha256::Sha256() : buffered_(0), length_(0) {
+    std::memcpy(state_, kSha256Initial, sizeof(state_));
+}
+
+void Sha256::update(const void* data, size_t size) {
+    // An empty string_view may carry a null pointer, which memcpy rejects
+    if (size == 0) {
+        return;
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    length_ += size;
+    if (buffered_ > 0) {
+        const size_t taken = std::min(size, sizeof(buffer_) - buffered_);
+        std::memcpy(buffer_ + buffered_, bytes, taken);
+        buffered_ += taken;
+        bytes += taken;
+        size -= taken;
+        if (buffered_ < sizeof(buffer_)) {
+            return;
+        }
+        kSha256Blocks(state_, buffer_, 1);
+        buffered_ = 0;
+    }
+    kSha256Blocks(state_, bytes, size / 64);
+    buffered_ = size % 64;
+    std::memcpy(buffer_, bytes + size - buffered_, buffered_);
+}
+
+void Sha256::finish(uint8_t digest[kDigestSize]) {
+    // Padding: 0x80, zeros up to 8 bytes short of a block, then the length in bits, big-endian
+    const uint64_t bits = length_ * 8;
+    uint8_t padding[72] = {0x80};
+    const size_t zeros = (buffered_ < 56 ? 56 : 120) - buffered_;
+    for (int i = 0; i < 8; ++i) {
+        padding[zeros + i] = static_cast<uint8_t>(bits >> (56 - i * 8));
+    }
+    update(padding, zeros + 8);
+    for (int i = 0; i < 8; ++i) {
+        digest[i * 4] = static_cast<uint8_t>(state_[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(state_[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(state_[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(state_[i]);
+    }
+    std::memcpy(state_, kSha256Initial, sizeof(state_));
+    buffered_ = 0;
+    length_ = 0;
+}
+
+void Sha256::hash(const void* data, size_t size, uint8_t digest[kDigestSize]) {
+    Sha256 sha;
+    sha.update(data, size);
+    sha.finish(digest);
+}
+
+std::string toHex(const void* data, size_t size) {
+    static const char kDigits[] = "0123456789abcdef";
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    std::string out(size * 2, '0');
+    for (size_t i = 0; i < size; ++i) {
+        out[i * 2] = kDigits[bytes[i] >> 4];
+        out[i * 2 + 1] = kDigits[bytes[i] & 15];
+    }
+    return out;
+}
@@ -0,0 +1,408 @@
+#include "hnsw_index.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+namespace {
+
+// Per-thread visited marks; bumping the epoch clears the set in O(1)
+class VisitedSet {
+public:
+    void reset(size_t count) {
+        if (marks_.size() < count) {
+            marks_.resize(count, 0);
+        }
+        if (++epoch_ == 0) {
+            std::fill(marks_.begin(), marks_.end(), 0);
+            epoch_ = 1;
+        }
+    }
+
+    bool visit(uint32_t node) {
+        if (marks_[node] == epoch_) {
+            return false;
+        }
+        marks_[node] = epoch_;
+        return true;
+    }
+
+private:
+    std::vector<uint32_t> marks_;
+    uint32_t epoch_ = 0;
+};
+
+VisitedSet& visitedSet() {
+    thread_local VisitedSet visited;
+    return visited;
+}
+
+struct CloserFirst {
+    bool operator()(const SearchHit& a, const SearchHit& b) const { return a.distance > b.distance; }
+};
+
+struct FartherFirst {
+    bool operator()(const SearchHit& a, const SearchHit& b) const { return a.distance < b.distance; }
+};
+
+bool byDistance(const SearchHit& a, const SearchHit& b) {
+    return a.distance < b.distance;
+}
+
+template <typename Graph, typename DistanceFn>
+SearchHit greedyClosest(const Graph& graph, DistanceFn distance, SearchHit current, uint32_t level) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        const uint32_t* list = graph.neighbors(current.row, level);
+        for (uint32_t i = 1; i <= list[0]; ++i) {
+            float d = distance(list[i]);
+            if (d < current.distance) {
+                current = {list[i], d};
+                changed = true;
+            }
+        }
+    }
+    return current;
+}
+
+struct AcceptAll {
+    bool operator()(uint32_t) const { return true; }
+};
+
+// Filtered nodes are still expanded (they keep the graph connected) but never enter the results
+template <typename Graph, typename DistanceFn, typename FilterFn = AcceptAll>
+std::vector<SearchHit> searchLayer(const Graph& graph, DistanceFn distance, SearchHit entry, size_t ef,
+                                   uint32_t level, size_t count, FilterFn allowed = FilterFn()) {
+    VisitedSet& visited = visitedSet();
+    visited.reset(count);
+    visited.visit(entry.row);
+
+    std::priority_queue<SearchHit, std::vector<SearchHit>, CloserFirst> candidates;
+    std::priority_queue<SearchHit, std::vector<SearchHit>, FartherFirst> results;
+    candidates.push(entry);
+    if (allowed(entry.row)) {
+        results.push(entry);
+    }
+
+    while (!candidates.empty()) {
+        SearchHit current = candidates.top();
+        if (results.size() >= ef && current.distance > results.top().distance) {
+            break;
+        }
+        candidates.pop();
+
+        const uint32_t* list = graph.neighbors(current.row, level);
+        for (uint32_t i = 1; i <= list[0]; ++i) {
+            uint32_t node = list[i];
+            if (!visited.visit(node)) {
+                continue;
+            }
+            float d = distance(node);
+            if (results.size() < ef || d < results.top().distance) {
+                candidates.push({node, d});
+                if (allowed(node)) {
+                    results.push({node, d});
+                    if (results.size() > ef) {
+                        results.pop();
+                    }
+                }
+            }
+        }
+    }
+
+    std::vector<SearchHit> out(results.size());
+    for (size_t i = out.size(); i-- > 0;) {
+        out[i] = results.top();
+        results.pop();
+    }
+    return out;
+}
+
+} // namespace
+
+HnswBuilder::HnswBuilder(DistanceMetric metric, uint32_t dim, const float* vectors, const HnswParams& params)
+    : metric_(metric), dim_(dim), vectors_(vectors), m_(std::max<uint32_t>(params.m, 2)),
+      m0_(2 * m_), efConstruction_(std::max<uint32_t>(params.efConstruction, m_)),
+      levelMult_(1.0 / std::log(static_cast<double>(m_))), rng_(params.seed),
+      entry_(kInvalidRow), maxLevel_(0) {}
+
+void HnswBuilder::reserve(uint32_t count) {
+    level0_.reserve(static_cast<size_t>(count) * (m0_ + 1));
+    levels_.reserve(count);
+    upper_.reserve(count);
+}
+
+uint8_t HnswBuilder::randomLevel() {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    double level = -std::log(1.0 - uniform(rng_)) * levelMult_;
+    return static_cast<uint8_t>(std::min(level, 32.0));
+}
+
+uint32_t* HnswBuilder::links(uint32_t node, uint32_t level) {
+    if (level == 0) {
+        return level0_.data() + static_cast<size_t>(node) * (m0_ + 1);
+    }
+    return upper_[node].data() + static_cast<size_t>(level - 1) * (m_ + 1);
+}
+
+const uint32_t* HnswBuilder::neighbors(uint32_t node, uint32_t level) const {
+    return const_cast<HnswBuilder*>(this)->links(node, level);
+}
+
+float HnswBuilder::distance(uint32_t a, uint32_t b) const {
+    return vectorDistance(metric_, vectors_ + static_cast<size_t>(a) * dim_,
+                          vectors_ + static_cast<size_t>(b) * dim_, dim_);
+}
+
+void HnswBuilder::selectNeighbors(std::vector<SearchHit>& candidates, uint32_t maxCount) const {
+    if (candidates.size() <= maxCount) {
+        return;
+    }
+
+    // Keep a candidate only if it is closer to the base node than to every
+    // neighbour already kept; this spreads links across clusters.
+    std::vector<SearchHit> selected;
+    selected.reserve(maxCount);
+    for (const SearchHit& candidate : candidates) {
+        if (selected.size() >= maxCount) {
+            break;
+        }
+        bool keep = true;
+        for (const SearchHit& kept : selected) {
+            if (distance(candidate.row, kept.row) < candidate.distance) {
+                keep = false;
+                break;
+            }
+        }
+        if (keep) {
+            selected.push_back(candidate);
+        }
+    }
+    candidates.swap(selected);
+}
+
+void HnswBuilder::connect(uint32_t node, uint32_t level, const std::vector<SearchHit>& neighbors) {
+    uint32_t* list = links(node, level);
+    uint32_t cap = level == 0 ? m0_ : m_;
+    uint32_t degree = 0;
+    for (const SearchHit& hit : neighbors) {
+        if (degree >= cap) {
+            break;
+        }
+        list[++degree] = hit.row;
+    }
+    list[0] = degree;
+
+    for (uint32_t i = 1; i <= degree; ++i) {
+        addLink(list[i], level, node);
+    }
+}
+
+void HnswBuilder::addLink(uint32_t node, uint32_t level, uint32_t neighbor) {
+    uint32_t* list = links(node, level);
+    uint32_t cap = level == 0 ? m0_ : m_;
+    for (uint32_t i = 1; i <= list[0]; ++i) {
+        if (list[i] == neighbor) {
+            return;
+        }
+    }
+    if (list[0] < cap) {
+        list[++list[0]] = neighbor;
+        return;
+    }
+
+    // Full: re-select among the existing links plus the new one
+    std::vector<SearchHit> candidates;
+    candidates.reserve(cap + 1);
+    for (uint32_t i = 1; i <= list[0]; ++i) {
+        candidates.push_back({list[i], distance(node, list[i])});
+    }
+    candidates.push_back({neighbor, distance(node, neighbor)});
+    std::sort(candidates.begin(), candidates.end(), byDistance);
+    selectNeighbors(candidates, cap);
+
+    list[0] = static_cast<uint32_t>(candidates.size());
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        list[i + 1] = candidates[i].row;
+    }
+}
+
+void HnswBuilder::add(uint32_t row) {
+    uint8_t level = randomLevel();
+    levels_.push_back(level);
+    level0_.resize(level0_.size() + m0_ + 1, 0);
+    upper_.emplace_back(static_cast<size_t>(level) * (m_ + 1), 0);
+
+    if (entry_ == kInvalidRow) {
+        entry_ = row;
+        maxLevel_ = level;
+        return;
+    }
+
+    const float* query = vectors_ + static_cast<size_t>(row) * dim_;
+    auto distanceTo = [this, query](uint32_t node) {
+        return vectorDistance(metric_, query, vectors_ + static_cast<size_t>(node) * dim_, dim_);
+    };
+
+    SearchHit current{entry_, distanceTo(entry_)};
+    for (uint32_t l = maxLevel_; l > level; --l) {
+        current = greedyClosest(*this, distanceTo, current, l);
+    }
+
+    for (int l = static_cast<int>(std::min<uint32_t>(level, maxLevel_)); l >= 0; --l) {
+        std::vector<SearchHit> found = searchLayer(*this, distanceTo, current, efConstruction_,
+                                                   static_cast<uint32_t>(l), size());
+        current = found.front();
+        selectNeighbors(found, m_);
+        connect(row, static_cast<uint32_t>(l), found);
+    }
+
+    if (level > maxLevel_) {
+        maxLevel_ = level;
+        entry_ = row;
+    }
+}
+
+void HnswBuilder::seed(const HnswGraphView& graph, const std::vector<uint32_t>& remap) {
+    uint32_t survivors = 0;
+    for (uint32_t row : remap) {
+        if (row != kInvalidRow) {
+            survivors = std::max(survivors, row + 1);
+        }
+    }
+
+    levels_.assign(survivors, 0);
+    level0_.assign(static_cast<size_t>(survivors) * (m0_ + 1), 0);
+    upper_.assign(survivors, std::vector<uint32_t>());
+
+    std::vector<uint32_t> damaged;
+    for (uint32_t old = 0; old < graph.count; ++old) {
+        uint32_t node = remap[old];
+        if (node == kInvalidRow) {
+            continue;
+        }
+        uint8_t level = graph.levels[old];
+        levels_[node] = level;
+        upper_[node].assign(static_cast<size_t>(level) * (m_ + 1), 0);
+
+        for (uint32_t l = 0; l <= level; ++l) {
+            const uint32_t* src = graph.neighbors(old, l);
+            uint32_t* dst = links(node, l);
+            uint32_t cap = l == 0 ? m0_ : m_;
+            uint32_t degree = 0;
+            for (uint32_t i = 1; i <= src[0]; ++i) {
+                uint32_t mapped = remap[src[i]];
+                if (mapped != kInvalidRow && degree < cap) {
+                    dst[++degree] = mapped;
+                }
+            }
+            dst[0] = degree;
+            if (l == 0 && degree < src[0] && degree < m_) {
+                damaged.push_back(node);
+            }
+        }
+
+        if (entry_ == kInvalidRow || level > maxLevel_) {
+            entry_ = node;
+            maxLevel_ = level;
+        }
+    }
+
+    if (graph.entryPoint != kInvalidRow && graph.entryPoint < remap.size() &&
+        remap[graph.entryPoint] != kInvalidRow) {
+        entry_ = remap[graph.entryPoint];
+        maxLevel_ = levels_[entry_];
+    }
+
+    for (uint32_t node : damaged) {
+        repair(node);
+    }
+}
+
+void HnswBuilder::repair(uint32_t node) {
+    // Re-link a node that lost too many level-0 neighbours to deletions
+    if (node == entry_) {
+        return;
+    }
+    const float* query = vectors_ + static_cast<size_t>(node) * dim_;
+    auto distanceTo = [this, query](uint32_t other) {
+        return vectorDistance(metric_, query, vectors_ + static_cast<size_t>(other) * dim_, dim_);
+    };
+
+    SearchHit current{entry_, distanceTo(entry_)};
+    for (uint32_t l = maxLevel_; l > 0; --l) {
+        current = greedyClosest(*this, distanceTo, current, l);
+    }
+    std::vector<SearchHit> found = searchLayer(*this, distanceTo, current, efConstruction_, 0, size());
+
+    const uint32_t* list = links(node, 0);
+    for (uint32_t i = 1; i <= list[0]; ++i) {
+        found.push_back({list[i], distanceTo(list[i])});
+    }
+    std::sort(found.begin(), found.end(), byDistance);
+    found.erase(std::unique(found.begin(), found.end(),
+                            [](const SearchHit& a, const SearchHit& b) { return a.row == b.row; }),
+                found.end());
+    found.erase(std::remove_if(found.begin(), found.end(), [node](const SearchHit& h) { return h.row == node; }),
+                found.end());
+    selectNeighbors(found, m_);
+    connect(node, 0, found);
+}
+
+void HnswBuilder::flattenUpper(std::vector<uint64_t>& offsets, std::vector<uint32_t>& upper) const {
+    offsets.assign(upper_.size() + 1, 0);
+    size_t total = 0;
+    for (size_t i = 0; i < upper_.size(); ++i) {
+        total += upper_[i].size();
+        offsets[i + 1] = total;
+    }
+    upper.clear();
+    upper.reserve(total);
+    for (const std::vector<uint32_t>& lists : upper_) {
+        upper.insert(upper.end(), lists.begin(), lists.end());
+    }
+}
+
+namespace {
+
+template <typename DistanceFn>
+std::vector<SearchHit> searchGraph(const HnswGraphView& graph, DistanceFn distanceTo, size_t k, size_t ef,
+                                   RowFilterFn filter, const void* filterContext) {
+    if (graph.empty() || k == 0) {
+        return {};
+    }
+
+    SearchHit current{graph.entryPoint, distanceTo(graph.entryPoint)};
+    for (uint32_t l = graph.maxLevel; l > 0; --l) {
+        current = greedyClosest(graph, distanceTo, current, l);
+    }
+
+    std::vector<SearchHit> hits;
+    if (filter) {
+        auto allowed = [filter, filterContext](uint32_t node) { return filter(filterContext, node); };
+        hits = searchLayer(graph, distanceTo, current, std::max(ef, k), 0, graph.count, allowed);
+    } else {
+        hits = searchLayer(graph, distanceTo, current, std::max(ef, k), 0, graph.count);
+    }
+    if (hits.size() > k) {
+        hits.resize(k);
+    }
+    return hits;
+}
+
+} // namespace
+
+std::vector<SearchHit> hnswSearch(const HnswGraphView& graph, DistanceMetric metric, const float* vectors,
+                                  uint32_t dim, const float* query, size_t k, size_t ef, RowFilterFn filter,
+                                  const void* filterContext) {
+    auto distanceTo = [metric, vectors, dim, query](uint32_t node) {
+        return vectorDistance(metric, query, vectors + static_cast<size_t>(node) * dim, dim);
+    };
+    return searchGraph(graph, distanceTo, k, ef, filter, filterContext);
+}
+
+std::vector<SearchHit> hnswSearch(const HnswGraphView& graph, RowDistanceFn distance, const void* context,
+                                  size_t k, size_t ef, RowFilterFn filter, const void* filterContext) {
+    auto distanceTo = [distance, context](uint32_t node) { return distance(context, node); };
+    return searchGraph(graph, distanceTo, k, ef, filter, filterContext);
+}
@@ -0,0 +1,1162 @@
+#include "html_to_markdown.h"
+#include "unicode_util.h"
+#include <algorithm>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const size_t kNeedMore = static_cast<size_t>(-1);
+const size_t kMaxEntityBytes = 32;
+const size_t kMaxAttributeBytes = 2048;
+
+enum Kind : uint8_t {
+    kOther,
+    kLink,
+    kStrong,
+    kEmphasis,
+    kCode,
+    kPre,
+    kHeading,
+    kParagraph,
+    kBlock,
+    kBreak,
+    kRule,
+    kImage,
+    kUnordered,
+    kOrdered,
+    kItem,
+    kQuote,
+    kTable,
+    kRow,
+    kCell,
+    kRaw,     // Contents are raw text up to the end tag, and dropped
+    kSkip     // Contents are parsed but dropped
+};
+
+struct TagInfo {
+    const char* name;
+    Kind kind;
+};
+
+// Sorted by name; a tag's id is its index here (0 is reserved for unknown tags)
+const TagInfo kTags[] = {
+    {"", kOther},           {"a", kLink},          {"address", kBlock},   {"article", kBlock},
+    {"aside", kBlock},      {"b", kStrong},        {"blockquote", kQuote}, {"br", kBreak},
+    {"canvas", kSkip},      {"caption", kBlock},   {"code", kCode},       {"dd", kBlock},
+    {"details", kBlock},    {"div", kBlock},       {"dl", kBlock},        {"dt", kBlock},
+    {"em", kEmphasis},      {"figcaption", kBlock}, {"figure", kBlock},   {"footer", kBlock},
+    {"form", kBlock},       {"h1", kHeading},      {"h2", kHeading},      {"h3", kHeading},
+    {"h4", kHeading},       {"h5", kHeading},      {"h6", kHeading},      {"header", kBlock},
+    {"hr", kRule},          {"i", kEmphasis},      {"iframe", kRaw},      {"img", kImage},
+    {"kbd", kCode},         {"li", kItem},         {"main", kBlock},      {"math", kSkip},
+    {"nav", kBlock},        {"noembed", kRaw},     {"noframes", kRaw},    {"noscript", kSkip},
+    {"object", kSkip},      {"ol", kOrdered},      {"p", kParagraph},     {"pre", kPre},
+    {"samp", kCode},        {"script", kRaw},      {"section", kBlock},   {"select", kSkip},
+    {"strong", kStrong},    {"style", kRaw},       {"summary", kBlock},   {"svg", kSkip},
+    {"table", kTable},      {"td", kCell},         {"template", kSkip},   {"textarea", kRaw},
+    {"th", kCell},          {"title", kRaw},       {"tr", kRow},          {"tt", kCode},
+    {"ul", kUnordered},     {"xmp", kRaw},
+};
+
+struct Entity {
+    const char* name;
+    uint32_t codePoint;
+};
+
+// Sorted by name
+const Entity kEntities[] = {
+    {"amp", '&'},       {"apos", '\''},     {"bull", 0x2022},   {"cent", 0xA2},     {"copy", 0xA9},
+    {"deg", 0xB0},      {"divide", 0xF7},   {"euro", 0x20AC},   {"gt", '>'},        {"hellip", 0x2026},
+    {"laquo", 0xAB},    {"larr", 0x2190},   {"ldquo", 0x201C},  {"lsquo", 0x2018},  {"lt", '<'},
+    {"mdash", 0x2014},  {"middot", 0xB7},   {"nbsp", ' '},      {"ndash", 0x2013},  {"para", 0xB6},
+    {"pound", 0xA3},    {"quot", '"'},      {"raquo", 0xBB},    {"rarr", 0x2192},   {"rdquo", 0x201D},
+    {"reg", 0xAE},      {"rsquo", 0x2019},  {"sect", 0xA7},     {"shy", 0},         {"thinsp", ' '},
+    {"times", 0xD7},    {"trade", 0x2122},  {"yen", 0xA5},      {"zwj", 0},         {"zwnj", 0},
+};
+
+// Would start a heading, quote, list item, thematic break, setext underline or fence at the start of a line
+inline bool isBlockMarker(char c) {
+    return c == '#' || c == '>' || c == '-' || c == '+' || c == '=' || c == '~';
+}
+
+// Would open emphasis, a link or code anywhere in text
+inline bool isInlineMarker(char c) {
+    return c == '\\' || c == '`' || c == '*' || c == '_' || c == '[' || c == ']';
+}
+
+inline bool isHtmlSpace(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+inline bool isAsciiAlpha(char c) {
+    return (c | 0x20) >= 'a' && (c | 0x20) <= 'z';
+}
+
+inline char asciiLower(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c + 32) : c;
+}
+
+uint8_t lookupTag(std::string_view name) {
+    const TagInfo* it = std::lower_bound(std::begin(kTags) + 1, std::end(kTags), name,
+                                         [](const TagInfo& t, std::string_view n) { return n.compare(t.name) > 0; });
+    return it != std::end(kTags) && name == it->name ? static_cast<uint8_t>(it - kTags) : 0;
+}
+
+// Decodes an entity name (without & and ;) into UTF-8; -1 when unknown
+int decodeEntity(std::string_view name, char* out) {
+    uint32_t cp;
+    if (!name.empty() && name[0] == '#') {
+        const bool hex = name.size() > 1 && (name[1] == 'x' || name[1] == 'X');
+        size_t i = hex ? 2 : 1;
+        if (i == name.size()) {
+            return -1;
+        }
+        cp = 0;
+        for (; i < name.size(); ++i) {
+            const char c = asciiLower(name[i]);
+            uint32_t digit;
+            if (c >= '0' && c <= '9') {
+                digit = c - '0';
+            } else if (hex && c >= 'a' && c <= 'f') {
+                digit = c - 'a' + 10;
+            } else {
+                return -1;
+            }
+            cp = std::min<uint32_t>(cp * (hex ? 16 : 10) + digit, 0x110000);
+        }
+        if (cp == 0 || cp >= 0x110000 || (cp >= 0xD800 && cp <= 0xDFFF)) {
+            cp = 0xFFFD;
+        }
+    } else {
+        const Entity* it = std::lower_bound(std::begin(kEntities), std::end(kEntities), name,
+                                            [](const Entity& e, std::string_view n) { return n.compare(e.name) > 0; });
+        if (it == std::end(kEntities) || name != it->name) {
+            return -1;
+        }
+        cp = it->codePoint;
+        if (cp == 0) {
+            return 0;
+        }
+    }
+    return static_cast<int>(encodeUtf8(cp, out));
+}
+
+// Appends an attribute value with entities decoded
+void appendDecoded(std::string_view value, std::string& out) {
+    size_t pos = 0;
+    while (pos < value.size()) {
+        const size_t amp = value.find('&', pos);
+        out.append(value.data() + pos, std::min(amp, value.size()) - pos);
+        if (amp == std::string_view::npos) {
+            return;
+        }
+        const size_t semicolon = value.find(';', amp);
+        char decoded[4];
+        int length;
+        if (semicolon != std::string_view::npos && semicolon - amp <= kMaxEntityBytes &&
+            (length = decodeEntity(value.substr(amp + 1, semicolon - amp - 1), decoded)) >= 0) {
+            out.append(decoded, length);
+            pos = semicolon + 1;
+        } else {
+            out.push_back('&');
+            pos = amp + 1;
+        }
+    }
+}
+
+// Finds an attribute in the text after the tag name; false when absent
+bool findAttribute(std::string_view attributes, std::string_view name, std::string& value) {
+    size_t i = 0;
+    const size_t n = attributes.size();
+    while (i < n) {
+        while (i < n && (isHtmlSpace(attributes[i]) || attributes[i] == '/')) {
+            ++i;
+        }
+        const size_t nameStart = i;
+        while (i < n && !isHtmlSpace(attributes[i]) && attributes[i] != '=' && attributes[i] != '/') {
+            ++i;
+        }
+        const std::string_view attribute = attributes.substr(nameStart, i - nameStart);
+        while (i < n && isHtmlSpace(attributes[i])) {
+            ++i;
+        }
+        std::string_view raw;
+        if (i < n && attributes[i] == '=') {
+            ++i;
+            while (i < n && isHtmlSpace(attributes[i])) {
+                ++i;
+            }
+            if (i < n && (attributes[i] == '"' || attributes[i] == '\'')) {
+                const size_t close = attributes.find(attributes[i], i + 1);
+                const size_t end = close == std::string_view::npos ? n : close;
+                raw = attributes.substr(i + 1, end - i - 1);
+                i = end + 1;
+            } else {
+                const size_t start = i;
+                while (i < n && !isHtmlSpace(attributes[i])) {
+                    ++i;
+                }
+                raw = attributes.substr(start, i - start);
+            }
+        }
+        if (attribute.size() == name.size() &&
+            std::equal(attribute.begin(), attribute.end(), name.begin(),
+                       [](char a, char b) { return asciiLower(a) == b; })) {
+            value.clear();
+            if (raw.size() > kMaxAttributeBytes) {
+                return false;
+            }
+            appendDecoded(raw, value);
+            return true;
+        }
+        if (attribute.empty() && i < n) {
+            ++i;
+        }
+    }
+    return false;
+}
+
+bool startsWithNoCase(std::string_view text, std::string_view prefix) {
+    return text.size() >= prefix.size() &&
+           std::equal(prefix.begin(), prefix.end(), text.begin(), [](char a, char b) { return a == asciiLower(b); });
+}
+
+// Image alt text on one line, with brackets and other inline markup escaped
+void appendAltText(std::string& out, std::string_view alt, bool cell) {
+    for (char c : alt) {
+        if (isHtmlSpace(c)) {
+            c = ' ';
+        } else if (isInlineMarker(c) || (cell && c == '|')) {
+            out.push_back('\\');
+        }
+        out.push_back(c);
+    }
+}
+
+// A link destination Markdown reads back whole: parentheses, angle brackets
+// and backslashes escaped, whitespace and control bytes percent-encoded
+void appendDestination(std::string& out, std::string_view url, bool cell) {
+    static const char kHex[] = "0123456789ABCDEF";
+    for (const char c : url) {
+        const unsigned char u = static_cast<unsigned char>(c);
+        if (u <= ' ' || u == 0x7F) {
+            out.push_back('%');
+            out.push_back(kHex[u >> 4]);
+            out.push_back(kHex[u & 15]);
+            continue;
+        }
+        if (c == '(' || c == ')' || c == '<' || c == '>' || c == '\\' || (cell && c == '|')) {
+            out.push_back('\\');
+        }
+        out.push_back(c);
+    }
+}
+
+// Offset of the first byte a text run cannot be copied past: '<', '&',
+// whitespace other than a single space, or a newline inside <pre>
+typedef size_t (*SpecialKernel)(const char* p, size_t n);
+
+size_t scalarFindSpecial(const char* p, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        const char c = p[i];
+        if (c == '<' || c == '&' || (c >= '\t' && c <= '\r') || (c == ' ' && i + 1 < n && p[i + 1] == ' ')) {
+            return i;
+        }
+    }
+    return n;
+}
+
+size_t scalarFindPreSpecial(const char* p, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (p[i] == '<' || p[i] == '&' || p[i] == '\n') {
+            return i;
+        }
+    }
+    return n;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("avx2,bmi"))) size_t avx2FindSpecial(const char* p, size_t n) {
+    const __m256i lt = _mm256_set1_epi8('<');
+    const __m256i amp = _mm256_set1_epi8('&');
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    size_t i = 0;
+    for (; i + 33 <= n; i += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + 1));
+        // \t..\r: unsigned range test via min/max
+        __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(_mm256_max_epu8(bytes, tab), cr), bytes);
+        __m256i doubleSpace = _mm256_and_si256(_mm256_cmpeq_epi8(bytes, space), _mm256_cmpeq_epi8(next, space));
+        __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, lt), _mm256_cmpeq_epi8(bytes, amp)),
+                                       _mm256_or_si256(control, doubleSpace));
+        const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+        if (mask != 0) {
+            return i + _tzcnt_u32(mask);
+        }
+    }
+    return i + scalarFindSpecial(p + i, n - i);
+}
+
+__attribute__((target("avx2,bmi"))) size_t avx2FindPreSpecial(const char* p, size_t n) {
+    const __m256i lt = _mm256_set1_epi8('<');
+    const __m256i amp = _mm256_set1_epi8('&');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, lt), _mm256_cmpeq_epi8(bytes, amp)),
+                                       _mm256_cmpeq_epi8(bytes, newline));
+        const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+        if (mask != 0) {
+            return i + _tzcnt_u32(mask);
+        }
+    }
+    return i + scalarFindPreSpecial(p + i, n - i);
+}
+
+bool hasAvx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi");
+}
+
+const bool kAvx2 = hasAvx2();
+const SpecialKernel kFindSpecial = kAvx2 ? avx2FindSpecial : scalarFindSpecial;
+const SpecialKernel kFindPreSpecial = kAvx2 ? avx2FindPreSpecial : scalarFindPreSpecial;
+
+#else
+
+const SpecialKernel kFindSpecial = scalarFindSpecial;
+const SpecialKernel kFindPreSpecial = scalarFindPreSpecial;
+
+#endif
+
+} // namespace
+
+HtmlToMarkdown::HtmlToMarkdown() : out_(nullptr) {
+    reset();
+}
+
+void HtmlToMarkdown::reset() {
+    buffer_.clear();
+    mode_ = kText;
+    rawTag_ = 0;
+    stack_.clear();
+    hrefs_.clear();
+    tables_.clear();
+    skipDepth_ = 0;
+    linkDepth_ = 0;
+    quoteDepth_ = 0;
+    listDepth_ = 0;
+    itemDepth_ = 0;
+    headingDepth_ = 0;
+    preDepth_ = 0;
+    hasOutput_ = false;
+    trailingNewlines_ = 0;
+    pendingBreaks_ = 0;
+    pendingSpace_ = false;
+    skipPreNewline_ = false;
+    lineDigits_ = false;
+    linkOpened_ = false;
+    pendingMarker_.clear();
+    codeOpen_ = false;
+    codeSpaceBefore_ = false;
+    codeText_.clear();
+}
+
+void HtmlToMarkdown::convert(std::string_view html, std::string& markdown) {
+    reset();
+    markdown.clear();
+    markdown.reserve(html.size() / 2);
+    out_ = &markdown;
+    process(html, true);
+    finish(markdown);
+}
+
+void HtmlToMarkdown::feed(std::string_view html, std::string& markdown) {
+    out_ = &markdown;
+    if (buffer_.empty()) {
+        // Common case: nothing carried over, so only the unfinished tail is copied
+        const size_t consumed = process(html, false);
+        buffer_.assign(html.data() + consumed, html.size() - consumed);
+        return;
+    }
+    buffer_.append(html.data(), html.size());
+    const size_t consumed = process(buffer_, false);
+    buffer_.erase(0, consumed);
+}
+
+void HtmlToMarkdown::finish(std::string& markdown) {
+    out_ = &markdown;
+    if (!buffer_.empty()) {
+        std::string rest;
+        rest.swap(buffer_);
+        process(rest, true);
+    }
+    // Close whatever is still open, so fences and tables are terminated
+    while (!stack_.empty()) {
+        popElement();
+    }
+    reset();
+}
+
+size_t HtmlToMarkdown::process(std::string_view html, bool final) {
+    const char* p = html.data();
+    const size_t n = html.size();
+    size_t pos = 0;
+    while (pos < n) {
+        switch (mode_) {
+        case kRawText: {
+            // Dropped until </name, which is then parsed as a normal tag
+            const std::string_view name = kTags[rawTag_].name;
+            const void* lt = std::memchr(p + pos, '<', n - pos);
+            if (!lt) {
+                return n;
+            }
+            pos = static_cast<const char*>(lt) - p;
+            if (n - pos < name.size() + 3) {
+                if (!final) {
+                    return pos;
+                }
+                return n;
+            }
+            if (p[pos + 1] == '/' && startsWithNoCase(html.substr(pos + 2), name) &&
+                (isHtmlSpace(p[pos + 2 + name.size()]) || p[pos + 2 + name.size()] == '>' ||
+                 p[pos + 2 + name.size()] == '/')) {
+                mode_ = kText;
+            } else {
+                ++pos;
+            }
+            continue;
+        }
+        case kComment: {
+            const size_t end = html.find("-->", pos);
+            if (end == std::string_view::npos) {
+                // Keep "--" that may start the terminator
+                return final ? n : std::max(pos, n - 2);
+            }
+            pos = end + 3;
+            mode_ = kText;
+            continue;
+        }
+        case kSkipTag: {
+            const void* gt = std::memchr(p + pos, '>', n - pos);
+            if (!gt) {
+                return n;
+            }
+            pos = static_cast<const char*>(gt) - p + 1;
+            mode_ = kText;
+            continue;
+        }
+        case kText:
+            break;
+        }
+
+        const size_t special = pos + (preDepth_ > 0 ? kFindPreSpecial : kFindSpecial)(p + pos, n - pos);
+        if (special > pos) {
+            writeText(p + pos, special - pos);
+        }
+        pos = special;
+        if (pos >= n) {
+            break;
+        }
+
+        const char c = p[pos];
+        if (c == '<') {
+            const size_t next = parseTag(html, pos, final);
+            if (next == kNeedMore) {
+                return pos;
+            }
+            pos = next;
+        } else if (c == '&') {
+            const size_t next = parseEntity(html, pos, final);
+            if (next == kNeedMore) {
+                return pos;
+            }
+            pos = next;
+        } else if (preDepth_ > 0) {
+            if (skipPreNewline_) {
+                skipPreNewline_ = false;
+            } else {
+                writePreNewline();
+            }
+            ++pos;
+        } else {
+            while (pos < n && isHtmlSpace(p[pos])) {
+                ++pos;
+            }
+            pendingSpace_ = true;
+        }
+    }
+    return n;
+}
+
+size_t HtmlToMarkdown::parseEntity(std::string_view html, size_t pos, bool final) {
+    size_t end = pos + 1;
+    while (end < html.size() && end - pos <= kMaxEntityBytes &&
+           (isAsciiAlpha(html[end]) || (html[end] >= '0' && html[end] <= '9') || html[end] == '#')) {
+        ++end;
+    }
+    if (end >= html.size() && !final && end - pos <= kMaxEntityBytes) {
+        return kNeedMore;
+    }
+    char decoded[4];
+    int length;
+    if (end < html.size() && html[end] == ';' &&
+        (length = decodeEntity(html.substr(pos + 1, end - pos - 1), decoded)) >= 0) {
+        skipPreNewline_ = false;
+        writeText(decoded, length);
+        return end + 1;
+    }
+    writeText("&", 1);
+    return pos + 1;
+}
+
+size_t HtmlToMarkdown::parseTag(std::string_view html, size_t pos, bool final) {
+    const char* p = html.data();
+    const size_t n = html.size();
+    if (n - pos < 4 && !final) {
+        return kNeedMore;
+    }
+    size_t i = pos + 1;
+    if (i < n && (p[i] == '!' || p[i] == '?')) {
+        if (html.compare(pos, 4, "<!--") == 0) {
+            mode_ = kComment;
+            return pos + 4;
+        }
+        // Doctype, CDATA and processing instructions
+        mode_ = kSkipTag;
+        return pos + 2;
+    }
+    const bool closing = i < n && p[i] == '/';
+    if (closing) {
+        ++i;
+    }
+    if (i >= n || !isAsciiAlpha(p[i])) {
+        writeText("<", 1);
+        return pos + 1;
+    }
+
+    // Tag end: the first '>' outside a quoted attribute value
+    size_t end = n;
+    const void* gt = std::memchr(p + i, '>', n - i);
+    if (gt) {
+        end = static_cast<const char*>(gt) - p;
+        if (std::memchr(p + i, '"', end - i) || std::memchr(p + i, '\'', end - i)) {
+            char quote = 0;
+            char previous = 0;
+            for (end = i; end < n; ++end) {
+                const char c = p[end];
+                if (quote) {
+                    if (c == quote) {
+                        quote = 0;
+                    }
+                } else if (c == '>') {
+                    break;
+                } else if ((c == '"' || c == '\'') && previous == '=') {
+                    quote = c;
+                }
+                if (!isHtmlSpace(c)) {
+                    previous = c;
+                }
+            }
+        }
+    }
+    if (end >= n) {
+        if (final) {
+            return n;
+        }
+        if (n - pos > kMaxTagBytes) {
+            mode_ = kSkipTag;
+            return pos + 1;
+        }
+        return kNeedMore;
+    }
+
+    size_t nameEnd = i;
+    tagName_.clear();
+    while (nameEnd < end && !isHtmlSpace(p[nameEnd]) && p[nameEnd] != '/') {
+        if (tagName_.size() < 16) {
+            tagName_.push_back(asciiLower(p[nameEnd]));
+        }
+        ++nameEnd;
+    }
+    const uint8_t tag = lookupTag(tagName_);
+    skipPreNewline_ = false;
+    if (closing) {
+        closeTag(tag);
+    } else {
+        const bool selfClosing = end > nameEnd && p[end - 1] == '/';
+        openTag(tag, html.substr(nameEnd, end - nameEnd), selfClosing);
+    }
+    return end + 1;
+}
+
+void HtmlToMarkdown::openTag(uint8_t tag, std::string_view attributes, bool selfClosing) {
+    const Kind kind = kTags[tag].kind;
+    if (kind == kRaw) {
+        if (!selfClosing) {
+            mode_ = kRawText;
+            rawTag_ = tag;
+        }
+        return;
+    }
+    const bool container = kind == kLink || kind == kStrong || kind == kEmphasis || kind == kCode ||
+                           kind == kPre || kind == kHeading || kind == kUnordered || kind == kOrdered ||
+                           kind == kItem || kind == kQuote || kind == kTable || kind == kRow || kind == kCell ||
+                           kind == kSkip;
+    if (container && (selfClosing || stack_.size() >= kMaxDepth)) {
+        return;
+    }
+
+    Element element = {tag, 0};
+    switch (kind) {
+    case kLink: {
+        const bool linked = findAttribute(attributes, "href", attrValue_) && !attrValue_.empty() &&
+                            !startsWithNoCase(attrValue_, "javascript:");
+        hrefs_.emplace_back();
+        element.data = linked;
+        if (linked) {
+            appendDestination(hrefs_.back(), attrValue_, cellOpen());
+            writeOpening("[");
+            linkOpened_ = skipDepth_ == 0 && !codeOpen_;
+            ++linkDepth_;
+        }
+        break;
+    }
+    case kStrong:
+        writeOpening("**");
+        break;
+    case kEmphasis:
+        writeOpening("*");
+        break;
+    case kCode:
+        if (preDepth_ == 0 && !codeOpen_ && skipDepth_ == 0) {
+            codeOpen_ = true;
+            codeSpaceBefore_ = pendingSpace_;
+            pendingSpace_ = false;
+            element.data = 1;
+        }
+        break;
+    case kPre:
+        if (preDepth_++ == 0 && !inlineOnly()) {
+            requestBreak(2);
+            writeOpening("```");
+            if (skipDepth_ == 0) {
+                writeNewline();
+            }
+            skipPreNewline_ = true;
+        }
+        break;
+    case kHeading:
+        if (!inlineOnly()) {
+            requestBreak(2);
+            writeOpening(std::string(kTags[tag].name[1] - '0', '#'));
+            pendingSpace_ = true;
+        }
+        ++headingDepth_;
+        break;
+    case kParagraph:
+        requestBreak(2);
+        return;
+    case kBlock:
+        requestBreak(1);
+        return;
+    case kBreak:
+        if (preDepth_ > 0) {
+            writePreNewline();
+        } else {
+            requestBreak(1);
+        }
+        return;
+    case kRule:
+        if (!inlineOnly()) {
+            requestBreak(2);
+            writeOpening("---");
+            requestBreak(2);
+        }
+        return;
+    case kImage: {
+        std::string alt;
+        if (findAttribute(attributes, "src", attrValue_) && !attrValue_.empty() &&
+            !startsWithNoCase(attrValue_, "data:")) {
+            findAttribute(attributes, "alt", alt);
+            std::string markup = "![";
+            appendAltText(markup, alt, cellOpen());
+            markup += "](";
+            appendDestination(markup, attrValue_, cellOpen());
+            markup += ')';
+            writeOpening(markup);
+        }
+        return;
+    }
+    case kUnordered:
+    case kOrdered:
+        requestBreak(listDepth_ > 0 ? 1 : 2);
+        ++listDepth_;
+        element.data = 1;
+        if (kind == kOrdered && findAttribute(attributes, "start", attrValue_)) {
+            element.data = static_cast<uint32_t>(std::strtoul(attrValue_.c_str(), nullptr, 10));
+        }
+        break;
+    case kItem: {
+        // An open <li> of the same list ends here
+        for (size_t i = stack_.size(); i-- > 0;) {
+            const Kind below = kTags[stack_[i].tag].kind;
+            if (below == kItem) {
+                while (stack_.size() > i) {
+                    popElement();
+                }
+                break;
+            }
+            if (below == kUnordered || below == kOrdered) {
+                break;
+            }
+        }
+        requestBreak(1);
+        pendingMarker_ = "* ";
+        for (size_t i = stack_.size(); i-- > 0;) {
+            const Kind below = kTags[stack_[i].tag].kind;
+            if (below == kOrdered) {
+                pendingMarker_ = std::to_string(stack_[i].data++) + ". ";
+                break;
+            }
+            if (below == kUnordered) {
+                break;
+            }
+        }
+        if (inlineOnly()) {
+            pendingMarker_.clear();
+        }
+        ++itemDepth_;
+        break;
+    }
+    case kQuote:
+        requestBreak(2);
+        ++quoteDepth_;
+        break;
+    case kTable:
+        if (tables_.empty()) {
+            requestBreak(2);
+        } else {
+            pendingSpace_ = true;
+        }
+        tables_.push_back({0, 0, false, false});
+        break;
+    case kRow:
+    case kCell: {
+        if (tables_.empty()) {
+            return;
+        }
+        // End the open cell (and for a row, the open row) of this table
+        for (size_t i = stack_.size(); i-- > 0;) {
+            const Kind below = kTags[stack_[i].tag].kind;
+            if (below == kTable || (kind == kCell && below == kRow)) {
+                break;
+            }
+            if (below == kCell || below == kRow) {
+                while (stack_.size() > i) {
+                    popElement();
+                }
+                break;
+            }
+        }
+        if (tables_.size() > 1 || linkDepth_ > 0) {
+            pendingSpace_ = true;
+            break;
+        }
+        Table& table = tables_.back();
+        if (kind == kRow || !table.rowOpen) {
+            closeRow();
+            requestBreak(1);
+            writeOpening("|");
+            table.rowOpen = true;
+            table.cells = 0;
+        }
+        if (kind == kCell) {
+            table.cellOpen = true;
+            ++table.cells;
+            pendingSpace_ = true;
+        }
+        break;
+    }
+    case kSkip:
+        ++skipDepth_;
+        break;
+    default:
+        return;
+    }
+    stack_.push_back(element);
+}
+
+void HtmlToMarkdown::closeTag(uint8_t tag) {
+    const Kind kind = kTags[tag].kind;
+    if (kind == kParagraph) {
+        requestBreak(2);
+        return;
+    }
+    if (kind == kBlock) {
+        requestBreak(1);
+        return;
+    }
+    if (tag == 0) {
+        return;
+    }
+    for (size_t i = stack_.size(); i-- > 0;) {
+        if (stack_[i].tag == tag) {
+            while (stack_.size() > i) {
+                popElement();
+            }
+            return;
+        }
+    }
+}
+
+void HtmlToMarkdown::popElement() {
+    const Element element = stack_.back();
+    stack_.pop_back();
+    switch (kTags[element.tag].kind) {
+    case kLink:
+        if (element.data) {
+            writeClosing("](" + hrefs_.back() + ")");
+            linkOpened_ = false;
+            --linkDepth_;
+        }
+        hrefs_.pop_back();
+        break;
+    case kStrong:
+        writeClosing("**");
+        break;
+    case kEmphasis:
+        writeClosing("*");
+        break;
+    case kCode:
+        if (element.data && codeOpen_) {
+            flushCode();
+        }
+        break;
+    case kPre:
+        if (--preDepth_ == 0 && !inlineOnly()) {
+            skipPreNewline_ = false;
+            if (skipDepth_ == 0) {
+                if (trailingNewlines_ == 0) {
+                    writeNewline();
+                }
+                writePrefix(false);
+                out_->append("```");
+                trailingNewlines_ = 0;
+            }
+            requestBreak(2);
+        }
+        break;
+    case kHeading:
+        --headingDepth_;
+        requestBreak(2);
+        break;
+    case kUnordered:
+    case kOrdered:
+        --listDepth_;
+        requestBreak(listDepth_ > 0 ? 1 : 2);
+        break;
+    case kItem:
+        --itemDepth_;
+        pendingMarker_.clear();
+        requestBreak(1);
+        break;
+    case kQuote:
+        --quoteDepth_;
+        requestBreak(2);
+        break;
+    case kTable:
+        if (tables_.size() == 1) {
+            closeRow();
+            tables_.pop_back();
+            requestBreak(2);
+        } else {
+            tables_.pop_back();
+            pendingSpace_ = true;
+        }
+        break;
+    case kRow:
+        if (tables_.size() == 1) {
+            closeRow();
+        }
+        break;
+    case kCell:
+        if (tables_.size() == 1) {
+            closeCell();
+        }
+        break;
+    case kSkip:
+        --skipDepth_;
+        break;
+    default:
+        break;
+    }
+}
+
+void HtmlToMarkdown::closeCell() {
+    Table& table = tables_.back();
+    if (table.cellOpen) {
+        table.cellOpen = false;
+        pendingSpace_ = false;
+        writeClosing(" |");
+    }
+}
+
+void HtmlToMarkdown::closeRow() {
+    closeCell();
+    Table& table = tables_.back();
+    if (!table.rowOpen) {
+        return;
+    }
+    table.rowOpen = false;
+    if (++table.rows == 1 && skipDepth_ == 0) {
+        // Markdown tables need a delimiter row under the first one
+        writeNewline();
+        writePrefix(false);
+        out_->push_back('|');
+        for (size_t c = 0; c < std::max<size_t>(table.cells, 1); ++c) {
+            out_->append(" --- |");
+        }
+        trailingNewlines_ = 0;
+    }
+    requestBreak(1);
+}
+
+void HtmlToMarkdown::requestBreak(size_t lines) {
+    if (skipDepth_ > 0) {
+        return;
+    }
+    if (inlineOnly()) {
+        pendingSpace_ = true;
+        return;
+    }
+    pendingBreaks_ = std::max(pendingBreaks_, lines);
+    pendingSpace_ = false;
+}
+
+bool HtmlToMarkdown::beginContent() {
+    if (skipDepth_ > 0) {
+        return false;
+    }
+    if (pendingBreaks_ > 0) {
+        if (hasOutput_) {
+            while (trailingNewlines_ < pendingBreaks_) {
+                if (trailingNewlines_ > 0 && quoteDepth_ > 0) {
+                    // Blank lines inside a quote keep its markers
+                    out_->append(quoteDepth_, '>');
+                }
+                out_->push_back('\n');
+                ++trailingNewlines_;
+            }
+        }
+        pendingBreaks_ = 0;
+        pendingSpace_ = false;
+    }
+    if (!hasOutput_ || trailingNewlines_ > 0) {
+        writePrefix(!pendingMarker_.empty());
+        lineDigits_ = false;
+    } else if (pendingSpace_ && !linkOpened_) {
+        out_->push_back(' ');
+        lineDigits_ = false;
+    }
+    pendingSpace_ = false;
+    linkOpened_ = false;
+    hasOutput_ = true;
+    trailingNewlines_ = 0;
+    return true;
+}
+
+void HtmlToMarkdown::writePrefix(bool marker) {
+    for (size_t q = 0; q < quoteDepth_; ++q) {
+        out_->append("> ");
+    }
+    if (itemDepth_ > 0 && listDepth_ > 0) {
+        out_->append(2 * (marker ? listDepth_ - 1 : listDepth_), ' ');
+    }
+    if (marker) {
+        out_->append(pendingMarker_);
+        pendingMarker_.clear();
+    }
+    hasOutput_ = true;
+}
+
+void HtmlToMarkdown::writeText(const char* p, size_t n) {
+    if (skipDepth_ > 0) {
+        return;
+    }
+    if (codeOpen_) {
+        appendCode(p, n);
+        return;
+    }
+    if (preDepth_ > 0) {
+        if (skipPreNewline_) {
+            skipPreNewline_ = false;
+        }
+        if (pendingBreaks_ > 0 || !hasOutput_) {
+            beginContent();
+        } else if (trailingNewlines_ > 0) {
+            writePrefix(false);
+            trailingNewlines_ = 0;
+        }
+        out_->append(p, n);
+        return;
+    }
+
+    // Runs hold single spaces only; one at either end is collapsed with its neighbours
+    if (n > 0 && p[0] == ' ') {
+        pendingSpace_ = true;
+        ++p;
+        --n;
+    }
+    const bool trailing = n > 0 && p[n - 1] == ' ';
+    if (trailing) {
+        --n;
+    }
+    if (n > 0) {
+        const bool lineStart = !hasOutput_ || trailingNewlines_ > 0 || pendingBreaks_ > 0;
+        beginContent();
+        writeEscaped(p, n, lineStart);
+    }
+    if (trailing) {
+        pendingSpace_ = true;
+    }
+}
+
+// Backslash-escapes what Markdown would read as markup rather than text
+void HtmlToMarkdown::writeEscaped(const char* p, size_t n, bool lineStart) {
+    size_t i = 0;
+    if (lineStart && isBlockMarker(p[0])) {
+        out_->push_back('\\');
+        out_->push_back(p[0]);
+        i = 1;
+    } else if (lineStart) {
+        lineDigits_ = p[0] >= '0' && p[0] <= '9';
+    }
+    const bool cell = cellOpen();
+    size_t from = i;
+    for (; i < n; ++i) {
+        const char c = p[i];
+        bool escape = isInlineMarker(c) || (cell && c == '|');
+        if (lineDigits_ && (c < '0' || c > '9')) {
+            escape = escape || c == '.' || c == ')';
+            lineDigits_ = false;
+        }
+        if (escape) {
+            out_->append(p + from, i - from);
+            out_->push_back('\\');
+            from = i;
+        }
+    }
+    out_->append(p + from, n - from);
+}
+
+// Inline code keeps its text as is; single spaces at either end fall outside it
+void HtmlToMarkdown::appendCode(const char* p, size_t n) {
+    if (preDepth_ == 0) {
+        if (n > 0 && p[0] == ' ') {
+            pendingSpace_ = true;
+            ++p;
+            --n;
+        }
+        if (n == 0) {
+            return;
+        }
+        if (pendingSpace_ && !codeText_.empty()) {
+            codeText_.push_back(' ');
+        }
+        pendingSpace_ = p[n - 1] == ' ';
+        n -= pendingSpace_;
+    }
+    const size_t start = codeText_.size();
+    codeText_.append(p, n);
+    // A line break inside <pre> in a code span would end the span's line
+    std::replace(codeText_.begin() + start, codeText_.end(), '\n', ' ');
+    if (codeText_.size() > kMaxCodeBytes) {
+        flushCode();
+    }
+}
+
+// Writes the held code span fenced with one backtick more than its longest run
+void HtmlToMarkdown::flushCode() {
+    const bool spaceAfter = pendingSpace_;
+    codeOpen_ = false;
+    if (!codeText_.empty()) {
+        size_t longest = 0;
+        size_t run = 0;
+        for (char c : codeText_) {
+            run = c == '`' ? run + 1 : 0;
+            longest = std::max(longest, run);
+        }
+        const std::string fence(longest + 1, '`');
+        const bool pad = codeText_.front() == '`' || codeText_.back() == '`';
+        pendingSpace_ = codeSpaceBefore_;
+        beginContent();
+        out_->append(fence);
+        if (pad) {
+            out_->push_back(' ');
+        }
+        if (cellOpen()) {
+            for (char c : codeText_) {
+                if (c == '|') {
+                    out_->push_back('\\');
+                }
+                out_->push_back(c);
+            }
+        } else {
+            out_->append(codeText_);
+        }
+        if (pad) {
+            out_->push_back(' ');
+        }
+        out_->append(fence);
+        lineDigits_ = false;
+    } else if (codeSpaceBefore_) {
+        pendingSpace_ = true;
+    }
+    pendingSpace_ = pendingSpace_ || spaceAfter;
+    codeText_.clear();
+}
+
+void HtmlToMarkdown::writeOpening(std::string_view markup) {
+    if (codeOpen_) {
+        // Markup inside inline code would show literally
+        return;
+    }
+    if (beginContent()) {
+        out_->append(markup.data(), markup.size());
+        lineDigits_ = false;
+    }
+}
+
+void HtmlToMarkdown::writeClosing(std::string_view markup) {
+    // Attached to the text before it; a pending space stays pending
+    if (skipDepth_ == 0 && hasOutput_ && !codeOpen_) {
+        out_->append(markup.data(), markup.size());
+        trailingNewlines_ = 0;
+        lineDigits_ = false;
+    }
+}
+
+void HtmlToMarkdown::writeNewline() {
+    out_->push_back('\n');
+    ++trailingNewlines_;
+    hasOutput_ = true;
+}
+
+void HtmlToMarkdown::writePreNewline() {
+    if (skipDepth_ > 0) {
+        return;
+    }
+    if (codeOpen_) {
+        appendCode("\n", 1);
+    } else {
+        writeNewline();
+    }
+}
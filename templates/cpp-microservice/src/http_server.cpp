@@ -1,5 +1,8 @@
 #include "http_server.h"
 #include "microservice.h"
+#include "json_parser.h"
+#include "json_util.h"
+#include "json_writer.h"
 #include <iostream>
 #include <thread>
 #include <chrono>
@@ -17,12 +20,18 @@ bool HttpServer::start(const std::string& host, int port) {
     std::cout << "Starting HTTP server on " << host << ":" << port << std::endl;
     
     // Register default routes
-    get("/health", [](const std::map<std::string, std::string>& params) -> std::string {
-        return "{\"status\": \"healthy\", \"service\": \"cpp-microservice\"}";
+    getJson("/health", [](const std::map<std::string, std::string>&, JsonWriter& out) {
+        out.beginObject();
+        out.member("status", "healthy");
+        out.member("service", "cpp-microservice");
+        out.endObject();
     });
     
-    get("/version", [](const std::map<std::string, std::string>& params) -> std::string {
-        return "{\"version\": \"1.0.0\", \"service\": \"cpp-microservice\"}";
+    getJson("/version", [](const std::map<std::string, std::string>&, JsonWriter& out) {
+        out.beginObject();
+        out.member("version", "1.0.0");
+        out.member("service", "cpp-microservice");
+        out.endObject();
     });
     
     running_ = true;
@@ -56,4 +65,55 @@ void HttpServer::get(const std::string& path, const RequestHandler& handler) {
 void HttpServer::post(const std::string& path, const RequestHandler& handler) {
     post_handlers_[path] = handler;
     std::cout << "Registered POST route: " << path << std::endl;
-}
\ No newline at end of file
+}
+
+void HttpServer::getJson(const std::string& path, const JsonHandler& handler) {
+    get_json_handlers_[path] = handler;
+    std::cout << "Registered GET route: " << path << std::endl;
+}
+
+void HttpServer::postJson(const std::string& path, const JsonHandler& handler) {
+    post_json_handlers_[path] = handler;
+    std::cout << "Registered POST route: " << path << std::endl;
+}
+
+void HttpServer::postBody(const std::string& path, const BodyHandler& handler) {
+    post_body_handlers_[path] = handler;
+    std::cout << "Registered POST route: " << path << std::endl;
+}
+
+std::string HttpServer::dispatch(const std::string& method, const std::string& path, std::string_view body) const {
+    BufferChain out;
+    dispatch(method, path, body, out);
+    return out.str();
+}
+
+void HttpServer::dispatch(const std::string& method, const std::string& path, std::string_view body,
+                          BufferChain& out) const {
+    const bool post = method == "POST";
+    const auto& jsonHandlers = post ? post_json_handlers_ : get_json_handlers_;
+    const auto& handlers = post ? post_handlers_ : get_handlers_;
+    auto jsonHandler = jsonHandlers.find(path);
+    auto handler = handlers.find(path);
+    auto bodyHandler = post ? post_body_handlers_.find(path) : post_body_handlers_.end();
+    if (jsonHandler == jsonHandlers.end() && handler == handlers.end() && bodyHandler == post_body_handlers_.end()) {
+        out.append("{\"error\": \"not found\"}");
+        return;
+    }
+    std::map<std::string, std::string> params;
+    std::string error;
+    if (!body.empty() && !flattenJson(body, params, &error)) {
+        std::string message = "{\"error\": ";
+        appendJsonString(message, error);
+        out.append(message + "}");
+        return;
+    }
+    if (jsonHandler != jsonHandlers.end()) {
+        JsonWriter writer(out);
+        jsonHandler->second(params, writer);
+    } else if (bodyHandler != post_body_handlers_.end()) {
+        out.append(bodyHandler->second(params, body));
+    } else {
+        out.append(handler->second(params));
+    }
+}
@@ -0,0 +1,714 @@
+#include "json_parser.h"
+#include "unicode_util.h"
+#include <charconv>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const uint32_t kNoNode = 0xFFFFFFFFu;
+const uint64_t kTopBit = 1ULL << 63;    // Keeps __builtin_ctzll defined once a mask runs out
+
+// Bitmasks of one 64-byte block, bit i for byte i
+struct BlockMasks {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t op;         // { } [ ] : ,
+    uint64_t space;      // Space, tab, newline, carriage return
+    uint64_t control;    // Bytes below 0x20
+};
+
+inline void scalarClassify(const char* block, BlockMasks& masks) {
+    masks = BlockMasks{0, 0, 0, 0, 0};
+    for (size_t i = 0; i < 64; ++i) {
+        const unsigned char c = static_cast<unsigned char>(block[i]);
+        const uint64_t bit = 1ULL << i;
+        switch (c) {
+        case '"':
+            masks.quote |= bit;
+            break;
+        case '\\':
+            masks.backslash |= bit;
+            break;
+        case '{':
+        case '}':
+        case '[':
+        case ']':
+        case ':':
+        case ',':
+            masks.op |= bit;
+            break;
+        case ' ':
+            masks.space |= bit;
+            break;
+        case '\t':
+        case '\n':
+        case '\r':
+            masks.space |= bit;
+            masks.control |= bit;
+            break;
+        default:
+            if (c < 0x20) {
+                masks.control |= bit;
+            }
+        }
+    }
+}
+
+inline uint64_t prefixXor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+// Characters escaped by a backslash: those after an odd-length run.
+// prevEscaped carries a run that ends on the block's last byte.
+inline uint64_t escapedChars(uint64_t backslash, uint64_t& prevEscaped) {
+    const uint64_t evenBits = 0x5555555555555555ULL;
+    backslash &= ~prevEscaped;
+    const uint64_t followsEscape = backslash << 1 | prevEscaped;
+    const uint64_t oddStarts = backslash & ~evenBits & ~followsEscape;
+    uint64_t evenStarts;
+    prevEscaped = __builtin_add_overflow(oddStarts, backslash, &evenStarts) ? 1 : 0;
+    const uint64_t invert = evenStarts << 1;
+    return (evenBits ^ invert) & followsEscape;
+}
+
+inline int hexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c = static_cast<char>(c | 0x20);
+    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+// The character after an escaping backslash is one of " \\ / b f n r t, or u and 4 hex digits
+inline bool validEscape(const char* json, size_t n, size_t at) {
+    if (at >= n) {
+        return false;
+    }
+    switch (json[at]) {
+    case '"':
+    case '\\':
+    case '/':
+    case 'b':
+    case 'f':
+    case 'n':
+    case 'r':
+    case 't':
+        return true;
+    case 'u':
+        return at + 4 < n && hexValue(json[at + 1]) >= 0 && hexValue(json[at + 2]) >= 0 &&
+               hexValue(json[at + 3]) >= 0 && hexValue(json[at + 4]) >= 0;
+    default:
+        return false;
+    }
+}
+
+// Stage 1 over a whole document. Writes the structural positions to out,
+// advancing it, and checks control characters and escapes in strings.
+// Returns an error message, or nullptr.
+template <void (*Classify)(const char*, BlockMasks&)>
+__attribute__((always_inline)) inline const char* indexBlocks(const char* json, size_t n, uint32_t*& out,
+                                                              size_t& errorOffset) {
+    uint64_t prevEscaped = 0;
+    uint64_t prevInString = 0;    // All ones when the previous block ended inside a string
+    uint64_t prevScalar = 0;      // 1 when the previous block ended inside a number or literal
+    char tail[64];
+    for (size_t base = 0; base < n; base += 64) {
+        const char* block = json + base;
+        if (n - base < 64) {
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, block, n - base);
+            block = tail;
+        }
+        BlockMasks m;
+        Classify(block, m);
+
+        const uint64_t escaped = escapedChars(m.backslash, prevEscaped);
+        const uint64_t quotes = m.quote & ~escaped;
+        // Set from each opening quote up to, not including, its closing quote
+        const uint64_t inString = prefixXor(quotes) ^ prevInString;
+        prevInString = static_cast<uint64_t>(static_cast<int64_t>(inString) >> 63);
+        // Control bytes outside strings are left to stage 2, which rejects them as literals
+        const uint64_t stringControl = m.control & inString;
+        if (stringControl) {
+            errorOffset = base + __builtin_ctzll(stringControl);
+            return "unescaped control character in string";
+        }
+        for (uint64_t escapes = escaped & inString; escapes; escapes &= escapes - 1) {
+            if (!validEscape(json, n, base + __builtin_ctzll(escapes))) {
+                errorOffset = base + __builtin_ctzll(escapes);
+                return "bad escape in string";
+            }
+        }
+
+        const uint64_t scalar = ~(m.op | m.space | m.quote) & ~inString;
+        const uint64_t scalarStarts = scalar & ~(scalar << 1 | prevScalar);
+        prevScalar = scalar >> 63;
+        uint64_t structural = (m.op & ~inString) | (quotes & inString) | scalarStarts;
+        // Eight positions are written unconditionally so the common case has no
+        // per-bit branch; entries past the count are overwritten by the next block
+        const uint32_t found = static_cast<uint32_t>(__builtin_popcountll(structural));
+        uint32_t* write = out;
+        for (uint32_t k = 0; k < 8; ++k) {
+            write[k] = static_cast<uint32_t>(base + __builtin_ctzll(structural | kTopBit));
+            structural &= structural - 1;
+        }
+        for (uint32_t k = 8; k < found; ++k) {
+            write[k] = static_cast<uint32_t>(base + __builtin_ctzll(structural));
+            structural &= structural - 1;
+        }
+        out += found;
+    }
+    if (prevInString) {
+        errorOffset = n;
+        return "unterminated string";
+    }
+    return nullptr;
+}
+
+typedef const char* (*IndexKernel)(const char* json, size_t n, uint32_t*& out, size_t& errorOffset);
+
+const char* scalarIndex(const char* json, size_t n, uint32_t*& out, size_t& errorOffset) {
+    return indexBlocks<scalarClassify>(json, n, out, errorOffset);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// Whitespace and structural characters are found with one table lookup each,
+// indexed by the low nibble of the byte (bytes with the top bit set look up 0).
+// The whitespace table holds, per nibble, the one whitespace byte with that
+// nibble, or a byte that never has it. The structural table holds ':' '{' ','
+// '}' and is compared with the byte OR 0x20, which folds '[' ']' onto '{' '}'.
+// 0x0C and 0x1A also fold onto structurals; outside strings stage 2 rejects
+// them, and inside strings they are control characters and already errors.
+__attribute__((target("avx2"))) inline void avx2Classify(const char* block, BlockMasks& masks) {
+    const __m256i spaceTable = _mm256_setr_epi8(' ', 100, 100, 100, 17, 100, 113, 2, 100, '\t', '\n', 112, 100, '\r',
+                                                100, 100, ' ', 100, 100, 100, 17, 100, 113, 2, 100, '\t', '\n', 112, 100,
+                                                '\r', 100, 100);
+    const __m256i opTable = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, ':', '{', ',', '}', 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                             0, 0, 0, ':', '{', ',', '}', 0, 0);
+    const __m256i fold = _mm256_set1_epi8(0x20);
+    const __m256i low = _mm256_set1_epi8(0x1F);
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    uint32_t masks32[5][2];
+    for (int half = 0; half < 2; ++half) {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32 * half));
+        const __m256i space = _mm256_cmpeq_epi8(bytes, _mm256_shuffle_epi8(spaceTable, bytes));
+        const __m256i op = _mm256_cmpeq_epi8(_mm256_or_si256(bytes, fold), _mm256_shuffle_epi8(opTable, bytes));
+        masks32[0][half] = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, quote)));
+        masks32[1][half] = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, backslash)));
+        masks32[2][half] = static_cast<uint32_t>(_mm256_movemask_epi8(op));
+        masks32[3][half] = static_cast<uint32_t>(_mm256_movemask_epi8(space));
+        masks32[4][half] =
+            static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_max_epu8(bytes, low), low)));
+    }
+    auto join = [](const uint32_t* m) { return static_cast<uint64_t>(m[0]) | static_cast<uint64_t>(m[1]) << 32; };
+    masks.quote = join(masks32[0]);
+    masks.backslash = join(masks32[1]);
+    masks.op = join(masks32[2]);
+    masks.space = join(masks32[3]);
+    masks.control = join(masks32[4]);
+}
+
+__attribute__((target("avx2,bmi,popcnt"))) const char* avx2Index(const char* json, size_t n, uint32_t*& out,
+                                                      size_t& errorOffset) {
+    return indexBlocks<avx2Classify>(json, n, out, errorOffset);
+}
+
+bool hasAvx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi") && __builtin_cpu_supports("popcnt");
+}
+
+const IndexKernel kIndex = hasAvx2() ? avx2Index : scalarIndex;
+
+#else
+
+const IndexKernel kIndex = scalarIndex;
+
+#endif
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+bool validNumber(const char* p, const char* end) {
+    if (p < end && *p == '-') {
+        ++p;
+    }
+    if (p == end || !isDigit(*p)) {
+        return false;
+    }
+    if (*p == '0') {
+        ++p;
+    } else {
+        while (p < end && isDigit(*p)) {
+            ++p;
+        }
+    }
+    if (p < end && *p == '.') {
+        if (++p == end || !isDigit(*p)) {
+            return false;
+        }
+        while (p < end && isDigit(*p)) {
+            ++p;
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        if (p < end && (*p == '+' || *p == '-')) {
+            ++p;
+        }
+        if (p == end || !isDigit(*p)) {
+            return false;
+        }
+        while (p < end && isDigit(*p)) {
+            ++p;
+        }
+    }
+    return p == end;
+}
+
+uint32_t hex4(const char* p) {
+    return static_cast<uint32_t>(hexValue(p[0]) << 12 | hexValue(p[1]) << 8 | hexValue(p[2]) << 4 | hexValue(p[3]));
+}
+
+// Contents already checked by validEscapes
+void unescape(std::string_view raw, std::string& out) {
+    out.clear();
+    const char* p = raw.data();
+    const char* end = p + raw.size();
+    while (p < end) {
+        const char* slash = static_cast<const char*>(std::memchr(p, '\\', static_cast<size_t>(end - p)));
+        if (!slash) {
+            out.append(p, end);
+            break;
+        }
+        out.append(p, slash);
+        p = slash + 2;
+        switch (slash[1]) {
+        case 'b':
+            out.push_back('\b');
+            break;
+        case 'f':
+            out.push_back('\f');
+            break;
+        case 'n':
+            out.push_back('\n');
+            break;
+        case 'r':
+            out.push_back('\r');
+            break;
+        case 't':
+            out.push_back('\t');
+            break;
+        case 'u': {
+            uint32_t cp = hex4(slash + 2);
+            p = slash + 6;
+            if (cp >= 0xD800 && cp < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                const uint32_t low = hex4(p + 2);
+                if (low >= 0xDC00 && low < 0xE000) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                }
+            }
+            // Unpaired surrogates have no UTF-8 form
+            appendUtf8(cp >= 0xD800 && cp < 0xE000 ? 0xFFFD : cp, out);
+            break;
+        }
+        default:
+            out.push_back(slash[1]);    // " \ /
+        }
+    }
+}
+
+// Returns false, naming the array in error, for an array that mixes numbers with other values
+bool appendFlattened(const JsonValue& value, std::string& name, std::map<std::string, std::string>& params,
+                     std::string& scratch, std::string* error) {
+    const size_t length = name.size();
+    switch (value.type()) {
+    case JsonType::Null:
+        break;
+    case JsonType::Bool:
+    case JsonType::Number:
+        params[name] = std::string(value.raw());
+        break;
+    case JsonType::String:
+        params[name] = std::string(value.string(scratch));
+        break;
+    case JsonType::Array: {
+        // Whether an array is joined must not depend on what else it holds, or a null among scores
+        // would turn "scores" into scores.<j> keys its handler does not read
+        size_t numbers = 0;
+        for (JsonValue item : value.items()) {
+            numbers += item.type() == JsonType::Number;
+        }
+        if (numbers > 0 && numbers != value.size()) {
+            if (error) {
+                *error = "array " + name.substr(0, 64) + " mixes numbers with other values";
+            }
+            return false;
+        }
+        if (numbers > 0) {
+            std::string& joined = params[name];
+            joined.clear();
+            for (JsonValue item : value.items()) {
+                if (!joined.empty()) {
+                    joined.push_back(',');
+                }
+                joined.append(item.raw());
+            }
+            break;
+        }
+        size_t index = 0;
+        for (JsonValue item : value.items()) {
+            name.resize(length);
+            name += (length > 0 ? "." : "") + std::to_string(index++);
+            if (!appendFlattened(item, name, params, scratch, error)) {
+                return false;
+            }
+        }
+        break;
+    }
+    case JsonType::Object:
+        for (JsonMember member : value.members()) {
+            name.resize(length);
+            if (length > 0) {
+                name.push_back('.');
+            }
+            name.append(member.key.string(scratch));
+            if (!appendFlattened(member.value, name, params, scratch, error)) {
+                return false;
+            }
+        }
+        break;
+    }
+    name.resize(length);
+    return true;
+}
+
+} // namespace
+
+JsonParser::JsonParser() : structuralCount_(0), valid_(false), error_(""), errorOffset_(0) {
+}
+
+bool JsonParser::fail(const char* message, size_t offset) {
+    error_ = message;
+    errorOffset_ = offset;
+    valid_ = false;
+    return false;
+}
+
+bool JsonParser::parse(std::string_view json) {
+    json_ = json;
+    valid_ = false;
+    error_ = "";
+    errorOffset_ = 0;
+    if (json.size() > kMaxBytes) {
+        return fail("document too large", 0);
+    }
+    valid_ = indexStructurals() && buildTape();
+    return valid_;
+}
+
+bool JsonParser::indexStructurals() {
+    const size_t n = json_.size();
+    // At most one index per byte, plus one past the end and slack for the unconditional writes
+    if (structurals_.size() < n + 64) {
+        structurals_.resize(n + 64);
+    }
+    uint32_t* out = structurals_.data();
+    size_t offset = 0;
+    const char* message = kIndex(json_.data(), n, out, offset);
+    if (message) {
+        return fail(message, offset);
+    }
+    structuralCount_ = static_cast<size_t>(out - structurals_.data());
+    // Trailing padding spaces of the last block are never indexed, so no index reaches n
+    *out = static_cast<uint32_t>(n);
+    return true;
+}
+
+bool JsonParser::buildTape() {
+    const char* text = json_.data();
+    const uint32_t* idx = structurals_.data();
+    const size_t count = structuralCount_;
+    // Every node starts at a structural, so count nodes is enough
+    if (tape_.size() < count) {
+        tape_.resize(count);
+    }
+    if (stack_.size() < kMaxDepth) {
+        stack_.resize(kMaxDepth);
+    }
+    Node* tape = tape_.data();
+    uint32_t* stack = stack_.data();    // Tape indexes of the open containers
+    size_t depth = 0;
+    uint32_t nodes = 0;
+    size_t i = 0;
+
+    // End of the token starting at structural i: back from the next structural over whitespace
+    auto tokenEnd = [&](size_t i) {
+        size_t end = idx[i + 1];
+        while (end > idx[i] && isSpace(text[end - 1])) {
+            --end;
+        }
+        return end;
+    };
+
+    // Appends the string, number or literal at structural i; returns an error or nullptr
+    auto leaf = [&](size_t i) -> const char* {
+        const size_t pos = idx[i];
+        const size_t end = tokenEnd(i);
+        if (text[pos] == '"') {
+            if (end < pos + 2 || text[end - 1] != '"') {
+                return "malformed string";
+            }
+            // Escapes were checked in stage 1 and are decoded on access
+            tape[nodes] = Node{static_cast<uint32_t>(pos + 1), static_cast<uint32_t>(end - pos - 2), nodes + 1, 0,
+                               JsonType::String};
+            ++nodes;
+            return nullptr;
+        }
+        const std::string_view token(text + pos, end - pos);
+        JsonType type;
+        if (validNumber(token.data(), token.data() + token.size())) {
+            type = JsonType::Number;
+        } else if (token == "true" || token == "false") {
+            type = JsonType::Bool;
+        } else if (token == "null") {
+            type = JsonType::Null;
+        } else {
+            return "invalid literal";
+        }
+        tape[nodes] = Node{static_cast<uint32_t>(pos), static_cast<uint32_t>(token.size()), nodes + 1, 0, type};
+        ++nodes;
+        return nullptr;
+    };
+
+    // One label per place in the grammar; each jumps straight to the next
+    const char* message;
+    char c;
+value:
+    if (i == count) {
+        return fail(nodes == 0 ? "empty document" : "unexpected end of document", json_.size());
+    }
+    c = text[idx[i]];
+    if (c == '{' || c == '[') {
+        if (depth == kMaxDepth) {
+            return fail("nesting too deep", idx[i]);
+        }
+        stack[depth++] = nodes;
+        tape[nodes++] = Node{idx[i], 0, 0, 0, c == '{' ? JsonType::Object : JsonType::Array};
+        ++i;
+        if (i < count && text[idx[i]] == (c == '{' ? '}' : ']')) {
+            Node& container = tape[stack[--depth]];
+            container.length = idx[i] + 1 - container.offset;
+            container.next = nodes;
+            ++i;
+            goto valueEnd;
+        }
+        if (c == '[') {
+            goto value;
+        }
+        goto key;
+    }
+    if (c == ']' || c == '}' || c == ',' || c == ':') {
+        return fail("expected a value", idx[i]);
+    }
+    if ((message = leaf(i)) != nullptr) {
+        return fail(message, idx[i]);
+    }
+    ++i;
+    goto valueEnd;
+
+key:
+    if (i == count || text[idx[i]] != '"') {
+        return fail("expected a string key", i < count ? idx[i] : json_.size());
+    }
+    if ((message = leaf(i)) != nullptr) {
+        return fail(message, idx[i]);
+    }
+    ++i;
+    if (i == count || text[idx[i]] != ':') {
+        return fail("expected ':' after key", i < count ? idx[i] : json_.size());
+    }
+    ++i;
+    goto value;
+
+valueEnd:
+    if (depth == 0) {
+        if (i != count) {
+            return fail("trailing characters after the document", idx[i]);
+        }
+        return true;
+    }
+    if (i == count) {
+        return fail("unexpected end of document", json_.size());
+    }
+    {
+        Node& container = tape[stack[depth - 1]];
+        const bool object = container.type == JsonType::Object;
+        c = text[idx[i]];
+        container.count++;
+        if (c == ',') {
+            ++i;
+            if (object) {
+                goto key;
+            }
+            goto value;
+        }
+        if (c != (object ? '}' : ']')) {
+            return fail(object ? "expected ',' or '}'" : "expected ',' or ']'", idx[i]);
+        }
+        container.length = idx[i] + 1 - container.offset;
+        container.next = nodes;
+        --depth;
+        ++i;
+        goto valueEnd;
+    }
+}
+
+JsonValue JsonParser::root() const {
+    return valid_ ? JsonValue(this, 0) : JsonValue();
+}
+
+JsonType JsonValue::type() const {
+    return parser_ ? parser_->tape_[node_].type : JsonType::Null;
+}
+
+std::string_view JsonValue::raw() const {
+    if (!parser_) {
+        return std::string_view();
+    }
+    const JsonParser::Node& node = parser_->tape_[node_];
+    return parser_->json_.substr(node.offset, node.length);
+}
+
+std::string_view JsonValue::string(std::string& scratch) const {
+    if (!parser_ || type() != JsonType::String) {
+        return std::string_view();
+    }
+    const std::string_view text = raw();
+    if (std::memchr(text.data(), '\\', text.size()) == nullptr) {
+        return text;
+    }
+    unescape(text, scratch);
+    return scratch;
+}
+
+std::string JsonValue::string() const {
+    std::string scratch;
+    return std::string(string(scratch));
+}
+
+bool JsonValue::getBool(bool& value) const {
+    if (!parser_ || type() != JsonType::Bool) {
+        return false;
+    }
+    value = raw()[0] == 't';
+    return true;
+}
+
+bool JsonValue::getDouble(double& value) const {
+    if (!parser_ || type() != JsonType::Number) {
+        return false;
+    }
+    const std::string_view text = raw();
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    // Out-of-range numbers parse but do not fit a double
+    return result.ec == std::errc();
+}
+
+bool JsonValue::getInt64(int64_t& value) const {
+    if (!parser_ || type() != JsonType::Number) {
+        return false;
+    }
+    const std::string_view text = raw();
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+size_t JsonValue::size() const {
+    if (!parser_) {
+        return 0;
+    }
+    const JsonParser::Node& node = parser_->tape_[node_];
+    return node.type == JsonType::Array || node.type == JsonType::Object ? node.count : 0;
+}
+
+JsonValue JsonValue::operator[](size_t index) const {
+    if (!parser_ || type() != JsonType::Array || index >= size()) {
+        return JsonValue();
+    }
+    uint32_t node = node_ + 1;
+    for (size_t i = 0; i < index; ++i) {
+        node = parser_->tape_[node].next;
+    }
+    return JsonValue(parser_, node);
+}
+
+JsonValue JsonValue::find(std::string_view key) const {
+    if (!parser_ || type() != JsonType::Object) {
+        return JsonValue();
+    }
+    std::string scratch;
+    for (JsonMember member : members()) {
+        const std::string_view raw = member.key.raw();
+        if (raw == key || (raw.find('\\') != std::string_view::npos && member.key.string(scratch) == key)) {
+            return member.value;
+        }
+    }
+    return JsonValue();
+}
+
+JsonValue::Range<JsonValue::ArrayIterator> JsonValue::items() const {
+    if (!parser_ || type() != JsonType::Array) {
+        return Range<ArrayIterator>{ArrayIterator(nullptr, kNoNode), ArrayIterator(nullptr, kNoNode)};
+    }
+    return Range<ArrayIterator>{ArrayIterator(parser_, node_ + 1), ArrayIterator(parser_, parser_->tape_[node_].next)};
+}
+
+JsonValue::Range<JsonValue::MemberIterator> JsonValue::members() const {
+    if (!parser_ || type() != JsonType::Object) {
+        return Range<MemberIterator>{MemberIterator(nullptr, kNoNode), MemberIterator(nullptr, kNoNode)};
+    }
+    return Range<MemberIterator>{MemberIterator(parser_, node_ + 1),
+                                 MemberIterator(parser_, parser_->tape_[node_].next)};
+}
+
+JsonValue::ArrayIterator& JsonValue::ArrayIterator::operator++() {
+    node_ = parser_->tape_[node_].next;
+    return *this;
+}
+
+JsonValue::MemberIterator& JsonValue::MemberIterator::operator++() {
+    node_ = parser_->tape_[node_ + 1].next;
+    return *this;
+}
+
+bool flattenJson(std::string_view body, std::map<std::string, std::string>& params, std::string* error) {
+    // Reused per thread so request decoding stops allocating tape and index
+    thread_local JsonParser parser;
+    if (!parser.parse(body) || parser.root().type() != JsonType::Object) {
+        if (error) {
+            *error = "request body must be a JSON object";
+        }
+        return false;
+    }
+    std::string name;
+    std::string scratch;
+    return appendFlattened(parser.root(), name, params, scratch, error);
+}
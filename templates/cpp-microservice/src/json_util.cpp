@@ -0,0 +1,137 @@
+#include "json_util.h"
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+typedef size_t (*SafeLengthKernel)(const char* p, size_t n);
+
+size_t scalarSafeLength(const char* p, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        const unsigned char c = static_cast<unsigned char>(p[i]);
+        if (c < 0x20 || c == '"' || c == '\\') {
+            return i;
+        }
+    }
+    return n;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("avx2,bmi"))) size_t avx2SafeLength(const char* p, size_t n) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i low = _mm256_set1_epi8(0x1F);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        // Control characters: unsigned max with 0x1F leaves them at 0x1F
+        __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, quote),
+                                                       _mm256_cmpeq_epi8(bytes, backslash)),
+                                       _mm256_cmpeq_epi8(_mm256_max_epu8(bytes, low), low));
+        const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+        if (mask != 0) {
+            return i + _tzcnt_u32(mask);
+        }
+    }
+    return i + scalarSafeLength(p + i, n - i);
+}
+
+bool hasAvx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi");
+}
+
+const SafeLengthKernel kSafeLength = hasAvx2() ? avx2SafeLength : scalarSafeLength;
+
+#else
+
+const SafeLengthKernel kSafeLength = scalarSafeLength;
+
+#endif
+
+} // namespace
+
+
+size_t jsonSafeLength(const char* data, size_t size) {
+    return kSafeLength(data, size);
+}
+
+size_t jsonEscape(char c, char* out) {
+    static const char kHex[] = "0123456789abcdef";
+    out[0] = '\\';
+    switch (c) {
+    case '"':
+    case '\\':
+        out[1] = c;
+        return 2;
+    case '\n':
+        out[1] = 'n';
+        return 2;
+    case '\r':
+        out[1] = 'r';
+        return 2;
+    case '\t':
+        out[1] = 't';
+        return 2;
+    default:
+        std::memcpy(out + 1, "u00", 3);
+        out[4] = kHex[(c >> 4) & 0xF];
+        out[5] = kHex[c & 0xF];
+        return 6;
+    }
+}
+
+void appendJsonString(std::string& out, std::string_view value) {
+    out.push_back('"');
+    size_t i = 0;
+    while (i < value.size()) {
+        const size_t run = jsonSafeLength(value.data() + i, value.size() - i);
+        out.append(value.data() + i, run);
+        i += run;
+        if (i < value.size()) {
+            char escape[6];
+            out.append(escape, jsonEscape(value[i], escape));
+            ++i;
+        }
+    }
+    out.push_back('"');
+}
+
+void appendJsonNumber(std::string& out, double value) {
+    if (!std::isfinite(value)) {
+        out.append("null");
+        return;
+    }
+    // Shortest round-trip form, as JsonWriter::number writes it
+    char buf[32];
+    out.append(buf, static_cast<size_t>(std::to_chars(buf, buf + sizeof(buf), value).ptr - buf));
+}
+
+bool parseParamIndex(std::string_view digits, size_t limit, size_t& index) {
+    const char* end = digits.data() + digits.size();
+    const auto result = std::from_chars(digits.data(), end, index);
+    return result.ec == std::errc() && result.ptr == end && index < limit;
+}
+
+bool indexedParams(const std::map<std::string, std::string>& params, const std::string& prefix, size_t limit,
+                   std::map<size_t, std::string_view>& values) {
+    for (auto it = params.lower_bound(prefix); it != params.end() && it->first.compare(0, prefix.size(), prefix) == 0;
+         ++it) {
+        if (it->first.size() == prefix.size() ||
+            it->first.find_first_not_of("0123456789", prefix.size()) != std::string::npos) {
+            continue;
+        }
+        size_t index;
+        if (!parseParamIndex(std::string_view(it->first).substr(prefix.size()), limit, index)) {
+            return false;
+        }
+        values[index] = it->second;
+    }
+    return true;
+}
@@ -0,0 +1,47 @@
+#include "json_writer.h"
+#include "json_util.h"
+#include <charconv>
+#include <cmath>
+
+void JsonWriter::number(double value) {
+    if (!std::isfinite(value)) {
+        null();
+        return;
+    }
+    separate();
+    // Shortest round-trip form is at most 24 characters
+    char* p = out_.reserve(32);
+    out_.commit(static_cast<size_t>(std::to_chars(p, p + 32, value).ptr - p));
+    comma_ = true;
+}
+
+void JsonWriter::integer(int64_t value) {
+    separate();
+    char* p = out_.reserve(24);
+    out_.commit(static_cast<size_t>(std::to_chars(p, p + 24, value).ptr - p));
+    comma_ = true;
+}
+
+void JsonWriter::unsignedInteger(uint64_t value) {
+    separate();
+    char* p = out_.reserve(24);
+    out_.commit(static_cast<size_t>(std::to_chars(p, p + 24, value).ptr - p));
+    comma_ = true;
+}
+
+void JsonWriter::quoted(std::string_view value) {
+    out_.push('"');
+    const char* p = value.data();
+    size_t n = value.size();
+    while (n > 0) {
+        const size_t run = jsonSafeLength(p, n);
+        out_.append(p, run);
+        if (run == n) {
+            break;
+        }
+        out_.commit(jsonEscape(p[run], out_.reserve(6)));
+        p += run + 1;
+        n -= run + 1;
+    }
+    out_.push('"');
+}
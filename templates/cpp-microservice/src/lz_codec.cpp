@@ -0,0 +1,394 @@
+#include "lz_codec.h"
+#include "file_util.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const size_t kMinMatch = 4;
+const size_t kHashBits = 14;
+const size_t kMaxOffset = 65535;
+const size_t kLastLiterals = 5;       // The block always ends with this many literals
+const size_t kMatchSearchEnd = 12;    // No match starts in this many trailing bytes
+
+const size_t kDmer = 8;               // Dictionary training counts substrings of this length
+const size_t kTrainBits = 20;         // Hash buckets for those substrings
+const size_t kTrainSegment = 256;     // Bytes the trainer picks at a time
+
+uint32_t hashSequence(uint32_t bytes) {
+    return (bytes * 2654435761u) >> (32 - kHashBits);
+}
+
+void appendLength(std::string& out, size_t length) {
+    while (length >= 255) {
+        out.push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    out.push_back(static_cast<char>(length));
+}
+
+void appendSequence(std::string& out, const uint8_t* literals, size_t literalCount, size_t offset,
+                    size_t matchLength) {
+    const size_t extra = matchLength - kMinMatch;
+    out.push_back(static_cast<char>(((literalCount < 15 ? literalCount : 15) << 4) | (extra < 15 ? extra : 15)));
+    if (literalCount >= 15) {
+        appendLength(out, literalCount - 15);
+    }
+    out.append(reinterpret_cast<const char*>(literals), literalCount);
+    out.push_back(static_cast<char>(offset & 0xFF));
+    out.push_back(static_cast<char>(offset >> 8));
+    if (extra >= 15) {
+        appendLength(out, extra - 15);
+    }
+}
+
+// Reads the continuation bytes of a length whose nibble was 15
+bool readLength(const uint8_t*& p, const uint8_t* end, size_t& length) {
+    uint8_t byte;
+    do {
+        if (p == end) {
+            return false;
+        }
+        byte = *p++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+// Compresses [start, end). Bytes from base to start are history that matches
+// may reach into (a dictionary); table holds positions relative to base.
+void compressBlock(const uint8_t* base, const uint8_t* start, const uint8_t* end, uint32_t* table,
+                   std::string& out) {
+    const uint8_t* anchor = start;
+    if (static_cast<size_t>(end - start) > kMatchSearchEnd) {
+        const uint8_t* searchEnd = end - kMatchSearchEnd;
+        const uint8_t* matchEnd = end - kLastLiterals;
+        const uint8_t* p = start == base ? start + 1 : start;
+        while (p < searchEnd) {
+            const uint32_t bytes = readRaw<uint32_t>(p);
+            const uint32_t h = hashSequence(bytes);
+            const uint8_t* candidate = base + table[h];
+            table[h] = static_cast<uint32_t>(p - base);
+            if (candidate >= p || static_cast<size_t>(p - candidate) > kMaxOffset ||
+                readRaw<uint32_t>(candidate) != bytes) {
+                // Step faster through data that has not matched for a while
+                p += 1 + ((p - anchor) >> 7);
+                continue;
+            }
+
+            while (p > anchor && candidate > base && p[-1] == candidate[-1]) {
+                --p;
+                --candidate;
+            }
+            const uint8_t* q = p + kMinMatch;
+            const uint8_t* c = candidate + kMinMatch;
+            while (q + 8 <= matchEnd) {
+                const uint64_t diff = readRaw<uint64_t>(q) ^ readRaw<uint64_t>(c);
+                if (diff) {
+                    q += __builtin_ctzll(diff) >> 3;
+                    goto matched;
+                }
+                q += 8;
+                c += 8;
+            }
+            while (q < matchEnd && *q == *c) {
+                ++q;
+                ++c;
+            }
+        matched:
+            appendSequence(out, anchor, static_cast<size_t>(p - anchor), static_cast<size_t>(p - candidate),
+                           static_cast<size_t>(q - p));
+            p = anchor = q;
+            if (p < searchEnd) {
+                table[hashSequence(readRaw<uint32_t>(p - 2))] = static_cast<uint32_t>(p - 2 - base);
+            }
+        }
+    }
+
+    const size_t literalCount = static_cast<size_t>(end - anchor);
+    out.push_back(static_cast<char>((literalCount < 15 ? literalCount : 15) << 4));
+    if (literalCount >= 15) {
+        appendLength(out, literalCount - 15);
+    }
+    out.append(reinterpret_cast<const char*>(anchor), literalCount);
+}
+
+// Copies a match of length bytes starting offset bytes before o. A
+// dictionary, if any, sits just before start; a match may run from its end
+// into the output.
+bool copyMatch(uint8_t* o, const uint8_t* start, const uint8_t* outEnd, size_t offset, size_t length,
+               const LzDictionary* dictionary) {
+    const size_t produced = static_cast<size_t>(o - start);
+    if (offset == 0) {
+        return false;
+    }
+    if (offset > produced) {
+        const size_t back = offset - produced;
+        if (!dictionary || back > dictionary->size()) {
+            return false;
+        }
+        const uint8_t* match =
+            reinterpret_cast<const uint8_t*>(dictionary->bytes().data()) + dictionary->size() - back;
+        const size_t fromDictionary = std::min(length, back);
+        std::memcpy(o, match, fromDictionary);
+        for (size_t i = fromDictionary; i < length; ++i) {
+            o[i] = start[i - fromDictionary];
+        }
+        return true;
+    }
+
+    const uint8_t* match = o - offset;
+    if (offset >= 16 && static_cast<size_t>(outEnd - o) >= length + 16) {
+        for (size_t i = 0; i < length; i += 16) {
+            std::memcpy(o + i, match + i, 16);
+        }
+    } else if (offset >= 8 && static_cast<size_t>(outEnd - o) >= length + 8) {
+        // Each 8-byte copy reads bytes already written, so overlap is safe
+        for (size_t i = 0; i < length; i += 8) {
+            std::memcpy(o + i, match + i, 8);
+        }
+    } else {
+        for (size_t i = 0; i < length; ++i) {
+            o[i] = match[i];
+        }
+    }
+    return true;
+}
+
+uint32_t dmerBucket(const char* p) {
+    return static_cast<uint32_t>((readRaw<uint64_t>(p) * 0x9E3779B97F4A7C15ull) >> (64 - kTrainBits));
+}
+
+} // namespace
+
+// ─── LzDictionary ───────────────────────────────────────────────────────────
+
+LzDictionary::LzDictionary() {}
+
+LzDictionary::LzDictionary(std::string bytes) : bytes_(std::move(bytes)) {
+    if (bytes_.size() > kMaxSize) {
+        bytes_.erase(0, bytes_.size() - kMaxSize);
+    }
+    // Later positions overwrite earlier ones, so matches prefer the dictionary's end
+    table_.assign(size_t(1) << kHashBits, 0);
+    for (size_t i = 0; i + 4 <= bytes_.size(); ++i) {
+        table_[hashSequence(readRaw<uint32_t>(bytes_.data() + i))] = static_cast<uint32_t>(i);
+    }
+}
+
+LzDictionary LzDictionary::train(const std::vector<std::string_view>& samples, size_t maxBytes) {
+    maxBytes = std::min(maxBytes, kMaxSize);
+    size_t total = 0;
+    for (std::string_view sample : samples) {
+        total += sample.size();
+    }
+    if (maxBytes < kTrainSegment || total < kTrainSegment) {
+        return LzDictionary();
+    }
+
+    // Number of samples each dmer occurs in. A dmer found in one sample only
+    // would not repeat across records, so it is worth nothing.
+    std::vector<uint32_t> frequency(size_t(1) << kTrainBits, 0);
+    std::vector<uint32_t> lastSample(size_t(1) << kTrainBits, 0);
+    for (size_t s = 0; s < samples.size(); ++s) {
+        for (size_t i = 0; i + kDmer <= samples[s].size(); ++i) {
+            const uint32_t bucket = dmerBucket(samples[s].data() + i);
+            if (lastSample[bucket] != s + 1) {
+                lastSample[bucket] = static_cast<uint32_t>(s + 1);
+                ++frequency[bucket];
+            }
+        }
+    }
+    for (uint32_t& f : frequency) {
+        f = f < 2 ? 0 : f;
+    }
+
+    // Epochs split the samples' bytes (as if concatenated) into equal ranges
+    const size_t epochs = std::max<size_t>(1, std::min(maxBytes / kTrainSegment, total / (4 * kTrainSegment)));
+    const size_t epochBytes = (total + epochs - 1) / epochs;
+    const size_t windowDmers = kTrainSegment - kDmer + 1;
+    std::vector<uint16_t> inWindow(size_t(1) << kTrainBits, 0);
+    std::vector<std::string_view> picks;
+    size_t picked = 0;
+    bool progress = true;
+    while (picked < maxBytes && progress) {
+        progress = false;
+        size_t sample = 0;
+        size_t sampleStart = 0;
+        for (size_t epoch = 0; epoch < epochs && picked < maxBytes; ++epoch) {
+            const size_t lo = epoch * epochBytes;
+            const size_t hi = std::min(total, lo + epochBytes);
+            uint64_t bestScore = 0;
+            std::string_view best;
+            while (sample < samples.size() && sampleStart + samples[sample].size() <= lo) {
+                sampleStart += samples[sample++].size();
+            }
+            for (size_t s = sample, begin = sampleStart; s < samples.size() && begin < hi;
+                 begin += samples[s++].size()) {
+                // The part of sample s inside the epoch, slid over one window at a time
+                const char* data = samples[s].data();
+                const size_t a = lo > begin ? lo - begin : 0;
+                const size_t b = std::min(samples[s].size(), hi - begin);
+                if (b < a + kDmer) {
+                    continue;
+                }
+                uint64_t score = 0;
+                size_t head = a;
+                for (size_t i = a; i + kDmer <= b; ++i) {
+                    const uint32_t bucket = dmerBucket(data + i);
+                    if (inWindow[bucket]++ == 0) {
+                        score += frequency[bucket];
+                    }
+                    if (i - head + 1 > windowDmers) {
+                        const uint32_t leaving = dmerBucket(data + head++);
+                        if (--inWindow[leaving] == 0) {
+                            score -= frequency[leaving];
+                        }
+                    }
+                    if (score > bestScore) {
+                        bestScore = score;
+                        best = std::string_view(data + head, i + kDmer - head);
+                    }
+                }
+                for (; head + kDmer <= b; ++head) {
+                    --inWindow[dmerBucket(data + head)];
+                }
+            }
+            if (bestScore == 0) {
+                continue;
+            }
+
+            // Trim dmers worth nothing off both ends, then stop counting the rest
+            while (best.size() > kDmer && frequency[dmerBucket(best.data())] == 0) {
+                best.remove_prefix(1);
+            }
+            while (best.size() > kDmer && frequency[dmerBucket(best.data() + best.size() - kDmer)] == 0) {
+                best.remove_suffix(1);
+            }
+            for (size_t i = 0; i + kDmer <= best.size(); ++i) {
+                frequency[dmerBucket(best.data() + i)] = 0;
+            }
+            picks.push_back(best);
+            picked += best.size();
+            progress = true;
+        }
+    }
+    if (picks.empty()) {
+        return LzDictionary();
+    }
+
+    // Best picks last, where every record's matches can reach them
+    std::string bytes;
+    bytes.reserve(picked);
+    for (size_t i = picks.size(); i-- > 0;) {
+        bytes.append(picks[i].data(), picks[i].size());
+    }
+    return LzDictionary(std::move(bytes));
+}
+
+// ─── Block codec ────────────────────────────────────────────────────────────
+
+void lzCompress(const char* data, size_t size, std::string& out, const LzDictionary* dictionary) {
+    out.reserve(out.size() + size + size / 255 + 16);
+    if (!dictionary || dictionary->empty()) {
+        const uint8_t* base = reinterpret_cast<const uint8_t*>(data);
+        uint32_t table[1u << kHashBits];
+        std::memset(table, 0, sizeof(table));
+        compressBlock(base, base, base + size, table, out);
+        return;
+    }
+
+    // The dictionary and the input side by side, so matches may span both
+    thread_local std::string window;
+    thread_local std::vector<uint32_t> table;
+    window.assign(dictionary->bytes_);
+    window.append(data, size);
+    table = dictionary->table_;
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(window.data());
+    compressBlock(base, base + dictionary->size(), base + window.size(), table.data(), out);
+}
+
+bool lzDecompress(const uint8_t* block, size_t size, char* out, size_t outSize, const LzDictionary* dictionary) {
+    const uint8_t* p = block;
+    const uint8_t* end = block + size;
+    uint8_t* const start = reinterpret_cast<uint8_t*>(out);
+    uint8_t* const outEnd = start + outSize;
+    uint8_t* o = start;
+    const uint8_t* dictionaryEnd =
+        dictionary ? reinterpret_cast<const uint8_t*>(dictionary->bytes().data()) + dictionary->size() : nullptr;
+    const size_t dictionarySize = dictionary ? dictionary->size() : 0;
+    while (p < end) {
+        const uint8_t token = *p++;
+        size_t literals = token >> 4;
+        size_t length = token & 15;
+
+        // Fast path for the common short sequence far from both ends: fixed-size
+        // copies that may write past the sequence, into bytes later ones overwrite
+        if (literals < 15 && length < 15 && end - p >= 16 && outEnd - o >= 40) {
+            std::memcpy(o, p, 16);
+            o += literals;
+            p += literals;
+            const size_t offset = p[0] | (static_cast<size_t>(p[1]) << 8);
+            p += 2;
+            if (offset >= 8 && offset <= static_cast<size_t>(o - start)) {
+                const uint8_t* match = o - offset;
+                std::memcpy(o, match, 8);
+                std::memcpy(o + 8, match + 8, 8);
+                std::memcpy(o + 16, match + 16, 2);
+                o += length + kMinMatch;
+                continue;
+            }
+            // The same for a match far enough inside the dictionary
+            const size_t back = offset - static_cast<size_t>(o - start);
+            if (offset > static_cast<size_t>(o - start) && back >= 24 && back <= dictionarySize) {
+                const uint8_t* match = dictionaryEnd - back;
+                std::memcpy(o, match, 8);
+                std::memcpy(o + 8, match + 8, 8);
+                std::memcpy(o + 16, match + 16, 8);
+                o += length + kMinMatch;
+                continue;
+            }
+            length += kMinMatch;
+            if (!copyMatch(o, start, outEnd, offset, length, dictionary)) {
+                return false;
+            }
+            o += length;
+            continue;
+        }
+
+        if (literals == 15 && !readLength(p, end, literals)) {
+            return false;
+        }
+        if (literals > static_cast<size_t>(end - p) || literals > static_cast<size_t>(outEnd - o)) {
+            return false;
+        }
+        if (static_cast<size_t>(end - p) >= literals + 16 && static_cast<size_t>(outEnd - o) >= literals + 16) {
+            // Long runs: 16-byte chunks, rounding up into the slack
+            for (size_t i = 0; i < literals; i += 16) {
+                std::memcpy(o + i, p + i, 16);
+            }
+        } else {
+            std::memcpy(o, p, literals);
+        }
+        o += literals;
+        p += literals;
+        if (p == end) {
+            return o == outEnd;
+        }
+
+        if (end - p < 2) {
+            return false;
+        }
+        const size_t offset = p[0] | (static_cast<size_t>(p[1]) << 8);
+        p += 2;
+        if (length == 15 && !readLength(p, end, length)) {
+            return false;
+        }
+        length += kMinMatch;
+        if (length > static_cast<size_t>(outEnd - o) || !copyMatch(o, start, outEnd, offset, length, dictionary)) {
+            return false;
+        }
+        o += length;
+    }
+    return false;
+}
@@ -1,5 +1,7 @@
 #include "microservice.h"
 #include "config_manager.h"
+#include "http_server.h"
+#include "database.h"
 #include <signal.h>
 #include <unistd.h>
 #include <cstring>
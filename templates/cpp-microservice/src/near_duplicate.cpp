@@ -0,0 +1,422 @@
+#include "near_duplicate.h"
+#include "hash.h"
+#include "unicode_util.h"
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const uint32_t kEmpty = 0xFFFFFFFFu;
+const size_t kSimhashBlocks = 4;      // 16-bit blocks; a distance below 4 leaves one block equal
+const size_t kShingleBlock = 256;     // Shingle hashes folded into the MinHash at a time
+
+inline uint64_t fmix64(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+inline uint32_t fmix32(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+// mins[i] = min(mins[i], fmix32(x ^ seeds[i])) over every x in xs
+typedef void (*MinHashKernel)(uint32_t* mins, const uint32_t* seeds, size_t count, const uint32_t* xs, size_t n);
+
+void scalarMinHash(uint32_t* mins, const uint32_t* seeds, size_t count, const uint32_t* xs, size_t n) {
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t m = mins[i];
+        for (size_t j = 0; j < n; ++j) {
+            m = std::min(m, fmix32(xs[j] ^ seeds[i]));
+        }
+        mins[i] = m;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("avx2"))) void avx2MinHash(uint32_t* mins, const uint32_t* seeds, size_t count,
+                                                 const uint32_t* xs, size_t n) {
+    const __m256i c1 = _mm256_set1_epi32(static_cast<int>(0x85ebca6bu));
+    const __m256i c2 = _mm256_set1_epi32(static_cast<int>(0xc2b2ae35u));
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        // Two vectors of hash functions per pass over the shingles
+        __m256i m0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mins + i));
+        __m256i m1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mins + i + 8));
+        const __m256i s0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(seeds + i));
+        const __m256i s1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(seeds + i + 8));
+        for (size_t j = 0; j < n; ++j) {
+            const __m256i x = _mm256_set1_epi32(static_cast<int>(xs[j]));
+            __m256i h0 = _mm256_xor_si256(x, s0);
+            __m256i h1 = _mm256_xor_si256(x, s1);
+            h0 = _mm256_xor_si256(h0, _mm256_srli_epi32(h0, 16));
+            h1 = _mm256_xor_si256(h1, _mm256_srli_epi32(h1, 16));
+            h0 = _mm256_mullo_epi32(h0, c1);
+            h1 = _mm256_mullo_epi32(h1, c1);
+            h0 = _mm256_xor_si256(h0, _mm256_srli_epi32(h0, 13));
+            h1 = _mm256_xor_si256(h1, _mm256_srli_epi32(h1, 13));
+            h0 = _mm256_mullo_epi32(h0, c2);
+            h1 = _mm256_mullo_epi32(h1, c2);
+            h0 = _mm256_xor_si256(h0, _mm256_srli_epi32(h0, 16));
+            h1 = _mm256_xor_si256(h1, _mm256_srli_epi32(h1, 16));
+            m0 = _mm256_min_epu32(m0, h0);
+            m1 = _mm256_min_epu32(m1, h1);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(mins + i), m0);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(mins + i + 8), m1);
+    }
+    scalarMinHash(mins + i, seeds + i, count - i, xs, n);
+}
+
+bool hasAvx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+const MinHashKernel kMinHash = hasAvx2() ? avx2MinHash : scalarMinHash;
+
+#else
+
+const MinHashKernel kMinHash = scalarMinHash;
+
+#endif
+
+inline uint32_t shingleValue(uint64_t h) {
+    return static_cast<uint32_t>(h ^ (h >> 32));
+}
+
+const uint64_t kFnvOffset = 0xcbf29ce484222325ULL;
+const uint64_t kFnvPrime = 0x100000001b3ULL;
+
+// Byte b of kSpreadBits[x] is bit b of x
+struct SpreadBits {
+    uint64_t values[256];
+
+    SpreadBits() {
+        for (size_t x = 0; x < 256; ++x) {
+            values[x] = 0;
+            for (size_t b = 0; b < 8; ++b) {
+                values[x] |= static_cast<uint64_t>((x >> b) & 1) << (8 * b);
+            }
+        }
+    }
+
+    uint64_t operator[](size_t x) const { return values[x]; }
+};
+const SpreadBits kSpreadBits;
+
+// Lower-cased ASCII letters and digits; 0 for separators
+struct AsciiWord {
+    unsigned char values[128];
+
+    AsciiWord() {
+        for (int c = 0; c < 128; ++c) {
+            values[c] = (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ? static_cast<unsigned char>(c)
+                        : c >= 'A' && c <= 'Z' ? static_cast<unsigned char>(c + 32) : 0;
+        }
+    }
+
+    unsigned char operator[](size_t c) const { return values[c]; }
+};
+const AsciiWord kAsciiWord;
+
+} // namespace
+
+const uint64_t NearDuplicateIndex::kNotFound;
+
+NearDuplicateIndex::NearDuplicateIndex(const NearDuplicateOptions& options)
+    : options_(options), added_(0), mask_(0) {
+    // Clamp the options to what the band tables and SimHash blocks can index
+    options_.shingleWords = std::max<size_t>(options_.shingleWords, 1);
+    options_.bands = std::max<size_t>(options_.bands, 1);
+    options_.rows = std::max<size_t>(options_.rows, 1);
+    options_.simhashDistance = std::min(options_.simhashDistance, kSimhashBlocks - 1);
+    options_.capacity = std::min<size_t>(std::max<size_t>(options_.capacity, 1), kEmpty - 1);
+    hashes_ = options_.bands * options_.rows;
+    keysPerEntry_ = options_.bands + kSimhashBlocks;
+
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    seeds_.resize(hashes_);
+    for (uint32_t& seed : seeds_) {
+        state += 0x9E3779B97F4A7C15ULL;
+        seed = static_cast<uint32_t>(fmix64(state));
+    }
+}
+
+void NearDuplicateIndex::sign(std::string_view text, DocumentSignature& signature) const {
+    signature.minhash.assign(hashes_, 0xFFFFFFFFu);
+    signature.shingles = 0;
+
+    const size_t windowSize = std::min<size_t>(options_.shingleWords, 64);
+    uint64_t window[64];
+    size_t words = 0;
+    uint32_t block[kShingleBlock];
+    size_t blocked = 0;
+
+    // SimHash bit counts: 8 byte-wide counters per word of lanes[], flushed before they overflow
+    uint64_t lanes[8] = {0};
+    uint32_t counts[64] = {0};
+    size_t laned = 0;
+    auto flushLanes = [&]() {
+        for (size_t j = 0; j < 8; ++j) {
+            for (size_t b = 0; b < 8; ++b) {
+                counts[8 * j + b] += (lanes[j] >> (8 * b)) & 0xFF;
+            }
+            lanes[j] = 0;
+        }
+        laned = 0;
+    };
+    auto addShingle = [&](uint64_t h) {
+        for (size_t j = 0; j < 8; ++j) {
+            lanes[j] += kSpreadBits[(h >> (8 * j)) & 0xFF];
+        }
+        if (++laned == 255) {
+            flushLanes();
+        }
+        block[blocked++] = shingleValue(h);
+        ++signature.shingles;
+        if (blocked == kShingleBlock) {
+            kMinHash(signature.minhash.data(), seeds_.data(), hashes_, block, blocked);
+            blocked = 0;
+        }
+    };
+    auto shingleOf = [&](size_t count) {
+        uint64_t h = count;
+        for (size_t j = words - count; j < words; ++j) {
+            h = (h ^ window[j % windowSize]) * 0x9E3779B97F4A7C15ULL;
+        }
+        return fmix64(h);
+    };
+
+    // Words are hashed as they are read: FNV-1a over the lower-cased UTF-8, then mixed
+    uint64_t wordHash = kFnvOffset;
+    bool inWord = false;
+    auto endWord = [&]() {
+        if (!inWord) {
+            return;
+        }
+        window[words % windowSize] = fmix64(wordHash);
+        ++words;
+        if (words >= windowSize) {
+            addShingle(shingleOf(windowSize));
+        }
+        wordHash = kFnvOffset;
+        inWord = false;
+    };
+
+    const char* p = text.data();
+    const char* end = p + text.size();
+    while (p < end) {
+        const unsigned char c = static_cast<unsigned char>(*p);
+        if (c < 0x80) {
+            ++p;
+            const unsigned char lower = kAsciiWord[c];
+            if (lower != 0) {
+                wordHash = (wordHash ^ lower) * kFnvPrime;
+                inWord = true;
+            } else {
+                endWord();
+            }
+            continue;
+        }
+        const uint32_t cp = decodeUtf8(p, end);
+        if (isUnicodeAlnum(cp)) {
+            char utf8[4];
+            const size_t length = encodeUtf8(toLowerCodePoint(cp), utf8);
+            for (size_t i = 0; i < length; ++i) {
+                wordHash = (wordHash ^ static_cast<unsigned char>(utf8[i])) * kFnvPrime;
+            }
+            inWord = true;
+        } else {
+            endWord();
+        }
+    }
+    endWord();
+    if (words > 0 && words < windowSize) {
+        // Shorter than a shingle: the whole text is the one shingle
+        addShingle(shingleOf(words));
+    }
+    if (blocked > 0) {
+        kMinHash(signature.minhash.data(), seeds_.data(), hashes_, block, blocked);
+    }
+    flushLanes();
+
+    // A bit is set when most shingles have it set
+    signature.simhash = 0;
+    for (size_t b = 0; b < 64; ++b) {
+        if (2 * static_cast<uint64_t>(counts[b]) > signature.shingles) {
+            signature.simhash |= 1ULL << b;
+        }
+    }
+}
+
+double NearDuplicateIndex::similarity(const DocumentSignature& a, const DocumentSignature& b) {
+    const size_t n = std::min(a.minhash.size(), b.minhash.size());
+    if (n == 0 || a.shingles == 0 || b.shingles == 0) {
+        return 0.0;
+    }
+    size_t equal = 0;
+    for (size_t i = 0; i < n; ++i) {
+        equal += a.minhash[i] == b.minhash[i];
+    }
+    return static_cast<double>(equal) / n;
+}
+
+void NearDuplicateIndex::computeKeys(const DocumentSignature& signature, uint32_t* keys) const {
+    for (size_t b = 0; b < options_.bands; ++b) {
+        keys[b] = static_cast<uint32_t>(
+            hash64(signature.minhash.data() + b * options_.rows, options_.rows * sizeof(uint32_t), b + 1));
+    }
+    for (size_t j = 0; j < kSimhashBlocks; ++j) {
+        const uint64_t block = (signature.simhash >> (16 * j)) & 0xFFFF;
+        keys[options_.bands + j] = static_cast<uint32_t>(fmix64(block | ((j + 1) << 16) | (1ULL << 40)));
+    }
+}
+
+bool NearDuplicateIndex::matches(const DocumentSignature& signature, size_t entry) const {
+    if (static_cast<size_t>(__builtin_popcountll(signature.simhash ^ simhashes_[entry])) <=
+        options_.simhashDistance) {
+        return true;
+    }
+    // Only the low byte of each value is stored; 1 in 256 unrelated values agree by chance
+    const uint8_t* stored = minhashBytes_.data() + entry * hashes_;
+    size_t equal = 0;
+    for (size_t i = 0; i < hashes_; ++i) {
+        equal += static_cast<uint8_t>(signature.minhash[i]) == stored[i];
+    }
+    const double agreement = static_cast<double>(equal) / hashes_;
+    return (agreement - 1.0 / 256) / (1.0 - 1.0 / 256) >= options_.threshold;
+}
+
+uint64_t NearDuplicateIndex::find(const DocumentSignature& signature) const {
+    if (table_.empty() || signature.shingles == 0 || signature.minhash.size() != hashes_) {
+        return kNotFound;
+    }
+    std::vector<uint32_t> keys(keysPerEntry_);
+    computeKeys(signature, keys.data());
+    const uint64_t last = added_ - 1;
+    const size_t capacity = options_.capacity;
+    uint64_t best = kNotFound;
+    for (uint32_t key : keys) {
+        for (size_t i = key & mask_; table_[i].entry != kEmpty; i = (i + 1) & mask_) {
+            if (table_[i].key != key) {
+                continue;
+            }
+            const size_t entry = table_[i].entry;
+            const uint64_t number = last - ((last % capacity) + capacity - entry) % capacity;
+            if (number < best && matches(signature, entry)) {
+                best = number;
+            }
+        }
+    }
+    return best;
+}
+
+uint64_t NearDuplicateIndex::add(const DocumentSignature& signature) {
+    const size_t capacity = options_.capacity;
+    if (table_.empty()) {
+        // Sized on first use, for at most half the slots filled at capacity
+        size_t slots = 16;
+        while (slots < capacity * keysPerEntry_ * 2) {
+            slots <<= 1;
+        }
+        table_.assign(slots, Slot{0, kEmpty});
+        mask_ = slots - 1;
+        minhashBytes_.resize(capacity * hashes_);
+        simhashes_.resize(capacity);
+        keys_.resize(capacity * keysPerEntry_);
+    }
+
+    const uint64_t number = added_++;
+    const uint32_t entry = static_cast<uint32_t>(number % capacity);
+    uint32_t* keys = keys_.data() + entry * keysPerEntry_;
+    if (number >= capacity) {
+        for (size_t j = 0; j < keysPerEntry_; ++j) {
+            eraseKey(keys[j], entry);
+        }
+    }
+
+    uint8_t* bytes = minhashBytes_.data() + entry * hashes_;
+    for (size_t i = 0; i < hashes_; ++i) {
+        bytes[i] = i < signature.minhash.size() ? static_cast<uint8_t>(signature.minhash[i]) : 0;
+    }
+    simhashes_[entry] = signature.simhash;
+    if (signature.shingles == 0 || signature.minhash.size() != hashes_) {
+        // Texts without words are numbered but never matched
+        std::fill(keys, keys + keysPerEntry_, 0);
+        return number;
+    }
+    computeKeys(signature, keys);
+    for (size_t j = 0; j < keysPerEntry_; ++j) {
+        insertKey(keys[j], entry);
+    }
+    return number;
+}
+
+void NearDuplicateIndex::insertKey(uint32_t key, uint32_t entry) {
+    size_t i = key & mask_;
+    while (table_[i].entry != kEmpty) {
+        i = (i + 1) & mask_;
+    }
+    table_[i] = Slot{key, entry};
+}
+
+void NearDuplicateIndex::eraseKey(uint32_t key, uint32_t entry) {
+    size_t hole = key & mask_;
+    while (table_[hole].entry != kEmpty && (table_[hole].key != key || table_[hole].entry != entry)) {
+        hole = (hole + 1) & mask_;
+    }
+    if (table_[hole].entry == kEmpty) {
+        return;
+    }
+    // Backward-shift deletion keeps every probe run unbroken without tombstones
+    for (size_t i = (hole + 1) & mask_; table_[i].entry != kEmpty; i = (i + 1) & mask_) {
+        const size_t home = table_[i].key & mask_;
+        if (((i - home) & mask_) >= ((i - hole) & mask_)) {
+            table_[hole] = table_[i];
+            hole = i;
+        }
+    }
+    table_[hole].entry = kEmpty;
+}
+
+void NearDuplicateIndex::cluster(const std::vector<std::string_view>& texts, std::vector<size_t>& clusters) const {
+    std::vector<DocumentSignature> signatures(texts.size());
+    for (size_t i = 0; i < texts.size(); ++i) {
+        sign(texts[i], signatures[i]);
+    }
+    cluster(signatures, clusters);
+}
+
+void NearDuplicateIndex::cluster(const std::vector<DocumentSignature>& signatures,
+                                 std::vector<size_t>& clusters) const {
+    NearDuplicateOptions options = options_;
+    options.capacity = std::max<size_t>(signatures.size(), 1);
+    NearDuplicateIndex scratch(options);
+    clusters.resize(signatures.size());
+    for (size_t i = 0; i < signatures.size(); ++i) {
+        const uint64_t match = scratch.find(signatures[i]);
+        clusters[i] = match == kNotFound ? i : clusters[match];
+        scratch.add(signatures[i]);
+    }
+}
+
+size_t NearDuplicateIndex::size() const {
+    return static_cast<size_t>(std::min<uint64_t>(added_, options_.capacity));
+}
+
+void NearDuplicateIndex::clear() {
+    added_ = 0;
+    std::fill(table_.begin(), table_.end(), Slot{0, kEmpty});
+}
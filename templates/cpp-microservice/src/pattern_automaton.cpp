@@ -0,0 +1,670 @@
+#include "pattern_automaton.h"
+#include "unicode_util.h"
+#include <algorithm>
+#include <iostream>
+#include <map>
+
+namespace {
+
+const int32_t kDead = 0;
+const int32_t kStart = 1;
+const size_t kMaxStates = 1 << 16;
+const size_t kMaxRangeSize = 512;
+
+// Character classes a set can include wholesale
+const uint8_t kWordClass = 1;
+const uint8_t kDigitClass = 2;
+const uint8_t kSpaceClass = 4;
+
+const uint32_t kNoCodePoint = 0xFFFFFFFFu;
+
+uint8_t classesOf(uint32_t cp) {
+    uint8_t classes = 0;
+    if (cp == '_' || isUnicodeAlnum(cp)) {
+        classes |= kWordClass;
+    }
+    if (isUnicodeDecimal(cp)) {
+        classes |= kDigitClass;
+    }
+    if (isPythonWhitespace(cp)) {
+        classes |= kSpaceClass;
+    }
+    return classes;
+}
+
+struct Node {
+    enum Kind { kSet, kEnd, kBoundary, kConcat, kAlternation, kRepeat };
+
+    Kind kind = kSet;
+    std::vector<uint32_t> codePoints;    // kSet members
+    uint8_t classes = 0;                 // kSet members, as k*Class bits
+    bool negated = false;
+    std::vector<Node> children;
+    int min = 0;
+    int max = 0;                         // kRepeat; negative is unbounded
+};
+
+Node setOf(uint32_t cp) {
+    Node node;
+    node.codePoints.push_back(cp);
+    return node;
+}
+
+class Parser {
+public:
+    explicit Parser(std::string_view pattern)
+        : begin_(pattern.data()), p_(pattern.data()), end_(pattern.data() + pattern.size()) {
+    }
+
+    bool parse(Node& root) {
+        if (p_ < end_ && *p_ == '^') {
+            ++p_;
+        }
+        if (!parseAlternation(root)) {
+            return false;
+        }
+        return p_ == end_ || fail("unbalanced ')'");
+    }
+
+    const std::string& error() const { return error_; }
+
+private:
+    const char* begin_;
+    const char* p_;
+    const char* end_;
+    std::string error_;
+
+    bool fail(const char* message) {
+        error_ = std::string(message) + " at offset " + std::to_string(p_ - begin_);
+        return false;
+    }
+
+    bool parseAlternation(Node& out) {
+        out.kind = Node::kAlternation;
+        while (true) {
+            out.children.emplace_back();
+            if (!parseConcat(out.children.back())) {
+                return false;
+            }
+            if (p_ == end_ || *p_ != '|') {
+                return true;
+            }
+            ++p_;
+        }
+    }
+
+    bool parseConcat(Node& out) {
+        out.kind = Node::kConcat;
+        while (p_ < end_ && *p_ != '|' && *p_ != ')') {
+            Node atom;
+            if (!parseAtom(atom) || !parseQuantifier(atom)) {
+                return false;
+            }
+            out.children.push_back(std::move(atom));
+        }
+        return true;
+    }
+
+    bool parseQuantifier(Node& atom) {
+        if (p_ == end_) {
+            return true;
+        }
+        int min = 0;
+        int max = 0;
+        switch (*p_) {
+        case '*':
+            min = 0;
+            max = -1;
+            ++p_;
+            break;
+        case '+':
+            min = 1;
+            max = -1;
+            ++p_;
+            break;
+        case '?':
+            min = 0;
+            max = 1;
+            ++p_;
+            break;
+        case '{':
+            ++p_;
+            if (!parseNumber(min)) {
+                return fail("bad repeat count");
+            }
+            max = min;
+            if (p_ < end_ && *p_ == ',') {
+                ++p_;
+                max = -1;
+                if (p_ < end_ && *p_ != '}' && !parseNumber(max)) {
+                    return fail("bad repeat count");
+                }
+            }
+            if (p_ == end_ || *p_ != '}' || (max >= 0 && max < min)) {
+                return fail("bad repeat count");
+            }
+            ++p_;
+            break;
+        default:
+            return true;
+        }
+        // Lazy and greedy forms accept the same texts
+        if (p_ < end_ && *p_ == '?') {
+            ++p_;
+        }
+        Node repeat;
+        repeat.kind = Node::kRepeat;
+        repeat.min = min;
+        repeat.max = max;
+        repeat.children.push_back(std::move(atom));
+        atom = std::move(repeat);
+        return true;
+    }
+
+    bool parseNumber(int& value) {
+        if (p_ == end_ || *p_ < '0' || *p_ > '9') {
+            return false;
+        }
+        value = 0;
+        while (p_ < end_ && *p_ >= '0' && *p_ <= '9' && value < 1000) {
+            value = value * 10 + (*p_++ - '0');
+        }
+        return true;
+    }
+
+    bool parseAtom(Node& out) {
+        switch (*p_) {
+        case '(':
+            ++p_;
+            if (end_ - p_ >= 2 && p_[0] == '?' && p_[1] == ':') {
+                p_ += 2;
+            }
+            if (!parseAlternation(out)) {
+                return false;
+            }
+            if (p_ == end_ || *p_ != ')') {
+                return fail("missing ')'");
+            }
+            ++p_;
+            return true;
+        case '[':
+            ++p_;
+            return parseSet(out);
+        case '.':
+            ++p_;
+            out = setOf('\n');
+            out.negated = true;
+            return true;
+        case '$':
+            ++p_;
+            out.kind = Node::kEnd;
+            return true;
+        case '\\':
+            ++p_;
+            return parseEscape(out, false);
+        case '*':
+        case '+':
+        case '?':
+        case '{':
+            return fail("nothing to repeat");
+        case '^':
+            return fail("'^' is only supported at the start");
+        default:
+            out = setOf(decodeUtf8(p_, end_));
+            return true;
+        }
+    }
+
+    bool parseEscape(Node& out, bool inSet) {
+        if (p_ == end_) {
+            return fail("trailing '\\'");
+        }
+        const char c = *p_++;
+        switch (c) {
+        case 's':
+        case 'S':
+        case 'd':
+        case 'D':
+        case 'w':
+        case 'W':
+            out = Node();
+            out.classes = (c == 's' || c == 'S') ? kSpaceClass : (c == 'd' || c == 'D') ? kDigitClass : kWordClass;
+            out.negated = c >= 'A' && c <= 'Z';
+            return !(inSet && out.negated) || fail("negated class inside a set");
+        case 'b':
+            if (inSet) {
+                out = setOf('\b');
+                return true;
+            }
+            // Consumes the character after the word, so it has to come last
+            out.kind = Node::kBoundary;
+            return p_ == end_ || fail("\\b is only supported at the end");
+        case 't':
+            out = setOf('\t');
+            return true;
+        case 'n':
+            out = setOf('\n');
+            return true;
+        case 'r':
+            out = setOf('\r');
+            return true;
+        case 'f':
+            out = setOf('\f');
+            return true;
+        case 'v':
+            out = setOf('\v');
+            return true;
+        default:
+            if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+                --p_;
+                return fail("unsupported escape");
+            }
+            --p_;
+            out = setOf(decodeUtf8(p_, end_));
+            return true;
+        }
+    }
+
+    bool parseSet(Node& out) {
+        out = Node();
+        if (p_ < end_ && *p_ == '^') {
+            out.negated = true;
+            ++p_;
+        }
+        bool first = true;
+        while (p_ < end_ && (*p_ != ']' || first)) {
+            first = false;
+            uint32_t low;
+            if (*p_ == '\\') {
+                ++p_;
+                Node member;
+                if (!parseEscape(member, true)) {
+                    return false;
+                }
+                out.classes |= member.classes;
+                if (member.codePoints.empty()) {
+                    continue;
+                }
+                low = member.codePoints[0];
+            } else {
+                low = decodeUtf8(p_, end_);
+            }
+
+            if (end_ - p_ >= 2 && p_[0] == '-' && p_[1] != ']') {
+                ++p_;
+                uint32_t high;
+                if (*p_ == '\\') {
+                    ++p_;
+                    Node member;
+                    if (!parseEscape(member, true) || member.codePoints.empty()) {
+                        return fail("bad range");
+                    }
+                    high = member.codePoints[0];
+                } else {
+                    high = decodeUtf8(p_, end_);
+                }
+                if (high < low || high - low >= kMaxRangeSize) {
+                    return fail("range too large");
+                }
+                for (uint32_t cp = low; cp <= high; ++cp) {
+                    out.codePoints.push_back(cp);
+                }
+            } else {
+                out.codePoints.push_back(low);
+            }
+        }
+        if (p_ == end_) {
+            return fail("missing ']'");
+        }
+        ++p_;
+        return true;
+    }
+};
+
+struct SymbolInfo {
+    uint32_t codePoint;    // kNoCodePoint for the catch-all symbols
+    uint8_t classes;
+};
+
+uint32_t foldCodePoint(uint32_t cp, PatternAutomaton::CaseMode mode) {
+    switch (mode) {
+    case PatternAutomaton::kIgnoreCase:
+        // The non-ASCII letters re.IGNORECASE matches to ASCII ones
+        if (cp == 0x130 || cp == 0x131) {
+            return 'i';
+        }
+        if (cp == 0x17F) {
+            return 's';
+        }
+        if (cp == 0x212A) {
+            return 'k';
+        }
+        return toLowerCodePoint(cp);
+    case PatternAutomaton::kLowerCase:
+        if (cp == 0x212A) {
+            return 'k';
+        }
+        // lower() turns it into two code points, so it equals no literal
+        if (cp == 0x130) {
+            return cp;
+        }
+        return toLowerCodePoint(cp);
+    default:
+        return cp;
+    }
+}
+
+struct NfaState {
+    std::vector<uint8_t> accepts;    // Per symbol; empty for states with only epsilon moves
+    int32_t next = -1;
+    std::vector<int32_t> epsilon;
+    bool final = false;
+};
+
+// Thompson construction, compiling each node backwards onto its continuation
+class NfaBuilder {
+public:
+    NfaBuilder(const std::vector<SymbolInfo>& symbols, uint16_t endSymbol, PatternAutomaton::CaseMode mode)
+        : symbols_(symbols), endSymbol_(endSymbol), mode_(mode) {
+    }
+
+    std::vector<NfaState> states;
+
+    int32_t add() {
+        states.emplace_back();
+        return static_cast<int32_t>(states.size() - 1);
+    }
+
+    int32_t build(const Node& node, int32_t target) {
+        switch (node.kind) {
+        case Node::kSet: {
+            const int32_t s = add();
+            states[s].accepts = members(node);
+            states[s].next = target;
+            return s;
+        }
+        case Node::kEnd: {
+            const int32_t s = add();
+            states[s].accepts.assign(symbols_.size(), 0);
+            states[s].accepts[endSymbol_] = 1;
+            states[s].next = target;
+            return s;
+        }
+        case Node::kBoundary: {
+            // Any non-word symbol or the end of the text
+            Node nonWord;
+            nonWord.classes = kWordClass;
+            nonWord.negated = true;
+            const int32_t s = add();
+            states[s].accepts = members(nonWord);
+            states[s].accepts[endSymbol_] = 1;
+            states[s].next = target;
+            return s;
+        }
+        case Node::kConcat:
+            for (auto it = node.children.rbegin(); it != node.children.rend(); ++it) {
+                target = build(*it, target);
+            }
+            return target;
+        case Node::kAlternation: {
+            if (node.children.size() == 1) {
+                return build(node.children[0], target);
+            }
+            std::vector<int32_t> starts;
+            for (const Node& child : node.children) {
+                starts.push_back(build(child, target));
+            }
+            const int32_t s = add();
+            states[s].epsilon = starts;
+            return s;
+        }
+        case Node::kRepeat: {
+            const Node& child = node.children[0];
+            int32_t tail = target;
+            if (node.max < 0) {
+                const int32_t loop = add();
+                const int32_t body = build(child, loop);
+                states[loop].epsilon = {body, target};
+                tail = loop;
+            } else {
+                for (int i = node.min; i < node.max; ++i) {
+                    const int32_t optional = add();
+                    const int32_t body = build(child, tail);
+                    states[optional].epsilon = {body, target};
+                    tail = optional;
+                }
+            }
+            for (int i = 0; i < node.min; ++i) {
+                tail = build(child, tail);
+            }
+            return tail;
+        }
+        }
+        return target;
+    }
+
+private:
+    const std::vector<SymbolInfo>& symbols_;
+    uint16_t endSymbol_;
+    PatternAutomaton::CaseMode mode_;
+
+    std::vector<uint8_t> members(const Node& node) const {
+        std::vector<uint32_t> folded;
+        for (uint32_t cp : node.codePoints) {
+            folded.push_back(foldCodePoint(cp, mode_));
+        }
+        std::sort(folded.begin(), folded.end());
+        std::vector<uint8_t> accepts(symbols_.size(), 0);
+        for (size_t s = 0; s < symbols_.size(); ++s) {
+            if (s == endSymbol_) {
+                continue;
+            }
+            const SymbolInfo& info = symbols_[s];
+            bool member = (info.classes & node.classes) != 0 ||
+                          (info.codePoint != kNoCodePoint &&
+                           std::binary_search(folded.begin(), folded.end(), info.codePoint));
+            accepts[s] = member != node.negated;
+        }
+        return accepts;
+    }
+};
+
+void collectLiterals(const Node& node, std::vector<uint32_t>& out) {
+    out.insert(out.end(), node.codePoints.begin(), node.codePoints.end());
+    for (const Node& child : node.children) {
+        collectLiterals(child, out);
+    }
+}
+
+void closure(const std::vector<NfaState>& nfa, std::vector<int32_t>& set) {
+    std::vector<uint8_t> seen(nfa.size(), 0);
+    std::vector<int32_t> stack(set);
+    set.clear();
+    while (!stack.empty()) {
+        const int32_t s = stack.back();
+        stack.pop_back();
+        if (seen[s]) {
+            continue;
+        }
+        seen[s] = 1;
+        set.push_back(s);
+        for (int32_t e : nfa[s].epsilon) {
+            stack.push_back(e);
+        }
+    }
+    std::sort(set.begin(), set.end());
+}
+
+} // namespace
+
+PatternAutomaton::PatternAutomaton()
+    : mode_(kExactCase), symbolCount_(0), digitSymbol_(0), wordSymbol_(0), spaceSymbol_(0), otherSymbol_(0),
+      endSymbol_(0) {
+    compile({});
+}
+
+uint32_t PatternAutomaton::fold(uint32_t cp) const {
+    return foldCodePoint(cp, mode_);
+}
+
+bool PatternAutomaton::compile(const std::vector<std::string>& patterns, CaseMode mode) {
+    std::vector<Node> roots(patterns.size());
+    for (size_t i = 0; i < patterns.size(); ++i) {
+        Parser parser(patterns[i]);
+        if (!parser.parse(roots[i])) {
+            std::cerr << "Bad pattern '" << patterns[i] << "': " << parser.error() << std::endl;
+            return false;
+        }
+    }
+
+    // Alphabet: every distinct folded literal (and newline, which `.`
+    // excludes), then the catch-all classes and the end of the text
+    std::vector<uint32_t> literals = {'\n'};
+    for (const Node& root : roots) {
+        collectLiterals(root, literals);
+    }
+    for (uint32_t& cp : literals) {
+        cp = foldCodePoint(cp, mode);
+    }
+    std::sort(literals.begin(), literals.end());
+    literals.erase(std::unique(literals.begin(), literals.end()), literals.end());
+
+    std::vector<SymbolInfo> symbols;
+    for (uint32_t cp : literals) {
+        symbols.push_back({cp, classesOf(cp)});
+    }
+    const uint16_t digitSymbol = static_cast<uint16_t>(symbols.size());
+    symbols.push_back({kNoCodePoint, static_cast<uint8_t>(kDigitClass | kWordClass)});
+    symbols.push_back({kNoCodePoint, kWordClass});
+    symbols.push_back({kNoCodePoint, kSpaceClass});
+    symbols.push_back({kNoCodePoint, 0});
+    symbols.push_back({kNoCodePoint, 0});
+    const uint16_t endSymbol = static_cast<uint16_t>(symbols.size() - 1);
+
+    // One NFA for all patterns, entered through a shared start state
+    NfaBuilder builder(symbols, endSymbol, mode);
+    std::vector<int32_t> starts;
+    for (const Node& root : roots) {
+        const int32_t accept = builder.add();
+        builder.states[accept].final = true;
+        starts.push_back(builder.build(root, accept));
+    }
+    const std::vector<NfaState>& nfa = builder.states;
+
+    // Subset construction; state 0 is dead, state 1 the start
+    std::map<std::vector<int32_t>, int32_t> ids;
+    std::vector<std::vector<int32_t>> sets = {{}, starts};
+    closure(nfa, sets[kStart]);
+    ids[sets[kDead]] = kDead;
+    ids[sets[kStart]] = kStart;
+    std::vector<int32_t> transitions;
+    std::vector<uint8_t> accepting;
+    for (size_t d = 0; d < sets.size(); ++d) {
+        bool final = false;
+        for (int32_t s : sets[d]) {
+            final = final || nfa[s].final;
+        }
+        accepting.push_back(final);
+        transitions.resize((d + 1) * symbols.size(), kDead);
+        if (final || d == kDead) {
+            // Matching stops at the first accepting state
+            continue;
+        }
+        for (size_t symbol = 0; symbol < symbols.size(); ++symbol) {
+            std::vector<int32_t> next;
+            for (int32_t s : sets[d]) {
+                if (!nfa[s].accepts.empty() && nfa[s].accepts[symbol]) {
+                    next.push_back(nfa[s].next);
+                }
+            }
+            if (next.empty()) {
+                continue;
+            }
+            closure(nfa, next);
+            auto found = ids.find(next);
+            int32_t id;
+            if (found != ids.end()) {
+                id = found->second;
+            } else {
+                if (sets.size() >= kMaxStates) {
+                    std::cerr << "Pattern set needs more than " << kMaxStates << " DFA states" << std::endl;
+                    return false;
+                }
+                id = static_cast<int32_t>(sets.size());
+                ids.emplace(next, id);
+                sets.push_back(std::move(next));
+            }
+            transitions[d * symbols.size() + symbol] = id;
+        }
+    }
+
+    mode_ = mode;
+    symbolCount_ = symbols.size();
+    digitSymbol_ = digitSymbol;
+    wordSymbol_ = digitSymbol + 1;
+    spaceSymbol_ = digitSymbol + 2;
+    otherSymbol_ = digitSymbol + 3;
+    endSymbol_ = endSymbol;
+    wideSymbols_.clear();
+    for (size_t s = 0; s < literals.size(); ++s) {
+        if (literals[s] >= 0x80) {
+            wideSymbols_.emplace_back(literals[s], static_cast<uint16_t>(s));
+        }
+    }
+    for (uint32_t c = 0; c < 128; ++c) {
+        const uint32_t folded = fold(c);
+        auto it = std::lower_bound(literals.begin(), literals.end(), folded);
+        asciiSymbols_[c] = it != literals.end() && *it == folded ? static_cast<uint16_t>(it - literals.begin())
+                                                                 : symbolOf(c);
+    }
+    transitions_ = std::move(transitions);
+    accepting_ = std::move(accepting);
+    return true;
+}
+
+uint16_t PatternAutomaton::symbolOf(uint32_t cp) const {
+    const uint32_t folded = fold(cp);
+    if (folded < 0x80 && cp >= 0x80) {
+        return asciiSymbols_[folded];
+    }
+    auto it = std::lower_bound(wideSymbols_.begin(), wideSymbols_.end(), std::make_pair(folded, uint16_t(0)));
+    if (it != wideSymbols_.end() && it->first == folded) {
+        return it->second;
+    }
+    const uint8_t classes = classesOf(cp);
+    if (classes & kDigitClass) {
+        return digitSymbol_;
+    }
+    if (classes & kWordClass) {
+        return wordSymbol_;
+    }
+    return (classes & kSpaceClass) ? spaceSymbol_ : otherSymbol_;
+}
+
+bool PatternAutomaton::matches(std::string_view text) const {
+    if (accepting_[kStart]) {
+        return true;
+    }
+    const int32_t* table = transitions_.data();
+    const char* p = text.data();
+    const char* end = p + text.size();
+    int32_t state = kStart;
+    while (p < end) {
+        const unsigned char c = static_cast<unsigned char>(*p);
+        uint16_t symbol;
+        if (c < 0x80) {
+            symbol = asciiSymbols_[c];
+            ++p;
+        } else {
+            symbol = symbolOf(decodeUtf8(p, end));
+        }
+        state = table[state * symbolCount_ + symbol];
+        if (state == kDead) {
+            return false;
+        }
+        if (accepting_[state]) {
+            return true;
+        }
+    }
+    return accepting_[table[state * symbolCount_ + endSymbol_]];
+}
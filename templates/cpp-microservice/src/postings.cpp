@@ -0,0 +1,201 @@
+#include "postings.h"
+#include "file_util.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+uint32_t bitWidth(uint32_t value) {
+    return value ? 32 - static_cast<uint32_t>(__builtin_clz(value)) : 0;
+}
+
+// Packs kPostingBlockSize values of `bits` bits each, little-endian bit order
+void packBlock(const uint32_t* values, uint32_t bits, std::string& out) {
+    uint64_t buffer = 0;
+    uint32_t filled = 0;
+    for (uint32_t i = 0; i < kPostingBlockSize; ++i) {
+        buffer |= static_cast<uint64_t>(values[i]) << filled;
+        filled += bits;
+        while (filled >= 8) {
+            out.push_back(static_cast<char>(buffer & 0xFF));
+            buffer >>= 8;
+            filled -= 8;
+        }
+    }
+}
+
+// Reads 8 bytes at a time, so a packed block must be followed by at least 7 readable bytes
+void unpackBlock(const uint8_t* data, uint32_t bits, uint32_t* values) {
+    if (bits == 0) {
+        std::fill(values, values + kPostingBlockSize, 0u);
+        return;
+    }
+    const uint64_t mask = (uint64_t(1) << bits) - 1;
+    uint32_t bit = 0;
+    for (uint32_t i = 0; i < kPostingBlockSize; ++i, bit += bits) {
+        values[i] = static_cast<uint32_t>((readRaw<uint64_t>(data + (bit >> 3)) >> (bit & 7)) & mask);
+    }
+}
+
+void appendVarint(std::string& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+uint32_t readVarint(const uint8_t*& p) {
+    uint32_t value = 0;
+    for (uint32_t shift = 0;; shift += 7) {
+        const uint8_t byte = *p++;
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80) || shift >= 28) {
+            return value;
+        }
+    }
+}
+
+} // namespace
+
+void encodePostings(const uint32_t* docs, const uint32_t* freqs, size_t n, const uint32_t* lengths,
+                    std::string& out, PostingSummary& summary) {
+    out.append((4 - out.size() % 4) % 4, '\0');
+    const size_t blockCount = (n + kPostingBlockSize - 1) / kPostingBlockSize;
+    const size_t table = out.size();
+    out.append(blockCount * sizeof(PostingBlock), '\0');
+    const size_t dataStart = out.size();
+
+    summary = PostingSummary{static_cast<uint32_t>(n), 0, UINT32_MAX};
+    uint32_t gaps[kPostingBlockSize];
+    uint32_t values[kPostingBlockSize];
+    uint32_t previous = UINT32_MAX;    // So that the first gap is the document itself
+    for (size_t b = 0; b < blockCount; ++b) {
+        const size_t first = b * kPostingBlockSize;
+        const size_t count = std::min<size_t>(kPostingBlockSize, n - first);
+        PostingBlock block{docs[first + count - 1], static_cast<uint32_t>(out.size() - dataStart), 0, UINT32_MAX};
+        uint32_t gapBits = 0;
+        uint32_t freqBits = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const uint32_t doc = docs[first + i];
+            gaps[i] = doc - previous - 1;
+            values[i] = freqs[first + i] - 1;
+            previous = doc;
+            block.maxFreq = std::max(block.maxFreq, freqs[first + i]);
+            block.minLength = std::min(block.minLength, lengths[doc]);
+            gapBits = std::max(gapBits, bitWidth(gaps[i]));
+            freqBits = std::max(freqBits, bitWidth(values[i]));
+        }
+
+        if (count == kPostingBlockSize) {
+            out.push_back(static_cast<char>(gapBits));
+            out.push_back(static_cast<char>(freqBits));
+            packBlock(gaps, gapBits, out);
+            packBlock(values, freqBits, out);
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                appendVarint(out, gaps[i]);
+                appendVarint(out, values[i]);
+            }
+        }
+        std::memcpy(&out[table + b * sizeof(PostingBlock)], &block, sizeof(block));
+        summary.maxFreq = std::max(summary.maxFreq, block.maxFreq);
+        summary.minLength = std::min(summary.minLength, block.minLength);
+    }
+    if (n % kPostingBlockSize == 0 && n > 0) {
+        out.append(8, '\0');    // unpackBlock reads past the end of a full last block
+    }
+}
+
+PostingCursor::PostingCursor()
+    : blocks_(nullptr), data_(nullptr), blockCount_(0), docFreq_(0), block_(0), shallow_(0), pos_(0), count_(0),
+      doc_(kEnd) {
+    freqs_[0] = 0;
+}
+
+void PostingCursor::reset(const uint8_t* postings, uint32_t docFreq) {
+    blocks_ = reinterpret_cast<const PostingBlock*>(postings);
+    blockCount_ = (docFreq + kPostingBlockSize - 1) / kPostingBlockSize;
+    data_ = postings + blockCount_ * sizeof(PostingBlock);
+    docFreq_ = docFreq;
+    shallow_ = 0;
+    if (blockCount_ == 0) {
+        doc_ = kEnd;
+        return;
+    }
+    decode(0);
+}
+
+void PostingCursor::decode(uint32_t block) {
+    block_ = block;
+    shallow_ = std::max(shallow_, block);
+    pos_ = 0;
+    count_ = block + 1 < blockCount_ ? kPostingBlockSize : docFreq_ - block * kPostingBlockSize;
+
+    const uint8_t* p = data_ + blocks_[block].offset;
+    if (count_ == kPostingBlockSize) {
+        const uint32_t gapBits = p[0];
+        const uint32_t freqBits = p[1];
+        unpackBlock(p + 2, gapBits, docs_);
+        unpackBlock(p + 2 + gapBits * (kPostingBlockSize / 8), freqBits, freqs_);
+    } else {
+        for (uint32_t i = 0; i < count_; ++i) {
+            docs_[i] = readVarint(p);
+            freqs_[i] = readVarint(p);
+        }
+    }
+
+    uint32_t doc = block == 0 ? UINT32_MAX : blocks_[block - 1].lastDoc;
+    for (uint32_t i = 0; i < count_; ++i) {
+        doc += docs_[i] + 1;
+        docs_[i] = doc;
+        freqs_[i] += 1;
+    }
+    doc_ = docs_[0];
+}
+
+void PostingCursor::next() {
+    if (++pos_ < count_) {
+        doc_ = docs_[pos_];
+    } else if (block_ + 1 < blockCount_) {
+        decode(block_ + 1);
+    } else {
+        doc_ = kEnd;
+    }
+}
+
+void PostingCursor::advance(uint32_t target) {
+    if (doc_ >= target) {
+        return;
+    }
+    if (target > blocks_[block_].lastDoc) {
+        const PostingBlock* found =
+            std::lower_bound(blocks_ + block_ + 1, blocks_ + blockCount_, target,
+                             [](const PostingBlock& block, uint32_t doc) { return block.lastDoc < doc; });
+        if (found == blocks_ + blockCount_) {
+            doc_ = kEnd;
+            return;
+        }
+        decode(static_cast<uint32_t>(found - blocks_));
+    }
+    while (docs_[pos_] < target) {
+        ++pos_;
+    }
+    doc_ = docs_[pos_];
+}
+
+const PostingBlock* PostingCursor::shallowAdvance(uint32_t target) {
+    if (blockCount_ == 0) {
+        return nullptr;
+    }
+    if (blocks_[shallow_].lastDoc < target) {
+        const PostingBlock* found =
+            std::lower_bound(blocks_ + shallow_, blocks_ + blockCount_, target,
+                             [](const PostingBlock& block, uint32_t doc) { return block.lastDoc < doc; });
+        if (found == blocks_ + blockCount_) {
+            return nullptr;
+        }
+        shallow_ = static_cast<uint32_t>(found - blocks_);
+    }
+    return blocks_ + shallow_;
+}
@@ -0,0 +1,341 @@
+#include "quantization.h"
+#include "file_util.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+
+namespace {
+
+// Training cost grows linearly with the sample; this many rows is plenty for 256 centroids
+const size_t kMaxTrainingRows = 20000;
+const int kTrainingIterations = 10;
+
+template <typename T>
+bool readRaw(const uint8_t*& p, const uint8_t* end, T& value) {
+    if (static_cast<size_t>(end - p) < sizeof(T)) {
+        return false;
+    }
+    std::memcpy(&value, p, sizeof(T));
+    p += sizeof(T);
+    return true;
+}
+
+bool readFloats(const uint8_t*& p, const uint8_t* end, std::vector<float>& out, size_t count) {
+    if (static_cast<size_t>(end - p) < count * sizeof(float)) {
+        return false;
+    }
+    out.resize(count);
+    std::memcpy(out.data(), p, count * sizeof(float));
+    p += count * sizeof(float);
+    return true;
+}
+
+void appendFloats(std::string& out, const std::vector<float>& values) {
+    out.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(float));
+}
+
+} // namespace
+
+QuantizerType parseQuantizerType(const std::string& name) {
+    if (name == "sq8" || name == "int8" || name == "scalar") {
+        return QuantizerType::Scalar8;
+    }
+    if (name == "pq" || name == "product") {
+        return QuantizerType::Product;
+    }
+    return QuantizerType::None;
+}
+
+// ─── VectorQuantizer ────────────────────────────────────────────────────────
+
+VectorQuantizer::VectorQuantizer(DistanceMetric metric, uint32_t dim) : metric_(metric), dim_(dim) {}
+
+VectorQuantizer::~VectorQuantizer() {
+    // Destructor implementation
+}
+
+void VectorQuantizer::serialize(std::string& out) const {
+    appendRaw<uint32_t>(out, static_cast<uint32_t>(type()));
+    appendRaw<uint32_t>(out, static_cast<uint32_t>(metric_));
+    appendRaw<uint32_t>(out, dim_);
+    serializeParams(out);
+}
+
+std::unique_ptr<VectorQuantizer> VectorQuantizer::deserialize(const uint8_t* data, size_t size) {
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+    uint32_t type = 0, metric = 0, dim = 0;
+    if (!readRaw(p, end, type) || !readRaw(p, end, metric) || !readRaw(p, end, dim) || dim == 0) {
+        return nullptr;
+    }
+    std::unique_ptr<VectorQuantizer> quantizer =
+        create(static_cast<QuantizerType>(type), static_cast<DistanceMetric>(metric), dim, 1);
+    if (!quantizer || !quantizer->deserializeParams(p, static_cast<size_t>(end - p))) {
+        return nullptr;
+    }
+    return quantizer;
+}
+
+std::unique_ptr<VectorQuantizer> VectorQuantizer::create(QuantizerType type, DistanceMetric metric, uint32_t dim,
+                                                         uint32_t subspaces) {
+    switch (type) {
+    case QuantizerType::Scalar8:
+        return std::unique_ptr<VectorQuantizer>(new ScalarQuantizer(metric, dim));
+    case QuantizerType::Product: {
+        // Default to 4 dimensions per code byte (16x smaller than float32)
+        uint32_t m = subspaces ? std::min(subspaces, dim) : std::max<uint32_t>(1, dim / 4);
+        while (dim % m != 0) {
+            --m;
+        }
+        return std::unique_ptr<VectorQuantizer>(new ProductQuantizer(metric, dim, m));
+    }
+    default:
+        return nullptr;
+    }
+}
+
+// ─── ScalarQuantizer ────────────────────────────────────────────────────────
+
+ScalarQuantizer::ScalarQuantizer(DistanceMetric metric, uint32_t dim)
+    : VectorQuantizer(metric, dim), min_(dim, 0.0f), step_(dim, 1.0f) {}
+
+bool ScalarQuantizer::train(const float* vectors, size_t count) {
+    if (count == 0) {
+        return false;
+    }
+    std::vector<float> max(dim_, std::numeric_limits<float>::lowest());
+    std::fill(min_.begin(), min_.end(), std::numeric_limits<float>::max());
+    for (size_t i = 0; i < count; ++i) {
+        const float* v = vectors + i * dim_;
+        for (uint32_t d = 0; d < dim_; ++d) {
+            min_[d] = std::min(min_[d], v[d]);
+            max[d] = std::max(max[d], v[d]);
+        }
+    }
+    for (uint32_t d = 0; d < dim_; ++d) {
+        float range = max[d] - min_[d];
+        step_[d] = range > 0.0f ? range / 255.0f : 1.0f;
+    }
+    return true;
+}
+
+void ScalarQuantizer::encode(const float* vector, uint8_t* code) const {
+    for (uint32_t d = 0; d < dim_; ++d) {
+        float q = std::round((vector[d] - min_[d]) / step_[d]);
+        code[d] = static_cast<uint8_t>(std::min(255.0f, std::max(0.0f, q)));
+    }
+}
+
+void ScalarQuantizer::decode(const uint8_t* code, float* vector) const {
+    for (uint32_t d = 0; d < dim_; ++d) {
+        vector[d] = min_[d] + code[d] * step_[d];
+    }
+}
+
+void ScalarQuantizer::prepareQuery(const float* query, std::vector<float>& table) const {
+    if (metric_ == DistanceMetric::Cosine) {
+        // dot(q, min + c*step) = dot(q, min) + sum(q*step * c)
+        table.resize(dim_ + 1);
+        float bias = 0.0f;
+        for (uint32_t d = 0; d < dim_; ++d) {
+            table[d] = query[d] * step_[d];
+            bias += query[d] * min_[d];
+        }
+        table[dim_] = bias;
+    } else {
+        // (q - min - c*step)^2, with q - min precomputed and step appended
+        table.resize(2 * dim_);
+        for (uint32_t d = 0; d < dim_; ++d) {
+            table[d] = query[d] - min_[d];
+            table[dim_ + d] = step_[d];
+        }
+    }
+}
+
+float ScalarQuantizer::distance(const std::vector<float>& table, const uint8_t* code) const {
+    const float* t = table.data();
+    float sum = 0.0f;
+    if (metric_ == DistanceMetric::Cosine) {
+        for (uint32_t d = 0; d < dim_; ++d) {
+            sum += t[d] * static_cast<float>(code[d]);
+        }
+        return 1.0f - (sum + t[dim_]);
+    }
+    const float* step = t + dim_;
+    for (uint32_t d = 0; d < dim_; ++d) {
+        float diff = t[d] - static_cast<float>(code[d]) * step[d];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+void ScalarQuantizer::serializeParams(std::string& out) const {
+    appendFloats(out, min_);
+    appendFloats(out, step_);
+}
+
+bool ScalarQuantizer::deserializeParams(const uint8_t* data, size_t size) {
+    const uint8_t* end = data + size;
+    return readFloats(data, end, min_, dim_) && readFloats(data, end, step_, dim_);
+}
+
+// ─── ProductQuantizer ───────────────────────────────────────────────────────
+
+ProductQuantizer::ProductQuantizer(DistanceMetric metric, uint32_t dim, uint32_t subspaces)
+    : VectorQuantizer(metric, dim), subspaces_(subspaces), subDim_(dim / subspaces),
+      centroids_(static_cast<size_t>(subspaces) * kCentroids * (dim / subspaces), 0.0f) {}
+
+bool ProductQuantizer::train(const float* vectors, size_t count) {
+    if (count == 0) {
+        return false;
+    }
+
+    // Evenly strided sample so training time does not grow with the index
+    size_t stride = std::max<size_t>(1, count / kMaxTrainingRows);
+    size_t samples = (count + stride - 1) / stride;
+    std::vector<float> sub(samples * subDim_);
+    std::vector<float> centroids;
+
+    for (uint32_t m = 0; m < subspaces_; ++m) {
+        for (size_t i = 0; i < samples; ++i) {
+            std::memcpy(sub.data() + i * subDim_, vectors + (i * stride) * dim_ + m * subDim_,
+                        subDim_ * sizeof(float));
+        }
+        kmeans(sub.data(), samples, subDim_, kCentroids, kTrainingIterations, 1234 + m, centroids);
+        std::memcpy(centroids_.data() + static_cast<size_t>(m) * kCentroids * subDim_, centroids.data(),
+                    centroids.size() * sizeof(float));
+    }
+    return true;
+}
+
+void ProductQuantizer::encode(const float* vector, uint8_t* code) const {
+    for (uint32_t m = 0; m < subspaces_; ++m) {
+        const float* sub = vector + m * subDim_;
+        uint32_t best = 0;
+        float bestDistance = std::numeric_limits<float>::max();
+        for (uint32_t c = 0; c < kCentroids; ++c) {
+            float d = squaredL2(sub, centroid(m, c), subDim_);
+            if (d < bestDistance) {
+                bestDistance = d;
+                best = c;
+            }
+        }
+        code[m] = static_cast<uint8_t>(best);
+    }
+}
+
+void ProductQuantizer::decode(const uint8_t* code, float* vector) const {
+    for (uint32_t m = 0; m < subspaces_; ++m) {
+        std::memcpy(vector + m * subDim_, centroid(m, code[m]), subDim_ * sizeof(float));
+    }
+}
+
+void ProductQuantizer::prepareQuery(const float* query, std::vector<float>& table) const {
+    // One row of partial distances (or partial dot products) per subspace
+    table.resize(static_cast<size_t>(subspaces_) * kCentroids);
+    for (uint32_t m = 0; m < subspaces_; ++m) {
+        const float* sub = query + m * subDim_;
+        float* row = table.data() + static_cast<size_t>(m) * kCentroids;
+        for (uint32_t c = 0; c < kCentroids; ++c) {
+            row[c] = metric_ == DistanceMetric::Cosine ? dotProduct(sub, centroid(m, c), subDim_)
+                                                        : squaredL2(sub, centroid(m, c), subDim_);
+        }
+    }
+}
+
+float ProductQuantizer::distance(const std::vector<float>& table, const uint8_t* code) const {
+    const float* t = table.data();
+    float sum = 0.0f;
+    for (uint32_t m = 0; m < subspaces_; ++m) {
+        sum += t[static_cast<size_t>(m) * kCentroids + code[m]];
+    }
+    return metric_ == DistanceMetric::Cosine ? 1.0f - sum : sum;
+}
+
+void ProductQuantizer::serializeParams(std::string& out) const {
+    appendRaw<uint32_t>(out, subspaces_);
+    appendFloats(out, centroids_);
+}
+
+bool ProductQuantizer::deserializeParams(const uint8_t* data, size_t size) {
+    const uint8_t* end = data + size;
+    uint32_t subspaces = 0;
+    if (!readRaw(data, end, subspaces) || subspaces == 0 || dim_ % subspaces != 0) {
+        return false;
+    }
+    subspaces_ = subspaces;
+    subDim_ = dim_ / subspaces;
+    return readFloats(data, end, centroids_, static_cast<size_t>(subspaces_) * kCentroids * subDim_);
+}
+
+// ─── k-means ────────────────────────────────────────────────────────────────
+
+void kmeans(const float* data, size_t count, uint32_t dim, uint32_t k, int iterations, uint64_t seed,
+            std::vector<float>& centroids) {
+    std::mt19937_64 rng(seed);
+    centroids.assign(static_cast<size_t>(k) * dim, 0.0f);
+
+    // Initialize from distinct random points (repeating when there are fewer points than clusters)
+    std::vector<size_t> order(count);
+    for (size_t i = 0; i < count; ++i) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), rng);
+    for (uint32_t c = 0; c < k; ++c) {
+        std::memcpy(centroids.data() + static_cast<size_t>(c) * dim, data + order[c % count] * dim,
+                    dim * sizeof(float));
+    }
+    if (count <= k) {
+        return;
+    }
+
+    std::vector<uint32_t> assignment(count, 0);
+    std::vector<double> sums(static_cast<size_t>(k) * dim);
+    std::vector<size_t> sizes(k);
+    std::uniform_int_distribution<size_t> pick(0, count - 1);
+
+    for (int iter = 0; iter < iterations; ++iter) {
+        bool changed = false;
+        for (size_t i = 0; i < count; ++i) {
+            const float* v = data + i * dim;
+            uint32_t best = 0;
+            float bestDistance = std::numeric_limits<float>::max();
+            for (uint32_t c = 0; c < k; ++c) {
+                float d = squaredL2(v, centroids.data() + static_cast<size_t>(c) * dim, dim);
+                if (d < bestDistance) {
+                    bestDistance = d;
+                    best = c;
+                }
+            }
+            changed = changed || assignment[i] != best;
+            assignment[i] = best;
+        }
+        if (!changed && iter > 0) {
+            break;
+        }
+
+        std::fill(sums.begin(), sums.end(), 0.0);
+        std::fill(sizes.begin(), sizes.end(), 0);
+        for (size_t i = 0; i < count; ++i) {
+            double* sum = sums.data() + static_cast<size_t>(assignment[i]) * dim;
+            const float* v = data + i * dim;
+            for (uint32_t d = 0; d < dim; ++d) {
+                sum[d] += v[d];
+            }
+            ++sizes[assignment[i]];
+        }
+        for (uint32_t c = 0; c < k; ++c) {
+            float* centroid = centroids.data() + static_cast<size_t>(c) * dim;
+            if (sizes[c] == 0) {
+                // Re-seed empty clusters from a random point
+                std::memcpy(centroid, data + pick(rng) * dim, dim * sizeof(float));
+                continue;
+            }
+            for (uint32_t d = 0; d < dim; ++d) {
+                centroid[d] = static_cast<float>(sums[static_cast<size_t>(c) * dim + d] / sizes[c]);
+            }
+        }
+    }
+}
@@ -0,0 +1,162 @@
+#include "roaring_bitmap.h"
+#include "file_util.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const uint16_t kArrayContainer = 0;
+const uint16_t kBitmapContainer = 1;
+const uint32_t kMaxArrayCardinality = 4096;
+const size_t kBitmapBytes = 65536 / 8;
+
+void alignTo8(std::string& out, size_t base) {
+    while ((out.size() - base) % 8 != 0) {
+        out.push_back('\0');
+    }
+}
+
+} // namespace
+
+void encodeRoaring(const uint32_t* rows, size_t count, std::string& out) {
+    const size_t base = out.size();
+
+    // Split into runs sharing the high 16 bits
+    std::vector<std::pair<size_t, size_t>> runs;
+    for (size_t i = 0; i < count;) {
+        size_t j = i + 1;
+        while (j < count && (rows[j] >> 16) == (rows[i] >> 16)) {
+            ++j;
+        }
+        runs.push_back({i, j});
+        i = j;
+    }
+
+    appendRaw<uint32_t>(out, static_cast<uint32_t>(runs.size()));
+    const size_t tableStart = out.size();
+    out.resize(tableStart + runs.size() * 12);
+    alignTo8(out, base);
+
+    for (size_t r = 0; r < runs.size(); ++r) {
+        const size_t begin = runs[r].first;
+        const size_t end = runs[r].second;
+        const uint32_t cardinality = static_cast<uint32_t>(end - begin);
+        const uint16_t type = cardinality <= kMaxArrayCardinality ? kArrayContainer : kBitmapContainer;
+        const uint32_t offset = static_cast<uint32_t>(out.size() - base);
+
+        if (type == kArrayContainer) {
+            for (size_t i = begin; i < end; ++i) {
+                appendRaw<uint16_t>(out, static_cast<uint16_t>(rows[i] & 0xFFFF));
+            }
+        } else {
+            std::vector<uint64_t> words(kBitmapBytes / 8, 0);
+            for (size_t i = begin; i < end; ++i) {
+                uint32_t low = rows[i] & 0xFFFF;
+                words[low >> 6] |= uint64_t(1) << (low & 63);
+            }
+            out.append(reinterpret_cast<const char*>(words.data()), kBitmapBytes);
+        }
+        alignTo8(out, base);
+
+        char* entry = &out[tableStart + r * 12];
+        uint16_t key = static_cast<uint16_t>(rows[begin] >> 16);
+        std::memcpy(entry, &key, 2);
+        std::memcpy(entry + 2, &type, 2);
+        std::memcpy(entry + 4, &cardinality, 4);
+        std::memcpy(entry + 8, &offset, 4);
+    }
+}
+
+RoaringView::RoaringView() : data_(nullptr), containers_(nullptr), containerCount_(0), cardinality_(0) {}
+
+bool RoaringView::open(const uint8_t* data, size_t size) {
+    *this = RoaringView();
+    if (size < 4) {
+        return false;
+    }
+    uint32_t count;
+    std::memcpy(&count, data, 4);
+    if (count > 65536 || size < 4 + static_cast<size_t>(count) * sizeof(Container)) {
+        return false;
+    }
+
+    const Container* containers = reinterpret_cast<const Container*>(data + 4);
+    uint64_t cardinality = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+        const Container& c = containers[i];
+        size_t payload = c.type == kArrayContainer ? c.cardinality * sizeof(uint16_t) : kBitmapBytes;
+        if ((i > 0 && c.key <= containers[i - 1].key) || c.type > kBitmapContainer || c.cardinality == 0 ||
+            c.cardinality > 65536 || c.offset % 8 != 0 || c.offset > size || payload > size - c.offset) {
+            return false;
+        }
+        cardinality += c.cardinality;
+    }
+
+    data_ = data;
+    containers_ = containers;
+    containerCount_ = count;
+    cardinality_ = cardinality;
+    return true;
+}
+
+const RoaringView::Container* RoaringView::findContainer(uint16_t key) const {
+    const Container* end = containers_ + containerCount_;
+    const Container* it =
+        std::lower_bound(containers_, end, key, [](const Container& c, uint16_t k) { return c.key < k; });
+    return it != end && it->key == key ? it : nullptr;
+}
+
+bool RoaringView::contains(uint32_t row) const {
+    const Container* c = findContainer(static_cast<uint16_t>(row >> 16));
+    if (!c) {
+        return false;
+    }
+    const uint16_t low = static_cast<uint16_t>(row & 0xFFFF);
+    if (c->type == kArrayContainer) {
+        const uint16_t* values = reinterpret_cast<const uint16_t*>(data_ + c->offset);
+        return std::binary_search(values, values + c->cardinality, low);
+    }
+    const uint64_t* words = reinterpret_cast<const uint64_t*>(data_ + c->offset);
+    return (words[low >> 6] >> (low & 63)) & 1;
+}
+
+void RoaringView::toArray(std::vector<uint32_t>& rows) const {
+    rows.reserve(rows.size() + cardinality_);
+    for (uint32_t i = 0; i < containerCount_; ++i) {
+        const Container& c = containers_[i];
+        const uint32_t high = static_cast<uint32_t>(c.key) << 16;
+        if (c.type == kArrayContainer) {
+            const uint16_t* values = reinterpret_cast<const uint16_t*>(data_ + c.offset);
+            for (uint32_t j = 0; j < c.cardinality; ++j) {
+                rows.push_back(high | values[j]);
+            }
+        } else {
+            const uint64_t* words = reinterpret_cast<const uint64_t*>(data_ + c.offset);
+            for (uint32_t w = 0; w < kBitmapBytes / 8; ++w) {
+                for (uint64_t bits = words[w]; bits; bits &= bits - 1) {
+                    rows.push_back(high | (w << 6) | static_cast<uint32_t>(__builtin_ctzll(bits)));
+                }
+            }
+        }
+    }
+}
+
+std::vector<uint32_t> RoaringView::intersect(const std::vector<const RoaringView*>& views) {
+    std::vector<uint32_t> rows;
+    if (views.empty()) {
+        return rows;
+    }
+    const RoaringView* smallest = *std::min_element(
+        views.begin(), views.end(), [](const RoaringView* a, const RoaringView* b) {
+            return a->cardinality() < b->cardinality();
+        });
+    smallest->toArray(rows);
+    for (const RoaringView* view : views) {
+        if (view == smallest) {
+            continue;
+        }
+        rows.erase(std::remove_if(rows.begin(), rows.end(), [view](uint32_t row) { return !view->contains(row); }),
+                   rows.end());
+    }
+    return rows;
+}
@@ -0,0 +1,246 @@
+#include "robots_cache.h"
+#include "crawl_frontier.h"
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <mutex>
+
+namespace {
+
+// Most origins have no rules for the agent, or none that could be fetched; they share these, which stay in cache
+const std::shared_ptr<const RobotsRules>& sharedAllowAll() {
+    static const std::shared_ptr<const RobotsRules> rules = std::make_shared<const RobotsRules>();
+    return rules;
+}
+
+const std::shared_ptr<const RobotsRules>& sharedDisallowAll() {
+    static const std::shared_ptr<const RobotsRules> rules =
+        std::make_shared<const RobotsRules>(RobotsRules::disallowAll());
+    return rules;
+}
+
+} // namespace
+
+RobotsCache::RobotsCache(const RobotsCacheOptions& options)
+    : options_(options), frontier_(nullptr), generation_(0), hits_(0), misses_(0), fetches_(0), fetchErrors_(0),
+      evicted_(0), allowed_(0), disallowed_(0) {}
+
+void RobotsCache::setFetcher(const Fetcher& fetcher) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    fetcher_ = fetcher;
+}
+
+void RobotsCache::attachFrontier(CrawlFrontier* frontier) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    frontier_ = frontier;
+}
+
+bool RobotsCache::originOf(std::string_view url, std::string& origin, std::string_view& path) {
+    const size_t scheme = url.find("://");
+    if (scheme == std::string_view::npos || scheme == 0) {
+        return false;
+    }
+    const size_t authorityStart = scheme + 3;
+    size_t authorityEnd = url.find_first_of("/?#", authorityStart);
+    if (authorityEnd == std::string_view::npos) {
+        authorityEnd = url.size();
+    }
+    std::string_view authority = url.substr(authorityStart, authorityEnd - authorityStart);
+    const size_t at = authority.rfind('@');
+    if (at != std::string_view::npos) {
+        authority.remove_prefix(at + 1);
+    }
+    if (authority.empty() || authority.front() == ':') {
+        return false;
+    }
+
+    origin.assign(url.data(), scheme + 3);
+    origin.append(authority.data(), authority.size());
+    for (char& c : origin) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    // Default ports name the same origin as no port
+    const size_t colon = origin.rfind(':');
+    if (colon > scheme + 2 && origin.find(']', colon) == std::string::npos) {
+        const std::string_view port(origin.data() + colon + 1, origin.size() - colon - 1);
+        const bool http = origin.compare(0, scheme, "http") == 0 && port == "80";
+        const bool https = origin.compare(0, scheme, "https") == 0 && port == "443";
+        if (port.empty() || http || https) {
+            origin.resize(colon);
+        }
+    }
+
+    path = url.substr(authorityEnd);
+    path = path.substr(0, path.find('#'));
+    if (path.empty() || path.front() != '/') {
+        // "https://host" and "https://host?q" ask for the root
+        path = "/";
+    }
+    return true;
+}
+
+RobotsVerdict RobotsCache::count(bool allowed) {
+    if (allowed) {
+        allowed_.fetch_add(1, std::memory_order_relaxed);
+        return RobotsVerdict::Allowed;
+    }
+    disallowed_.fetch_add(1, std::memory_order_relaxed);
+    return RobotsVerdict::Disallowed;
+}
+
+RobotsVerdict RobotsCache::check(std::string_view url, uint64_t nowMillis) {
+    // Reused so that a hit does not allocate
+    thread_local std::string origin;
+    std::string_view path;
+    if (!originOf(url, origin, path)) {
+        return RobotsVerdict::Unknown;
+    }
+    bool haveFetcher;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = entries_.find(origin);
+        if (it != entries_.end() && it->second.expiresAt > nowMillis) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return count(it->second.rules->allowed(path));
+        }
+        haveFetcher = static_cast<bool>(fetcher_);
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    if (!haveFetcher) {
+        return RobotsVerdict::Unknown;
+    }
+    const std::shared_ptr<const RobotsRules> rules = fetch(origin, nowMillis);
+    return rules ? count(rules->allowed(path)) : RobotsVerdict::Unknown;
+}
+
+// One fetch per origin at a time; the other checks of it wait for its result
+std::shared_ptr<const RobotsRules> RobotsCache::fetch(const std::string& origin, uint64_t nowMillis) {
+    Fetcher fetcher;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        fetchCv_.wait(lock, [&] { return fetching_.count(origin) == 0; });
+        auto it = entries_.find(origin);
+        if (it != entries_.end() && it->second.expiresAt > nowMillis) {
+            return it->second.rules;
+        }
+        if (!fetcher_) {
+            return nullptr;
+        }
+        fetcher = fetcher_;
+        fetching_.insert(origin);
+    }
+    RobotsFetchResult result;
+    try {
+        result = fetcher(origin + "/robots.txt");
+    } catch (const std::exception& e) {
+        std::cerr << "robots.txt fetch for " << origin << " failed: " << e.what() << std::endl;
+        result = RobotsFetchResult();
+    }
+    fetches_.fetch_add(1, std::memory_order_relaxed);
+    std::shared_ptr<const RobotsRules> rules = store(origin, result.status, result.body, nowMillis);
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        fetching_.erase(origin);
+    }
+    fetchCv_.notify_all();
+    return rules;
+}
+
+std::shared_ptr<const RobotsRules> RobotsCache::store(const std::string& origin, int status, std::string_view body,
+                                                      uint64_t nowMillis) {
+    const bool success = status >= 200 && status < 300;
+    // RFC 9309: unavailable (4xx, or redirects that never ended) allows all; unreachable (5xx) disallows all
+    const bool unreachable = status == 0 || status >= 500;
+    std::shared_ptr<const RobotsRules> rules = sharedAllowAll();
+    if (success) {
+        RobotsRules parsed = RobotsRules::parse(body, options_.userAgent);
+        if (parsed.ruleCount() > 0 || parsed.crawlDelayMillis() > 0 || !parsed.sitemaps().empty()) {
+            rules = std::make_shared<const RobotsRules>(std::move(parsed));
+        }
+    } else if (unreachable) {
+        fetchErrors_.fetch_add(1, std::memory_order_relaxed);
+        rules = sharedDisallowAll();
+    }
+
+    uint64_t oldDelay = 0;
+    CrawlFrontier* frontier;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        Entry& entry = entries_[origin];
+        if (entry.rules) {
+            oldDelay = entry.rules->crawlDelayMillis();
+        }
+        if (unreachable && entry.fetched) {
+            // A server error says nothing new about the rules; keep the last ones for another errorTtl
+            rules = entry.rules;
+        } else {
+            entry.rules = rules;
+            entry.fetched = success;
+        }
+        entry.expiresAt = nowMillis + (unreachable ? options_.errorTtlMillis : options_.ttlMillis);
+        entry.generation = ++generation_;
+        order_.emplace_back(origin, entry.generation);
+
+        while (entries_.size() > options_.maxHosts && !order_.empty()) {
+            auto it = entries_.find(order_.front().first);
+            if (it != entries_.end() && it->second.generation == order_.front().second) {
+                entries_.erase(it);
+                evicted_.fetch_add(1, std::memory_order_relaxed);
+            }
+            order_.pop_front();
+        }
+        // Items for origins stored again since are dropped as they come to the front
+        while (!order_.empty()) {
+            auto it = entries_.find(order_.front().first);
+            if (it != entries_.end() && it->second.generation == order_.front().second) {
+                break;
+            }
+            order_.pop_front();
+        }
+        if (order_.size() > 2 * entries_.size() + 64) {
+            std::deque<std::pair<std::string, uint64_t>> live;
+            for (auto& item : order_) {
+                auto it = entries_.find(item.first);
+                if (it != entries_.end() && it->second.generation == item.second) {
+                    live.push_back(std::move(item));
+                }
+            }
+            order_.swap(live);
+        }
+        frontier = frontier_;
+    }
+
+    const uint64_t delay = std::min(rules->crawlDelayMillis(), options_.maxCrawlDelayMillis);
+    if (frontier && (delay > 0 || oldDelay > 0)) {
+        // 0 gives the host back the frontier's default interval
+        frontier->setDomainInterval(CrawlFrontier::hostOf(origin), delay);
+    }
+    return rules;
+}
+
+std::shared_ptr<const RobotsRules> RobotsCache::rules(const std::string& origin, uint64_t nowMillis) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = entries_.find(origin);
+    return it != entries_.end() && it->second.expiresAt > nowMillis ? it->second.rules : nullptr;
+}
+
+RobotsCacheStats RobotsCache::stats() const {
+    RobotsCacheStats s;
+    s.hits = hits_.load(std::memory_order_relaxed);
+    s.misses = misses_.load(std::memory_order_relaxed);
+    s.fetches = fetches_.load(std::memory_order_relaxed);
+    s.fetchErrors = fetchErrors_.load(std::memory_order_relaxed);
+    s.evicted = evicted_.load(std::memory_order_relaxed);
+    s.allowed = allowed_.load(std::memory_order_relaxed);
+    s.disallowed = disallowed_.load(std::memory_order_relaxed);
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    s.origins = entries_.size();
+    s.memoryBytes = order_.size() * sizeof(std::pair<std::string, uint64_t>);
+    for (const auto& kv : entries_) {
+        s.memoryBytes += sizeof(kv) + kv.first.capacity();
+        if (kv.second.rules != sharedAllowAll() && kv.second.rules != sharedDisallowAll()) {
+            s.memoryBytes += kv.second.rules->memoryBytes();
+        }
+    }
+    return s;
+}
@@ -0,0 +1,162 @@
+#include "robots_service.h"
+#include "config_manager.h"
+#include "crawl_frontier.h"
+#include "crawl_frontier_service.h"
+#include "json_util.h"
+#include <cstdlib>
+#include <iostream>
+#include <set>
+
+namespace {
+
+typedef std::map<std::string, std::string> Params;
+
+std::string param(const Params& params, const std::string& key, const std::string& defaultValue = "") {
+    auto it = params.find(key);
+    return it != params.end() ? it->second : defaultValue;
+}
+
+std::string error(const std::string& message) {
+    std::string out = "{\"error\": ";
+    appendJsonString(out, message);
+    out += "}";
+    return out;
+}
+
+void appendList(std::string& out, const char* name, const std::vector<std::string_view>& values) {
+    out += out.size() > 1 ? ", \"" : "\"";
+    out += name;
+    out += "\": [";
+    for (size_t i = 0; i < values.size(); ++i) {
+        if (i > 0) {
+            out += ", ";
+        }
+        appendJsonString(out, values[i]);
+    }
+    out += "]";
+}
+
+} // namespace
+
+RobotsService::RobotsService() : cache_(new RobotsCache()) {}
+
+bool RobotsService::initialize(const ConfigManager& config) {
+    RobotsCacheOptions options;
+    options.userAgent = config.get("ROBOTS_USER_AGENT", options.userAgent);
+    const int ttl = config.getInt("ROBOTS_TTL_S", static_cast<int>(options.ttlMillis / 1000));
+    const int errorTtl = config.getInt("ROBOTS_ERROR_TTL_S", static_cast<int>(options.errorTtlMillis / 1000));
+    const int maxDelay = config.getInt("ROBOTS_MAX_CRAWL_DELAY_MS", static_cast<int>(options.maxCrawlDelayMillis));
+    const int maxHosts = config.getInt("ROBOTS_MAX_HOSTS", static_cast<int>(options.maxHosts));
+    if (options.userAgent.empty() || ttl < 1 || errorTtl < 1 || maxDelay < 0 || maxHosts < 1) {
+        std::cerr << "ROBOTS_USER_AGENT must be set, ROBOTS_TTL_S, ROBOTS_ERROR_TTL_S and ROBOTS_MAX_HOSTS "
+                     "positive and ROBOTS_MAX_CRAWL_DELAY_MS non-negative"
+                  << std::endl;
+        return false;
+    }
+    options.ttlMillis = static_cast<uint64_t>(ttl) * 1000;
+    options.errorTtlMillis = static_cast<uint64_t>(errorTtl) * 1000;
+    options.maxCrawlDelayMillis = static_cast<uint64_t>(maxDelay);
+    options.maxHosts = static_cast<size_t>(maxHosts);
+    cache_.reset(new RobotsCache(options));
+    return true;
+}
+
+void RobotsService::registerRoutes(HttpServer& server) {
+    server.post("/robots/check", [this](const Params& params) { return handleCheck(params); });
+    server.post("/robots/store", [this](const Params& params) { return handleStore(params); });
+    server.get("/robots/stats", [this](const Params& params) { return handleStats(params); });
+}
+
+void RobotsService::attachFrontier(CrawlFrontierService& frontier) {
+    cache_->attachFrontier(&frontier.frontier());
+    frontier.setRobots(cache_.get());
+}
+
+std::string RobotsService::handleCheck(const Params& params) {
+    std::map<size_t, std::string_view> indexed;
+    if (!indexedParams(params, "urls.", kMaxParamIndex, indexed)) {
+        return error("bad index");
+    }
+    auto single = params.find("url");
+    if (single != params.end()) {
+        indexed[indexed.empty() ? 0 : indexed.rbegin()->first + 1] = single->second;
+    }
+    if (indexed.empty()) {
+        return error("url or urls.<i> required");
+    }
+
+    const uint64_t now = CrawlFrontier::steadyMillis();
+    std::vector<std::string_view> allowed;
+    std::vector<std::string_view> disallowed;
+    std::vector<std::string_view> unknown;
+    std::set<std::string> fetch;
+    std::string origin;
+    std::string_view path;
+    for (const auto& kv : indexed) {
+        switch (cache_->check(kv.second, now)) {
+        case RobotsVerdict::Allowed:
+            allowed.push_back(kv.second);
+            break;
+        case RobotsVerdict::Disallowed:
+            disallowed.push_back(kv.second);
+            break;
+        case RobotsVerdict::Unknown:
+            unknown.push_back(kv.second);
+            if (RobotsCache::originOf(kv.second, origin, path)) {
+                fetch.insert(origin + "/robots.txt");
+            }
+            break;
+        }
+    }
+    std::string out = "{";
+    appendList(out, "allowed", allowed);
+    appendList(out, "disallowed", disallowed);
+    appendList(out, "unknown", unknown);
+    appendList(out, "fetch", std::vector<std::string_view>(fetch.begin(), fetch.end()));
+    out += "}";
+    return out;
+}
+
+std::string RobotsService::handleStore(const Params& params) {
+    std::string origin;
+    std::string_view path;
+    if (!RobotsCache::originOf(param(params, "url"), origin, path)) {
+        return error("url of the robots.txt is required");
+    }
+    const std::string statusText = param(params, "status", "200");
+    char* end = nullptr;
+    const long status = std::strtol(statusText.c_str(), &end, 10);
+    if (*end != '\0' || status < 0 || status > 599) {
+        return error("status must be an HTTP status, or 0 for an unreachable host");
+    }
+    std::shared_ptr<const RobotsRules> rules =
+        cache_->store(origin, static_cast<int>(status), param(params, "body"), CrawlFrontier::steadyMillis());
+
+    std::string out = "{\"origin\": ";
+    appendJsonString(out, origin);
+    out += ", \"rules\": " + std::to_string(rules->ruleCount());
+    out += ", \"crawl_delay_ms\": " + std::to_string(rules->crawlDelayMillis());
+    out += ", \"sitemaps\": [";
+    for (size_t i = 0; i < rules->sitemaps().size(); ++i) {
+        if (i > 0) {
+            out += ", ";
+        }
+        appendJsonString(out, rules->sitemaps()[i]);
+    }
+    out += "]}";
+    return out;
+}
+
+std::string RobotsService::handleStats(const Params&) {
+    RobotsCacheStats s = cache_->stats();
+    std::string out = "{\"origins\": " + std::to_string(s.origins);
+    out += ", \"hits\": " + std::to_string(s.hits);
+    out += ", \"misses\": " + std::to_string(s.misses);
+    out += ", \"fetches\": " + std::to_string(s.fetches);
+    out += ", \"fetch_errors\": " + std::to_string(s.fetchErrors);
+    out += ", \"evicted\": " + std::to_string(s.evicted);
+    out += ", \"allowed\": " + std::to_string(s.allowed);
+    out += ", \"disallowed\": " + std::to_string(s.disallowed);
+    out += ", \"memory_bytes\": " + std::to_string(s.memoryBytes) + "}";
+    return out;
+}
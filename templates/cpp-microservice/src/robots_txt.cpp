@@ -0,0 +1,371 @@
+#include "robots_txt.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+const size_t kMaxRobotsBytes = 500u << 10;
+const uint32_t kMaxBranches = 4096;    // Rules like "/*a*a*a*b" could otherwise take exponential time
+const char kHexDigits[] = "0123456789ABCDEF";
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+std::string lower(std::string_view text) {
+    std::string out(text);
+    for (char& c : out) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return out;
+}
+
+// Product token of a user-agent string or line: "DeepSearchStack/1.0 (+url)" -> "deepsearchstack"
+std::string productToken(std::string_view agent) {
+    size_t end = 0;
+    while (end < agent.size() &&
+           (std::isalpha(static_cast<unsigned char>(agent[end])) || agent[end] == '_' || agent[end] == '-')) {
+        ++end;
+    }
+    return lower(agent.substr(0, end));
+}
+
+bool needsNormalizing(std::string_view path) {
+    for (char c : path) {
+        if (c == '%' || static_cast<unsigned char>(c) >= 0x80) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Trie under construction; compile() flattens it
+struct BuildNode {
+    uint32_t firstChild = 0;    // Children are a sibling list, so building allocates nothing per node
+    uint32_t nextSibling = 0;
+    uint32_t childCount = 0;
+    unsigned char byte = 0;
+    uint32_t star = 0;
+    uint8_t rule = 0;
+    uint8_t endRule = 0;
+    uint32_t length = 0;
+};
+
+} // namespace
+
+std::string normalizeRobotsPath(std::string_view path) {
+    std::string out;
+    out.reserve(path.size());
+    for (size_t i = 0; i < path.size(); ++i) {
+        const unsigned char c = static_cast<unsigned char>(path[i]);
+        if (c == '%' && i + 2 < path.size() && std::isxdigit(static_cast<unsigned char>(path[i + 1])) &&
+            std::isxdigit(static_cast<unsigned char>(path[i + 2]))) {
+            out += '%';
+            out += static_cast<char>(std::toupper(static_cast<unsigned char>(path[i + 1])));
+            out += static_cast<char>(std::toupper(static_cast<unsigned char>(path[i + 2])));
+            i += 2;
+        } else if (c >= 0x80) {
+            out += '%';
+            out += kHexDigits[c >> 4];
+            out += kHexDigits[c & 15];
+        } else {
+            out += static_cast<char>(c);
+        }
+    }
+    return out;
+}
+
+RobotsRules::RobotsRules() : nodes_(1), crawlDelayMillis_(0), rules_(0) {}
+
+RobotsRules RobotsRules::parse(std::string_view text, std::string_view userAgent) {
+    text = text.substr(0, kMaxRobotsBytes);
+    const std::string agent = productToken(userAgent);
+
+    // Rules of the groups naming the agent, and of the "*" groups
+    std::vector<std::pair<std::string, bool>> agentRules;
+    std::vector<std::pair<std::string, bool>> starRules;
+    double agentDelay = 0;
+    double starDelay = 0;
+    bool agentGroupSeen = false;
+    bool inAgentLines = false;    // A group's user-agent lines run until its first other line
+    bool groupForAgent = false;
+    bool groupForStar = false;
+    RobotsRules rules;
+
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find_first_of("\r\n", pos);
+        if (end == std::string_view::npos) {
+            end = text.size();
+        }
+        std::string_view line = text.substr(pos, end - pos);
+        pos = end + 1;
+        line = line.substr(0, line.find('#'));
+        const size_t colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            continue;
+        }
+        const std::string key = lower(trim(line.substr(0, colon)));
+        const std::string_view value = trim(line.substr(colon + 1));
+
+        if (key == "user-agent") {
+            if (!inAgentLines) {
+                groupForAgent = false;
+                groupForStar = false;
+            }
+            inAgentLines = true;
+            if (value == "*") {
+                groupForStar = true;
+            } else if (!agent.empty() && productToken(value) == agent) {
+                groupForAgent = true;
+                agentGroupSeen = true;
+            }
+            continue;
+        }
+        if (key == "sitemap") {
+            if (!value.empty()) {
+                rules.sitemaps_.emplace_back(value);
+            }
+            continue;
+        }
+        if (key != "allow" && key != "disallow" && key != "crawl-delay") {
+            continue;
+        }
+        inAgentLines = false;
+        if (key == "crawl-delay") {
+            const double seconds = std::strtod(std::string(value).c_str(), nullptr);
+            if (seconds > 0) {
+                agentDelay = groupForAgent ? std::max(agentDelay, seconds) : agentDelay;
+                starDelay = groupForStar ? std::max(starDelay, seconds) : starDelay;
+            }
+            continue;
+        }
+        // An empty Disallow allows everything, which is what no rule does
+        if (value.empty()) {
+            continue;
+        }
+        const bool allow = key == "allow";
+        if (groupForAgent) {
+            agentRules.emplace_back(std::string(value), allow);
+        }
+        if (groupForStar) {
+            starRules.emplace_back(std::string(value), allow);
+        }
+    }
+
+    const double delay = agentGroupSeen ? agentDelay : starDelay;
+    rules.crawlDelayMillis_ = static_cast<uint64_t>(delay * 1000);
+    rules.compile(agentGroupSeen ? agentRules : starRules);
+    return rules;
+}
+
+RobotsRules RobotsRules::disallowAll() {
+    RobotsRules rules;
+    rules.compile({{"/", false}});
+    return rules;
+}
+
+void RobotsRules::compile(const std::vector<std::pair<std::string, bool>>& rules) {
+    size_t bytes = 1;
+    for (const auto& entry : rules) {
+        bytes += entry.first.size();
+    }
+    std::vector<BuildNode> build(1);
+    build.reserve(bytes);
+    for (const auto& entry : rules) {
+        std::string path = normalizeRobotsPath(entry.first);
+        const bool anchored = !path.empty() && path.back() == '$';
+        if (anchored) {
+            path.pop_back();
+        }
+        uint32_t node = 0;
+        for (size_t i = 0; i < path.size(); ++i) {
+            if (path[i] == '*') {
+                // "**" matches what "*" does
+                if (i > 0 && path[i - 1] == '*') {
+                    continue;
+                }
+                if (build[node].star == 0) {
+                    build[node].star = static_cast<uint32_t>(build.size());
+                    build.emplace_back();
+                    build.back().length = build[node].length + 1;
+                }
+                node = build[node].star;
+                continue;
+            }
+            const unsigned char byte = static_cast<unsigned char>(path[i]);
+            uint32_t next = build[node].firstChild;
+            while (next != 0 && build[next].byte != byte) {
+                next = build[next].nextSibling;
+            }
+            if (next == 0) {
+                next = static_cast<uint32_t>(build.size());
+                build.emplace_back();
+                build.back().byte = byte;
+                build.back().length = build[node].length + 1;
+                build.back().nextSibling = build[node].firstChild;
+                build[node].firstChild = next;
+                ++build[node].childCount;
+            }
+            node = next;
+        }
+        // The same path both allowed and disallowed is allowed
+        uint8_t& rule = anchored ? build[node].endRule : build[node].rule;
+        rule = rule == kAllow || entry.second ? kAllow : kDisallow;
+        ++rules_;
+    }
+
+    // Flatten breadth-first, folding chains of nodes with one child and nothing else into edge labels
+    nodes_.assign(1, Node());
+    edges_.clear();
+    labels_.clear();
+    std::vector<uint32_t> order(1, 0);
+    std::vector<std::pair<unsigned char, uint32_t>> children;
+    for (size_t i = 0; i < order.size(); ++i) {
+        const BuildNode& from = build[order[i]];
+        children.clear();
+        for (uint32_t child = from.firstChild; child != 0; child = build[child].nextSibling) {
+            children.emplace_back(build[child].byte, child);
+        }
+        std::sort(children.begin(), children.end());
+        Node node;
+        node.firstEdge = static_cast<uint32_t>(edges_.size());
+        node.edgeCount = static_cast<uint16_t>(children.size());
+        node.rule = from.rule;
+        node.endRule = from.endRule;
+        node.length = from.length;
+        for (const auto& kv : children) {
+            Edge edge;
+            edge.byte = static_cast<char>(kv.first);
+            edge.labelOffset = static_cast<uint32_t>(labels_.size());
+            labels_ += edge.byte;
+            uint32_t end = kv.second;
+            while (build[end].childCount == 1 && build[end].star == 0 && build[end].rule == kNoRule &&
+                   build[end].endRule == kNoRule) {
+                end = build[end].firstChild;
+                labels_ += static_cast<char>(build[end].byte);
+            }
+            edge.labelLength = static_cast<uint32_t>(labels_.size()) - edge.labelOffset;
+            edge.child = static_cast<uint32_t>(order.size());
+            order.push_back(end);
+            edges_.push_back(edge);
+        }
+        if (from.star != 0) {
+            node.star = static_cast<uint32_t>(order.size());
+            order.push_back(from.star);
+        }
+        nodes_.resize(std::max(nodes_.size(), order.size()));
+        nodes_[i] = node;
+    }
+    nodes_.shrink_to_fit();
+    edges_.shrink_to_fit();
+    labels_.shrink_to_fit();
+}
+
+const RobotsRules::Edge* RobotsRules::edge(const Node& node, char byte) const {
+    const Edge* first = edges_.data() + node.firstEdge;
+    const Edge* last = first + node.edgeCount;
+    const unsigned char key = static_cast<unsigned char>(byte);
+    const Edge* it = std::lower_bound(
+        first, last, key, [](const Edge& e, unsigned char b) { return static_cast<unsigned char>(e.byte) < b; });
+    return it != last && it->byte == byte ? it : nullptr;
+}
+
+// Follow the path from a node; only "*" edges branch, once per place they may stop
+void RobotsRules::walk(uint32_t index, size_t pos, std::string_view path, Match& match) const {
+    // Longer rule paths win; on equal length Allow does
+    auto consider = [&match](uint32_t length, uint8_t rule) {
+        if (rule != kNoRule && (length > match.length || (length == match.length && rule == kAllow))) {
+            match.length = length;
+            match.rule = rule;
+        }
+    };
+    const char* data = path.data();
+    const size_t size = path.size();
+    while (true) {
+        const Node& node = nodes_[index];
+        consider(node.length, node.rule);
+        if (pos == size) {
+            consider(node.length + 1, node.endRule);
+        }
+        if (node.star != 0) {
+            const Node& star = nodes_[node.star];
+            // A "*" at the end of a rule (with "$" or not) matches whatever is left
+            consider(star.length, star.rule);
+            consider(star.length + 1, star.endRule);
+            if (star.edgeCount == 1) {
+                // Usually the byte after a "*" is a "/" or "."; jump between its occurrences
+                const Edge& only = edges_[star.firstEdge];
+                const char* label = labels_.data() + only.labelOffset;
+                const char* at = data + pos;
+                while ((at = static_cast<const char*>(std::memchr(at, only.byte, data + size - at))) != nullptr) {
+                    const size_t from = static_cast<size_t>(at - data);
+                    if (only.labelLength <= size - from && std::memcmp(label, at, only.labelLength) == 0) {
+                        if (match.branches == 0) {
+                            return;
+                        }
+                        --match.branches;
+                        walk(only.child, from + only.labelLength, path, match);
+                    }
+                    if (++at == data + size) {
+                        break;
+                    }
+                }
+            } else if (star.edgeCount > 1) {
+                for (size_t from = pos; from < size; ++from) {
+                    const Edge* next = edge(star, data[from]);
+                    if (next && next->labelLength <= size - from &&
+                        std::memcmp(labels_.data() + next->labelOffset, data + from, next->labelLength) == 0) {
+                        if (match.branches == 0) {
+                            return;
+                        }
+                        --match.branches;
+                        walk(next->child, from + next->labelLength, path, match);
+                    }
+                }
+            }
+        }
+        if (pos == size) {
+            return;
+        }
+        // Nodes folded into a label hold no rules, so a path ending inside one matches nothing more
+        const Edge* next = edge(node, data[pos]);
+        if (!next || next->labelLength > size - pos ||
+            std::memcmp(labels_.data() + next->labelOffset, data + pos, next->labelLength) != 0) {
+            return;
+        }
+        index = next->child;
+        pos += next->labelLength;
+    }
+}
+
+bool RobotsRules::allowed(std::string_view path) const {
+    if (rules_ == 0 || path == "/robots.txt") {
+        return true;
+    }
+    Match match;
+    match.branches = kMaxBranches;
+    if (needsNormalizing(path)) {
+        const std::string normalized = normalizeRobotsPath(path);
+        walk(0, 0, normalized, match);
+    } else {
+        walk(0, 0, path, match);
+    }
+    return match.rule != kDisallow;
+}
+
+size_t RobotsRules::memoryBytes() const {
+    size_t bytes = nodes_.capacity() * sizeof(Node) + edges_.capacity() * sizeof(Edge) + labels_.capacity();
+    for (const std::string& sitemap : sitemaps_) {
+        bytes += sizeof(std::string) + sitemap.capacity();
+    }
+    return bytes;
+}
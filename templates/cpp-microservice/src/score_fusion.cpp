@@ -0,0 +1,148 @@
+#include "score_fusion.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const size_t kMinSlots = 64;
+
+} // namespace
+
+ScoreFusion::ScoreFusion(const ScoreFusionOptions& options)
+    : options_(options), mask_(0), generation_(1), lists_(0) {
+}
+
+void ScoreFusion::reset() {
+    results_.clear();
+    states_.clear();
+    lists_ = 0;
+    if (++generation_ == 0) {
+        // Stamps wrapped: slots from 2^32 fusions ago would look live again
+        std::fill(table_.begin(), table_.end(), Slot{0, 0});
+        generation_ = 1;
+    }
+}
+
+void ScoreFusion::reserve(size_t entries) {
+    // Load factor stays at or below one half
+    if (entries * 2 <= table_.size()) {
+        return;
+    }
+    size_t slots = std::max(table_.size(), kMinSlots);
+    while (slots < entries * 2) {
+        slots *= 2;
+    }
+    table_.assign(slots, Slot{0, 0});
+    mask_ = slots - 1;
+    generation_ = 1;
+    for (uint32_t entry = 0; entry < results_.size(); ++entry) {
+        size_t i = results_[entry].key.low & mask_;
+        while (table_[i].generation == generation_) {
+            i = (i + 1) & mask_;
+        }
+        table_[i] = Slot{generation_, entry};
+    }
+}
+
+uint32_t ScoreFusion::findOrInsert(const Hash128& key, bool& inserted) {
+    size_t i = key.low & mask_;
+    for (; table_[i].generation == generation_; i = (i + 1) & mask_) {
+        if (results_[table_[i].entry].key == key) {
+            inserted = false;
+            return table_[i].entry;
+        }
+    }
+    const uint32_t entry = static_cast<uint32_t>(results_.size());
+    table_[i] = Slot{generation_, entry};
+    inserted = true;
+    return entry;
+}
+
+uint32_t ScoreFusion::addList(const Hash128* keys, const double* scores, size_t count, double weight) {
+    const uint32_t list = lists_++;
+    reserve(results_.size() + count);
+
+    const bool rrf = options_.method == FusionMethod::Rrf;
+    double low = 0.0;
+    double scale = 1.0;
+    if (!rrf && scores && options_.normalizeScores) {
+        double high = -HUGE_VAL;
+        low = HUGE_VAL;
+        for (size_t i = 0; i < count; ++i) {
+            if (std::isfinite(scores[i])) {
+                low = std::min(low, scores[i]);
+                high = std::max(high, scores[i]);
+            }
+        }
+        // A list whose scores are all equal scores 1 throughout
+        scale = high > low ? 1.0 / (high - low) : 0.0;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        double contribution;
+        if (rrf) {
+            contribution = weight / (options_.rrfK + static_cast<double>(i + 1));
+        } else if (!scores) {
+            contribution = weight * (1.0 - static_cast<double>(i) / static_cast<double>(count));
+        } else if (!std::isfinite(scores[i])) {
+            contribution = 0.0;
+        } else if (options_.normalizeScores) {
+            contribution = weight * (scale > 0.0 ? (scores[i] - low) * scale : 1.0);
+        } else {
+            contribution = weight * scores[i];
+        }
+
+        bool inserted;
+        const uint32_t entry = findOrInsert(keys[i], inserted);
+        if (inserted) {
+            results_.push_back(FusedResult{keys[i], contribution, list, static_cast<uint32_t>(i), 1});
+            states_.push_back(EntryState{contribution, list});
+            continue;
+        }
+        EntryState& state = states_[entry];
+        if (state.lastList == list) {
+            continue;    // Repeated within this list; the earlier, better-ranked copy counted
+        }
+        FusedResult& result = results_[entry];
+        result.score += contribution;
+        result.lists++;
+        state.lastList = list;
+        if (contribution > state.best) {
+            state.best = contribution;
+            result.list = list;
+            result.index = static_cast<uint32_t>(i);
+        }
+    }
+    return list;
+}
+
+const std::vector<FusedResult>& ScoreFusion::rank(size_t limit) {
+    const size_t n = results_.size();
+    const size_t keep = limit == 0 ? n : std::min(limit, n);
+    const bool mnz = options_.method == FusionMethod::CombMnz;
+    auto score = [&](uint32_t entry) {
+        return mnz ? results_[entry].score * results_[entry].lists : results_[entry].score;
+    };
+
+    order_.resize(n);
+    for (uint32_t i = 0; i < n; ++i) {
+        order_[i] = i;
+    }
+    auto better = [&](uint32_t a, uint32_t b) {
+        const double sa = score(a);
+        const double sb = score(b);
+        return sa > sb || (sa == sb && a < b);
+    };
+    if (keep < n) {
+        std::partial_sort(order_.begin(), order_.begin() + keep, order_.end(), better);
+    } else {
+        std::sort(order_.begin(), order_.end(), better);
+    }
+
+    ranked_.resize(keep);
+    for (size_t i = 0; i < keep; ++i) {
+        ranked_[i] = results_[order_[i]];
+        ranked_[i].score = score(order_[i]);
+    }
+    return ranked_;
+}
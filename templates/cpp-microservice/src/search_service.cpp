@@ -0,0 +1,278 @@
+#include "search_service.h"
+#include "config_manager.h"
+#include "json_util.h"
+#include "json_writer.h"
+#include <cctype>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+typedef std::map<std::string, std::string> Params;
+
+// Terms of markdown per snippet, as FTS5 snippet(..., 40) returns
+const size_t kSnippetWords = 40;
+
+std::string param(const Params& params, const std::string& key, const std::string& defaultValue = "") {
+    auto it = params.find(key);
+    return it != params.end() ? it->second : defaultValue;
+}
+
+std::string error(const std::string& message) {
+    std::string out = "{\"error\": ";
+    appendJsonString(out, message);
+    out += "}";
+    return out;
+}
+
+bool parseId(const std::string& text, uint64_t& id) {
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos || text.size() > 19) {
+        return false;
+    }
+    id = std::strtoull(text.c_str(), nullptr, 10);
+    return true;
+}
+
+double parseDouble(const std::string& text, double defaultValue) {
+    char* end = nullptr;
+    double value = std::strtod(text.c_str(), &end);
+    return end != text.c_str() && *end == '\0' ? value : defaultValue;
+}
+
+// The first words of the markdown, with "..." when there are more; for
+// segments written before term offsets were stored
+std::string leadingSnippet(const std::string& markdown) {
+    size_t pos = 0;
+    size_t words = 0;
+    while (true) {
+        while (pos < markdown.size() && std::isspace(static_cast<unsigned char>(markdown[pos]))) {
+            ++pos;
+        }
+        if (pos == markdown.size()) {
+            return markdown;
+        }
+        if (words == kSnippetWords) {
+            break;
+        }
+        while (pos < markdown.size() && !std::isspace(static_cast<unsigned char>(markdown[pos]))) {
+            ++pos;
+        }
+        ++words;
+    }
+    size_t end = pos;
+    while (end > 0 && std::isspace(static_cast<unsigned char>(markdown[end - 1]))) {
+        --end;
+    }
+    return markdown.substr(0, end) + "...";
+}
+
+// The warehouse stores ingested_at as an ISO timestamp; epoch seconds are converted to one
+std::string isoTimestamp(const std::string& value) {
+    if (value.empty() || value.find_first_not_of("0123456789.") != std::string::npos) {
+        return value;
+    }
+    std::time_t seconds = static_cast<std::time_t>(std::strtod(value.c_str(), nullptr));
+    std::tm utc;
+    gmtime_r(&seconds, &utc);
+    char buffer[40];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S+00:00", &utc);
+    return buffer;
+}
+
+std::string_view field(const Metadata& fields, const char* key) {
+    auto it = fields.find(key);
+    return it != fields.end() ? std::string_view(it->second) : std::string_view();
+}
+
+} // namespace
+
+SearchService::SearchService() : maxDocuments_(10000) {}
+
+SearchService::~SearchService() {
+    shutdown();
+}
+
+bool SearchService::initialize(const ConfigManager& config) {
+    TextIndexOptions options;
+    options.directory = config.get("SEARCH_INDEX_DIR", options.directory);
+    options.flushThreshold = static_cast<size_t>(
+        config.getInt("SEARCH_FLUSH_THRESHOLD", static_cast<int>(options.flushThreshold)));
+    options.flushIntervalSeconds = config.getInt("SEARCH_FLUSH_INTERVAL", options.flushIntervalSeconds);
+    options.mergeFactor =
+        static_cast<size_t>(config.getInt("SEARCH_MERGE_FACTOR", static_cast<int>(options.mergeFactor)));
+    options.syncWrites = config.getBool("SEARCH_SYNC_WRITES", options.syncWrites);
+    options.k1 = static_cast<float>(parseDouble(config.get("SEARCH_BM25_K1"), options.k1));
+    options.b = static_cast<float>(parseDouble(config.get("SEARCH_BM25_B"), options.b));
+    if (options.k1 < 0 || options.b < 0 || options.b > 1) {
+        std::cerr << "SEARCH_BM25_K1 must be non-negative and SEARCH_BM25_B within [0, 1]" << std::endl;
+        return false;
+    }
+    options.compressStored = config.getBool("SEARCH_COMPRESS_STORED", options.compressStored);
+    const int dictionaryBytes =
+        config.getInt("SEARCH_STORED_DICTIONARY_BYTES", static_cast<int>(options.storedDictionaryBytes));
+    if (dictionaryBytes < 0 || static_cast<size_t>(dictionaryBytes) > LzDictionary::kMaxSize) {
+        std::cerr << "SEARCH_STORED_DICTIONARY_BYTES must be within [0, " << LzDictionary::kMaxSize << "]"
+                  << std::endl;
+        return false;
+    }
+    options.storedDictionaryBytes = static_cast<size_t>(dictionaryBytes);
+
+    const int maxDocuments = config.getInt("SEARCH_MAX_BATCH_DOCUMENTS", static_cast<int>(maxDocuments_));
+    if (maxDocuments < 1) {
+        std::cerr << "SEARCH_MAX_BATCH_DOCUMENTS must be positive" << std::endl;
+        return false;
+    }
+    maxDocuments_ = static_cast<size_t>(maxDocuments);
+
+    if (!index_.open(options)) {
+        std::cerr << "Failed to open text index at " << options.directory << std::endl;
+        return false;
+    }
+    index_.startBackgroundMaintenance();
+    return true;
+}
+
+void SearchService::shutdown() {
+    index_.close();
+}
+
+void SearchService::registerRoutes(HttpServer& server) {
+    server.getJson("/search", [this](const Params& params, JsonWriter& out) { handleSearch(params, out); });
+    server.post("/ingest", [this](const Params& params) { return handleIngest(params); });
+    server.post("/search/delete", [this](const Params& params) { return handleDelete(params); });
+    server.get("/search/stats", [this](const Params& params) { return handleStats(params); });
+    server.post("/search/merge", [this](const Params& params) { return handleMerge(params); });
+}
+
+void SearchService::handleSearch(const Params& params, JsonWriter& out) {
+    // Same validation as the warehouse: q of at least 2 characters, 1 <= limit <= 100
+    TextQuery query;
+    query.text = param(params, "q");
+    const int limit = std::atoi(param(params, "limit", "20").c_str());
+    if (query.text.size() < 2 || limit < 1 || limit > 100) {
+        out.beginObject();
+        out.member("error", query.text.size() < 2 ? "q must be at least 2 characters" : "limit must be 1-100");
+        out.endObject();
+        return;
+    }
+    query.limit = static_cast<size_t>(limit);
+    query.domain = param(params, "domain");
+    query.matchAll = param(params, "match") != "any";
+    query.snippetTokens = kSnippetWords;
+
+    out.beginArray();
+    for (const TextHit& hit : index_.search(query)) {
+        out.beginObject();
+        out.member("id", hit.id);
+        out.member("url", field(hit.fields, "url"));
+        out.member("title", field(hit.fields, "title"));
+        out.member("snippet", !hit.snippet.empty() ? hit.snippet
+                                                   : leadingSnippet(std::string(field(hit.fields, "markdown"))));
+        out.member("source_domain", field(hit.fields, "source_domain"));
+        out.member("word_count", std::strtoll(std::string(field(hit.fields, "word_count")).c_str(), nullptr, 10));
+        out.member("ingested_at", isoTimestamp(std::string(field(hit.fields, "ingested_at"))));
+        out.member("score", static_cast<double>(hit.score));
+        out.endObject();
+    }
+    out.endArray();
+}
+
+std::string SearchService::handleIngest(const Params& params) {
+    // documents.<i>.{id,url,title,markdown,content,author,source_domain,word_count,ingested_at,...}
+    std::map<size_t, TextDocument> documents;
+    for (const auto& kv : params) {
+        const std::string& key = kv.first;
+        if (key.compare(0, 10, "documents.") != 0) {
+            continue;
+        }
+        size_t dot = key.find('.', 10);
+        if (dot == std::string::npos || dot == 10 || key.find_first_not_of("0123456789", 10) != dot) {
+            return error("malformed document field " + key);
+        }
+        size_t index;
+        if (!parseParamIndex(std::string_view(key).substr(10, dot - 10), maxDocuments_, index)) {
+            return error("document index out of range in " + key.substr(0, 64));
+        }
+        TextDocument& document = documents[index];
+        std::string name = key.substr(dot + 1);
+        if (name == "id") {
+            if (!parseId(kv.second, document.id)) {
+                return error("document ids must be non-negative integers");
+            }
+        } else {
+            document.fields[name] = kv.second;
+        }
+    }
+    if (documents.empty()) {
+        return error("documents required");
+    }
+
+    std::vector<TextDocument> batch;
+    batch.reserve(documents.size());
+    for (auto& kv : documents) {
+        if (!params.count("documents." + std::to_string(kv.first) + ".id")) {
+            return error("id required for every document");
+        }
+        batch.push_back(std::move(kv.second));
+    }
+    const size_t count = batch.size();
+    if (!index_.addBatch(batch)) {
+        return error("ingest failed");
+    }
+    return "{\"indexed\": " + std::to_string(count) + ", \"total_docs\": " + std::to_string(index_.count()) + "}";
+}
+
+std::string SearchService::handleDelete(const Params& params) {
+    // ids as a JSON array of numbers arrives comma-separated
+    std::string ids = param(params, "ids", param(params, "id"));
+    if (ids.empty()) {
+        return error("id or ids required");
+    }
+    std::vector<uint64_t> parsed;
+    std::stringstream list(ids);
+    std::string one;
+    while (std::getline(list, one, ',')) {
+        uint64_t id;
+        if (!parseId(one, id)) {
+            return error("malformed id " + one.substr(0, 32));
+        }
+        parsed.push_back(id);
+    }
+    for (uint64_t id : parsed) {
+        if (!index_.remove(id)) {
+            return error("delete failed");
+        }
+    }
+    return "{\"deleted\": " + std::to_string(parsed.size()) + "}";
+}
+
+std::string SearchService::handleStats(const Params&) {
+    TextIndexStats s = index_.stats();
+    std::string out = "{\"documents\": " + std::to_string(index_.count());
+    out += ", \"segments\": " + std::to_string(s.segments);
+    out += ", \"segment_docs\": " + std::to_string(s.segmentDocs);
+    out += ", \"deleted_docs\": " + std::to_string(s.deletedDocs);
+    out += ", \"segment_bytes\": " + std::to_string(s.segmentBytes);
+    out += ", \"stored_bytes\": " + std::to_string(s.storedBytes);
+    out += ", \"stored_raw_bytes\": " + std::to_string(s.storedRawBytes);
+    out += ", \"stored_compression_ratio\": ";
+    appendJsonNumber(out, s.storedBytes ? static_cast<double>(s.storedRawBytes) / s.storedBytes : 0.0);
+    out += ", \"delta_docs\": " + std::to_string(s.deltaDocs);
+    out += ", \"open_ms\": ";
+    appendJsonNumber(out, s.openMillis);
+    out += ", \"last_flush_ms\": ";
+    appendJsonNumber(out, s.lastFlushMillis);
+    out += ", \"last_merge_ms\": ";
+    appendJsonNumber(out, s.lastMergeMillis);
+    out += ", \"flushes\": " + std::to_string(s.flushes);
+    out += ", \"merges\": " + std::to_string(s.merges) + "}";
+    return out;
+}
+
+std::string SearchService::handleMerge(const Params& params) {
+    // Flush first so that a full merge leaves a single segment holding everything
+    bool ok = index_.flush() && index_.merge(param(params, "full", "true") != "false");
+    return ok ? handleStats(Params()) : error("merge failed");
+}
@@ -0,0 +1,163 @@
+#include "snippet.h"
+#include "hash.h"
+#include "text_index.h"
+#include <algorithm>
+
+namespace {
+
+void appendVarint(std::string& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+bool readVarint(const uint8_t*& p, const uint8_t* end, uint32_t& value) {
+    value = 0;
+    for (uint32_t shift = 0; p < end && shift <= 28; shift += 7) {
+        const uint8_t byte = *p++;
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint16_t fingerprint(std::string_view term) {
+    return static_cast<uint16_t>(hash64(term) >> 48);
+}
+
+} // namespace
+
+void encodeTermOffsets(std::string_view text, std::string& out) {
+    TermSplitter terms(text);
+    std::string_view term;
+    size_t previousEnd = 0;
+    while (terms.next(term)) {
+        appendTermOffset(text, terms.source(), term, previousEnd, out);
+    }
+}
+
+void appendTermOffset(std::string_view text, std::string_view source, std::string_view term, size_t& previousEnd,
+                      std::string& out) {
+    const size_t start = static_cast<size_t>(source.data() - text.data());
+    appendVarint(out, static_cast<uint32_t>(start - previousEnd));
+    appendVarint(out, static_cast<uint32_t>(source.size()));
+    const uint16_t print = fingerprint(term);
+    out.push_back(static_cast<char>(print & 0xFF));
+    out.push_back(static_cast<char>(print >> 8));
+    previousEnd = start + source.size();
+}
+
+SnippetBuilder::SnippetBuilder(std::vector<std::string> terms, SnippetOptions options)
+    : terms_(std::move(terms)), options_(std::move(options)) {
+    for (const std::string& term : terms_) {
+        fingerprints_.push_back(fingerprint(term));
+    }
+    counts_.resize(terms_.size());
+}
+
+int32_t SnippetBuilder::match(std::string_view source, uint16_t print) const {
+    for (size_t i = 0; i < fingerprints_.size(); ++i) {
+        if (fingerprints_[i] != print) {
+            continue;
+        }
+        // A fingerprint collision costs one re-split of this term only
+        TermSplitter splitter(source);
+        std::string_view term;
+        if (splitter.next(term) && term == terms_[i]) {
+            return static_cast<int32_t>(i);
+        }
+    }
+    return -1;
+}
+
+void SnippetBuilder::build(std::string_view text, std::string_view offsets, std::string& out) {
+    out.clear();
+    tokens_.clear();
+    hits_.clear();
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(offsets.data());
+    const uint8_t* end = p + offsets.size();
+    uint32_t previous = 0;
+    while (p < end) {
+        uint32_t gap;
+        uint32_t length;
+        if (end - p >= 4 && (p[0] | p[1]) < 0x80) {
+            // Both varints one byte: nearly every term of ordinary text
+            gap = p[0];
+            length = p[1];
+            p += 2;
+        } else if (!readVarint(p, end, gap) || !readVarint(p, end, length) || end - p < 2) {
+            break;
+        }
+        const uint16_t print = static_cast<uint16_t>(p[0] | (p[1] << 8));
+        p += 2;
+        const uint64_t start = uint64_t(previous) + gap;
+        if (start + length > text.size()) {
+            break;    // Offsets of some other text
+        }
+        previous = static_cast<uint32_t>(start + length);
+        const int32_t term = match(text.substr(start, length), print);
+        if (term >= 0) {
+            hits_.push_back({static_cast<uint32_t>(tokens_.size()), static_cast<uint32_t>(term)});
+        }
+        tokens_.push_back({static_cast<uint32_t>(start), previous});
+    }
+    const size_t n = tokens_.size();
+    if (n == 0) {
+        return;
+    }
+
+    // The best window starts at a query term, so only windows starting at
+    // one are scored: distinct query terms first, occurrences second
+    const size_t window = std::min(std::max<size_t>(options_.tokens, 1), n);
+    size_t best = 0;
+    if (!hits_.empty()) {
+        std::fill(counts_.begin(), counts_.end(), 0u);
+        size_t distinct = 0;
+        size_t bestScore = 0;
+        size_t bestFirst = 0;
+        size_t bestLast = 0;
+        for (size_t first = 0, last = 0; first < hits_.size(); ++first) {
+            for (; last < hits_.size() && hits_[last].token < hits_[first].token + window; ++last) {
+                distinct += counts_[hits_[last].term]++ == 0;
+            }
+            const size_t score = distinct * n + (last - first);
+            if (score > bestScore) {
+                bestScore = score;
+                bestFirst = first;
+                bestLast = last - 1;
+            }
+            distinct -= --counts_[hits_[first].term] == 0;
+        }
+
+        // Centre its query terms, as FTS5 does
+        const size_t firstHit = hits_[bestFirst].token;
+        const size_t slack = window - (hits_[bestLast].token - firstHit + 1);
+        best = std::min(firstHit - std::min(firstHit, slack / 2), n - window);
+    }
+
+    const size_t last = best + window - 1;
+    const size_t from = best == 0 ? 0 : tokens_[best].start;
+    const size_t to = last == n - 1 ? text.size() : tokens_[last].end;
+    if (best > 0) {
+        out += options_.ellipsis;
+    }
+    size_t copied = from;
+    auto hit = std::lower_bound(hits_.begin(), hits_.end(), best,
+                                [](const Hit& h, size_t token) { return h.token < token; });
+    for (; hit != hits_.end() && hit->token <= last; ++hit) {
+        const Token& token = tokens_[hit->token];
+        out.append(text.data() + copied, token.start - copied);
+        out += options_.open;
+        out.append(text.data() + token.start, token.end - token.start);
+        out += options_.close;
+        copied = token.end;
+    }
+    out.append(text.data() + copied, to - copied);
+    if (last < n - 1) {
+        out += options_.ellipsis;
+    }
+}
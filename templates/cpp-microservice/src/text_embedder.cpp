@@ -0,0 +1,160 @@
+#include "text_embedder.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+TextEmbedder::TextEmbedder()
+    : pendingTokens_(0), running_(false), requests_(0), texts_(0), tokens_(0), batches_(0), busySeconds_(0.0) {}
+
+TextEmbedder::~TextEmbedder() {
+    stop();
+}
+
+bool TextEmbedder::load(const std::string& directory, const TextEmbedderOptions& options) {
+    return load(directory + "/model.dsem", directory + "/vocab.txt", options);
+}
+
+bool TextEmbedder::load(const std::string& modelPath, const std::string& vocabPath,
+                        const TextEmbedderOptions& options) {
+    stop();
+    options_ = options;
+    if (!tokenizer_.load(vocabPath) || !model_.load(modelPath, options_.quantize)) {
+        return false;
+    }
+    if (tokenizer_.vocabularySize() != model_.config().vocabSize) {
+        std::cerr << "Vocabulary has " << tokenizer_.vocabularySize() << " tokens, model expects "
+                  << model_.config().vocabSize << std::endl;
+        return false;
+    }
+    options_.maxSequenceLength = std::min<size_t>(options_.maxSequenceLength, model_.config().maxPositions);
+    // The batcher thread runs inference too, so the pool gets one worker fewer
+    pool_.reset(options_.threads == 1 ? nullptr : new ThreadPool(options_.threads > 0 ? options_.threads - 1 : 0));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = true;
+    batcher_ = std::thread(&TextEmbedder::batchLoop, this);
+    return true;
+}
+
+void TextEmbedder::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) {
+            return;
+        }
+        running_ = false;
+    }
+    pendingCv_.notify_all();
+    batcher_.join();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Request* request : pending_) {
+        request->done = true;
+        request->ok = false;
+    }
+    pending_.clear();
+    pendingTokens_ = 0;
+    doneCv_.notify_all();
+}
+
+bool TextEmbedder::embed(const std::vector<std::string>& texts, std::vector<std::vector<float>>& vectors,
+                         size_t* tokens) {
+    vectors.clear();
+    if (texts.empty()) {
+        return true;
+    }
+
+    // Tokenize on the caller's thread so concurrent requests tokenize in parallel
+    Request request;
+    request.ids.resize(texts.size());
+    request.tokens = 0;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        tokenizer_.encode(texts[i], options_.maxSequenceLength, request.ids[i]);
+        request.tokens += request.ids[i].size();
+    }
+    request.vectors = &vectors;
+    request.done = false;
+    request.ok = false;
+    if (tokens) {
+        *tokens = request.tokens;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!running_) {
+        return false;
+    }
+    pending_.push_back(&request);
+    pendingTokens_ += request.tokens;
+    pendingCv_.notify_one();
+    doneCv_.wait(lock, [&] { return request.done; });
+    return request.ok;
+}
+
+void TextEmbedder::batchLoop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        pendingCv_.wait(lock, [this] { return !running_ || !pending_.empty(); });
+        if (!running_) {
+            return;
+        }
+        if (options_.maxWaitMicros > 0 && pendingTokens_ < options_.maxBatchTokens) {
+            pendingCv_.wait_for(lock, std::chrono::microseconds(options_.maxWaitMicros),
+                                [this] { return !running_ || pendingTokens_ >= options_.maxBatchTokens; });
+        }
+
+        // Take requests in arrival order up to the token budget (always at least one)
+        std::vector<Request*> batch;
+        size_t batchTokens = 0;
+        while (!pending_.empty() &&
+               (batch.empty() || batchTokens + pending_.front()->tokens <= options_.maxBatchTokens)) {
+            batch.push_back(pending_.front());
+            batchTokens += pending_.front()->tokens;
+            pendingTokens_ -= pending_.front()->tokens;
+            pending_.pop_front();
+        }
+        lock.unlock();
+
+        std::vector<std::vector<int32_t>> sequences;
+        for (Request* request : batch) {
+            sequences.insert(sequences.end(), request->ids.begin(), request->ids.end());
+        }
+        const size_t dim = model_.config().hidden;
+        std::vector<float> out(sequences.size() * dim);
+        auto start = std::chrono::steady_clock::now();
+        bool ok = model_.embed(sequences, out.data(), pool_.get());
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        size_t row = 0;
+        for (Request* request : batch) {
+            request->vectors->resize(request->ids.size());
+            for (std::vector<float>& vector : *request->vectors) {
+                vector.assign(out.begin() + row * dim, out.begin() + (row + 1) * dim);
+                ++row;
+            }
+        }
+
+        lock.lock();
+        for (Request* request : batch) {
+            request->ok = ok;
+            request->done = true;
+        }
+        requests_ += batch.size();
+        texts_ += sequences.size();
+        tokens_ += batchTokens;
+        batches_ += 1;
+        busySeconds_ += seconds;
+        doneCv_.notify_all();
+    }
+}
+
+TextEmbedderStats TextEmbedder::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    TextEmbedderStats s;
+    s.requests = requests_;
+    s.texts = texts_;
+    s.tokens = tokens_;
+    s.batches = batches_;
+    s.busySeconds = busySeconds_;
+    s.tokensPerSecond = busySeconds_ > 0.0 ? tokens_ / busySeconds_ : 0.0;
+    return s;
+}
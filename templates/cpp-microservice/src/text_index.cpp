@@ -0,0 +1,1200 @@
+#include "text_index.h"
+#include "checksum.h"
+#include "file_util.h"
+#include "unicode_util.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const uint8_t kLogAdd = 1;
+const uint8_t kLogDelete = 2;
+const char kCurrentFile[] = "CURRENT";
+const char* const kIndexedFields[] = {"title", "markdown", "content", "url", "author"};
+// Longer queries keep their first distinct terms
+const size_t kMaxQueryTerms = 32;
+
+// Record: [u32 payload length][u32 crc32c][payload]
+// Payload: [u8 op][u64 id][fields (see encodeMetadata), adds only]
+void encodeLogRecord(uint8_t op, uint64_t id, const Metadata* fields, std::string& out) {
+    const size_t start = out.size();
+    out.append(8, '\0');
+    appendRaw<uint8_t>(out, op);
+    appendRaw<uint64_t>(out, id);
+    if (fields) {
+        encodeMetadata(*fields, out);
+    }
+
+    uint32_t length = static_cast<uint32_t>(out.size() - start - 8);
+    uint32_t crc = crc32c(out.data() + start + 8, length);
+    std::memcpy(&out[start], &length, 4);
+    std::memcpy(&out[start + 4], &crc, 4);
+}
+
+// Distinct terms of a query, in query order
+std::vector<std::string> queryTerms(std::string_view text) {
+    std::vector<std::string> terms;
+    TermSplitter splitter(text);
+    std::string_view term;
+    while (terms.size() < kMaxQueryTerms && splitter.next(term)) {
+        if (std::find(terms.begin(), terms.end(), term) == terms.end()) {
+            terms.emplace_back(term);
+        }
+    }
+    return terms;
+}
+
+} // namespace
+
+// ─── TermSplitter ───────────────────────────────────────────────────────────
+
+bool TermSplitter::next(std::string_view& term) {
+    while (words_.next(term)) {
+        if (term.empty()) {
+            continue;    // Overlong
+        }
+        const char* p = term.data();
+        const uint32_t cp = decodeUtf8(p, term.data() + term.size());
+        if (isUnicodeAlnum(cp) || isCjkIdeograph(cp)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ─── Query evaluation ───────────────────────────────────────────────────────
+
+// BM25 with the collection statistics of one query
+struct TextIndex::Scorer {
+    std::vector<float> idf;    // Per query term
+    float k1Plus1;
+    float base;                // k1 * (1 - b)
+    float perLength;           // k1 * b / average length
+
+    // Grows with freq and shrinks with length, so (maxFreq, minLength) bounds a block
+    float weight(size_t term, uint32_t freq, uint32_t length) const {
+        const float f = static_cast<float>(freq);
+        return idf[term] * f * k1Plus1 / (f + base + perLength * static_cast<float>(length));
+    }
+};
+
+// Top-k min-heap shared by the delta and every segment of one query
+struct TextIndex::Collector {
+    struct Entry {
+        float score;
+        uint64_t id;
+        const TextSegment* segment;    // nullptr for delta documents
+        uint32_t row;
+        const DeltaDoc* delta;
+    };
+
+    size_t limit;
+    bool prune;
+    std::vector<Entry> heap;
+
+    static bool worse(const Entry& a, const Entry& b) { return a.score > b.score; }
+
+    // A document must score above this to enter; 0 while the heap is filling
+    float threshold() const { return prune && heap.size() == limit ? heap.front().score : 0.0f; }
+
+    bool wouldAccept(float score) const { return heap.size() < limit || score > heap.front().score; }
+
+    void offer(const Entry& entry) {
+        if (heap.size() < limit) {
+            heap.push_back(entry);
+            std::push_heap(heap.begin(), heap.end(), worse);
+        } else if (entry.score > heap.front().score) {
+            std::pop_heap(heap.begin(), heap.end(), worse);
+            heap.back() = entry;
+            std::push_heap(heap.begin(), heap.end(), worse);
+        }
+    }
+};
+
+std::vector<TextHit> TextIndex::search(const TextQuery& query) const {
+    std::vector<TextHit> hits;
+    const std::vector<std::string> terms = queryTerms(query.text);
+    if (terms.empty() || query.limit == 0) {
+        return hits;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    // Collection statistics over every segment row and delta document, as
+    // Lucene counts them: replaced rows still count until a merge drops them
+    double docs = static_cast<double>(active_.liveDocs + frozen_.liveDocs);
+    double length = static_cast<double>(active_.totalLength + frozen_.totalLength);
+    for (const auto& state : segments_) {
+        docs += state->segment->size();
+        length += static_cast<double>(state->segment->totalLength());
+    }
+    if (docs == 0) {
+        return hits;
+    }
+    Scorer scorer;
+    const double average = length > 0 ? length / docs : 1.0;
+    scorer.k1Plus1 = options_.k1 + 1.0f;
+    scorer.base = options_.k1 * (1.0f - options_.b);
+    scorer.perLength = static_cast<float>(options_.k1 * options_.b / average);
+    for (const std::string& term : terms) {
+        double df = 0;
+        for (const auto& state : segments_) {
+            const TextTermEntry* entry = state->segment->findTerm(term);
+            df += entry ? entry->docFreq : 0;
+        }
+        for (const Delta* delta : {&active_, &frozen_}) {
+            auto it = delta->postings.find(term);
+            df += it != delta->postings.end() ? static_cast<double>(it->second.size()) : 0;
+        }
+        df = std::min(df, docs);
+        scorer.idf.push_back(static_cast<float>(std::log(1.0 + (docs - df + 0.5) / (df + 0.5))));
+    }
+
+    Collector top{query.limit, query.blockMax, {}};
+    top.heap.reserve(query.limit);
+    searchDelta(terms, query, scorer, top);
+    // Newest segments first: recent documents are the likeliest to be replaced
+    for (size_t i = segments_.size(); i-- > 0;) {
+        searchSegment(i, terms, query, scorer, top);
+    }
+
+    std::sort(top.heap.begin(), top.heap.end(), [](const Collector::Entry& a, const Collector::Entry& b) {
+        return a.score != b.score ? a.score > b.score : a.id < b.id;
+    });
+    hits.reserve(top.heap.size());
+    for (const Collector::Entry& entry : top.heap) {
+        hits.push_back(
+            {entry.id, entry.score, entry.segment ? entry.segment->stored(entry.row) : entry.delta->stored, {}});
+    }
+
+    // Cut from the stored markdown (decompressed above) at the recorded term
+    // offsets; segments written before offsets were kept give an empty snippet
+    if (query.snippetTokens > 0) {
+        SnippetOptions options;
+        options.tokens = query.snippetTokens;
+        SnippetBuilder snippets(terms, options);
+        for (size_t i = 0; i < hits.size(); ++i) {
+            const Collector::Entry& entry = top.heap[i];
+            auto markdown = hits[i].fields.find("markdown");
+            if (markdown != hits[i].fields.end()) {
+                snippets.build(markdown->second,
+                               entry.segment ? entry.segment->termOffsets(entry.row) : entry.delta->termOffsets,
+                               hits[i].snippet);
+            }
+        }
+    }
+    return hits;
+}
+
+void TextIndex::searchDelta(const std::vector<std::string>& terms, const TextQuery& query, const Scorer& scorer,
+                            Collector& top) const {
+    // Delta documents are few (bounded by the flush threshold), so score every candidate
+    std::vector<uint64_t> candidates;
+    for (const Delta* delta : {&active_, &frozen_}) {
+        for (const std::string& term : terms) {
+            auto it = delta->postings.find(term);
+            if (it != delta->postings.end()) {
+                for (const DeltaPosting& posting : it->second) {
+                    candidates.push_back(posting.id);
+                }
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    for (uint64_t id : candidates) {
+        const DeltaDoc* doc = findDelta(id);
+        if (!doc || doc->deleted) {
+            continue;
+        }
+        if (!query.domain.empty()) {
+            auto domain = doc->stored.find("source_domain");
+            if (domain == doc->stored.end() || domain->second != query.domain) {
+                continue;
+            }
+        }
+        float score = 0;
+        size_t matched = 0;
+        for (size_t i = 0; i < terms.size(); ++i) {
+            auto it = std::lower_bound(doc->terms.begin(), doc->terms.end(), terms[i],
+                                       [](const std::pair<std::string, uint32_t>& entry, const std::string& term) {
+                                           return entry.first < term;
+                                       });
+            if (it != doc->terms.end() && it->first == terms[i]) {
+                score += scorer.weight(i, it->second, doc->length);
+                ++matched;
+            }
+        }
+        if (matched > 0 && (!query.matchAll || matched == terms.size())) {
+            top.offer({score, id, nullptr, 0, doc});
+        }
+    }
+}
+
+void TextIndex::searchSegment(size_t index, const std::vector<std::string>& terms, const TextQuery& query,
+                              const Scorer& scorer, Collector& top) const {
+    const Segment& state = *segments_[index];
+    const TextSegment& segment = *state.segment;
+    const bool filtered = !query.domain.empty();
+    RoaringView domainRows;
+    if (filtered && !segment.domainRows(query.domain, domainRows)) {
+        return;
+    }
+
+    struct TermCursor {
+        PostingCursor postings;
+        size_t term;
+        float maxScore;
+    };
+    std::vector<TermCursor> cursors(terms.size());
+    size_t used = 0;
+    for (size_t i = 0; i < terms.size(); ++i) {
+        const TextTermEntry* entry = segment.findTerm(terms[i]);
+        if (!entry) {
+            if (query.matchAll) {
+                return;
+            }
+            continue;
+        }
+        TermCursor& cursor = cursors[used++];
+        segment.postings(*entry, cursor.postings);
+        cursor.term = i;
+        cursor.maxScore = scorer.weight(i, entry->maxFreq, entry->minLength);
+    }
+    cursors.resize(used);
+    if (cursors.empty()) {
+        return;
+    }
+
+    const uint32_t* lengths = segment.lengths();
+    const bool masking = !active_.empty() || !frozen_.empty();
+    auto collect = [&](uint32_t row, float score) {
+        // Rows replaced by a newer write are skipped only once they could make the cut
+        if (top.wouldAccept(score) && !(masking && findDelta(segment.id(row)))) {
+            top.offer({score, segment.id(row), &segment, row, nullptr});
+        }
+    };
+    auto eligible = [&](uint32_t row) {
+        return !state.isDeleted(row) && (!filtered || domainRows.contains(row));
+    };
+
+    // A small domain: score its rows one by one instead of walking postings past everything else
+    if (filtered && domainRows.cardinality() <= options_.filterScanThreshold) {
+        std::vector<uint32_t> rows;
+        domainRows.toArray(rows);
+        for (uint32_t row : rows) {
+            if (state.isDeleted(row)) {
+                continue;
+            }
+            float score = 0;
+            size_t matched = 0;
+            for (TermCursor& cursor : cursors) {
+                cursor.postings.advance(row);
+                if (cursor.postings.doc() == row) {
+                    score += scorer.weight(cursor.term, cursor.postings.freq(), lengths[row]);
+                    ++matched;
+                }
+            }
+            if (matched > 0 && (!query.matchAll || matched == terms.size())) {
+                collect(row, score);
+            }
+        }
+        return;
+    }
+
+    if (query.matchAll) {
+        // Block-max intersection led by the rarest term: before aligning the
+        // cursors on a candidate, the block maxima of the blocks holding it
+        // must add up to more than the heap threshold. Runs of blocks that
+        // cannot are stepped over on the skip tables alone, without decoding
+        std::sort(cursors.begin(), cursors.end(), [](const TermCursor& a, const TermCursor& b) {
+            return a.postings.docFreq() < b.postings.docFreq();
+        });
+        PostingCursor& lead = cursors[0].postings;
+        uint32_t doc = lead.doc();
+        uint32_t checkedEnd = 0;     // Documents below this lie in blocks whose bound is checkedBound
+        float checkedBound = 0;
+        while (doc != PostingCursor::kEnd) {
+            const float threshold = top.threshold();
+            if (threshold > 0 && (doc >= checkedEnd || checkedBound <= threshold)) {
+                uint32_t target = doc;
+                bool exhausted = false;
+                while (!exhausted) {
+                    float bound = 0;
+                    uint32_t boundary = PostingCursor::kEnd;
+                    for (TermCursor& cursor : cursors) {
+                        const PostingBlock* block = cursor.postings.shallowAdvance(target);
+                        if (!block) {
+                            exhausted = true;
+                            break;
+                        }
+                        bound += scorer.weight(cursor.term, block->maxFreq, block->minLength);
+                        boundary = std::min(boundary, block->lastDoc + 1);
+                    }
+                    if (bound > threshold) {
+                        checkedEnd = boundary;
+                        checkedBound = bound;
+                        break;
+                    }
+                    target = boundary;
+                }
+                if (exhausted) {
+                    break;
+                }
+                if (target > doc) {
+                    lead.advance(target);
+                    doc = lead.doc();
+                    continue;
+                }
+            }
+
+            bool aligned = true;
+            for (size_t i = 1; i < cursors.size(); ++i) {
+                PostingCursor& postings = cursors[i].postings;
+                postings.advance(doc);
+                if (postings.doc() != doc) {
+                    aligned = false;
+                    doc = postings.doc();
+                    break;
+                }
+            }
+            if (!aligned) {
+                lead.advance(doc);
+                doc = lead.doc();
+                continue;
+            }
+
+            if (eligible(doc)) {
+                float score = 0;
+                for (const TermCursor& cursor : cursors) {
+                    score += scorer.weight(cursor.term, cursor.postings.freq(), lengths[doc]);
+                }
+                collect(doc, score);
+            }
+            lead.next();
+            doc = lead.doc();
+        }
+        return;
+    }
+
+    // Block-max WAND (Ding & Suel): with cursors ordered by document, the
+    // pivot is the first document whose terms' list maxima could beat the
+    // threshold; it is scored only if the maxima of the blocks holding it
+    // could too, otherwise the cursors jump past the end of those blocks
+    std::vector<TermCursor*> order;
+    for (TermCursor& cursor : cursors) {
+        order.push_back(&cursor);
+    }
+    auto byDoc = [](const TermCursor* a, const TermCursor* b) { return a->postings.doc() < b->postings.doc(); };
+    while (true) {
+        std::sort(order.begin(), order.end(), byDoc);
+        const float threshold = top.threshold();
+        float upper = 0;
+        size_t pivot = order.size();
+        for (size_t i = 0; i < order.size() && order[i]->postings.doc() != PostingCursor::kEnd; ++i) {
+            upper += order[i]->maxScore;
+            if (upper > threshold) {
+                pivot = i;
+                break;
+            }
+        }
+        if (pivot == order.size()) {
+            break;
+        }
+        const uint32_t pivotDoc = order[pivot]->postings.doc();
+        while (pivot + 1 < order.size() && order[pivot + 1]->postings.doc() == pivotDoc) {
+            ++pivot;
+        }
+
+        float bound = 0;
+        uint32_t boundary = PostingCursor::kEnd;
+        for (size_t i = 0; i <= pivot; ++i) {
+            const PostingBlock* block = order[i]->postings.shallowAdvance(pivotDoc);
+            if (block) {
+                bound += scorer.weight(order[i]->term, block->maxFreq, block->minLength);
+                boundary = std::min(boundary, block->lastDoc + 1);
+            }
+        }
+
+        if (bound > threshold) {
+            if (order[0]->postings.doc() == pivotDoc) {
+                if (eligible(pivotDoc)) {
+                    float score = 0;
+                    for (size_t i = 0; i <= pivot; ++i) {
+                        score += scorer.weight(order[i]->term, order[i]->postings.freq(), lengths[pivotDoc]);
+                    }
+                    collect(pivotDoc, score);
+                }
+                for (size_t i = 0; i <= pivot; ++i) {
+                    order[i]->postings.next();
+                }
+            } else {
+                for (size_t i = 0; i < pivot && order[i]->postings.doc() < pivotDoc; ++i) {
+                    order[i]->postings.advance(pivotDoc);
+                }
+            }
+        } else {
+            // No document before the first block boundary (or the next term's
+            // cursor) can make the cut
+            uint32_t next = boundary;
+            if (pivot + 1 < order.size()) {
+                next = std::min(next, order[pivot + 1]->postings.doc());
+            }
+            next = std::max(next, pivotDoc + 1);
+            for (size_t i = 0; i <= pivot; ++i) {
+                order[i]->postings.advance(next);
+            }
+        }
+    }
+}
+
+// ─── Delta ──────────────────────────────────────────────────────────────────
+
+void TextIndex::Delta::put(uint64_t id, DeltaDoc doc) {
+    auto it = docs.find(id);
+    if (it != docs.end() && !it->second.deleted) {
+        totalLength -= it->second.length;
+        --liveDocs;
+    }
+    doc.sequence = ++sequence;
+    if (!doc.deleted) {
+        totalLength += doc.length;
+        ++liveDocs;
+        for (const auto& term : doc.terms) {
+            postings[term.first].push_back({id, term.second, doc.sequence});
+        }
+    }
+    docs[id] = std::move(doc);
+}
+
+void TextIndex::Delta::clear() {
+    docs.clear();
+    postings.clear();
+    totalLength = 0;
+    liveDocs = 0;
+}
+
+void TextIndex::Delta::swap(Delta& other) {
+    docs.swap(other.docs);
+    postings.swap(other.postings);
+    std::swap(totalLength, other.totalLength);
+    std::swap(liveDocs, other.liveDocs);
+}
+
+bool TextIndex::Segment::markDeleted(uint32_t row) {
+    uint64_t& word = deleted[row >> 6];
+    const uint64_t bit = uint64_t(1) << (row & 63);
+    if (word & bit) {
+        return false;
+    }
+    word |= bit;
+    ++deletedCount;
+    return true;
+}
+
+TextIndex::DeltaDoc TextIndex::makeDeltaDoc(Metadata fields) {
+    DeltaDoc doc;
+    doc.length = 0;
+    doc.deleted = false;
+
+    // Terms are copied into one buffer (the splitter reuses its own) and
+    // counted by sorting, which is much cheaper than a map per document
+    std::string buffer;
+    std::vector<std::pair<uint32_t, uint32_t>> spans;    // Offset and length in buffer
+    uint32_t markdownTerms = 0;
+    for (const char* field : kIndexedFields) {
+        auto it = fields.find(field);
+        if (it == fields.end()) {
+            continue;
+        }
+        const bool markdown = it->first == "markdown";
+        TermSplitter splitter(it->second);
+        std::string_view term;
+        size_t previousEnd = 0;
+        while (splitter.next(term)) {
+            spans.emplace_back(static_cast<uint32_t>(buffer.size()), static_cast<uint32_t>(term.size()));
+            buffer.append(term.data(), term.size());
+            if (markdown) {
+                appendTermOffset(it->second, splitter.source(), term, previousEnd, doc.termOffsets);
+                ++markdownTerms;
+            }
+        }
+    }
+    doc.length = static_cast<uint32_t>(spans.size());
+    auto view = [&buffer](const std::pair<uint32_t, uint32_t>& span) {
+        return std::string_view(buffer.data() + span.first, span.second);
+    };
+    std::sort(spans.begin(), spans.end(), [&view](const auto& a, const auto& b) { return view(a) < view(b); });
+    for (size_t i = 0; i < spans.size();) {
+        size_t j = i + 1;
+        while (j < spans.size() && view(spans[j]) == view(spans[i])) {
+            ++j;
+        }
+        doc.terms.emplace_back(std::string(view(spans[i])), static_cast<uint32_t>(j - i));
+        i = j;
+    }
+
+    // The raw page is indexed but not returned with hits
+    fields.erase("content");
+    if (!fields.count("word_count")) {
+        fields["word_count"] = std::to_string(markdownTerms);
+    }
+    doc.stored = std::move(fields);
+    return doc;
+}
+
+const TextIndex::DeltaDoc* TextIndex::findDelta(uint64_t id) const {
+    auto it = active_.docs.find(id);
+    if (it != active_.docs.end()) {
+        return &it->second;
+    }
+    it = frozen_.docs.find(id);
+    return it != frozen_.docs.end() ? &it->second : nullptr;
+}
+
+bool TextIndex::liveInSegments(uint64_t id, size_t end) const {
+    for (size_t i = 0; i < end; ++i) {
+        uint32_t row = segments_[i]->segment->findRow(id);
+        if (row != kInvalidRow && !segments_[i]->isDeleted(row)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ─── Store ──────────────────────────────────────────────────────────────────
+
+TextIndex::TextIndex()
+    : logFd_(-1), logGeneration_(0), nextGeneration_(1), backgroundRunning_(false), flushRequested_(false),
+      openMillis_(0.0), lastFlushMillis_(0.0), lastMergeMillis_(0.0), flushes_(0), merges_(0) {}
+
+TextIndex::~TextIndex() {
+    close();
+}
+
+std::string TextIndex::segmentPath(uint64_t generation) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "segment-%08llu.tsx", static_cast<unsigned long long>(generation));
+    return options_.directory + "/" + name;
+}
+
+std::string TextIndex::logPath(uint64_t generation) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "delta-%08llu.log", static_cast<unsigned long long>(generation));
+    return options_.directory + "/" + name;
+}
+
+bool TextIndex::writeCurrent(const Segments& segments) const {
+    std::string names;
+    for (const auto& state : segments) {
+        const std::string& path = state->segment->path();
+        names += path.substr(path.find_last_of('/') + 1) + "\n";
+    }
+    return writeFileAtomic(options_.directory + "/" + kCurrentFile, names);
+}
+
+bool TextIndex::open(const TextIndexOptions& options) {
+    close();
+    options_ = options;
+    auto start = std::chrono::steady_clock::now();
+
+    std::error_code ec;
+    fs::create_directories(options_.directory, ec);
+    if (ec) {
+        std::cerr << "Failed to create text index directory " << options_.directory << ": " << ec.message()
+                  << std::endl;
+        return false;
+    }
+
+    // Map the live segments, oldest first, and apply each one's tombstones to those before it
+    std::vector<std::string> live;
+    uint64_t replayFrom = 0;
+    uint64_t maxGeneration = 0;
+    std::ifstream current(options_.directory + "/" + kCurrentFile);
+    std::string name;
+    while (current && std::getline(current, name)) {
+        if (name.empty()) {
+            continue;
+        }
+        uint64_t generation = 0;
+        if (!parseGeneration(name, "segment-", ".tsx", generation)) {
+            std::cerr << "Unrecognized CURRENT entry: " << name << std::endl;
+            return false;
+        }
+        auto state = std::make_shared<Segment>();
+        state->segment = std::make_shared<TextSegment>();
+        if (!state->segment->open(options_.directory + "/" + name)) {
+            segments_.clear();
+            return false;
+        }
+        state->deleted.assign((state->segment->size() + 63) / 64, 0);
+        size_t count = 0;
+        const uint64_t* tombstones = state->segment->tombstones(&count);
+        for (size_t i = 0; i < count; ++i) {
+            for (const auto& older : segments_) {
+                uint32_t row = older->segment->findRow(tombstones[i]);
+                if (row != kInvalidRow) {
+                    older->markDeleted(row);
+                }
+            }
+        }
+        replayFrom = std::max(replayFrom, state->segment->logGeneration());
+        maxGeneration = std::max(maxGeneration, generation);
+        segments_.push_back(state);
+        live.push_back(name);
+    }
+
+    // Replay delta logs written since the newest flush; drop leftovers of older or failed work
+    std::vector<uint64_t> logs;
+    for (const fs::directory_entry& entry : fs::directory_iterator(options_.directory, ec)) {
+        std::string file = entry.path().filename().string();
+        uint64_t generation = 0;
+        if (parseGeneration(file, "delta-", ".log", generation)) {
+            if (generation >= replayFrom) {
+                logs.push_back(generation);
+            } else {
+                fs::remove(entry.path(), ec);
+            }
+        } else if ((parseGeneration(file, "segment-", ".tsx", generation) &&
+                    std::find(live.begin(), live.end(), file) == live.end()) ||
+                   (file.size() > 4 && file.compare(file.size() - 4, 4, ".tmp") == 0)) {
+            fs::remove(entry.path(), ec);
+        }
+    }
+    std::sort(logs.begin(), logs.end());
+    for (uint64_t generation : logs) {
+        if (!replayLog(logPath(generation))) {
+            return false;
+        }
+    }
+
+    logGeneration_ = logs.empty() ? replayFrom : std::max(replayFrom, logs.back());
+    nextGeneration_ = std::max(maxGeneration, logGeneration_) + 1;
+    if (!openLog(logGeneration_)) {
+        return false;
+    }
+
+    openMillis_ = millisSince(start);
+    std::cout << "Text index opened in " << openMillis_ << " ms: " << segments_.size() << " segments, "
+              << active_.docs.size() << " delta documents" << std::endl;
+    return true;
+}
+
+void TextIndex::close() {
+    stopBackgroundMaintenance();
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (logFd_ >= 0) {
+        ::close(logFd_);
+        logFd_ = -1;
+    }
+    segments_.clear();
+    active_.clear();
+    frozen_.clear();
+}
+
+bool TextIndex::openLog(uint64_t generation) {
+    int fd = ::open(logPath(generation).c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to open delta log " << logPath(generation) << std::endl;
+        return false;
+    }
+    if (logFd_ >= 0) {
+        ::close(logFd_);
+    }
+    logFd_ = fd;
+    logGeneration_ = generation;
+    syncDirectory(options_.directory);
+    return true;
+}
+
+bool TextIndex::writeLog(const std::string& records) {
+    // A failed append is cut back off, or replay would stop at it and drop every record after
+    const off_t start = ::lseek(logFd_, 0, SEEK_END);
+    if (start < 0) {
+        std::cerr << "Delta log write failed" << std::endl;
+        return false;
+    }
+    if (writeAll(logFd_, records.data(), records.size(), -1) && (!options_.syncWrites || fdatasync(logFd_) == 0)) {
+        return true;
+    }
+    std::cerr << "Delta log write failed" << std::endl;
+    if (::ftruncate(logFd_, start) != 0) {
+        std::cerr << "Failed to roll back delta log " << logPath(logGeneration_) << std::endl;
+    }
+    return false;
+}
+
+bool TextIndex::replayLog(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    size_t pos = 0;
+    while (data.size() - pos >= 8) {
+        uint32_t length = readRaw<uint32_t>(data.data() + pos);
+        uint32_t crc = readRaw<uint32_t>(data.data() + pos + 4);
+        if (data.size() - pos - 8 < length || crc32c(data.data() + pos + 8, length) != crc || length < 9) {
+            break;
+        }
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(data.data() + pos + 8);
+        const uint8_t op = p[0];
+        const uint64_t id = readRaw<uint64_t>(p + 1);
+        if (op == kLogAdd) {
+            Metadata fields;
+            if (!decodeMetadata(p + 9, length - 9, fields)) {
+                break;
+            }
+            active_.put(id, makeDeltaDoc(std::move(fields)));
+        } else {
+            active_.put(id, DeltaDoc{{}, {}, 0, true, 0, {}});
+        }
+        pos += 8 + length;
+    }
+
+    if (pos < data.size()) {
+        // Torn write at the tail from a crash; drop it so new records append cleanly
+        std::cerr << "Truncating delta log " << path << " at offset " << pos << std::endl;
+        if (truncate(path.c_str(), static_cast<off_t>(pos)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TextIndex::requestFlush(size_t pending) {
+    if (pending >= options_.flushThreshold) {
+        std::lock_guard<std::mutex> lock(backgroundMutex_);
+        flushRequested_ = true;
+        backgroundCv_.notify_one();
+    }
+}
+
+bool TextIndex::add(const TextDocument& document) {
+    std::vector<TextDocument> batch{document};
+    return addBatch(batch);
+}
+
+bool TextIndex::addBatch(std::vector<TextDocument>& documents) {
+    if (documents.empty()) {
+        return true;
+    }
+    // Tokenize and encode outside the write lock
+    std::string log;
+    std::vector<DeltaDoc> docs;
+    docs.reserve(documents.size());
+    for (TextDocument& document : documents) {
+        encodeLogRecord(kLogAdd, document.id, &document.fields, log);
+        docs.push_back(makeDeltaDoc(std::move(document.fields)));
+    }
+
+    size_t pending;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        if (!writeLog(log)) {
+            return false;
+        }
+        for (size_t i = 0; i < docs.size(); ++i) {
+            active_.put(documents[i].id, std::move(docs[i]));
+        }
+        pending = active_.docs.size();
+    }
+    requestFlush(pending);
+    return true;
+}
+
+bool TextIndex::remove(uint64_t id) {
+    std::string log;
+    encodeLogRecord(kLogDelete, id, nullptr, log);
+    size_t pending;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        if (!writeLog(log)) {
+            return false;
+        }
+        active_.put(id, DeltaDoc{{}, {}, 0, true, 0, {}});
+        pending = active_.docs.size();
+    }
+    requestFlush(pending);
+    return true;
+}
+
+bool TextIndex::flush() {
+    std::lock_guard<std::mutex> guard(maintenanceMutex_);
+    auto start = std::chrono::steady_clock::now();
+
+    uint64_t generation;
+    Segments base;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        if (active_.empty()) {
+            return true;
+        }
+        // New writes go to the next log; the frozen delta stays searchable until the swap
+        generation = nextGeneration_++;
+        if (!openLog(generation)) {
+            return false;
+        }
+        frozen_.swap(active_);
+        base = segments_;
+    }
+
+    // Only this thread mutates frozen_ and the segment list from here on, so both can be read without the lock
+    std::vector<uint64_t> ids;
+    std::vector<uint64_t> tombstones;
+    for (const auto& kv : frozen_.docs) {
+        if (!kv.second.deleted) {
+            ids.push_back(kv.first);
+        }
+        if (liveInSegments(kv.first, base.size())) {
+            tombstones.push_back(kv.first);
+        }
+    }
+    std::sort(ids.begin(), ids.end());
+
+    const std::string path = segmentPath(generation);
+    TextSegmentWriter writer(path, generation, generation);
+    writer.setStoredCompression(options_.compressStored, options_.storedDictionaryBytes);
+    std::unordered_map<uint64_t, uint32_t> rows;
+    std::vector<uint32_t> sequences;
+    rows.reserve(ids.size());
+    sequences.reserve(ids.size());
+    std::string stored;
+    for (uint32_t row = 0; row < ids.size(); ++row) {
+        const DeltaDoc& doc = frozen_.docs.find(ids[row])->second;
+        rows.emplace(ids[row], row);
+        sequences.push_back(doc.sequence);
+        stored.clear();
+        encodeMetadata(doc.stored, stored);
+        writer.addDocument(ids[row], doc.length, reinterpret_cast<const uint8_t*>(stored.data()), stored.size(),
+                           doc.termOffsets);
+    }
+
+    // The delta's postings become the segment's once ids are mapped to rows,
+    // less the entries of documents replaced or deleted since
+    std::vector<const std::pair<const std::string, std::vector<DeltaPosting>>*> terms;
+    terms.reserve(frozen_.postings.size());
+    for (const auto& kv : frozen_.postings) {
+        terms.push_back(&kv);
+    }
+    std::sort(terms.begin(), terms.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+    std::vector<std::pair<uint32_t, uint32_t>> postings;
+    std::vector<uint32_t> docs;
+    std::vector<uint32_t> freqs;
+    for (const auto* term : terms) {
+        postings.clear();
+        for (const DeltaPosting& posting : term->second) {
+            auto row = rows.find(posting.id);
+            if (row != rows.end() && sequences[row->second] == posting.sequence) {
+                postings.emplace_back(row->second, posting.freq);
+            }
+        }
+        std::sort(postings.begin(), postings.end());
+        docs.clear();
+        freqs.clear();
+        for (const auto& posting : postings) {
+            docs.push_back(posting.first);
+            freqs.push_back(posting.second);
+        }
+        writer.addTerm(term->first, docs.data(), freqs.data(), docs.size());
+    }
+    writer.setTombstones(tombstones);
+
+    auto state = std::make_shared<Segment>();
+    state->segment = std::make_shared<TextSegment>();
+    Segments next = base;
+    next.push_back(state);
+    bool ok = writer.finish() && state->segment->open(path) && writeCurrent(next);
+    if (!ok) {
+        std::cerr << "Text index flush to generation " << generation << " failed" << std::endl;
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        // Newer writes in active_ win; the frozen documents are still in their logs
+        for (auto& kv : frozen_.docs) {
+            if (!active_.docs.count(kv.first)) {
+                active_.put(kv.first, std::move(kv.second));
+            }
+        }
+        frozen_.clear();
+        return false;
+    }
+    state->deleted.assign((state->segment->size() + 63) / 64, 0);
+
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        for (uint64_t id : tombstones) {
+            for (const auto& older : base) {
+                uint32_t row = older->segment->findRow(id);
+                if (row != kInvalidRow) {
+                    older->markDeleted(row);
+                }
+            }
+        }
+        segments_ = next;
+        frozen_.clear();
+    }
+
+    std::error_code ec;
+    for (const fs::directory_entry& entry : fs::directory_iterator(options_.directory, ec)) {
+        uint64_t logGen = 0;
+        if (parseGeneration(entry.path().filename().string(), "delta-", ".log", logGen) && logGen < generation) {
+            fs::remove(entry.path(), ec);
+        }
+    }
+
+    lastFlushMillis_ = millisSince(start);
+    ++flushes_;
+    std::cout << "Flushed text index to segment " << generation << " (" << ids.size() << " documents, "
+              << tombstones.size() << " tombstones) in " << lastFlushMillis_.load() << " ms" << std::endl;
+    return true;
+}
+
+bool TextIndex::merge(bool full) {
+    std::lock_guard<std::mutex> guard(maintenanceMutex_);
+    auto start = std::chrono::steady_clock::now();
+
+    Segments base;
+    uint64_t generation;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        base = segments_;
+    }
+
+    // The run of adjacent segments to merge; adjacent so that the merged
+    // segment keeps its place in the replacement order
+    size_t first = 0;
+    size_t last = base.size();
+    if (full) {
+        if (base.empty() || (base.size() == 1 && base[0]->deletedCount == 0)) {
+            return true;
+        }
+    } else {
+        const size_t width = std::max<size_t>(options_.mergeFactor, 2);
+        if (base.size() < width) {
+            return true;
+        }
+        uint64_t best = UINT64_MAX;
+        for (size_t i = 0; i + width <= base.size(); ++i) {
+            uint64_t docs = 0;
+            for (size_t j = i; j < i + width; ++j) {
+                docs += base[j]->segment->size();
+            }
+            if (docs < best) {
+                best = docs;
+                first = i;
+            }
+        }
+        last = first + width;
+    }
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        generation = nextGeneration_++;
+    }
+
+    // Live rows keep their order, so remapped postings stay ascending
+    const std::string path = segmentPath(generation);
+    uint64_t logGeneration = 0;
+    for (size_t i = first; i < last; ++i) {
+        logGeneration = std::max(logGeneration, base[i]->segment->logGeneration());
+    }
+    TextSegmentWriter writer(path, generation, logGeneration);
+    writer.setStoredCompression(options_.compressStored, options_.storedDictionaryBytes);
+    std::vector<std::vector<uint32_t>> remap(last - first);
+    std::string buffer;
+    for (size_t i = first; i < last; ++i) {
+        const Segment& input = *base[i];
+        remap[i - first].assign(input.segment->size(), kInvalidRow);
+        for (uint32_t row = 0; row < input.segment->size(); ++row) {
+            if (input.isDeleted(row)) {
+                continue;
+            }
+            remap[i - first][row] = writer.size();
+            size_t length = 0;
+            const uint8_t* stored = input.segment->storedRecord(row, buffer, &length);
+            writer.addDocument(input.segment->id(row), input.segment->lengths()[row], stored, length,
+                               input.segment->termOffsets(row));
+        }
+    }
+
+    // Walk the sorted term directories together, concatenating each term's postings
+    std::vector<uint64_t> positions(last - first, 0);
+    std::vector<uint32_t> docs;
+    std::vector<uint32_t> freqs;
+    PostingCursor cursor;
+    while (true) {
+        std::string_view term;
+        bool found = false;
+        for (size_t k = 0; k < positions.size(); ++k) {
+            const TextSegment& input = *base[first + k]->segment;
+            if (positions[k] < input.termCount() && (!found || input.term(positions[k]) < term)) {
+                term = input.term(positions[k]);
+                found = true;
+            }
+        }
+        if (!found) {
+            break;
+        }
+        docs.clear();
+        freqs.clear();
+        for (size_t k = 0; k < positions.size(); ++k) {
+            const TextSegment& input = *base[first + k]->segment;
+            if (positions[k] >= input.termCount() || input.term(positions[k]) != term) {
+                continue;
+            }
+            input.postings(input.termEntry(positions[k]), cursor);
+            for (; cursor.doc() != PostingCursor::kEnd; cursor.next()) {
+                const uint32_t row = remap[k][cursor.doc()];
+                if (row != kInvalidRow) {
+                    docs.push_back(row);
+                    freqs.push_back(cursor.freq());
+                }
+            }
+            ++positions[k];
+        }
+        writer.addTerm(term, docs.data(), freqs.data(), docs.size());
+    }
+
+    // Tombstones still matter only where they delete from segments older than the run
+    std::vector<uint64_t> tombstones;
+    for (size_t i = first; i < last; ++i) {
+        size_t count = 0;
+        const uint64_t* ids = base[i]->segment->tombstones(&count);
+        for (size_t j = 0; j < count; ++j) {
+            for (size_t older = 0; older < first; ++older) {
+                if (base[older]->segment->findRow(ids[j]) != kInvalidRow) {
+                    tombstones.push_back(ids[j]);
+                    break;
+                }
+            }
+        }
+    }
+    writer.setTombstones(tombstones);
+    const uint32_t rows = writer.size();
+
+    auto state = std::make_shared<Segment>();
+    state->segment = std::make_shared<TextSegment>();
+    Segments next(base.begin(), base.begin() + first);
+    next.push_back(state);
+    next.insert(next.end(), base.begin() + last, base.end());
+    bool ok = writer.finish() && state->segment->open(path) && writeCurrent(next);
+    if (!ok) {
+        std::cerr << "Text index merge to generation " << generation << " failed" << std::endl;
+        std::error_code ec;
+        fs::remove(path, ec);
+        return false;
+    }
+    state->deleted.assign((state->segment->size() + 63) / 64, 0);
+
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        segments_ = next;
+    }
+
+    // Readers still holding the old segments keep their mappings until they finish
+    std::error_code ec;
+    for (size_t i = first; i < last; ++i) {
+        fs::remove(base[i]->segment->path(), ec);
+    }
+
+    lastMergeMillis_ = millisSince(start);
+    ++merges_;
+    std::cout << "Merged " << last - first << " text segments into segment " << generation << " (" << rows
+              << " documents) in " << lastMergeMillis_.load() << " ms" << std::endl;
+    return true;
+}
+
+void TextIndex::startBackgroundMaintenance() {
+    std::lock_guard<std::mutex> lock(backgroundMutex_);
+    if (backgroundRunning_) {
+        return;
+    }
+    backgroundRunning_ = true;
+    backgroundThread_ = std::thread(&TextIndex::backgroundLoop, this);
+}
+
+void TextIndex::stopBackgroundMaintenance() {
+    {
+        std::lock_guard<std::mutex> lock(backgroundMutex_);
+        if (!backgroundRunning_) {
+            return;
+        }
+        backgroundRunning_ = false;
+        backgroundCv_.notify_one();
+    }
+    if (backgroundThread_.joinable()) {
+        backgroundThread_.join();
+    }
+}
+
+void TextIndex::backgroundLoop() {
+    std::unique_lock<std::mutex> lock(backgroundMutex_);
+    while (backgroundRunning_) {
+        backgroundCv_.wait_for(lock, std::chrono::seconds(options_.flushIntervalSeconds),
+                               [this] { return !backgroundRunning_ || flushRequested_; });
+        if (!backgroundRunning_) {
+            break;
+        }
+        flushRequested_ = false;
+        lock.unlock();
+        if (flush()) {
+            size_t segments;
+            do {
+                {
+                    std::shared_lock<std::shared_mutex> read(mutex_);
+                    segments = segments_.size();
+                }
+            } while (segments >= std::max<size_t>(options_.mergeFactor, 2) && merge(false));
+        }
+        lock.lock();
+    }
+}
+
+size_t TextIndex::count() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    size_t total = 0;
+    for (const auto& state : segments_) {
+        total += state->segment->size() - state->deletedCount;
+    }
+    for (const Delta* delta : {&active_, &frozen_}) {
+        for (const auto& kv : delta->docs) {
+            if (findDelta(kv.first) != &kv.second) {
+                continue;
+            }
+            bool inSegments = liveInSegments(kv.first, segments_.size());
+            if (kv.second.deleted && inSegments) {
+                --total;
+            } else if (!kv.second.deleted && !inSegments) {
+                ++total;
+            }
+        }
+    }
+    return total;
+}
+
+TextIndexStats TextIndex::stats() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    TextIndexStats s = TextIndexStats();
+    s.segments = segments_.size();
+    for (const auto& state : segments_) {
+        s.segmentDocs += state->segment->size();
+        s.deletedDocs += state->deletedCount;
+        s.segmentBytes += state->segment->fileSize();
+        s.storedBytes += state->segment->storedBytes();
+        s.storedRawBytes += state->segment->storedRawBytes();
+    }
+    s.deltaDocs = active_.docs.size() + frozen_.docs.size();
+    s.openMillis = openMillis_;
+    s.lastFlushMillis = lastFlushMillis_.load();
+    s.lastMergeMillis = lastMergeMillis_.load();
+    s.flushes = flushes_.load();
+    s.merges = merges_.load();
+    return s;
+}
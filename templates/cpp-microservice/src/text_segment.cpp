@@ -0,0 +1,499 @@
+#include "text_segment.h"
+#include "checksum.h"
+#include "file_util.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+const char kTextSegmentMagic[8] = {'D', 'S', 'S', 'T', 'S', 'E', 'G', '\0'};
+const size_t kPageSize = VectorSegment::kPageSize;
+const size_t kDictionarySampleBytes = 4 << 20;    // Stored records a segment's dictionary is trained on
+
+struct IdTableEntry {
+    uint64_t id;
+    uint32_t row;
+    uint32_t pad;
+};
+
+struct DomainEntry {
+    uint64_t termOffset;
+    uint64_t bitmapOffset;
+    uint32_t termLength;
+    uint32_t bitmapLength;
+};
+
+uint64_t alignToPage(uint64_t offset) {
+    return (offset + kPageSize - 1) & ~static_cast<uint64_t>(kPageSize - 1);
+}
+
+uint32_t headerChecksum(TextSegmentHeader header) {
+    header.checksum = 0;
+    return crc32c(&header, sizeof(header));
+}
+
+// Ids are assigned by the caller and often sequential; mix them before masking
+uint64_t idSlot(uint64_t id, uint64_t mask) {
+    id ^= id >> 33;
+    id *= 0xff51afd7ed558ccdull;
+    id ^= id >> 33;
+    return id & mask;
+}
+
+} // namespace
+
+// ─── TextSegment ────────────────────────────────────────────────────────────
+
+TextSegment::TextSegment()
+    : header_(), terms_(nullptr), termDirectory_(nullptr), termCount_(0), postings_(nullptr), lengths_(nullptr),
+      ids_(nullptr), idTable_(nullptr), idTableMask_(0), storedOffsets_(nullptr), storedBlob_(nullptr),
+      compressed_(false), storedRawBytes_(0), termOffsetIndex_(nullptr), termOffsets_(nullptr), domainTerms_(nullptr),
+      domainDirectory_(nullptr), domainCount_(0), domainBitmaps_(nullptr) {}
+
+TextSegment::~TextSegment() {
+    close();
+}
+
+bool TextSegment::open(const std::string& path) {
+    close();
+    if (!file_.open(path)) {
+        std::cerr << "Failed to map text segment: " << path << std::endl;
+        return false;
+    }
+    if (!validate()) {
+        std::cerr << "Invalid text segment: " << path << std::endl;
+        close();
+        return false;
+    }
+    // Queries jump between postings lists, lengths and stored fields
+    file_.adviseRandom(true);
+    return true;
+}
+
+void TextSegment::close() {
+    file_.close();
+    header_ = TextSegmentHeader();
+    terms_ = nullptr;
+    termDirectory_ = nullptr;
+    termCount_ = 0;
+    postings_ = nullptr;
+    lengths_ = nullptr;
+    ids_ = nullptr;
+    idTable_ = nullptr;
+    idTableMask_ = 0;
+    storedOffsets_ = nullptr;
+    storedBlob_ = nullptr;
+    compressed_ = false;
+    dictionary_ = LzDictionary();
+    storedRawBytes_ = 0;
+    termOffsetIndex_ = nullptr;
+    termOffsets_ = nullptr;
+    domainTerms_ = nullptr;
+    domainDirectory_ = nullptr;
+    domainCount_ = 0;
+    domainBitmaps_ = nullptr;
+}
+
+const uint8_t* TextSegment::section(TextSegmentSection section, size_t* length) const {
+    const TextSegmentHeader::Section& s = header_.sections[static_cast<uint32_t>(section)];
+    if (length) {
+        *length = s.length;
+    }
+    return s.length ? file_.data() + s.offset : nullptr;
+}
+
+bool TextSegment::validate() {
+    if (file_.size() < sizeof(TextSegmentHeader)) {
+        return false;
+    }
+    std::memcpy(&header_, file_.data(), sizeof(TextSegmentHeader));
+
+    if (std::memcmp(header_.magic, kTextSegmentMagic, sizeof(kTextSegmentMagic)) != 0) {
+        return false;
+    }
+    if (header_.version != 1 && header_.version != kFormatVersion) {
+        std::cerr << "Unsupported text segment version " << header_.version << std::endl;
+        return false;
+    }
+    if (header_.checksum != headerChecksum(header_) || header_.count >= kInvalidRow) {
+        return false;
+    }
+    for (const TextSegmentHeader::Section& s : header_.sections) {
+        if (s.length == 0) {
+            continue;
+        }
+        if (s.offset % kPageSize != 0 || s.offset > file_.size() || s.length > file_.size() - s.offset) {
+            return false;
+        }
+    }
+
+    const uint64_t count = header_.count;
+    auto sectionLength = [this](TextSegmentSection s) { return header_.sections[static_cast<uint32_t>(s)].length; };
+    if (sectionLength(TextSegmentSection::DocLengths) != count * sizeof(uint32_t) ||
+        sectionLength(TextSegmentSection::DocIds) != count * sizeof(uint64_t) ||
+        sectionLength(TextSegmentSection::StoredOffsets) != (count + 1) * sizeof(uint64_t) ||
+        sectionLength(TextSegmentSection::TermDirectory) % sizeof(TextTermEntry) != 0 ||
+        sectionLength(TextSegmentSection::DomainDirectory) % sizeof(DomainEntry) != 0 ||
+        sectionLength(TextSegmentSection::Tombstones) % sizeof(uint64_t) != 0) {
+        return false;
+    }
+    const uint64_t termOffsetIndexLength = sectionLength(TextSegmentSection::TermOffsetIndex);
+    if (termOffsetIndexLength != 0 && termOffsetIndexLength != (count + 1) * sizeof(uint64_t)) {
+        return false;
+    }
+    const uint64_t tableSlots = sectionLength(TextSegmentSection::IdTable) / sizeof(IdTableEntry);
+    if (count > 0 && (tableSlots < count || (tableSlots & (tableSlots - 1)) != 0)) {
+        return false;
+    }
+
+    terms_ = reinterpret_cast<const char*>(section(TextSegmentSection::Terms, nullptr));
+    termDirectory_ = reinterpret_cast<const TextTermEntry*>(section(TextSegmentSection::TermDirectory, nullptr));
+    termCount_ = sectionLength(TextSegmentSection::TermDirectory) / sizeof(TextTermEntry);
+    postings_ = section(TextSegmentSection::Postings, nullptr);
+    lengths_ = reinterpret_cast<const uint32_t*>(section(TextSegmentSection::DocLengths, nullptr));
+    ids_ = reinterpret_cast<const uint64_t*>(section(TextSegmentSection::DocIds, nullptr));
+    idTable_ = section(TextSegmentSection::IdTable, nullptr);
+    idTableMask_ = tableSlots ? tableSlots - 1 : 0;
+    storedOffsets_ = reinterpret_cast<const uint64_t*>(section(TextSegmentSection::StoredOffsets, nullptr));
+    storedBlob_ = section(TextSegmentSection::StoredBlob, nullptr);
+    if (termOffsetIndexLength != 0) {
+        termOffsetIndex_ = reinterpret_cast<const uint64_t*>(section(TextSegmentSection::TermOffsetIndex, nullptr));
+        termOffsets_ = reinterpret_cast<const char*>(section(TextSegmentSection::TermOffsets, nullptr));
+    }
+    domainTerms_ = reinterpret_cast<const char*>(section(TextSegmentSection::DomainTerms, nullptr));
+    domainDirectory_ = section(TextSegmentSection::DomainDirectory, nullptr);
+    domainCount_ = sectionLength(TextSegmentSection::DomainDirectory) / sizeof(DomainEntry);
+    domainBitmaps_ = section(TextSegmentSection::DomainBitmaps, nullptr);
+
+    if (storedOffsets_[count] != sectionLength(TextSegmentSection::StoredBlob) ||
+        (termOffsetIndex_ && termOffsetIndex_[count] != sectionLength(TextSegmentSection::TermOffsets))) {
+        return false;
+    }
+    compressed_ = header_.version >= 2;
+    storedRawBytes_ = storedOffsets_[count];
+    if (compressed_) {
+        size_t dictionaryLength = 0;
+        const uint8_t* dictionary = section(TextSegmentSection::StoredDictionary, &dictionaryLength);
+        if (dictionaryLength > LzDictionary::kMaxSize) {
+            return false;
+        }
+        dictionary_ = LzDictionary(std::string(reinterpret_cast<const char*>(dictionary), dictionaryLength));
+        storedRawBytes_ = 0;
+        for (uint64_t row = 0; row < count; ++row) {
+            if (storedOffsets_[row + 1] < storedOffsets_[row] + 4) {
+                return false;
+            }
+            storedRawBytes_ += readRaw<uint32_t>(storedBlob_ + storedOffsets_[row]);
+        }
+    }
+    const uint64_t termBytes = sectionLength(TextSegmentSection::Terms);
+    const uint64_t postingBytes = sectionLength(TextSegmentSection::Postings);
+    for (uint64_t i = 0; i < termCount_; ++i) {
+        const TextTermEntry& entry = termDirectory_[i];
+        const uint64_t blocks = (entry.docFreq + kPostingBlockSize - 1) / kPostingBlockSize;
+        if (entry.termOffset + entry.termLength > termBytes || entry.postingsOffset % 4 != 0 ||
+            entry.postingsOffset + blocks * sizeof(PostingBlock) > postingBytes || entry.docFreq > count) {
+            return false;
+        }
+    }
+    const uint64_t domainBytes = sectionLength(TextSegmentSection::DomainTerms);
+    const uint64_t bitmapBytes = sectionLength(TextSegmentSection::DomainBitmaps);
+    for (uint64_t i = 0; i < domainCount_; ++i) {
+        DomainEntry entry = readRaw<DomainEntry>(domainDirectory_ + i * sizeof(DomainEntry));
+        if (entry.termOffset + entry.termLength > domainBytes || entry.bitmapOffset % 8 != 0 ||
+            entry.bitmapOffset + entry.bitmapLength > bitmapBytes) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string_view TextSegment::term(uint64_t i) const {
+    return std::string_view(terms_ + termDirectory_[i].termOffset, termDirectory_[i].termLength);
+}
+
+const TextTermEntry* TextSegment::findTerm(std::string_view term) const {
+    uint64_t lo = 0;
+    uint64_t hi = termCount_;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        int cmp = this->term(mid).compare(term);
+        if (cmp == 0) {
+            return termDirectory_ + mid;
+        }
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return nullptr;
+}
+
+uint32_t TextSegment::findRow(uint64_t id) const {
+    if (header_.count == 0) {
+        return kInvalidRow;
+    }
+    for (uint64_t slot = idSlot(id, idTableMask_);; slot = (slot + 1) & idTableMask_) {
+        IdTableEntry entry = readRaw<IdTableEntry>(idTable_ + slot * sizeof(IdTableEntry));
+        if (entry.row == kInvalidRow) {
+            return kInvalidRow;
+        }
+        if (entry.id == id) {
+            return entry.row;
+        }
+    }
+}
+
+Metadata TextSegment::stored(uint32_t row) const {
+    Metadata result;
+    std::string buffer;
+    size_t length = 0;
+    const uint8_t* record = storedRecord(row, buffer, &length);
+    decodeMetadata(record, length, result);
+    return result;
+}
+
+const uint8_t* TextSegment::storedRecord(uint32_t row, std::string& buffer, size_t* length) const {
+    const uint8_t* record = storedBlob_ + storedOffsets_[row];
+    *length = storedOffsets_[row + 1] - storedOffsets_[row];
+    if (!compressed_) {
+        return record;
+    }
+    buffer.resize(readRaw<uint32_t>(record));
+    if (!lzDecompress(record + 4, *length - 4, &buffer[0], buffer.size(),
+                      dictionary_.empty() ? nullptr : &dictionary_)) {
+        std::cerr << "Corrupt stored record in text segment " << path() << " row " << row << std::endl;
+        buffer.clear();
+    }
+    *length = buffer.size();
+    return reinterpret_cast<const uint8_t*>(buffer.data());
+}
+
+std::string_view TextSegment::storedValue(uint32_t row, std::string_view key, std::string& buffer) const {
+    size_t length = 0;
+    const uint8_t* record = storedRecord(row, buffer, &length);
+    return findMetadataValue(record, length, key);
+}
+
+uint64_t TextSegment::storedBytes() const {
+    return header_.sections[static_cast<uint32_t>(TextSegmentSection::StoredBlob)].length;
+}
+
+std::string_view TextSegment::termOffsets(uint32_t row) const {
+    if (!termOffsetIndex_) {
+        return std::string_view();
+    }
+    return std::string_view(termOffsets_ + termOffsetIndex_[row], termOffsetIndex_[row + 1] - termOffsetIndex_[row]);
+}
+
+bool TextSegment::domainRows(std::string_view domain, RoaringView& rows) const {
+    rows = RoaringView();
+    uint64_t lo = 0;
+    uint64_t hi = domainCount_;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        DomainEntry entry = readRaw<DomainEntry>(domainDirectory_ + mid * sizeof(DomainEntry));
+        int cmp = std::string_view(domainTerms_ + entry.termOffset, entry.termLength).compare(domain);
+        if (cmp == 0) {
+            return rows.open(domainBitmaps_ + entry.bitmapOffset, entry.bitmapLength);
+        }
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return false;
+}
+
+const uint64_t* TextSegment::tombstones(size_t* count) const {
+    size_t length = 0;
+    const uint8_t* data = section(TextSegmentSection::Tombstones, &length);
+    *count = length / sizeof(uint64_t);
+    return reinterpret_cast<const uint64_t*>(data);
+}
+
+// ─── TextSegmentWriter ──────────────────────────────────────────────────────
+
+TextSegmentWriter::TextSegmentWriter(const std::string& path, uint64_t generation, uint64_t logGeneration)
+    : path_(path), generation_(generation), logGeneration_(logGeneration), storedOffsets_(1, 0), termOffsetIndex_(1, 0),
+      totalLength_(0), compress_(true), dictionaryBytes_(16 << 10) {}
+
+void TextSegmentWriter::addDocument(uint64_t id, uint32_t length, const uint8_t* stored, size_t storedSize,
+                                    std::string_view termOffsets) {
+    ids_.push_back(id);
+    lengths_.push_back(length);
+    totalLength_ += length;
+    storedBlob_.append(reinterpret_cast<const char*>(stored), storedSize);
+    storedOffsets_.push_back(storedBlob_.size());
+    termOffsets_.append(termOffsets.data(), termOffsets.size());
+    termOffsetIndex_.push_back(termOffsets_.size());
+}
+
+void TextSegmentWriter::addTerm(std::string_view term, const uint32_t* docs, const uint32_t* freqs, size_t n) {
+    if (n == 0) {
+        return;
+    }
+    // encodePostings pads the buffer so the list's skip table starts 4-byte aligned
+    const uint64_t start = (postings_.size() + 3) & ~static_cast<uint64_t>(3);
+    PostingSummary summary;
+    encodePostings(docs, freqs, n, lengths_.data(), postings_, summary);
+    termDirectory_.push_back(TextTermEntry{terms_.size(), start, static_cast<uint32_t>(term.size()),
+                                           summary.docFreq, summary.maxFreq, summary.minLength});
+    terms_.append(term.data(), term.size());
+}
+
+void TextSegmentWriter::setTombstones(std::vector<uint64_t> ids) {
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    tombstones_ = std::move(ids);
+}
+
+void TextSegmentWriter::setStoredCompression(bool compress, size_t dictionaryBytes) {
+    compress_ = compress;
+    dictionaryBytes_ = std::min(dictionaryBytes, LzDictionary::kMaxSize);
+}
+
+bool TextSegmentWriter::finish() {
+    const uint64_t count = ids_.size();
+
+    // Id lookup table, at most half full
+    uint64_t slots = 1;
+    while (slots < count * 2) {
+        slots <<= 1;
+    }
+    std::vector<IdTableEntry> table(count ? slots : 0, IdTableEntry{0, kInvalidRow, 0});
+    for (uint32_t row = 0; row < count; ++row) {
+        uint64_t slot = idSlot(ids_[row], slots - 1);
+        while (table[slot].row != kInvalidRow) {
+            slot = (slot + 1) & (slots - 1);
+        }
+        table[slot] = IdTableEntry{ids_[row], row, 0};
+    }
+
+    // source_domain -> rows, so domain filters are applied inside the query
+    std::map<std::string_view, std::vector<uint32_t>> domains;
+    for (uint32_t row = 0; row < count; ++row) {
+        std::string_view domain =
+            findMetadataValue(reinterpret_cast<const uint8_t*>(storedBlob_.data()) + storedOffsets_[row],
+                              storedOffsets_[row + 1] - storedOffsets_[row], "source_domain");
+        if (!domain.empty()) {
+            domains[domain].push_back(row);
+        }
+    }
+    std::string domainTerms;
+    std::vector<DomainEntry> domainDirectory;
+    std::string bitmaps;
+    for (const auto& kv : domains) {
+        const size_t bitmapStart = bitmaps.size();
+        encodeRoaring(kv.second.data(), kv.second.size(), bitmaps);
+        domainDirectory.push_back(DomainEntry{domainTerms.size(), bitmapStart, static_cast<uint32_t>(kv.first.size()),
+                                              static_cast<uint32_t>(bitmaps.size() - bitmapStart)});
+        domainTerms.append(kv.first.data(), kv.first.size());
+    }
+
+    // Records are compressed one by one so a hit decompresses only its own.
+    // The dictionary is trained on records spread over the whole segment.
+    LzDictionary dictionary;
+    std::vector<uint64_t> compressedOffsets;
+    std::string compressedBlob;
+    if (compress_) {
+        auto record = [this](uint64_t row) {
+            return std::string_view(storedBlob_.data() + storedOffsets_[row],
+                                    storedOffsets_[row + 1] - storedOffsets_[row]);
+        };
+        if (dictionaryBytes_ > 0 && count > 1) {
+            const uint64_t stride = storedBlob_.size() / kDictionarySampleBytes + 1;
+            std::vector<std::string_view> samples;
+            for (uint64_t row = 0; row < count; row += stride) {
+                samples.push_back(record(row));
+            }
+            dictionary = LzDictionary::train(samples, dictionaryBytes_);
+        }
+        compressedOffsets.reserve(count + 1);
+        compressedOffsets.push_back(0);
+        compressedBlob.reserve(storedBlob_.size() / 2);
+        for (uint64_t row = 0; row < count; ++row) {
+            const std::string_view raw = record(row);
+            appendRaw<uint32_t>(compressedBlob, static_cast<uint32_t>(raw.size()));
+            lzCompress(raw.data(), raw.size(), compressedBlob, dictionary.empty() ? nullptr : &dictionary);
+            compressedOffsets.push_back(compressedBlob.size());
+        }
+    }
+    const std::vector<uint64_t>& storedOffsets = compress_ ? compressedOffsets : storedOffsets_;
+    const std::string& storedBlob = compress_ ? compressedBlob : storedBlob_;
+
+    const std::string tmpPath = path_ + ".tmp";
+    int fd = ::open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to create text segment file: " << tmpPath << std::endl;
+        return false;
+    }
+
+    TextSegmentHeader header = TextSegmentHeader();
+    uint64_t offset = kPageSize;
+    auto write = [&](TextSegmentSection section, const void* data, size_t length) {
+        header.sections[static_cast<uint32_t>(section)] = {offset, length};
+        if (length > 0 && !writeAll(fd, static_cast<const char*>(data), length, static_cast<off_t>(offset))) {
+            return false;
+        }
+        offset = alignToPage(offset + length);
+        return true;
+    };
+    bool ok = write(TextSegmentSection::Terms, terms_.data(), terms_.size()) &&
+              write(TextSegmentSection::TermDirectory, termDirectory_.data(),
+                    termDirectory_.size() * sizeof(TextTermEntry)) &&
+              write(TextSegmentSection::Postings, postings_.data(), postings_.size()) &&
+              write(TextSegmentSection::DocLengths, lengths_.data(), lengths_.size() * sizeof(uint32_t)) &&
+              write(TextSegmentSection::DocIds, ids_.data(), ids_.size() * sizeof(uint64_t)) &&
+              write(TextSegmentSection::IdTable, table.data(), table.size() * sizeof(IdTableEntry)) &&
+              write(TextSegmentSection::StoredOffsets, storedOffsets.data(),
+                    storedOffsets.size() * sizeof(uint64_t)) &&
+              write(TextSegmentSection::StoredBlob, storedBlob.data(), storedBlob.size()) &&
+              write(TextSegmentSection::DomainTerms, domainTerms.data(), domainTerms.size()) &&
+              write(TextSegmentSection::DomainDirectory, domainDirectory.data(),
+                    domainDirectory.size() * sizeof(DomainEntry)) &&
+              write(TextSegmentSection::DomainBitmaps, bitmaps.data(), bitmaps.size()) &&
+              write(TextSegmentSection::Tombstones, tombstones_.data(), tombstones_.size() * sizeof(uint64_t)) &&
+              write(TextSegmentSection::TermOffsetIndex, termOffsetIndex_.data(),
+                    termOffsetIndex_.size() * sizeof(uint64_t)) &&
+              write(TextSegmentSection::TermOffsets, termOffsets_.data(), termOffsets_.size()) &&
+              write(TextSegmentSection::StoredDictionary, dictionary.bytes().data(), dictionary.size());
+    if (!ok || ftruncate(fd, static_cast<off_t>(offset)) != 0 || fsync(fd) != 0) {
+        std::cerr << "Failed to write text segment sections: " << tmpPath << std::endl;
+        ::close(fd);
+        unlink(tmpPath.c_str());
+        return false;
+    }
+
+    // The header goes last so a partially written file never validates
+    std::memcpy(header.magic, kTextSegmentMagic, sizeof(kTextSegmentMagic));
+    header.version = compress_ ? TextSegment::kFormatVersion : 1;
+    header.headerSize = sizeof(TextSegmentHeader);
+    header.count = count;
+    header.generation = generation_;
+    header.logGeneration = logGeneration_;
+    header.totalLength = totalLength_;
+    header.checksum = headerChecksum(header);
+    if (!writeAll(fd, reinterpret_cast<const char*>(&header), sizeof(header), 0) || fsync(fd) != 0) {
+        ::close(fd);
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    ::close(fd);
+
+    if (rename(tmpPath.c_str(), path_.c_str()) != 0) {
+        std::cerr << "Failed to install text segment file: " << path_ << std::endl;
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    std::string::size_type slash = path_.find_last_of('/');
+    syncDirectory(slash == std::string::npos ? "." : path_.substr(0, slash));
+    return true;
+}
@@ -0,0 +1,123 @@
+#include "timer_wheel.h"
+#include <algorithm>
+
+TimerWheel::TimerWheel(uint64_t now) : now_(now), size_(0), free_(kNone) {
+    std::fill(levelSizes_, levelSizes_ + kLevels, 0);
+}
+
+void TimerWheel::schedule(uint64_t due, uint64_t payload) {
+    uint32_t node = free_;
+    if (node != kNone) {
+        free_ = nodes_[node].next;
+    } else {
+        node = static_cast<uint32_t>(nodes_.size());
+        nodes_.push_back(Node());
+    }
+    nodes_[node].due = std::max(due, now_ + 1);
+    nodes_[node].payload = payload;
+    ++size_;
+    place(node);
+}
+
+void TimerWheel::place(uint32_t node) {
+    // Timers beyond the top level's round wait in it and are placed again from there
+    const uint64_t span = (uint64_t(1) << (kLevels * kSlotBits)) - 1;
+    const uint64_t due = std::min(nodes_[node].due, now_ | span);
+    const uint64_t differing = due ^ now_;
+    int level = 0;
+    while (level < kLevels - 1 && (differing >> ((level + 1) * kSlotBits)) != 0) {
+        ++level;
+    }
+    Slot& slot = slots_[level][(due >> (level * kSlotBits)) & (kSlots - 1)];
+    nodes_[node].next = kNone;
+    if (slot.tail == kNone) {
+        slot.head = node;
+    } else {
+        nodes_[slot.tail].next = node;
+    }
+    slot.tail = node;
+    ++levelSizes_[level];
+}
+
+// Redistribute the slot of @p level that the current tick just entered
+void TimerWheel::cascade(int level) {
+    Slot& slot = slots_[level][(now_ >> (level * kSlotBits)) & (kSlots - 1)];
+    uint32_t node = slot.head;
+    slot.head = slot.tail = kNone;
+    while (node != kNone) {
+        const uint32_t next = nodes_[node].next;
+        --levelSizes_[level];
+        place(node);
+        node = next;
+    }
+}
+
+void TimerWheel::advance(uint64_t now, std::vector<Timer>& fired) {
+    while (now_ < now) {
+        if (size_ == 0) {
+            now_ = now;
+            break;
+        }
+        // Nothing fires before the lowest occupied level turns over, so jump to just before that
+        int lowest = 0;
+        while (levelSizes_[lowest] == 0) {
+            ++lowest;
+        }
+        if (lowest > 0) {
+            const uint64_t boundary = now_ | ((uint64_t(1) << (lowest * kSlotBits)) - 1);
+            if (boundary >= now) {
+                now_ = now;
+                break;
+            }
+            now_ = boundary;
+        }
+
+        ++now_;
+        if ((now_ & (kSlots - 1)) == 0) {
+            // Higher levels first: what they hand down may belong to a lower level's current slot
+            int top = 1;
+            while (top < kLevels - 1 && ((now_ >> (top * kSlotBits)) & (kSlots - 1)) == 0) {
+                ++top;
+            }
+            for (int level = top; level >= 1; --level) {
+                cascade(level);
+            }
+        }
+
+        Slot& slot = slots_[0][now_ & (kSlots - 1)];
+        uint32_t node = slot.head;
+        slot.head = slot.tail = kNone;
+        while (node != kNone) {
+            const uint32_t next = nodes_[node].next;
+            --levelSizes_[0];
+            if (nodes_[node].due > now_) {
+                place(node);
+            } else {
+                fired.push_back(Timer{nodes_[node].due, nodes_[node].payload});
+                nodes_[node].next = free_;
+                free_ = node;
+                --size_;
+            }
+            node = next;
+        }
+    }
+}
+
+uint64_t TimerWheel::nextWait() const {
+    if (size_ == 0) {
+        return 0;
+    }
+    if (levelSizes_[0] > 0) {
+        for (uint64_t tick = now_ + 1;; ++tick) {
+            if (slots_[0][tick & (kSlots - 1)].head != kNone) {
+                return tick - now_;
+            }
+        }
+    }
+    int lowest = 1;
+    while (levelSizes_[lowest] == 0) {
+        ++lowest;
+    }
+    const uint64_t round = uint64_t(1) << (lowest * kSlotBits);
+    return round - (now_ & (round - 1));
+}
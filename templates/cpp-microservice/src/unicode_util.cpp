@@ -0,0 +1,384 @@
+#include "unicode_util.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+struct Range {
+    uint32_t first;
+    uint32_t last;
+};
+
+template <size_t N>
+bool inRanges(const Range (&ranges)[N], uint32_t cp) {
+    const Range* it = std::upper_bound(std::begin(ranges), std::end(ranges), cp,
+                                       [](uint32_t value, const Range& r) { return value < r.first; });
+    return it != std::begin(ranges) && cp <= (it - 1)->last;
+}
+
+// Unicode P* categories outside ASCII (sorted, inclusive)
+const Range kPunctuation[] = {
+    {0x00A1, 0x00A1}, {0x00A7, 0x00A7}, {0x00AB, 0x00AB}, {0x00B6, 0x00B7}, {0x00BB, 0x00BB},
+    {0x00BF, 0x00BF}, {0x037E, 0x037E}, {0x0387, 0x0387}, {0x055A, 0x055F}, {0x0589, 0x058A},
+    {0x05BE, 0x05BE}, {0x05C0, 0x05C0}, {0x05C3, 0x05C3}, {0x05C6, 0x05C6}, {0x05F3, 0x05F4},
+    {0x0609, 0x060A}, {0x060C, 0x060D}, {0x061B, 0x061B}, {0x061E, 0x061F}, {0x066A, 0x066D},
+    {0x06D4, 0x06D4}, {0x0964, 0x0965}, {0x0970, 0x0970}, {0x0E4F, 0x0E4F}, {0x0E5A, 0x0E5B},
+    {0x2010, 0x2027}, {0x2030, 0x2043}, {0x2045, 0x2051}, {0x2053, 0x205E}, {0x207D, 0x207E},
+    {0x208D, 0x208E}, {0x2308, 0x230B}, {0x2329, 0x232A}, {0x2768, 0x2775}, {0x27C5, 0x27C6},
+    {0x27E6, 0x27EF}, {0x2983, 0x2998}, {0x29D8, 0x29DB}, {0x29FC, 0x29FD}, {0x2E00, 0x2E2E},
+    {0x2E30, 0x2E4F}, {0x3001, 0x3003}, {0x3008, 0x3011}, {0x3014, 0x301F}, {0x3030, 0x3030},
+    {0x303D, 0x303D}, {0x30A0, 0x30A0}, {0x30FB, 0x30FB}, {0xFD3E, 0xFD3F}, {0xFE10, 0xFE19},
+    {0xFE30, 0xFE52}, {0xFE54, 0xFE61}, {0xFE63, 0xFE63}, {0xFE68, 0xFE68}, {0xFE6A, 0xFE6B},
+    {0xFF01, 0xFF03}, {0xFF05, 0xFF0A}, {0xFF0C, 0xFF0F}, {0xFF1A, 0xFF1B}, {0xFF1F, 0xFF20},
+    {0xFF3B, 0xFF3D}, {0xFF3F, 0xFF3F}, {0xFF5B, 0xFF5B}, {0xFF5D, 0xFF5D}, {0xFF5F, 0xFF65},
+};
+
+// Cc and Cf, minus \t \n \r
+const Range kControl[] = {
+    {0x0000, 0x0008}, {0x000B, 0x000C}, {0x000E, 0x001F}, {0x007F, 0x009F}, {0x00AD, 0x00AD},
+    {0x0600, 0x0605}, {0x061C, 0x061C}, {0x06DD, 0x06DD}, {0x070F, 0x070F}, {0x180E, 0x180E},
+    {0x200B, 0x200F}, {0x202A, 0x202E}, {0x2060, 0x2064}, {0x2066, 0x206F}, {0xFEFF, 0xFEFF},
+    {0xFFF9, 0xFFFB},
+};
+
+const Range kWhitespace[] = {
+    {0x0009, 0x000A}, {0x000D, 0x000D}, {0x0020, 0x0020}, {0x00A0, 0x00A0}, {0x1680, 0x1680},
+    {0x2000, 0x200A}, {0x202F, 0x202F}, {0x205F, 0x205F}, {0x3000, 0x3000},
+};
+
+// Python's str.isalnum() outside ASCII (Unicode 14, unassigned code points merged into ranges)
+const Range kAlnum[] = {
+    {0x00AA, 0x00AA}, {0x00B2, 0x00B3}, {0x00B5, 0x00B5}, {0x00B9, 0x00BA}, {0x00BC, 0x00BE},
+    {0x00C0, 0x00D6}, {0x00D8, 0x00F6}, {0x00F8, 0x02C1}, {0x02C6, 0x02D1}, {0x02E0, 0x02E4},
+    {0x02EC, 0x02EC}, {0x02EE, 0x02EE}, {0x0370, 0x0374}, {0x0376, 0x037D}, {0x037F, 0x037F},
+    {0x0386, 0x0386}, {0x0388, 0x03F5}, {0x03F7, 0x0481}, {0x048A, 0x0559}, {0x0560, 0x0588},
+    {0x05D0, 0x05F2}, {0x0620, 0x064A}, {0x0660, 0x0669}, {0x066E, 0x066F}, {0x0671, 0x06D3},
+    {0x06D5, 0x06D5}, {0x06E5, 0x06E6}, {0x06EE, 0x06FC}, {0x06FF, 0x06FF}, {0x0710, 0x0710},
+    {0x0712, 0x072F}, {0x074D, 0x07A5}, {0x07B1, 0x07EA}, {0x07F4, 0x07F5}, {0x07FA, 0x07FA},
+    {0x0800, 0x0815}, {0x081A, 0x081A}, {0x0824, 0x0824}, {0x0828, 0x0828}, {0x0840, 0x0858},
+    {0x0860, 0x0887}, {0x0889, 0x088E}, {0x08A0, 0x08C9}, {0x0904, 0x0939}, {0x093D, 0x093D},
+    {0x0950, 0x0950}, {0x0958, 0x0961}, {0x0966, 0x096F}, {0x0971, 0x0980}, {0x0985, 0x09B9},
+    {0x09BD, 0x09BD}, {0x09CE, 0x09CE}, {0x09DC, 0x09E1}, {0x09E6, 0x09F1}, {0x09F4, 0x09F9},
+    {0x09FC, 0x09FC}, {0x0A05, 0x0A39}, {0x0A59, 0x0A6F}, {0x0A72, 0x0A74}, {0x0A85, 0x0AB9},
+    {0x0ABD, 0x0ABD}, {0x0AD0, 0x0AE1}, {0x0AE6, 0x0AEF}, {0x0AF9, 0x0AF9}, {0x0B05, 0x0B39},
+    {0x0B3D, 0x0B3D}, {0x0B5C, 0x0B61}, {0x0B66, 0x0B6F}, {0x0B71, 0x0B77}, {0x0B83, 0x0BB9},
+    {0x0BD0, 0x0BD0}, {0x0BE6, 0x0BF2}, {0x0C05, 0x0C39}, {0x0C3D, 0x0C3D}, {0x0C58, 0x0C61},
+    {0x0C66, 0x0C6F}, {0x0C78, 0x0C7E}, {0x0C80, 0x0C80}, {0x0C85, 0x0CB9}, {0x0CBD, 0x0CBD},
+    {0x0CDD, 0x0CE1}, {0x0CE6, 0x0CF2}, {0x0D04, 0x0D3A}, {0x0D3D, 0x0D3D}, {0x0D4E, 0x0D4E},
+    {0x0D54, 0x0D56}, {0x0D58, 0x0D61}, {0x0D66, 0x0D78}, {0x0D7A, 0x0D7F}, {0x0D85, 0x0DC6},
+    {0x0DE6, 0x0DEF}, {0x0E01, 0x0E30}, {0x0E32, 0x0E33}, {0x0E40, 0x0E46}, {0x0E50, 0x0E59},
+    {0x0E81, 0x0EB0}, {0x0EB2, 0x0EB3}, {0x0EBD, 0x0EC6}, {0x0ED0, 0x0F00}, {0x0F20, 0x0F33},
+    {0x0F40, 0x0F6C}, {0x0F88, 0x0F8C}, {0x1000, 0x102A}, {0x103F, 0x1049}, {0x1050, 0x1055},
+    {0x105A, 0x105D}, {0x1061, 0x1061}, {0x1065, 0x1066}, {0x106E, 0x1070}, {0x1075, 0x1081},
+    {0x108E, 0x108E}, {0x1090, 0x1099}, {0x10A0, 0x10FA}, {0x10FC, 0x135A}, {0x1369, 0x138F},
+    {0x13A0, 0x13FD}, {0x1401, 0x166C}, {0x166F, 0x167F}, {0x1681, 0x169A}, {0x16A0, 0x16EA},
+    {0x16EE, 0x1711}, {0x171F, 0x1731}, {0x1740, 0x1751}, {0x1760, 0x1770}, {0x1780, 0x17B3},
+    {0x17D7, 0x17D7}, {0x17DC, 0x17DC}, {0x17E0, 0x17F9}, {0x1810, 0x1884}, {0x1887, 0x18A8},
+    {0x18AA, 0x191E}, {0x1946, 0x19DA}, {0x1A00, 0x1A16}, {0x1A20, 0x1A54}, {0x1A80, 0x1A99},
+    {0x1AA7, 0x1AA7}, {0x1B05, 0x1B33}, {0x1B45, 0x1B59}, {0x1B83, 0x1BA0}, {0x1BAE, 0x1BE5},
+    {0x1C00, 0x1C23}, {0x1C40, 0x1C7D}, {0x1C80, 0x1CBF}, {0x1CE9, 0x1CEC}, {0x1CEE, 0x1CF3},
+    {0x1CF5, 0x1CF6}, {0x1CFA, 0x1DBF}, {0x1E00, 0x1FBC}, {0x1FBE, 0x1FBE}, {0x1FC2, 0x1FCC},
+    {0x1FD0, 0x1FDB}, {0x1FE0, 0x1FEC}, {0x1FF2, 0x1FFC}, {0x2070, 0x2079}, {0x207F, 0x2089},
+    {0x2090, 0x209C}, {0x2102, 0x2102}, {0x2107, 0x2107}, {0x210A, 0x2113}, {0x2115, 0x2115},
+    {0x2119, 0x211D}, {0x2124, 0x2124}, {0x2126, 0x2126}, {0x2128, 0x2128}, {0x212A, 0x212D},
+    {0x212F, 0x2139}, {0x213C, 0x213F}, {0x2145, 0x2149}, {0x214E, 0x214E}, {0x2150, 0x2189},
+    {0x2460, 0x249B}, {0x24EA, 0x24FF}, {0x2776, 0x2793}, {0x2C00, 0x2CE4}, {0x2CEB, 0x2CEE},
+    {0x2CF2, 0x2CF3}, {0x2CFD, 0x2CFD}, {0x2D00, 0x2D6F}, {0x2D80, 0x2DDE}, {0x2E2F, 0x2E2F},
+    {0x3005, 0x3007}, {0x3021, 0x3029}, {0x3031, 0x3035}, {0x3038, 0x303C}, {0x3041, 0x3096},
+    {0x309D, 0x309F}, {0x30A1, 0x30FA}, {0x30FC, 0x318E}, {0x3192, 0x3195}, {0x31A0, 0x31BF},
+    {0x31F0, 0x31FF}, {0x3220, 0x3229}, {0x3248, 0x324F}, {0x3251, 0x325F}, {0x3280, 0x3289},
+    {0x32B1, 0x32BF}, {0x3400, 0x4DBF}, {0x4E00, 0xA48C}, {0xA4D0, 0xA4FD}, {0xA500, 0xA60C},
+    {0xA610, 0xA66E}, {0xA67F, 0xA69D}, {0xA6A0, 0xA6EF}, {0xA717, 0xA71F}, {0xA722, 0xA788},
+    {0xA78B, 0xA801}, {0xA803, 0xA805}, {0xA807, 0xA80A}, {0xA80C, 0xA822}, {0xA830, 0xA835},
+    {0xA840, 0xA873}, {0xA882, 0xA8B3}, {0xA8D0, 0xA8D9}, {0xA8F2, 0xA8F7}, {0xA8FB, 0xA8FB},
+    {0xA8FD, 0xA8FE}, {0xA900, 0xA925}, {0xA930, 0xA946}, {0xA960, 0xA97C}, {0xA984, 0xA9B2},
+    {0xA9CF, 0xA9D9}, {0xA9E0, 0xA9E4}, {0xA9E6, 0xAA28}, {0xAA40, 0xAA42}, {0xAA44, 0xAA4B},
+    {0xAA50, 0xAA59}, {0xAA60, 0xAA76}, {0xAA7A, 0xAA7A}, {0xAA7E, 0xAAAF}, {0xAAB1, 0xAAB1},
+    {0xAAB5, 0xAAB6}, {0xAAB9, 0xAABD}, {0xAAC0, 0xAAC0}, {0xAAC2, 0xAADD}, {0xAAE0, 0xAAEA},
+    {0xAAF2, 0xAAF4}, {0xAB01, 0xAB5A}, {0xAB5C, 0xAB69}, {0xAB70, 0xABE2}, {0xABF0, 0xD7FB},
+    {0xF900, 0xFB1D}, {0xFB1F, 0xFB28}, {0xFB2A, 0xFBB1}, {0xFBD3, 0xFD3D}, {0xFD50, 0xFDC7},
+    {0xFDF0, 0xFDFB}, {0xFE70, 0xFEFC}, {0xFF10, 0xFF19}, {0xFF21, 0xFF3A}, {0xFF41, 0xFF5A},
+    {0xFF66, 0xFFDC}, {0x10000, 0x100FA}, {0x10107, 0x10133}, {0x10140, 0x10178}, {0x1018A, 0x1018B},
+    {0x10280, 0x102D0}, {0x102E1, 0x10375}, {0x10380, 0x1039D}, {0x103A0, 0x103CF}, {0x103D1, 0x10563},
+    {0x10570, 0x10855}, {0x10858, 0x10876}, {0x10879, 0x1091B}, {0x10920, 0x10939}, {0x10980, 0x10A00},
+    {0x10A10, 0x10A35}, {0x10A40, 0x10A48}, {0x10A60, 0x10A7E}, {0x10A80, 0x10AC7}, {0x10AC9, 0x10AE4},
+    {0x10AEB, 0x10AEF}, {0x10B00, 0x10B35}, {0x10B40, 0x10B91}, {0x10BA9, 0x10D23}, {0x10D30, 0x10EA9},
+    {0x10EB0, 0x10F45}, {0x10F51, 0x10F54}, {0x10F70, 0x10F81}, {0x10FB0, 0x10FF6}, {0x11003, 0x11037},
+    {0x11052, 0x1106F}, {0x11071, 0x11072}, {0x11075, 0x11075}, {0x11083, 0x110AF}, {0x110D0, 0x110F9},
+    {0x11103, 0x11126}, {0x11136, 0x1113F}, {0x11144, 0x11144}, {0x11147, 0x11172}, {0x11176, 0x11176},
+    {0x11183, 0x111B2}, {0x111C1, 0x111C4}, {0x111D0, 0x111DA}, {0x111DC, 0x111DC}, {0x111E1, 0x1122B},
+    {0x11280, 0x112A8}, {0x112B0, 0x112DE}, {0x112F0, 0x112F9}, {0x11305, 0x11339}, {0x1133D, 0x1133D},
+    {0x11350, 0x11350}, {0x1135D, 0x11361}, {0x11400, 0x11434}, {0x11447, 0x1144A}, {0x11450, 0x11459},
+    {0x1145F, 0x114AF}, {0x114C4, 0x114C5}, {0x114C7, 0x115AE}, {0x115D8, 0x115DB}, {0x11600, 0x1162F},
+    {0x11644, 0x11659}, {0x11680, 0x116AA}, {0x116B8, 0x116B8}, {0x116C0, 0x1171A}, {0x11730, 0x1173B},
+    {0x11740, 0x1182B}, {0x118A0, 0x1192F}, {0x1193F, 0x1193F}, {0x11941, 0x11941}, {0x11950, 0x119D0},
+    {0x119E1, 0x119E1}, {0x119E3, 0x119E3}, {0x11A00, 0x11A00}, {0x11A0B, 0x11A32}, {0x11A3A, 0x11A3A},
+    {0x11A50, 0x11A50}, {0x11A5C, 0x11A89}, {0x11A9D, 0x11A9D}, {0x11AB0, 0x11C2E}, {0x11C40, 0x11C40},
+    {0x11C50, 0x11C6C}, {0x11C72, 0x11C8F}, {0x11D00, 0x11D30}, {0x11D46, 0x11D46}, {0x11D50, 0x11D89},
+    {0x11D98, 0x11EF2}, {0x11FB0, 0x11FD4}, {0x12000, 0x1246E}, {0x12480, 0x12FF0}, {0x13000, 0x1342E},
+    {0x14400, 0x16A69}, {0x16A70, 0x16AED}, {0x16B00, 0x16B2F}, {0x16B40, 0x16B43}, {0x16B50, 0x16E96},
+    {0x16F00, 0x16F4A}, {0x16F50, 0x16F50}, {0x16F93, 0x16FE1}, {0x16FE3, 0x16FE3}, {0x17000, 0x1BC99},
+    {0x1D2E0, 0x1D2F3}, {0x1D360, 0x1D6C0}, {0x1D6C2, 0x1D6DA}, {0x1D6DC, 0x1D6FA}, {0x1D6FC, 0x1D714},
+    {0x1D716, 0x1D734}, {0x1D736, 0x1D74E}, {0x1D750, 0x1D76E}, {0x1D770, 0x1D788}, {0x1D78A, 0x1D7A8},
+    {0x1D7AA, 0x1D7C2}, {0x1D7C4, 0x1D7FF}, {0x1DF00, 0x1DF1E}, {0x1E100, 0x1E12C}, {0x1E137, 0x1E14E},
+    {0x1E290, 0x1E2AD}, {0x1E2C0, 0x1E2EB}, {0x1E2F0, 0x1E2F9}, {0x1E7E0, 0x1E8CF}, {0x1E900, 0x1E943},
+    {0x1E94B, 0x1E959}, {0x1EC71, 0x1ECAB}, {0x1ECAD, 0x1ECAF}, {0x1ECB1, 0x1ED2D}, {0x1ED2F, 0x1EEBB},
+    {0x1F100, 0x1F10C}, {0x1FBF0, 0x3134A},
+};
+
+// First code point of each run of ten Nd digits outside ASCII
+const uint32_t kDecimalZeros[] = {
+    0x0660, 0x06F0, 0x07C0, 0x0966, 0x09E6, 0x0A66, 0x0AE6, 0x0B66,
+    0x0BE6, 0x0C66, 0x0CE6, 0x0D66, 0x0DE6, 0x0E50, 0x0ED0, 0x0F20,
+    0x1040, 0x1090, 0x17E0, 0x1810, 0x1946, 0x19D0, 0x1A80, 0x1A90,
+    0x1B50, 0x1BB0, 0x1C40, 0x1C50, 0xA620, 0xA8D0, 0xA900, 0xA9D0,
+    0xA9F0, 0xAA50, 0xABF0, 0xFF10, 0x104A0, 0x10D30, 0x11066, 0x110F0,
+    0x11136, 0x111D0, 0x112F0, 0x11450, 0x114D0, 0x11650, 0x116C0, 0x11730,
+    0x118E0, 0x11950, 0x11C50, 0x11D50, 0x11DA0, 0x16A60, 0x16AC0, 0x16B50,
+    0x1D7CE, 0x1D7D8, 0x1D7E2, 0x1D7EC, 0x1D7F6, 0x1E140, 0x1E2F0, 0x1E950,
+    0x1FBF0,
+};
+
+const Range kCjk[] = {
+    {0x3400, 0x4DBF}, {0x4E00, 0x9FFF}, {0xF900, 0xFAFF}, {0x20000, 0x2A6DF}, {0x2A700, 0x2CEAF},
+    {0x2F800, 0x2FA1F},
+};
+
+const Range kCombining[] = {
+    {0x0300, 0x036F}, {0x0483, 0x0487}, {0x0591, 0x05BD}, {0x05BF, 0x05BF}, {0x05C1, 0x05C2},
+    {0x05C4, 0x05C5}, {0x05C7, 0x05C7}, {0x0610, 0x061A}, {0x064B, 0x065F}, {0x0670, 0x0670},
+    {0x06D6, 0x06DC}, {0x06DF, 0x06E4}, {0x06E7, 0x06E8}, {0x06EA, 0x06ED}, {0x0E31, 0x0E31},
+    {0x0E34, 0x0E3A}, {0x0E47, 0x0E4E}, {0x1AB0, 0x1ABD}, {0x1DC0, 0x1DFF}, {0x20D0, 0x20DC},
+    {0x20E1, 0x20E1}, {0x20E5, 0x20F0}, {0x302A, 0x302D}, {0x3099, 0x309A}, {0xFE20, 0xFE2F},
+};
+
+// Base letters of U+00C0..U+017F under NFD; '.' where the letter does not decompose
+const char kLatinBase[] =
+    "AAAAAA.CEEEEIIII"
+    ".NOOOOO..UUUUY.."
+    "aaaaaa.ceeeeiiii"
+    ".nooooo..uuuuy.y"
+    "AaAaAaCcCcCcCcDd"
+    "..EeEeEeEeEeGgGg"
+    "GgGgHh..IiIiIiIi"
+    "I...JjKk.LlLlLl."
+    "...NnNnNn...OoOo"
+    "Oo..RrRrRrSsSsSs"
+    "SsTtTt..UuUuUuUu"
+    "UuUuWwYyYZzZzZz.";
+
+} // namespace
+
+uint32_t decodeUtf8(const char*& p, const char* end) {
+    const unsigned char* s = reinterpret_cast<const unsigned char*>(p);
+    const unsigned char lead = s[0];
+    if (lead < 0x80) {
+        ++p;
+        return lead;
+    }
+
+    size_t length;
+    uint32_t cp;
+    uint32_t minimum;
+    if ((lead & 0xE0) == 0xC0) {
+        length = 2;
+        cp = lead & 0x1F;
+        minimum = 0x80;
+    } else if ((lead & 0xF0) == 0xE0) {
+        length = 3;
+        cp = lead & 0x0F;
+        minimum = 0x800;
+    } else if ((lead & 0xF8) == 0xF0) {
+        length = 4;
+        cp = lead & 0x07;
+        minimum = 0x10000;
+    } else {
+        ++p;
+        return 0xFFFD;
+    }
+    if (static_cast<size_t>(end - p) < length) {
+        ++p;
+        return 0xFFFD;
+    }
+    for (size_t i = 1; i < length; ++i) {
+        if ((s[i] & 0xC0) != 0x80) {
+            ++p;
+            return 0xFFFD;
+        }
+        cp = (cp << 6) | (s[i] & 0x3F);
+    }
+    if (cp < minimum || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+        ++p;
+        return 0xFFFD;
+    }
+    p += length;
+    return cp;
+}
+
+size_t encodeUtf8(uint32_t cp, char* out) {
+    if (cp < 0x80) {
+        out[0] = static_cast<char>(cp);
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = static_cast<char>(0xC0 | (cp >> 6));
+        out[1] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = static_cast<char>(0xE0 | (cp >> 12));
+        out[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = static_cast<char>(0xF0 | (cp >> 18));
+    out[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = static_cast<char>(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+void appendUtf8(uint32_t cp, std::string& out) {
+    char bytes[4];
+    out.append(bytes, encodeUtf8(cp, bytes));
+}
+
+bool isUnicodeWhitespace(uint32_t cp) {
+    return inRanges(kWhitespace, cp);
+}
+
+bool isPythonWhitespace(uint32_t cp) {
+    if (cp < 0x80) {
+        return (cp >= 0x09 && cp <= 0x0D) || (cp >= 0x1C && cp <= 0x20);
+    }
+    return cp == 0x85 || cp == 0xA0 || cp == 0x1680 || (cp >= 0x2000 && cp <= 0x200A) || cp == 0x2028 ||
+           cp == 0x2029 || cp == 0x202F || cp == 0x205F || cp == 0x3000;
+}
+
+bool isUnicodeAlnum(uint32_t cp) {
+    if (cp < 0x80) {
+        return (cp >= '0' && cp <= '9') || ((cp | 0x20) >= 'a' && (cp | 0x20) <= 'z');
+    }
+    return inRanges(kAlnum, cp);
+}
+
+bool isUnicodeDecimal(uint32_t cp) {
+    if (cp < 0x80) {
+        return cp >= '0' && cp <= '9';
+    }
+    const uint32_t* it = std::upper_bound(std::begin(kDecimalZeros), std::end(kDecimalZeros), cp);
+    return it != std::begin(kDecimalZeros) && cp - *(it - 1) < 10;
+}
+
+bool isUnicodeControl(uint32_t cp) {
+    return inRanges(kControl, cp);
+}
+
+bool isUnicodePunctuation(uint32_t cp) {
+    if (cp < 0x80) {
+        return (cp >= 33 && cp <= 47) || (cp >= 58 && cp <= 64) || (cp >= 91 && cp <= 96) ||
+               (cp >= 123 && cp <= 126);
+    }
+    return inRanges(kPunctuation, cp);
+}
+
+bool isCjkIdeograph(uint32_t cp) {
+    return inRanges(kCjk, cp);
+}
+
+bool isCombiningMark(uint32_t cp) {
+    return inRanges(kCombining, cp);
+}
+
+uint32_t toLowerCodePoint(uint32_t cp) {
+    if (cp < 0x80) {
+        return cp >= 'A' && cp <= 'Z' ? cp + 32 : cp;
+    }
+    if (cp >= 0xC0 && cp <= 0xDE && cp != 0xD7) {
+        return cp + 32;
+    }
+    if (cp >= 0x100 && cp <= 0x17F) {
+        if (cp == 0x130) {
+            return 'i';    // Python lower() gives i + combining dot, which accent stripping removes
+        }
+        if (cp == 0x178) {
+            return 0xFF;
+        }
+        const bool evenUpper = (cp <= 0x137) || (cp >= 0x14A && cp <= 0x177);
+        const bool oddUpper = (cp >= 0x139 && cp <= 0x148) || (cp >= 0x179 && cp <= 0x17E);
+        if ((evenUpper && cp % 2 == 0) || (oddUpper && cp % 2 == 1)) {
+            return cp + 1;
+        }
+        return cp;
+    }
+    if (cp >= 0x391 && cp <= 0x3A9 && cp != 0x3A2) {
+        return cp + 32;
+    }
+    switch (cp) {
+    case 0x386: return 0x3AC;
+    case 0x388: return 0x3AD;
+    case 0x389: return 0x3AE;
+    case 0x38A: return 0x3AF;
+    case 0x38C: return 0x3CC;
+    case 0x38E: return 0x3CD;
+    case 0x38F: return 0x3CE;
+    case 0x3AA: return 0x3CA;
+    case 0x3AB: return 0x3CB;
+    default: break;
+    }
+    if (cp >= 0x410 && cp <= 0x42F) {
+        return cp + 32;
+    }
+    if (cp >= 0x400 && cp <= 0x40F) {
+        return cp + 80;
+    }
+    return cp;
+}
+
+uint32_t stripAccent(uint32_t cp) {
+    if (cp >= 0xC0 && cp <= 0x17F) {
+        char base = kLatinBase[cp - 0xC0];
+        return base == '.' ? cp : static_cast<uint32_t>(base);
+    }
+    switch (cp) {
+    // Greek tonos and dialytika
+    case 0x386: return 0x391;
+    case 0x388: return 0x395;
+    case 0x389: return 0x397;
+    case 0x38A: return 0x399;
+    case 0x38C: return 0x39F;
+    case 0x38E: return 0x3A5;
+    case 0x38F: return 0x3A9;
+    case 0x390: return 0x3B9;
+    case 0x3AA: return 0x399;
+    case 0x3AB: return 0x3A5;
+    case 0x3AC: return 0x3B1;
+    case 0x3AD: return 0x3B5;
+    case 0x3AE: return 0x3B7;
+    case 0x3AF: return 0x3B9;
+    case 0x3B0: return 0x3C5;
+    case 0x3CA: return 0x3B9;
+    case 0x3CB: return 0x3C5;
+    case 0x3CC: return 0x3BF;
+    case 0x3CD: return 0x3C5;
+    case 0x3CE: return 0x3C9;
+    // Cyrillic letters with breve, diaeresis or acute
+    case 0x400: return 0x415;
+    case 0x401: return 0x415;
+    case 0x403: return 0x413;
+    case 0x407: return 0x406;
+    case 0x40C: return 0x41A;
+    case 0x40D: return 0x418;
+    case 0x40E: return 0x423;
+    case 0x419: return 0x418;
+    case 0x439: return 0x438;
+    case 0x450: return 0x435;
+    case 0x451: return 0x435;
+    case 0x453: return 0x433;
+    case 0x457: return 0x456;
+    case 0x45C: return 0x43A;
+    case 0x45D: return 0x438;
+    case 0x45E: return 0x443;
+    default: return cp;
+    }
+}
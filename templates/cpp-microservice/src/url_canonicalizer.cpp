@@ -0,0 +1,432 @@
+#include "url_canonicalizer.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+enum CharClass : uint8_t {
+    kUnreserved = 1,    // ALPHA DIGIT - . _ ~
+    kPathSafe = 2,      // Left as is in a path
+    kQuerySafe = 4,     // Left as is in a query
+    kUserSafe = 8,      // Left as is in userinfo
+    kHostInvalid = 16,  // Rejected in a host
+};
+
+struct CharClasses {
+    uint8_t values[256];
+
+    CharClasses() {
+        std::memset(values, 0, sizeof(values));
+        for (int c = 0; c < 256; ++c) {
+            if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' ||
+                c == '.' || c == '_' || c == '~') {
+                values[c] = kUnreserved | kPathSafe | kQuerySafe | kUserSafe;
+            }
+        }
+        for (const char* p = "!$&'()*+,;=:"; *p; ++p) {
+            values[static_cast<unsigned char>(*p)] |= kPathSafe | kQuerySafe | kUserSafe;
+        }
+        values[static_cast<unsigned char>('@')] |= kPathSafe | kQuerySafe;
+        values[static_cast<unsigned char>('/')] |= kPathSafe | kQuerySafe;
+        values[static_cast<unsigned char>('?')] |= kQuerySafe;
+        for (int c = 0; c <= ' '; ++c) {
+            values[c] |= kHostInvalid;
+        }
+        for (const char* p = "<>\"`{}|^\\"; *p; ++p) {
+            values[static_cast<unsigned char>(*p)] |= kHostInvalid;
+        }
+    }
+
+    uint8_t operator[](unsigned char c) const { return values[c]; }
+};
+const CharClasses kClasses;
+
+const char kHex[] = "0123456789ABCDEF";
+
+inline int hexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c = static_cast<char>(c | 0x20);
+    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+inline char asciiLower(char c) {
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c + 32) : c;
+}
+
+inline bool isRemoved(char c) {
+    // Tabs and newlines inside a URL are dropped, as browsers do
+    return c == '\t' || c == '\n' || c == '\r';
+}
+
+bool equalsNoCase(std::string_view a, std::string_view b) {
+    return a.size() == b.size() &&
+           std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) { return asciiLower(x) == asciiLower(y); });
+}
+
+// Bounded output buffer; overflowing marks it failed
+struct Writer {
+    char* out;
+    size_t capacity;
+    size_t size;
+
+    bool ok() const { return size <= capacity; }
+
+    void put(char c) {
+        if (size < capacity) {
+            out[size] = c;
+        }
+        ++size;
+    }
+
+    void append(std::string_view text) {
+        if (size + text.size() <= capacity) {
+            std::memcpy(out + size, text.data(), text.size());
+        }
+        size += text.size();
+    }
+
+    void escape(unsigned char c) {
+        put('%');
+        put(kHex[c >> 4]);
+        put(kHex[c & 15]);
+    }
+};
+
+// Writes text with escapes normalized: unreserved bytes decoded, others
+// escaped with upper-case hex, bytes outside @p safe escaped
+void writeEscaped(std::string_view text, uint8_t safe, Writer& w) {
+    // Worst case every byte becomes an escape; otherwise go through the checked writer
+    if (w.size + 3 * text.size() > w.capacity) {
+        for (size_t i = 0; i < text.size(); ++i) {
+            const unsigned char c = static_cast<unsigned char>(text[i]);
+            if (c == '%') {
+                const int high = i + 2 < text.size() ? hexValue(text[i + 1]) : -1;
+                const int low = high >= 0 ? hexValue(text[i + 2]) : -1;
+                if (low < 0) {
+                    w.append("%25");
+                    continue;
+                }
+                const unsigned char decoded = static_cast<unsigned char>(high * 16 + low);
+                if (kClasses[decoded] & kUnreserved) {
+                    w.put(static_cast<char>(decoded));
+                } else {
+                    w.escape(decoded);
+                }
+                i += 2;
+            } else if (kClasses[c] & safe) {
+                w.put(static_cast<char>(c));
+            } else if (!isRemoved(static_cast<char>(c))) {
+                w.escape(c);
+            }
+        }
+        return;
+    }
+    // Local copies, since stores through char* would force the writer to be reloaded
+    char* out = w.out + w.size;
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (kClasses[c] & safe) {
+            *out++ = static_cast<char>(c);
+            continue;
+        }
+        if (c == '%') {
+            const int high = i + 2 < text.size() ? hexValue(text[i + 1]) : -1;
+            const int low = high >= 0 ? hexValue(text[i + 2]) : -1;
+            if (low < 0) {
+                *out++ = '%';
+                *out++ = '2';
+                *out++ = '5';
+                continue;
+            }
+            c = static_cast<unsigned char>(high * 16 + low);
+            i += 2;
+            if (kClasses[c] & kUnreserved) {
+                *out++ = static_cast<char>(c);
+                continue;
+            }
+        } else if (isRemoved(static_cast<char>(c))) {
+            continue;
+        }
+        *out++ = '%';
+        *out++ = kHex[c >> 4];
+        *out++ = kHex[c & 15];
+    }
+    w.size = out - w.out;
+}
+
+unsigned defaultPort(std::string_view scheme) {
+    if (scheme == "http" || scheme == "ws") {
+        return 80;
+    }
+    if (scheme == "https" || scheme == "wss") {
+        return 443;
+    }
+    return scheme == "ftp" ? 21 : 0;
+}
+
+// Writes the path with escapes normalized and dot segments resolved
+void writePath(std::string_view path, bool special, bool removeTrailingSlash, Writer& w) {
+    const size_t root = w.size;
+    w.put('/');
+    size_t i = !path.empty() && (path[0] == '/' || (special && path[0] == '\\')) ? 1 : 0;
+    while (true) {
+        size_t end = i;
+        while (end < path.size() && path[end] != '/' && !(special && path[end] == '\\')) {
+            ++end;
+        }
+        const size_t segment = w.size;
+        writeEscaped(path.substr(i, end - i), kPathSafe, w);
+        if (!w.ok()) {
+            return;
+        }
+        const std::string_view written(w.out + segment, w.size - segment);
+        const bool last = end >= path.size();
+        if (written == ".") {
+            w.size = segment;
+        } else if (written == "..") {
+            // Back to the start of the previous segment, never above the root
+            w.size = segment > root + 1 ? segment - 1 : segment;
+            while (w.size > root + 1 && w.out[w.size - 1] != '/') {
+                --w.size;
+            }
+        } else if (!last) {
+            w.put('/');
+        }
+        if (last) {
+            break;
+        }
+        i = end + 1;
+    }
+    if (removeTrailingSlash && w.size > root + 1 && w.out[w.size - 1] == '/') {
+        --w.size;
+    }
+}
+
+struct Param {
+    uint32_t offset;
+    uint32_t size;
+    uint32_t nameSize;
+};
+
+} // namespace
+
+UrlCanonicalizer::UrlCanonicalizer(const UrlCanonicalizerOptions& options) : options_(options) {}
+
+bool UrlCanonicalizer::isTracking(std::string_view name) const {
+    for (const std::string& prefix : options_.trackingPrefixes) {
+        if (name.size() >= prefix.size() && equalsNoCase(name.substr(0, prefix.size()), prefix)) {
+            return true;
+        }
+    }
+    for (const std::string& param : options_.trackingParams) {
+        if (equalsNoCase(name, param)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t UrlCanonicalizer::canonicalize(std::string_view url, char* out, size_t capacity) const {
+    capacity = std::min(capacity, kMaxUrlBytes);
+    while (!url.empty() && static_cast<unsigned char>(url.front()) <= ' ') {
+        url.remove_prefix(1);
+    }
+    while (!url.empty() && static_cast<unsigned char>(url.back()) <= ' ') {
+        url.remove_suffix(1);
+    }
+
+    // scheme ":" "//"
+    size_t i = 0;
+    if (url.empty() || asciiLower(url[0]) < 'a' || asciiLower(url[0]) > 'z') {
+        return 0;
+    }
+    while (i < url.size() && ((kClasses[static_cast<unsigned char>(url[i])] & kUnreserved) || url[i] == '+') &&
+           url[i] != '_' && url[i] != '~') {
+        ++i;
+    }
+    if (i + 2 >= url.size() || url[i] != ':') {
+        return 0;
+    }
+    Writer w = {out, capacity, 0};
+    for (size_t j = 0; j < i; ++j) {
+        w.put(asciiLower(url[j]));
+    }
+    const std::string_view scheme(out, std::min(i, capacity));
+    const unsigned port = defaultPort(scheme);
+    const bool special = port != 0;
+    ++i;
+    const auto isSlash = [&](char c) { return c == '/' || (special && c == '\\'); };
+    if (!isSlash(url[i]) || !isSlash(url[i + 1])) {
+        return 0;
+    }
+    i += 2;
+    w.append("://");
+
+    // authority: [userinfo "@"] host [":" port]
+    size_t end = i;
+    while (end < url.size() && !isSlash(url[end]) && url[end] != '?' && url[end] != '#') {
+        ++end;
+    }
+    std::string_view authority = url.substr(i, end - i);
+    const size_t at = authority.rfind('@');
+    if (at != std::string_view::npos) {
+        writeEscaped(authority.substr(0, at), kUserSafe, w);
+        w.put('@');
+        authority.remove_prefix(at + 1);
+    }
+    std::string_view host = authority;
+    std::string_view portText;
+    const size_t bracket = authority.rfind(']');
+    const size_t colon = authority.rfind(':');
+    if (colon != std::string_view::npos && (bracket == std::string_view::npos || colon > bracket)) {
+        host = authority.substr(0, colon);
+        portText = authority.substr(colon + 1);
+    }
+    while (!host.empty() && host.back() == '.') {
+        host.remove_suffix(1);
+    }
+    if (host.empty()) {
+        return 0;
+    }
+    for (char c : host) {
+        if (isRemoved(c)) {
+            continue;
+        }
+        if (kClasses[static_cast<unsigned char>(c)] & kHostInvalid) {
+            return 0;
+        }
+        w.put(asciiLower(c));
+    }
+    unsigned long portValue = 0;
+    for (char c : portText) {
+        if (c < '0' || c > '9') {
+            return 0;
+        }
+        portValue = portValue * 10 + (c - '0');
+        if (portValue > 65535) {
+            return 0;
+        }
+    }
+    if (!portText.empty() && portValue != port) {
+        char digits[8];
+        size_t n = 0;
+        do {
+            digits[n++] = static_cast<char>('0' + portValue % 10);
+            portValue /= 10;
+        } while (portValue > 0);
+        w.put(':');
+        while (n > 0) {
+            w.put(digits[--n]);
+        }
+    }
+
+    // path, query, fragment
+    size_t queryStart = url.find('?', end);
+    const size_t hash = url.find('#', end);
+    if (queryStart > hash) {
+        queryStart = std::string_view::npos;
+    }
+    const size_t pathEnd = std::min(std::min(queryStart, hash), url.size());
+    writePath(url.substr(end, pathEnd - end), special, options_.removeTrailingSlash, w);
+
+    if (queryStart != std::string_view::npos) {
+        const std::string_view query = url.substr(queryStart + 1, std::min(hash, url.size()) - queryStart - 1);
+        // Normalized parameters are staged past the output, then copied back in order
+        const size_t queryOffset = w.size + 1;
+        Param params[kMaxQueryParams];
+        size_t count = 0;
+        Writer stage = {out, capacity, queryOffset};
+        size_t start = 0;
+        while (start <= query.size()) {
+            size_t stop = query.find('&', start);
+            if (stop == std::string_view::npos) {
+                stop = query.size();
+            }
+            const std::string_view raw = query.substr(start, stop - start);
+            start = stop + 1;
+            const size_t offset = stage.size;
+            size_t equals = raw.find('=');
+            writeEscaped(raw.substr(0, equals), kQuerySafe, stage);
+            const size_t nameSize = stage.size - offset;
+            if (equals != std::string_view::npos) {
+                stage.put('=');
+                writeEscaped(raw.substr(equals + 1), kQuerySafe, stage);
+            }
+            if (!stage.ok()) {
+                return 0;
+            }
+            const std::string_view name(out + offset, nameSize);
+            if (stage.size == offset || (options_.stripTracking && isTracking(name))) {
+                stage.size = offset;
+                continue;
+            }
+            if (count < kMaxQueryParams) {
+                params[count++] = Param{static_cast<uint32_t>(offset), static_cast<uint32_t>(stage.size - offset),
+                                        static_cast<uint32_t>(nameSize)};
+            } else {
+                stage.put('&');
+            }
+        }
+        const size_t overflowEnd = stage.size;
+        if (count > 0) {
+            if (options_.sortQuery) {
+                // Insertion sort: stable, in place (std::stable_sort may allocate), and queries are short
+                for (size_t p = 1; p < count; ++p) {
+                    const Param param = params[p];
+                    const std::string_view name(out + param.offset, param.nameSize);
+                    size_t q = p;
+                    while (q > 0 && name < std::string_view(out + params[q - 1].offset, params[q - 1].nameSize)) {
+                        params[q] = params[q - 1];
+                        --q;
+                    }
+                    params[q] = param;
+                }
+            }
+            // The output overlaps the staged parameters, so they are copied out first
+            char staged[kMaxUrlBytes];
+            const size_t stagedSize = overflowEnd - queryOffset;
+            std::memcpy(staged, out + queryOffset, stagedSize);
+            w.put('?');
+            for (size_t p = 0; p < count; ++p) {
+                if (p > 0) {
+                    w.put('&');
+                }
+                w.append(std::string_view(staged + params[p].offset - queryOffset, params[p].size));
+            }
+            size_t overflowStart = queryOffset;
+            for (size_t p = 0; p < count; ++p) {
+                overflowStart = std::max<size_t>(overflowStart, params[p].offset + params[p].size);
+            }
+            if (overflowEnd > overflowStart) {
+                // Parameters past kMaxQueryParams, each followed by '&'
+                w.put('&');
+                w.append(std::string_view(staged + overflowStart - queryOffset, overflowEnd - overflowStart - 1));
+            }
+        }
+    }
+
+    if (!options_.dropFragment && hash != std::string_view::npos) {
+        w.put('#');
+        writeEscaped(url.substr(hash + 1), kQuerySafe, w);
+    }
+    return w.ok() ? w.size : 0;
+}
+
+bool UrlCanonicalizer::canonicalize(std::string_view url, std::string& out) const {
+    char buffer[kMaxUrlBytes];
+    const size_t size = canonicalize(url, buffer, sizeof(buffer));
+    out.assign(buffer, size);
+    return size > 0;
+}
+
+bool UrlCanonicalizer::hash(std::string_view url, Hash128& hash) const {
+    char buffer[kMaxUrlBytes];
+    const size_t size = canonicalize(url, buffer, sizeof(buffer));
+    if (size == 0) {
+        return false;
+    }
+    hash = murmurHash3(buffer, size);
+    return true;
+}
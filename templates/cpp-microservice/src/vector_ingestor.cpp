@@ -0,0 +1,237 @@
+#include "vector_ingestor.h"
+#include "hash.h"
+#include <chrono>
+#include <iostream>
+#include <unordered_map>
+
+namespace {
+
+const size_t kPrepareGrain = 256;
+// Failed batches remembered for lost()
+const size_t kMaxFailedRanges = 1024;
+
+} // namespace
+
+VectorIngestor::VectorIngestor()
+    : store_(nullptr), running_(false), parked_(false), applied_(0), submitted_(0), written_(0), duplicates_(0),
+      failed_(0), batches_(0) {}
+
+VectorIngestor::~VectorIngestor() {
+    stop();
+}
+
+bool VectorIngestor::start(VectorStore& store, const IngestOptions& options) {
+    stop();
+    if (!store.pool() || options.maxBatch == 0) {
+        std::cerr << "Ingestion pipeline needs an open store and a non-zero batch size" << std::endl;
+        return false;
+    }
+    store_ = &store;
+    options_ = options;
+    queue_.reset(new MpscQueue<Item>(options_.queueCapacity));
+    applied_.store(queue_->dequeuePosition(), std::memory_order_release);
+    running_.store(true);
+    applier_ = std::thread(&VectorIngestor::applyLoop, this);
+    return true;
+}
+
+void VectorIngestor::stop() {
+    if (!applier_.joinable()) {
+        return;
+    }
+    running_.store(false);
+    {
+        std::lock_guard<std::mutex> lock(parkMutex_);
+        parkCv_.notify_one();
+    }
+    applier_.join();
+}
+
+std::string VectorIngestor::contentId(const std::string& text) {
+    // The Python service's _generate_id: the first 16 hex digits of SHA-256
+    uint8_t digest[Sha256::kDigestSize];
+    Sha256::hash(text.data(), text.size(), digest);
+    return toHex(digest, 8);
+}
+
+uint64_t VectorIngestor::submit(std::vector<VectorRecord>& records, const std::string& idPrefix,
+                                uint64_t* first) {
+    if (!running_.load() || records.empty()) {
+        return 0;
+    }
+    const size_t dim = store_->options().dim;
+    for (const VectorRecord& record : records) {
+        if (record.vector.size() != dim || (record.id.empty() && !record.metadata.count("document"))) {
+            std::cerr << "Rejected ingest batch: record '" << record.id << "' has dim " << record.vector.size()
+                      << " or no id" << std::endl;
+            return 0;
+        }
+    }
+
+    // Hashing and normalization dominate per-record cost, so they run on the
+    // pool; the applier thread only dedups and writes
+    std::vector<uint64_t> idHashes(records.size());
+    std::vector<uint64_t> fingerprints(records.size());
+    store_->pool()->parallelFor(records.size(), kPrepareGrain, [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            VectorRecord& record = records[i];
+            if (record.id.empty()) {
+                record.id = contentId(record.metadata["document"]);
+            }
+            if (!idPrefix.empty()) {
+                record.id = idPrefix + record.id;
+            }
+            idHashes[i] = hash64(record.id);
+            fingerprints[i] = store_->prepareRecord(record);
+        }
+    });
+
+    uint64_t ticket = 0;
+    for (size_t i = 0; i < records.size(); ++i) {
+        Item item{std::move(records[i]), idHashes[i], fingerprints[i]};
+        for (int attempt = 0; !queue_->tryPush(std::move(item), &ticket); ++attempt) {
+            // Stopped while full: the applier is gone and will never make room
+            if (!running_.load()) {
+                return 0;
+            }
+            // Full: wake the applier and back off until it makes room
+            if (parked_.load()) {
+                std::lock_guard<std::mutex> lock(parkMutex_);
+                parkCv_.notify_one();
+            }
+            if (attempt < 64) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+        if (i == 0 && first) {
+            *first = ticket;
+        }
+    }
+    submitted_.fetch_add(records.size());
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked_.load()) {
+        std::lock_guard<std::mutex> lock(parkMutex_);
+        parkCv_.notify_one();
+    }
+    return ticket + 1;
+}
+
+bool VectorIngestor::waitFor(uint64_t token, int timeoutMillis) const {
+    if (appliedToken() >= token) {
+        return true;
+    }
+    std::unique_lock<std::mutex> lock(appliedMutex_);
+    return appliedCv_.wait_for(lock, std::chrono::milliseconds(timeoutMillis),
+                               [&] { return appliedToken() >= token; });
+}
+
+bool VectorIngestor::lost(uint64_t first, uint64_t token) const {
+    std::lock_guard<std::mutex> lock(appliedMutex_);
+    for (const auto& range : failedRanges_) {
+        if (range.first < token && first < range.second) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void VectorIngestor::applyLoop() {
+    std::vector<Item> batch;
+    batch.reserve(options_.maxBatch);
+    while (true) {
+        Item item;
+        while (batch.size() < options_.maxBatch && queue_->tryPop(item)) {
+            batch.push_back(std::move(item));
+        }
+
+        if (batch.empty()) {
+            if (!running_.load()) {
+                return;
+            }
+            // Advertise that we are parking, then re-check so a concurrent push is not missed
+            std::unique_lock<std::mutex> lock(parkMutex_);
+            parked_.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (queue_->tryPop(item)) {
+                batch.push_back(std::move(item));
+            } else if (running_.load()) {
+                parkCv_.wait_for(lock, std::chrono::milliseconds(5));
+            }
+            parked_.store(false);
+            continue;
+        }
+
+        const bool applied = applyBatch(batch);
+        batch.clear();
+        {
+            std::lock_guard<std::mutex> lock(appliedMutex_);
+            if (!applied) {
+                failedRanges_.emplace_back(applied_.load(std::memory_order_relaxed), queue_->dequeuePosition());
+                if (failedRanges_.size() > kMaxFailedRanges) {
+                    failedRanges_.pop_front();
+                }
+            }
+            applied_.store(queue_->dequeuePosition(), std::memory_order_release);
+        }
+        appliedCv_.notify_all();
+    }
+}
+
+bool VectorIngestor::applyBatch(std::vector<Item>& batch) {
+    // Keep the last write of each id; ids were hashed by the producers. A
+    // 64-bit hash collision between different ids just leaves both in place,
+    // which is still correct because the store applies records in order.
+    std::unordered_map<uint64_t, size_t> latest;
+    latest.reserve(batch.size());
+    std::vector<bool> superseded(batch.size(), false);
+    for (size_t i = 0; i < batch.size(); ++i) {
+        auto inserted = latest.emplace(batch[i].idHash, i);
+        if (!inserted.second) {
+            size_t& previous = inserted.first->second;
+            if (batch[previous].record.id == batch[i].record.id) {
+                superseded[previous] = true;
+                previous = i;
+            }
+        }
+    }
+
+    std::vector<VectorRecord> records;
+    std::vector<uint64_t> fingerprints;
+    records.reserve(batch.size());
+    fingerprints.reserve(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (!superseded[i]) {
+            records.push_back(std::move(batch[i].record));
+            fingerprints.push_back(batch[i].fingerprint);
+        }
+    }
+
+    size_t written = 0;
+    const bool applied = store_->upsertBatch(records, fingerprints, &written);
+    if (applied) {
+        written_.fetch_add(written);
+        duplicates_.fetch_add(batch.size() - written);
+    } else {
+        std::cerr << "Failed to apply ingest batch of " << records.size() << " records" << std::endl;
+        failed_.fetch_add(records.size());
+        duplicates_.fetch_add(batch.size() - records.size());
+    }
+    batches_.fetch_add(1);
+    return applied;
+}
+
+IngestStats VectorIngestor::stats() const {
+    IngestStats s;
+    s.submitted = submitted_.load();
+    s.written = written_.load();
+    s.duplicates = duplicates_.load();
+    s.failed = failed_.load();
+    s.batches = batches_.load();
+    s.appliedToken = appliedToken();
+    uint64_t claimed = queue_ ? queue_->enqueuePosition() : 0;
+    s.queued = claimed > s.appliedToken ? claimed - s.appliedToken : 0;
+    return s;
+}
@@ -0,0 +1,589 @@
+#include "vector_segment.h"
+#include "checksum.h"
+#include "file_util.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+const char kSegmentMagic[8] = {'D', 'S', 'S', 'V', 'S', 'E', 'G', '\0'};
+
+struct IdTableEntry {
+    uint64_t hash;
+    uint32_t row;
+    uint32_t pad;
+};
+
+struct TermEntry {
+    uint64_t termOffset;
+    uint64_t bitmapOffset;
+    uint32_t termLength;
+    uint32_t bitmapLength;
+};
+
+uint64_t alignToPage(uint64_t offset) {
+    return (offset + VectorSegment::kPageSize - 1) & ~static_cast<uint64_t>(VectorSegment::kPageSize - 1);
+}
+
+uint32_t headerChecksum(SegmentHeader header) {
+    header.checksum = 0;
+    return crc32c(&header, sizeof(header));
+}
+
+bool pwriteAll(int fd, const void* data, size_t length, uint64_t offset) {
+    const char* p = static_cast<const char*>(data);
+    while (length > 0) {
+        ssize_t n = pwrite(fd, p, length, static_cast<off_t>(offset));
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        length -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+void encodeMetadata(const Metadata& metadata, std::string& out) {
+    appendRaw<uint16_t>(out, static_cast<uint16_t>(metadata.size()));
+    for (const auto& kv : metadata) {
+        appendRaw<uint16_t>(out, static_cast<uint16_t>(kv.first.size()));
+        out.append(kv.first);
+        appendRaw<uint32_t>(out, static_cast<uint32_t>(kv.second.size()));
+        out.append(kv.second);
+    }
+}
+
+bool decodeMetadata(const uint8_t* data, size_t size, Metadata& metadata) {
+    if (size < 2) {
+        return size == 0;
+    }
+    const uint8_t* end = data + size;
+    uint16_t count = readRaw<uint16_t>(data);
+    data += 2;
+    for (uint16_t i = 0; i < count; ++i) {
+        if (end - data < 2) {
+            return false;
+        }
+        uint16_t keyLen = readRaw<uint16_t>(data);
+        data += 2;
+        if (end - data < static_cast<ptrdiff_t>(keyLen) + 4) {
+            return false;
+        }
+        std::string key(reinterpret_cast<const char*>(data), keyLen);
+        data += keyLen;
+        uint32_t valueLen = readRaw<uint32_t>(data);
+        data += 4;
+        if (end - data < static_cast<ptrdiff_t>(valueLen)) {
+            return false;
+        }
+        metadata[key].assign(reinterpret_cast<const char*>(data), valueLen);
+        data += valueLen;
+    }
+    return true;
+}
+
+std::string_view findMetadataValue(const uint8_t* data, size_t size, std::string_view key) {
+    if (size < 2) {
+        return std::string_view();
+    }
+    const uint8_t* end = data + size;
+    uint16_t count = readRaw<uint16_t>(data);
+    data += 2;
+    for (uint16_t i = 0; i < count && end - data >= 2; ++i) {
+        uint16_t keyLen = readRaw<uint16_t>(data);
+        data += 2;
+        if (end - data < static_cast<ptrdiff_t>(keyLen) + 4) {
+            break;
+        }
+        std::string_view candidate(reinterpret_cast<const char*>(data), keyLen);
+        data += keyLen;
+        uint32_t valueLen = readRaw<uint32_t>(data);
+        data += 4;
+        if (end - data < static_cast<ptrdiff_t>(valueLen)) {
+            break;
+        }
+        if (candidate == key) {
+            return std::string_view(reinterpret_cast<const char*>(data), valueLen);
+        }
+        data += valueLen;
+    }
+    return std::string_view();
+}
+
+uint64_t hashRecordId(std::string_view id) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : id) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// ─── VectorSegment ──────────────────────────────────────────────────────────
+
+VectorSegment::VectorSegment()
+    : header_(), vectors_(nullptr), idOffsets_(nullptr), idBlob_(nullptr), idTable_(nullptr),
+      idTableMask_(0), metadataOffsets_(nullptr), metadataBlob_(nullptr), codes_(nullptr),
+      termDirectory_(nullptr), termCount_(0), terms_(nullptr), bitmaps_(nullptr) {}
+
+VectorSegment::~VectorSegment() {
+    close();
+}
+
+bool VectorSegment::open(const std::string& path) {
+    close();
+    if (!file_.open(path)) {
+        std::cerr << "Failed to map vector segment: " << path << std::endl;
+        return false;
+    }
+    if (!validate()) {
+        std::cerr << "Invalid vector segment: " << path << std::endl;
+        close();
+        return false;
+    }
+    // Graph traversal touches pages in no particular order
+    file_.adviseRandom(true);
+    return true;
+}
+
+void VectorSegment::close() {
+    file_.close();
+    header_ = SegmentHeader();
+    vectors_ = nullptr;
+    idOffsets_ = nullptr;
+    idBlob_ = nullptr;
+    idTable_ = nullptr;
+    idTableMask_ = 0;
+    metadataOffsets_ = nullptr;
+    metadataBlob_ = nullptr;
+    graph_ = HnswGraphView();
+    quantizer_.reset();
+    codes_ = nullptr;
+    indexedKeys_.clear();
+    termDirectory_ = nullptr;
+    termCount_ = 0;
+    terms_ = nullptr;
+    bitmaps_ = nullptr;
+}
+
+const uint8_t* VectorSegment::section(SegmentSection section, size_t* length) const {
+    const SegmentHeader::Section& s = header_.sections[static_cast<uint32_t>(section)];
+    if (length) {
+        *length = s.length;
+    }
+    return s.length ? file_.data() + s.offset : nullptr;
+}
+
+bool VectorSegment::validate() {
+    if (file_.size() < sizeof(SegmentHeader)) {
+        return false;
+    }
+    std::memcpy(&header_, file_.data(), sizeof(SegmentHeader));
+
+    if (std::memcmp(header_.magic, kSegmentMagic, sizeof(kSegmentMagic)) != 0) {
+        return false;
+    }
+    if (header_.version != kFormatVersion) {
+        std::cerr << "Unsupported vector segment version " << header_.version << std::endl;
+        return false;
+    }
+    if (header_.checksum != headerChecksum(header_)) {
+        return false;
+    }
+    if (header_.dim == 0 || header_.count >= kInvalidRow) {
+        return false;
+    }
+
+    for (const SegmentHeader::Section& s : header_.sections) {
+        if (s.length == 0) {
+            continue;
+        }
+        if (s.offset % kPageSize != 0 || s.offset > file_.size() || s.length > file_.size() - s.offset) {
+            return false;
+        }
+    }
+
+    const uint64_t count = header_.count;
+    auto sectionLength = [this](SegmentSection s) { return header_.sections[static_cast<uint32_t>(s)].length; };
+    if (sectionLength(SegmentSection::Vectors) != count * header_.dim * sizeof(float) ||
+        sectionLength(SegmentSection::IdOffsets) != (count + 1) * sizeof(uint64_t) ||
+        sectionLength(SegmentSection::MetadataOffsets) != (count + 1) * sizeof(uint64_t) ||
+        sectionLength(SegmentSection::GraphLevels) != count ||
+        sectionLength(SegmentSection::GraphLevel0) != count * (header_.maxDegree0 + 1) * sizeof(uint32_t) ||
+        sectionLength(SegmentSection::GraphUpperOffsets) != (count + 1) * sizeof(uint64_t)) {
+        return false;
+    }
+
+    uint64_t tableBytes = sectionLength(SegmentSection::IdTable);
+    uint64_t tableSlots = tableBytes / sizeof(IdTableEntry);
+    if (count > 0 && (tableSlots < count || (tableSlots & (tableSlots - 1)) != 0)) {
+        return false;
+    }
+
+    vectors_ = reinterpret_cast<const float*>(section(SegmentSection::Vectors, nullptr));
+    idOffsets_ = reinterpret_cast<const uint64_t*>(section(SegmentSection::IdOffsets, nullptr));
+    idBlob_ = reinterpret_cast<const char*>(section(SegmentSection::IdBlob, nullptr));
+    idTable_ = section(SegmentSection::IdTable, nullptr);
+    idTableMask_ = tableSlots ? tableSlots - 1 : 0;
+    metadataOffsets_ = reinterpret_cast<const uint64_t*>(section(SegmentSection::MetadataOffsets, nullptr));
+    metadataBlob_ = section(SegmentSection::MetadataBlob, nullptr);
+
+    if (idOffsets_[count] != sectionLength(SegmentSection::IdBlob) ||
+        metadataOffsets_[count] != sectionLength(SegmentSection::MetadataBlob)) {
+        return false;
+    }
+
+    graph_.level0 = reinterpret_cast<const uint32_t*>(section(SegmentSection::GraphLevel0, nullptr));
+    graph_.levels = section(SegmentSection::GraphLevels, nullptr);
+    graph_.upperOffsets = reinterpret_cast<const uint64_t*>(section(SegmentSection::GraphUpperOffsets, nullptr));
+    graph_.upper = reinterpret_cast<const uint32_t*>(section(SegmentSection::GraphUpper, nullptr));
+    graph_.count = static_cast<uint32_t>(count);
+    graph_.maxDegree = header_.maxDegree;
+    graph_.maxDegree0 = header_.maxDegree0;
+    graph_.entryPoint = count ? header_.entryPoint : kInvalidRow;
+    graph_.maxLevel = header_.maxLevel;
+
+    if (graph_.upperOffsets[count] * sizeof(uint32_t) != sectionLength(SegmentSection::GraphUpper)) {
+        return false;
+    }
+
+    size_t paramsLength = 0;
+    const uint8_t* params = section(SegmentSection::QuantizerParams, &paramsLength);
+    if (params) {
+        quantizer_ = VectorQuantizer::deserialize(params, paramsLength);
+        if (!quantizer_ || quantizer_->dim() != header_.dim || quantizer_->metric() != metric() ||
+            sectionLength(SegmentSection::QuantizedCodes) != count * quantizer_->codeSize()) {
+            return false;
+        }
+        codes_ = section(SegmentSection::QuantizedCodes, nullptr);
+    }
+
+    size_t termsLength = 0;
+    terms_ = reinterpret_cast<const char*>(section(SegmentSection::MetadataIndexTerms, &termsLength));
+    uint32_t keysLength = 0;
+    if (terms_) {
+        keysLength = termsLength >= 4 ? readRaw<uint32_t>(reinterpret_cast<const uint8_t*>(terms_)) : 0;
+        if (termsLength < 4 || keysLength > termsLength - 4) {
+            return false;
+        }
+    }
+    const char* keys = terms_ + 4;
+    for (size_t pos = 0; pos < keysLength;) {
+        const void* nul = std::memchr(keys + pos, '\0', keysLength - pos);
+        if (!nul) {
+            return false;
+        }
+        size_t end = static_cast<size_t>(static_cast<const char*>(nul) - keys);
+        indexedKeys_.push_back(std::string_view(keys + pos, end - pos));
+        pos = end + 1;
+    }
+
+    size_t directoryLength = 0;
+    termDirectory_ = section(SegmentSection::MetadataIndexDirectory, &directoryLength);
+    termCount_ = directoryLength / sizeof(TermEntry);
+    bitmaps_ = section(SegmentSection::MetadataIndexBitmaps, nullptr);
+    const uint64_t termBytes = sectionLength(SegmentSection::MetadataIndexTerms);
+    const uint64_t bitmapBytes = sectionLength(SegmentSection::MetadataIndexBitmaps);
+    for (uint64_t i = 0; i < termCount_; ++i) {
+        TermEntry entry = readRaw<TermEntry>(termDirectory_ + i * sizeof(TermEntry));
+        if (entry.termOffset + entry.termLength > termBytes || entry.bitmapOffset % 8 != 0 ||
+            entry.bitmapOffset + entry.bitmapLength > bitmapBytes) {
+            return false;
+        }
+    }
+    return count == 0 || header_.entryPoint < count;
+}
+
+bool VectorSegment::isIndexed(std::string_view key) const {
+    return std::find(indexedKeys_.begin(), indexedKeys_.end(), key) != indexedKeys_.end();
+}
+
+bool VectorSegment::metadataBitmap(std::string_view key, std::string_view value, RoaringView& bitmap) const {
+    bitmap = RoaringView();
+    if (!isIndexed(key)) {
+        return false;
+    }
+
+    std::string term;
+    term.reserve(key.size() + 1 + value.size());
+    term.append(key.data(), key.size()).push_back('\0');
+    term.append(value.data(), value.size());
+
+    // Binary search over the term-sorted directory
+    uint64_t lo = 0;
+    uint64_t hi = termCount_;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        TermEntry entry = readRaw<TermEntry>(termDirectory_ + mid * sizeof(TermEntry));
+        int cmp = std::string_view(terms_ + entry.termOffset, entry.termLength).compare(term);
+        if (cmp == 0) {
+            // A damaged bitmap reads as empty rather than failing the query
+            bitmap.open(bitmaps_ + entry.bitmapOffset, entry.bitmapLength);
+            return true;
+        }
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return true;
+}
+
+std::string_view VectorSegment::id(uint32_t row) const {
+    return std::string_view(idBlob_ + idOffsets_[row], idOffsets_[row + 1] - idOffsets_[row]);
+}
+
+Metadata VectorSegment::metadata(uint32_t row) const {
+    Metadata result;
+    decodeMetadata(metadataBlob_ + metadataOffsets_[row], metadataOffsets_[row + 1] - metadataOffsets_[row], result);
+    return result;
+}
+
+const uint8_t* VectorSegment::metadataRecord(uint32_t row, size_t* length) const {
+    *length = metadataOffsets_[row + 1] - metadataOffsets_[row];
+    return metadataBlob_ + metadataOffsets_[row];
+}
+
+std::string_view VectorSegment::metadataValue(uint32_t row, std::string_view key) const {
+    return findMetadataValue(metadataBlob_ + metadataOffsets_[row],
+                             metadataOffsets_[row + 1] - metadataOffsets_[row], key);
+}
+
+uint32_t VectorSegment::findRow(std::string_view id) const {
+    if (header_.count == 0) {
+        return kInvalidRow;
+    }
+    uint64_t hash = hashRecordId(id);
+    for (uint64_t slot = hash & idTableMask_;; slot = (slot + 1) & idTableMask_) {
+        IdTableEntry entry;
+        std::memcpy(&entry, idTable_ + slot * sizeof(IdTableEntry), sizeof(entry));
+        if (entry.row == kInvalidRow) {
+            return kInvalidRow;
+        }
+        if (entry.hash == hash && this->id(entry.row) == id) {
+            return entry.row;
+        }
+    }
+}
+
+// ─── VectorSegmentWriter ────────────────────────────────────────────────────
+
+VectorSegmentWriter::VectorSegmentWriter(const std::string& path, uint32_t dim, DistanceMetric metric,
+                                         uint64_t generation)
+    : path_(path), tmpPath_(path + ".tmp"), dim_(dim), metric_(metric), generation_(generation), count_(0),
+      fd_(-1), vectors_(nullptr), vectorBytes_(0), nextOffset_(0), header_() {}
+
+VectorSegmentWriter::~VectorSegmentWriter() {
+    abort();
+}
+
+void VectorSegmentWriter::abort() {
+    if (vectors_) {
+        munmap(vectors_, vectorBytes_);
+        vectors_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+        unlink(tmpPath_.c_str());
+    }
+}
+
+bool VectorSegmentWriter::begin(uint32_t count) {
+    abort();
+    count_ = count;
+    fd_ = ::open(tmpPath_.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        std::cerr << "Failed to create segment file: " << tmpPath_ << std::endl;
+        return false;
+    }
+
+    const uint64_t vectorOffset = VectorSegment::kPageSize;
+    vectorBytes_ = static_cast<size_t>(count) * dim_ * sizeof(float);
+    nextOffset_ = alignToPage(vectorOffset + vectorBytes_);
+    if (ftruncate(fd_, static_cast<off_t>(nextOffset_)) != 0) {
+        abort();
+        return false;
+    }
+
+    header_.sections[static_cast<uint32_t>(SegmentSection::Vectors)] = {vectorOffset, vectorBytes_};
+    if (vectorBytes_ > 0) {
+        void* addr = mmap(nullptr, vectorBytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_,
+                          static_cast<off_t>(vectorOffset));
+        if (addr == MAP_FAILED) {
+            abort();
+            return false;
+        }
+        vectors_ = static_cast<float*>(addr);
+    }
+
+    idOffsets_.assign(1, 0);
+    idOffsets_.reserve(static_cast<size_t>(count) + 1);
+    metadataOffsets_.assign(1, 0);
+    metadataOffsets_.reserve(static_cast<size_t>(count) + 1);
+    idBlob_.clear();
+    metadataBlob_.clear();
+    return true;
+}
+
+void VectorSegmentWriter::addRecord(std::string_view id, const Metadata& metadata) {
+    idBlob_.append(id.data(), id.size());
+    idOffsets_.push_back(idBlob_.size());
+    encodeMetadata(metadata, metadataBlob_);
+    metadataOffsets_.push_back(metadataBlob_.size());
+}
+
+void VectorSegmentWriter::addEncodedRecord(std::string_view id, const uint8_t* metadata, size_t metadataSize) {
+    idBlob_.append(id.data(), id.size());
+    idOffsets_.push_back(idBlob_.size());
+    metadataBlob_.append(reinterpret_cast<const char*>(metadata), metadataSize);
+    metadataOffsets_.push_back(metadataBlob_.size());
+}
+
+void VectorSegmentWriter::setQuantization(const VectorQuantizer& quantizer, std::vector<uint8_t> codes) {
+    quantizerParams_.clear();
+    quantizer.serialize(quantizerParams_);
+    codes_ = std::move(codes);
+}
+
+bool VectorSegmentWriter::writeSection(SegmentSection section, const void* data, size_t length) {
+    header_.sections[static_cast<uint32_t>(section)] = {nextOffset_, length};
+    if (length > 0 && !pwriteAll(fd_, data, length, nextOffset_)) {
+        return false;
+    }
+    nextOffset_ = alignToPage(nextOffset_ + length);
+    return true;
+}
+
+bool VectorSegmentWriter::finish(const HnswBuilder& graph) {
+    if (fd_ < 0 || idOffsets_.size() != static_cast<size_t>(count_) + 1 || graph.size() != count_) {
+        std::cerr << "Segment writer finished with " << idOffsets_.size() - 1 << " records and "
+                  << graph.size() << " graph nodes, expected " << count_ << std::endl;
+        abort();
+        return false;
+    }
+
+    if (vectors_) {
+        msync(vectors_, vectorBytes_, MS_SYNC);
+        munmap(vectors_, vectorBytes_);
+        vectors_ = nullptr;
+    }
+
+    // Id lookup table, at most half full
+    uint64_t slots = 1;
+    while (slots < static_cast<uint64_t>(count_) * 2) {
+        slots <<= 1;
+    }
+    std::vector<IdTableEntry> table(count_ ? slots : 0, IdTableEntry{0, kInvalidRow, 0});
+    for (uint32_t row = 0; row < count_; ++row) {
+        std::string_view id(idBlob_.data() + idOffsets_[row], idOffsets_[row + 1] - idOffsets_[row]);
+        uint64_t hash = hashRecordId(id);
+        uint64_t slot = hash & (slots - 1);
+        while (table[slot].row != kInvalidRow) {
+            slot = (slot + 1) & (slots - 1);
+        }
+        table[slot] = IdTableEntry{hash, row, 0};
+    }
+
+    std::vector<uint64_t> upperOffsets;
+    std::vector<uint32_t> upper;
+    graph.flattenUpper(upperOffsets, upper);
+
+    // "key\0value" -> rows for the indexed keys, so filters can be applied during the search
+    std::map<std::string, std::vector<uint32_t>> postings;
+    for (uint32_t row = 0; row < count_; ++row) {
+        const uint8_t* record = reinterpret_cast<const uint8_t*>(metadataBlob_.data()) + metadataOffsets_[row];
+        const size_t length = metadataOffsets_[row + 1] - metadataOffsets_[row];
+        for (const std::string& key : indexedKeys_) {
+            std::string_view value = findMetadataValue(record, length, key);
+            // Absent keys come back as a null view; present but empty values are indexed
+            if (value.data()) {
+                std::string term = key;
+                term.push_back('\0');
+                term.append(value.data(), value.size());
+                postings[term].push_back(row);
+            }
+        }
+    }
+    std::string indexKeys;
+    for (const std::string& key : indexedKeys_) {
+        indexKeys.append(key).push_back('\0');
+    }
+    std::vector<TermEntry> termDirectory;
+    std::string terms;
+    if (!indexedKeys_.empty()) {
+        appendRaw<uint32_t>(terms, static_cast<uint32_t>(indexKeys.size()));
+        terms.append(indexKeys);
+    }
+    std::string bitmaps;
+    for (const auto& kv : postings) {
+        const size_t bitmapStart = bitmaps.size();
+        encodeRoaring(kv.second.data(), kv.second.size(), bitmaps);
+        termDirectory.push_back(TermEntry{terms.size(), bitmapStart, static_cast<uint32_t>(kv.first.size()),
+                                          static_cast<uint32_t>(bitmaps.size() - bitmapStart)});
+        terms.append(kv.first);
+    }
+
+    bool ok = writeSection(SegmentSection::IdOffsets, idOffsets_.data(), idOffsets_.size() * sizeof(uint64_t)) &&
+              writeSection(SegmentSection::IdBlob, idBlob_.data(), idBlob_.size()) &&
+              writeSection(SegmentSection::IdTable, table.data(), table.size() * sizeof(IdTableEntry)) &&
+              writeSection(SegmentSection::MetadataOffsets, metadataOffsets_.data(),
+                           metadataOffsets_.size() * sizeof(uint64_t)) &&
+              writeSection(SegmentSection::MetadataBlob, metadataBlob_.data(), metadataBlob_.size()) &&
+              writeSection(SegmentSection::GraphLevels, graph.levels().data(), graph.levels().size()) &&
+              writeSection(SegmentSection::GraphLevel0, graph.level0().data(),
+                           graph.level0().size() * sizeof(uint32_t)) &&
+              writeSection(SegmentSection::GraphUpperOffsets, upperOffsets.data(),
+                           upperOffsets.size() * sizeof(uint64_t)) &&
+              writeSection(SegmentSection::GraphUpper, upper.data(), upper.size() * sizeof(uint32_t)) &&
+              writeSection(SegmentSection::QuantizerParams, quantizerParams_.data(), quantizerParams_.size()) &&
+              writeSection(SegmentSection::QuantizedCodes, codes_.data(), codes_.size()) &&
+              writeSection(SegmentSection::MetadataIndexTerms, terms.data(), terms.size()) &&
+              writeSection(SegmentSection::MetadataIndexDirectory, termDirectory.data(),
+                           termDirectory.size() * sizeof(TermEntry)) &&
+              writeSection(SegmentSection::MetadataIndexBitmaps, bitmaps.data(), bitmaps.size());
+    if (!ok || ftruncate(fd_, static_cast<off_t>(nextOffset_)) != 0 || fsync(fd_) != 0) {
+        std::cerr << "Failed to write segment sections: " << tmpPath_ << std::endl;
+        abort();
+        return false;
+    }
+
+    // The header goes last so a partially written file never validates
+    std::memcpy(header_.magic, kSegmentMagic, sizeof(kSegmentMagic));
+    header_.version = VectorSegment::kFormatVersion;
+    header_.headerSize = sizeof(SegmentHeader);
+    header_.dim = dim_;
+    header_.metric = static_cast<uint32_t>(metric_);
+    header_.count = count_;
+    header_.generation = generation_;
+    header_.maxDegree = graph.maxDegree();
+    header_.maxDegree0 = graph.maxDegree0();
+    header_.entryPoint = count_ ? graph.entryPoint() : kInvalidRow;
+    header_.maxLevel = graph.maxLevel();
+    header_.checksum = headerChecksum(header_);
+
+    if (!pwriteAll(fd_, &header_, sizeof(header_), 0) || fsync(fd_) != 0) {
+        abort();
+        return false;
+    }
+    ::close(fd_);
+    fd_ = -1;
+
+    if (rename(tmpPath_.c_str(), path_.c_str()) != 0) {
+        std::cerr << "Failed to install segment file: " << path_ << std::endl;
+        unlink(tmpPath_.c_str());
+        return false;
+    }
+    std::string::size_type slash = path_.find_last_of('/');
+    syncDirectory(slash == std::string::npos ? "." : path_.substr(0, slash));
+    return true;
+}
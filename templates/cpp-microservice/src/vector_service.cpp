@@ -0,0 +1,342 @@
+#include "vector_service.h"
+#include "config_manager.h"
+#include "json_util.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+typedef std::map<std::string, std::string> Params;
+
+std::string param(const Params& params, const std::string& key, const std::string& defaultValue = "") {
+    auto it = params.find(key);
+    return it != params.end() ? it->second : defaultValue;
+}
+
+bool parseVector(const std::string& text, std::vector<float>& out) {
+    out.clear();
+    const char* p = text.c_str();
+    while (*p) {
+        char* end = nullptr;
+        float value = std::strtof(p, &end);
+        if (end == p) {
+            return false;
+        }
+        out.push_back(value);
+        p = end;
+        while (*p == ',' || *p == ' ') {
+            ++p;
+        }
+    }
+    return !out.empty();
+}
+
+std::string error(const std::string& message) {
+    std::string out = "{\"error\": ";
+    appendJsonString(out, message);
+    out += "}";
+    return out;
+}
+
+void appendMetadata(std::string& out, const Metadata& metadata) {
+    out += "{";
+    bool first = true;
+    for (const auto& kv : metadata) {
+        if (!first) {
+            out += ", ";
+        }
+        first = false;
+        appendJsonString(out, kv.first);
+        out += ": ";
+        appendJsonString(out, kv.second);
+    }
+    out += "}";
+}
+
+} // namespace
+
+VectorService::VectorService() : embedder_(nullptr), maxDocuments_(10000) {}
+
+VectorService::~VectorService() {
+    shutdown();
+}
+
+bool VectorService::initialize(const ConfigManager& config) {
+    VectorStoreOptions options;
+    options.directory = config.get("VECTOR_INDEX_DIR", options.directory);
+    options.dim = static_cast<uint32_t>(config.getInt("VECTOR_DIM", static_cast<int>(options.dim)));
+    options.metric = config.get("VECTOR_METRIC", "cosine") == "l2" ? DistanceMetric::L2 : DistanceMetric::Cosine;
+    options.efSearch = static_cast<size_t>(config.getInt("VECTOR_EF_SEARCH", static_cast<int>(options.efSearch)));
+    options.compactionThreshold = static_cast<size_t>(
+        config.getInt("VECTOR_COMPACTION_THRESHOLD", static_cast<int>(options.compactionThreshold)));
+    options.compactionIntervalSeconds =
+        config.getInt("VECTOR_COMPACTION_INTERVAL", options.compactionIntervalSeconds);
+    options.syncWrites = config.getBool("VECTOR_SYNC_WRITES", options.syncWrites);
+    options.quantization = parseQuantizerType(config.get("VECTOR_QUANTIZATION", "none"));
+    options.pqSubspaces = static_cast<uint32_t>(config.getInt("VECTOR_PQ_SUBSPACES", 0));
+    options.rerankFactor =
+        static_cast<size_t>(config.getInt("VECTOR_RERANK_FACTOR", static_cast<int>(options.rerankFactor)));
+    options.flatScanThreshold = static_cast<size_t>(
+        config.getInt("VECTOR_FLAT_SCAN_THRESHOLD", static_cast<int>(options.flatScanThreshold)));
+    options.searchThreads = static_cast<size_t>(config.getInt("VECTOR_SEARCH_THREADS", 0));
+    std::string indexed = config.get("VECTOR_INDEXED_METADATA", "namespace,url,query");
+    options.indexedMetadataKeys.clear();
+    std::stringstream keys(indexed);
+    std::string key;
+    while (std::getline(keys, key, ',')) {
+        if (!key.empty()) {
+            options.indexedMetadataKeys.push_back(key);
+        }
+    }
+
+    if (!store_.open(options)) {
+        std::cerr << "Failed to open vector store at " << options.directory << std::endl;
+        return false;
+    }
+    store_.startBackgroundCompaction();
+
+    const int maxDocuments = config.getInt("VECTOR_MAX_BATCH_DOCUMENTS", static_cast<int>(maxDocuments_));
+    if (maxDocuments < 1) {
+        std::cerr << "VECTOR_MAX_BATCH_DOCUMENTS must be positive" << std::endl;
+        return false;
+    }
+    maxDocuments_ = static_cast<size_t>(maxDocuments);
+
+    IngestOptions ingest;
+    ingest.queueCapacity = static_cast<size_t>(
+        config.getInt("VECTOR_INGEST_QUEUE_CAPACITY", static_cast<int>(ingest.queueCapacity)));
+    ingest.maxBatch =
+        static_cast<size_t>(config.getInt("VECTOR_INGEST_MAX_BATCH", static_cast<int>(ingest.maxBatch)));
+    return ingestor_.start(store_, ingest);
+}
+
+void VectorService::shutdown() {
+    ingestor_.stop();
+    store_.close();
+}
+
+void VectorService::registerRoutes(HttpServer& server) {
+    server.post("/upsert", [this](const Params& params) { return handleUpsert(params); });
+    server.post("/embed", [this](const Params& params) { return handleEmbed(params); });
+    server.post("/query", [this](const Params& params) { return handleQuery(params); });
+    server.get("/query", [this](const Params& params) { return handleQuery(params); });
+    server.post("/documents/delete", [this](const Params& params) { return handleDelete(params); });
+    server.get("/index/stats", [this](const Params& params) { return handleStats(params); });
+    server.post("/index/compact", [this](const Params& params) { return handleCompact(params); });
+}
+
+std::string VectorService::handleUpsert(const Params& params) {
+    VectorRecord record;
+    record.id = param(params, "id");
+    if (record.id.empty() || !parseVector(param(params, "vector"), record.vector)) {
+        return error("id and vector required");
+    }
+
+    // Everything else is metadata, as in the Python service; text is kept as "document"
+    for (const auto& kv : params) {
+        if (kv.first == "id" || kv.first == "vector") {
+            continue;
+        }
+        record.metadata[kv.first == "text" ? "document" : kv.first] = kv.second;
+    }
+    if (!record.metadata.count("namespace")) {
+        record.metadata["namespace"] = "";
+    }
+
+    if (!store_.upsert(record)) {
+        return error("upsert failed");
+    }
+    return "{\"message\": \"Embedded 1 documents\", \"count\": 1, \"total_docs\": " +
+           std::to_string(store_.count()) + "}";
+}
+
+std::string VectorService::handleEmbed(const Params& params) {
+    // documents.<i>.{id,text,vector,url,title,metadata.<key>}, as the Python
+    // EmbedRequest flattened; without a vector the text is embedded natively
+    std::map<size_t, VectorRecord> documents;
+    for (const auto& kv : params) {
+        const std::string& key = kv.first;
+        if (key.compare(0, 10, "documents.") != 0) {
+            continue;
+        }
+        size_t dot = key.find('.', 10);
+        if (dot == std::string::npos || dot == 10 ||
+            key.find_first_not_of("0123456789", 10) != dot) {
+            return error("malformed document field " + key);
+        }
+        size_t index;
+        if (!parseParamIndex(std::string_view(key).substr(10, dot - 10), maxDocuments_, index)) {
+            return error("document index out of range in " + key.substr(0, 64));
+        }
+        VectorRecord& record = documents[index];
+        std::string field = key.substr(dot + 1);
+        if (field == "id") {
+            record.id = kv.second;
+        } else if (field == "text") {
+            record.metadata["document"] = kv.second;
+        } else if (field == "vector") {
+            if (!parseVector(kv.second, record.vector)) {
+                return error("malformed vector in " + key);
+            }
+        } else if (field == "url" || field == "title") {
+            record.metadata[field] = kv.second;
+        } else if (field.compare(0, 9, "metadata.") == 0 && field.size() > 9) {
+            record.metadata[field.substr(9)] = kv.second;
+        }
+    }
+    if (documents.empty()) {
+        return error("documents required");
+    }
+
+    std::string ns = param(params, "namespace");
+    std::vector<VectorRecord> records;
+    std::vector<size_t> unembedded;
+    std::vector<std::string> texts;
+    records.reserve(documents.size());
+    for (auto& kv : documents) {
+        if (!kv.second.metadata.count("document")) {
+            return error("text required for every document");
+        }
+        kv.second.metadata["namespace"] = ns;
+        if (kv.second.vector.empty()) {
+            unembedded.push_back(records.size());
+            texts.push_back(kv.second.metadata["document"]);
+        }
+        records.push_back(std::move(kv.second));
+    }
+    if (!texts.empty()) {
+        std::vector<std::vector<float>> vectors;
+        if (!embedder_ || !embedder_->embed(texts, vectors)) {
+            return error(embedder_ ? "embedding failed" : "vector required (no embedding model loaded)");
+        }
+        for (size_t i = 0; i < unembedded.size(); ++i) {
+            records[unembedded[i]].vector = std::move(vectors[i]);
+        }
+    }
+
+    size_t count = records.size();
+    uint64_t first = 0;
+    uint64_t token = ingestor_.submit(records, ns.empty() ? "" : ns + ":", &first);
+    if (token == 0) {
+        return error("every document needs a vector of dimension " + std::to_string(store_.options().dim));
+    }
+    if (param(params, "wait") == "true") {
+        if (!ingestor_.waitFor(token, 30000)) {
+            return error("timed out waiting for the batch to be applied");
+        }
+        if (ingestor_.lost(first, token)) {
+            return error("the batch could not be written to the store");
+        }
+    }
+    return "{\"message\": \"Embedded " + std::to_string(count) + " documents\", \"count\": " +
+           std::to_string(count) + ", \"total_docs\": " + std::to_string(store_.count()) +
+           ", \"token\": " + std::to_string(token) + "}";
+}
+
+std::string VectorService::handleQuery(const Params& params) {
+    std::vector<float> vector;
+    std::string queryText = param(params, "query_text");
+    if (!queryText.empty() && !params.count("vector") && embedder_) {
+        std::vector<std::vector<float>> vectors;
+        if (!embedder_->embed({queryText}, vectors)) {
+            return error("embedding failed");
+        }
+        vector = std::move(vectors[0]);
+    } else if (!parseVector(param(params, "vector"), vector)) {
+        return error("vector required");
+    }
+
+    // Read-your-writes: a token from /embed makes the query wait for that batch
+    uint64_t token = std::strtoull(param(params, "token", "0").c_str(), nullptr, 10);
+    if (token > 0 && !ingestor_.waitFor(token, 30000)) {
+        return error("timed out waiting for token " + std::to_string(token));
+    }
+    if (token > 0 && ingestor_.lost(token - 1, token)) {
+        return error("the batch of token " + std::to_string(token) + " could not be written to the store");
+    }
+    size_t k = static_cast<size_t>(std::max(1, std::atoi(param(params, "n_results", "5").c_str())));
+
+    // `namespace` plus chromadb-style equality conditions passed as where.<key>=<value>
+    MetadataFilter where;
+    if (!param(params, "namespace").empty()) {
+        where["namespace"] = param(params, "namespace");
+    }
+    for (const auto& kv : params) {
+        if (kv.first.compare(0, 6, "where.") == 0 && kv.first.size() > 6) {
+            where[kv.first.substr(6)] = kv.second;
+        }
+    }
+    std::vector<VectorQueryResult> results = store_.query(vector, k, where);
+
+    // Same nested-list shape as chromadb's collection.query()
+    std::string ids = "[[", distances = "[[", documents = "[[", metadatas = "[[";
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (i > 0) {
+            ids += ", ";
+            distances += ", ";
+            documents += ", ";
+            metadatas += ", ";
+        }
+        appendJsonString(ids, results[i].id);
+        appendJsonNumber(distances, results[i].distance);
+        auto doc = results[i].metadata.find("document");
+        appendJsonString(documents, doc != results[i].metadata.end() ? doc->second : "");
+        Metadata metadata = results[i].metadata;
+        metadata.erase("document");
+        appendMetadata(metadatas, metadata);
+    }
+    return "{\"ids\": " + ids + "]], \"distances\": " + distances + "]], \"documents\": " + documents +
+           "]], \"metadatas\": " + metadatas + "]]}";
+}
+
+std::string VectorService::handleDelete(const Params& params) {
+    std::string id = param(params, "id");
+    std::string ns = param(params, "namespace");
+    if (!id.empty()) {
+        size_t deleted = 0;
+        std::stringstream ids(id);
+        std::string one;
+        while (std::getline(ids, one, ',')) {
+            deleted += store_.remove(one) ? 1 : 0;
+        }
+        return "{\"deleted\": " + std::to_string(deleted) + "}";
+    }
+    if (!ns.empty()) {
+        std::string out = "{\"deleted\": " + std::to_string(store_.removeNamespace(ns)) + ", \"namespace\": ";
+        appendJsonString(out, ns);
+        return out + "}";
+    }
+    return error("id or namespace required");
+}
+
+std::string VectorService::handleStats(const Params&) {
+    VectorStoreStats s = store_.stats();
+    std::string out = "{\"documents\": " + std::to_string(store_.count());
+    out += ", \"generation\": " + std::to_string(s.generation);
+    out += ", \"segment_rows\": " + std::to_string(s.segmentRows);
+    out += ", \"segment_bytes\": " + std::to_string(s.segmentBytes);
+    out += ", \"delta_records\": " + std::to_string(s.deltaRecords);
+    out += ", \"code_bytes_per_vector\": " + std::to_string(s.codeBytesPerVector);
+    out += ", \"open_ms\": ";
+    appendJsonNumber(out, s.openMillis);
+    out += ", \"last_compaction_ms\": ";
+    appendJsonNumber(out, s.lastCompactionMillis);
+    out += ", \"compactions\": " + std::to_string(s.compactions);
+
+    IngestStats ingest = ingestor_.stats();
+    out += ", \"ingest\": {\"submitted\": " + std::to_string(ingest.submitted);
+    out += ", \"written\": " + std::to_string(ingest.written);
+    out += ", \"duplicates\": " + std::to_string(ingest.duplicates);
+    out += ", \"failed\": " + std::to_string(ingest.failed);
+    out += ", \"batches\": " + std::to_string(ingest.batches);
+    out += ", \"queued\": " + std::to_string(ingest.queued);
+    out += ", \"applied_token\": " + std::to_string(ingest.appliedToken) + "}}";
+    return out;
+}
+
+std::string VectorService::handleCompact(const Params&) {
+    bool ok = store_.compact();
+    return ok ? handleStats(Params()) : error("compaction failed");
+}
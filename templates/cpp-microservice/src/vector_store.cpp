@@ -0,0 +1,863 @@
+#include "vector_store.h"
+#include "checksum.h"
+#include "file_util.h"
+#include "flat_scan.h"
+#include "hash.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const uint8_t kLogUpsert = 1;
+const uint8_t kLogDelete = 2;
+const char kCurrentFile[] = "CURRENT";
+// Log records store the id length in a u16
+const size_t kMaxIdLength = 0xFFFF;
+
+// Query state for graph traversal over quantized codes
+struct CodeSearchContext {
+    const VectorQuantizer* quantizer;
+    const std::vector<float>* table;
+    const VectorSegment* segment;
+};
+
+float codeDistance(const void* context, uint32_t row) {
+    const CodeSearchContext* c = static_cast<const CodeSearchContext*>(context);
+    return c->quantizer->distance(*c->table, c->segment->code(row));
+}
+
+// Record: [u32 payload length][u32 crc32c][payload]
+// Payload: [u8 op][u16 id length][id][u32 dim][dim x f32][metadata]
+void encodeLogRecord(uint8_t op, const std::string& id, const std::vector<float>* vector, const Metadata* metadata,
+                     std::string& out) {
+    const size_t start = out.size();
+    out.append(8, '\0');
+    appendRaw<uint8_t>(out, op);
+    appendRaw<uint16_t>(out, static_cast<uint16_t>(id.size()));
+    out.append(id);
+    appendRaw<uint32_t>(out, vector ? static_cast<uint32_t>(vector->size()) : 0);
+    if (vector) {
+        out.append(reinterpret_cast<const char*>(vector->data()), vector->size() * sizeof(float));
+    }
+    if (metadata) {
+        encodeMetadata(*metadata, out);
+    }
+
+    uint32_t length = static_cast<uint32_t>(out.size() - start - 8);
+    uint32_t crc = crc32c(out.data() + start + 8, length);
+    std::memcpy(&out[start], &length, 4);
+    std::memcpy(&out[start + 4], &crc, 4);
+}
+
+// Logs and rejects records the log cannot hold or the store cannot index
+bool acceptable(const VectorRecord& record, size_t dim) {
+    if (!record.id.empty() && record.id.size() <= kMaxIdLength && record.vector.size() == dim) {
+        return true;
+    }
+    std::cerr << "Rejected upsert of '" << record.id.substr(0, 64) << "' (id of " << record.id.size()
+              << " bytes) with dim " << record.vector.size() << std::endl;
+    return false;
+}
+
+// Content fingerprint: the vector bytes seed a hash of the encoded metadata record
+uint64_t fingerprint(const float* vector, size_t dim, const void* metadata, size_t metadataSize) {
+    return hash64(metadata, metadataSize, hash64(vector, dim * sizeof(float)));
+}
+
+bool bitmapContains(const void* context, uint32_t row) {
+    return static_cast<const RoaringView*>(context)->contains(row);
+}
+
+bool rowListContains(const void* context, uint32_t row) {
+    const std::vector<uint32_t>* rows = static_cast<const std::vector<uint32_t>*>(context);
+    return std::binary_search(rows->begin(), rows->end(), row);
+}
+
+bool matchesFilter(const Metadata& metadata, const MetadataFilter& where) {
+    for (const auto& condition : where) {
+        auto it = metadata.find(condition.first);
+        if (it == metadata.end() || it->second != condition.second) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+VectorStore::VectorStore()
+    : logFd_(-1), logGeneration_(0), backgroundRunning_(false), compactionRequested_(false), openMillis_(0.0),
+      lastCompactionMillis_(0.0), compactions_(0) {}
+
+VectorStore::~VectorStore() {
+    close();
+}
+
+std::string VectorStore::segmentPath(uint64_t generation) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "segment-%08llu.dss", static_cast<unsigned long long>(generation));
+    return options_.directory + "/" + name;
+}
+
+std::string VectorStore::logPath(uint64_t generation) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "delta-%08llu.log", static_cast<unsigned long long>(generation));
+    return options_.directory + "/" + name;
+}
+
+bool VectorStore::open(const VectorStoreOptions& options) {
+    close();
+    options_ = options;
+    auto start = std::chrono::steady_clock::now();
+    pool_.reset(new ThreadPool(options_.searchThreads));
+
+    std::error_code ec;
+    fs::create_directories(options_.directory, ec);
+    if (ec) {
+        std::cerr << "Failed to create vector store directory " << options_.directory << ": " << ec.message()
+                  << std::endl;
+        return false;
+    }
+
+    // Map the live segment, if any
+    uint64_t segmentGeneration = 0;
+    std::string currentName;
+    std::ifstream current(options_.directory + "/" + kCurrentFile);
+    if (current && std::getline(current, currentName) && !currentName.empty()) {
+        if (!parseGeneration(currentName, "segment-", ".dss", segmentGeneration)) {
+            std::cerr << "Unrecognized CURRENT entry: " << currentName << std::endl;
+            return false;
+        }
+        auto segment = std::make_shared<VectorSegment>();
+        if (!segment->open(options_.directory + "/" + currentName)) {
+            return false;
+        }
+        if (segment->dim() != options_.dim || segment->metric() != options_.metric) {
+            std::cerr << "Vector segment " << currentName << " has dim " << segment->dim()
+                      << ", store is configured for " << options_.dim << std::endl;
+            return false;
+        }
+        segment_ = segment;
+    }
+
+    // Replay delta logs written since that segment; drop leftovers of older or failed compactions
+    std::vector<uint64_t> logs;
+    for (const fs::directory_entry& entry : fs::directory_iterator(options_.directory, ec)) {
+        std::string name = entry.path().filename().string();
+        uint64_t generation = 0;
+        if (parseGeneration(name, "delta-", ".log", generation)) {
+            if (generation >= segmentGeneration) {
+                logs.push_back(generation);
+            } else {
+                fs::remove(entry.path(), ec);
+            }
+        } else if ((parseGeneration(name, "segment-", ".dss", generation) && name != currentName) ||
+                   (name.size() > 4 && name.compare(name.size() - 4, 4, ".tmp") == 0)) {
+            fs::remove(entry.path(), ec);
+        }
+    }
+    std::sort(logs.begin(), logs.end());
+    for (uint64_t generation : logs) {
+        if (!replayLog(logPath(generation))) {
+            return false;
+        }
+    }
+
+    logGeneration_ = logs.empty() ? segmentGeneration : std::max(segmentGeneration, logs.back());
+    if (!openLog(logGeneration_)) {
+        return false;
+    }
+
+    openMillis_ = millisSince(start);
+    std::cout << "Vector store opened in " << openMillis_ << " ms: "
+              << (segment_ ? segment_->size() : 0) << " segment rows, " << active_.size() << " delta records"
+              << std::endl;
+    return true;
+}
+
+void VectorStore::close() {
+    stopBackgroundCompaction();
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (logFd_ >= 0) {
+        ::close(logFd_);
+        logFd_ = -1;
+    }
+    segment_.reset();
+    active_.clear();
+    frozen_.clear();
+}
+
+bool VectorStore::openLog(uint64_t generation) {
+    int fd = ::open(logPath(generation).c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to open delta log " << logPath(generation) << std::endl;
+        return false;
+    }
+    if (logFd_ >= 0) {
+        ::close(logFd_);
+    }
+    logFd_ = fd;
+    logGeneration_ = generation;
+    syncDirectory(options_.directory);
+    return true;
+}
+
+bool VectorStore::writeLog(const std::string& records) {
+    // A failed append is cut back off, or replay would stop at it and drop every record after
+    const off_t start = ::lseek(logFd_, 0, SEEK_END);
+    if (start < 0) {
+        std::cerr << "Delta log write failed" << std::endl;
+        return false;
+    }
+    if (writeAll(logFd_, records.data(), records.size(), -1) && (!options_.syncWrites || fdatasync(logFd_) == 0)) {
+        return true;
+    }
+    std::cerr << "Delta log write failed" << std::endl;
+    if (::ftruncate(logFd_, start) != 0) {
+        std::cerr << "Failed to roll back delta log " << logPath(logGeneration_) << std::endl;
+    }
+    return false;
+}
+
+bool VectorStore::replayLog(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    size_t pos = 0;
+    while (data.size() - pos >= 8) {
+        uint32_t length = readRaw<uint32_t>(data.data() + pos);
+        uint32_t crc = readRaw<uint32_t>(data.data() + pos + 4);
+        if (data.size() - pos - 8 < length || crc32c(data.data() + pos + 8, length) != crc || length < 7) {
+            break;
+        }
+
+        const char* p = data.data() + pos + 8;
+        const char* end = p + length;
+        uint8_t op = static_cast<uint8_t>(*p++);
+        uint16_t idLen = readRaw<uint16_t>(p);
+        p += 2;
+        if (end - p < static_cast<ptrdiff_t>(idLen) + 4) {
+            break;
+        }
+        std::string id(p, idLen);
+        p += idLen;
+        uint32_t dim = readRaw<uint32_t>(p);
+        p += 4;
+        if (end - p < static_cast<ptrdiff_t>(dim * sizeof(float))) {
+            break;
+        }
+        if (op == kLogUpsert && dim != options_.dim) {
+            // Written with another dim; compaction copies options_.dim floats from every vector
+            std::cerr << "Skipping delta record '" << id.substr(0, 64) << "' with dim " << dim << " in " << path
+                      << std::endl;
+            pos += 8 + length;
+            continue;
+        }
+
+        DeltaEntry entry;
+        entry.deleted = op == kLogDelete;
+        entry.fingerprint = 0;
+        if (op == kLogUpsert) {
+            entry.vector.resize(dim);
+            std::memcpy(entry.vector.data(), p, dim * sizeof(float));
+            p += dim * sizeof(float);
+            decodeMetadata(reinterpret_cast<const uint8_t*>(p), static_cast<size_t>(end - p), entry.metadata);
+            entry.fingerprint = fingerprint(entry.vector.data(), dim, p, static_cast<size_t>(end - p));
+        }
+        active_[id] = std::move(entry);
+        pos += 8 + length;
+    }
+
+    if (pos < data.size()) {
+        // Torn write at the tail from a crash; drop it so new records append cleanly
+        std::cerr << "Truncating delta log " << path << " at offset " << pos << std::endl;
+        if (truncate(path.c_str(), static_cast<off_t>(pos)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint64_t VectorStore::prepareRecord(VectorRecord& record) const {
+    if (options_.metric == DistanceMetric::Cosine) {
+        normalizeVector(record.vector.data(), record.vector.size());
+    }
+    std::string metadata;
+    encodeMetadata(record.metadata, metadata);
+    return fingerprint(record.vector.data(), record.vector.size(), metadata.data(), metadata.size());
+}
+
+bool VectorStore::upsert(const VectorRecord& record) {
+    if (!acceptable(record, options_.dim)) {
+        return false;
+    }
+
+    VectorRecord prepared(record);
+    uint64_t fp = prepareRecord(prepared);
+    DeltaEntry entry{std::move(prepared.vector), std::move(prepared.metadata), false, fp};
+    std::string log;
+    encodeLogRecord(kLogUpsert, record.id, &entry.vector, &entry.metadata, log);
+
+    size_t pending;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        if (!writeLog(log)) {
+            return false;
+        }
+        active_[record.id] = std::move(entry);
+        pending = active_.size();
+    }
+
+    if (pending >= options_.compactionThreshold) {
+        std::lock_guard<std::mutex> lock(backgroundMutex_);
+        compactionRequested_ = true;
+        backgroundCv_.notify_one();
+    }
+    return true;
+}
+
+bool VectorStore::upsertBatch(std::vector<VectorRecord>& records, const std::vector<uint64_t>& fingerprints,
+                              size_t* written) {
+    if (written) {
+        *written = 0;
+    }
+
+    // Drop records that would not change anything, then encode the rest outside the write lock
+    std::vector<size_t> changed;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        for (size_t i = 0; i < records.size(); ++i) {
+            uint64_t stored;
+            if (!acceptable(records[i], options_.dim)) {
+                continue;
+            }
+            if (!storedFingerprint(records[i].id, stored) || stored != fingerprints[i]) {
+                changed.push_back(i);
+            }
+        }
+    }
+    if (changed.empty()) {
+        return true;
+    }
+
+    std::string log;
+    log.reserve(changed.size() * (options_.dim * sizeof(float) + 256));
+    for (size_t i : changed) {
+        encodeLogRecord(kLogUpsert, records[i].id, &records[i].vector, &records[i].metadata, log);
+    }
+
+    size_t pending;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        if (!writeLog(log)) {
+            return false;
+        }
+        for (size_t i : changed) {
+            active_[records[i].id] =
+                DeltaEntry{std::move(records[i].vector), std::move(records[i].metadata), false, fingerprints[i]};
+        }
+        pending = active_.size();
+    }
+    if (written) {
+        *written = changed.size();
+    }
+
+    if (pending >= options_.compactionThreshold) {
+        std::lock_guard<std::mutex> lock(backgroundMutex_);
+        compactionRequested_ = true;
+        backgroundCv_.notify_one();
+    }
+    return true;
+}
+
+bool VectorStore::remove(const std::string& id) {
+    if (id.size() > kMaxIdLength) {
+        return false;
+    }
+    std::string log;
+    encodeLogRecord(kLogDelete, id, nullptr, nullptr, log);
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (!writeLog(log)) {
+        return false;
+    }
+    active_[id] = DeltaEntry{{}, {}, true, 0};
+    return true;
+}
+
+size_t VectorStore::removeNamespace(const std::string& ns) {
+    std::vector<std::string> ids;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        if (segment_) {
+            std::vector<uint32_t> rows;
+            RoaringView bitmap;
+            if (segment_->metadataBitmap("namespace", ns, bitmap)) {
+                bitmap.toArray(rows);
+            } else {
+                for (uint32_t row = 0; row < segment_->size(); ++row) {
+                    if (segment_->metadataValue(row, "namespace") == ns) {
+                        rows.push_back(row);
+                    }
+                }
+            }
+            for (uint32_t row : rows) {
+                std::string id(segment_->id(row));
+                if (!findDelta(id)) {
+                    ids.push_back(std::move(id));
+                }
+            }
+        }
+        for (const Delta* delta : {&active_, &frozen_}) {
+            for (const auto& kv : *delta) {
+                auto it = kv.second.metadata.find("namespace");
+                if (!kv.second.deleted && it != kv.second.metadata.end() && it->second == ns &&
+                    findDelta(kv.first) == &kv.second) {
+                    ids.push_back(kv.first);
+                }
+            }
+        }
+    }
+
+    size_t removed = 0;
+    for (const std::string& id : ids) {
+        removed += remove(id) ? 1 : 0;
+    }
+    return removed;
+}
+
+const VectorStore::DeltaEntry* VectorStore::findDelta(const std::string& id) const {
+    auto it = active_.find(id);
+    if (it != active_.end()) {
+        return &it->second;
+    }
+    it = frozen_.find(id);
+    return it != frozen_.end() ? &it->second : nullptr;
+}
+
+bool VectorStore::storedFingerprint(const std::string& id, uint64_t& fp) const {
+    const DeltaEntry* entry = findDelta(id);
+    if (entry) {
+        fp = entry->fingerprint;
+        return !entry->deleted;
+    }
+    uint32_t row = segment_ ? segment_->findRow(id) : kInvalidRow;
+    if (row == kInvalidRow) {
+        return false;
+    }
+    size_t length = 0;
+    const uint8_t* metadata = segment_->metadataRecord(row, &length);
+    fp = fingerprint(segment_->vector(row), segment_->dim(), metadata, length);
+    return true;
+}
+
+std::vector<VectorQueryResult> VectorStore::query(const std::vector<float>& vector, size_t k,
+                                                  const std::string& ns) const {
+    MetadataFilter where;
+    if (!ns.empty()) {
+        where["namespace"] = ns;
+    }
+    return query(vector, k, where);
+}
+
+std::vector<VectorQueryResult> VectorStore::query(const std::vector<float>& vector, size_t k,
+                                                  const MetadataFilter& where) const {
+    std::vector<VectorQueryResult> results;
+    if (vector.size() != options_.dim || k == 0) {
+        return results;
+    }
+
+    std::vector<float> q(vector);
+    if (options_.metric == DistanceMetric::Cosine) {
+        normalizeVector(q.data(), q.size());
+    }
+
+    struct Candidate {
+        float distance;
+        uint32_t row;                     // Segment row, or kInvalidRow for delta records
+        const std::string* id;            // Delta records only
+        const DeltaEntry* entry;          // Delta records only
+    };
+    std::vector<Candidate> candidates;
+
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    // Delta records are few (bounded by the compaction threshold), so scan them
+    for (const Delta* delta : {&active_, &frozen_}) {
+        for (const auto& kv : *delta) {
+            const DeltaEntry& entry = kv.second;
+            if (entry.deleted || findDelta(kv.first) != &entry || !matchesFilter(entry.metadata, where)) {
+                continue;
+            }
+            float d = vectorDistance(options_.metric, q.data(), entry.vector.data(), options_.dim);
+            candidates.push_back({d, kInvalidRow, &kv.first, &entry});
+        }
+    }
+
+    // Resolve indexed conditions to row bitmaps; the rest are checked per hit
+    std::vector<RoaringView> bitmaps;
+    bitmaps.reserve(where.size());
+    MetadataFilter residual;
+    bool noMatches = false;
+    if (segment_) {
+        for (const auto& condition : where) {
+            RoaringView bitmap;
+            if (segment_->metadataBitmap(condition.first, condition.second, bitmap)) {
+                noMatches = noMatches || bitmap.empty();
+                bitmaps.push_back(bitmap);
+            } else {
+                residual.insert(condition);
+            }
+        }
+    }
+
+    if (segment_ && segment_->size() > 0 && !noMatches) {
+        size_t matching = segment_->size();
+        std::vector<uint32_t> selected;
+        if (bitmaps.size() == 1) {
+            matching = bitmaps[0].cardinality();
+        } else if (bitmaps.size() > 1) {
+            std::vector<const RoaringView*> views;
+            for (const RoaringView& bitmap : bitmaps) {
+                views.push_back(&bitmap);
+            }
+            selected = RoaringView::intersect(views);
+            matching = selected.size();
+        }
+
+        // Few matching rows (a small namespace, a single url): an exact scan of
+        // just those rows beats walking the graph past everything filtered out
+        const bool flat = matching <= options_.flatScanThreshold;
+        const uint32_t* rows = nullptr;
+        RowFilterFn filter = nullptr;
+        const void* filterContext = nullptr;
+        if (flat && bitmaps.size() == 1) {
+            bitmaps[0].toArray(selected);
+        }
+        if (flat && !bitmaps.empty()) {
+            rows = selected.data();
+        } else if (bitmaps.size() == 1) {
+            filter = bitmapContains;
+            filterContext = &bitmaps[0];
+        } else if (bitmaps.size() > 1) {
+            filter = rowListContains;
+            filterContext = &selected;
+        }
+
+        const bool masking = !active_.empty() || !frozen_.empty();
+        const size_t limit = matching;
+        size_t fetch = std::min(k, limit);
+        std::vector<Candidate> fromSegment;
+        while (fetch > 0) {
+            fromSegment.clear();
+            std::vector<SearchHit> hits =
+                flat ? flatSearch(segment_->metric(), segment_->vectors(), segment_->dim(), q.data(), rows, matching,
+                                  fetch, pool_.get())
+                     : searchSegment(*segment_, q.data(), fetch, filter, filterContext);
+            for (const SearchHit& hit : hits) {
+                if (masking && findDelta(std::string(segment_->id(hit.row)))) {
+                    continue;
+                }
+                bool matches = true;
+                for (const auto& condition : residual) {
+                    if (segment_->metadataValue(hit.row, condition.first) != condition.second) {
+                        matches = false;
+                        break;
+                    }
+                }
+                if (matches) {
+                    fromSegment.push_back({hit.distance, hit.row, nullptr, nullptr});
+                }
+            }
+            // Masked or residual-filtered hits leave gaps; widen the search until k survive
+            if (fromSegment.size() >= k || hits.size() < fetch || fetch >= limit) {
+                break;
+            }
+            fetch = std::min(fetch * 4, limit);
+        }
+        candidates.insert(candidates.end(), fromSegment.begin(), fromSegment.end());
+    }
+
+    size_t n = std::min(k, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + n, candidates.end(),
+                      [](const Candidate& a, const Candidate& b) { return a.distance < b.distance; });
+
+    results.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        const Candidate& c = candidates[i];
+        if (c.row != kInvalidRow) {
+            results.push_back({std::string(segment_->id(c.row)), c.distance, segment_->metadata(c.row)});
+        } else {
+            results.push_back({*c.id, c.distance, c.entry->metadata});
+        }
+    }
+    return results;
+}
+
+std::vector<SearchHit> VectorStore::searchSegment(const VectorSegment& segment, const float* query, size_t k,
+                                                 RowFilterFn filter, const void* filterContext) const {
+    const VectorQuantizer* quantizer = segment.quantizer();
+    if (!quantizer) {
+        return hnswSearch(segment.graph(), segment.metric(), segment.vectors(), segment.dim(), query, k,
+                          std::max(options_.efSearch, k), filter, filterContext);
+    }
+
+    // Traverse the graph over the compact codes, then re-score a short list with the float vectors
+    std::vector<float> table;
+    quantizer->prepareQuery(query, table);
+    CodeSearchContext context{quantizer, &table, &segment};
+    size_t fetch = k * std::max<size_t>(1, options_.rerankFactor);
+    std::vector<SearchHit> hits =
+        hnswSearch(segment.graph(), codeDistance, &context, fetch, std::max(options_.efSearch, fetch), filter,
+                   filterContext);
+    if (options_.rerankFactor == 0) {
+        return hits;
+    }
+
+    for (SearchHit& hit : hits) {
+        hit.distance = vectorDistance(segment.metric(), query, segment.vector(hit.row), segment.dim());
+    }
+    size_t n = std::min(k, hits.size());
+    std::partial_sort(hits.begin(), hits.begin() + n, hits.end(),
+                      [](const SearchHit& a, const SearchHit& b) { return a.distance < b.distance; });
+    hits.resize(n);
+    return hits;
+}
+
+bool VectorStore::encodeSegment(const VectorSegment* base, const std::vector<uint32_t>& remap, uint32_t survivors,
+                                const float* vectors, uint32_t total, VectorSegmentWriter& writer) const {
+    if (options_.quantization == QuantizerType::None || total == 0) {
+        return true;
+    }
+
+    std::unique_ptr<VectorQuantizer> fresh =
+        VectorQuantizer::create(options_.quantization, options_.metric, options_.dim, options_.pqSubspaces);
+    if (!fresh) {
+        return false;
+    }
+
+    // Keep the previous codebook while most rows were encoded with it, so that
+    // compaction only encodes new rows; retrain once the data has moved on
+    const VectorQuantizer* previous = base ? base->quantizer() : nullptr;
+    const bool reuse = previous && previous->type() == fresh->type() && previous->codeSize() == fresh->codeSize() &&
+                       static_cast<uint64_t>(survivors) * 2 >= total;
+    if (!reuse && !fresh->train(vectors, total)) {
+        return false;
+    }
+    const VectorQuantizer& quantizer = reuse ? *previous : *fresh;
+
+    const size_t codeSize = quantizer.codeSize();
+    std::vector<uint8_t> codes(static_cast<size_t>(total) * codeSize);
+    uint32_t first = 0;
+    if (reuse) {
+        for (uint32_t row = 0; row < base->size(); ++row) {
+            if (remap[row] != kInvalidRow) {
+                std::memcpy(codes.data() + static_cast<size_t>(remap[row]) * codeSize, base->code(row), codeSize);
+            }
+        }
+        first = survivors;
+    }
+    for (uint32_t row = first; row < total; ++row) {
+        quantizer.encode(vectors + static_cast<size_t>(row) * options_.dim, codes.data() + row * codeSize);
+    }
+    writer.setQuantization(quantizer, std::move(codes));
+    return true;
+}
+
+bool VectorStore::compact() {
+    std::lock_guard<std::mutex> guard(compactMutex_);
+    auto start = std::chrono::steady_clock::now();
+
+    std::shared_ptr<const VectorSegment> base;
+    uint64_t generation;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        if (active_.empty()) {
+            return true;
+        }
+        // New writes go to the next log; the frozen delta stays readable until the swap
+        generation = logGeneration_ + 1;
+        if (!openLog(generation)) {
+            return false;
+        }
+        frozen_.swap(active_);
+        base = segment_;
+    }
+
+    // Only this thread mutates frozen_ from here on, so it can be read without the lock
+    const uint32_t dim = options_.dim;
+    std::vector<uint32_t> remap;
+    uint32_t survivors = 0;
+    if (base) {
+        remap.assign(base->size(), kInvalidRow);
+        for (uint32_t row = 0; row < base->size(); ++row) {
+            if (frozen_.find(std::string(base->id(row))) == frozen_.end()) {
+                remap[row] = survivors++;
+            }
+        }
+    }
+
+    std::vector<const Delta::value_type*> added;
+    for (const Delta::value_type& kv : frozen_) {
+        if (!kv.second.deleted) {
+            added.push_back(&kv);
+        }
+    }
+
+    const uint32_t total = survivors + static_cast<uint32_t>(added.size());
+    const std::string path = segmentPath(generation);
+    auto next = std::make_shared<VectorSegment>();
+    bool ok;
+    {
+        VectorSegmentWriter writer(path, dim, options_.metric, generation);
+        writer.setIndexedKeys(options_.indexedMetadataKeys);
+        ok = writer.begin(total);
+        if (ok) {
+            float* vectors = writer.vectors();
+            if (base) {
+                for (uint32_t row = 0; row < base->size(); ++row) {
+                    if (remap[row] == kInvalidRow) {
+                        continue;
+                    }
+                    std::memcpy(vectors + static_cast<size_t>(remap[row]) * dim, base->vector(row),
+                                dim * sizeof(float));
+                    size_t length = 0;
+                    const uint8_t* metadata = base->metadataRecord(row, &length);
+                    writer.addEncodedRecord(base->id(row), metadata, length);
+                }
+            }
+            for (size_t i = 0; i < added.size(); ++i) {
+                std::memcpy(vectors + (survivors + i) * dim, added[i]->second.vector.data(), dim * sizeof(float));
+                writer.addRecord(added[i]->first, added[i]->second.metadata);
+            }
+
+            // Surviving rows keep their links; only new rows are inserted
+            HnswBuilder builder(options_.metric, dim, vectors, options_.hnsw);
+            builder.reserve(total);
+            if (base && survivors > 0) {
+                builder.seed(base->graph(), remap);
+            }
+            for (uint32_t row = survivors; row < total; ++row) {
+                builder.add(row);
+            }
+            ok = encodeSegment(base.get(), remap, survivors, vectors, total, writer) && writer.finish(builder);
+        }
+    }
+
+    const std::string name = path.substr(path.find_last_of('/') + 1);
+    ok = ok && next->open(path) && writeFileAtomic(options_.directory + "/" + kCurrentFile, name + "\n");
+    if (!ok) {
+        std::cerr << "Vector store compaction to generation " << generation << " failed" << std::endl;
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        // Newer writes in active_ win; the frozen records are still in their logs
+        for (Delta::value_type& kv : frozen_) {
+            active_.emplace(kv.first, std::move(kv.second));
+        }
+        frozen_.clear();
+        return false;
+    }
+
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        segment_ = next;
+        frozen_.clear();
+    }
+
+    // Readers still holding the old segment keep their mapping until they finish
+    std::error_code ec;
+    if (base) {
+        fs::remove(base->path(), ec);
+    }
+    for (const fs::directory_entry& entry : fs::directory_iterator(options_.directory, ec)) {
+        uint64_t logGen = 0;
+        if (parseGeneration(entry.path().filename().string(), "delta-", ".log", logGen) && logGen < generation) {
+            fs::remove(entry.path(), ec);
+        }
+    }
+
+    lastCompactionMillis_ = millisSince(start);
+    ++compactions_;
+    std::cout << "Compacted vector store to generation " << generation << " (" << total << " rows) in "
+              << lastCompactionMillis_.load() << " ms" << std::endl;
+    return true;
+}
+
+void VectorStore::startBackgroundCompaction() {
+    std::lock_guard<std::mutex> lock(backgroundMutex_);
+    if (backgroundRunning_) {
+        return;
+    }
+    backgroundRunning_ = true;
+    backgroundThread_ = std::thread(&VectorStore::backgroundLoop, this);
+}
+
+void VectorStore::stopBackgroundCompaction() {
+    {
+        std::lock_guard<std::mutex> lock(backgroundMutex_);
+        if (!backgroundRunning_) {
+            return;
+        }
+        backgroundRunning_ = false;
+        backgroundCv_.notify_one();
+    }
+    if (backgroundThread_.joinable()) {
+        backgroundThread_.join();
+    }
+}
+
+void VectorStore::backgroundLoop() {
+    std::unique_lock<std::mutex> lock(backgroundMutex_);
+    while (backgroundRunning_) {
+        backgroundCv_.wait_for(lock, std::chrono::seconds(options_.compactionIntervalSeconds),
+                               [this] { return !backgroundRunning_ || compactionRequested_; });
+        if (!backgroundRunning_) {
+            break;
+        }
+        compactionRequested_ = false;
+        lock.unlock();
+        compact();
+        lock.lock();
+    }
+}
+
+size_t VectorStore::count() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    size_t total = segment_ ? segment_->size() : 0;
+    for (const Delta* delta : {&active_, &frozen_}) {
+        for (const auto& kv : *delta) {
+            if (findDelta(kv.first) != &kv.second) {
+                continue;
+            }
+            bool inSegment = segment_ && segment_->findRow(kv.first) != kInvalidRow;
+            if (kv.second.deleted && inSegment) {
+                --total;
+            } else if (!kv.second.deleted && !inSegment) {
+                ++total;
+            }
+        }
+    }
+    return total;
+}
+
+VectorStoreStats VectorStore::stats() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    VectorStoreStats s;
+    s.generation = segment_ ? segment_->generation() : 0;
+    s.segmentRows = segment_ ? segment_->size() : 0;
+    s.segmentBytes = segment_ ? segment_->fileSize() : 0;
+    s.deltaRecords = active_.size() + frozen_.size();
+    s.codeBytesPerVector = segment_ && segment_->quantizer() ? segment_->quantizer()->codeSize() : 0;
+    s.openMillis = openMillis_;
+    s.lastCompactionMillis = lastCompactionMillis_.load();
+    s.compactions = compactions_.load();
+    return s;
+}
@@ -0,0 +1,198 @@
+#include "word_splitter.h"
+#include "unicode_util.h"
+#include <cstring>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+enum AsciiClass : uint8_t { kWordByte, kSpace, kPunct, kDrop };
+
+// ASCII classes derived from the Unicode predicates, so both paths agree
+struct AsciiTable {
+    uint8_t classes[128];
+
+    AsciiTable() {
+        for (uint32_t c = 0; c < 128; ++c) {
+            if (c == 0 || isUnicodeControl(c)) {
+                classes[c] = kDrop;
+            } else if (isUnicodeWhitespace(c)) {
+                classes[c] = kSpace;
+            } else if (isUnicodePunctuation(c)) {
+                classes[c] = kPunct;
+            } else {
+                classes[c] = kWordByte;
+            }
+        }
+    }
+};
+
+const AsciiTable kAscii;
+
+// Scans a run of ASCII word bytes, writing them lower-cased to out while
+// they fit in room bytes; returns the run length
+typedef size_t (*AsciiRunKernel)(const char* p, const char* end, char* out, size_t room);
+
+size_t scalarAsciiRun(const char* p, const char* end, char* out, size_t room) {
+    size_t run = 0;
+    while (p + run < end) {
+        const unsigned char c = static_cast<unsigned char>(p[run]);
+        if (c >= 0x80 || kAscii.classes[c] != kWordByte) {
+            break;
+        }
+        if (run < room) {
+            out[run] = static_cast<char>(c >= 'A' && c <= 'Z' ? c + 32 : c);
+        }
+        ++run;
+    }
+    return run;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// Letters and digits are the only ASCII word bytes; bytes >= 0x80 are
+// negative as signed and fail both range tests
+__attribute__((target("avx2,bmi"))) size_t avx2AsciiRun(const char* p, const char* end, char* out, size_t room) {
+    const __m256i caseBit = _mm256_set1_epi8(0x20);
+    size_t run = 0;
+    while (end - (p + run) >= 32) {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + run));
+        __m256i folded = _mm256_or_si256(bytes, caseBit);
+        __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(folded, _mm256_set1_epi8('a' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), folded));
+        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, _mm256_set1_epi8('0' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), bytes));
+        const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(alpha, digit)));
+        if (run + 32 <= room) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + run), _mm256_blendv_epi8(bytes, folded, alpha));
+        }
+        if (mask != 0xFFFFFFFFu) {
+            return run + _tzcnt_u32(~mask);
+        }
+        run += 32;
+    }
+    return run + scalarAsciiRun(p + run, end, out + run, run < room ? room - run : 0);
+}
+
+bool hasAvx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi");
+}
+
+const AsciiRunKernel kAsciiRun = hasAvx2() ? avx2AsciiRun : scalarAsciiRun;
+
+#else
+
+const AsciiRunKernel kAsciiRun = scalarAsciiRun;
+
+#endif
+
+} // namespace
+
+WordSplitter::WordSplitter(std::string_view text)
+    : p_(text.data()), end_(text.data() + text.size()), size_(0), chars_(0), start_(p_), stop_(p_), pendingSize_(0),
+      pendingStart_(p_) {}
+
+void WordSplitter::append(uint32_t cp) {
+    if (++chars_ <= kMaxWordChars) {
+        size_ += encodeUtf8(cp, buffer_ + size_);
+    }
+}
+
+void WordSplitter::appendAsciiRun() {
+    if (chars_ == 0) {
+        start_ = p_;
+    }
+    const size_t room = chars_ <= kMaxWordChars ? sizeof(buffer_) - size_ : 0;
+    size_t run = kAsciiRun(p_, end_, buffer_ + size_, room);
+    if (run == 0) {
+        // A word byte the SIMD ranges do not cover; the table has the final say
+        run = scalarAsciiRun(p_, end_, buffer_ + size_, room);
+    }
+    p_ += run;
+    stop_ = p_;
+    chars_ += run;
+    if (chars_ <= kMaxWordChars) {
+        size_ += run;
+    }
+}
+
+bool WordSplitter::next(std::string_view& word) {
+    size_ = 0;
+    chars_ = 0;
+    auto emit = [&] {
+        word = overlong() ? std::string_view() : std::string_view(buffer_, size_);
+        return true;
+    };
+    if (pendingSize_ > 0) {
+        std::memcpy(buffer_, pending_, pendingSize_);
+        size_ = pendingSize_;
+        chars_ = 1;
+        pendingSize_ = 0;
+        start_ = pendingStart_;
+        stop_ = p_;
+        return emit();
+    }
+
+    while (p_ < end_) {
+        const char* at = p_;
+        const unsigned char c = static_cast<unsigned char>(*p_);
+        uint32_t cp;
+        if (c < 0x80) {
+            switch (kAscii.classes[c]) {
+            case kWordByte:
+                appendAsciiRun();
+                continue;
+            case kDrop:
+                ++p_;
+                continue;
+            case kSpace:
+                ++p_;
+                if (chars_ > 0) {
+                    return emit();
+                }
+                continue;
+            default:
+                ++p_;
+                cp = c;
+                break;
+            }
+        } else {
+            cp = decodeUtf8(p_, end_);
+            if (cp == 0xFFFD || isUnicodeControl(cp)) {
+                continue;
+            }
+            if (isUnicodeWhitespace(cp)) {
+                if (chars_ > 0) {
+                    return emit();
+                }
+                continue;
+            }
+            cp = stripAccent(toLowerCodePoint(cp));
+            if (isCombiningMark(cp)) {
+                stop_ = chars_ > 0 ? p_ : stop_;
+                continue;
+            }
+            if (!isCjkIdeograph(cp) && !isUnicodePunctuation(cp)) {
+                start_ = chars_ > 0 ? start_ : at;
+                stop_ = p_;
+                append(cp);
+                continue;
+            }
+        }
+
+        // Punctuation and CJK ideographs stand alone, after any word in progress
+        if (chars_ > 0) {
+            pendingSize_ = encodeUtf8(cp, pending_);
+            pendingStart_ = at;
+            return emit();
+        }
+        size_ = encodeUtf8(cp, buffer_);
+        chars_ = 1;
+        start_ = at;
+        stop_ = p_;
+        return emit();
+    }
+    return chars_ > 0 ? emit() : false;
+}
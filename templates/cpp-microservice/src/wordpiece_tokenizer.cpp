@@ -0,0 +1,125 @@
+#include "wordpiece_tokenizer.h"
+#include "word_splitter.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const char kUnknown[] = "[UNK]";
+
+} // namespace
+
+WordPieceTokenizer::WordPieceTokenizer() : continuationNode_(-1), unknownId_(-1), clsId_(-1), sepId_(-1) {}
+
+bool WordPieceTokenizer::load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Failed to open vocabulary " << path << std::endl;
+        return false;
+    }
+    std::vector<std::string> tokens;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        tokens.push_back(line);
+    }
+    return setVocabulary(tokens);
+}
+
+bool WordPieceTokenizer::setVocabulary(const std::vector<std::string>& tokens) {
+    tokens_ = tokens;
+    std::vector<int32_t> ids(tokens.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        ids[i] = static_cast<int32_t>(i);
+    }
+    trie_.build(tokens_, ids);
+    continuationNode_ = DoubleArrayTrie::kRoot;
+    if (!trie_.step(continuationNode_, '#') || !trie_.step(continuationNode_, '#')) {
+        continuationNode_ = -1;
+    }
+
+    unknownId_ = tokenId(kUnknown);
+    clsId_ = tokenId("[CLS]");
+    sepId_ = tokenId("[SEP]");
+    if (unknownId_ < 0 || clsId_ < 0 || sepId_ < 0) {
+        std::cerr << "Vocabulary is missing [UNK], [CLS] or [SEP]" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int32_t WordPieceTokenizer::tokenId(std::string_view token) const {
+    return trie_.find(token.data(), token.size());
+}
+
+size_t WordPieceTokenizer::wordPiece(std::string_view word, int32_t* ids) const {
+    size_t count = 0;
+    size_t start = 0;
+    while (start < word.size()) {
+        // Walk as far as the trie allows, remembering the longest match ending on a character boundary
+        int32_t node = start == 0 ? DoubleArrayTrie::kRoot : continuationNode_;
+        int32_t matchId = -1;
+        size_t matchEnd = start;
+        for (size_t i = start; node >= 0 && i < word.size();) {
+            if (!trie_.step(node, static_cast<uint8_t>(word[i]))) {
+                break;
+            }
+            ++i;
+            const bool boundary = i == word.size() || (static_cast<uint8_t>(word[i]) & 0xC0) != 0x80;
+            if (boundary && trie_.value(node) >= 0) {
+                matchId = trie_.value(node);
+                matchEnd = i;
+            }
+        }
+        if (matchId < 0) {
+            ids[0] = unknownId_;
+            return 1;
+        }
+        ids[count++] = matchId;
+        start = matchEnd;
+    }
+    return count;
+}
+
+size_t WordPieceTokenizer::encode(std::string_view text, int32_t* ids, size_t capacity) const {
+    // A word has at most kMaxWordChars pieces, so it is split on the stack and then copied
+    int32_t pieces[WordSplitter::kMaxWordChars];
+    WordSplitter splitter(text);
+    std::string_view word;
+    size_t count = 0;
+    while (count < capacity && splitter.next(word)) {
+        size_t n = 1;
+        if (splitter.overlong()) {
+            pieces[0] = unknownId_;
+        } else {
+            n = wordPiece(word, pieces);
+        }
+        n = std::min(n, capacity - count);
+        std::memcpy(ids + count, pieces, n * sizeof(int32_t));
+        count += n;
+    }
+    return count;
+}
+
+void WordPieceTokenizer::tokenize(std::string_view text, std::vector<std::string>& pieces) const {
+    pieces.clear();
+    // Every piece consumes at least one byte of input
+    std::vector<int32_t> ids(text.size());
+    ids.resize(encode(text, ids.data(), ids.size()));
+    for (int32_t id : ids) {
+        pieces.push_back(tokens_[id]);
+    }
+}
+
+void WordPieceTokenizer::encode(std::string_view text, size_t maxLength, std::vector<int32_t>& ids) const {
+    maxLength = std::max<size_t>(maxLength, 2);
+    ids.resize(maxLength);
+    ids[0] = clsId_;
+    const size_t count = encode(text, ids.data() + 1, maxLength - 2);
+    ids[count + 1] = sepId_;
+    ids.resize(count + 2);
+}
@@ -0,0 +1,353 @@
+#include "xml_reader.h"
+#include "unicode_util.h"
+#include <cstring>
+
+namespace {
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool startsWith(std::string_view text, size_t pos, std::string_view prefix) {
+    return text.size() - pos >= prefix.size() && text.compare(pos, prefix.size(), prefix) == 0;
+}
+
+std::string_view localName(std::string_view name) {
+    const size_t colon = name.find(':');
+    return colon == std::string_view::npos ? name : name.substr(colon + 1);
+}
+
+// Decodes an entity name (without & and ;); false when unknown or out of range
+bool decodeEntity(std::string_view name, uint32_t& cp) {
+    if (name.size() >= 2 && name[0] == '#') {
+        const bool hex = name[1] == 'x';
+        const size_t first = hex ? 2 : 1;
+        if (first == name.size() || name.size() - first > 8) {
+            return false;
+        }
+        cp = 0;
+        for (size_t i = first; i < name.size(); ++i) {
+            const char c = name[i];
+            uint32_t digit;
+            if (c >= '0' && c <= '9') {
+                digit = c - '0';
+            } else if (hex && (c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+                digit = (c | 0x20) - 'a' + 10;
+            } else {
+                return false;
+            }
+            cp = cp * (hex ? 16 : 10) + digit;
+        }
+        return cp > 0 && cp <= 0x10FFFF && (cp < 0xD800 || cp > 0xDFFF);
+    }
+    static const struct {
+        const char* name;
+        char value;
+    } kEntities[] = {{"lt", '<'}, {"gt", '>'}, {"amp", '&'}, {"quot", '"'}, {"apos", '\''}};
+    for (const auto& entity : kEntities) {
+        if (name == entity.name) {
+            cp = static_cast<unsigned char>(entity.value);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Appends text with whitespace runs collapsed; a run is written only once
+// something follows it
+class CollapsedText {
+public:
+    explicit CollapsedText(std::string& out) : out_(out), space_(false) {}
+
+    void space() { space_ = true; }
+
+    void put(char c) {
+        if (isSpace(c)) {
+            space_ = true;
+            return;
+        }
+        flushSpace();
+        out_.push_back(c);
+    }
+
+    void put(uint32_t cp) {
+        flushSpace();
+        appendUtf8(cp, out_);
+    }
+
+private:
+    std::string& out_;
+    bool space_;
+
+    void flushSpace() {
+        if (space_ && !out_.empty()) {
+            out_.push_back(' ');
+        }
+        space_ = false;
+    }
+};
+
+// Whether raw can be shown as is: no markup or entities, no whitespace but
+// single spaces between words
+bool isPlainText(std::string_view raw) {
+    if (raw.empty()) {
+        return true;
+    }
+    if (raw.front() == ' ' || raw.back() == ' ') {
+        return false;
+    }
+    char previous = 0;
+    for (char c : raw) {
+        if (c == '<' || c == '&' || c == '\t' || c == '\n' || c == '\r' || (c == ' ' && previous == ' ')) {
+            return false;
+        }
+        previous = c;
+    }
+    return true;
+}
+
+} // namespace
+
+XmlReader::XmlReader(std::string_view xml)
+    : xml_(xml), pos_(0), tagStart_(0), depth_(0), cdata_(false), pendingEnd_(false), error_("") {}
+
+XmlToken XmlReader::fail(const char* message) {
+    error_ = message;
+    pos_ = xml_.size();
+    return XmlToken::Error;
+}
+
+bool XmlReader::skipPast(std::string_view terminator) {
+    const size_t end = xml_.find(terminator, pos_);
+    if (end == std::string_view::npos) {
+        return false;
+    }
+    pos_ = end + terminator.size();
+    return true;
+}
+
+bool XmlReader::skipDoctype() {
+    // <!DOCTYPE root PUBLIC "..." "..." [ internal subset ]>
+    for (size_t i = pos_; i < xml_.size(); ++i) {
+        const char c = xml_[i];
+        if (c == '"' || c == '\'') {
+            i = xml_.find(c, i + 1);
+            if (i == std::string_view::npos) {
+                return false;
+            }
+        } else if (c == '[') {
+            i = xml_.find(']', i + 1);
+            if (i == std::string_view::npos) {
+                return false;
+            }
+        } else if (c == '>') {
+            pos_ = i + 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+XmlToken XmlReader::next() {
+    if (*error_) {
+        return XmlToken::Error;
+    }
+    if (pendingEnd_) {
+        pendingEnd_ = false;
+        --depth_;
+        return XmlToken::EndTag;
+    }
+    const char* data = xml_.data();
+    const size_t size = xml_.size();
+    while (pos_ < size) {
+        if (data[pos_] != '<') {
+            const void* lt = std::memchr(data + pos_, '<', size - pos_);
+            const size_t end = lt ? static_cast<size_t>(static_cast<const char*>(lt) - data) : size;
+            const size_t start = pos_;
+            pos_ = end;
+            if (depth_ > 0) {
+                text_ = xml_.substr(start, end - start);
+                cdata_ = false;
+                return XmlToken::Text;
+            }
+            continue;
+        }
+
+        tagStart_ = pos_;
+        if (startsWith(xml_, pos_, "<!--")) {
+            if (!skipPast("-->")) {
+                return fail("unterminated comment");
+            }
+            continue;
+        }
+        if (startsWith(xml_, pos_, "<![CDATA[")) {
+            const size_t start = pos_ + 9;
+            pos_ = start;
+            if (!skipPast("]]>")) {
+                return fail("unterminated CDATA section");
+            }
+            if (depth_ == 0) {
+                return fail("text outside the root element");
+            }
+            text_ = xml_.substr(start, pos_ - 3 - start);
+            cdata_ = true;
+            return XmlToken::Text;
+        }
+        if (startsWith(xml_, pos_, "<?")) {
+            if (!skipPast("?>")) {
+                return fail("unterminated processing instruction");
+            }
+            continue;
+        }
+        if (startsWith(xml_, pos_, "<!")) {
+            if (!skipDoctype()) {
+                return fail("unterminated declaration");
+            }
+            continue;
+        }
+
+        const bool end = pos_ + 1 < size && data[pos_ + 1] == '/';
+        size_t nameStart = pos_ + (end ? 2 : 1);
+        size_t nameEnd = nameStart;
+        while (nameEnd < size && !isSpace(data[nameEnd]) && data[nameEnd] != '/' && data[nameEnd] != '>') {
+            ++nameEnd;
+        }
+        if (nameEnd == nameStart) {
+            return fail("expected a tag name");
+        }
+        name_ = localName(xml_.substr(nameStart, nameEnd - nameStart));
+
+        if (end) {
+            const void* gt = std::memchr(data + nameEnd, '>', size - nameEnd);
+            if (!gt) {
+                return fail("unterminated tag");
+            }
+            if (depth_ == 0) {
+                return fail("end tag without a start tag");
+            }
+            pos_ = static_cast<size_t>(static_cast<const char*>(gt) - data) + 1;
+            --depth_;
+            return XmlToken::EndTag;
+        }
+
+        // Find the closing '>' or '/>', stepping over quoted attribute values
+        size_t i = nameEnd;
+        bool selfClosing = false;
+        while (true) {
+            if (i >= size) {
+                return fail("unterminated tag");
+            }
+            const char c = data[i];
+            if (c == '>') {
+                break;
+            }
+            if (c == '/' && i + 1 < size && data[i + 1] == '>') {
+                selfClosing = true;
+                break;
+            }
+            if (c == '"' || c == '\'') {
+                const void* quote = std::memchr(data + i + 1, c, size - i - 1);
+                if (!quote) {
+                    return fail("unterminated attribute value");
+                }
+                i = static_cast<size_t>(static_cast<const char*>(quote) - data);
+            }
+            ++i;
+        }
+        attributes_ = xml_.substr(nameEnd, i - nameEnd);
+        pos_ = i + (selfClosing ? 2 : 1);
+        ++depth_;
+        pendingEnd_ = selfClosing;
+        return XmlToken::StartTag;
+    }
+    if (depth_ > 0) {
+        return fail("unexpected end of document");
+    }
+    return XmlToken::End;
+}
+
+bool XmlReader::attribute(std::string_view name, std::string_view& value) const {
+    const std::string_view s = attributes_;
+    size_t i = 0;
+    while (true) {
+        while (i < s.size() && isSpace(s[i])) {
+            ++i;
+        }
+        if (i == s.size()) {
+            return false;
+        }
+        const size_t nameStart = i;
+        while (i < s.size() && s[i] != '=' && !isSpace(s[i])) {
+            ++i;
+        }
+        const std::string_view attribute = s.substr(nameStart, i - nameStart);
+        while (i < s.size() && isSpace(s[i])) {
+            ++i;
+        }
+        if (i == s.size() || s[i] != '=') {
+            return false;
+        }
+        ++i;
+        while (i < s.size() && isSpace(s[i])) {
+            ++i;
+        }
+        if (i == s.size() || (s[i] != '"' && s[i] != '\'')) {
+            return false;
+        }
+        const size_t close = s.find(s[i], i + 1);
+        if (close == std::string_view::npos) {
+            return false;
+        }
+        if (attribute == name) {
+            value = s.substr(i + 1, close - i - 1);
+            return true;
+        }
+        i = close + 1;
+    }
+}
+
+std::string_view decodeXmlText(std::string_view raw, std::string& scratch) {
+    if (isPlainText(raw)) {
+        return raw;
+    }
+    scratch.clear();
+    CollapsedText out(scratch);
+    size_t i = 0;
+    while (i < raw.size()) {
+        const char c = raw[i];
+        if (c == '<') {
+            if (startsWith(raw, i, "<![CDATA[")) {
+                size_t end = raw.find("]]>", i + 9);
+                end = end == std::string_view::npos ? raw.size() : end;
+                for (size_t j = i + 9; j < end; ++j) {
+                    out.put(raw[j]);
+                }
+                i = end + 3;
+                continue;
+            }
+            const bool comment = startsWith(raw, i, "<!--");
+            const size_t end = comment ? raw.find("-->", i + 4) : raw.find('>', i + 1);
+            if (end == std::string_view::npos) {
+                break;
+            }
+            i = end + (comment ? 3 : 1);
+            if (!comment) {
+                out.space();
+            }
+            continue;
+        }
+        if (c == '&') {
+            const size_t semicolon = raw.find(';', i + 1);
+            uint32_t cp;
+            if (semicolon != std::string_view::npos && semicolon - i <= 12 &&
+                decodeEntity(raw.substr(i + 1, semicolon - i - 1), cp)) {
+                out.put(cp);
+                i = semicolon + 1;
+                continue;
+            }
+        }
+        out.put(c);
+        ++i;
+    }
+    return scratch;
+}
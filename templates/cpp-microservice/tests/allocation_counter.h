@@ -0,0 +1,133 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+// Counts every heap allocation in a test binary, so a test can check that a
+// stretch of code allocated nothing. Replaces the whole set of global
+// operator new and delete forms (plain, array, nothrow, sized and aligned),
+// so no allocation slips past the count and every block is freed by the
+// function family that made it: include it from the one source file of a
+// test binary. noinline keeps GCC from pairing an inlined malloc with a
+// delete at call sites and warning about mismatched allocation functions.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<size_t> allocations(0);
+
+static void* countedAllocate(size_t size) noexcept {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+static void* countedAllocate(size_t size, std::align_val_t align) noexcept {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    size_t alignment = static_cast<size_t>(align);
+    if (alignment < sizeof(void*)) {
+        alignment = sizeof(void*);
+    }
+    void* p = nullptr;
+    if (posix_memalign(&p, alignment, size ? size : 1) != 0) {
+        return nullptr;
+    }
+    return p;
+}
+
+__attribute__((noinline)) void* operator new(size_t size) {
+    if (void* p = countedAllocate(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void* operator new[](size_t size) {
+    if (void* p = countedAllocate(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocate(size);
+}
+
+__attribute__((noinline)) void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocate(size);
+}
+
+__attribute__((noinline)) void* operator new(size_t size, std::align_val_t align) {
+    if (void* p = countedAllocate(size, align)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void* operator new[](size_t size, std::align_val_t align) {
+    if (void* p = countedAllocate(size, align)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void* operator new(size_t size, std::align_val_t align,
+                                             const std::nothrow_t&) noexcept {
+    return countedAllocate(size, align);
+}
+
+__attribute__((noinline)) void* operator new[](size_t size, std::align_val_t align,
+                                               const std::nothrow_t&) noexcept {
+    return countedAllocate(size, align);
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void* p, size_t) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void* p, size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, std::align_val_t,
+                                               const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete[](void* p, std::align_val_t,
+                                                 const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+#endif // ALLOCATION_COUNTER_H
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include "../include/boilerplate_stripper.h"
+#include "../include/pattern_automaton.h"
+#include <string>
+#include <vector>
+
+// Expected outputs below come from the Python _strip_boilerplate functions
+class BoilerplateStripperTest : public ::testing::Test {
+protected:
+    const std::string page =
+        "[Jump to content](#content)\nMain menu\n\n# Search engine\n\nA search engine ranks pages.\n"
+        "Cookie settings\n\n\n\n## History\nEarly engines indexed titles.\n## See also\n* Web crawler\n"
+        "* Inverted index\n### Sub\nstill skipped\n## Design\nPress [?] to search\n"
+        "[Privacy](https://example.org/privacy)\n**Sponsored by:** Acme\n* sponsored child\n"
+        "  1. nested child\nBody text.\nToggle navigation\n# References\n1. Ref\n";
+
+    std::string strip(const BoilerplateRules& rules, const std::string& markdown) {
+        BoilerplateStripper stripper;
+        EXPECT_TRUE(stripper.setRules(rules));
+        return stripper.strip(markdown);
+    }
+};
+
+TEST_F(BoilerplateStripperTest, PatternSyntax) {
+    PatternAutomaton automaton;
+    ASSERT_TRUE(automaton.compile({R"(^(Cookie|Terms)\b)", R"(^Main menu$)", R"(^\[.*?\]\(https?://.*?(privacy)\))",
+                                   R"(^Press .(←|S|Esc). to)", R"(\d+\.)", R"([ \t*\-+])", R"(a{2,3}b)"},
+                                  PatternAutomaton::kIgnoreCase));
+    EXPECT_TRUE(automaton.matches("Cookie"));
+    EXPECT_TRUE(automaton.matches("COOKIE: yes"));
+    EXPECT_TRUE(automaton.matches("Terms\xC2\xA0of use"));
+    EXPECT_FALSE(automaton.matches("Cookies"));
+    EXPECT_FALSE(automaton.matches("Cookie_jar"));
+    EXPECT_FALSE(automaton.matches("Cookie\xC3\xA9"));    // é is a word character
+    EXPECT_TRUE(automaton.matches("main MENU"));
+    EXPECT_FALSE(automaton.matches("Main menu x"));
+    EXPECT_TRUE(automaton.matches("[a](https://x.org/PRIVACY)"));
+    EXPECT_FALSE(automaton.matches("[a](ftp://x.org/privacy)"));
+    EXPECT_TRUE(automaton.matches("Press [\xE2\x86\x90] to"));
+    EXPECT_TRUE(automaton.matches("Press (\xC5\xBF) to"));    // long s matches S under re.IGNORECASE
+    EXPECT_TRUE(automaton.matches("\xD9\xA1\xD9\xA2. item"));  // Arabic-Indic digits are \d
+    EXPECT_TRUE(automaton.matches("- item"));
+    EXPECT_TRUE(automaton.matches("aaab"));
+    EXPECT_FALSE(automaton.matches("ab"));
+    EXPECT_FALSE(automaton.matches(""));
+
+    ASSERT_TRUE(automaton.compile({"external links$"}, PatternAutomaton::kLowerCase));
+    EXPECT_TRUE(automaton.matches("External lin\xE2\x84\xAAs"));    // Kelvin sign lowers to k
+    EXPECT_FALSE(automaton.matches("external links too"));
+
+    EXPECT_FALSE(automaton.compile({"(unclosed"}));
+    EXPECT_FALSE(automaton.compile({R"(\bword)"}));
+    EXPECT_FALSE(automaton.compile({"*"}));
+}
+
+TEST_F(BoilerplateStripperTest, CrawlerRules) {
+    EXPECT_EQ(strip(BoilerplateRules::crawler(), page),
+              "# Search engine\n\nA search engine ranks pages.\n\n## History\nEarly engines indexed titles.\n"
+              "## Design\n**Sponsored by:** Acme\n* sponsored child\n  1. nested child\nBody text.");
+}
+
+TEST_F(BoilerplateStripperTest, ScraperRulesDropChildLines) {
+    EXPECT_EQ(strip(BoilerplateRules::scraper(), page),
+              "# Search engine\n\nA search engine ranks pages.\n\n## History\nEarly engines indexed titles.\n"
+              "## Design\nPress [?] to search\nBody text.\nToggle navigation");
+}
+
+TEST_F(BoilerplateStripperTest, WebApiRules) {
+    EXPECT_EQ(strip(BoilerplateRules::webApi(), page),
+              "# Search engine\n\nA search engine ranks pages.\n\n## History\nEarly engines indexed titles.\n"
+              "## Design\n**Sponsored by:** Acme\n* sponsored child\n  1. nested child\nBody text.\n"
+              "Toggle navigation");
+}
+
+TEST_F(BoilerplateStripperTest, TrimsAndNeverEmpties) {
+    const BoilerplateRules rules = BoilerplateRules::crawler();
+    EXPECT_EQ(strip(rules, "  \n\nText\n\n\n\nMore\n\n"), "Text\n\nMore");
+    EXPECT_EQ(strip(rules, "Main menu\nSign in"), "Main menu\nSign in");
+    EXPECT_EQ(strip(rules, ""), "");
+    EXPECT_EQ(strip(rules, "\xE3\x80\x80 body \xC2\xA0"), "body");
+}
+
+TEST_F(BoilerplateStripperTest, RejectsBadPattern) {
+    BoilerplateStripper stripper;
+    BoilerplateRules rules;
+    rules.linePatterns = {"[unclosed"};
+    EXPECT_FALSE(stripper.setRules(rules));
+    // The previous rules stay in force
+    EXPECT_EQ(stripper.strip("Main menu\nText"), "Text");
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
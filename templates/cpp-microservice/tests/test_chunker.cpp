@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include "../include/chunker.h"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Python-side expectations below come from rag.split_into_chunks
+std::vector<std::string> chunkText(const std::string& text, const ChunkerOptions& options) {
+    Chunker chunker(options);
+    std::vector<std::string_view> views;
+    chunker.split(text, views);
+    return std::vector<std::string>(views.begin(), views.end());
+}
+
+std::vector<std::string> chunkStream(const std::string& text, const ChunkerOptions& options, std::mt19937& rng) {
+    Chunker chunker(options);
+    std::vector<std::string> chunks;
+    auto collect = [&chunks](std::string_view chunk) { chunks.emplace_back(chunk); };
+    size_t pos = 0;
+    while (pos < text.size()) {
+        const size_t piece = std::min<size_t>(1 + rng() % 64, text.size() - pos);
+        chunker.feed(std::string_view(text).substr(pos, piece), collect);
+        pos += piece;
+    }
+    chunker.finish(collect);
+    return chunks;
+}
+
+ChunkerOptions sentenceOptions(size_t chunkSize, size_t overlapSentences) {
+    ChunkerOptions options;
+    options.chunkSize = chunkSize;
+    options.overlapSentences = overlapSentences;
+    return options;
+}
+
+ChunkerOptions windowOptions(size_t chunkSize, size_t overlapChars) {
+    ChunkerOptions options;
+    options.chunkSize = chunkSize;
+    options.overlapChars = overlapChars;
+    return options;
+}
+
+} // namespace
+
+class ChunkerTest : public ::testing::Test {
+protected:
+    std::mt19937 rng{3};
+
+    // Crawled-page-like text: sentences of mixed scripts separated by
+    // spaces, newlines, tabs, NBSP and ideographic spaces
+    std::string makePage(size_t sentences) {
+        const char* words[] = {"search", "stack", "crawls", "pages", "café", "naïve", "東京", "данные", "🙂", "ranks"};
+        const char* ends[] = {".", "!", "?", "...", "", "."};
+        const char* separators[] = {" ", " ", " ", "  ", "\n", "\n\n", "\t", "\xC2\xA0", "\xE3\x80\x80"};
+        std::string page;
+        for (size_t s = 0; s < sentences; ++s) {
+            const size_t count = 1 + rng() % 25;
+            for (size_t w = 0; w < count; ++w) {
+                page += w > 0 ? " " : "";
+                page += words[rng() % 10];
+            }
+            page += ends[rng() % 6];
+            page += separators[rng() % 9];
+        }
+        return page;
+    }
+};
+
+TEST_F(ChunkerTest, PacksSentencesWithOverlap) {
+    EXPECT_EQ(chunkText("One. Two!  Three?\nFour.", sentenceOptions(12, 1)),
+              (std::vector<std::string>{"One. Two!", "Two! Three?", "Three? Four."}));
+    // As in Python, an overlap of zero carries every sentence forward
+    EXPECT_EQ(chunkText("One. Two. Three. Four.", sentenceOptions(10, 0)),
+              (std::vector<std::string>{"One. Two.", "One. Two. Three.", "One. Two. Three. Four."}));
+    EXPECT_EQ(chunkText("No terminator here", sentenceOptions(5, 2)), (std::vector<std::string>{"No terminator here"}));
+    EXPECT_EQ(chunkText("Ends with space. ", sentenceOptions(1000, 2)), (std::vector<std::string>{"Ends with space. "}));
+    EXPECT_EQ(chunkText("Dr.Smith arrived. Then left.", sentenceOptions(1000, 2)),
+              (std::vector<std::string>{"Dr.Smith arrived. Then left."}));
+    EXPECT_EQ(chunkText("", sentenceOptions(1000, 2)), (std::vector<std::string>{""}));
+}
+
+TEST_F(ChunkerTest, SlidesCharacterWindows) {
+    // Windows count code points, not bytes; the 40-character tail is dropped
+    std::string accented;
+    for (int i = 0; i < 250; ++i) {
+        accented += "é";
+    }
+    std::vector<std::string> chunks = chunkText(accented, windowOptions(100, 30));
+    ASSERT_EQ(chunks.size(), 3u);
+    for (const std::string& chunk : chunks) {
+        EXPECT_EQ(chunk, accented.substr(0, 200));
+    }
+
+    chunks = chunkText(std::string(350, 'x'), windowOptions(200, 50));
+    ASSERT_EQ(chunks.size(), 2u);
+    EXPECT_EQ(chunks[1].size(), 200u);
+    // A short text is one chunk, and an overlap past the chunk size steps by one
+    EXPECT_EQ(chunkText("short", windowOptions(1000, 200)), (std::vector<std::string>{"short"}));
+    EXPECT_EQ(chunkText(std::string(103, 'y'), windowOptions(100, 400)).size(), 4u);
+    EXPECT_EQ(chunkText("", windowOptions(1000, 200)), (std::vector<std::string>{""}));
+}
+
+TEST_F(ChunkerTest, ViewsPointIntoSourceForSingleSpaces) {
+    const std::string text = "First sentence here. Second one! Third? Fourth sentence. Fifth.";
+    Chunker chunker(sentenceOptions(30, 1));
+    std::vector<std::string_view> views;
+    chunker.split(text, views);
+    ASSERT_GT(views.size(), 1u);
+    for (std::string_view view : views) {
+        EXPECT_GE(view.data(), text.data());
+        EXPECT_LE(view.data() + view.size(), text.data() + text.size());
+    }
+
+    // Other separators are normalized to one space in an owned buffer
+    const std::string spaced = "First.\n\nSecond.";
+    chunker.split(spaced, views);
+    ASSERT_EQ(views.size(), 1u);
+    EXPECT_EQ(views[0], "First. Second.");
+}
+
+TEST_F(ChunkerTest, StreamingMatchesWholeText) {
+    const std::vector<ChunkerOptions> settings = {sentenceOptions(1000, 2), sentenceOptions(200, 0),
+                                                  sentenceOptions(50, 3),   windowOptions(1000, 200),
+                                                  windowOptions(300, 299),  windowOptions(150, 400)};
+    for (int page = 0; page < 20; ++page) {
+        const std::string text = makePage(rng() % 300);
+        for (const ChunkerOptions& options : settings) {
+            EXPECT_EQ(chunkStream(text, options, rng), chunkText(text, options));
+        }
+    }
+}
+
+TEST_F(ChunkerTest, StreamingRetainsOnlyPendingText) {
+    Chunker chunker(windowOptions(1000, 200));
+    size_t chunks = 0;
+    auto count = [&chunks](std::string_view) { ++chunks; };
+    const std::string page = makePage(50);
+    for (int i = 0; i < 200; ++i) {
+        chunker.feed(page, count);
+        EXPECT_LT(chunker.buffered(), page.size() + 4 * 1000);
+    }
+    chunker.finish(count);
+    EXPECT_GT(chunks, 0u);
+    EXPECT_EQ(chunker.buffered(), 0u);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
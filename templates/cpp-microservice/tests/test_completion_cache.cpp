@@ -0,0 +1,323 @@
+#include <gtest/gtest.h>
+#include "../include/completion_cache.h"
+#include "../include/completion_cache_service.h"
+#include "../include/config_manager.h"
+#include "../include/microservice.h"
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+CompletionKey keyOf(const std::string& prompt, const std::string& provider = "deepseek") {
+    return CompletionCache::key(provider, {{"system", "Be brief."}, {"user", prompt}});
+}
+
+// Single-shard cache with room for about `entries` responses of 100 bytes
+CompletionCacheOptions smallOptions(size_t entries) {
+    CompletionCacheOptions options;
+    options.shards = 1;
+    options.maxBytes = entries * (256 + 100);
+    return options;
+}
+
+// A stand-in for a Redis server: answers GET, PTTL and SET PX over RESP, with its own clock
+class FakeRedis {
+public:
+    bool handle(const std::string& request, std::string& replies) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++roundTrips;
+        std::string_view rest(request);
+        std::vector<std::string> command;
+        while (readCommand(rest, command)) {
+            if (command[0] == "GET") {
+                auto it = values_.find(command[1]);
+                replies += it == values_.end() ? "$-1\r\n"
+                                               : "$" + std::to_string(it->second.first.size()) + "\r\n" +
+                                                     it->second.first + "\r\n";
+            } else if (command[0] == "PTTL") {
+                auto it = values_.find(command[1]);
+                replies += it == values_.end() ? ":-2\r\n" : ":" + std::to_string(it->second.second) + "\r\n";
+            } else if (command[0] == "SET" && command.size() == 5 && command[3] == "PX") {
+                values_[command[1]] = {command[2], std::stoull(command[4])};
+                replies += "+OK\r\n";
+            } else {
+                replies += "-ERR unknown command\r\n";
+            }
+        }
+        return true;
+    }
+
+    CompletionCache::RespTransport transport() {
+        return [this](const std::string& request, std::string& replies) { return handle(request, replies); };
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return values_.size();
+    }
+
+    int roundTrips = 0;
+
+private:
+    std::mutex mutex_;
+    std::map<std::string, std::pair<std::string, uint64_t>> values_;
+
+    static bool readCommand(std::string_view& rest, std::vector<std::string>& command) {
+        if (rest.empty() || rest[0] != '*') {
+            return false;
+        }
+        const size_t end = rest.find("\r\n");
+        size_t count = std::stoul(std::string(rest.substr(1, end - 1)));
+        rest.remove_prefix(end + 2);
+        command.clear();
+        while (count-- > 0) {
+            std::string value;
+            char type;
+            if (!CompletionCache::parseRespReply(rest, value, type) || type != '$') {
+                return false;
+            }
+            command.push_back(value);
+        }
+        return true;
+    }
+};
+
+} // namespace
+
+TEST(CompletionCacheTest, KeysCoverEveryFieldWithoutAmbiguity) {
+    EXPECT_EQ(keyOf("hello"), keyOf("hello"));
+    EXPECT_NE(keyOf("hello"), keyOf("hello!"));
+    EXPECT_NE(keyOf("hello"), keyOf("hello", "openai"));
+    EXPECT_NE(CompletionCache::key("p", {{"user", "ab"}}), CompletionCache::key("p", {{"usera", "b"}}));
+    EXPECT_NE(CompletionCache::key("p", {{"user", "a"}, {"user", "b"}}), CompletionCache::key("p", {{"user", "ab"}}));
+    EXPECT_NE(CompletionCache::key("p", {{"user", "a"}}, "temperature=0"),
+              CompletionCache::key("p", {{"user", "a"}}, "temperature=1"));
+    std::string smuggled;
+    CompletionCache::appendSetting(smuggled, "seed", "1\ntemperature=0.7");
+    std::string separate;
+    CompletionCache::appendSetting(separate, "seed", "1");
+    CompletionCache::appendSetting(separate, "temperature", "0.7");
+    EXPECT_NE(smuggled, separate);
+    EXPECT_NE(CompletionCache::key("p", {{"user", "a"}}, smuggled), CompletionCache::key("p", {{"user", "a"}}, separate));
+
+    const CompletionKey key = keyOf("hello");
+    const std::string hex = key.hex();
+    EXPECT_EQ(hex.size(), 64u);
+    CompletionKey parsed;
+    ASSERT_TRUE(CompletionKey::fromHex(hex, parsed));
+    EXPECT_EQ(parsed, key);
+    EXPECT_FALSE(CompletionKey::fromHex(hex.substr(1), parsed));
+    EXPECT_FALSE(CompletionKey::fromHex(std::string(64, 'g'), parsed));
+}
+
+TEST(CompletionCacheTest, ServesResponsesUntilTheTtlRunsOut) {
+    CompletionCacheOptions options;
+    options.ttlMillis = 1000;
+    CompletionCache cache(options);
+    const CompletionKey key = keyOf("hello");
+    EXPECT_EQ(cache.get(key, 0), nullptr);
+    EXPECT_TRUE(cache.put(key, "{\"content\": \"hi\"}", 0));
+    std::shared_ptr<const std::string> response = cache.get(key, 999);
+    ASSERT_NE(response, nullptr);
+    EXPECT_EQ(*response, "{\"content\": \"hi\"}");
+    EXPECT_EQ(cache.get(key, 1000), nullptr);
+
+    EXPECT_TRUE(cache.put(key, "short-lived", 2000, 10));
+    EXPECT_NE(cache.get(key, 2009), nullptr);
+    EXPECT_EQ(cache.get(key, 2010), nullptr);
+
+    const CompletionCacheStats stats = cache.stats();
+    EXPECT_EQ(stats.hits, 2u);
+    EXPECT_EQ(stats.misses, 3u);
+    EXPECT_EQ(stats.expired, 2u);
+    EXPECT_EQ(stats.inserts, 2u);
+    EXPECT_EQ(stats.entries, 0u);
+    EXPECT_EQ(stats.bytes, 0u);
+}
+
+TEST(CompletionCacheTest, ReplacesAndRemovesResponses) {
+    CompletionCache cache;
+    const CompletionKey key = keyOf("hello");
+    cache.put(key, "first", 0);
+    cache.put(key, "second", 0);
+    EXPECT_EQ(*cache.get(key, 1), "second");
+    EXPECT_EQ(cache.stats().entries, 1u);
+    EXPECT_TRUE(cache.remove(key));
+    EXPECT_FALSE(cache.remove(key));
+    EXPECT_EQ(cache.get(key, 1), nullptr);
+    EXPECT_EQ(cache.stats().bytes, 0u);
+}
+
+TEST(CompletionCacheTest, StaysWithinItsByteBound) {
+    CompletionCacheOptions options = smallOptions(100);
+    options.shards = 4;
+    CompletionCache cache(options);
+    for (int i = 0; i < 2000; ++i) {
+        cache.put(keyOf("prompt " + std::to_string(i)), std::string(100 + i % 50, 'x'), 0);
+        ASSERT_LE(cache.stats().bytes, cache.stats().capacityBytes);
+    }
+    const CompletionCacheStats stats = cache.stats();
+    EXPECT_GT(stats.entries, 50u);
+    EXPECT_LT(stats.entries, 100u);
+    EXPECT_EQ(stats.entries + stats.evictions + stats.rejected, 2000u);
+
+    // Too large for the shard: not cached in memory
+    EXPECT_FALSE(cache.put(keyOf("huge"), std::string(options.maxBytes, 'x'), 0));
+}
+
+TEST(CompletionCacheTest, FrequentResponsesSurviveAScanOfOneOffPrompts) {
+    CompletionCache cache(smallOptions(100));
+    for (int i = 0; i < 50; ++i) {
+        const CompletionKey key = keyOf("popular " + std::to_string(i));
+        cache.get(key, 0);
+        cache.put(key, std::string(100, 'p'), 0);
+        for (int hit = 0; hit < 5; ++hit) {
+            cache.get(key, 0);
+        }
+    }
+    for (int i = 0; i < 2000; ++i) {
+        const CompletionKey key = keyOf("one-off " + std::to_string(i));
+        cache.get(key, 0);
+        cache.put(key, std::string(100, 'o'), 0);
+    }
+    int hits = 0;
+    for (int i = 0; i < 50; ++i) {
+        hits += cache.get(keyOf("popular " + std::to_string(i)), 0) != nullptr;
+    }
+    // A plain LRU of this size would have none left
+    EXPECT_EQ(hits, 50);
+    EXPECT_GT(cache.stats().rejected, 1900u);
+}
+
+TEST(CompletionCacheTest, SpillsToRedisAndReadsBack) {
+    std::string_view replies = "+OK\r\n$5\r\nhello\r\n$-1\r\n:42\r\n-ERR no\r\n$3\r\nab";
+    std::string value;
+    char type;
+    ASSERT_TRUE(CompletionCache::parseRespReply(replies, value, type));
+    EXPECT_EQ(type, '+');
+    EXPECT_EQ(value, "OK");
+    ASSERT_TRUE(CompletionCache::parseRespReply(replies, value, type));
+    EXPECT_EQ(type, '$');
+    EXPECT_EQ(value, "hello");
+    ASSERT_TRUE(CompletionCache::parseRespReply(replies, value, type));
+    EXPECT_EQ(type, '_');
+    ASSERT_TRUE(CompletionCache::parseRespReply(replies, value, type));
+    EXPECT_EQ(type, ':');
+    EXPECT_EQ(value, "42");
+    ASSERT_TRUE(CompletionCache::parseRespReply(replies, value, type));
+    EXPECT_EQ(type, '-');
+    EXPECT_FALSE(CompletionCache::parseRespReply(replies, value, type));
+    EXPECT_EQ(CompletionCache::respCommand({"GET", "k"}), "*2\r\n$3\r\nGET\r\n$1\r\nk\r\n");
+
+    FakeRedis redis;
+    CompletionCacheOptions options = smallOptions(10);
+    options.ttlMillis = 60000;
+    CompletionCache cache(options);
+    cache.setSpill(CompletionCache::redisSpill(redis.transport(), "completion:"));
+    for (int i = 0; i < 100; ++i) {
+        cache.put(keyOf("prompt " + std::to_string(i)), "response " + std::to_string(i), 1000);
+    }
+    CompletionCacheStats stats = cache.stats();
+    EXPECT_EQ(stats.spillWrites, stats.evictions + stats.rejected);
+    EXPECT_EQ(redis.size(), stats.spillWrites);
+    EXPECT_GE(redis.size(), 80u);
+
+    // Every response is still served, from memory or after one round trip for GET and PTTL
+    for (int i = 0; i < 100; ++i) {
+        std::shared_ptr<const std::string> response = cache.get(keyOf("prompt " + std::to_string(i)), 2000);
+        ASSERT_NE(response, nullptr) << i;
+        EXPECT_EQ(*response, "response " + std::to_string(i));
+    }
+    stats = cache.stats();
+    EXPECT_GE(stats.spillHits, 80u);
+    EXPECT_EQ(stats.hits + stats.spillHits, 100u);
+
+    // A response with no copy anywhere is a miss
+    const int roundTrips = redis.roundTrips;
+    EXPECT_EQ(cache.get(keyOf("never stored"), 2000), nullptr);
+    EXPECT_EQ(redis.roundTrips, roundTrips + 1);
+
+    cache.setSpill(CompletionSpill());
+    EXPECT_EQ(cache.get(keyOf("never stored"), 2000), nullptr);
+    EXPECT_EQ(redis.roundTrips, roundTrips + 1);
+}
+
+TEST(CompletionCacheTest, ConcurrentGetsAndPuts) {
+    CompletionCacheOptions options;
+    options.maxBytes = 1 << 20;
+    CompletionCache cache(options);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&cache, t] {
+            for (int i = 0; i < 5000; ++i) {
+                const std::string prompt = "prompt " + std::to_string((i * 7 + t) % 500);
+                const CompletionKey key = keyOf(prompt);
+                std::shared_ptr<const std::string> response = cache.get(key, 0);
+                if (response) {
+                    ASSERT_EQ(*response, "answer to " + prompt);
+                } else {
+                    cache.put(key, "answer to " + prompt, 0);
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    const CompletionCacheStats stats = cache.stats();
+    EXPECT_EQ(stats.hits + stats.misses, 20000u);
+    EXPECT_EQ(stats.entries, 500u);
+    EXPECT_LE(stats.bytes, stats.capacityBytes);
+}
+
+TEST(CompletionCacheServiceTest, LooksUpAndStoresResponses) {
+    ConfigManager config;
+    CompletionCacheService service;
+    ASSERT_TRUE(service.initialize(config));
+    Microservice microservice;
+    HttpServer server(microservice);
+    service.registerRoutes(server);
+
+    const std::string request = R"({"provider": "deepseek", "messages": [{"role": "system", "content": "Be brief."},
+                                    {"role": "user", "content": "hello"}], "temperature": 0.7})";
+    std::string settings;
+    CompletionCache::appendSetting(settings, "temperature", "0.7");
+    const std::string hex =
+        CompletionCache::key("deepseek", {{"system", "Be brief."}, {"user", "hello"}}, settings).hex();
+    EXPECT_EQ(server.dispatch("POST", "/completion/cache/lookup", request),
+              "{\"hit\": false, \"key\": \"" + hex + "\"}");
+    EXPECT_EQ(server.dispatch("POST", "/completion/cache/store",
+                              "{\"key\": \"" + hex + "\", \"response\": \"{\\\"content\\\": \\\"Hi.\\\"}\"}"),
+              "{\"key\": \"" + hex + "\", \"cached\": true}");
+    EXPECT_EQ(server.dispatch("POST", "/completion/cache/lookup", request),
+              "{\"hit\": true, \"key\": \"" + hex + "\", \"response\": \"{\\\"content\\\": \\\"Hi.\\\"}\"}");
+
+    // Other sampling settings are another request
+    const std::string colder = R"({"provider": "deepseek", "messages": [{"role": "system", "content": "Be brief."},
+                                   {"role": "user", "content": "hello"}], "temperature": 0})";
+    EXPECT_EQ(server.dispatch("POST", "/completion/cache/lookup", colder).find("\"hit\": false"), 1u);
+
+    EXPECT_EQ(server.dispatch("POST", "/completion/cache/lookup", R"({"messages": []})"),
+              "{\"error\": \"provider required\"}");
+    EXPECT_EQ(server.dispatch("POST", "/completion/cache/lookup",
+                              R"({"provider": "p", "messages": [{"role": "user", "content": [{"type": "text"}]}]})"),
+              "{\"error\": \"unsupported message field messages.0.content.0.type\"}");
+    EXPECT_EQ(server.dispatch("POST", "/completion/cache/store", R"({"key": "abc", "response": "x"})"),
+              "{\"error\": \"key must be the 64 hex digits a lookup returned\"}");
+    EXPECT_EQ(server.dispatch("GET", "/completion/cache/stats", "").find(
+                  "{\"entries\": 1, \"bytes\": "),
+              0u);
+    EXPECT_NE(server.dispatch("GET", "/completion/cache/stats", "").find("\"hits\": 1, \"misses\": 2"),
+              std::string::npos);
+
+    // A value cannot smuggle in another setting
+    const std::string smuggled = server.dispatch(
+        "POST", "/completion/cache/lookup", R"({"provider": "p", "messages": [{"role": "user", "content": "hi"}],
+                                             "seed": "1\ntemperature=0.7"})");
+    const std::string separate = server.dispatch(
+        "POST", "/completion/cache/lookup", R"({"provider": "p", "messages": [{"role": "user", "content": "hi"}],
+                                             "seed": 1, "temperature": 0.7})");
+    EXPECT_EQ(smuggled.find("\"hit\": false"), 1u);
+    EXPECT_NE(smuggled, separate);
+}
@@ -0,0 +1,801 @@
+#include <gtest/gtest.h>
+#include "../include/config_manager.h"
+#include "../include/crawl_cache.h"
+#include "../include/crawl_cache_service.h"
+#include "../include/cuckoo_filter.h"
+#include "../include/lz_codec.h"
+#include "../include/microservice.h"
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+double now() {
+    return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string roundTrip(const std::string& data) {
+    std::string block;
+    lzCompress(data.data(), data.size(), block);
+    std::string out(data.size(), '\0');
+    EXPECT_TRUE(lzDecompress(reinterpret_cast<const uint8_t*>(block.data()), block.size(), &out[0], out.size()));
+    return out;
+}
+
+// A page of one made-up site: shared navigation and footer around its own article text
+std::string sitePage(std::mt19937& rng, int n) {
+    static const char* const words[] = {"crawler", "index", "markdown", "segment", "query", "ranking",
+                                        "latency", "provider", "snippet", "domain", "offset", "budget"};
+    std::string out = "[Home](/) | [Docs](/docs) | [Blog](/blog) | [Pricing](/pricing) | [Sign in](/login)\n\n"
+                      "# Article " + std::to_string(n) + "\n\n";
+    for (int i = 0; i < 300; ++i) {
+        out += words[rng() % 12];
+        out += i % 15 == 14 ? ".\n" : " ";
+    }
+    out += "\n\n---\nCopyright Example Corp. All rights reserved. Terms of service | Privacy policy | "
+           "Contact us at support@example.com | Follow us on social media for updates\n";
+    return out;
+}
+
+// A documentation page as the crawler stores it: the site's navigation,
+// headings, prose, a list of links, a code block, a table and the footer
+std::string docsPage(std::mt19937& rng, int n) {
+    static const char* const words[] = {
+        "the",      "a",        "request",  "returns",  "each",      "page",     "with",     "and",
+        "for",      "results",  "query",    "limit",    "cache",     "is",       "when",     "are",
+        "provider", "search",   "response", "field",    "timeout",   "retries",  "of",       "to",
+        "set",      "default",  "token",    "rate",     "header",    "client",   "server",   "error",
+        "from",     "only",     "links",    "crawl",    "markdown",  "content",  "this",     "that",
+        "stored",   "index",    "before",   "after",    "documents", "between",  "which",    "every",
+        "seconds",  "requests", "in",       "by",       "its",       "snippet",  "language", "region",
+        "domain",   "expires",  "fetch",    "body",     "status",    "or",       "not",      "may"};
+    static const char* const topics[] = {"Authentication", "Rate limits", "Search API", "Crawl API",
+                                         "Webhooks",       "Pagination",  "Errors",     "Caching"};
+    const auto sentence = [&](std::string& out) {
+        const int length = 8 + static_cast<int>(rng() % 14);
+        for (int i = 0; i < length; ++i) {
+            std::string word = words[rng() % 64];
+            if (i == 0) {
+                word[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(word[0])));
+            }
+            out += word;
+            out += i + 1 < length ? " " : ". ";
+        }
+    };
+    const std::string topic = topics[rng() % 8];
+    std::string out = "[Docs](/docs) | [API reference](/docs/api) | [Guides](/docs/guides) | [Changelog](/changelog) | "
+                      "[Status](https://status.example.com)\n\n"
+                      "# " + topic + "\n\n";
+    for (int paragraph = 0; paragraph < 3; ++paragraph) {
+        for (int i = 0, count = 2 + static_cast<int>(rng() % 4); i < count; ++i) {
+            sentence(out);
+        }
+        out += "\n\n";
+    }
+    out += "## Example\n\n```\ncurl -H \"Authorization: Bearer $TOKEN\" "
+           "\"https://api.example.com/v1/search?q=page+" + std::to_string(n) + "&limit=" +
+           std::to_string(10 + rng() % 90) + "\"\n```\n\n"
+           "| Field | Type | Description |\n| --- | --- | --- |\n";
+    for (int i = 0, rows = 2 + static_cast<int>(rng() % 4); i < rows; ++i) {
+        out += "| ";
+        out += words[rng() % 64];
+        out += "_";
+        out += words[rng() % 64];
+        out += i % 2 ? " | string | " : " | integer | ";
+        sentence(out);
+        out += "|\n";
+    }
+    out += "\n## See also\n\n";
+    for (int i = 0; i < 3; ++i) {
+        const char* const other = topics[rng() % 8];
+        out += "* [" + std::string(other) + "](/docs/" + std::to_string(rng() % 50) + ")\n";
+    }
+    out += "\n---\n\nWas this page helpful? [Yes](/feedback?v=1) | [No](/feedback?v=0)\n\n"
+           "Copyright 2024 Example Inc. [Terms](/terms) | [Privacy](/privacy) | [Contact](/contact)\n";
+    return out;
+}
+
+ino_t inode(const std::filesystem::path& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? st.st_ino : 0;
+}
+
+std::vector<std::filesystem::path> segmentFiles(const std::filesystem::path& dir) {
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        if (entry.path().extension() == ".log") {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+} // namespace
+
+TEST(LzCodecTest, RoundTripsAndCompressesRepetition) {
+    EXPECT_EQ(roundTrip(""), "");
+    EXPECT_EQ(roundTrip("short"), "short");
+    EXPECT_EQ(roundTrip(std::string(100000, 'a')), std::string(100000, 'a'));
+
+    std::string text;
+    for (int i = 0; i < 2000; ++i) {
+        text += "## Section " + std::to_string(i % 37) + "\n\nThe crawler stores markdown pages. ";
+    }
+    EXPECT_EQ(roundTrip(text), text);
+    std::string block;
+    lzCompress(text.data(), text.size(), block);
+    EXPECT_LT(block.size() * 10, text.size());
+
+    std::mt19937 rng(3);
+    std::string noise(70000, '\0');
+    for (char& c : noise) {
+        c = static_cast<char>(rng());
+    }
+    EXPECT_EQ(roundTrip(noise), noise);
+}
+
+TEST(LzCodecTest, RejectsCorruptBlocks) {
+    std::string text;
+    for (int i = 0; i < 200; ++i) {
+        text += "repeated words and more repeated words ";
+    }
+    std::string block;
+    lzCompress(text.data(), text.size(), block);
+    std::string out(text.size(), '\0');
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(block.data());
+
+    EXPECT_FALSE(lzDecompress(bytes, block.size() - 1, &out[0], out.size()));
+    EXPECT_FALSE(lzDecompress(bytes, block.size(), &out[0], out.size() - 1));
+    std::mt19937 rng(9);
+    for (int trial = 0; trial < 2000; ++trial) {
+        std::string corrupt = block;
+        corrupt[rng() % corrupt.size()] ^= static_cast<char>(1 + rng() % 255);
+        // Must fail or decode to something of the right size, never overrun
+        lzDecompress(reinterpret_cast<const uint8_t*>(corrupt.data()), corrupt.size(), &out[0], out.size());
+    }
+}
+
+TEST(LzCodecTest, DictionaryRoundTripsAndHelpsSimilarRecords) {
+    std::mt19937 rng(5);
+    std::vector<std::string> pages;
+    for (int i = 0; i < 40; ++i) {
+        pages.push_back(sitePage(rng, i));
+    }
+    const std::vector<std::string_view> samples(pages.begin(), pages.begin() + 32);
+    const LzDictionary dictionary = LzDictionary::train(samples, 16 << 10);
+    ASSERT_FALSE(dictionary.empty());
+    EXPECT_LE(dictionary.size(), 16u << 10);
+    EXPECT_NE(dictionary.bytes().find("Privacy policy"), std::string::npos);
+
+    // Pages the dictionary was not trained on
+    size_t plain = 0;
+    size_t trained = 0;
+    for (size_t i = 32; i < pages.size(); ++i) {
+        std::string block;
+        lzCompress(pages[i].data(), pages[i].size(), block);
+        plain += block.size();
+        block.clear();
+        lzCompress(pages[i].data(), pages[i].size(), block, &dictionary);
+        trained += block.size();
+
+        std::string out(pages[i].size(), '\0');
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(block.data());
+        ASSERT_TRUE(lzDecompress(bytes, block.size(), &out[0], out.size(), &dictionary));
+        EXPECT_EQ(out, pages[i]);
+        // Matches into the dictionary are out of range without it
+        EXPECT_FALSE(lzDecompress(bytes, block.size(), &out[0], out.size()));
+    }
+    EXPECT_LT(trained, plain);
+
+    EXPECT_TRUE(LzDictionary::train({"abc", "xyz"}, 1024).empty());
+    const LzDictionary stored(dictionary.bytes());
+    std::string block;
+    lzCompress(pages[0].data(), pages[0].size(), block, &stored);
+    std::string out(pages[0].size(), '\0');
+    ASSERT_TRUE(lzDecompress(reinterpret_cast<const uint8_t*>(block.data()), block.size(), &out[0], out.size(),
+                             &dictionary));
+    EXPECT_EQ(out, pages[0]);
+}
+
+TEST(LzCodecTest, DictionaryCompressesDocumentationCorpus) {
+    std::mt19937 rng(11);
+    std::vector<std::string> pages;
+    for (int i = 0; i < 200; ++i) {
+        pages.push_back(docsPage(rng, i));
+    }
+    const std::vector<std::string_view> samples(pages.begin(), pages.begin() + 100);
+    const LzDictionary dictionary = LzDictionary::train(samples, 32 << 10);
+    ASSERT_FALSE(dictionary.empty());
+
+    // Each held-out page is its own block, as a cache record is
+    size_t raw = 0;
+    size_t plain = 0;
+    size_t trained = 0;
+    for (size_t i = 100; i < pages.size(); ++i) {
+        const std::string& page = pages[i];
+        std::string block;
+        lzCompress(page.data(), page.size(), block);
+        plain += block.size();
+        block.clear();
+        lzCompress(page.data(), page.size(), block, &dictionary);
+        raw += page.size();
+        trained += block.size();
+
+        std::string out(page.size(), '\0');
+        ASSERT_TRUE(lzDecompress(reinterpret_cast<const uint8_t*>(block.data()), block.size(), &out[0], out.size(),
+                                 &dictionary));
+        ASSERT_EQ(out, page) << "page " << i;
+    }
+    // About 2.7x with the dictionary and 1.5x without on this corpus
+    EXPECT_GE(raw, 2 * trained) << "ratio " << double(raw) / trained;
+    EXPECT_LE(trained * 10, plain * 7) << "plain " << plain << ", dictionary " << trained;
+}
+
+TEST(CuckooFilterTest, NeverMissesAndKeepsFalsePositivesNearTheBound) {
+    CuckooFilter filter;
+    ASSERT_TRUE(filter.create("", 40000));
+    EXPECT_EQ(filter.capacity(), 65536u);
+    std::mt19937_64 rng(5);
+    std::vector<uint64_t> inserted;
+    while (filter.load() < 0.93) {
+        inserted.push_back(rng());
+        ASSERT_TRUE(filter.insert(inserted.back())) << filter.load();
+    }
+    for (uint64_t hash : inserted) {
+        ASSERT_TRUE(filter.contains(hash));
+    }
+    size_t passed = 0;
+    const size_t trials = 400000;
+    for (size_t i = 0; i < trials; ++i) {
+        passed += filter.contains(rng());
+    }
+    const double expected = filter.expectedFalsePositiveRate();
+    EXPECT_NEAR(expected, 8 * 0.93 / 65535, 1e-5);
+    EXPECT_LT(static_cast<double>(passed) / trials, 2 * expected);
+
+    // Erasing leaves the others in place and frees their slots
+    for (size_t i = 0; i < inserted.size(); i += 2) {
+        ASSERT_TRUE(filter.erase(inserted[i]));
+    }
+    EXPECT_EQ(filter.size(), inserted.size() / 2);
+    size_t stale = 0;
+    for (size_t i = 0; i < inserted.size(); ++i) {
+        if (i % 2) {
+            ASSERT_TRUE(filter.contains(inserted[i]));
+        } else {
+            stale += filter.contains(inserted[i]);
+        }
+    }
+    EXPECT_LT(stale, inserted.size() / 1000);
+    EXPECT_FALSE(filter.erase(rng()));
+}
+
+TEST(CuckooFilterTest, LookupsNeverMissWhileInsertsRelocate) {
+    CuckooFilter filter;
+    ASSERT_TRUE(filter.create("", 1 << 14));
+    std::mt19937_64 rng(6);
+    std::vector<uint64_t> resident(2000);
+    for (uint64_t& hash : resident) {
+        hash = rng();
+        ASSERT_TRUE(filter.insert(hash));
+    }
+    std::atomic<bool> stop(false);
+    std::atomic<int> missed(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 2; ++t) {
+        readers.emplace_back([&] {
+            while (!stop.load()) {
+                for (uint64_t hash : resident) {
+                    missed += !filter.contains(hash);
+                }
+            }
+        });
+    }
+    // Fill to 95%, where most inserts move other fingerprints, then empty again
+    size_t full = 0;
+    for (int round = 0; round < 50; ++round) {
+        std::vector<uint64_t> added;
+        while (filter.load() < 0.95) {
+            added.push_back(rng());
+            if (!filter.insert(added.back())) {
+                added.pop_back();
+                break;
+            }
+        }
+        full += filter.load() > 0.9;
+        for (uint64_t hash : added) {
+            ASSERT_TRUE(filter.erase(hash));
+        }
+    }
+    stop = true;
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(full, 50u);
+    EXPECT_EQ(filter.size(), resident.size());
+    EXPECT_EQ(missed.load(), 0);
+}
+
+TEST(CuckooFilterTest, OpensOnlyCleanFilesWithTheSameStamp) {
+    const std::filesystem::path path =
+        std::filesystem::temp_directory_path() / ("cuckoo_filter_test_" + std::to_string(getpid()));
+    CuckooFilter filter;
+    ASSERT_TRUE(filter.create(path.string(), 1000));
+    for (uint64_t i = 1; i <= 500; ++i) {
+        ASSERT_TRUE(filter.insert(i * 0x9e3779b97f4a7c15ULL));
+    }
+    ASSERT_TRUE(filter.persist(42));
+    filter.close();
+
+    CuckooFilter reopened;
+    EXPECT_FALSE(reopened.open(path.string(), 43));
+    ASSERT_TRUE(reopened.open(path.string(), 42));
+    EXPECT_EQ(reopened.size(), 500u);
+    for (uint64_t i = 1; i <= 500; ++i) {
+        ASSERT_TRUE(reopened.contains(i * 0x9e3779b97f4a7c15ULL));
+    }
+    // Open marks the file dirty until the next persist, as after a crash
+    reopened.close();
+    EXPECT_FALSE(reopened.open(path.string(), 42));
+
+    ASSERT_TRUE(filter.create(path.string(), 1000));
+    ASSERT_TRUE(filter.insert(7));
+    ASSERT_TRUE(filter.persist(1));
+    filter.close();
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(4096 + 100);
+        file.put('\x5a');
+    }
+    EXPECT_FALSE(reopened.open(path.string(), 1));
+    std::filesystem::remove(path);
+}
+
+class CrawlCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir_ = std::filesystem::temp_directory_path() / ("crawl_cache_test_" + std::to_string(getpid()));
+        std::filesystem::remove_all(dir_);
+        options_.directory = dir_.string();
+        options_.segmentBytes = 1 << 20;
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir_);
+    }
+
+    static CrawlPage page(const std::string& url, const std::string& markdown, double crawledAt,
+                          const std::string& domain = "example.com") {
+        return CrawlPage{url, domain, crawledAt, {{"markdown", markdown}, {"title", "Title of " + url}}};
+    }
+
+    std::filesystem::path dir_;
+    CrawlCacheOptions options_;
+};
+
+TEST_F(CrawlCacheTest, PutGetReplaceAndRemove) {
+    CrawlCache cache;
+    ASSERT_TRUE(cache.open(options_));
+    CrawlPage found;
+    EXPECT_FALSE(cache.get("https://a.org/1", found));
+
+    ASSERT_TRUE(cache.put(page("https://a.org/1", "first body", now())));
+    ASSERT_TRUE(cache.get("https://a.org/1", found));
+    EXPECT_EQ(found.url, "https://a.org/1");
+    EXPECT_EQ(found.sourceDomain, "example.com");
+    EXPECT_EQ(found.fields.at("markdown"), "first body");
+    EXPECT_EQ(found.fields.at("title"), "Title of https://a.org/1");
+
+    ASSERT_TRUE(cache.put(page("https://a.org/1", "second body", now())));
+    ASSERT_TRUE(cache.get("https://a.org/1", found));
+    EXPECT_EQ(found.fields.at("markdown"), "second body");
+    EXPECT_EQ(cache.stats().entries, 1u);
+
+    EXPECT_TRUE(cache.remove("https://a.org/1"));
+    EXPECT_FALSE(cache.remove("https://a.org/1"));
+    EXPECT_FALSE(cache.get("https://a.org/1", found));
+    EXPECT_EQ(cache.stats().entries, 0u);
+
+    CrawlCacheStats stats = cache.stats();
+    EXPECT_EQ(stats.hits, 2u);
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_EQ(stats.puts, 2u);
+}
+
+TEST_F(CrawlCacheTest, ChecksTtlAgainstCrawledAt) {
+    options_.ttlSeconds = 3600;
+    CrawlCache cache;
+    ASSERT_TRUE(cache.open(options_));
+    ASSERT_TRUE(cache.put(page("https://a.org/old", "stale", now() - 7200)));
+    ASSERT_TRUE(cache.put(page("https://a.org/new", "fresh", now() - 60)));
+
+    CrawlPage found;
+    EXPECT_FALSE(cache.get("https://a.org/old", found));
+    EXPECT_TRUE(cache.get("https://a.org/old", 86400, found));
+    EXPECT_TRUE(cache.get("https://a.org/new", found));
+    EXPECT_FALSE(cache.get("https://a.org/new", 30, found));
+    EXPECT_TRUE(cache.contains("https://a.org/new", 3600));
+    EXPECT_FALSE(cache.contains("https://a.org/old", 3600));
+    EXPECT_EQ(cache.countFresh(3600), 1u);
+    EXPECT_EQ(cache.stats().expired, 2u);
+}
+
+TEST_F(CrawlCacheTest, ReopenReplaysAndRollsSegments) {
+    options_.segmentBytes = 64 << 10;
+    std::mt19937 rng(1);
+    std::string body;
+    for (int i = 0; i < 3000; ++i) {
+        body += static_cast<char>('a' + rng() % 26);
+    }
+    {
+        CrawlCache cache;
+        ASSERT_TRUE(cache.open(options_));
+        for (int i = 0; i < 200; ++i) {
+            ASSERT_TRUE(cache.put(page("https://a.org/" + std::to_string(i), body + std::to_string(i), now(),
+                                       i % 3 ? "a.org" : "b.org")));
+        }
+        ASSERT_TRUE(cache.remove("https://a.org/7"));
+        EXPECT_GT(cache.stats().segments, 5u);
+    }
+
+    CrawlCache cache;
+    ASSERT_TRUE(cache.open(options_));
+    EXPECT_EQ(cache.stats().entries, 199u);
+    CrawlPage found;
+    EXPECT_FALSE(cache.get("https://a.org/7", found));
+    ASSERT_TRUE(cache.get("https://a.org/151", found));
+    EXPECT_EQ(found.fields.at("markdown"), body + "151");
+    EXPECT_EQ(found.sourceDomain, "a.org");
+
+    auto domains = cache.topDomains(5);
+    ASSERT_EQ(domains.size(), 2u);
+    EXPECT_EQ(domains[0], (std::pair<std::string, size_t>("a.org", 132)));
+    EXPECT_EQ(domains[1], (std::pair<std::string, size_t>("b.org", 67)));
+}
+
+TEST_F(CrawlCacheTest, TruncatesTornTail) {
+    {
+        CrawlCache cache;
+        ASSERT_TRUE(cache.open(options_));
+        ASSERT_TRUE(cache.put(page("https://a.org/1", "survives the crash", now())));
+        ASSERT_TRUE(cache.put(page("https://a.org/2", "torn by the crash", now())));
+    }
+    auto files = segmentFiles(dir_);
+    ASSERT_EQ(files.size(), 1u);
+    {
+        // Flip the last written byte, inside the second record
+        std::fstream file(files[0], std::ios::binary | std::ios::in | std::ios::out);
+        std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        size_t last = bytes.find_last_not_of('\0');
+        ASSERT_NE(last, std::string::npos);
+        file.seekp(static_cast<std::streamoff>(last));
+        file.put(static_cast<char>(bytes[last] ^ 0x5A));
+    }
+
+    CrawlCache cache;
+    ASSERT_TRUE(cache.open(options_));
+    CrawlPage found;
+    EXPECT_TRUE(cache.get("https://a.org/1", found));
+    EXPECT_FALSE(cache.get("https://a.org/2", found));
+    ASSERT_TRUE(cache.put(page("https://a.org/3", "written after the crash", now())));
+    cache.close();
+    ASSERT_TRUE(cache.open(options_));
+    EXPECT_EQ(cache.stats().entries, 2u);
+    EXPECT_TRUE(cache.get("https://a.org/3", found));
+}
+
+TEST_F(CrawlCacheTest, CompactionDropsExpiredAndReplacedRecords) {
+    options_.segmentBytes = 16 << 10;
+    options_.ttlSeconds = 3600;
+    std::mt19937 rng(2);
+    std::string body;
+    for (int i = 0; i < 2000; ++i) {
+        body += static_cast<char>('a' + rng() % 26);
+    }
+    CrawlCache cache;
+    ASSERT_TRUE(cache.open(options_));
+    for (int i = 0; i < 40; ++i) {
+        ASSERT_TRUE(cache.put(page("https://old.org/" + std::to_string(i), body, now() - 7200)));
+    }
+    for (int i = 0; i < 40; ++i) {
+        ASSERT_TRUE(cache.put(page("https://a.org/" + std::to_string(i), body, now())));
+    }
+    for (int i = 0; i < 20; ++i) {
+        ASSERT_TRUE(cache.put(page("https://a.org/" + std::to_string(i), "replaced", now())));
+    }
+    ASSERT_TRUE(cache.remove("https://a.org/39"));
+    const CrawlCacheStats before = cache.stats();
+
+    ASSERT_TRUE(cache.compact(true));
+    const CrawlCacheStats after = cache.stats();
+    EXPECT_EQ(after.compactions, 1u);
+    EXPECT_LT(after.segmentBytes, before.segmentBytes);
+    EXPECT_EQ(after.droppedRecords, 60u);
+    EXPECT_EQ(after.entries, 39u);
+
+    CrawlPage found;
+    for (int i = 0; i < 39; ++i) {
+        ASSERT_TRUE(cache.get("https://a.org/" + std::to_string(i), found)) << i;
+        EXPECT_EQ(found.fields.at("markdown"), i < 20 ? "replaced" : body);
+    }
+    EXPECT_FALSE(cache.get("https://a.org/39", found));
+    EXPECT_FALSE(cache.get("https://old.org/0", 86400, found));
+
+    // The removal must still hide the original put after a reopen
+    cache.close();
+    ASSERT_TRUE(cache.open(options_));
+    EXPECT_EQ(cache.stats().entries, 39u);
+    EXPECT_FALSE(cache.get("https://a.org/39", 86400, found));
+    EXPECT_TRUE(cache.get("https://a.org/5", found));
+}
+
+TEST_F(CrawlCacheTest, ClearDropsEverything) {
+    CrawlCache cache;
+    ASSERT_TRUE(cache.open(options_));
+    ASSERT_TRUE(cache.put(page("https://a.org/1", "body", now())));
+    ASSERT_TRUE(cache.clear());
+    CrawlPage found;
+    EXPECT_FALSE(cache.get("https://a.org/1", found));
+    EXPECT_EQ(cache.stats().entries, 0u);
+    EXPECT_EQ(segmentFiles(dir_).size(), 1u);
+    ASSERT_TRUE(cache.put(page("https://a.org/2", "body", now())));
+    cache.close();
+    ASSERT_TRUE(cache.open(options_));
+    EXPECT_EQ(cache.stats().entries, 1u);
+}
+
+TEST_F(CrawlCacheTest, ReadersRunDuringWritesAndCompaction) {
+    options_.segmentBytes = 32 << 10;
+    CrawlCache cache;
+    ASSERT_TRUE(cache.open(options_));
+    const int pages = 64;
+    for (int i = 0; i < pages; ++i) {
+        ASSERT_TRUE(cache.put(page("https://a.org/" + std::to_string(i), "v0 " + std::to_string(i), now())));
+    }
+
+    std::atomic<bool> stop(false);
+    std::atomic<int> wrong(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 3; ++t) {
+        readers.emplace_back([&, t] {
+            CrawlPage found;
+            std::mt19937 rng(t);
+            while (!stop.load()) {
+                const int i = static_cast<int>(rng() % pages);
+                const std::string url = "https://a.org/" + std::to_string(i);
+                if (!cache.get(url, found)) {
+                    ++wrong;
+                    continue;
+                }
+                const std::string& markdown = found.fields.at("markdown");
+                const std::string suffix = " " + std::to_string(i);
+                if (found.url != url || markdown.size() < suffix.size() ||
+                    markdown.compare(markdown.size() - suffix.size(), suffix.size(), suffix) != 0) {
+                    ++wrong;
+                }
+            }
+        });
+    }
+    for (int round = 1; round <= 30; ++round) {
+        for (int i = 0; i < pages; ++i) {
+            const std::string version = "v" + std::to_string(round) + std::string(200, 'p') + " " + std::to_string(i);
+            ASSERT_TRUE(cache.put(page("https://a.org/" + std::to_string(i), version, now())));
+        }
+        if (round % 5 == 0) {
+            ASSERT_TRUE(cache.compact(true));
+        }
+    }
+    stop = true;
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    EXPECT_EQ(wrong.load(), 0);
+    EXPECT_EQ(cache.stats().entries, static_cast<size_t>(pages));
+}
+
+TEST_F(CrawlCacheTest, TrainsDomainDictionariesAndRecompresses) {
+    options_.dictionarySamples = 16;
+    options_.dictionaryBytes = 8 << 10;
+    options_.segmentBytes = 16 << 10;
+    std::mt19937 rng(11);
+    std::vector<std::string> bodies;
+    {
+        CrawlCache cache;
+        ASSERT_TRUE(cache.open(options_));
+        for (int i = 0; i < 40; ++i) {
+            bodies.push_back(sitePage(rng, i));
+            ASSERT_TRUE(cache.put(page("https://a.org/" + std::to_string(i), bodies.back(), now(), "a.org")));
+        }
+        // Too few pages to train on
+        ASSERT_TRUE(cache.put(page("https://b.org/1", bodies[0], now(), "b.org")));
+        ASSERT_TRUE(cache.trainDictionaries());
+        EXPECT_EQ(cache.stats().dictionaries, 1u);
+        EXPECT_TRUE(std::filesystem::exists(dir_ / "dict-00000001.lzd"));
+
+        const uint64_t before = cache.stats().liveBytes;
+        for (int i = 40; i < 60; ++i) {
+            bodies.push_back(sitePage(rng, i));
+            ASSERT_TRUE(cache.put(page("https://a.org/" + std::to_string(i), bodies.back(), now(), "a.org")));
+        }
+        const uint64_t added = cache.stats().liveBytes - before;
+        EXPECT_LT(added / 20.0, before / 41.0 * 0.9);
+
+        // Pages put before the dictionary are rewritten with it
+        ASSERT_TRUE(cache.compact(true));
+        EXPECT_LT(cache.stats().liveBytes * 10, (before + added) * 9);
+        CrawlPage found;
+        ASSERT_TRUE(cache.get("https://a.org/3", found));
+        EXPECT_EQ(found.fields.at("markdown"), bodies[3]);
+        EXPECT_GT(cache.stats().decodedBytes, bodies[3].size());
+    }
+
+    CrawlCache cache;
+    ASSERT_TRUE(cache.open(options_));
+    EXPECT_EQ(cache.stats().dictionaries, 1u);
+    for (int i = 0; i < 60; ++i) {
+        CrawlPage found;
+        ASSERT_TRUE(cache.get("https://a.org/" + std::to_string(i), found));
+        EXPECT_EQ(found.fields.at("markdown"), bodies[i]);
+    }
+    CrawlPage found;
+    ASSERT_TRUE(cache.get("https://b.org/1", found));
+    EXPECT_EQ(found.fields.at("markdown"), bodies[0]);
+    cache.close();
+
+    // A damaged dictionary is skipped, and so are the pages compressed with it
+    {
+        std::fstream file(dir_ / "dict-00000001.lzd", std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(100);
+        file.put('\x7f');
+    }
+    ASSERT_TRUE(cache.open(options_));
+    EXPECT_EQ(cache.stats().dictionaries, 0u);
+    EXPECT_FALSE(cache.get("https://a.org/3", found));
+    EXPECT_TRUE(cache.get("https://b.org/1", found));
+}
+
+TEST_F(CrawlCacheTest, FilterAnswersMissesAndFollowsTheTable) {
+    options_.segmentBytes = 64 << 10;
+    options_.ttlSeconds = 3600;
+    CrawlCache cache;
+    ASSERT_TRUE(cache.open(options_));
+    for (int i = 0; i < 3000; ++i) {
+        ASSERT_TRUE(cache.put(page("https://a.org/" + std::to_string(i), "body " + std::to_string(i),
+                                   i < 500 ? now() - 7200 : now())));
+    }
+    CrawlPage found;
+    for (int i = 0; i < 3000; ++i) {
+        ASSERT_TRUE(cache.contains("https://a.org/" + std::to_string(i), 86400)) << i;
+    }
+    for (int i = 0; i < 5000; ++i) {
+        EXPECT_FALSE(cache.get("https://b.org/" + std::to_string(i), found));
+    }
+    CrawlCacheStats stats = cache.stats();
+    EXPECT_GT(stats.filterBytes, 0u);
+    EXPECT_GT(stats.filterLoad, 0.2);
+    EXPECT_LT(stats.filterLoad, 0.9);
+    EXPECT_EQ(stats.filterNegatives + stats.filterFalsePositives, 5000u);
+    EXPECT_LT(stats.filterFalsePositives, 10u);
+
+    // Removed and expired pages leave the filter
+    for (int i = 500; i < 600; ++i) {
+        ASSERT_TRUE(cache.remove("https://a.org/" + std::to_string(i)));
+    }
+    ASSERT_TRUE(cache.compact(true));
+    EXPECT_EQ(cache.stats().entries, 2400u);
+    const uint64_t negatives = cache.stats().filterNegatives;
+    for (int i = 0; i < 600; ++i) {
+        EXPECT_FALSE(cache.get("https://a.org/" + std::to_string(i), 86400, found));
+    }
+    EXPECT_GT(cache.stats().filterNegatives - negatives, 590u);
+
+    // A clean close keeps the filter; a segment that changed since makes open rebuild it
+    const std::filesystem::path filterFile = dir_ / "urls.cuckoo";
+    const ino_t written = inode(filterFile);
+    cache.close();
+    ASSERT_TRUE(cache.open(options_));
+    EXPECT_EQ(inode(filterFile), written);
+    EXPECT_TRUE(cache.get("https://a.org/700", found));
+    EXPECT_FALSE(cache.get("https://a.org/100", 86400, found));
+    ASSERT_TRUE(cache.put(page("https://a.org/new", "body", now())));
+    const ino_t reopened = inode(filterFile);
+    cache.close();
+    std::filesystem::resize_file(segmentFiles(dir_).back(), std::filesystem::file_size(segmentFiles(dir_).back()) + 1);
+    ASSERT_TRUE(cache.open(options_));
+    EXPECT_NE(inode(filterFile), reopened);
+    EXPECT_TRUE(cache.get("https://a.org/new", found));
+    EXPECT_EQ(cache.stats().entries, 2401u);
+
+    options_.filter = false;
+    cache.close();
+    ASSERT_TRUE(cache.open(options_));
+    EXPECT_EQ(cache.stats().filterBytes, 0u);
+    EXPECT_TRUE(cache.get("https://a.org/new", found));
+    EXPECT_FALSE(cache.get("https://b.org/1", found));
+}
+
+TEST_F(CrawlCacheTest, FilterRebuildsAfterPutsWithoutIt) {
+    CrawlCache cache;
+    ASSERT_TRUE(cache.open(options_));
+    ASSERT_TRUE(cache.put(page("https://a.org/1", "body", now())));
+    ASSERT_TRUE(cache.put(page("https://a.org/2", "body", now())));
+    cache.close();
+
+    // Same page count and segment file sizes: only the active segment's records changed
+    options_.filter = false;
+    ASSERT_TRUE(cache.open(options_));
+    ASSERT_TRUE(cache.remove("https://a.org/1"));
+    ASSERT_TRUE(cache.put(page("https://a.org/3", "body", now())));
+    cache.close();
+
+    options_.filter = true;
+    ASSERT_TRUE(cache.open(options_));
+    CrawlPage found;
+    EXPECT_TRUE(cache.contains("https://a.org/2", 86400));
+    EXPECT_TRUE(cache.contains("https://a.org/3", 86400));
+    EXPECT_TRUE(cache.get("https://a.org/3", found));
+    EXPECT_FALSE(cache.get("https://a.org/1", found));
+    EXPECT_EQ(cache.stats().entries, 2u);
+}
+
+TEST_F(CrawlCacheTest, ServiceMatchesCrawlerContract) {
+    std::filesystem::create_directories(dir_);
+    {
+        std::ofstream env(dir_ / "cache.env");
+        env << "CRAWL_CACHE_DIR=" << (dir_ / "cache").string() << "\nCRAWL_CACHE_TTL=3600\n";
+    }
+    ConfigManager config;
+    ASSERT_TRUE(config.load((dir_ / "cache.env").string()));
+    CrawlCacheService service;
+    ASSERT_TRUE(service.initialize(config));
+    Microservice microservice;
+    HttpServer server(microservice);
+    service.registerRoutes(server);
+
+    EXPECT_EQ(server.dispatch("GET", "/cache/page", R"({"url": "https://a.org/x"})"), "{\"hit\": false}");
+    EXPECT_EQ(server.dispatch("POST", "/cache/put", R"({"title": "no url"})"), "{\"error\": \"url is required\"}");
+    EXPECT_EQ(server.dispatch("POST", "/cache/put",
+                              R"({"url": "https://a.org/x", "markdown": "# Hello", "title": "Hello",
+                                  "word_count": 2, "success": true, "crawled_at": )" +
+                                  std::to_string(now() - 60) +
+                                  R"(, "source_domain": "a.org", "headers": {"content-type": "text/html"}})"),
+              "{\"stored\": true}");
+
+    std::string hit = server.dispatch("GET", "/cache/page", R"({"url": "https://a.org/x"})");
+    EXPECT_EQ(hit.find("{\"hit\": true, \"url\": \"https://a.org/x\", \"content\": null, \"markdown\": \"# Hello\", "
+                       "\"title\": \"Hello\", \"author\": null"),
+              0u)
+        << hit;
+    EXPECT_NE(hit.find("\"word_count\": 2, \"success\": true, \"crawled_at\": "), std::string::npos) << hit;
+    EXPECT_NE(hit.find("\"headers_json\": \"{\\\"content-type\\\": \\\"text/html\\\"}\", \"source_domain\": "
+                       "\"a.org\"}"),
+              std::string::npos)
+        << hit;
+    EXPECT_EQ(server.dispatch("GET", "/cache/page", R"({"url": "https://a.org/x", "ttl": 10})"), "{\"hit\": false}");
+    EXPECT_EQ(server.dispatch("GET", "/cache/contains", R"({"url": "https://a.org/x"})"), "{\"cached\": true}");
+    EXPECT_EQ(server.dispatch("GET", "/cache/contains", R"({"url": "https://a.org/x", "ttl": 10})"),
+              "{\"cached\": false}");
+    EXPECT_EQ(server.dispatch("GET", "/cache/contains", R"({"url": "https://a.org/y"})"), "{\"cached\": false}");
+
+    std::string stats = server.dispatch("GET", "/cache/stats", "");
+    EXPECT_EQ(stats.find("{\"total_entries\": 1, \"fresh_entries\": 1, \"domains\": [{\"domain\": \"a.org\", "
+                         "\"count\": 1}], \"segments\": 1"),
+              0u)
+        << stats;
+    EXPECT_NE(stats.find("\"dictionaries\": 0, \"decoded_bytes\": "), std::string::npos) << stats;
+    EXPECT_NE(stats.find("\"filter_negatives\": 2, \"filter_false_positives\": 0"), std::string::npos) << stats;
+    EXPECT_EQ(server.dispatch("POST", "/cache/delete", R"({"url": "https://a.org/x"})"), "{\"deleted\": true}");
+    EXPECT_EQ(server.dispatch("POST", "/cache/delete", R"({"url": "https://a.org/x"})"), "{\"deleted\": false}");
+    EXPECT_NE(server.dispatch("POST", "/cache/compact", R"({"force": "true"})").find("\"total_entries\": 0"),
+              std::string::npos);
+    EXPECT_EQ(server.dispatch("POST", "/cache/clear", ""), "{\"cleared\": true}");
+    service.shutdown();
+}
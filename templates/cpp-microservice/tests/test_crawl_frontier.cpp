@@ -0,0 +1,311 @@
+#include <gtest/gtest.h>
+#include "../include/config_manager.h"
+#include "../include/crawl_frontier.h"
+#include "../include/crawl_frontier_service.h"
+#include "../include/microservice.h"
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <unistd.h>
+
+namespace {
+
+std::string url(int host, int page) {
+    return "https://site" + std::to_string(host) + ".com/page/" + std::to_string(page);
+}
+
+// Lease everything ready at each millisecond up to @p end, finishing every lease at once
+std::vector<std::pair<uint64_t, FrontierLease>> drain(CrawlFrontier& frontier, uint64_t start, uint64_t end) {
+    std::vector<std::pair<uint64_t, FrontierLease>> log;
+    std::vector<FrontierLease> leases;
+    for (uint64_t now = start; now <= end; ++now) {
+        leases.clear();
+        frontier.lease(1000, now, leases);
+        for (FrontierLease& lease : leases) {
+            EXPECT_TRUE(frontier.finish(lease.host, now));
+            log.emplace_back(now, std::move(lease));
+        }
+    }
+    return log;
+}
+
+} // namespace
+
+TEST(TimerWheelTest, FiresEveryTimerOnItsTick) {
+    std::mt19937_64 rng(7);
+    TimerWheel wheel(1000);
+    std::map<uint64_t, uint64_t> expected;    // payload -> due
+    for (uint64_t i = 0; i < 20000; ++i) {
+        // Mostly near, some a few levels out, some past the wheel's 2^32-tick span
+        const int scale = static_cast<int>(rng() % 5);
+        const uint64_t delay = 1 + rng() % (uint64_t(1) << (scale == 4 ? 34 : 6 + scale * 6));
+        wheel.schedule(1000 + delay, i);
+        expected[i] = 1000 + delay;
+    }
+    EXPECT_EQ(wheel.size(), 20000u);
+
+    std::vector<TimerWheel::Timer> fired;
+    uint64_t now = 1000;
+    size_t count = 0;
+    while (wheel.size() > 0) {
+        // Small steps near the start, then large jumps
+        const uint64_t step = now < 100000 ? 1 + rng() % 300 : 1 + rng() % (uint64_t(1) << 31);
+        const uint64_t previous = now;
+        now += step;
+        fired.clear();
+        wheel.advance(now, fired);
+        for (size_t i = 0; i < fired.size(); ++i) {
+            EXPECT_EQ(fired[i].due, expected[fired[i].payload]);
+            EXPECT_GT(fired[i].due, previous);
+            EXPECT_LE(fired[i].due, now);
+            if (i > 0) {
+                EXPECT_LE(fired[i - 1].due, fired[i].due);
+            }
+        }
+        count += fired.size();
+    }
+    EXPECT_EQ(count, 20000u);
+    EXPECT_EQ(wheel.now(), now);
+}
+
+TEST(TimerWheelTest, NextWaitNeverOversleeps) {
+    TimerWheel wheel(250);
+    EXPECT_EQ(wheel.nextWait(), 0u);
+    wheel.schedule(253, 1);
+    wheel.schedule(900, 2);
+    wheel.schedule(70000, 3);
+    EXPECT_EQ(wheel.nextWait(), 3u);
+
+    // Sleeping nextWait() ticks at a time reaches every timer on its tick
+    std::vector<TimerWheel::Timer> fired;
+    std::vector<uint64_t> firedAt;
+    while (wheel.size() > 0) {
+        const uint64_t wait = wheel.nextWait();
+        ASSERT_GT(wait, 0u);
+        fired.clear();
+        wheel.advance(wheel.now() + wait, fired);
+        for (const TimerWheel::Timer& timer : fired) {
+            EXPECT_EQ(timer.due, wheel.now());
+            firedAt.push_back(timer.due);
+        }
+    }
+    EXPECT_EQ(firedAt, (std::vector<uint64_t>{253, 900, 70000}));
+
+    // A timer already due fires on the next tick
+    wheel.schedule(5, 4);
+    fired.clear();
+    wheel.advance(wheel.now() + 1, fired);
+    ASSERT_EQ(fired.size(), 1u);
+    EXPECT_EQ(fired[0].payload, 4u);
+}
+
+TEST(CrawlFrontierTest, HostOfMatchesUrlparseHostname) {
+    EXPECT_EQ(CrawlFrontier::hostOf("https://Example.COM/a?b"), "example.com");
+    EXPECT_EQ(CrawlFrontier::hostOf("http://user:pw@example.com:8080/"), "example.com");
+    EXPECT_EQ(CrawlFrontier::hostOf("http://example.com./x"), "example.com");
+    EXPECT_EQ(CrawlFrontier::hostOf("http://[::1]:8080/x"), "::1");
+    EXPECT_EQ(CrawlFrontier::hostOf("https://example.com#frag"), "example.com");
+    EXPECT_EQ(CrawlFrontier::hostOf("example.com/a"), "");
+    EXPECT_EQ(CrawlFrontier::hostOf("https:///a"), "");
+}
+
+TEST(CrawlFrontierTest, KeepsEveryHostAtItsInterval) {
+    CrawlFrontierOptions options;
+    options.domainIntervalMillis = 100;
+    CrawlFrontier frontier(options);
+    for (int page = 0; page < 20; ++page) {
+        for (int host = 0; host < 50; ++host) {
+            ASSERT_TRUE(frontier.push(url(host, page), CrawlPriority::Batch, 0));
+        }
+    }
+    EXPECT_FALSE(frontier.push("not a url", CrawlPriority::Batch, 0));
+    EXPECT_EQ(frontier.stats().queued, 1000u);
+    EXPECT_EQ(frontier.stats().readyDomains, 50u);
+
+    const auto log = drain(frontier, 0, 2500);
+    ASSERT_EQ(log.size(), 1000u);
+    std::map<std::string, std::vector<std::pair<uint64_t, std::string>>> byHost;
+    for (const auto& entry : log) {
+        byHost[entry.second.host].emplace_back(entry.first, entry.second.url);
+    }
+    ASSERT_EQ(byHost.size(), 50u);
+    for (const auto& host : byHost) {
+        ASSERT_EQ(host.second.size(), 20u);
+        for (size_t i = 0; i < host.second.size(); ++i) {
+            // Each host runs exactly at its limit, in push order
+            EXPECT_EQ(host.second[i].first, i * 100);
+            EXPECT_EQ(host.second[i].second.substr(host.second[i].second.rfind('/') + 1), std::to_string(i));
+        }
+    }
+    CrawlFrontierStats stats = frontier.stats();
+    EXPECT_EQ(stats.queued, 0u);
+    EXPECT_EQ(stats.leased, 0u);
+    EXPECT_EQ(stats.leases, 1000u);
+    EXPECT_EQ(stats.maxWaitMillis, 1900u);
+    // Idle hosts are forgotten once their interval has run out
+    EXPECT_EQ(stats.domains, 0u);
+    EXPECT_EQ(frontier.waitMillis(2500), -1);
+}
+
+TEST(CrawlFrontierTest, LimitsLeasesOutPerHost) {
+    CrawlFrontierOptions options;
+    options.domainIntervalMillis = 0;
+    options.domainConcurrency = 2;
+    CrawlFrontier frontier(options);
+    for (int page = 0; page < 5; ++page) {
+        ASSERT_TRUE(frontier.push(url(1, page), CrawlPriority::Batch, 0));
+    }
+    ASSERT_TRUE(frontier.push(url(2, 0), CrawlPriority::Batch, 0));
+
+    std::vector<FrontierLease> leases;
+    EXPECT_EQ(frontier.lease(10, 0, leases), 3u);
+    EXPECT_EQ(frontier.lease(10, 5, leases), 0u);
+    // Nothing becomes ready by waiting while site1 is at its limit
+    EXPECT_EQ(frontier.waitMillis(5), -1);
+    EXPECT_FALSE(frontier.finish("site3.com", 5));
+    EXPECT_TRUE(frontier.finish("site1.com", 5));
+    EXPECT_EQ(frontier.waitMillis(5), 0);
+    EXPECT_EQ(frontier.lease(10, 5, leases), 1u);
+    EXPECT_EQ(leases.back().url, url(1, 2));
+    EXPECT_EQ(frontier.stats().leased, 3u);
+}
+
+TEST(CrawlFrontierTest, WeighsClassesWithoutStarvingAny) {
+    CrawlFrontierOptions options;
+    options.domainIntervalMillis = 0;
+    CrawlFrontier frontier(options);
+    const CrawlPriority classes[] = {CrawlPriority::Interactive, CrawlPriority::Batch, CrawlPriority::Background};
+    for (int c = 0; c < 3; ++c) {
+        for (int i = 0; i < (c == 0 ? 800 : 1000); ++i) {
+            ASSERT_TRUE(frontier.push(url(c * 1000 + i % 100, i), classes[c], 0));
+        }
+    }
+
+    // One lease at a time: shares follow the 16:4:1 weights, and every window of 21 serves each class
+    std::vector<FrontierLease> leases;
+    int counts[3] = {0, 0, 0};
+    for (int i = 0; i < 1050; ++i) {
+        leases.clear();
+        ASSERT_EQ(frontier.lease(1, 0, leases), 1u);
+        ++counts[static_cast<int>(leases[0].priority)];
+        frontier.finish(leases[0].host, 0);
+        if (i % 21 == 20) {
+            EXPECT_EQ(counts[0], (i + 1) / 21 * 16);
+            EXPECT_EQ(counts[1], (i + 1) / 21 * 4);
+            EXPECT_EQ(counts[2], (i + 1) / 21);
+        }
+    }
+
+    // Interactive ran dry on the last window; the others are all still there
+    const auto log = drain(frontier, 1, 100);
+    int rest[3] = {0, 0, 0};
+    for (const auto& entry : log) {
+        ++rest[static_cast<int>(entry.second.priority)];
+    }
+    EXPECT_EQ(rest[0], 0);
+    EXPECT_EQ(rest[1], 800);
+    EXPECT_EQ(rest[2], 950);
+}
+
+TEST(CrawlFrontierTest, HoldsDelayedUrlsAndCustomIntervals) {
+    CrawlFrontierOptions options;
+    options.domainIntervalMillis = 10;
+    CrawlFrontier frontier(options);
+    frontier.setDomainInterval("slow.org", 5000);
+    ASSERT_TRUE(frontier.push("https://slow.org/1", CrawlPriority::Batch, 100));
+    ASSERT_TRUE(frontier.push("https://slow.org/2", CrawlPriority::Batch, 100));
+    ASSERT_TRUE(frontier.push("https://fast.org/later", CrawlPriority::Background, 100, 86400000));
+    EXPECT_EQ(frontier.stats().delayed, 1u);
+
+    std::vector<FrontierLease> leases;
+    EXPECT_EQ(frontier.lease(10, 100, leases), 1u);
+    EXPECT_TRUE(frontier.finish("slow.org", 150));
+    EXPECT_EQ(frontier.waitMillis(150), 4950);
+    EXPECT_EQ(frontier.lease(10, 5099, leases), 0u);
+    EXPECT_EQ(frontier.lease(10, 5100, leases), 1u);
+    EXPECT_EQ(leases.back().url, "https://slow.org/2");
+    EXPECT_EQ(leases.back().waitedMillis, 5000u);
+    EXPECT_TRUE(frontier.finish("slow.org", 5100));
+
+    // The delayed URL comes out a day later, waited from when it came due
+    EXPECT_EQ(frontier.lease(10, 86400099, leases), 0u);
+    EXPECT_EQ(frontier.stats().domains, 1u);
+    EXPECT_EQ(frontier.lease(10, 86400100, leases), 1u);
+    EXPECT_EQ(leases.back().url, "https://fast.org/later");
+    EXPECT_EQ(leases.back().waitedMillis, 0u);
+
+    // The interval outlives the forgotten host
+    EXPECT_TRUE(frontier.finish("fast.org", 86400100));
+    ASSERT_TRUE(frontier.push("https://slow.org/3", CrawlPriority::Batch, 86400100));
+    ASSERT_TRUE(frontier.push("https://slow.org/4", CrawlPriority::Batch, 86400100));
+    EXPECT_EQ(frontier.lease(10, 86400100, leases), 1u);
+    EXPECT_TRUE(frontier.finish("slow.org", 86400100));
+    EXPECT_EQ(frontier.waitMillis(86400100), 5000);
+}
+
+TEST(CrawlFrontierTest, RefusesPastMaxPending) {
+    CrawlFrontierOptions options;
+    options.maxPending = 3;
+    CrawlFrontier frontier(options);
+    EXPECT_TRUE(frontier.push(url(1, 0), CrawlPriority::Batch, 0));
+    EXPECT_TRUE(frontier.push(url(1, 1), CrawlPriority::Batch, 0, 50));
+    EXPECT_TRUE(frontier.push(url(2, 0), CrawlPriority::Batch, 0));
+    EXPECT_FALSE(frontier.push(url(3, 0), CrawlPriority::Batch, 0));
+    EXPECT_EQ(frontier.stats().rejected, 1u);
+    std::vector<FrontierLease> leases;
+    EXPECT_EQ(frontier.lease(10, 0, leases), 2u);
+    EXPECT_TRUE(frontier.push(url(3, 0), CrawlPriority::Batch, 0));
+}
+
+TEST(CrawlFrontierTest, ServiceMatchesBatchCrawlContract) {
+    const std::filesystem::path env =
+        std::filesystem::temp_directory_path() / ("frontier_" + std::to_string(getpid()) + ".env");
+    {
+        std::ofstream out(env);
+        out << "FRONTIER_DOMAIN_INTERVAL_MS=60000\nFRONTIER_WEIGHT_BACKGROUND=2\n";
+    }
+    ConfigManager config;
+    ASSERT_TRUE(config.load(env.string()));
+    std::filesystem::remove(env);
+    CrawlFrontierService service;
+    ASSERT_TRUE(service.initialize(config));
+    EXPECT_EQ(service.frontier().options().domainIntervalMillis, 60000u);
+    EXPECT_EQ(service.frontier().options().classWeights[2], 2u);
+    Microservice microservice;
+    HttpServer server(microservice);
+    service.registerRoutes(server);
+
+    EXPECT_EQ(server.dispatch("POST", "/frontier/push", "{}"), "{\"error\": \"url or urls.<i> required\"}");
+    EXPECT_EQ(server.dispatch("POST", "/frontier/push", R"({"url": "https://a.org/", "priority": "urgent"})"),
+              "{\"error\": \"priority must be interactive, batch or background\"}");
+    EXPECT_EQ(server.dispatch("POST", "/frontier/push",
+                              R"({"urls": ["https://a.org/1", "https://a.org/2", "nope", "https://b.org/1"]})"),
+              "{\"queued\": 3, \"rejected\": [\"nope\"]}");
+    EXPECT_EQ(server.dispatch("POST", "/frontier/push", R"({"url": "https://c.org/", "delay_ms": 60000})"),
+              "{\"queued\": 1, \"rejected\": []}");
+    EXPECT_EQ(server.dispatch("POST", "/frontier/lease", R"({"max": 0})"),
+              "{\"error\": \"max must be within [1, 1000]\"}");
+
+    // One URL per host now; the second a.org URL waits out the interval
+    const std::string leased = server.dispatch("POST", "/frontier/lease", R"({"max": 10})");
+    EXPECT_NE(leased.find("{\"url\": \"https://a.org/1\", \"host\": \"a.org\", \"priority\": \"batch\""),
+              std::string::npos);
+    EXPECT_NE(leased.find("\"url\": \"https://b.org/1\""), std::string::npos);
+    EXPECT_EQ(leased.find("https://a.org/2"), std::string::npos);
+    EXPECT_EQ(leased.find("\"wait_ms\": -1"), std::string::npos);
+    EXPECT_EQ(leased.find("\"wait_ms\": 0"), std::string::npos);
+
+    EXPECT_EQ(server.dispatch("POST", "/frontier/done", R"({"url": "https://a.org/1"})"), "{\"released\": true}");
+    EXPECT_EQ(server.dispatch("POST", "/frontier/done", R"({"host": "a.org"})"), "{\"released\": false}");
+    EXPECT_EQ(server.dispatch("POST", "/frontier/done", "{}"), "{\"error\": \"host or url is required\"}");
+    EXPECT_EQ(server.dispatch("POST", "/frontier/domain", R"({"host": "a.org", "interval_ms": 0})"),
+              "{\"host\": \"a.org\", \"interval_ms\": 60000}");
+    EXPECT_EQ(server.dispatch("POST", "/frontier/domain", R"({"host": "a.org"})"),
+              "{\"error\": \"host and a non-negative interval_ms are required\"}");
+
+    const std::string stats = server.dispatch("GET", "/frontier/stats", "");
+    EXPECT_NE(stats.find("\"queued\": 1, \"delayed\": 1, \"leased\": 1, \"domains\": 3"), std::string::npos);
+    EXPECT_NE(stats.find("\"leases_by_priority\": {\"interactive\": 0, \"batch\": 2, \"background\": 0}"),
+              std::string::npos);
+}
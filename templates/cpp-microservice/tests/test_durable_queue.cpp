@@ -0,0 +1,453 @@
+#include <gtest/gtest.h>
+#include "../include/config_manager.h"
+#include "../include/durable_queue.h"
+#include "../include/forward_queue_service.h"
+#include "../include/json_parser.h"
+#include "../include/microservice.h"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <thread>
+#include <csignal>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace {
+
+std::string message(int n) {
+    return "{\"url\": \"https://example.com/" + std::to_string(n) + "\", \"markdown\": \"" + std::string(n % 300, 'm') +
+           "\"}";
+}
+
+} // namespace
+
+class DurableQueueTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir_ = std::filesystem::temp_directory_path() / ("durable_queue_test_" + std::to_string(getpid()));
+        std::filesystem::remove_all(dir_);
+        options_.directory = (dir_ / "queue").string();
+        options_.segmentBytes = 4096;
+    }
+
+    void TearDown() override { std::filesystem::remove_all(dir_); }
+
+    std::filesystem::path dir_;
+    DurableQueueOptions options_;
+};
+
+TEST_F(DurableQueueTest, DeliversInOrderAndDropsDoneSegments) {
+    DurableQueue queue;
+    ASSERT_TRUE(queue.open(options_));
+    for (int i = 1; i <= 100; ++i) {
+        ASSERT_EQ(queue.append(message(i)), static_cast<uint64_t>(i));
+    }
+    DurableQueueStats stats = queue.stats();
+    EXPECT_EQ(stats.backlog, 100u);
+    EXPECT_GT(stats.segments, 2u);
+
+    std::vector<QueueMessage> out;
+    EXPECT_EQ(queue.poll(30, 0, out), 30u);
+    EXPECT_EQ(queue.poll(100, 0, out), 70u);
+    EXPECT_EQ(queue.poll(100, 0, out), 0u);
+    EXPECT_EQ(queue.waitMillis(0), -1);
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(out[i].seq, static_cast<uint64_t>(i + 1));
+        EXPECT_EQ(out[i].payload, message(i + 1));
+        EXPECT_EQ(out[i].attempts, 0u);
+    }
+
+    // Acks out of order: the offset stops at the oldest message still out
+    for (int i = 99; i >= 50; --i) {
+        EXPECT_TRUE(queue.ack(out[i].seq));
+    }
+    EXPECT_FALSE(queue.ack(out[99].seq));
+    EXPECT_FALSE(queue.ack(1000));
+    ASSERT_TRUE(queue.sync());
+    EXPECT_EQ(queue.stats().consumerOffset, 1u);
+    for (int i = 0; i < 50; ++i) {
+        EXPECT_TRUE(queue.ack(out[i].seq));
+    }
+    ASSERT_TRUE(queue.sync());
+    stats = queue.stats();
+    EXPECT_EQ(stats.backlog, 0u);
+    EXPECT_EQ(stats.consumerOffset, 101u);
+    EXPECT_EQ(stats.acked, 100u);
+    EXPECT_EQ(stats.segments, 1u);
+    queue.close();
+
+    // Numbering carries on after a reopen
+    ASSERT_TRUE(queue.open(options_));
+    EXPECT_EQ(queue.stats().backlog, 0u);
+    EXPECT_EQ(queue.append(message(101)), 101u);
+    out.clear();
+    EXPECT_EQ(queue.poll(10, 0, out), 1u);
+    EXPECT_EQ(out[0].payload, message(101));
+}
+
+TEST_F(DurableQueueTest, RedeliversUnackedMessagesAfterReopen) {
+    options_.offsetInterval = 10;
+    DurableQueue queue;
+    ASSERT_TRUE(queue.open(options_));
+    for (int i = 1; i <= 40; ++i) {
+        ASSERT_GT(queue.append(message(i)), 0u);
+    }
+    std::vector<QueueMessage> out;
+    ASSERT_EQ(queue.poll(40, 0, out), 40u);
+    for (int i = 0; i < 25; ++i) {
+        ASSERT_TRUE(queue.ack(out[i].seq));
+    }
+
+    // A copy taken while open is what a crash leaves: the offset persisted at the 20th ack
+    const std::filesystem::path crashed = dir_ / "crashed";
+    std::filesystem::copy(options_.directory, crashed);
+    queue.close();
+
+    ASSERT_TRUE(queue.open(options_));
+    std::vector<QueueMessage> pending;
+    queue.pending(100, pending);
+    ASSERT_EQ(pending.size(), 15u);
+    EXPECT_EQ(pending.front().seq, 26u);
+    queue.close();
+
+    DurableQueueOptions copy = options_;
+    copy.directory = crashed.string();
+    ASSERT_TRUE(queue.open(copy));
+    EXPECT_EQ(queue.stats().backlog, 20u);
+    out.clear();
+    ASSERT_EQ(queue.poll(100, 0, out), 20u);
+    EXPECT_EQ(out.front().seq, 21u);
+    EXPECT_EQ(out.front().payload, message(21));
+}
+
+TEST_F(DurableQueueTest, TruncatesTornTail) {
+    DurableQueue queue;
+    ASSERT_TRUE(queue.open(options_));
+    for (int i = 1; i <= 3; ++i) {
+        ASSERT_GT(queue.append(message(i)), 0u);
+    }
+    queue.close();
+    std::string last;
+    for (const auto& entry : std::filesystem::directory_iterator(options_.directory)) {
+        if (entry.path().extension() == ".log" && entry.path().filename() != "dead.log") {
+            last = std::max(last, entry.path().string());
+        }
+    }
+    {
+        std::ofstream out(last, std::ios::binary | std::ios::app);
+        out << std::string(50, '\x7f');
+    }
+
+    ASSERT_TRUE(queue.open(options_));
+    EXPECT_EQ(queue.stats().backlog, 3u);
+    EXPECT_EQ(queue.append(message(4)), 4u);
+    std::vector<QueueMessage> out;
+    ASSERT_EQ(queue.poll(10, 0, out), 4u);
+    EXPECT_EQ(out.back().payload, message(4));
+}
+
+TEST_F(DurableQueueTest, BacksOffExponentiallyThenDeadLetters) {
+    options_.backoffMillis = 100;
+    options_.maxBackoffMillis = 250;
+    options_.maxAttempts = 4;
+    DurableQueue queue;
+    ASSERT_TRUE(queue.open(options_));
+    ASSERT_EQ(queue.append(message(1)), 1u);
+
+    std::vector<QueueMessage> out;
+    uint64_t now = 1000;
+    ASSERT_EQ(queue.poll(10, now, out), 1u);
+    const uint64_t waits[] = {100, 200, 250};
+    for (uint64_t wait : waits) {
+        ASSERT_TRUE(queue.nack(out.back().seq, now));
+        // A fresh message is not held up behind the retry
+        const uint64_t fresh = queue.append(message(static_cast<int>(wait)));
+        out.clear();
+        ASSERT_EQ(queue.poll(10, now, out), 1u);
+        EXPECT_EQ(out[0].seq, fresh);
+        EXPECT_TRUE(queue.ack(fresh));
+        EXPECT_EQ(queue.stats().waiting, 1u);
+        EXPECT_GT(queue.waitMillis(now), 0);
+
+        out.clear();
+        EXPECT_EQ(queue.poll(10, now + wait - 1, out), 0u);
+        ASSERT_EQ(queue.poll(10, now + wait, out), 1u);
+        EXPECT_EQ(out[0].payload, message(1));
+        now += wait;
+    }
+    EXPECT_EQ(out.back().attempts, 3u);
+    ASSERT_TRUE(queue.nack(out.back().seq, now));
+    DurableQueueStats stats = queue.stats();
+    EXPECT_EQ(stats.deadLetters, 1u);
+    EXPECT_EQ(stats.retried, 3u);
+    EXPECT_EQ(stats.backlog, 0u);
+    EXPECT_EQ(queue.waitMillis(now), -1);
+    EXPECT_GT(std::filesystem::file_size(std::filesystem::path(options_.directory) / "dead.log"), 0u);
+
+    // retryNow() skips the rest of a backoff
+    ASSERT_GT(queue.append(message(7)), 0u);
+    out.clear();
+    ASSERT_EQ(queue.poll(1, now, out), 1u);
+    ASSERT_TRUE(queue.nack(out[0].seq, now));
+    out.clear();
+    EXPECT_EQ(queue.poll(1, now, out), 0u);
+    EXPECT_EQ(queue.retryNow(), 1u);
+    ASSERT_EQ(queue.poll(1, now, out), 1u);
+    EXPECT_EQ(out[0].attempts, 1u);
+}
+
+TEST_F(DurableQueueTest, RedeliversMessagesWhoseNackCouldNotBeWritten) {
+    options_.backoffMillis = 100;
+    DurableQueue queue;
+    ASSERT_TRUE(queue.open(options_));
+    for (int i = 1; i <= 3; ++i) {
+        ASSERT_GT(queue.append(message(i)), 0u);
+    }
+    std::vector<QueueMessage> out;
+    ASSERT_EQ(queue.poll(10, 1000, out), 3u);
+
+    // A file size limit at the log's current size makes the retry append fail, as a full disk would
+    rlimit saved;
+    ASSERT_EQ(getrlimit(RLIMIT_FSIZE, &saved), 0);
+    signal(SIGXFSZ, SIG_IGN);
+    rlimit limit = saved;
+    limit.rlim_cur = static_cast<rlim_t>(queue.stats().segmentBytes);
+    ASSERT_EQ(setrlimit(RLIMIT_FSIZE, &limit), 0);
+    const bool nacked = queue.nack(1, 1000);
+    ASSERT_EQ(setrlimit(RLIMIT_FSIZE, &saved), 0);
+    signal(SIGXFSZ, SIG_DFL);
+    EXPECT_FALSE(nacked);
+
+    DurableQueueStats stats = queue.stats();
+    EXPECT_EQ(stats.retried, 0u);
+    EXPECT_EQ(stats.inflight, 2u);
+    EXPECT_EQ(stats.waiting, 1u);
+    EXPECT_EQ(stats.appended, 3u);
+    EXPECT_FALSE(queue.ack(1));
+
+    // It comes back after its backoff, from memory, and the offset moves past it once it is done
+    EXPECT_TRUE(queue.ack(2));
+    EXPECT_TRUE(queue.ack(3));
+    out.clear();
+    EXPECT_EQ(queue.poll(10, 1099, out), 0u);
+    ASSERT_EQ(queue.poll(10, 1100, out), 1u);
+    EXPECT_EQ(out[0].seq, 1u);
+    EXPECT_EQ(out[0].attempts, 1u);
+    EXPECT_EQ(out[0].payload, message(1));
+    EXPECT_TRUE(queue.ack(1));
+    ASSERT_TRUE(queue.sync());
+    stats = queue.stats();
+    EXPECT_EQ(stats.backlog, 0u);
+    EXPECT_EQ(stats.waiting, 0u);
+    EXPECT_EQ(stats.consumerOffset, 4u);
+}
+
+TEST_F(DurableQueueTest, ReadsPastRetriesBeyondTheHeldCap) {
+    options_.maxHeldRetries = 4;
+    options_.backoffMillis = 60000;
+    DurableQueue queue;
+    ASSERT_TRUE(queue.open(options_));
+    for (int i = 1; i <= 10; ++i) {
+        ASSERT_GT(queue.append(message(i)), 0u);
+    }
+    std::vector<QueueMessage> out;
+    ASSERT_EQ(queue.poll(10, 1000, out), 10u);
+    for (const QueueMessage& m : out) {
+        ASSERT_TRUE(queue.nack(m.seq, 1000));
+    }
+
+    // Ten retries are waiting, six of them only as places in the log; fresh messages still go out
+    for (int i = 11; i <= 15; ++i) {
+        ASSERT_GT(queue.append(message(i)), 0u);
+    }
+    out.clear();
+    ASSERT_EQ(queue.poll(20, 2000, out), 5u);
+    for (int i = 0; i < 5; ++i) {
+        EXPECT_EQ(out[i].payload, message(11 + i));
+        EXPECT_TRUE(queue.ack(out[i].seq));
+    }
+    EXPECT_EQ(queue.stats().waiting, 10u);
+    std::vector<QueueMessage> pending;
+    queue.pending(100, pending);
+    ASSERT_EQ(pending.size(), 10u);
+    EXPECT_EQ(pending[9].payload, message(10));
+
+    EXPECT_EQ(queue.retryNow(), 10u);
+    out.clear();
+    ASSERT_EQ(queue.poll(20, 2000, out), 10u);
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(out[i].payload, message(1 + i));
+        EXPECT_EQ(out[i].attempts, 1u);
+        EXPECT_TRUE(queue.ack(out[i].seq));
+    }
+    const DurableQueueStats stats = queue.stats();
+    EXPECT_EQ(stats.backlog, 0u);
+    EXPECT_EQ(stats.waiting, 0u);
+    EXPECT_EQ(stats.inflight, 0u);
+}
+
+TEST_F(DurableQueueTest, ConcurrentAppendersShareSyncs) {
+    options_.segmentBytes = 64u << 10;
+    DurableQueue queue;
+    ASSERT_TRUE(queue.open(options_));
+    std::vector<std::thread> threads;
+    std::vector<std::vector<uint64_t>> seqs(8);
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&queue, &seqs, t] {
+            for (int i = 0; i < 100; ++i) {
+                seqs[t].push_back(queue.append(message(t * 100 + i)));
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    std::set<uint64_t> unique;
+    for (const auto& list : seqs) {
+        for (uint64_t seq : list) {
+            EXPECT_GT(seq, 0u);
+            unique.insert(seq);
+        }
+    }
+    EXPECT_EQ(unique.size(), 800u);
+    DurableQueueStats stats = queue.stats();
+    EXPECT_EQ(stats.appended, 800u);
+    EXPECT_LE(stats.syncs, 800u);
+    queue.close();
+    ASSERT_TRUE(queue.open(options_));
+    EXPECT_EQ(queue.stats().backlog, 800u);
+}
+
+TEST_F(DurableQueueTest, DeliveryThreadRetriesUntilTheSenderSucceeds) {
+    options_.backoffMillis = 1;
+    options_.maxBackoffMillis = 4;
+    DurableQueue queue;
+    ASSERT_TRUE(queue.open(options_));
+    std::atomic<int> calls(0);
+    std::mutex mutex;
+    std::set<std::string> delivered;
+    queue.startDelivery([&](const QueueMessage& m) {
+        ++calls;
+        // Every message fails twice, as a warehouse that is down for a moment
+        if (m.attempts < 2) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        delivered.insert(m.payload);
+        return true;
+    });
+    for (int i = 1; i <= 50; ++i) {
+        ASSERT_GT(queue.append(message(i)), 0u);
+    }
+    for (int i = 0; i < 500 && queue.stats().acked < 50; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    queue.stopDelivery();
+    DurableQueueStats stats = queue.stats();
+    EXPECT_EQ(stats.acked, 50u);
+    EXPECT_EQ(stats.retried, 100u);
+    EXPECT_EQ(stats.backlog, 0u);
+    EXPECT_EQ(calls.load(), 150);
+    EXPECT_EQ(delivered.size(), 50u);
+}
+
+TEST_F(DurableQueueTest, ServiceMatchesCrawlerContract) {
+    std::filesystem::create_directories(dir_);
+    {
+        std::ofstream env(dir_ / "queue.env");
+        env << "FORWARD_QUEUE_DIR=" << options_.directory << "\nFORWARD_QUEUE_BACKOFF_MS=60000\n";
+    }
+    ConfigManager config;
+    ASSERT_TRUE(config.load((dir_ / "queue.env").string()));
+    ForwardQueueService service;
+    ASSERT_TRUE(service.initialize(config));
+    Microservice microservice;
+    HttpServer server(microservice);
+    service.registerRoutes(server);
+
+    EXPECT_EQ(server.dispatch("POST", "/forward/enqueue", R"({"title": "no url"})"),
+              "{\"error\": \"url is required\"}");
+    EXPECT_EQ(server.dispatch("POST", "/forward/enqueue",
+                              R"({"url": "https://a.org/x", "title": "X", "markdown": "# X", "word_count": 2})"),
+              "{\"queued\": true, \"id\": 1}");
+    EXPECT_EQ(server.dispatch("POST", "/forward/enqueue", R"({"url": "https://a.org/y", "title": "Y"})"),
+              "{\"queued\": true, \"id\": 2}");
+
+    std::string pending = server.dispatch("GET", "/forward/pending", "");
+    EXPECT_NE(pending.find("{\"total\": 2, \"pending\": [{\"id\": 1, \"url\": \"https://a.org/x\", \"title\": \"X\", "
+                           "\"attempts\": 0, \"created_at\": "),
+              std::string::npos);
+
+    const std::string leased = server.dispatch("POST", "/forward/lease", R"({"max": 1})");
+    EXPECT_NE(leased.find("\"payload\": {\"url\": \"https://a.org/x\", \"title\": \"X\", \"markdown\": \"# X\", "
+                          "\"word_count\": 2}}], \"wait_ms\": 0}"),
+              std::string::npos);
+    EXPECT_EQ(server.dispatch("POST", "/forward/ack", R"({"id": 2})"), "{\"error\": \"id is not leased\"}");
+    EXPECT_EQ(server.dispatch("POST", "/forward/ack", R"({"id": 1, "ok": false})"), "{\"requeued\": true}");
+    EXPECT_EQ(server.dispatch("POST", "/forward/ack", R"({"id": 1})"), "{\"error\": \"id is not leased\"}");
+
+    // The retry waits out its backoff until /forward/retry
+    std::string next = server.dispatch("POST", "/forward/lease", R"({"max": 10})");
+    EXPECT_NE(next.find("{\"id\": 2,"), std::string::npos);
+    EXPECT_EQ(next.find("https://a.org/x"), std::string::npos);
+    EXPECT_EQ(server.dispatch("POST", "/forward/ack", R"({"id": 2, "ok": true})"), "{\"acked\": true}");
+    EXPECT_EQ(server.dispatch("POST", "/forward/retry", ""), "{\"retried\": true, \"due\": 1}");
+    next = server.dispatch("POST", "/forward/lease", R"({"max": 10})");
+    EXPECT_NE(next.find("{\"id\": 3, \"attempts\": 1,"), std::string::npos);
+    EXPECT_EQ(server.dispatch("POST", "/forward/ack", R"({"id": 3})"), "{\"acked\": true}");
+
+    const std::string stats = server.dispatch("GET", "/forward/stats", "");
+    EXPECT_NE(stats.find("\"backlog\": 0, \"inflight\": 0, \"waiting\": 0"), std::string::npos);
+    EXPECT_NE(stats.find("\"acked\": 2, \"retried\": 1, \"dead_letters\": 0"), std::string::npos);
+}
+
+TEST_F(DurableQueueTest, ServiceKeepsPayloadsAsSent) {
+    std::filesystem::create_directories(dir_);
+    {
+        std::ofstream env(dir_ / "queue.env");
+        env << "FORWARD_QUEUE_DIR=" << options_.directory << "\n";
+    }
+    ConfigManager config;
+    ASSERT_TRUE(config.load((dir_ / "queue.env").string()));
+    ForwardQueueService service;
+    ASSERT_TRUE(service.initialize(config));
+    Microservice microservice;
+    HttpServer server(microservice);
+    service.registerRoutes(server);
+
+    const std::string body = R"({"url": "https://a.org/x", "word_count": 1234, "score": 0.25, "public": true,
+                                 "metadata": {"author": "A", "tags": ["x", "y"]}, "parent": null})";
+    const uint64_t before = DurableQueue::wallMillis();
+    ASSERT_EQ(server.dispatch("POST", "/forward/enqueue", body), "{\"queued\": true, \"id\": 1}");
+    const uint64_t after = DurableQueue::wallMillis();
+
+    // created_at is epoch seconds to the millisecond, as the crawler's column, never in exponent form
+    const std::string pending = server.dispatch("GET", "/forward/pending", "");
+    const size_t at = pending.find("\"created_at\": ") + 14;
+    const std::string createdAt = pending.substr(at, pending.find('}', at) - at);
+    ASSERT_EQ(createdAt.size(), createdAt.find('.') + 4) << createdAt;
+    EXPECT_EQ(createdAt.find_first_not_of("0123456789."), std::string::npos) << createdAt;
+    const uint64_t millis = std::stoull(createdAt.substr(0, createdAt.size() - 4)) * 1000 +
+                            std::stoull(createdAt.substr(createdAt.size() - 3));
+    EXPECT_GE(millis, before);
+    EXPECT_LE(millis, after);
+
+    const std::string leased = server.dispatch("POST", "/forward/lease", R"({"max": 1})");
+    EXPECT_NE(leased.find("\"created_at\": " + createdAt + ","), std::string::npos) << leased;
+    EXPECT_NE(leased.find("\"payload\": " + body + "}]"), std::string::npos) << leased;
+
+    // The payload parses back to the original types
+    const size_t start = leased.find("\"payload\": ") + 11;
+    JsonParser parser;
+    ASSERT_TRUE(parser.parse(std::string_view(leased).substr(start, body.size())));
+    int64_t words = 0;
+    bool isPublic = false;
+    EXPECT_TRUE(parser.root().find("word_count").getInt64(words));
+    EXPECT_EQ(words, 1234);
+    EXPECT_TRUE(parser.root().find("public").getBool(isPublic));
+    EXPECT_TRUE(isPublic);
+    EXPECT_EQ(parser.root().find("metadata").find("author").string(), "A");
+    EXPECT_EQ(parser.root().find("metadata").find("tags")[1].string(), "y");
+}
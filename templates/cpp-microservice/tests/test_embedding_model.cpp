@@ -0,0 +1,331 @@
+#include <gtest/gtest.h>
+#include "../include/embedding_model.h"
+#include "../include/gemm.h"
+#include "../include/text_embedder.h"
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+#include <unistd.h>
+
+// Test fixture for EmbeddingModel, GEMM kernels and TextEmbedder
+class EmbeddingModelTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir_ = std::filesystem::temp_directory_path() / ("embedding_model_test_" + std::to_string(getpid()));
+        std::filesystem::create_directories(dir_);
+        config_.vocabSize = 40;
+        config_.hidden = 32;
+        config_.layers = 2;
+        config_.heads = 4;
+        config_.intermediate = 64;
+        config_.maxPositions = 24;
+
+        // Random weights, with LayerNorm gammas near one so activations stay in range
+        std::mt19937 rng(7);
+        std::normal_distribution<float> normal(0.0f, 0.2f);
+        parameters_.resize(EmbeddingModel::parameterCount(config_));
+        for (float& x : parameters_) {
+            x = normal(rng);
+        }
+        for (const Tensor& t : tensors()) {
+            if (t.gamma) {
+                for (size_t i = 0; i < t.size; ++i) {
+                    parameters_[t.offset + i] += 1.0f;
+                }
+            }
+        }
+        modelPath_ = (dir_ / "model.dsem").string();
+        ASSERT_TRUE(EmbeddingModel::write(modelPath_, config_, parameters_.data()));
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir_);
+    }
+
+    struct Tensor {
+        size_t offset;
+        size_t size;
+        bool gamma;
+    };
+
+    // Parameter tensors in file order
+    std::vector<Tensor> tensors() const {
+        const size_t h = config_.hidden;
+        const size_t i = config_.intermediate;
+        std::vector<size_t> sizes = {config_.vocabSize * h, config_.maxPositions * h, config_.typeVocabSize * h, h, h};
+        std::vector<bool> gammas = {false, false, false, true, false};
+        for (uint32_t layer = 0; layer < config_.layers; ++layer) {
+            for (size_t s : {h * h, h, h * h, h, h * h, h, h * h, h, h, h, i * h, i, h * i, h, h, h}) {
+                sizes.push_back(s);
+            }
+            for (bool g : {false, false, false, false, false, false, false, false, true, false, false, false, false,
+                           false, true, false}) {
+                gammas.push_back(g);
+            }
+        }
+        std::vector<Tensor> out;
+        size_t offset = 0;
+        for (size_t t = 0; t < sizes.size(); ++t) {
+            out.push_back({offset, sizes[t], gammas[t]});
+            offset += sizes[t];
+        }
+        return out;
+    }
+
+    // Straightforward BERT forward pass on one sequence, as the reference
+    std::vector<float> reference(const std::vector<int32_t>& ids) const {
+        const size_t h = config_.hidden;
+        const size_t inter = config_.intermediate;
+        const size_t d = h / config_.heads;
+        const size_t n = ids.size();
+        std::vector<Tensor> t = tensors();
+        auto at = [&](size_t index) { return parameters_.data() + t[index].offset; };
+        auto linear = [&](const std::vector<float>& x, size_t in, size_t out, const float* w, const float* b) {
+            std::vector<float> y(n * out);
+            for (size_t r = 0; r < n; ++r) {
+                for (size_t o = 0; o < out; ++o) {
+                    double sum = b[o];
+                    for (size_t k = 0; k < in; ++k) {
+                        sum += static_cast<double>(x[r * in + k]) * w[o * in + k];
+                    }
+                    y[r * out + o] = static_cast<float>(sum);
+                }
+            }
+            return y;
+        };
+        auto layerNorm = [&](std::vector<float>& x, const float* gamma, const float* beta) {
+            for (size_t r = 0; r < n; ++r) {
+                double mean = 0.0, variance = 0.0;
+                for (size_t k = 0; k < h; ++k) {
+                    mean += x[r * h + k];
+                }
+                mean /= h;
+                for (size_t k = 0; k < h; ++k) {
+                    variance += (x[r * h + k] - mean) * (x[r * h + k] - mean);
+                }
+                variance /= h;
+                for (size_t k = 0; k < h; ++k) {
+                    x[r * h + k] = static_cast<float>((x[r * h + k] - mean) / std::sqrt(variance + 1e-12) * gamma[k] +
+                                                      beta[k]);
+                }
+            }
+        };
+
+        std::vector<float> x(n * h);
+        for (size_t r = 0; r < n; ++r) {
+            for (size_t k = 0; k < h; ++k) {
+                x[r * h + k] = at(0)[ids[r] * h + k] + at(1)[r * h + k] + at(2)[k];
+            }
+        }
+        layerNorm(x, at(3), at(4));
+
+        for (uint32_t layer = 0; layer < config_.layers; ++layer) {
+            size_t base = 5 + layer * 16;
+            std::vector<float> q = linear(x, h, h, at(base), at(base + 1));
+            std::vector<float> k = linear(x, h, h, at(base + 2), at(base + 3));
+            std::vector<float> v = linear(x, h, h, at(base + 4), at(base + 5));
+            std::vector<float> context(n * h, 0.0f);
+            for (size_t head = 0; head < config_.heads; ++head) {
+                for (size_t i = 0; i < n; ++i) {
+                    std::vector<double> scores(n);
+                    double maxScore = -1e30, sum = 0.0;
+                    for (size_t j = 0; j < n; ++j) {
+                        double dot = 0.0;
+                        for (size_t c = 0; c < d; ++c) {
+                            dot += q[i * h + head * d + c] * k[j * h + head * d + c];
+                        }
+                        scores[j] = dot / std::sqrt(static_cast<double>(d));
+                        maxScore = std::max(maxScore, scores[j]);
+                    }
+                    for (size_t j = 0; j < n; ++j) {
+                        scores[j] = std::exp(scores[j] - maxScore);
+                        sum += scores[j];
+                    }
+                    for (size_t j = 0; j < n; ++j) {
+                        for (size_t c = 0; c < d; ++c) {
+                            context[i * h + head * d + c] += static_cast<float>(scores[j] / sum) * v[j * h + head * d + c];
+                        }
+                    }
+                }
+            }
+            std::vector<float> attended = linear(context, h, h, at(base + 6), at(base + 7));
+            for (size_t e = 0; e < n * h; ++e) {
+                attended[e] += x[e];
+            }
+            layerNorm(attended, at(base + 8), at(base + 9));
+            x = attended;
+
+            std::vector<float> hidden = linear(x, h, inter, at(base + 10), at(base + 11));
+            for (float& value : hidden) {
+                value = static_cast<float>(0.5 * value * (1.0 + std::erf(value / std::sqrt(2.0))));
+            }
+            std::vector<float> output = linear(hidden, inter, h, at(base + 12), at(base + 13));
+            for (size_t e = 0; e < n * h; ++e) {
+                output[e] += x[e];
+            }
+            layerNorm(output, at(base + 14), at(base + 15));
+            x = output;
+        }
+
+        std::vector<float> pooled(h, 0.0f);
+        double norm = 0.0;
+        for (size_t k = 0; k < h; ++k) {
+            for (size_t r = 0; r < n; ++r) {
+                pooled[k] += x[r * h + k] / n;
+            }
+            norm += pooled[k] * pooled[k];
+        }
+        for (float& value : pooled) {
+            value = static_cast<float>(value / std::sqrt(norm));
+        }
+        return pooled;
+    }
+
+    void writeVocabulary(const std::string& path) {
+        std::ofstream out(path);
+        out << "[PAD]\n[UNK]\n[CLS]\n[SEP]\n";
+        const char* words[] = {"the", "cat", "sat", "on", "mat", "dog", "ran", "far", "away", "home"};
+        for (uint32_t i = 4; i < config_.vocabSize; ++i) {
+            out << (i - 4 < 10 ? words[i - 4] : "w" + std::to_string(i)) << "\n";
+        }
+    }
+
+    std::filesystem::path dir_;
+    EmbeddingModelConfig config_;
+    std::vector<float> parameters_;
+    std::string modelPath_;
+};
+
+// fp32 GEMM is exact to rounding and int8 GEMM within quantization error, including ragged shapes
+TEST_F(EmbeddingModelTest, GemmMatchesNaive) {
+    std::mt19937 rng(1);
+    std::normal_distribution<float> normal;
+    const size_t m = 37, n = 45, k = 70;
+    std::vector<float> a(m * k), w(n * k), bias(n);
+    for (float& x : a) x = normal(rng);
+    for (float& x : w) x = normal(rng);
+    for (float& x : bias) x = normal(rng);
+
+    PackedMatrix packed;
+    packed.pack(w.data(), n, k);
+    QuantizedMatrix quantized;
+    quantized.quantize(w.data(), n, k);
+    ThreadPool pool(2);
+    std::vector<float> fp32(m * n), int8(m * n), threaded(m * n);
+    gemm(a.data(), m, packed, bias.data(), fp32.data());
+    gemm(a.data(), m, packed, bias.data(), threaded.data(), &pool);
+    gemmInt8(a.data(), m, quantized, bias.data(), int8.data(), &pool);
+
+    double errorNorm = 0.0, norm = 0.0;
+    for (size_t r = 0; r < m; ++r) {
+        for (size_t c = 0; c < n; ++c) {
+            double expected = bias[c];
+            for (size_t p = 0; p < k; ++p) {
+                expected += static_cast<double>(a[r * k + p]) * w[c * k + p];
+            }
+            EXPECT_NEAR(fp32[r * n + c], expected, 1e-3);
+            EXPECT_EQ(threaded[r * n + c], fp32[r * n + c]);
+            errorNorm += (int8[r * n + c] - expected) * (int8[r * n + c] - expected);
+            norm += expected * expected;
+        }
+    }
+    EXPECT_LT(std::sqrt(errorNorm / norm), 0.02);
+}
+
+// The optimized ragged forward pass matches a naive per-sequence implementation
+TEST_F(EmbeddingModelTest, MatchesReferenceForward) {
+    EmbeddingModel model;
+    ASSERT_TRUE(model.load(modelPath_, false));
+    std::vector<std::vector<int32_t>> sequences = {{2, 5, 6, 7, 3}, {2, 9, 3}, {2, 4, 5, 6, 7, 8, 9, 10, 11, 12, 3}};
+    ThreadPool pool(2);
+    std::vector<float> out(sequences.size() * config_.hidden);
+    ASSERT_TRUE(model.embed(sequences, out.data(), &pool));
+
+    for (size_t s = 0; s < sequences.size(); ++s) {
+        std::vector<float> expected = reference(sequences[s]);
+        for (size_t i = 0; i < config_.hidden; ++i) {
+            EXPECT_NEAR(out[s * config_.hidden + i], expected[i], 1e-4) << "sequence " << s << " dim " << i;
+        }
+    }
+}
+
+// int8 embeddings stay close to fp32, and batching never changes a sequence's result
+TEST_F(EmbeddingModelTest, QuantizedAndBatchedAgree) {
+    EmbeddingModel fp32;
+    EmbeddingModel int8;
+    ASSERT_TRUE(fp32.load(modelPath_, false));
+    ASSERT_TRUE(int8.load(modelPath_, true));
+    EXPECT_TRUE(int8.quantized());
+
+    std::vector<std::vector<int32_t>> sequences = {{2, 5, 6, 7, 3}, {2, 9, 3}, {2, 14, 15, 16, 17, 3}};
+    const size_t h = config_.hidden;
+    std::vector<float> full(sequences.size() * h), quantized(sequences.size() * h);
+    ASSERT_TRUE(fp32.embed(sequences, full.data()));
+    ASSERT_TRUE(int8.embed(sequences, quantized.data()));
+
+    for (size_t s = 0; s < sequences.size(); ++s) {
+        std::vector<float> alone(h);
+        ASSERT_TRUE(fp32.embed({sequences[s]}, alone.data()));
+        double cosine = 0.0;
+        for (size_t i = 0; i < h; ++i) {
+            EXPECT_NEAR(alone[i], full[s * h + i], 1e-5);
+            cosine += full[s * h + i] * quantized[s * h + i];
+        }
+        EXPECT_GT(cosine, 0.99);
+    }
+}
+
+// Bad ids, over-long sequences and malformed files are rejected
+TEST_F(EmbeddingModelTest, RejectsInvalidInput) {
+    EmbeddingModel model;
+    ASSERT_TRUE(model.load(modelPath_, true));
+    std::vector<float> out(config_.hidden);
+    EXPECT_FALSE(model.embed({{2, static_cast<int32_t>(config_.vocabSize), 3}}, out.data()));
+    EXPECT_FALSE(model.embed({std::vector<int32_t>(config_.maxPositions + 1, 5)}, out.data()));
+
+    std::filesystem::resize_file(modelPath_, std::filesystem::file_size(modelPath_) - 4);
+    EmbeddingModel truncated;
+    EXPECT_FALSE(truncated.load(modelPath_, false));
+}
+
+// Concurrent callers are batched together and each gets its own texts' vectors
+TEST_F(EmbeddingModelTest, TextEmbedderBatchesConcurrentCallers) {
+    std::filesystem::rename(modelPath_, dir_ / "model.dsem");
+    writeVocabulary((dir_ / "vocab.txt").string());
+    TextEmbedderOptions options;
+    options.maxWaitMicros = 20000;
+    options.threads = 2;
+    TextEmbedder embedder;
+    ASSERT_TRUE(embedder.load(dir_.string(), options));
+    EXPECT_EQ(embedder.dim(), config_.hidden);
+
+    std::vector<std::string> texts = {"the cat sat on the mat", "the dog ran far away", "home", "cat dog"};
+    std::vector<std::vector<std::vector<float>>> results(texts.size());
+    std::vector<std::thread> callers;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        callers.emplace_back([&, i] { EXPECT_TRUE(embedder.embed({texts[i]}, results[i])); });
+    }
+    for (std::thread& caller : callers) {
+        caller.join();
+    }
+
+    for (size_t i = 0; i < texts.size(); ++i) {
+        std::vector<std::vector<float>> alone;
+        ASSERT_TRUE(embedder.embed({texts[i]}, alone));
+        ASSERT_EQ(results[i].size(), 1u);
+        for (size_t d = 0; d < config_.hidden; ++d) {
+            EXPECT_NEAR(results[i][0][d], alone[0][d], 1e-5);
+        }
+    }
+    TextEmbedderStats stats = embedder.stats();
+    EXPECT_EQ(stats.texts, 2 * texts.size());
+    EXPECT_LT(stats.batches, 2 * texts.size());
+    EXPECT_GT(stats.tokensPerSecond, 0.0);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,241 @@
+#include <gtest/gtest.h>
+#include "allocation_counter.h"
+#include "../include/content_service.h"
+#include "../include/feed_reader.h"
+#include "../include/json_parser.h"
+#include "../include/xml_reader.h"
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+class FeedReaderTest : public ::testing::Test {
+protected:
+    // Recorded provider responses live next to this file
+    static std::string fixture(const std::string& name) {
+        std::string dir = __FILE__;
+        dir = dir.substr(0, dir.find_last_of('/') + 1);
+        std::ifstream file(dir + "fixtures/feeds/" + name, std::ios::binary);
+        std::stringstream content;
+        content << file.rdbuf();
+        return content.str();
+    }
+
+    static std::string decoded(std::string_view raw) {
+        std::string scratch;
+        return std::string(decodeXmlText(raw, scratch));
+    }
+
+    static std::vector<FeedEntry> entries(FeedReader& reader) {
+        std::vector<FeedEntry> out;
+        FeedEntry entry;
+        while (reader.next(entry)) {
+            out.push_back(entry);
+        }
+        return out;
+    }
+
+    // "S:name" for start tags, "E:name" for end tags, "T:text" for text
+    static std::vector<std::string> tokens(std::string_view xml, std::string* error = nullptr) {
+        XmlReader reader(xml);
+        std::vector<std::string> out;
+        while (true) {
+            switch (reader.next()) {
+            case XmlToken::StartTag:
+                out.push_back("S:" + std::string(reader.name()));
+                break;
+            case XmlToken::EndTag:
+                out.push_back("E:" + std::string(reader.name()));
+                break;
+            case XmlToken::Text:
+                out.push_back((reader.cdata() ? "C:" : "T:") + std::string(reader.text()));
+                break;
+            case XmlToken::End:
+                return out;
+            case XmlToken::Error:
+                if (error) {
+                    *error = reader.error();
+                }
+                out.push_back("error");
+                return out;
+            }
+        }
+    }
+};
+
+TEST_F(FeedReaderTest, Tokenizes) {
+    const std::string xml = "<?xml version=\"1.0\"?>\n<!DOCTYPE a [ <!ENTITY x \"y\"> ]>\n<!-- c -->\n"
+                            "<a:root x='1>2' y=\"3\"><b/>t&amp;<![CDATA[<raw>]]><c z=\"\">u</c></a:root>\n";
+    const std::vector<std::string> expected = {"S:root", "S:b", "E:b", "T:t&amp;", "C:<raw>",
+                                               "S:c", "T:u", "E:c", "E:root"};
+    EXPECT_EQ(tokens(xml), expected);
+
+    XmlReader reader(xml);
+    while (reader.next() != XmlToken::StartTag) {
+    }
+    std::string_view value;
+    ASSERT_TRUE(reader.attribute("x", value));
+    EXPECT_EQ(value, "1>2");
+    ASSERT_TRUE(reader.attribute("y", value));
+    EXPECT_EQ(value, "3");
+    EXPECT_FALSE(reader.attribute("z", value));
+    EXPECT_EQ(reader.depth(), 1u);
+
+    std::string error;
+    EXPECT_EQ(tokens("<a><b></a>", &error).back(), "error");
+    EXPECT_EQ(error, "unexpected end of document");
+    EXPECT_EQ(tokens("<a></a></b>", &error).back(), "error");
+    EXPECT_EQ(error, "end tag without a start tag");
+    EXPECT_EQ(tokens("<a x=\"1></a>", &error).back(), "error");
+    EXPECT_EQ(tokens("<a><!-- x</a>", &error).back(), "error");
+    EXPECT_EQ(tokens("<a>< b/></a>", &error).back(), "error");
+    EXPECT_EQ(tokens(""), std::vector<std::string>());
+}
+
+TEST_F(FeedReaderTest, DecodesText) {
+    const std::string_view plain = "already plain text";
+    std::string scratch;
+    EXPECT_EQ(decodeXmlText(plain, scratch).data(), plain.data());
+
+    EXPECT_EQ(decoded("  a\n  b\t c  "), "a b c");
+    EXPECT_EQ(decoded("&lt;b&gt; &amp; &quot;q&quot; &apos;"), "<b> & \"q\" '");
+    EXPECT_EQ(decoded("caf&#233; &#x1F600;"), "caf\xC3\xA9 \xF0\x9F\x98\x80");
+    EXPECT_EQ(decoded("&unknown; & &#xD800; &#;"), "&unknown; & &#xD800; &#;");
+    EXPECT_EQ(decoded("<i>E. coli</i> growth"), "E. coli growth");
+    EXPECT_EQ(decoded("<Year>2024</Year><Month>Jan</Month>"), "2024 Jan");
+    EXPECT_EQ(decoded("a<!-- note -->b <![CDATA[x &amp; <y>]]>"), "ab x &amp; <y>");
+    EXPECT_EQ(decoded(""), "");
+}
+
+TEST_F(FeedReaderTest, ReadsArxivAtom) {
+    const std::string xml = fixture("arxiv.xml");
+    ASSERT_FALSE(xml.empty());
+    FeedReader reader(xml);
+    const std::vector<FeedEntry> read = entries(reader);
+    EXPECT_STREQ(reader.error(), "");
+    EXPECT_EQ(reader.format(), FeedFormat::Atom);
+    ASSERT_EQ(read.size(), 3u);
+    EXPECT_EQ(read[0].id, "http://arxiv.org/abs/1603.09320v4");
+    EXPECT_EQ(decoded(read[0].title),
+              "Efficient and robust approximate nearest neighbor search using Hierarchical Navigable Small World graphs");
+    EXPECT_EQ(read[0].link, "http://arxiv.org/abs/1603.09320v4");
+    EXPECT_EQ(read[0].date, "2016-03-30T11:33:42Z");
+    EXPECT_EQ(decoded(read[0].summary).substr(0, 38), "We present a new approach for the appr");
+    EXPECT_NE(decoded(read[1].summary).find("state of the art & applies"), std::string::npos);
+    EXPECT_NE(decoded(read[2].summary).find("functions <q, x> weighted"), std::string::npos);
+    EXPECT_EQ(read[2].date, "2020-02-13T18:50:45Z");
+}
+
+TEST_F(FeedReaderTest, ReadsYacyRss) {
+    const std::string xml = fixture("yacy.rss");
+    FeedReader reader(xml);
+    const std::vector<FeedEntry> read = entries(reader);
+    EXPECT_STREQ(reader.error(), "");
+    EXPECT_EQ(reader.format(), FeedFormat::Rss);
+    ASSERT_EQ(read.size(), 3u);
+    EXPECT_EQ(read[0].title, "Vector database - Wikipedia");
+    EXPECT_EQ(read[0].link, "https://en.wikipedia.org/wiki/Vector_database");
+    EXPECT_EQ(read[0].id, "wUHjTq3ZbQxK");
+    EXPECT_EQ(read[0].date, "Tue, 14 May 2024 08:12:44 +0000");
+    EXPECT_EQ(decoded(read[0].summary).substr(0, 26), "A <b>vector</b> database i");
+    EXPECT_EQ(decoded(read[1].summary),
+              "Faiss is a library for efficient similarity search & clustering of dense vectors.");
+    EXPECT_EQ(read[2].link, "https://ann-benchmarks.com/");
+}
+
+TEST_F(FeedReaderTest, ReadsPubmed) {
+    const std::string summaries = fixture("pubmed_esummary.xml");
+    FeedReader summaryReader(summaries);
+    const std::vector<FeedEntry> docs = entries(summaryReader);
+    EXPECT_STREQ(summaryReader.error(), "");
+    EXPECT_EQ(summaryReader.format(), FeedFormat::PubmedSummary);
+    ASSERT_EQ(docs.size(), 3u);
+    EXPECT_EQ(docs[0].id, "37150711");
+    EXPECT_EQ(docs[0].title, "Dense retrieval of biomedical literature with domain-adapted sentence embeddings.");
+    EXPECT_EQ(docs[0].date, "2023 Jun");
+    EXPECT_EQ(docs[0].summary, "Comput Biol Med");
+    EXPECT_TRUE(docs[0].link.empty());
+    EXPECT_NE(decoded(docs[1].title).find("retrieval & ranking."), std::string::npos);
+
+    const std::string articles = fixture("pubmed_efetch.xml");
+    FeedReader articleReader(articles);
+    const std::vector<FeedEntry> read = entries(articleReader);
+    EXPECT_STREQ(articleReader.error(), "");
+    EXPECT_EQ(articleReader.format(), FeedFormat::PubmedArticles);
+    ASSERT_EQ(read.size(), 2u);
+    // The citation's own PMID, not the one in its comments list
+    EXPECT_EQ(read[0].id, "37150711");
+    EXPECT_EQ(decoded(read[0].date), "2023 Jun");
+    const std::string abstract = decoded(read[0].summary);
+    EXPECT_EQ(abstract.substr(0, 24), "Keyword search over PubM");
+    EXPECT_NE(abstract.find("terminology. We fine-tuned"), std::string::npos);
+    EXPECT_NE(abstract.find("(p < 0.001)"), std::string::npos);
+    EXPECT_EQ(read[1].id, "31501885");
+    EXPECT_EQ(decoded(read[1].title),
+              "BioBERT: a pre-trained biomedical language representation model for biomedical text mining.");
+    EXPECT_EQ(decoded(read[1].date), "2020 Feb 15");
+}
+
+TEST_F(FeedReaderTest, RejectsOtherDocuments) {
+    FeedEntry entry;
+    FeedReader html("<html><body>not a feed</body></html>");
+    EXPECT_FALSE(html.next(entry));
+    EXPECT_STREQ(html.error(), "unknown feed format");
+
+    FeedReader truncated("<feed><entry><title>cut");
+    EXPECT_FALSE(truncated.next(entry));
+    EXPECT_STREQ(truncated.error(), "unexpected end of document");
+
+    FeedReader empty("  ");
+    EXPECT_FALSE(empty.next(entry));
+    EXPECT_STREQ(empty.error(), "empty document");
+}
+
+TEST_F(FeedReaderTest, MemoryDoesNotGrowWithFeedSize) {
+    // Repeat the recorded entries into a feed of several megabytes
+    const std::string recorded = fixture("arxiv.xml");
+    const size_t first = recorded.find("<entry>");
+    const size_t last = recorded.rfind("</feed>");
+    std::string xml = recorded.substr(0, first);
+    while (xml.size() < (4u << 20)) {
+        xml.append(recorded, first, last - first);
+    }
+    xml += "</feed>\n";
+
+    const size_t before = allocations.load();
+    FeedReader reader(xml);
+    FeedEntry entry;
+    size_t count = 0;
+    size_t titleBytes = 0;
+    while (reader.next(entry)) {
+        ++count;
+        titleBytes += entry.title.size();
+    }
+    EXPECT_EQ(allocations.load(), before);
+    EXPECT_STREQ(reader.error(), "");
+    EXPECT_GT(count, 2000u);
+    EXPECT_GT(titleBytes, 0u);
+}
+
+TEST_F(FeedReaderTest, ServesParsedFeeds) {
+    ContentService service;
+    std::map<std::string, std::string> params = {{"xml", fixture("pubmed_esummary.xml")}, {"limit", "2"}};
+    JsonParser parser;
+    const std::string out = service.handleParseFeed(params);
+    ASSERT_TRUE(parser.parse(out)) << out;
+    EXPECT_EQ(parser.root().find("format").string(), "pubmed_summary");
+    EXPECT_EQ(parser.root().find("count").raw(), "2");
+    JsonValue first = parser.root().find("entries")[0];
+    EXPECT_EQ(first.find("link").string(), "https://pubmed.ncbi.nlm.nih.gov/37150711/");
+    EXPECT_EQ(first.find("date").string(), "2023 Jun");
+
+    params = {{"xml", fixture("arxiv.xml")}};
+    const std::string arxiv = service.handleParseFeed(params);
+    ASSERT_TRUE(parser.parse(arxiv));
+    EXPECT_EQ(parser.root().find("entries").size(), 3u);
+    EXPECT_EQ(parser.root().find("entries")[2].find("link").string(), "http://arxiv.org/abs/2002.05709v2");
+
+    params = {{"xml", "<feed><entry>"}};
+    EXPECT_EQ(service.handleParseFeed(params), "{\"error\": \"bad feed: unexpected end of document\"}");
+    EXPECT_EQ(service.handleParseFeed({}), "{\"error\": \"xml required\"}");
+}
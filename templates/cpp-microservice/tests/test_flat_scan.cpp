@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include "../include/flat_scan.h"
+#include <algorithm>
+#include <random>
+
+// Test fixture for the exact flat scan
+class FlatScanTest : public ::testing::Test {
+protected:
+    void fill(uint32_t dim, size_t count) {
+        std::mt19937 rng(11);
+        std::normal_distribution<float> normal;
+        dim_ = dim;
+        data_.resize(count * dim);
+        for (float& x : data_) {
+            x = normal(rng);
+        }
+        for (size_t i = 0; i < count; ++i) {
+            normalizeVector(data_.data() + i * dim, dim);
+        }
+    }
+
+    std::vector<SearchHit> exact(DistanceMetric metric, const float* query, const std::vector<uint32_t>& rows,
+                                 size_t k) {
+        std::vector<SearchHit> hits;
+        for (uint32_t row : rows) {
+            hits.push_back({row, vectorDistance(metric, query, data_.data() + static_cast<size_t>(row) * dim_, dim_)});
+        }
+        std::sort(hits.begin(), hits.end(),
+                  [](const SearchHit& a, const SearchHit& b) { return a.distance < b.distance; });
+        hits.resize(std::min(k, hits.size()));
+        return hits;
+    }
+
+    uint32_t dim_ = 0;
+    std::vector<float> data_;
+};
+
+// SIMD block kernel agrees with the scalar distance, including dimensions that are not a multiple of 8
+TEST_F(FlatScanTest, BlockDistancesMatchScalar) {
+    for (uint32_t dim : {3u, 16u, 37u, 384u}) {
+        fill(dim, 103);
+        const float* query = data_.data();
+        std::vector<float> out(102);
+        for (DistanceMetric metric : {DistanceMetric::Cosine, DistanceMetric::L2}) {
+            blockDistances(metric, data_.data(), dim, query, nullptr, 1, out.size(), out.data());
+            for (size_t i = 0; i < out.size(); ++i) {
+                EXPECT_NEAR(out[i], vectorDistance(metric, query, data_.data() + (i + 1) * dim, dim), 1e-4f);
+            }
+        }
+    }
+}
+
+// Parallel scans over all rows and over a row subset return the exact top-k
+TEST_F(FlatScanTest, ExactTopK) {
+    fill(64, 20000);
+    ThreadPool pool(3);
+    std::vector<uint32_t> all(20000);
+    for (uint32_t i = 0; i < all.size(); ++i) {
+        all[i] = i;
+    }
+    std::vector<uint32_t> subset;
+    for (uint32_t i = 0; i < all.size(); i += 7) {
+        subset.push_back(i);
+    }
+
+    for (DistanceMetric metric : {DistanceMetric::Cosine, DistanceMetric::L2}) {
+        for (int q = 0; q < 5; ++q) {
+            const float* query = data_.data() + q * 997 * dim_;
+            std::vector<SearchHit> expected = exact(metric, query, all, 10);
+            for (ThreadPool* p : {static_cast<ThreadPool*>(nullptr), &pool}) {
+                std::vector<SearchHit> hits = flatSearch(metric, data_.data(), dim_, query, nullptr, all.size(), 10, p);
+                ASSERT_EQ(hits.size(), expected.size());
+                for (size_t i = 0; i < hits.size(); ++i) {
+                    EXPECT_EQ(hits[i].row, expected[i].row);
+                }
+            }
+
+            expected = exact(metric, query, subset, 25);
+            std::vector<SearchHit> hits =
+                flatSearch(metric, data_.data(), dim_, query, subset.data(), subset.size(), 25, &pool);
+            ASSERT_EQ(hits.size(), expected.size());
+            for (size_t i = 0; i < hits.size(); ++i) {
+                EXPECT_EQ(hits[i].row, expected[i].row);
+            }
+        }
+    }
+}
+
+TEST_F(FlatScanTest, ParallelForCoversEveryItemOnce) {
+    ThreadPool pool(4);
+    std::vector<int> seen(10007, 0);
+    pool.parallelFor(seen.size(), 100, [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            ++seen[i];
+        }
+    });
+    EXPECT_EQ(std::count(seen.begin(), seen.end(), 1), static_cast<long>(seen.size()));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
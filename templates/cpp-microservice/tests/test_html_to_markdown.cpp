@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include "../include/html_to_markdown.h"
+#include <random>
+#include <string>
+
+class HtmlToMarkdownTest : public ::testing::Test {
+protected:
+    HtmlToMarkdown converter;
+
+    std::string convert(const std::string& html) {
+        std::string markdown;
+        converter.convert(html, markdown);
+        return markdown;
+    }
+};
+
+TEST_F(HtmlToMarkdownTest, InlineAndBlocks) {
+    EXPECT_EQ(convert("<h2>Main   <em>Title</em></h2><p>Hello,\n <b>world</b>! A "
+                      "<a href=\"https://x.org/?a=1&amp;b=2\">link</a>, <a href=\"javascript:go()\">js</a>"
+                      " and <code>x</code>.</p><p>Next<br>line<hr>after</p>"),
+              "## Main *Title*\n\nHello, **world**! A [link](https://x.org/?a=1&b=2), js and `x`.\n\n"
+              "Next\nline\n\n---\n\nafter");
+    EXPECT_EQ(convert("<p>&lt;tag&gt; &copy; &#169; &#x1F600; &bogus; a & b</p>"),
+              "<tag> \xC2\xA9 \xC2\xA9 \xF0\x9F\x98\x80 &bogus; a & b");
+    EXPECT_EQ(convert("<img src=\"a.png\" alt=\"A &amp; B\"><img src=\"data:image/png;base64,AA\">"), "![A & B](a.png)");
+}
+
+TEST_F(HtmlToMarkdownTest, InlineCodeFencesOutrunBackticks) {
+    EXPECT_EQ(convert("<p>run <code>a`b</code> now</p>"), "run ``a`b`` now");
+    EXPECT_EQ(convert("<p><code>``x</code></p>"), "``` ``x ```");
+    EXPECT_EQ(convert("<p><code>x`</code>, <code> <b>*y*</b> </code>.</p>"), "`` x` ``, `*y*` .");
+    EXPECT_EQ(convert("<p>a<code></code>b</p>"), "ab");
+    EXPECT_EQ(convert("<table><tr><td><code>a|b</code></td></tr></table>"), "| `a\\|b` |\n| --- |");
+
+    // Past the cap the span closes and the rest is plain text
+    const std::string code(HtmlToMarkdown::kMaxCodeBytes + 10, 'c');
+    EXPECT_EQ(convert("<code>" + code + "&amp;tail</code>"), "`" + code + "`&tail");
+}
+
+TEST_F(HtmlToMarkdownTest, EscapesTextThatWouldReadAsMarkup) {
+    EXPECT_EQ(convert("<p># x</p><p>1. x</p><p>- x</p><p>&gt; x</p><p>+ x</p><p>2024) x</p>"),
+              "\\# x\n\n1\\. x\n\n\\- x\n\n\\> x\n\n\\+ x\n\n2024\\) x");
+    EXPECT_EQ(convert("<p>a<br>===<br>~~~</p>"), "a\n\\===\n\\~~~");
+    EXPECT_EQ(convert("<p>*a* _b_ [c](d) `e` \\f, 1. g - h #i</p>"),
+              "\\*a\\* \\_b\\_ \\[c\\](d) \\`e\\` \\\\f, 1. g - h #i");
+    EXPECT_EQ(convert("<ul><li># not a heading</li></ul><h2># sign</h2>"), "* \\# not a heading\n\n## # sign");
+
+    // A number split across pieces still has its '.' escaped
+    std::string markdown;
+    converter.feed("<p>12", markdown);
+    converter.feed(". x</p>", markdown);
+    converter.finish(markdown);
+    EXPECT_EQ(markdown, "12\\. x");
+
+    // Code and pre blocks keep their text as is
+    EXPECT_EQ(convert("<p><code>*a*</code></p><pre># b\n1. c</pre>"), "`*a*`\n\n```\n# b\n1. c\n```");
+}
+
+TEST_F(HtmlToMarkdownTest, KeepsImagesAndLinksWhole) {
+    EXPECT_EQ(convert("<img alt=\"a [b] *c*\" src=\"x.png\">"), "![a \\[b\\] \\*c\\*](x.png)");
+    EXPECT_EQ(convert("<img alt=\"a\" src=\"/my pic (1).png\">"), "![a](/my%20pic%20\\(1\\).png)");
+    EXPECT_EQ(convert("<a href=\"https://en.wikipedia.org/wiki/C_(language)\">C</a>"),
+              "[C](https://en.wikipedia.org/wiki/C_\\(language\\))");
+    EXPECT_EQ(convert("<a href=\"a b\\c<d>\">x</a>"), "[x](a%20b\\\\c\\<d\\>)");
+    EXPECT_EQ(convert("<table><tr><td><a href=\"a|b\">x</a></td></tr></table>"), "| [x](a\\|b) |\n| --- |");
+
+    // Blocks inside a link collapse to spaces rather than splitting it
+    EXPECT_EQ(convert("<a href=x><p>t</p></a>"), "[t](x)");
+    EXPECT_EQ(convert("<p>See <a href=x><h2>Title</h2><div>one</div><br>two</a> now</p>"),
+              "See [Title one two](x) now");
+    EXPECT_EQ(convert("<a href=x><ul><li>a</li><li>b</li></ul></a><p>after</p>"), "[a b](x)\n\nafter");
+    EXPECT_EQ(convert("<a href=x><table><tr><td>a</td><td>b</td></tr></table></a>"), "[a b](x)");
+}
+
+TEST_F(HtmlToMarkdownTest, SkipsScriptsStylesAndComments) {
+    EXPECT_EQ(convert("<title>T</title><style>p{}</style><script>if (a<b) document.write(\"</p>\")</script>"
+                      "<p>kept<!-- <p>comment</p> --></p><noscript><p>no</p></noscript>"
+                      "<svg><text>no</text></svg><SCRIPT type=x>x</Script >done"),
+              "kept\n\ndone");
+}
+
+TEST_F(HtmlToMarkdownTest, Lists) {
+    EXPECT_EQ(convert("<ul><li>one<li>two<ul><li>nested</li></ul></li></ul><ol start=\"3\"><li>three</li>"
+                      "<li>four</li></ol>"),
+              "* one\n* two\n  * nested\n\n3. three\n4. four");
+    EXPECT_EQ(convert("<blockquote><p>quoted</p><p>twice</p></blockquote>"), "> quoted\n>\n> twice");
+}
+
+TEST_F(HtmlToMarkdownTest, PreAndTables) {
+    EXPECT_EQ(convert("<p>code:</p><pre>\n<code>int  main() {\n    return 1 &lt; 2;\n}</code></pre>"),
+              "code:\n\n```\nint  main() {\n    return 1 < 2;\n}\n```");
+    EXPECT_EQ(convert("<table><tr><th>A</th><th>B|C</th></tr><tr><td>1</td><td><b>2</b>\n<p>x</p></td></tr>"
+                      "</table>"),
+              "| A | B\\|C |\n| --- | --- |\n| 1 | **2** x |");
+}
+
+TEST_F(HtmlToMarkdownTest, StreamingMatchesWholeDocument) {
+    std::string html = "<!DOCTYPE html><html><head><script>var s = '</scr' + 'ipt>';</script></head><body>";
+    for (int i = 0; i < 50; ++i) {
+        html += "<h3 id=\"s" + std::to_string(i) + "\">Section &amp; " + std::to_string(i) + "</h3>"
+                "<p>Text   with <a href='/p?x=1&amp;y=2'>a link</a>&nbsp;and <!-- note -->entities &#8212; "
+                "&hellip; <code>a`b &amp; c</code></p><ul><li>item <i>one</i></li><li>two</li></ul><pre>a\n  b</pre>"
+                "<table><tr><td>1</td><td>2</td></tr></table>\n";
+    }
+    html += "</body></html>";
+    const std::string whole = convert(html);
+
+    std::mt19937 rng(5);
+    for (int round = 0; round < 20; ++round) {
+        std::string streamed;
+        size_t pos = 0;
+        while (pos < html.size()) {
+            const size_t n = std::min<size_t>(html.size() - pos, 1 + rng() % (round < 10 ? 8 : 400));
+            converter.feed(std::string_view(html).substr(pos, n), streamed);
+            pos += n;
+        }
+        converter.finish(streamed);
+        ASSERT_EQ(streamed, whole) << "round " << round;
+    }
+}
+
+TEST_F(HtmlToMarkdownTest, MemoryStaysBounded) {
+    // An unterminated tag is dropped once it exceeds the cap instead of buffering the rest
+    std::string markdown;
+    converter.feed("<p>before</p><a title=\"", markdown);
+    for (int i = 0; i < 100; ++i) {
+        converter.feed(std::string(1000, 'x'), markdown);
+        EXPECT_LE(converter.buffered(), HtmlToMarkdown::kMaxTagBytes + 1000);
+    }
+    converter.feed("\">link</a><p>after</p>", markdown);
+    converter.finish(markdown);
+    EXPECT_EQ(markdown.substr(0, 6), "before");
+    EXPECT_EQ(markdown.substr(markdown.size() - 5), "after");
+
+    // Deep nesting is capped and unclosed elements are closed at the end
+    std::string deep;
+    for (int i = 0; i < 2000; ++i) {
+        deep += "<div><b>";
+    }
+    EXPECT_FALSE(convert(deep + "x").empty());
+    EXPECT_EQ(convert("<pre>open"), "```\nopen\n```");
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,434 @@
+#include <gtest/gtest.h>
+#include "../include/http_server.h"
+#include "../include/json_parser.h"
+#include "../include/microservice.h"
+#include <random>
+#include <string>
+
+namespace {
+
+// Straightforward recursive-descent validator, the oracle for the fuzz tests.
+// Writes the same canonical form as canonical() below.
+class ReferenceParser {
+public:
+    explicit ReferenceParser(std::string_view text) : s_(text), p_(0) {}
+
+    bool parse(std::string& out) {
+        skipSpace();
+        if (!value(out, 0)) {
+            return false;
+        }
+        skipSpace();
+        return p_ == s_.size();
+    }
+
+private:
+    std::string_view s_;
+    size_t p_;
+
+    void skipSpace() {
+        while (p_ < s_.size() && (s_[p_] == ' ' || s_[p_] == '\t' || s_[p_] == '\n' || s_[p_] == '\r')) {
+            ++p_;
+        }
+    }
+
+    bool literal(std::string_view word, std::string& out) {
+        if (s_.substr(p_, word.size()) != word) {
+            return false;
+        }
+        p_ += word.size();
+        out += word;
+        return true;
+    }
+
+    bool digits() {
+        const size_t start = p_;
+        while (p_ < s_.size() && s_[p_] >= '0' && s_[p_] <= '9') {
+            ++p_;
+        }
+        return p_ > start;
+    }
+
+    bool number(std::string& out) {
+        const size_t start = p_;
+        if (p_ < s_.size() && s_[p_] == '-') {
+            ++p_;
+        }
+        if (p_ < s_.size() && s_[p_] == '0') {
+            ++p_;
+        } else if (!digits()) {
+            return false;
+        }
+        if (p_ < s_.size() && s_[p_] == '.') {
+            ++p_;
+            if (!digits()) {
+                return false;
+            }
+        }
+        if (p_ < s_.size() && (s_[p_] == 'e' || s_[p_] == 'E')) {
+            ++p_;
+            if (p_ < s_.size() && (s_[p_] == '+' || s_[p_] == '-')) {
+                ++p_;
+            }
+            if (!digits()) {
+                return false;
+            }
+        }
+        out += s_.substr(start, p_ - start);
+        return true;
+    }
+
+    bool string(std::string& out) {
+        const size_t start = ++p_;
+        while (p_ < s_.size() && s_[p_] != '"') {
+            const unsigned char c = static_cast<unsigned char>(s_[p_]);
+            if (c < 0x20) {
+                return false;
+            }
+            if (c == '\\') {
+                if (++p_ == s_.size()) {
+                    return false;
+                }
+                if (s_[p_] == 'u') {
+                    for (int i = 0; i < 4; ++i) {
+                        if (++p_ == s_.size() || !std::isxdigit(static_cast<unsigned char>(s_[p_]))) {
+                            return false;
+                        }
+                    }
+                } else if (std::string_view("\"\\/bfnrt").find(s_[p_]) == std::string_view::npos) {
+                    return false;
+                }
+            }
+            ++p_;
+        }
+        if (p_ == s_.size()) {
+            return false;
+        }
+        out += '"';
+        out += s_.substr(start, p_ - start);
+        out += '"';
+        ++p_;
+        return true;
+    }
+
+    bool value(std::string& out, size_t depth) {
+        if (p_ == s_.size()) {
+            return false;
+        }
+        const char c = s_[p_];
+        if (c == '"') {
+            return string(out);
+        }
+        if (c == '{' || c == '[') {
+            if (depth >= JsonParser::kMaxDepth) {
+                return false;
+            }
+            const char close = c == '{' ? '}' : ']';
+            out += c;
+            ++p_;
+            skipSpace();
+            if (p_ < s_.size() && s_[p_] == close) {
+                ++p_;
+                out += close;
+                return true;
+            }
+            while (true) {
+                if (c == '{') {
+                    if (p_ == s_.size() || s_[p_] != '"' || !string(out)) {
+                        return false;
+                    }
+                    skipSpace();
+                    if (p_ == s_.size() || s_[p_] != ':') {
+                        return false;
+                    }
+                    ++p_;
+                    out += ':';
+                    skipSpace();
+                }
+                if (!value(out, depth + 1)) {
+                    return false;
+                }
+                skipSpace();
+                if (p_ < s_.size() && s_[p_] == ',') {
+                    ++p_;
+                    out += ',';
+                    skipSpace();
+                } else if (p_ < s_.size() && s_[p_] == close) {
+                    ++p_;
+                    out += close;
+                    return true;
+                } else {
+                    return false;
+                }
+            }
+        }
+        if (c == 't') {
+            return literal("true", out);
+        }
+        if (c == 'f') {
+            return literal("false", out);
+        }
+        if (c == 'n') {
+            return literal("null", out);
+        }
+        return number(out);
+    }
+};
+
+void canonical(const JsonValue& value, std::string& out) {
+    switch (value.type()) {
+    case JsonType::String:
+        out += '"';
+        out += value.raw();
+        out += '"';
+        break;
+    case JsonType::Array: {
+        out += '[';
+        bool first = true;
+        for (JsonValue item : value.items()) {
+            out += first ? "" : ",";
+            first = false;
+            canonical(item, out);
+        }
+        out += ']';
+        break;
+    }
+    case JsonType::Object: {
+        out += '{';
+        bool first = true;
+        for (JsonMember member : value.members()) {
+            out += first ? "" : ",";
+            first = false;
+            canonical(member.key, out);
+            out += ':';
+            canonical(member.value, out);
+        }
+        out += '}';
+        break;
+    }
+    default:
+        out += value.raw();
+    }
+}
+
+} // namespace
+
+class JsonParserTest : public ::testing::Test {
+protected:
+    JsonParser parser;
+    std::mt19937 rng{7};
+
+    std::string space() {
+        static const char* kSpaces[] = {"", "", " ", "\n  ", "\t", "\r\n"};
+        return kSpaces[rng() % 6];
+    }
+
+    std::string randomString() {
+        static const char* kPieces[] = {"a", "Z", "9", " ", "\\\"", "\\\\", "\\/", "\\n", "\\t", "\\u00e9",
+                                        "\\uD83D\\uDE00", "\xC3\xA9", "\xE2\x82\xAC", "{", "]", ",", ":", "\\\\\\\""};
+        std::string s = "\"";
+        const size_t pieces = rng() % 4 == 0 ? rng() % 120 : rng() % 12;
+        for (size_t i = 0; i < pieces; ++i) {
+            s += kPieces[rng() % 18];
+        }
+        return s + "\"";
+    }
+
+    std::string randomValue(int depth) {
+        static const char* kScalars[] = {"0", "-0", "12", "-3.25", "1e9", "6.02E+23", "1.5e-7", "true", "false", "null"};
+        const unsigned kind = depth > 4 ? rng() % 2 : rng() % 4;
+        if (kind == 0) {
+            return kScalars[rng() % 10];
+        }
+        if (kind == 1) {
+            return randomString();
+        }
+        const bool object = kind == 3;
+        std::string s = object ? "{" : "[";
+        const size_t n = rng() % 6;
+        for (size_t i = 0; i < n; ++i) {
+            s += space() + (i > 0 ? "," + space() : "");
+            if (object) {
+                s += randomString() + space() + ":" + space();
+            }
+            s += randomValue(depth + 1);
+        }
+        return s + space() + (object ? "}" : "]");
+    }
+
+    void expectSameAsReference(const std::string& text) {
+        std::string expected;
+        const bool valid = ReferenceParser(text).parse(expected);
+        ASSERT_EQ(parser.parse(text), valid) << text << " | " << parser.error();
+        if (valid) {
+            std::string actual;
+            canonical(parser.root(), actual);
+            ASSERT_EQ(actual, expected) << text;
+        }
+    }
+};
+
+TEST_F(JsonParserTest, ValuesAndLookup) {
+    const std::string text = R"( {"results": [{"title": "Caf\u00e9 \"x\"", "url": "https://a.com/", "score": 0.75},
+        {"title": "b", "url": "https://b.com/", "score": -2, "tags": []}],
+        "count": 2, "ok": true, "next": null, "emoji": "\ud83d\ude00", "bad": "\udc00"} )";
+    ASSERT_TRUE(parser.parse(text)) << parser.error();
+    JsonValue root = parser.root();
+    EXPECT_EQ(root.type(), JsonType::Object);
+    EXPECT_EQ(root.size(), 6u);
+
+    JsonValue results = root.find("results");
+    ASSERT_EQ(results.size(), 2u);
+    EXPECT_EQ(results[0].find("title").string(), "Caf\xC3\xA9 \"x\"");
+    EXPECT_EQ(results[0].find("title").raw(), "Caf\\u00e9 \\\"x\\\"");
+    EXPECT_EQ(results[1].find("url").string(), "https://b.com/");
+    double score;
+    ASSERT_TRUE(results[0].find("score").getDouble(score));
+    EXPECT_DOUBLE_EQ(score, 0.75);
+    int64_t count;
+    ASSERT_TRUE(root.find("count").getInt64(count));
+    EXPECT_EQ(count, 2);
+    EXPECT_FALSE(results[0].find("score").getInt64(count));
+    bool ok = false;
+    ASSERT_TRUE(root.find("ok").getBool(ok));
+    EXPECT_TRUE(ok);
+    EXPECT_TRUE(root.find("next").isNull());
+    EXPECT_EQ(results[1].find("tags").size(), 0u);
+    EXPECT_EQ(results[1].find("tags").raw(), "[]");
+    EXPECT_EQ(root.find("emoji").string(), "\xF0\x9F\x98\x80");
+    EXPECT_EQ(root.find("bad").string(), "\xEF\xBF\xBD");
+    EXPECT_FALSE(root.find("missing"));
+    EXPECT_FALSE(results[2]);
+
+    size_t members = 0;
+    for (JsonMember member : results[1].members()) {
+        EXPECT_TRUE(member.key);
+        ++members;
+    }
+    EXPECT_EQ(members, 4u);
+}
+
+TEST_F(JsonParserTest, RejectsInvalidDocuments) {
+    const char* invalid[] = {"", " ", "{", "}", "[1,]", "[,1]", "{\"a\" 1}", "{\"a\":}", "{1:2}", "[1 2]",
+                             "01", "1.", ".5", "-", "1e", "+1", "tru", "nul", "truex", "\"abc", "\"a\\x\"",
+                             "\"\\u12g4\"", "\"tab\there\"", "[1]]", "{} {}", "[\"a\"\"b\"]", "\x01", "[\x01]"};
+    for (const char* text : invalid) {
+        EXPECT_FALSE(parser.parse(text)) << text;
+        EXPECT_FALSE(parser.root());
+    }
+    EXPECT_TRUE(parser.parse("  \"\"  "));
+    EXPECT_TRUE(parser.parse("-0.0e+00"));
+    EXPECT_TRUE(parser.parse(std::string(1024, '[') + std::string(1024, ']')));
+    EXPECT_FALSE(parser.parse(std::string(1025, '[') + std::string(1025, ']')));
+}
+
+TEST_F(JsonParserTest, EscapesAcrossBlockBoundaries) {
+    // Backslash runs of every length ending on every offset around a 64-byte block edge
+    for (size_t pad = 50; pad < 70; ++pad) {
+        for (size_t run = 1; run <= 5; ++run) {
+            const std::string text = "[\"" + std::string(pad, 'x') + std::string(run, '\\') + "\"\"]";
+            expectSameAsReference(text);
+            const std::string closed = "[\"" + std::string(pad, 'x') + std::string(2 * run, '\\') + "\", 1]";
+            ASSERT_TRUE(parser.parse(closed)) << closed;
+            EXPECT_EQ(parser.root()[0].string(), std::string(pad, 'x') + std::string(run, '\\'));
+            EXPECT_EQ(parser.root().size(), 2u);
+        }
+    }
+}
+
+TEST_F(JsonParserTest, FuzzAgainstReference) {
+    static const char kBytes[] = "\"\\{}[],: \n\t0123-+.eEtfnlrua\x01\x7F\xC3";
+    for (int round = 0; round < 20000; ++round) {
+        std::string text = randomValue(0);
+        expectSameAsReference(text);
+        if (HasFatalFailure()) {
+            return;
+        }
+        const size_t edits = 1 + rng() % 3;
+        for (size_t e = 0; e < edits && !text.empty(); ++e) {
+            const size_t at = rng() % text.size();
+            switch (rng() % 4) {
+            case 0:
+                text[at] = kBytes[rng() % (sizeof(kBytes) - 1)];
+                break;
+            case 1:
+                text.erase(at, 1);
+                break;
+            case 2:
+                text.insert(text.begin() + at, kBytes[rng() % (sizeof(kBytes) - 1)]);
+                break;
+            default:
+                text.resize(at);
+            }
+        }
+        expectSameAsReference(text);
+        if (HasFatalFailure()) {
+            return;
+        }
+    }
+}
+
+TEST_F(JsonParserTest, FlattensRequestBodies) {
+    std::map<std::string, std::string> params;
+    ASSERT_TRUE(flattenJson(R"({"documents": [{"id": "d1", "text": "a\nb", "vector": [0.5, -1, 2e3],
+        "metadata": {"url": "https://a.com", "rank": 3}}, {"id": "d2", "text": ""}],
+        "namespace": "ns", "wait": true, "skip": null, "empty": {}})", params));
+    EXPECT_EQ(params["documents.0.id"], "d1");
+    EXPECT_EQ(params["documents.0.text"], "a\nb");
+    EXPECT_EQ(params["documents.0.vector"], "0.5,-1,2e3");
+    EXPECT_EQ(params["documents.0.metadata.url"], "https://a.com");
+    EXPECT_EQ(params["documents.0.metadata.rank"], "3");
+    EXPECT_EQ(params["documents.1.text"], "");
+    EXPECT_EQ(params["namespace"], "ns");
+    EXPECT_EQ(params["wait"], "true");
+    EXPECT_EQ(params.count("skip"), 0u);
+    EXPECT_EQ(params.count("empty"), 0u);
+    EXPECT_EQ(params.size(), 9u);
+
+    std::map<std::string, std::string> strings;
+    ASSERT_TRUE(flattenJson(R"({"texts": ["x", "1", true]})", strings));
+    EXPECT_EQ(strings["texts.0"], "x");
+    EXPECT_EQ(strings["texts.1"], "1");
+    EXPECT_EQ(strings["texts.2"], "true");
+    std::string error;
+    EXPECT_FALSE(flattenJson("[1, 2]", strings, &error));
+    EXPECT_EQ(error, "request body must be a JSON object");
+    EXPECT_FALSE(flattenJson("{\"a\": }", strings));
+}
+
+TEST_F(JsonParserTest, RejectsArraysMixingNumbersWithOtherValues) {
+    // Joined or indexed must follow from the key alone: a null among scores may not shift them into scores.<j>
+    std::map<std::string, std::string> params;
+    std::string error;
+    EXPECT_FALSE(flattenJson(R"({"lists": [{"urls": ["a"], "scores": [0.9, null, 0.5]}]})", params, &error));
+    EXPECT_EQ(error, "array lists.0.scores mixes numbers with other values");
+    EXPECT_FALSE(flattenJson(R"({"texts": ["x", 1]})", params, &error));
+    EXPECT_EQ(error, "array texts mixes numbers with other values");
+    EXPECT_FALSE(flattenJson(R"({"vector": [[1, 2], 3]})", params, &error));
+    EXPECT_EQ(error, "array vector mixes numbers with other values");
+
+    params.clear();
+    ASSERT_TRUE(flattenJson(R"({"vectors": [[1, 2], [3]], "none": [null, null]})", params));
+    EXPECT_EQ(params["vectors.0"], "1,2");
+    EXPECT_EQ(params["vectors.1"], "3");
+    EXPECT_EQ(params.size(), 2u);
+
+    Microservice service;
+    HttpServer server(service);
+    server.post("/echo", [](const std::map<std::string, std::string>&) { return std::string("ok"); });
+    EXPECT_EQ(server.dispatch("POST", "/echo", R"({"scores": [1, "2"]})"),
+              "{\"error\": \"array scores mixes numbers with other values\"}");
+}
+
+TEST_F(JsonParserTest, ServerDecodesBodies) {
+    Microservice service;
+    HttpServer server(service);
+    server.post("/echo", [](const std::map<std::string, std::string>& params) {
+        auto it = params.find("texts.1");
+        return it != params.end() ? it->second : std::string("missing");
+    });
+    EXPECT_EQ(server.dispatch("POST", "/echo", R"({"texts": ["a", "b\u00e9"]})"), "b\xC3\xA9");
+    EXPECT_EQ(server.dispatch("POST", "/echo", ""), "missing");
+    EXPECT_EQ(server.dispatch("POST", "/echo", "{\"texts\": ["), "{\"error\": \"request body must be a JSON object\"}");
+    EXPECT_EQ(server.dispatch("GET", "/echo", ""), "{\"error\": \"not found\"}");
+}
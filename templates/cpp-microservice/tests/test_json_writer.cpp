@@ -0,0 +1,265 @@
+#include <gtest/gtest.h>
+#include "allocation_counter.h"
+#include "../include/http_server.h"
+#include "../include/json_parser.h"
+#include "../include/json_util.h"
+#include "../include/json_writer.h"
+#include "../include/microservice.h"
+#include "../include/user_model.h"
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SearchResult {
+    std::string url;
+    std::string title;
+    std::string snippet;
+    std::vector<std::string> engines;
+    double score;
+    uint32_t rank;
+    std::optional<std::string> publishedDate;
+};
+
+template <>
+struct JsonFields<SearchResult> {
+    static constexpr auto fields =
+        std::make_tuple(jsonField("url", &SearchResult::url), jsonField("title", &SearchResult::title),
+                        jsonField("snippet", &SearchResult::snippet), jsonField("engines", &SearchResult::engines),
+                        jsonField("score", &SearchResult::score), jsonField("rank", &SearchResult::rank),
+                        jsonField("published_date", &SearchResult::publishedDate));
+};
+
+class JsonWriterTest : public ::testing::Test {
+protected:
+    // Byte-at-a-time escaping, as a reference for the SIMD runs
+    static std::string reference(const std::string& value) {
+        static const char kHex[] = "0123456789abcdef";
+        std::string out = "\"";
+        for (char c : value) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if (c == '\n') {
+                out += "\\n";
+            } else if (c == '\r') {
+                out += "\\r";
+            } else if (c == '\t') {
+                out += "\\t";
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                out += "\\u00";
+                out += kHex[(c >> 4) & 0xF];
+                out += kHex[c & 0xF];
+            } else {
+                out += c;
+            }
+        }
+        return out + "\"";
+    }
+
+    template <class T>
+    static std::string json(const T& value) {
+        BufferChain out;
+        JsonWriter writer(out);
+        writer.write(value);
+        return out.str();
+    }
+
+    static std::vector<SearchResult> results(size_t count) {
+        std::vector<SearchResult> out;
+        for (size_t i = 0; i < count; ++i) {
+            SearchResult result;
+            result.url = "https://example.com/articles/" + std::to_string(i);
+            result.title = "Result \"" + std::to_string(i) + "\" about vector search";
+            result.snippet = std::string(200, 'x') + "\ttab";
+            result.engines = {"duckduckgo", "brave"};
+            result.score = 1.0 / (i + 1);
+            result.rank = static_cast<uint32_t>(i + 1);
+            if (i % 2 == 0) {
+                result.publishedDate = "2024-05-01";
+            }
+            out.push_back(result);
+        }
+        return out;
+    }
+};
+
+TEST_F(JsonWriterTest, WritesValues) {
+    BufferChain out;
+    JsonWriter writer(out);
+    writer.beginObject();
+    writer.member("text", "caf\xC3\xA9 \"q\" \\ \n\x01");
+    writer.key("list");
+    writer.beginArray();
+    writer.write(1);
+    writer.write(-2.5);
+    writer.write(true);
+    writer.null();
+    writer.beginArray();
+    writer.endArray();
+    writer.beginObject();
+    writer.endObject();
+    writer.endArray();
+    writer.member("raw", 0);
+    writer.endObject();
+    EXPECT_EQ(out.str(), "{\"text\": \"caf\xC3\xA9 \\\"q\\\" \\\\ \\n\\u0001\", \"list\": [1, -2.5, true, null, [], {}], "
+                         "\"raw\": 0}");
+
+    EXPECT_EQ(json(0.1), "0.1");
+    EXPECT_EQ(json(1e300), "1e+300");
+    EXPECT_EQ(json(1.0), "1");
+    EXPECT_EQ(json(0.5f), "0.5");
+    EXPECT_EQ(json(std::numeric_limits<double>::infinity()), "null");
+    EXPECT_EQ(json(std::nan("")), "null");
+    EXPECT_EQ(json(std::numeric_limits<int64_t>::min()), "-9223372036854775808");
+    EXPECT_EQ(json(std::numeric_limits<uint64_t>::max()), "18446744073709551615");
+    EXPECT_EQ(json(false), "false");
+    EXPECT_EQ(json(std::optional<int>()), "null");
+    EXPECT_EQ(json(std::optional<int>(3)), "3");
+    EXPECT_EQ(json(std::vector<std::string>{"a", "b"}), "[\"a\", \"b\"]");
+    EXPECT_EQ(json(std::map<std::string, int>{{"a", 1}, {"b", 2}}), "{\"a\": 1, \"b\": 2}");
+}
+
+TEST_F(JsonWriterTest, AppendsNumbersThatRoundTrip) {
+    const double values[] = {1792893381.123, 0.1 + 0.2, 1.0, -2.5, 1e300, 5e-324};
+    const char* const expected[] = {"1792893381.123", "0.30000000000000004", "1", "-2.5", "1e+300", "5e-324"};
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+        std::string out;
+        appendJsonNumber(out, values[i]);
+        EXPECT_EQ(out, expected[i]);
+        EXPECT_EQ(std::strtod(out.c_str(), nullptr), values[i]);
+    }
+    std::string out;
+    appendJsonNumber(out, std::nan(""));
+    EXPECT_EQ(out, "null");
+}
+
+TEST_F(JsonWriterTest, EscapesLikeReference) {
+    std::mt19937 rng(7);
+    const char alphabet[] = {'a', 'b', ' ', '"', '\\', '\n', '\x1F', '\x7F', '\xC3', '\xA9', '\0'};
+    for (int iteration = 0; iteration < 2000; ++iteration) {
+        std::string value(rng() % 100, 'x');
+        for (char& c : value) {
+            // Mostly plain text, so the SIMD runs get long
+            if (rng() % 8 == 0) {
+                c = alphabet[rng() % sizeof(alphabet)];
+            }
+        }
+        ASSERT_EQ(json(value), reference(value));
+        std::string appended;
+        appendJsonString(appended, value);
+        ASSERT_EQ(appended, reference(value));
+
+        JsonParser parser;
+        const std::string doc = json(value);
+        ASSERT_TRUE(parser.parse(doc));
+        EXPECT_EQ(parser.root().string(), value);
+    }
+}
+
+TEST_F(JsonWriterTest, SpansBlocks) {
+    BufferChain out;
+    JsonWriter writer(out);
+    std::vector<std::string> values;
+    for (size_t i = 0; i < 3000; ++i) {
+        values.push_back("value number " + std::to_string(i) + " \"quoted\"");
+    }
+    writer.write(values);
+    ASSERT_GT(out.blockCount(), 2u);
+
+    std::string expected = "[";
+    for (size_t i = 0; i < values.size(); ++i) {
+        expected += (i > 0 ? ", " : "") + reference(values[i]);
+    }
+    expected += "]";
+    EXPECT_EQ(out.str(), expected);
+    EXPECT_EQ(out.size(), expected.size());
+
+    std::string joined;
+    for (size_t i = 0; i < out.blockCount(); ++i) {
+        EXPECT_LE(out.block(i).size(), BufferChain::kBlockSize);
+        joined += out.block(i);
+    }
+    EXPECT_EQ(joined, expected);
+
+    out.clear();
+    EXPECT_TRUE(out.empty());
+    JsonWriter next(out);
+    next.write(12345);
+    EXPECT_EQ(out.str(), "12345");
+}
+
+TEST_F(JsonWriterTest, ReflectsStructs) {
+    EXPECT_EQ(json(UserModel(1, "John \"JD\" Doe", "john@example.com")),
+              "{\"id\": 1, \"name\": \"John \\\"JD\\\" Doe\", \"email\": \"john@example.com\"}");
+
+    const std::vector<SearchResult> ranked = results(2);
+    JsonParser parser;
+    const std::string doc = json(ranked);
+    ASSERT_TRUE(parser.parse(doc)) << parser.error();
+    JsonValue first = parser.root()[0];
+    EXPECT_EQ(first.find("url").string(), ranked[0].url);
+    EXPECT_EQ(first.find("title").string(), ranked[0].title);
+    EXPECT_EQ(first.find("snippet").string(), ranked[0].snippet);
+    EXPECT_EQ(first.find("engines")[1].string(), "brave");
+    double score = 0.0;
+    ASSERT_TRUE(first.find("score").getDouble(score));
+    EXPECT_EQ(score, 1.0);
+    EXPECT_EQ(first.find("published_date").string(), "2024-05-01");
+    EXPECT_TRUE(parser.root()[1].find("published_date").isNull());
+    EXPECT_EQ(parser.root()[1].find("rank").raw(), "2");
+}
+
+TEST_F(JsonWriterTest, SerializesResultsWithoutAllocating) {
+    const std::vector<SearchResult> ranked = results(100);
+    BufferChain out;
+    auto serialize = [&]() {
+        out.clear();
+        JsonWriter writer(out);
+        writer.beginObject();
+        writer.member("query", "vector search");
+        writer.member("results", ranked);
+        writer.member("count", ranked.size());
+        writer.endObject();
+    };
+    serialize();    // Sizes the buffer
+
+    size_t before = allocations.load();
+    serialize();
+    EXPECT_EQ(allocations.load(), before);
+
+    JsonParser parser;
+    const std::string doc = out.str();
+    ASSERT_TRUE(parser.parse(doc));
+    EXPECT_EQ(parser.root().find("results").size(), 100u);
+}
+
+TEST_F(JsonWriterTest, ServerStreamsResponses) {
+    Microservice service;
+    HttpServer server(service);
+    server.postJson("/users", [](const std::map<std::string, std::string>& params, JsonWriter& out) {
+        auto name = params.find("name");
+        out.write(UserModel(7, name != params.end() ? name->second : "", "u@example.com"));
+    });
+    server.get("/plain", [](const std::map<std::string, std::string>&) { return std::string("{\"ok\": true}"); });
+
+    BufferChain out;
+    server.dispatch("POST", "/users", R"({"name": "Ann"})", out);
+    EXPECT_EQ(out.str(), "{\"id\": 7, \"name\": \"Ann\", \"email\": \"u@example.com\"}");
+    EXPECT_EQ(server.dispatch("GET", "/plain", ""), "{\"ok\": true}");
+    EXPECT_EQ(server.dispatch("GET", "/users", ""), "{\"error\": \"not found\"}");
+
+    ASSERT_TRUE(server.start("127.0.0.1", 0));
+    EXPECT_EQ(server.dispatch("GET", "/health", ""), "{\"status\": \"healthy\", \"service\": \"cpp-microservice\"}");
+    EXPECT_EQ(server.dispatch("GET", "/version", ""), "{\"version\": \"1.0.0\", \"service\": \"cpp-microservice\"}");
+    server.stop();
+    // The simulated server loop is detached; let it see running_ go false before the server is destroyed
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+}
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include "../include/near_duplicate.h"
+#include <random>
+#include <string>
+#include <vector>
+
+class NearDuplicateTest : public ::testing::Test {
+protected:
+    std::mt19937 rng{3};
+
+    std::string randomText(size_t words) {
+        std::string text;
+        for (size_t i = 0; i < words; ++i) {
+            const size_t length = 3 + rng() % 7;
+            for (size_t c = 0; c < length; ++c) {
+                text.push_back(static_cast<char>('a' + rng() % 26));
+            }
+            text += i % 12 == 11 ? ". " : " ";
+        }
+        return text;
+    }
+
+    // Replaces one word in every @p every with a new one
+    std::string edit(const std::string& text, size_t every) {
+        std::string out;
+        size_t word = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            if (text[i] == ' ' && ++word % every == 0) {
+                out += " edited";
+                while (i + 1 < text.size() && text[i + 1] != ' ') {
+                    ++i;
+                }
+                continue;
+            }
+            out.push_back(text[i]);
+        }
+        return out;
+    }
+};
+
+TEST_F(NearDuplicateTest, Signatures) {
+    NearDuplicateIndex index;
+    DocumentSignature a, b, c, d;
+    const std::string text = randomText(400);
+    index.sign(text, a);
+    std::string shouted = text;
+    for (char& ch : shouted) {
+        ch = ch == ' ' ? '\n' : static_cast<char>(ch == '.' ? ',' : ch - 32 * (ch >= 'a' && ch <= 'z'));
+    }
+    index.sign(shouted, b);
+    EXPECT_EQ(a.minhash, b.minhash);    // Case and punctuation do not matter
+    EXPECT_EQ(a.simhash, b.simhash);
+    EXPECT_EQ(a.shingles, 397u);
+    EXPECT_EQ(a.minhash.size(), 96u);
+
+    index.sign(edit(text, 50), c);
+    index.sign(randomText(400), d);
+    EXPECT_GT(NearDuplicateIndex::similarity(a, c), 0.75);
+    EXPECT_LT(NearDuplicateIndex::similarity(a, d), 0.05);
+    EXPECT_LE(__builtin_popcountll(a.simhash ^ c.simhash), 12);
+    EXPECT_GE(__builtin_popcountll(a.simhash ^ d.simhash), 12);
+
+    // Non-ASCII words are lower-cased too
+    index.sign("Caf\xC3\xA9 \xCE\x91\xCE\x98\xCE\x97\xCE\x9D\xCE\x91 na\xC3\xAFve r\xC3\xA9sum\xC3\xA9", a);
+    index.sign("CAF\xC3\x89 \xCE\xB1\xCE\xB8\xCE\xB7\xCE\xBD\xCE\xB1 NA\xC3\x8FVE R\xC3\x89SUM\xC3\x89", b);
+    EXPECT_EQ(a.minhash, b.minhash);
+}
+
+TEST_F(NearDuplicateTest, FindsNearDuplicatesOnly) {
+    NearDuplicateIndex index;
+    std::vector<std::string> texts;
+    DocumentSignature signature;
+    for (size_t i = 0; i < 300; ++i) {
+        texts.push_back(randomText(200 + rng() % 600));
+        index.sign(texts.back(), signature);
+        EXPECT_EQ(index.add(signature), i);
+    }
+    EXPECT_EQ(index.size(), 300u);
+    size_t found = 0;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        index.sign(edit(texts[i], 100), signature);
+        const uint64_t match = index.find(signature);
+        found += match == i;
+        EXPECT_TRUE(match == i || match == NearDuplicateIndex::kNotFound);
+        index.sign(randomText(300), signature);
+        EXPECT_EQ(index.find(signature), NearDuplicateIndex::kNotFound);
+    }
+    EXPECT_GE(found, 295u);
+}
+
+TEST_F(NearDuplicateTest, ClustersBatchInOrder) {
+    NearDuplicateIndex index;
+    const std::string a = randomText(300);
+    const std::string b = randomText(300);
+    const std::string c = randomText(300);
+    const std::string aCopy = "Home | News\n" + a + "\nCookie settings";
+    const std::string bCopy = edit(b, 60);
+    std::vector<size_t> clusters;
+    index.cluster({a, b, aCopy, c, bCopy, "", ""}, clusters);
+    EXPECT_EQ(clusters, (std::vector<size_t>{0, 1, 0, 3, 1, 5, 6}));    // Empty texts never match
+    EXPECT_EQ(index.size(), 0u);
+}
+
+TEST_F(NearDuplicateTest, CapacityDropsOldest) {
+    NearDuplicateOptions options;
+    options.capacity = 3;
+    NearDuplicateIndex index(options);
+    std::vector<DocumentSignature> signatures(5);
+    for (size_t i = 0; i < signatures.size(); ++i) {
+        index.sign(randomText(100), signatures[i]);
+        index.add(signatures[i]);
+    }
+    EXPECT_EQ(index.size(), 3u);
+    EXPECT_EQ(index.find(signatures[0]), NearDuplicateIndex::kNotFound);
+    EXPECT_EQ(index.find(signatures[1]), NearDuplicateIndex::kNotFound);
+    EXPECT_EQ(index.find(signatures[2]), 2u);
+    EXPECT_EQ(index.find(signatures[4]), 4u);
+
+    // Re-adding a text that is stored twice reports the older copy
+    index.add(signatures[4]);
+    EXPECT_EQ(index.find(signatures[4]), 4u);
+    index.clear();
+    EXPECT_EQ(index.size(), 0u);
+    EXPECT_EQ(index.find(signatures[4]), NearDuplicateIndex::kNotFound);
+}
+
+TEST_F(NearDuplicateTest, ShortTexts) {
+    NearDuplicateIndex index;
+    DocumentSignature a, b, empty;
+    index.sign("Rust 1.80 released", a);
+    index.sign("rust 1.80 Released!", b);
+    index.sign(" \n,. ", empty);
+    EXPECT_EQ(a.shingles, 1u);
+    EXPECT_EQ(empty.shingles, 0u);
+    index.add(a);
+    index.add(empty);
+    EXPECT_EQ(index.find(b), 0u);
+    EXPECT_EQ(index.find(empty), NearDuplicateIndex::kNotFound);
+    index.sign("Rust 1.81 released", b);
+    EXPECT_EQ(index.find(b), NearDuplicateIndex::kNotFound);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include "../include/quantization.h"
+#include <random>
+
+// Test fixture for the vector quantizers
+class QuantizationTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::mt19937 rng(7);
+        std::normal_distribution<float> normal;
+        data_.resize(kCount * kDim);
+        for (float& x : data_) {
+            x = normal(rng);
+        }
+        for (size_t i = 0; i < kCount; ++i) {
+            normalizeVector(data_.data() + i * kDim, kDim);
+        }
+    }
+
+    // Mean squared reconstruction error over the data set
+    double reconstructionError(const VectorQuantizer& quantizer) {
+        std::vector<uint8_t> code(quantizer.codeSize());
+        std::vector<float> decoded(kDim);
+        double error = 0.0;
+        for (size_t i = 0; i < kCount; ++i) {
+            quantizer.encode(data_.data() + i * kDim, code.data());
+            quantizer.decode(code.data(), decoded.data());
+            error += squaredL2(data_.data() + i * kDim, decoded.data(), kDim);
+        }
+        return error / kCount;
+    }
+
+    static constexpr uint32_t kDim = 32;
+    static constexpr size_t kCount = 2000;
+    std::vector<float> data_;
+};
+
+TEST_F(QuantizationTest, ParseType) {
+    EXPECT_EQ(parseQuantizerType("sq8"), QuantizerType::Scalar8);
+    EXPECT_EQ(parseQuantizerType("pq"), QuantizerType::Product);
+    EXPECT_EQ(parseQuantizerType("none"), QuantizerType::None);
+    EXPECT_EQ(parseQuantizerType("bogus"), QuantizerType::None);
+}
+
+// ADC distances track exact distances, and the codebook survives serialization
+TEST_F(QuantizationTest, AsymmetricDistanceAndRoundTrip) {
+    for (QuantizerType type : {QuantizerType::Scalar8, QuantizerType::Product}) {
+        for (DistanceMetric metric : {DistanceMetric::Cosine, DistanceMetric::L2}) {
+            std::unique_ptr<VectorQuantizer> quantizer = VectorQuantizer::create(type, metric, kDim);
+            ASSERT_TRUE(quantizer);
+            ASSERT_TRUE(quantizer->train(data_.data(), kCount));
+            EXPECT_LT(reconstructionError(*quantizer), type == QuantizerType::Scalar8 ? 1e-3 : 0.5);
+
+            std::string params;
+            quantizer->serialize(params);
+            std::unique_ptr<VectorQuantizer> loaded =
+                VectorQuantizer::deserialize(reinterpret_cast<const uint8_t*>(params.data()), params.size());
+            ASSERT_TRUE(loaded);
+            EXPECT_EQ(loaded->type(), type);
+            EXPECT_EQ(loaded->codeSize(), quantizer->codeSize());
+
+            const float* query = data_.data();
+            std::vector<float> table;
+            std::vector<float> loadedTable;
+            quantizer->prepareQuery(query, table);
+            loaded->prepareQuery(query, loadedTable);
+            std::vector<uint8_t> code(quantizer->codeSize());
+            std::vector<float> decoded(kDim);
+            for (size_t i = 1; i < 100; ++i) {
+                quantizer->encode(data_.data() + i * kDim, code.data());
+                quantizer->decode(code.data(), decoded.data());
+                float expected = vectorDistance(metric, query, decoded.data(), kDim);
+                EXPECT_NEAR(quantizer->distance(table, code.data()), expected, 1e-3f);
+                EXPECT_FLOAT_EQ(loaded->distance(loadedTable, code.data()), quantizer->distance(table, code.data()));
+            }
+        }
+    }
+}
+
+TEST_F(QuantizationTest, RejectsTruncatedParams) {
+    std::unique_ptr<VectorQuantizer> quantizer = VectorQuantizer::create(QuantizerType::Product, DistanceMetric::L2, kDim);
+    ASSERT_TRUE(quantizer->train(data_.data(), kCount));
+    std::string params;
+    quantizer->serialize(params);
+    EXPECT_FALSE(VectorQuantizer::deserialize(reinterpret_cast<const uint8_t*>(params.data()), params.size() - 1));
+    EXPECT_FALSE(VectorQuantizer::deserialize(reinterpret_cast<const uint8_t*>(params.data()), 8));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include "../include/roaring_bitmap.h"
+#include <cstring>
+#include <deque>
+#include <random>
+#include <set>
+
+// Test fixture for the roaring bitmap encoding
+class RoaringBitmapTest : public ::testing::Test {
+protected:
+    RoaringView encode(const std::vector<uint32_t>& rows) {
+        // Keep the 8-byte alignment the segment file guarantees
+        buffers_.emplace_back();
+        encodeRoaring(rows.data(), rows.size(), buffers_.back().bytes);
+        buffers_.back().words.resize(buffers_.back().bytes.size() / 8 + 1);
+        std::memcpy(buffers_.back().words.data(), buffers_.back().bytes.data(), buffers_.back().bytes.size());
+        RoaringView view;
+        EXPECT_TRUE(view.open(reinterpret_cast<const uint8_t*>(buffers_.back().words.data()),
+                              buffers_.back().bytes.size()));
+        return view;
+    }
+
+    struct Buffer {
+        std::string bytes;
+        std::vector<uint64_t> words;
+    };
+    std::deque<Buffer> buffers_;
+};
+
+// Sparse (array) and dense (bitmap) containers round-trip
+TEST_F(RoaringBitmapTest, RoundTrip) {
+    std::mt19937 rng(3);
+    std::set<uint32_t> unique;
+    for (int i = 0; i < 1000; ++i) {
+        unique.insert(rng() % 1000000);         // Sparse across many containers
+    }
+    for (uint32_t i = 200000; i < 210000; ++i) {
+        unique.insert(i);                        // One dense container
+    }
+    std::vector<uint32_t> rows(unique.begin(), unique.end());
+
+    RoaringView view = encode(rows);
+    EXPECT_EQ(view.cardinality(), rows.size());
+    std::vector<uint32_t> decoded;
+    view.toArray(decoded);
+    EXPECT_EQ(decoded, rows);
+
+    for (uint32_t probe = 0; probe < 1000000; probe += 37) {
+        EXPECT_EQ(view.contains(probe), unique.count(probe) == 1) << probe;
+    }
+    EXPECT_FALSE(view.contains(4000000000u));
+}
+
+TEST_F(RoaringBitmapTest, Intersect) {
+    std::vector<uint32_t> evens, threes, big;
+    for (uint32_t i = 0; i < 150000; ++i) {
+        if (i % 2 == 0) {
+            evens.push_back(i);
+        }
+        if (i % 3 == 0) {
+            threes.push_back(i);
+        }
+    }
+    big = {6, 12, 13, 140000, 149994};
+    RoaringView a = encode(evens);
+    RoaringView b = encode(threes);
+    RoaringView c = encode(big);
+
+    std::vector<uint32_t> expected = {6, 12, 149994};
+    EXPECT_EQ(RoaringView::intersect({&a, &b, &c}), expected);
+    EXPECT_EQ(RoaringView::intersect({&a, &b}).size(), 25000u);
+}
+
+TEST_F(RoaringBitmapTest, RejectsMalformed) {
+    std::vector<uint32_t> rows = {1, 2, 3, 70000};
+    std::string bytes;
+    encodeRoaring(rows.data(), rows.size(), bytes);
+    std::vector<uint64_t> words(bytes.size() / 8 + 1);
+    std::memcpy(words.data(), bytes.data(), bytes.size());
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(words.data());
+
+    RoaringView view;
+    EXPECT_TRUE(view.open(data, bytes.size()));
+    EXPECT_FALSE(view.open(data, bytes.size() - 7));    // Cuts into the last container (6 bytes are padding)
+    EXPECT_FALSE(view.open(data, 3));
+    EXPECT_TRUE(view.empty());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,331 @@
+#include <gtest/gtest.h>
+#include "../include/config_manager.h"
+#include "../include/crawl_frontier_service.h"
+#include "../include/microservice.h"
+#include "../include/robots_cache.h"
+#include "../include/robots_service.h"
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// A stand-in for the hosts being crawled: serves robots.txt bodies by URL and counts requests
+class StubHost {
+public:
+    void serve(const std::string& url, int status, const std::string& body) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        files_[url] = RobotsFetchResult{status, body};
+    }
+
+    RobotsCache::Fetcher fetcher(int delayMillis = 0) {
+        return [this, delayMillis](const std::string& url) {
+            ++requests;
+            if (delayMillis > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(delayMillis));
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = files_.find(url);
+            return it != files_.end() ? it->second : RobotsFetchResult{404, "not found"};
+        };
+    }
+
+    std::atomic<int> requests{0};
+
+private:
+    std::mutex mutex_;
+    std::map<std::string, RobotsFetchResult> files_;
+};
+
+RobotsRules rules(const std::string& text) {
+    return RobotsRules::parse(text, "DeepSearchStack/1.0");
+}
+
+} // namespace
+
+TEST(RobotsRulesTest, LongestMatchWinsAndAllowWinsTies) {
+    RobotsRules r = rules("User-agent: *\nAllow: /p\nDisallow: /\n");
+    EXPECT_TRUE(r.allowed("/page"));
+    EXPECT_FALSE(r.allowed("/other"));
+
+    r = rules("User-agent: *\nAllow: /folder\nDisallow: /folder\n");
+    EXPECT_TRUE(r.allowed("/folder/page"));
+
+    r = rules("User-agent: *\nAllow: /page\nDisallow: /*.html\n");
+    EXPECT_FALSE(r.allowed("/page.html"));
+    EXPECT_TRUE(r.allowed("/page.php"));
+
+    r = rules("User-agent: *\nAllow: /$\nDisallow: /\n");
+    EXPECT_TRUE(r.allowed("/"));
+    EXPECT_FALSE(r.allowed("/page.htm"));
+    EXPECT_TRUE(r.allowed("/robots.txt"));
+
+    r = rules("User-agent: *\nDisallow: /private\nAllow: /private/public\nDisallow: /private/public/secret\n");
+    EXPECT_FALSE(r.allowed("/private"));
+    EXPECT_TRUE(r.allowed("/private/public/page"));
+    EXPECT_FALSE(r.allowed("/private/public/secret/x"));
+    EXPECT_TRUE(r.allowed("/priv"));
+}
+
+TEST(RobotsRulesTest, MatchesWildcardsAndEndAnchors) {
+    RobotsRules r = rules("User-agent: *\nDisallow: /*.php$\nDisallow: /fish*\nDisallow: /*/print/*?ref=\n"
+                          "Disallow: /a**b\nAllow: /*.php$x\n");
+    EXPECT_FALSE(r.allowed("/index.php"));
+    EXPECT_FALSE(r.allowed("/dir/index.php"));
+    EXPECT_TRUE(r.allowed("/index.php?x=1"));
+    EXPECT_TRUE(r.allowed("/index.php5"));
+    EXPECT_FALSE(r.allowed("/fish"));
+    EXPECT_FALSE(r.allowed("/fish.html"));
+    EXPECT_FALSE(r.allowed("/fishheads/yummy.html"));
+    EXPECT_TRUE(r.allowed("/Fish.asp"));
+    EXPECT_FALSE(r.allowed("/news/print/2024?ref=home"));
+    EXPECT_TRUE(r.allowed("/news/print/2024"));
+    EXPECT_FALSE(r.allowed("/a-to-b"));
+    // "$" inside a rule is a literal byte
+    EXPECT_TRUE(r.allowed("/x.php$x"));
+
+    // Branching is bounded, so a rule built to backtrack cannot stall a check
+    r = rules("User-agent: *\nDisallow: /*a*a*a*a*a*a*a*a*a*a*b\n");
+    EXPECT_TRUE(r.allowed("/" + std::string(300, 'a')));
+    EXPECT_FALSE(r.allowed("/aaaaaaaaaab"));
+
+    r = rules("User-agent: *\nDisallow: /*$\nAllow: /ok\n");
+    EXPECT_FALSE(r.allowed("/anything"));
+    EXPECT_TRUE(r.allowed("/ok/page"));
+}
+
+TEST(RobotsRulesTest, ComparesPercentEncodedPaths) {
+    RobotsRules r = rules("User-agent: *\nDisallow: /%7ejoe/\nDisallow: /caf\xc3\xa9\n");
+    EXPECT_FALSE(r.allowed("/%7Ejoe/index.html"));
+    EXPECT_FALSE(r.allowed("/%7ejoe/index.html"));
+    EXPECT_FALSE(r.allowed("/caf%C3%A9"));
+    EXPECT_FALSE(r.allowed("/caf%c3%a9/menu"));
+    EXPECT_TRUE(r.allowed("/cafe"));
+    EXPECT_EQ(normalizeRobotsPath("/a%2fb\xe2\x82\xac"), "/a%2Fb%E2%82%AC");
+}
+
+TEST(RobotsRulesTest, PicksTheGroupsOfTheAgent) {
+    const std::string text = "# comment\r\n"
+                             "User-agent: *\r\n"
+                             "Disallow: /everyone   # trailing comment\r\n"
+                             "Crawl-delay: 1\r\n"
+                             "\r\n"
+                             "User-agent: OtherBot\r\n"
+                             "user-agent: deepsearchstack\r\n"
+                             "Disallow: /shared\r\n"
+                             "\r\n"
+                             "Sitemap: https://example.com/sitemap.xml\r\n"
+                             "User-Agent: DeepSearchStack\r\n"
+                             "Crawl-delay: 2.5\r\n"
+                             "Disallow: /ours\r\n"
+                             "Disallow:\r\n";
+    RobotsRules ours = rules(text);
+    EXPECT_FALSE(ours.allowed("/shared/x"));
+    EXPECT_FALSE(ours.allowed("/ours"));
+    EXPECT_TRUE(ours.allowed("/everyone"));
+    EXPECT_EQ(ours.crawlDelayMillis(), 2500u);
+    EXPECT_EQ(ours.ruleCount(), 2u);
+    ASSERT_EQ(ours.sitemaps().size(), 1u);
+    EXPECT_EQ(ours.sitemaps()[0], "https://example.com/sitemap.xml");
+
+    RobotsRules others = RobotsRules::parse(text, "SomeBot");
+    EXPECT_FALSE(others.allowed("/everyone"));
+    EXPECT_TRUE(others.allowed("/ours"));
+    EXPECT_EQ(others.crawlDelayMillis(), 1000u);
+
+    EXPECT_TRUE(rules("").allowed("/anything"));
+    EXPECT_FALSE(RobotsRules::disallowAll().allowed("/anything"));
+    EXPECT_TRUE(RobotsRules::disallowAll().allowed("/robots.txt"));
+}
+
+TEST(RobotsCacheTest, SplitsOrigins) {
+    std::string origin;
+    std::string_view path;
+    ASSERT_TRUE(RobotsCache::originOf("HTTPS://User@Example.COM:443/a/b?q=1#frag", origin, path));
+    EXPECT_EQ(origin, "https://example.com");
+    EXPECT_EQ(path, "/a/b?q=1");
+    ASSERT_TRUE(RobotsCache::originOf("http://example.com:8080", origin, path));
+    EXPECT_EQ(origin, "http://example.com:8080");
+    EXPECT_EQ(path, "/");
+    ASSERT_TRUE(RobotsCache::originOf("http://[::1]/x", origin, path));
+    EXPECT_EQ(origin, "http://[::1]");
+    EXPECT_FALSE(RobotsCache::originOf("/relative/path", origin, path));
+    EXPECT_FALSE(RobotsCache::originOf("https:///path", origin, path));
+}
+
+TEST(RobotsCacheTest, FetchesOncePerOriginUntilTheTtlRunsOut) {
+    StubHost host;
+    host.serve("https://a.org/robots.txt", 200, "User-agent: *\nDisallow: /private\n");
+    RobotsCacheOptions options;
+    options.ttlMillis = 1000;
+    RobotsCache cache(options);
+    EXPECT_EQ(cache.check("https://a.org/x", 0), RobotsVerdict::Unknown);
+    cache.setFetcher(host.fetcher());
+
+    EXPECT_EQ(cache.check("https://a.org/x", 0), RobotsVerdict::Allowed);
+    EXPECT_EQ(cache.check("https://a.org/private/x", 10), RobotsVerdict::Disallowed);
+    EXPECT_EQ(cache.check("https://A.org:443/private", 999), RobotsVerdict::Disallowed);
+    EXPECT_EQ(host.requests.load(), 1);
+    EXPECT_EQ(cache.check("http://a.org/private", 999), RobotsVerdict::Allowed);
+    EXPECT_EQ(host.requests.load(), 2);
+
+    host.serve("https://a.org/robots.txt", 200, "User-agent: *\nDisallow: /\n");
+    EXPECT_EQ(cache.check("https://a.org/x", 1000), RobotsVerdict::Disallowed);
+    EXPECT_EQ(host.requests.load(), 3);
+
+    RobotsCacheStats stats = cache.stats();
+    EXPECT_EQ(stats.origins, 2u);
+    EXPECT_EQ(stats.fetches, 3u);
+    EXPECT_EQ(stats.hits, 2u);
+    EXPECT_EQ(stats.misses, 4u);
+    EXPECT_EQ(stats.allowed, 2u);
+    EXPECT_EQ(stats.disallowed, 3u);
+}
+
+TEST(RobotsCacheTest, FollowsRfcForFetchErrors) {
+    StubHost host;
+    host.serve("https://gone.org/robots.txt", 404, "");
+    host.serve("https://down.org/robots.txt", 503, "");
+    host.serve("https://flaky.org/robots.txt", 200, "User-agent: *\nDisallow: /admin\n");
+    RobotsCacheOptions options;
+    options.ttlMillis = 1000;
+    options.errorTtlMillis = 100;
+    RobotsCache cache(options);
+    cache.setFetcher(host.fetcher());
+
+    EXPECT_EQ(cache.check("https://gone.org/anything", 0), RobotsVerdict::Allowed);
+    EXPECT_EQ(cache.check("https://down.org/anything", 0), RobotsVerdict::Disallowed);
+    EXPECT_EQ(cache.check("https://missing.org/anything", 0), RobotsVerdict::Allowed);
+
+    // A 5xx after rules were fetched keeps them, for the error TTL
+    EXPECT_EQ(cache.check("https://flaky.org/page", 0), RobotsVerdict::Allowed);
+    host.serve("https://flaky.org/robots.txt", 500, "");
+    EXPECT_EQ(cache.check("https://flaky.org/page", 1000), RobotsVerdict::Allowed);
+    EXPECT_EQ(cache.check("https://flaky.org/admin", 1050), RobotsVerdict::Disallowed);
+    EXPECT_EQ(host.requests.load(), 5);
+    // The down host is asked again once its error TTL has passed
+    host.serve("https://down.org/robots.txt", 200, "");
+    EXPECT_EQ(cache.check("https://down.org/anything", 99), RobotsVerdict::Disallowed);
+    EXPECT_EQ(cache.check("https://down.org/anything", 100), RobotsVerdict::Allowed);
+    EXPECT_EQ(cache.stats().fetchErrors, 2u);
+}
+
+TEST(RobotsCacheTest, ConcurrentMissesShareOneFetch) {
+    StubHost host;
+    host.serve("https://slow.org/robots.txt", 200, "User-agent: *\nDisallow: /no\n");
+    RobotsCache cache;
+    cache.setFetcher(host.fetcher(50));
+    std::vector<std::thread> threads;
+    std::atomic<int> disallowed(0);
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([&cache, &disallowed] {
+            disallowed += cache.check("https://slow.org/no", 0) == RobotsVerdict::Disallowed;
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(disallowed.load(), 8);
+    EXPECT_EQ(host.requests.load(), 1);
+}
+
+TEST(RobotsCacheTest, EvictsTheOldestOrigins) {
+    RobotsCacheOptions options;
+    options.maxHosts = 3;
+    RobotsCache cache(options);
+    for (int i = 0; i < 5; ++i) {
+        cache.store("https://h" + std::to_string(i) + ".org", 200, "User-agent: *\nDisallow: /\n", 0);
+    }
+    // Stored again, h2 outlives h3
+    cache.store("https://h2.org", 200, "User-agent: *\nDisallow: /\n", 0);
+    cache.store("https://h5.org", 200, "", 0);
+    EXPECT_EQ(cache.stats().origins, 3u);
+    EXPECT_EQ(cache.stats().evicted, 3u);
+    EXPECT_EQ(cache.check("https://h3.org/", 0), RobotsVerdict::Unknown);
+    EXPECT_EQ(cache.check("https://h2.org/", 0), RobotsVerdict::Disallowed);
+    EXPECT_EQ(cache.check("https://h4.org/", 0), RobotsVerdict::Disallowed);
+    EXPECT_EQ(cache.check("https://h5.org/", 0), RobotsVerdict::Allowed);
+}
+
+TEST(RobotsCacheTest, CrawlDelaySetsTheFrontierInterval) {
+    CrawlFrontierOptions frontierOptions;
+    frontierOptions.domainIntervalMillis = 100;
+    CrawlFrontier frontier(frontierOptions);
+    RobotsCacheOptions options;
+    options.maxCrawlDelayMillis = 30000;
+    RobotsCache cache(options);
+    cache.attachFrontier(&frontier);
+    cache.store("https://slow.org", 200, "User-agent: *\nCrawl-delay: 5\n", 0);
+    cache.store("https://greedy.org", 200, "User-agent: *\nCrawl-delay: 86400\n", 0);
+
+    std::vector<FrontierLease> leases;
+    for (const char* url : {"https://slow.org/1", "https://slow.org/2", "https://fast.org/1", "https://fast.org/2",
+                            "https://greedy.org/1", "https://greedy.org/2"}) {
+        ASSERT_TRUE(frontier.push(url, CrawlPriority::Batch, 0));
+    }
+    auto leaseAt = [&](uint64_t now) {
+        leases.clear();
+        frontier.lease(10, now, leases);
+        for (const FrontierLease& lease : leases) {
+            frontier.finish(lease.host, now);
+        }
+        return leases.size();
+    };
+    EXPECT_EQ(leaseAt(0), 3u);
+    EXPECT_EQ(leaseAt(100), 1u);
+    EXPECT_EQ(leases[0].host, "fast.org");
+    EXPECT_EQ(leaseAt(4999), 0u);
+    EXPECT_EQ(leaseAt(5000), 1u);
+    EXPECT_EQ(leases[0].host, "slow.org");
+    EXPECT_EQ(leaseAt(29999), 0u);
+    EXPECT_EQ(leaseAt(30000), 1u);
+    EXPECT_EQ(leases[0].host, "greedy.org");
+
+    // Rules without a Crawl-delay give the host back the default interval
+    cache.store("https://slow.org", 200, "", 30000);
+    ASSERT_TRUE(frontier.push("https://slow.org/3", CrawlPriority::Batch, 30000));
+    ASSERT_TRUE(frontier.push("https://slow.org/4", CrawlPriority::Batch, 30000));
+    EXPECT_EQ(leaseAt(30000), 1u);
+    EXPECT_EQ(leaseAt(30100), 1u);
+}
+
+TEST(RobotsServiceTest, ChecksStoresAndFiltersFrontierPushes) {
+    ConfigManager config;
+    RobotsService robots;
+    ASSERT_TRUE(robots.initialize(config));
+    CrawlFrontierService frontier;
+    ASSERT_TRUE(frontier.initialize(config));
+    robots.attachFrontier(frontier);
+    Microservice microservice;
+    HttpServer server(microservice);
+    robots.registerRoutes(server);
+    frontier.registerRoutes(server);
+
+    EXPECT_EQ(server.dispatch("POST", "/robots/check", "{}"), "{\"error\": \"url or urls.<i> required\"}");
+    EXPECT_EQ(server.dispatch("POST", "/robots/check",
+                              R"({"urls": ["https://a.org/x", "https://a.org/y", "https://b.org/", "nohost"]})"),
+              "{\"allowed\": [], \"disallowed\": [], \"unknown\": [\"https://a.org/x\", \"https://a.org/y\", "
+              "\"https://b.org/\", \"nohost\"], \"fetch\": [\"https://a.org/robots.txt\", "
+              "\"https://b.org/robots.txt\"]}");
+    EXPECT_EQ(server.dispatch("POST", "/robots/store",
+                              R"({"url": "https://a.org/robots.txt", "status": 200, "body":
+                                  "User-agent: *\nDisallow: /x\nCrawl-delay: 3\nSitemap: https://a.org/s.xml"})"),
+              "{\"origin\": \"https://a.org\", \"rules\": 1, \"crawl_delay_ms\": 3000, "
+              "\"sitemaps\": [\"https://a.org/s.xml\"]}");
+    EXPECT_EQ(server.dispatch("POST", "/robots/store", R"({"url": "https://b.org/robots.txt", "status": 404})"),
+              "{\"origin\": \"https://b.org\", \"rules\": 0, \"crawl_delay_ms\": 0, \"sitemaps\": []}");
+    EXPECT_EQ(server.dispatch("POST", "/robots/store", R"({"url": "https://b.org/", "status": "ok"})"),
+              "{\"error\": \"status must be an HTTP status, or 0 for an unreachable host\"}");
+    EXPECT_EQ(server.dispatch("POST", "/robots/check", R"({"urls": ["https://a.org/x", "https://a.org/y"]})"),
+              "{\"allowed\": [\"https://a.org/y\"], \"disallowed\": [\"https://a.org/x\"], \"unknown\": [], "
+              "\"fetch\": []}");
+
+    EXPECT_EQ(server.dispatch("POST", "/frontier/push",
+                              R"({"urls": ["https://a.org/x", "https://a.org/y", "https://c.org/z"]})"),
+              "{\"queued\": 2, \"rejected\": [], \"disallowed\": [\"https://a.org/x\"]}");
+    const std::string stats = server.dispatch("GET", "/robots/stats", "");
+    EXPECT_NE(stats.find("{\"origins\": 2, \"hits\": 4, \"misses\": 4, \"fetches\": 0, \"fetch_errors\": 0"),
+              std::string::npos);
+}
@@ -0,0 +1,140 @@
+#include <gtest/gtest.h>
+#include "../include/content_service.h"
+#include "../include/microservice.h"
+#include "../include/score_fusion.h"
+#include <string>
+#include <vector>
+
+class ScoreFusionTest : public ::testing::Test {
+protected:
+    static Hash128 key(const std::string& url) { return murmurHash3(url.data(), url.size()); }
+
+    static std::vector<Hash128> keys(const std::vector<std::string>& urls) {
+        std::vector<Hash128> out;
+        for (const std::string& url : urls) {
+            out.push_back(key(url));
+        }
+        return out;
+    }
+};
+
+TEST_F(ScoreFusionTest, ReciprocalRank) {
+    ScoreFusion fusion;
+    const std::vector<Hash128> a = keys({"x", "y", "z"});
+    const std::vector<Hash128> b = keys({"y", "w", "x", "y"});
+    EXPECT_EQ(fusion.addList(a.data(), nullptr, a.size()), 0u);
+    EXPECT_EQ(fusion.addList(b.data(), nullptr, b.size(), 2.0), 1u);
+    EXPECT_EQ(fusion.size(), 4u);
+
+    const std::vector<FusedResult>& ranked = fusion.rank();
+    ASSERT_EQ(ranked.size(), 4u);
+    // y: 1/62 + 2/61; x: 1/61 + 2/63; w: 2/62; z: 1/63
+    EXPECT_EQ(ranked[0].key, key("y"));
+    EXPECT_NEAR(ranked[0].score, 1.0 / 62 + 2.0 / 61, 1e-12);
+    EXPECT_EQ(ranked[0].lists, 2u);
+    EXPECT_EQ(ranked[0].list, 1u);
+    EXPECT_EQ(ranked[0].index, 0u);
+    EXPECT_EQ(ranked[1].key, key("x"));
+    EXPECT_EQ(ranked[1].list, 1u);
+    EXPECT_EQ(ranked[1].index, 2u);
+    EXPECT_EQ(ranked[2].key, key("w"));
+    EXPECT_EQ(ranked[3].key, key("z"));
+    EXPECT_EQ(ranked[3].lists, 1u);
+
+    ASSERT_EQ(fusion.rank(2).size(), 2u);
+    EXPECT_EQ(fusion.rank(2)[1].key, key("x"));
+}
+
+TEST_F(ScoreFusionTest, CombSumAndCombMnz) {
+    const std::vector<Hash128> a = keys({"x", "y", "z"});
+    const std::vector<double> aScores = {10.0, 6.0, 2.0};
+    const std::vector<Hash128> b = keys({"z", "w"});
+    const std::vector<double> bScores = {0.9, 0.1};
+
+    ScoreFusionOptions options;
+    options.method = FusionMethod::CombSum;
+    ScoreFusion sum(options);
+    sum.addList(a.data(), aScores.data(), a.size());
+    sum.addList(b.data(), bScores.data(), b.size());
+    // Normalized: x 1, y 0.5, z 0 + 1, w 0; ties keep the order of first appearance
+    const std::vector<FusedResult>& summed = sum.rank();
+    ASSERT_EQ(summed.size(), 4u);
+    EXPECT_EQ(summed[0].key, key("x"));
+    EXPECT_EQ(summed[1].key, key("z"));
+    EXPECT_DOUBLE_EQ(summed[1].score, 1.0);
+    EXPECT_EQ(summed[1].list, 1u);
+    EXPECT_EQ(summed[2].key, key("y"));
+    EXPECT_EQ(summed[3].key, key("w"));
+
+    options.method = FusionMethod::CombMnz;
+    options.normalizeScores = false;
+    ScoreFusion mnz(options);
+    mnz.addList(a.data(), aScores.data(), a.size(), 0.1);
+    mnz.addList(b.data(), bScores.data(), b.size());
+    // Raw: x 1.0, y 0.6, z (0.2 + 0.9) * 2 = 2.2, w 0.1
+    const std::vector<FusedResult>& ranked = mnz.rank();
+    EXPECT_EQ(ranked[0].key, key("z"));
+    EXPECT_NEAR(ranked[0].score, 2.2, 1e-12);
+    EXPECT_EQ(ranked[1].key, key("x"));
+    EXPECT_EQ(ranked[3].key, key("w"));
+}
+
+TEST_F(ScoreFusionTest, UnscoredListsUsePosition) {
+    ScoreFusionOptions options;
+    options.method = FusionMethod::CombSum;
+    ScoreFusion fusion(options);
+    const std::vector<Hash128> a = keys({"x", "y"});
+    const std::vector<Hash128> b = keys({"y", "x"});
+    fusion.addList(a.data(), nullptr, a.size(), 1.0);
+    fusion.addList(b.data(), nullptr, b.size(), 1.5);
+    const std::vector<FusedResult>& ranked = fusion.rank();
+    EXPECT_EQ(ranked[0].key, key("y"));
+    EXPECT_DOUBLE_EQ(ranked[0].score, 0.5 + 1.5);
+    EXPECT_DOUBLE_EQ(ranked[1].score, 1.0 + 0.75);
+}
+
+TEST_F(ScoreFusionTest, ResetAndGrowth) {
+    ScoreFusion fusion;
+    for (int round = 0; round < 3; ++round) {
+        fusion.reset();
+        std::vector<std::string> urls;
+        for (int i = 0; i < 1000; ++i) {
+            urls.push_back("https://example.com/" + std::to_string(round) + "/" + std::to_string(i % 700));
+        }
+        const std::vector<Hash128> list = keys(urls);
+        fusion.addList(list.data(), nullptr, list.size());
+        fusion.addList(list.data() + 300, nullptr, 400);
+        EXPECT_EQ(fusion.size(), 700u);
+        const std::vector<FusedResult>& ranked = fusion.rank();
+        ASSERT_EQ(ranked.size(), 700u);
+        EXPECT_EQ(ranked[0].key, key(urls[300]));
+        EXPECT_EQ(ranked[0].lists, 2u);
+    }
+}
+
+TEST_F(ScoreFusionTest, FuseResultsRouteRejectsMalformedScores) {
+    Microservice microservice;
+    HttpServer server(microservice);
+    ContentService service;
+    service.registerRoutes(server);
+
+    const std::string scored = server.dispatch(
+        "POST", "/fuse_results",
+        R"({"method": "combsum", "lists": [{"urls": ["https://a.com/", "https://b.com/"], "scores": [0.1, 0.9]}]})");
+    EXPECT_LT(scored.find("https://b.com/"), scored.find("https://a.com/")) << scored;
+
+    // A null or a string among the scores must not quietly turn the list into a rank-only one
+    EXPECT_EQ(server.dispatch("POST", "/fuse_results",
+                              R"({"lists": [{"urls": ["https://a.com/", "https://b.com/", "https://c.com/"],
+                                             "scores": [0.9, null, 0.5]}]})"),
+              "{\"error\": \"array lists.0.scores mixes numbers with other values\"}");
+    EXPECT_EQ(server.dispatch("POST", "/fuse_results",
+                              R"({"lists": [{"urls": ["https://a.com/", "https://b.com/"], "scores": [0.9, "0.5"]}]})"),
+              "{\"error\": \"array lists.0.scores mixes numbers with other values\"}");
+    EXPECT_EQ(server.dispatch("POST", "/fuse_results",
+                              R"({"lists": [{"urls": ["https://a.com/", "https://b.com/"],
+                                             "scores": ["0.9", "0.5"]}]})"),
+              "{\"error\": \"unknown field lists.0.scores.0\"}");
+    EXPECT_EQ(server.dispatch("POST", "/fuse_results", R"({"lists": [{"urls": ["https://a.com/"], "weigth": 2}]})"),
+              "{\"error\": \"unknown field lists.0.weigth\"}");
+}
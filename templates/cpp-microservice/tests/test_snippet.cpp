@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+#include "../include/snippet.h"
+#include <string>
+
+namespace {
+
+std::string snippet(const std::string& text, const std::vector<std::string>& terms, size_t tokens = 40) {
+    std::string offsets;
+    encodeTermOffsets(text, offsets);
+    SnippetOptions options;
+    options.tokens = tokens;
+    SnippetBuilder builder(terms, options);
+    std::string out;
+    builder.build(text, offsets, out);
+    return out;
+}
+
+std::string words(size_t first, size_t last) {
+    std::string out;
+    for (size_t i = first; i < last; ++i) {
+        out += (i > first ? " w" : "w") + std::to_string(i);
+    }
+    return out;
+}
+
+} // namespace
+
+TEST(SnippetTest, PicksTheWindowWithMostDistinctTerms) {
+    // "alpha" alone early, "alpha" and "beta" together late
+    const std::string text = words(0, 10) + " alpha " + words(10, 60) + " alpha beta " + words(60, 100);
+    EXPECT_EQ(snippet(text, {"alpha", "beta"}, 6), "...w58 w59 <b>alpha</b> <b>beta</b> w60 w61...");
+    EXPECT_EQ(snippet(text, {"alpha"}, 4), "...w9 <b>alpha</b> w10 w11...");
+}
+
+TEST(SnippetTest, KeepsTheTextAtEitherEnd) {
+    EXPECT_EQ(snippet("# Alpha: first words.", {"alpha"}), "# <b>Alpha</b>: first words.");
+    EXPECT_EQ(snippet(words(0, 10) + " end.", {"end"}, 4), "...w7 w8 w9 <b>end</b>.");
+
+    // No query term in the text: the leading window, as the old snippet
+    EXPECT_EQ(snippet(words(0, 50), {"absent"}), words(0, 40) + "...");
+}
+
+TEST(SnippetTest, HighlightsTheOriginalBytesOfFoldedTerms) {
+    EXPECT_EQ(snippet("Le Café de l'ÉCOLE, 東京", {"cafe", "ecole", "京"}),
+              "Le <b>Café</b> de l'<b>ÉCOLE</b>, 東<b>京</b>");
+}
+
+TEST(SnippetTest, CustomMarkers) {
+    SnippetOptions options;
+    options.tokens = 2;
+    options.open = "[";
+    options.close = "]";
+    options.ellipsis = " ~ ";
+    const std::string text = "one two three four";
+    std::string offsets;
+    encodeTermOffsets(text, offsets);
+    SnippetBuilder builder({"three"}, options);
+    std::string out;
+    builder.build(text, offsets, out);
+    EXPECT_EQ(out, " ~ [three] four");
+}
+
+TEST(SnippetTest, MissingOrForeignOffsetsGiveNoSnippet) {
+    SnippetBuilder builder({"alpha"}, SnippetOptions());
+    std::string out = "stale";
+    builder.build("alpha beta", "", out);
+    EXPECT_EQ(out, "");
+
+    // Offsets of a longer text stop at the end of this one
+    std::string offsets;
+    encodeTermOffsets("alpha beta gamma delta", offsets);
+    builder.build("alpha beta", offsets, out);
+    EXPECT_EQ(out, "<b>alpha</b> beta");
+    builder.build("alpha beta", offsets.substr(0, offsets.size() - 1), out);
+    EXPECT_EQ(out, "<b>alpha</b> beta");
+}
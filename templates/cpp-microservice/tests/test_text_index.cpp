@@ -0,0 +1,473 @@
+#include <gtest/gtest.h>
+#include "../include/config_manager.h"
+#include "../include/microservice.h"
+#include "../include/search_service.h"
+#include "../include/text_index.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <set>
+#include <unistd.h>
+
+namespace {
+
+// Postings of a random list over [0, universe)
+void randomPostings(std::mt19937& rng, size_t n, uint32_t universe, std::vector<uint32_t>& docs,
+                    std::vector<uint32_t>& freqs) {
+    std::set<uint32_t> rows;
+    std::uniform_int_distribution<uint32_t> row(0, universe - 1);
+    while (rows.size() < n) {
+        rows.insert(row(rng));
+    }
+    docs.assign(rows.begin(), rows.end());
+    freqs.clear();
+    std::geometric_distribution<uint32_t> freq(0.4);
+    for (size_t i = 0; i < n; ++i) {
+        freqs.push_back(1 + freq(rng));
+    }
+}
+
+// Sentences over a Zipf-like vocabulary of w0..w<vocabulary-1>
+std::string randomText(std::mt19937& rng, size_t words, size_t vocabulary) {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::string text;
+    for (size_t i = 0; i < words; ++i) {
+        size_t rank = static_cast<size_t>(std::pow(static_cast<double>(vocabulary), uniform(rng))) - 1;
+        text += (i ? " w" : "w") + std::to_string(rank);
+    }
+    return text;
+}
+
+} // namespace
+
+TEST(PostingsTest, RoundTripAcrossBlockBoundaries) {
+    std::mt19937 rng(7);
+    for (size_t n : {1u, 5u, 127u, 128u, 129u, 256u, 1000u}) {
+        std::vector<uint32_t> docs, freqs;
+        randomPostings(rng, n, 5000, docs, freqs);
+        std::vector<uint32_t> lengths(5000);
+        for (uint32_t& length : lengths) {
+            length = 1 + rng() % 300;
+        }
+
+        std::string encoded = "x";    // Misaligned on purpose
+        PostingSummary summary;
+        encodePostings(docs.data(), freqs.data(), n, lengths.data(), encoded, summary);
+        EXPECT_EQ(summary.docFreq, n);
+        EXPECT_EQ(summary.maxFreq, *std::max_element(freqs.begin(), freqs.end()));
+
+        PostingCursor cursor;
+        cursor.reset(reinterpret_cast<const uint8_t*>(encoded.data()) + 4, static_cast<uint32_t>(n));
+        for (size_t i = 0; i < n; ++i) {
+            ASSERT_EQ(cursor.doc(), docs[i]) << "n=" << n << " i=" << i;
+            ASSERT_EQ(cursor.freq(), freqs[i]);
+            cursor.next();
+        }
+        EXPECT_EQ(cursor.doc(), PostingCursor::kEnd);
+
+        // advance lands on the first posting at or after the target
+        cursor.reset(reinterpret_cast<const uint8_t*>(encoded.data()) + 4, static_cast<uint32_t>(n));
+        for (uint32_t target = 0; target < 5000; target += 37) {
+            cursor.advance(target);
+            auto it = std::lower_bound(docs.begin(), docs.end(), target);
+            ASSERT_EQ(cursor.doc(), it == docs.end() ? PostingCursor::kEnd : *it);
+        }
+    }
+}
+
+TEST(PostingsTest, BlockBoundsCoverTheirPostings) {
+    std::mt19937 rng(11);
+    std::vector<uint32_t> docs, freqs;
+    randomPostings(rng, 700, 10000, docs, freqs);
+    std::vector<uint32_t> lengths(10000, 50);
+    lengths[docs[3]] = 2;
+
+    std::string encoded;
+    PostingSummary summary;
+    encodePostings(docs.data(), freqs.data(), docs.size(), lengths.data(), encoded, summary);
+    EXPECT_EQ(summary.minLength, 2u);
+
+    PostingCursor cursor;
+    cursor.reset(reinterpret_cast<const uint8_t*>(encoded.data()), static_cast<uint32_t>(docs.size()));
+    for (size_t i = 0; i < docs.size(); ++i) {
+        const PostingBlock* block = cursor.shallowAdvance(docs[i]);
+        ASSERT_NE(block, nullptr);
+        EXPECT_GE(block->lastDoc, docs[i]);
+        EXPECT_GE(block->maxFreq, freqs[i]);
+        EXPECT_LE(block->minLength, lengths[docs[i]]);
+    }
+    EXPECT_EQ(cursor.shallowAdvance(docs.back() + 1), nullptr);
+}
+
+TEST(TermSplitterTest, DropsPunctuationAndFoldsCase) {
+    TermSplitter splitter("Graph-based ANN, re-ranking: 42 «Café» — 東京");
+    std::vector<std::string> terms;
+    std::string_view term;
+    while (splitter.next(term)) {
+        terms.emplace_back(term);
+    }
+    std::vector<std::string> expected = {"graph", "based", "ann", "re", "ranking", "42", "cafe", "東", "京"};
+    EXPECT_EQ(terms, expected);
+}
+
+// Test fixture for TextIndex
+class TextIndexTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir_ = std::filesystem::temp_directory_path() / ("text_index_test_" + std::to_string(getpid()));
+        std::filesystem::remove_all(dir_);
+        options_.directory = dir_.string();
+        options_.syncWrites = false;
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir_);
+    }
+
+    static TextDocument document(uint64_t id, const std::string& title, const std::string& markdown,
+                                 const std::string& domain = "example.com") {
+        return TextDocument{id, {{"title", title}, {"markdown", markdown}, {"source_domain", domain}}};
+    }
+
+    static std::vector<uint64_t> ids(const std::vector<TextHit>& hits) {
+        std::vector<uint64_t> out;
+        for (const TextHit& hit : hits) {
+            out.push_back(hit.id);
+        }
+        return out;
+    }
+
+    std::filesystem::path dir_;
+    TextIndexOptions options_;
+};
+
+TEST_F(TextIndexTest, RanksByBm25AndRequiresEveryTerm) {
+    TextIndex index;
+    ASSERT_TRUE(index.open(options_));
+    ASSERT_TRUE(index.add(document(1, "Vector search", "approximate nearest neighbor search with graphs")));
+    ASSERT_TRUE(index.add(document(2, "Cooking", "a recipe for bread with flour and water and search")));
+    ASSERT_TRUE(index.add(document(3, "Graph search", "graph search nearest graph search nearest neighbor")));
+
+    // Same ranking whether the documents are in the delta or a segment
+    for (int pass = 0; pass < 2; ++pass) {
+        TextQuery query;
+        query.text = "nearest SEARCH";
+        EXPECT_EQ(ids(index.search(query)), (std::vector<uint64_t>{3, 1}));
+
+        query.matchAll = false;
+        std::vector<TextHit> hits = index.search(query);
+        ASSERT_EQ(ids(hits), (std::vector<uint64_t>{3, 1, 2}));
+        EXPECT_GT(hits[0].score, hits[1].score);
+        EXPECT_EQ(hits[0].fields.at("title"), "Graph search");
+        EXPECT_EQ(hits[0].fields.at("word_count"), "7");
+        ASSERT_TRUE(index.flush());
+    }
+    EXPECT_EQ(index.stats().segments, 1u);
+}
+
+TEST_F(TextIndexTest, BlockMaxMatchesExhaustiveScoring) {
+    options_.filterScanThreshold = 0;
+    TextIndex index;
+    ASSERT_TRUE(index.open(options_));
+    std::mt19937 rng(3);
+    const char* domains[] = {"a.org", "b.org", "c.org"};
+    for (int batch = 0; batch < 4; ++batch) {
+        std::vector<TextDocument> documents;
+        for (int i = 0; i < 1500; ++i) {
+            uint64_t id = static_cast<uint64_t>(batch * 1500 + i);
+            documents.push_back(document(id, randomText(rng, 4, 2000), randomText(rng, 20 + rng() % 200, 2000),
+                                         domains[id % 3]));
+        }
+        ASSERT_TRUE(index.addBatch(documents));
+        ASSERT_TRUE(index.flush());
+    }
+    // Replacements and deletes leave masked rows in every segment
+    for (uint64_t id = 0; id < 6000; id += 7) {
+        ASSERT_TRUE(id % 2 ? index.remove(id) : index.add(document(id, "fresh", randomText(rng, 50, 2000))));
+    }
+
+    for (int q = 0; q < 60; ++q) {
+        TextQuery query;
+        query.text = randomText(rng, 1 + q % 4, q % 2 ? 40 : 400);
+        query.limit = 1 + q % 15;
+        query.matchAll = q % 3 != 0;
+        query.domain = q % 5 == 0 ? domains[q % 3] : "";
+
+        query.blockMax = false;
+        std::vector<TextHit> exact = index.search(query);
+        query.blockMax = true;
+        std::vector<TextHit> pruned = index.search(query);
+        ASSERT_EQ(pruned.size(), exact.size()) << query.text;
+        for (size_t i = 0; i < exact.size(); ++i) {
+            EXPECT_FLOAT_EQ(pruned[i].score, exact[i].score) << query.text << " rank " << i;
+        }
+    }
+}
+
+TEST_F(TextIndexTest, DomainFilter) {
+    TextIndex index;
+    ASSERT_TRUE(index.open(options_));
+    ASSERT_TRUE(index.add(document(1, "rust", "memory safety", "a.org")));
+    ASSERT_TRUE(index.add(document(2, "rust", "memory safety", "b.org")));
+    ASSERT_TRUE(index.flush());
+    ASSERT_TRUE(index.add(document(3, "rust", "memory safety", "b.org")));
+
+    TextQuery query;
+    query.text = "rust memory";
+    query.domain = "b.org";
+    std::vector<uint64_t> found = ids(index.search(query));
+    std::sort(found.begin(), found.end());
+    EXPECT_EQ(found, (std::vector<uint64_t>{2, 3}));
+    query.domain = "c.org";
+    EXPECT_TRUE(index.search(query).empty());
+}
+
+TEST_F(TextIndexTest, ReplaceAndDeleteAcrossSegments) {
+    TextIndex index;
+    ASSERT_TRUE(index.open(options_));
+    ASSERT_TRUE(index.add(document(1, "alpha", "old text about kernels")));
+    ASSERT_TRUE(index.add(document(2, "beta", "kernels everywhere")));
+    ASSERT_TRUE(index.flush());
+    ASSERT_TRUE(index.add(document(1, "alpha", "new text about compilers")));
+    ASSERT_TRUE(index.remove(2));
+
+    TextQuery query;
+    query.text = "kernels";
+    EXPECT_TRUE(index.search(query).empty());
+    query.text = "compilers";
+    EXPECT_EQ(ids(index.search(query)), (std::vector<uint64_t>{1}));
+    EXPECT_EQ(index.count(), 1u);
+
+    ASSERT_TRUE(index.flush());
+    query.text = "kernels";
+    EXPECT_TRUE(index.search(query).empty());
+    EXPECT_EQ(index.count(), 1u);
+    EXPECT_EQ(index.stats().deletedDocs, 2u);
+}
+
+TEST_F(TextIndexTest, ReopenReplaysLogAndTombstones) {
+    {
+        TextIndex index;
+        ASSERT_TRUE(index.open(options_));
+        ASSERT_TRUE(index.add(document(1, "one", "persistent segment document")));
+        ASSERT_TRUE(index.add(document(2, "two", "persistent segment document")));
+        ASSERT_TRUE(index.flush());
+        ASSERT_TRUE(index.remove(1));
+        ASSERT_TRUE(index.flush());
+        ASSERT_TRUE(index.add(document(3, "three", "persistent log document")));
+    }
+    TextIndex index;
+    ASSERT_TRUE(index.open(options_));
+    EXPECT_EQ(index.count(), 2u);
+    TextQuery query;
+    query.text = "persistent document";
+    std::vector<uint64_t> found = ids(index.search(query));
+    std::sort(found.begin(), found.end());
+    EXPECT_EQ(found, (std::vector<uint64_t>{2, 3}));
+}
+
+TEST_F(TextIndexTest, TruncatesTornLogTail) {
+    {
+        TextIndex index;
+        ASSERT_TRUE(index.open(options_));
+        ASSERT_TRUE(index.add(document(1, "one", "survives the crash")));
+    }
+    std::filesystem::path log;
+    for (const auto& entry : std::filesystem::directory_iterator(dir_)) {
+        if (entry.path().extension() == ".log") {
+            log = entry.path();
+        }
+    }
+    ASSERT_FALSE(log.empty());
+    {
+        std::ofstream out(log, std::ios::binary | std::ios::app);
+        out << "\x40\x00\x00\x00garbage";
+    }
+    TextIndex index;
+    ASSERT_TRUE(index.open(options_));
+    EXPECT_EQ(index.count(), 1u);
+    ASSERT_TRUE(index.add(document(2, "two", "written after the crash")));
+    index.close();
+    ASSERT_TRUE(index.open(options_));
+    EXPECT_EQ(index.count(), 2u);
+}
+
+TEST_F(TextIndexTest, MergeKeepsResults) {
+    options_.mergeFactor = 3;
+    TextIndex index;
+    ASSERT_TRUE(index.open(options_));
+    std::mt19937 rng(5);
+    for (uint64_t id = 0; id < 600; ++id) {
+        ASSERT_TRUE(index.add(document(id, "t", randomText(rng, 30, 300))));
+        if (id % 100 == 99) {
+            ASSERT_TRUE(index.flush());
+        }
+    }
+    for (uint64_t id = 0; id < 600; id += 9) {
+        ASSERT_TRUE(index.remove(id));
+    }
+    ASSERT_TRUE(index.flush());
+
+    TextQuery query;
+    query.text = "w1 w2";
+    query.limit = 600;
+    std::vector<TextHit> before = index.search(query);
+    ASSERT_GT(before.size(), 10u);
+    ASSERT_LT(before.size(), query.limit);
+    const size_t count = index.count();
+
+    ASSERT_TRUE(index.merge());
+    EXPECT_EQ(index.stats().segments, 5u);
+    ASSERT_TRUE(index.merge(true));
+    EXPECT_EQ(index.stats().segments, 1u);
+    EXPECT_EQ(index.stats().deletedDocs, 0u);
+    EXPECT_EQ(index.count(), count);
+
+    // Merging drops deleted rows from the collection statistics, so compare the matching ids only
+    std::vector<TextHit> after = index.search(query);
+    ASSERT_EQ(after.size(), before.size());
+    std::vector<uint64_t> a = ids(before), b = ids(after);
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    EXPECT_EQ(a, b);
+
+    index.close();
+    ASSERT_TRUE(index.open(options_));
+    EXPECT_EQ(index.count(), count);
+    EXPECT_EQ(ids(index.search(query)), ids(after));
+}
+
+TEST_F(TextIndexTest, SnippetsFromDeltaSegmentsAndMerges) {
+    TextIndex index;
+    ASSERT_TRUE(index.open(options_));
+    std::string markdown;
+    for (int i = 0; i < 100; ++i) {
+        markdown += (i == 70 ? "Kernel bypass " : "") + ("w" + std::to_string(i)) + " ";
+    }
+    ASSERT_TRUE(index.add(document(1, "networking", markdown)));
+
+    TextQuery query;
+    query.text = "kernel bypass";
+    query.snippetTokens = 6;
+    const std::string expected = "...w68 w69 <b>Kernel</b> <b>bypass</b> w70 w71...";
+    std::vector<TextHit> hits = index.search(query);
+    ASSERT_EQ(hits.size(), 1u);
+    EXPECT_EQ(hits[0].snippet, expected);
+
+    ASSERT_TRUE(index.flush());
+    ASSERT_TRUE(index.add(document(2, "other", "unrelated")));
+    ASSERT_TRUE(index.flush());
+    EXPECT_EQ(index.search(query)[0].snippet, expected);
+    ASSERT_TRUE(index.merge(true));
+    EXPECT_EQ(index.search(query)[0].snippet, expected);
+
+    query.snippetTokens = 0;
+    EXPECT_EQ(index.search(query)[0].snippet, "");
+}
+
+TEST_F(TextIndexTest, CompressedStoredFieldsAcrossVersions) {
+    // Version 1 segments (plain records) stay readable and merge into compressed ones
+    options_.compressStored = false;
+    std::map<uint64_t, std::string> markdown;
+    std::mt19937 rng(8);
+    {
+        TextIndex index;
+        ASSERT_TRUE(index.open(options_));
+        for (uint64_t id = 0; id < 200; ++id) {
+            markdown[id] = "[Home](/) | [Docs](/docs)\n\n" + randomText(rng, 30, 200) + "\n\nCopyright Example Corp";
+            ASSERT_TRUE(index.add(document(id, "Title " + std::to_string(id), markdown[id])));
+        }
+        ASSERT_TRUE(index.flush());
+        EXPECT_EQ(index.stats().storedBytes, index.stats().storedRawBytes);
+    }
+
+    options_.compressStored = true;
+    TextIndex index;
+    ASSERT_TRUE(index.open(options_));
+    for (uint64_t id = 200; id < 400; ++id) {
+        markdown[id] = "[Home](/) | [Docs](/docs)\n\n" + randomText(rng, 30, 200) + "\n\nCopyright Example Corp";
+        ASSERT_TRUE(index.add(document(id, "Title " + std::to_string(id), markdown[id])));
+    }
+    ASSERT_TRUE(index.flush());
+    const TextIndexStats mixed = index.stats();
+    ASSERT_EQ(mixed.segments, 2u);
+    EXPECT_LT(mixed.storedBytes, mixed.storedRawBytes);
+
+    TextQuery query;
+    query.text = "copyright";
+    query.limit = 400;
+    query.snippetTokens = 4;
+    for (int pass = 0; pass < 2; ++pass) {
+        std::vector<TextHit> hits = index.search(query);
+        ASSERT_EQ(hits.size(), 400u);
+        for (const TextHit& hit : hits) {
+            EXPECT_EQ(hit.fields.at("markdown"), markdown[hit.id]);
+            EXPECT_EQ(hit.fields.at("title"), "Title " + std::to_string(hit.id));
+            EXPECT_NE(hit.snippet.find("<b>Copyright</b>"), std::string::npos);
+        }
+        ASSERT_TRUE(index.merge(true));
+    }
+    const TextIndexStats merged = index.stats();
+    EXPECT_EQ(merged.segments, 1u);
+    EXPECT_EQ(merged.storedRawBytes, mixed.storedRawBytes);
+    EXPECT_LT(merged.storedBytes * 3, merged.storedRawBytes * 2);
+
+    TextQuery filtered;
+    filtered.text = "copyright";
+    filtered.domain = "example.com";
+    EXPECT_EQ(index.search(filtered).size(), filtered.limit);
+}
+
+TEST_F(TextIndexTest, ServiceMatchesWarehouseContract) {
+    std::filesystem::create_directories(dir_);
+    {
+        std::ofstream env(dir_ / "search.env");
+        env << "SEARCH_INDEX_DIR=" << (dir_ / "index").string() << "\nSEARCH_SYNC_WRITES=false\n";
+    }
+    ConfigManager config;
+    ASSERT_TRUE(config.load((dir_ / "search.env").string()));
+    SearchService service;
+    ASSERT_TRUE(service.initialize(config));
+    Microservice microservice;
+    HttpServer server(microservice);
+    service.registerRoutes(server);
+
+    std::string markdown;
+    for (int i = 0; i < 50; ++i) {
+        markdown += "word" + std::to_string(i) + " ";
+    }
+    std::string ingested = server.dispatch(
+        "POST", "/ingest",
+        R"({"documents": [{"id": 7, "url": "https://a.org/x", "title": "Quantum error correction",
+            "markdown": ")" + markdown + R"(", "content": "raw page", "source_domain": "a.org",
+            "ingested_at": "0"},
+           {"id": 8, "title": "Classical codes", "markdown": "quantum free", "source_domain": "b.org",
+            "ingested_at": "2026-01-02T03:04:05+00:00"}]})");
+    EXPECT_EQ(ingested, "{\"indexed\": 2, \"total_docs\": 2}");
+
+    std::string results = server.dispatch("GET", "/search", R"({"q": "quantum correction"})");
+    EXPECT_EQ(results.find("\"id\": 7, \"url\": \"https://a.org/x\", \"title\": \"Quantum error correction\", "
+                           "\"snippet\": \"word0 word1"),
+              2u)
+        << results;
+    EXPECT_NE(results.find("word39...\", \"source_domain\": \"a.org\", \"word_count\": 50, "
+                           "\"ingested_at\": \"1970-01-01T00:00:00+00:00\""),
+              std::string::npos)
+        << results;
+    EXPECT_EQ(results.find("raw page"), std::string::npos);
+
+    results = server.dispatch("GET", "/search", R"({"q": "quantum", "domain": "b.org"})");
+    EXPECT_NE(results.find("\"ingested_at\": \"2026-01-02T03:04:05+00:00\""), std::string::npos) << results;
+    EXPECT_NE(results.find("\"snippet\": \"<b>quantum</b> free\""), std::string::npos) << results;
+    EXPECT_EQ(server.dispatch("GET", "/search", R"({"q": "q"})"),
+              "{\"error\": \"q must be at least 2 characters\"}");
+    EXPECT_EQ(server.dispatch("GET", "/search", R"({"q": "quantum", "limit": 101})"),
+              "{\"error\": \"limit must be 1-100\"}");
+
+    EXPECT_EQ(server.dispatch("POST", "/search/delete", R"({"ids": [7, 8]})"), "{\"deleted\": 2}");
+    EXPECT_EQ(server.dispatch("GET", "/search", R"({"q": "quantum"})"), "[]");
+    EXPECT_NE(server.dispatch("POST", "/search/merge", "").find("\"documents\": 0"), std::string::npos);
+    service.shutdown();
+}
@@ -0,0 +1,236 @@
+#include <gtest/gtest.h>
+#include "../include/vector_ingestor.h"
+#include <filesystem>
+#include <random>
+#include <thread>
+#include <unistd.h>
+
+// Test fixture for VectorIngestor
+class VectorIngestorTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir_ = std::filesystem::temp_directory_path() / ("vector_ingestor_test_" + std::to_string(getpid()));
+        std::filesystem::remove_all(dir_);
+        options_.directory = dir_.string();
+        options_.dim = 16;
+        options_.syncWrites = false;
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir_);
+    }
+
+    std::vector<float> randomVector(std::mt19937& rng) {
+        std::normal_distribution<float> normal;
+        std::vector<float> v(options_.dim);
+        for (float& x : v) {
+            x = normal(rng);
+        }
+        return v;
+    }
+
+    std::filesystem::path dir_;
+    VectorStoreOptions options_;
+};
+
+// Repeated ids within a batch collapse to the last write
+TEST_F(VectorIngestorTest, BatchDedupKeepsLastWrite) {
+    std::mt19937 rng(1);
+    VectorStore store;
+    ASSERT_TRUE(store.open(options_));
+    VectorIngestor ingestor;
+    ASSERT_TRUE(ingestor.start(store));
+
+    std::vector<float> latest = randomVector(rng);
+    std::vector<VectorRecord> records = {
+        {"a", randomVector(rng), {{"version", "1"}}},
+        {"b", randomVector(rng), {{"version", "1"}}},
+        {"a", latest, {{"version", "2"}}},
+    };
+    uint64_t token = ingestor.submit(records);
+    ASSERT_GT(token, 0u);
+    ASSERT_TRUE(ingestor.waitFor(token, 5000));
+
+    EXPECT_EQ(store.count(), 2u);
+    std::vector<VectorQueryResult> results = store.query(latest, 1);
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_EQ(results[0].id, "a");
+    EXPECT_EQ(results[0].metadata["version"], "2");
+
+    IngestStats stats = ingestor.stats();
+    EXPECT_EQ(stats.submitted, 3u);
+    EXPECT_EQ(stats.written, 2u);
+    EXPECT_EQ(stats.duplicates, 1u);
+    EXPECT_EQ(stats.queued, 0u);
+}
+
+// Replaying a batch that is already stored writes nothing, before or after compaction
+TEST_F(VectorIngestorTest, ResubmitIsIdempotent) {
+    std::mt19937 rng(2);
+    VectorStore store;
+    ASSERT_TRUE(store.open(options_));
+    VectorIngestor ingestor;
+    ASSERT_TRUE(ingestor.start(store));
+
+    std::vector<VectorRecord> original;
+    for (int i = 0; i < 100; ++i) {
+        original.push_back({"doc-" + std::to_string(i), randomVector(rng), {{"url", "https://example.com"}}});
+    }
+
+    std::vector<VectorRecord> batch = original;
+    ASSERT_TRUE(ingestor.waitFor(ingestor.submit(batch), 5000));
+    EXPECT_EQ(ingestor.stats().written, 100u);
+
+    batch = original;
+    ASSERT_TRUE(ingestor.waitFor(ingestor.submit(batch), 5000));
+    EXPECT_EQ(ingestor.stats().written, 100u);
+
+    ASSERT_TRUE(store.compact());
+    batch = original;
+    batch[7].metadata["url"] = "https://example.org";
+    ASSERT_TRUE(ingestor.waitFor(ingestor.submit(batch), 5000));
+    EXPECT_EQ(ingestor.stats().written, 101u);
+    EXPECT_EQ(store.stats().deltaRecords, 1u);
+}
+
+// A query that waits for its token sees the writes behind it, from any producer
+TEST_F(VectorIngestorTest, ReadYourWrites) {
+    VectorStore store;
+    ASSERT_TRUE(store.open(options_));
+    VectorIngestor ingestor;
+    IngestOptions ingest;
+    ingest.queueCapacity = 64;    // Small enough that producers hit backpressure
+    ingest.maxBatch = 16;
+    ASSERT_TRUE(ingestor.start(store, ingest));
+
+    std::vector<std::thread> producers;
+    std::atomic<int> misses(0);
+    for (int p = 0; p < 4; ++p) {
+        producers.emplace_back([&, p] {
+            std::mt19937 rng(100 + p);
+            for (int round = 0; round < 20; ++round) {
+                std::vector<VectorRecord> records;
+                for (int i = 0; i < 10; ++i) {
+                    records.push_back({"p" + std::to_string(p) + "-" + std::to_string(round) + "-" +
+                                           std::to_string(i),
+                                       randomVector(rng), {}});
+                }
+                std::vector<float> probe = records.back().vector;
+                std::string id = records.back().id;
+                uint64_t token = ingestor.submit(records);
+                if (!ingestor.waitFor(token, 5000)) {
+                    ++misses;
+                    continue;
+                }
+                std::vector<VectorQueryResult> results = store.query(probe, 1);
+                if (results.empty() || results[0].id != id) {
+                    ++misses;
+                }
+            }
+        });
+    }
+    for (std::thread& producer : producers) {
+        producer.join();
+    }
+
+    EXPECT_EQ(misses.load(), 0);
+    EXPECT_EQ(store.count(), 800u);
+    EXPECT_EQ(ingestor.stats().queued, 0u);
+}
+
+// Records without an id are addressed by a hash of their text, under the prefix
+TEST_F(VectorIngestorTest, ContentIdsAndPrefix) {
+    std::mt19937 rng(3);
+    VectorStore store;
+    ASSERT_TRUE(store.open(options_));
+    VectorIngestor ingestor;
+    ASSERT_TRUE(ingestor.start(store));
+
+    std::vector<float> vector = randomVector(rng);
+    std::vector<VectorRecord> records = {{"", vector, {{"document", "hello world"}}}};
+    ASSERT_TRUE(ingestor.waitFor(ingestor.submit(records, "docs:"), 5000));
+
+    // services/vector-store/main.py: hashlib.sha256(text.encode()).hexdigest()[:16]
+    EXPECT_EQ(VectorIngestor::contentId("hello world"), "b94d27b9934d3e08");
+    std::string expected = "docs:" + VectorIngestor::contentId("hello world");
+    std::vector<VectorQueryResult> results = store.query(vector, 1);
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_EQ(results[0].id, expected);
+}
+
+// Batches with a bad record are rejected whole, and applied batches survive a reopen
+TEST_F(VectorIngestorTest, RejectsBadBatchAndPersists) {
+    std::mt19937 rng(4);
+    {
+        VectorStore store;
+        ASSERT_TRUE(store.open(options_));
+        VectorIngestor ingestor;
+        ASSERT_TRUE(ingestor.start(store));
+
+        std::vector<VectorRecord> bad = {{"ok", randomVector(rng), {}}, {"short", {1.0f, 2.0f}, {}}};
+        EXPECT_EQ(ingestor.submit(bad), 0u);
+
+        std::vector<VectorRecord> good = {{"x", randomVector(rng), {}}, {"y", randomVector(rng), {}}};
+        ASSERT_TRUE(ingestor.waitFor(ingestor.submit(good), 5000));
+        ingestor.stop();
+    }
+
+    VectorStore reopened;
+    ASSERT_TRUE(reopened.open(options_));
+    EXPECT_EQ(reopened.count(), 2u);
+}
+
+// A batch that cannot reach the log is reported lost, not visible
+TEST_F(VectorIngestorTest, ReportsLostBatches) {
+    std::mt19937 rng(6);
+    VectorStore store;
+    ASSERT_TRUE(store.open(options_));
+    VectorIngestor ingestor;
+    ASSERT_TRUE(ingestor.start(store));
+
+    std::vector<VectorRecord> good = {{"x", randomVector(rng), {}}, {"y", randomVector(rng), {}}};
+    uint64_t goodFirst = 0;
+    const uint64_t goodToken = ingestor.submit(good, "", &goodFirst);
+    ASSERT_TRUE(ingestor.waitFor(goodToken, 5000));
+
+    store.close();    // Log writes fail from here on
+    std::vector<VectorRecord> bad = {{"z", randomVector(rng), {}}, {"w", randomVector(rng), {}}};
+    uint64_t badFirst = 0;
+    const uint64_t badToken = ingestor.submit(bad, "", &badFirst);
+    ASSERT_TRUE(ingestor.waitFor(badToken, 5000));
+
+    EXPECT_EQ(badFirst, goodToken);
+    EXPECT_TRUE(ingestor.lost(badFirst, badToken));
+    EXPECT_TRUE(ingestor.lost(badToken - 1, badToken));
+    EXPECT_FALSE(ingestor.lost(goodFirst, goodToken));
+    EXPECT_EQ(ingestor.stats().failed, 2u);
+}
+
+// A producer blocked on a full queue gives up when the pipeline stops
+TEST_F(VectorIngestorTest, StopReleasesBlockedProducer) {
+    std::mt19937 rng(5);
+    VectorStore store;
+    ASSERT_TRUE(store.open(options_));
+    VectorIngestor ingestor;
+    IngestOptions ingest;
+    ingest.queueCapacity = 4;
+    ingest.maxBatch = 1;
+    ASSERT_TRUE(ingestor.start(store, ingest));
+
+    std::vector<VectorRecord> records;
+    for (int i = 0; i < 100000; ++i) {
+        records.push_back({"r" + std::to_string(i), randomVector(rng), {}});
+    }
+    uint64_t token = 1;
+    std::thread producer([&] { token = ingestor.submit(records); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ingestor.stop();
+    producer.join();
+    EXPECT_EQ(token, 0u);
+    EXPECT_LT(store.count(), 100000u);
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,372 @@
+#include <gtest/gtest.h>
+#include "../include/vector_store.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <unistd.h>
+
+// Test fixture for VectorStore
+class VectorStoreTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir_ = std::filesystem::temp_directory_path() / ("vector_store_test_" + std::to_string(getpid()));
+        std::filesystem::remove_all(dir_);
+        options_.directory = dir_.string();
+        options_.dim = 16;
+        options_.syncWrites = false;
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(dir_);
+    }
+
+    std::vector<float> randomVector(std::mt19937& rng) {
+        std::normal_distribution<float> normal;
+        std::vector<float> v(options_.dim);
+        for (float& x : v) {
+            x = normal(rng);
+        }
+        return v;
+    }
+
+    void fill(VectorStore& store, int count, std::mt19937& rng, const std::string& ns = "") {
+        for (int i = 0; i < count; ++i) {
+            VectorRecord record{"doc-" + std::to_string(i), randomVector(rng), {{"namespace", ns}}};
+            ASSERT_TRUE(store.upsert(record));
+        }
+    }
+
+    // Fraction of the exact top-10 (cosine) found by the store, over 50 random queries
+    double recall(const VectorStore& store, const std::vector<std::vector<float>>& vectors, std::mt19937& rng) {
+        const size_t k = 10;
+        size_t found = 0;
+        for (int q = 0; q < 50; ++q) {
+            std::vector<float> query = randomVector(rng);
+            normalizeVector(query.data(), options_.dim);
+
+            std::vector<std::pair<float, int>> exact;
+            for (size_t i = 0; i < vectors.size(); ++i) {
+                exact.push_back({1.0f - dotProduct(query.data(), vectors[i].data(), options_.dim),
+                                 static_cast<int>(i)});
+            }
+            std::partial_sort(exact.begin(), exact.begin() + k, exact.end());
+
+            std::vector<VectorQueryResult> results = store.query(query, k);
+            for (size_t i = 0; i < k; ++i) {
+                for (const VectorQueryResult& r : results) {
+                    found += r.id == std::to_string(exact[i].second) ? 1 : 0;
+                }
+            }
+        }
+        return static_cast<double>(found) / (50 * k);
+    }
+
+    std::filesystem::path dir_;
+    VectorStoreOptions options_;
+};
+
+// Compacted records survive a reopen and are served from the mapped segment
+TEST_F(VectorStoreTest, CompactAndReopen) {
+    std::mt19937 rng(1);
+    std::vector<float> probe;
+    {
+        VectorStore store;
+        ASSERT_TRUE(store.open(options_));
+        fill(store, 500, rng);
+        probe = randomVector(rng);
+        ASSERT_TRUE(store.upsert({"probe", probe, {{"url", "https://example.com"}}}));
+        ASSERT_TRUE(store.compact());
+        EXPECT_EQ(store.stats().segmentRows, 501u);
+        EXPECT_EQ(store.stats().deltaRecords, 0u);
+    }
+
+    VectorStore store;
+    ASSERT_TRUE(store.open(options_));
+    EXPECT_EQ(store.count(), 501u);
+    EXPECT_EQ(store.stats().deltaRecords, 0u);
+
+    std::vector<VectorQueryResult> results = store.query(probe, 3);
+    ASSERT_FALSE(results.empty());
+    EXPECT_EQ(results[0].id, "probe");
+    EXPECT_NEAR(results[0].distance, 0.0f, 1e-4f);
+    EXPECT_EQ(results[0].metadata["url"], "https://example.com");
+}
+
+// Uncompacted writes and deletes are replayed from the delta log
+TEST_F(VectorStoreTest, DeltaLogReplay) {
+    std::mt19937 rng(2);
+    std::vector<float> replacement = randomVector(rng);
+    {
+        VectorStore store;
+        ASSERT_TRUE(store.open(options_));
+        fill(store, 100, rng);
+        ASSERT_TRUE(store.compact());
+        ASSERT_TRUE(store.remove("doc-1"));
+        ASSERT_TRUE(store.upsert({"doc-2", replacement, {{"title", "replaced"}}}));
+        // Too long for the log's id length field
+        EXPECT_FALSE(store.upsert({std::string(65536, 'x'), replacement, {}}));
+        EXPECT_FALSE(store.remove(std::string(65536, 'x')));
+    }
+
+    VectorStore store;
+    ASSERT_TRUE(store.open(options_));
+    EXPECT_EQ(store.count(), 99u);
+    std::vector<VectorQueryResult> results = store.query(replacement, 1);
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_EQ(results[0].id, "doc-2");
+    EXPECT_EQ(results[0].metadata["title"], "replaced");
+
+    // Folding the delta keeps the same view
+    ASSERT_TRUE(store.compact());
+    EXPECT_EQ(store.count(), 99u);
+    EXPECT_EQ(store.stats().segmentRows, 99u);
+    for (const VectorQueryResult& r : store.query(randomVector(rng), 99)) {
+        EXPECT_NE(r.id, "doc-1");
+    }
+}
+
+// HNSW results over the segment agree with an exact scan
+TEST_F(VectorStoreTest, RecallAgainstBruteForce) {
+    std::mt19937 rng(3);
+    options_.flatScanThreshold = 0;
+    VectorStore store;
+    ASSERT_TRUE(store.open(options_));
+    std::vector<std::vector<float>> vectors;
+    for (int i = 0; i < 2000; ++i) {
+        vectors.push_back(randomVector(rng));
+        normalizeVector(vectors.back().data(), options_.dim);
+        ASSERT_TRUE(store.upsert({std::to_string(i), vectors.back(), {}}));
+        // Second half is inserted into a graph seeded from the first segment
+        if (i == 999) {
+            ASSERT_TRUE(store.compact());
+        }
+    }
+    ASSERT_TRUE(store.compact());
+    EXPECT_GT(recall(store, vectors, rng), 0.9);
+}
+
+// Searching quantized codes and re-ranking with float vectors keeps recall, across reopen
+TEST_F(VectorStoreTest, QuantizedRecall) {
+    for (QuantizerType type : {QuantizerType::Scalar8, QuantizerType::Product}) {
+        std::filesystem::remove_all(dir_);
+        options_.quantization = type;
+        options_.flatScanThreshold = 0;
+        std::mt19937 rng(5);
+        std::vector<std::vector<float>> vectors;
+        {
+            VectorStore store;
+            ASSERT_TRUE(store.open(options_));
+            for (int i = 0; i < 2000; ++i) {
+                vectors.push_back(randomVector(rng));
+                normalizeVector(vectors.back().data(), options_.dim);
+                ASSERT_TRUE(store.upsert({std::to_string(i), vectors.back(), {}}));
+                // Second compaction reuses the first codebook and only encodes new rows
+                if (i == 1499) {
+                    ASSERT_TRUE(store.compact());
+                }
+            }
+            ASSERT_TRUE(store.compact());
+        }
+
+        VectorStore store;
+        ASSERT_TRUE(store.open(options_));
+        EXPECT_EQ(store.stats().codeBytesPerVector, type == QuantizerType::Scalar8 ? 16u : 4u);
+        EXPECT_GT(recall(store, vectors, rng), 0.9) << "quantizer " << static_cast<int>(type);
+    }
+}
+
+// Small namespaces are answered by an exact scan of their rows, including uncompacted changes
+TEST_F(VectorStoreTest, FlatScanNamespaceIsExact) {
+    std::mt19937 rng(6);
+    options_.flatScanThreshold = 500;
+    options_.searchThreads = 2;
+    VectorStore store;
+    ASSERT_TRUE(store.open(options_));
+    std::map<std::string, std::vector<float>> small;
+    for (int i = 0; i < 3000; ++i) {
+        std::string id = std::to_string(i);
+        std::vector<float> v = randomVector(rng);
+        normalizeVector(v.data(), options_.dim);
+        std::string ns = i % 10 == 0 ? "small" : "large";
+        if (ns == "small") {
+            small[id] = v;
+        }
+        ASSERT_TRUE(store.upsert({id, v, {{"namespace", ns}}}));
+    }
+    ASSERT_TRUE(store.compact());
+    ASSERT_TRUE(store.remove("10"));
+    small.erase("10");
+
+    for (int q = 0; q < 20; ++q) {
+        std::vector<float> query = randomVector(rng);
+        normalizeVector(query.data(), options_.dim);
+        std::vector<std::pair<float, std::string>> exact;
+        for (const auto& kv : small) {
+            exact.push_back({1.0f - dotProduct(query.data(), kv.second.data(), options_.dim), kv.first});
+        }
+        std::sort(exact.begin(), exact.end());
+
+        std::vector<VectorQueryResult> results = store.query(query, 10, "small");
+        ASSERT_EQ(results.size(), 10u);
+        for (size_t i = 0; i < results.size(); ++i) {
+            EXPECT_EQ(results[i].id, exact[i].second);
+            EXPECT_NEAR(results[i].distance, exact[i].first, 1e-5f);
+        }
+    }
+}
+
+// Indexed filters are applied during traversal and flat scan, so selective filters return a full top-k
+TEST_F(VectorStoreTest, MetadataFilterPushdown) {
+    std::mt19937 rng(8);
+    options_.flatScanThreshold = 100;
+    VectorStore store;
+    ASSERT_TRUE(store.open(options_));
+    std::vector<std::vector<float>> vectors;
+    std::vector<Metadata> metadata;
+    for (int i = 0; i < 4000; ++i) {
+        vectors.push_back(randomVector(rng));
+        normalizeVector(vectors.back().data(), options_.dim);
+        // 8 urls of 500 rows, one url with 7 rows, and an unindexed title
+        std::string url = i < 7 ? "https://rare.example" : "https://site-" + std::to_string(i % 8) + ".example";
+        metadata.push_back({{"url", url},
+                            {"namespace", i % 2 ? "odd" : "even"},
+                            {"title", i % 4 < 2 ? "a" : "b"}});
+        ASSERT_TRUE(store.upsert({std::to_string(i), vectors.back(), metadata.back()}));
+    }
+    ASSERT_TRUE(store.compact());
+
+    auto check = [&](const MetadataFilter& where, size_t k, size_t expectedCount, double minRecall) {
+        size_t found = 0;
+        size_t wanted = 0;
+        for (int q = 0; q < 20; ++q) {
+            std::vector<float> query = randomVector(rng);
+            normalizeVector(query.data(), options_.dim);
+            std::vector<std::pair<float, int>> exact;
+            for (size_t i = 0; i < vectors.size(); ++i) {
+                bool matches = true;
+                for (const auto& c : where) {
+                    matches = matches && metadata[i][c.first] == c.second;
+                }
+                if (matches) {
+                    exact.push_back({1.0f - dotProduct(query.data(), vectors[i].data(), options_.dim),
+                                     static_cast<int>(i)});
+                }
+            }
+            std::sort(exact.begin(), exact.end());
+            exact.resize(std::min(k, exact.size()));
+
+            std::vector<VectorQueryResult> results = store.query(query, k, where);
+            ASSERT_EQ(results.size(), expectedCount);
+            for (const VectorQueryResult& r : results) {
+                for (const auto& c : where) {
+                    EXPECT_EQ(r.metadata.at(c.first), c.second);
+                }
+            }
+            for (const auto& e : exact) {
+                for (const VectorQueryResult& r : results) {
+                    found += r.id == std::to_string(e.second) ? 1 : 0;
+                }
+            }
+            wanted += exact.size();
+        }
+        EXPECT_GE(static_cast<double>(found) / wanted, minRecall);
+    };
+
+    check({{"url", "https://rare.example"}}, 10, 7, 1.0);                          // Flat scan of 7 rows
+    check({{"url", "https://site-3.example"}}, 10, 10, 0.9);                       // Filtered traversal
+    check({{"url", "https://site-3.example"}, {"namespace", "odd"}}, 10, 10, 0.9);  // Bitmap intersection
+    check({{"url", "https://site-2.example"}, {"title", "b"}}, 10, 10, 0.9);       // Unindexed residual
+    EXPECT_TRUE(store.query(vectors[0], 10, MetadataFilter{{"url", "https://missing.example"}}).empty());
+}
+
+// Namespace filtering and namespace deletes
+TEST_F(VectorStoreTest, NamespaceFilter) {
+    std::mt19937 rng(4);
+    VectorStore store;
+    ASSERT_TRUE(store.open(options_));
+    for (int i = 0; i < 300; ++i) {
+        std::string ns = i % 10 == 0 ? "session-a" : "session-b";
+        ASSERT_TRUE(store.upsert({"doc-" + std::to_string(i), randomVector(rng), {{"namespace", ns}}}));
+    }
+    ASSERT_TRUE(store.compact());
+
+    std::vector<VectorQueryResult> results = store.query(randomVector(rng), 10, "session-a");
+    EXPECT_EQ(results.size(), 10u);
+    for (const VectorQueryResult& r : results) {
+        EXPECT_EQ(r.metadata.at("namespace"), "session-a");
+    }
+
+    EXPECT_EQ(store.removeNamespace("session-a"), 30u);
+    EXPECT_TRUE(store.query(randomVector(rng), 10, "session-a").empty());
+    EXPECT_EQ(store.count(), 270u);
+}
+
+// A damaged segment header is rejected instead of being served
+TEST_F(VectorStoreTest, RejectsCorruptSegment) {
+    std::mt19937 rng(5);
+    std::string segmentPath;
+    {
+        VectorStore store;
+        ASSERT_TRUE(store.open(options_));
+        fill(store, 10, rng);
+        ASSERT_TRUE(store.compact());
+        std::ifstream current(dir_ / "CURRENT");
+        std::getline(current, segmentPath);
+        segmentPath = (dir_ / segmentPath).string();
+    }
+
+    VectorSegment segment;
+    ASSERT_TRUE(segment.open(segmentPath));
+    segment.close();
+
+    std::fstream file(segmentPath, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(20);
+    file.put('\x7f');
+    file.close();
+    EXPECT_FALSE(segment.open(segmentPath));
+}
+
+// A torn record at the end of the delta log is dropped on replay
+TEST_F(VectorStoreTest, TruncatesTornLogTail) {
+    std::mt19937 rng(6);
+    {
+        VectorStore store;
+        ASSERT_TRUE(store.open(options_));
+        fill(store, 5, rng);
+    }
+    std::ofstream log(dir_ / "delta-00000000.log", std::ios::app | std::ios::binary);
+    log.write("\x40\x00\x00\x00garbage", 11);
+    log.close();
+
+    VectorStore store;
+    ASSERT_TRUE(store.open(options_));
+    EXPECT_EQ(store.count(), 5u);
+    ASSERT_TRUE(store.upsert({"after", randomVector(rng), {}}));
+    store.close();
+    ASSERT_TRUE(store.open(options_));
+    EXPECT_EQ(store.count(), 6u);
+}
+
+// Records of another dimension are skipped on replay rather than folded into the segment
+TEST_F(VectorStoreTest, SkipsLogRecordsOfAnotherDim) {
+    std::mt19937 rng(7);
+    {
+        VectorStore store;
+        ASSERT_TRUE(store.open(options_));
+        fill(store, 5, rng);
+    }
+    options_.dim = 8;
+    VectorStore store;
+    ASSERT_TRUE(store.open(options_));
+    EXPECT_EQ(store.count(), 0u);
+    ASSERT_TRUE(store.upsert({"narrow", randomVector(rng), {}}));
+    ASSERT_TRUE(store.compact());
+    EXPECT_EQ(store.stats().segmentRows, 1u);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,285 @@
+#include <gtest/gtest.h>
+#include "../include/double_array_trie.h"
+#include "../include/unicode_util.h"
+#include "../include/wordpiece_tokenizer.h"
+#include "allocation_counter.h"
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// The straightforward BertTokenizer algorithm (string per word, substring
+// lookups in a hash map), used as the parity reference
+class ReferenceTokenizer {
+public:
+    explicit ReferenceTokenizer(const std::vector<std::string>& vocab) {
+        for (size_t i = 0; i < vocab.size(); ++i) {
+            vocabulary_.emplace(vocab[i], static_cast<int32_t>(i));
+        }
+    }
+
+    std::vector<int32_t> encode(const std::string& text) const {
+        std::vector<int32_t> ids;
+        std::vector<std::string> words;
+        std::string word;
+        auto flush = [&] {
+            if (!word.empty()) {
+                words.push_back(word);
+                word.clear();
+            }
+        };
+        const char* p = text.data();
+        const char* end = p + text.size();
+        while (p < end) {
+            uint32_t cp = decodeUtf8(p, end);
+            if (cp == 0 || cp == 0xFFFD || isUnicodeControl(cp)) {
+                continue;
+            }
+            if (isUnicodeWhitespace(cp)) {
+                flush();
+                continue;
+            }
+            cp = stripAccent(toLowerCodePoint(cp));
+            if (isCombiningMark(cp)) {
+                continue;
+            }
+            if (isCjkIdeograph(cp) || isUnicodePunctuation(cp)) {
+                flush();
+                appendUtf8(cp, word);
+                flush();
+                continue;
+            }
+            appendUtf8(cp, word);
+        }
+        flush();
+
+        const int32_t unknown = vocabulary_.at("[UNK]");
+        for (const std::string& w : words) {
+            std::vector<size_t> boundaries;
+            const char* q = w.data();
+            while (q < w.data() + w.size()) {
+                boundaries.push_back(static_cast<size_t>(q - w.data()));
+                decodeUtf8(q, w.data() + w.size());
+            }
+            boundaries.push_back(w.size());
+            if (boundaries.size() - 1 > 100) {
+                ids.push_back(unknown);
+                continue;
+            }
+            std::vector<int32_t> pieces;
+            size_t start = 0;
+            while (start + 1 < boundaries.size()) {
+                size_t stop = boundaries.size() - 1;
+                for (; stop > start; --stop) {
+                    std::string candidate = w.substr(boundaries[start], boundaries[stop] - boundaries[start]);
+                    auto it = vocabulary_.find(start > 0 ? "##" + candidate : candidate);
+                    if (it != vocabulary_.end()) {
+                        pieces.push_back(it->second);
+                        break;
+                    }
+                }
+                if (stop == start) {
+                    pieces.assign(1, unknown);
+                    break;
+                }
+                start = stop;
+            }
+            ids.insert(ids.end(), pieces.begin(), pieces.end());
+        }
+        return ids;
+    }
+
+private:
+    std::unordered_map<std::string, int32_t> vocabulary_;
+};
+
+// Fixed-seed corpus mixing ASCII words, case, accents, Greek, Cyrillic, CJK,
+// punctuation, controls, invalid bytes, Unicode spaces and very long words
+std::string makeCorpus(size_t words, uint32_t seed) {
+    const char* fragments[] = {"the", "The", "QUICK", "brown", "fox", "jumps", "over", "lazy", "dog", "running",
+                               "unaffable", "Café", "naïve", "résumé", "Ζώο", "Москва", "中文", "日本語",
+                               "hello", "world", "co-operate", "don't", "e.g.", "3.14159", "x86_64", "ÅNGSTRÖM",
+                               "cafe\xCC\x81", "zero\xE2\x80\x8Bwidth", "tab\there", "\xFF\xFE", "emoji😀ok",
+                               "NBSP\xC2\xA0space", "ideographic\xE3\x80\x80space", "«quoted»", "—dash—"};
+    const char* separators[] = {" ", " ", " ", "  ", "\n", ", ", ". ", "!", "\t", "(", ")", "\x01"};
+    std::mt19937 rng(seed);
+    std::string text;
+    for (size_t i = 0; i < words; ++i) {
+        if (rng() % 200 == 0) {
+            text.append(150 + rng() % 50, 'a');    // overlong word
+        } else if (rng() % 50 == 0) {
+            text += "Supercalifragilisticexpialidocious";
+        } else {
+            text += fragments[rng() % (sizeof(fragments) / sizeof(fragments[0]))];
+        }
+        text += separators[rng() % (sizeof(separators) / sizeof(separators[0]))];
+    }
+    return text;
+}
+
+} // namespace
+
+// Test fixture for WordPieceTokenizer
+class WordPieceTokenizerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        std::vector<std::string> vocab = {"[PAD]", "[UNK]", "[CLS]", "[SEP]", "[MASK]", "hello", "world", ",",
+                                          "!",     "un",    "##aff", "##able", "cafe", "naive", "中", "文",
+                                          "the",   "##s",   "cat",   "'",      "don", "t", "##ing", "run",
+                                          "##n",   "ζ",     "##ω",   "и",      "##и", "е"};
+        ASSERT_TRUE(tokenizer_.setVocabulary(vocab));
+    }
+
+    std::vector<std::string> tokenize(const std::string& text) {
+        std::vector<std::string> pieces;
+        tokenizer_.tokenize(text, pieces);
+        return pieces;
+    }
+
+    WordPieceTokenizer tokenizer_;
+};
+
+// Whitespace and punctuation splitting with lower-casing
+TEST_F(WordPieceTokenizerTest, SplitsPunctuation) {
+    EXPECT_EQ(tokenize("Hello, World!"), (std::vector<std::string>{"hello", ",", "world", "!"}));
+    EXPECT_EQ(tokenize("  HELLO\tworld\n"), (std::vector<std::string>{"hello", "world"}));
+    EXPECT_EQ(tokenize("don't"), (std::vector<std::string>{"don", "'", "t"}));
+}
+
+// Greedy longest-match-first pieces, and [UNK] for words that cannot be covered
+TEST_F(WordPieceTokenizerTest, LongestMatchPieces) {
+    EXPECT_EQ(tokenize("unaffable"), (std::vector<std::string>{"un", "##aff", "##able"}));
+    EXPECT_EQ(tokenize("cats running"), (std::vector<std::string>{"cat", "##s", "run", "##n", "##ing"}));
+    EXPECT_EQ(tokenize("unxyz hello"), (std::vector<std::string>{"[UNK]", "hello"}));
+    EXPECT_EQ(tokenize(std::string(101, 'a')), (std::vector<std::string>{"[UNK]"}));
+}
+
+// Accents are stripped after lower-casing; CJK ideographs are single words; controls vanish
+TEST_F(WordPieceTokenizerTest, NormalizesUnicode) {
+    EXPECT_EQ(tokenize("CAFÉ naïve"), (std::vector<std::string>{"cafe", "naive"}));
+    EXPECT_EQ(tokenize("cafe\xCC\x81"), (std::vector<std::string>{"cafe"}));    // combining acute
+    EXPECT_EQ(tokenize("中文"), (std::vector<std::string>{"中", "文"}));
+    EXPECT_EQ(tokenize("hel\x01lo\xE2\x80\x8B"), (std::vector<std::string>{"hello"}));
+    EXPECT_EQ(tokenize("Ζώ"), (std::vector<std::string>{"ζ", "##ω"}));
+    EXPECT_EQ(tokenize("ИЙ Ё"), (std::vector<std::string>{"и", "##и", "е"}));
+    EXPECT_EQ(tokenize("\xFF\xFEhello"), (std::vector<std::string>{"hello"}));    // invalid UTF-8 dropped
+}
+
+// encode() wraps pieces in [CLS] ... [SEP] and truncates to the length limit
+TEST_F(WordPieceTokenizerTest, EncodesWithSpecialTokens) {
+    std::vector<int32_t> ids;
+    tokenizer_.encode("hello world!", 512, ids);
+    EXPECT_EQ(ids, (std::vector<int32_t>{2, 5, 6, 8, 3}));
+
+    tokenizer_.encode("hello world!", 4, ids);
+    EXPECT_EQ(ids, (std::vector<int32_t>{2, 5, 6, 3}));
+
+    tokenizer_.encode("", 8, ids);
+    EXPECT_EQ(ids, (std::vector<int32_t>{2, 3}));
+}
+
+// Every key is found with its value; prefixes and other strings are not
+TEST_F(WordPieceTokenizerTest, DoubleArrayTrieLookup) {
+    std::mt19937 rng(3);
+    std::vector<std::string> keys;
+    std::vector<int32_t> values;
+    for (int i = 0; i < 5000; ++i) {
+        std::string key;
+        size_t length = 1 + rng() % 12;
+        for (size_t j = 0; j < length; ++j) {
+            key.push_back(static_cast<char>(rng() % 2 ? 'a' + rng() % 6 : rng() % 256));
+        }
+        keys.push_back(key);
+        values.push_back(i);
+    }
+    keys.push_back(keys[10]);    // duplicate: the first value wins
+    values.push_back(99999);
+    DoubleArrayTrie trie;
+    trie.build(keys, values);
+
+    std::unordered_map<std::string, int32_t> expected;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        expected.emplace(keys[i], values[i]);
+    }
+    for (const auto& kv : expected) {
+        EXPECT_EQ(trie.find(kv.first.data(), kv.first.size()), kv.second);
+        std::string longer = kv.first + "\x7F\x7F";
+        if (!expected.count(longer)) {
+            EXPECT_EQ(trie.find(longer.data(), longer.size()), -1);
+        }
+    }
+    EXPECT_EQ(trie.find(keys[10].data(), keys[10].size()), 10);
+    EXPECT_EQ(trie.find("", 0), -1);
+}
+
+// Identical ids to the reference implementation on a fixed mixed-script corpus
+TEST_F(WordPieceTokenizerTest, MatchesReferenceOnCorpus) {
+    std::vector<std::string> vocab = {"[PAD]", "[UNK]", "[CLS]", "[SEP]"};
+    for (const char* word : {"the", "quick", "brown", "fox", "jump", "over", "lazy", "dog", "run", "un", "hello",
+                             "world", "co", "operate", "don", "e", "g", "x", "cafe", "naive", "resume", "ζ",
+                             "москва", "中", "文", "日", "本", "語", "super", "cal", "angstrom", "quote"}) {
+        vocab.push_back(word);
+    }
+    for (const char* piece : {"##s", "##ing", "##n", "##aff", "##able", "##ω", "##ο", "##86", "##_", "##64",
+                              "##i", "##fragil", "##istic", "##ex", "##pi", "##ali", "##doc", "##ious", "##ed",
+                              "##ok", "##dash", "##width"}) {
+        vocab.push_back(piece);
+    }
+    for (char c = 'a'; c <= 'z'; ++c) {
+        vocab.push_back(std::string(1, c));
+        vocab.push_back("##" + std::string(1, c));
+    }
+    for (const char* symbol : {".", ",", "!", "(", ")", "'", "-", "«", "»", "—", "3", "1", "4", "##1", "##4",
+                               "##5", "##9"}) {
+        vocab.push_back(symbol);
+    }
+    ASSERT_TRUE(tokenizer_.setVocabulary(vocab));
+    ReferenceTokenizer reference(vocab);
+
+    std::string corpus = makeCorpus(20000, 11);
+    std::vector<int32_t> ids(corpus.size());
+    ids.resize(tokenizer_.encode(corpus, ids.data(), ids.size()));
+    std::vector<int32_t> expected = reference.encode(corpus);
+    ASSERT_EQ(ids.size(), expected.size());
+    EXPECT_EQ(ids, expected);
+
+    // Line by line as well, so word boundaries at buffer ends are covered
+    size_t start = 0;
+    while (start < corpus.size()) {
+        size_t stop = std::min(corpus.size(), start + 1 + (start * 7919) % 300);
+        std::string line = corpus.substr(start, stop - start);
+        std::vector<int32_t> lineIds(line.size());
+        lineIds.resize(tokenizer_.encode(line, lineIds.data(), lineIds.size()));
+        ASSERT_EQ(lineIds, reference.encode(line)) << "at byte " << start;
+        start = stop;
+    }
+}
+
+// A short buffer receives a prefix of the full encoding, and encoding allocates nothing
+TEST_F(WordPieceTokenizerTest, EncodesIntoCallerBuffer) {
+    std::string text = "Unaffable cats, running! " + std::string(300, 'x') + " hello WORLD 中文";
+    std::vector<int32_t> full(text.size());
+    full.resize(tokenizer_.encode(text, full.data(), full.size()));
+    ASSERT_GT(full.size(), 6u);
+    for (size_t capacity = 0; capacity <= full.size(); ++capacity) {
+        std::vector<int32_t> prefix(capacity);
+        ASSERT_EQ(tokenizer_.encode(text, prefix.data(), capacity), capacity);
+        EXPECT_TRUE(std::equal(prefix.begin(), prefix.end(), full.begin()));
+    }
+
+    int32_t buffer[64];
+    size_t before = allocations.load();
+    size_t count = 0;
+    for (int i = 0; i < 100; ++i) {
+        count += tokenizer_.encode(text, buffer, 64);
+    }
+    EXPECT_EQ(allocations.load(), before);
+    EXPECT_EQ(count, 100 * full.size());
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}